@@ -1,11 +1,24 @@
 #include <windows.h>
 #include <iostream>
 #include <string>
-#include <locale>
-#include <codecvt>
+#include <shellapi.h>
 #include "WinShellPreview.h"
 
 #pragma comment(lib, "ole32.lib")
+#pragma comment(lib, "shell32.lib")
+
+// UTF-8 for console output
+std::string ToUtf8(const std::wstring& text)
+{
+    std::string out;
+    int len = WideCharToMultiByte(CP_UTF8, 0, text.c_str(), (int)text.size(), nullptr, 0, nullptr, nullptr);
+    if (len > 0)
+    {
+        out.resize(len);
+        WideCharToMultiByte(CP_UTF8, 0, text.c_str(), (int)text.size(), &out[0], len, nullptr, nullptr);
+    }
+    return out;
+}
 
 void PrintUsage(const char* programName)
 {
@@ -83,8 +96,25 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    std::string inputFile = argv[1 + argOffset];
-    std::string outputFile = argv[2 + argOffset];
+    // argv is in the ANSI code page, which cannot represent every file name; read the
+    // UTF-16 command line instead
+    int wargc = 0;
+    LPWSTR* wargv = CommandLineToArgvW(GetCommandLineW(), &wargc);
+    if (!wargv || wargc < 3 + argOffset)
+    {
+        std::cerr << "Failed to read the command line" << std::endl;
+        if (wargv)
+            LocalFree(wargv);
+        CoUninitialize();
+        return 1;
+    }
+    std::wstring wInputFile = wargv[1 + argOffset];
+    std::wstring wOutputFile = wargv[2 + argOffset];
+    LocalFree(wargv);
+
+    SetConsoleOutputCP(CP_UTF8);
+    std::string inputFile = ToUtf8(wInputFile);
+    std::string outputFile = ToUtf8(wOutputFile);
     UINT size = 256;
 
     if (argc >= 4 + argOffset)
@@ -92,10 +122,6 @@ int main(int argc, char* argv[])
         size = std::stoul(argv[3 + argOffset]);
     }
 
-    std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-    std::wstring wInputFile = converter.from_bytes(inputFile);
-    std::wstring wOutputFile = converter.from_bytes(outputFile);
-
     std::cout << "Input file: " << inputFile << std::endl;
     std::cout << "Output file: " << outputFile << std::endl;
     std::cout << "Size: " << size << "x" << size << std::endl;
@@ -0,0 +1,152 @@
+#include "pch.h"
+#include "AtlasImpl.h"
+#include "BitmapUtils.h"
+#include "TextUtils.h"
+#include "ThumbnailAtlas.h"
+#include "ThumbnailImpl.h"
+#include <mutex>
+
+namespace
+{
+    const UINT MIN_PAGE_SIZE = 64;
+    const UINT MAX_PAGE_SIZE = 4096;    // 64MB per page, the largest pooled buffer class
+
+    // Behind the opaque WSP_ATLAS handle. Extraction runs outside the lock, packing inside it.
+    struct AtlasHandle
+    {
+        AtlasHandle(UINT pageWidth, UINT pageHeight, UINT padding) : atlas(pageWidth, pageHeight, padding) {}
+
+        std::mutex lock;
+        ThumbnailAtlas atlas;
+    };
+
+    AtlasHandle* FromHandle(WSP_ATLAS hAtlas)
+    {
+        return reinterpret_cast<AtlasHandle*>(hAtlas);
+    }
+
+    void ToRect(const ThumbnailAtlas::Entry& entry, WSP_ATLAS_RECT* pRect)
+    {
+        if (!pRect)
+            return;
+        pRect->page = entry.page;
+        pRect->x = entry.rect.x;
+        pRect->y = entry.rect.y;
+        pRect->width = entry.rect.width;
+        pRect->height = entry.rect.height;
+    }
+
+    HRESULT AddPixels(AtlasHandle* handle, const std::string& id, const PixelImage& image, WSP_ATLAS_RECT* pRect)
+    {
+        std::lock_guard<std::mutex> lock(handle->lock);
+        ThumbnailAtlas::Entry entry;
+        if (!handle->atlas.Add(id, image, &entry))
+        {
+            bool tooLarge = image.width > handle->atlas.PageWidth() || image.height > handle->atlas.PageHeight();
+            return tooLarge ? E_INVALIDARG : E_OUTOFMEMORY;
+        }
+        ToRect(entry, pRect);
+        return S_OK;
+    }
+}
+
+HRESULT CreateThumbnailAtlasImpl(UINT pageWidth, UINT pageHeight, UINT padding, WSP_ATLAS* phAtlas)
+{
+    if (!phAtlas)
+        return E_INVALIDARG;
+
+    *phAtlas = nullptr;
+
+    if (pageWidth < MIN_PAGE_SIZE || pageHeight < MIN_PAGE_SIZE ||
+        pageWidth > MAX_PAGE_SIZE || pageHeight > MAX_PAGE_SIZE || padding >= MIN_PAGE_SIZE)
+        return E_INVALIDARG;
+
+    AtlasHandle* handle = new (std::nothrow) AtlasHandle(pageWidth, pageHeight, padding);
+    if (!handle)
+        return E_OUTOFMEMORY;
+
+    *phAtlas = reinterpret_cast<WSP_ATLAS>(handle);
+    return S_OK;
+}
+
+HRESULT OpenThumbnailAtlasImpl(LPCWSTR basePath, WSP_ATLAS* phAtlas)
+{
+    if (!basePath || !phAtlas)
+        return E_INVALIDARG;
+
+    *phAtlas = nullptr;
+
+    AtlasHandle* handle = new (std::nothrow) AtlasHandle(MIN_PAGE_SIZE, MIN_PAGE_SIZE, 0);
+    if (!handle)
+        return E_OUTOFMEMORY;
+
+    if (!handle->atlas.Load(std::filesystem::path(basePath)))
+    {
+        delete handle;
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    *phAtlas = reinterpret_cast<WSP_ATLAS>(handle);
+    return S_OK;
+}
+
+HRESULT AddFileToAtlasImpl(WSP_ATLAS hAtlas, LPCWSTR filePath, UINT size, WSP_ATLAS_RECT* pRect)
+{
+    if (!hAtlas || !filePath || size == 0)
+        return E_INVALIDARG;
+
+    AtlasHandle* handle = FromHandle(hAtlas);
+
+    // The id is the path, so adding the same file twice returns the existing rectangle
+    std::string id = WideToUtf8(filePath);
+    {
+        std::lock_guard<std::mutex> lock(handle->lock);
+        const ThumbnailAtlas::Entry* existing = handle->atlas.Find(id);
+        if (existing)
+        {
+            ToRect(*existing, pRect);
+            return S_FALSE;
+        }
+    }
+
+    HBITMAP hBitmap = nullptr;
+    HRESULT hr = GetFileThumbnailImpl(filePath, size, &hBitmap);
+    if (FAILED(hr))
+        return hr;
+
+    PixelImage image;
+    hr = HBITMAPToPixelImage(hBitmap, &image);
+    DeleteObject(hBitmap);
+    if (FAILED(hr))
+        return hr;
+
+    return AddPixels(handle, id, image, pRect);
+}
+
+HRESULT AddBitmapToAtlasImpl(WSP_ATLAS hAtlas, LPCWSTR id, HBITMAP hBitmap, WSP_ATLAS_RECT* pRect)
+{
+    if (!hAtlas || !id || !hBitmap)
+        return E_INVALIDARG;
+
+    PixelImage image;
+    HRESULT hr = HBITMAPToPixelImage(hBitmap, &image);
+    if (FAILED(hr))
+        return hr;
+
+    return AddPixels(FromHandle(hAtlas), WideToUtf8(id), image, pRect);
+}
+
+HRESULT SaveThumbnailAtlasImpl(WSP_ATLAS hAtlas, LPCWSTR basePath)
+{
+    if (!hAtlas || !basePath)
+        return E_INVALIDARG;
+
+    AtlasHandle* handle = FromHandle(hAtlas);
+    std::lock_guard<std::mutex> lock(handle->lock);
+    return handle->atlas.Save(std::filesystem::path(basePath)) ? S_OK : E_FAIL;
+}
+
+void CloseThumbnailAtlasImpl(WSP_ATLAS hAtlas)
+{
+    delete FromHandle(hAtlas);
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include "framework.h"
+#include "WinShellPreview.h"
+
+// Thumbnail atlas (sprite sheet) handles
+HRESULT CreateThumbnailAtlasImpl(UINT pageWidth, UINT pageHeight, UINT padding, WSP_ATLAS* phAtlas);
+HRESULT OpenThumbnailAtlasImpl(LPCWSTR basePath, WSP_ATLAS* phAtlas);
+HRESULT AddFileToAtlasImpl(WSP_ATLAS hAtlas, LPCWSTR filePath, UINT size, WSP_ATLAS_RECT* pRect);
+HRESULT AddBitmapToAtlasImpl(WSP_ATLAS hAtlas, LPCWSTR id, HBITMAP hBitmap, WSP_ATLAS_RECT* pRect);
+HRESULT SaveThumbnailAtlasImpl(WSP_ATLAS hAtlas, LPCWSTR basePath);
+void CloseThumbnailAtlasImpl(WSP_ATLAS hAtlas);
@@ -1,9 +1,13 @@
 #include "pch.h"
 #include "BitmapUtils.h"
+#include "BufferPool.h"
+#include "PathTable.h"
+#include "PngWriter.h"
 #include <memory>
 #include <gdiplus.h>
 #include <algorithm>
 #include <cctype>
+#include <functional>
 #include <string>
 
 #pragma comment(lib, "gdiplus.lib")
@@ -118,8 +122,16 @@ HBITMAP CropFromTopLeft(HBITMAP hBitmap, int targetWidth, int targetHeight)
         return nullptr;
     }
 
-    // 新しいビットマップを作成（スクリーンDCから作成してカラー対応）
-    HBITMAP hbmNew = CreateCompatibleBitmap(hdcScreen, width, height);
+    // 新しいビットマップを作成（32bpp DIB なのでアルファもそのまま残る）
+    BITMAPINFO bi = {};
+    bi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bi.bmiHeader.biWidth = width;
+    bi.bmiHeader.biHeight = -height; // top-down
+    bi.bmiHeader.biPlanes = 1;
+    bi.bmiHeader.biBitCount = 32;
+    bi.bmiHeader.biCompression = BI_RGB;
+    void* bits = nullptr;
+    HBITMAP hbmNew = CreateDIBSection(hdcScreen, &bi, DIB_RGB_COLORS, &bits, nullptr, 0);
     if (!hbmNew)
     {
         DeleteDC(hdcSrc);
@@ -242,9 +254,10 @@ HRESULT SaveBitmapAsBMP(HBITMAP hBitmap, LPCWSTR outputPath)
     bi.biCompression = BI_RGB;
     bi.biSizeImage = ((bmp.bmWidth * 24 + 31) / 32) * 4 * bmp.bmHeight;
 
+    // Pixel buffer comes from the per-thread pool instead of GlobalAlloc
     DWORD dwBmpSize = bi.biSizeImage;
-    HANDLE hDIB = GlobalAlloc(GHND, dwBmpSize);
-    if (!hDIB)
+    PooledBuffer dib;
+    if (!dib.Allocate(dwBmpSize))
     {
         SelectObject(memDC, oldBitmap);
         DeleteDC(memDC);
@@ -255,14 +268,12 @@ HRESULT SaveBitmapAsBMP(HBITMAP hBitmap, LPCWSTR outputPath)
         return E_OUTOFMEMORY;
     }
 
-    char* lpbitmap = (char*)GlobalLock(hDIB);
+    char* lpbitmap = reinterpret_cast<char*>(dib.Data());
     int result = GetDIBits(hdc, hBitmap, 0, bmp.bmHeight, lpbitmap, (BITMAPINFO*)&bi, DIB_RGB_COLORS);
     
     if (result == 0)
     {
         // GetDIBits failed, cleanup and return error
-        GlobalUnlock(hDIB);
-        GlobalFree(hDIB);
         SelectObject(memDC, oldBitmap);
         DeleteDC(memDC);
         DeleteDC(hdcMem);
@@ -275,8 +286,6 @@ HRESULT SaveBitmapAsBMP(HBITMAP hBitmap, LPCWSTR outputPath)
     HANDLE hFile = CreateFileW(outputPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
     if (hFile == INVALID_HANDLE_VALUE)
     {
-        GlobalUnlock(hDIB);
-        GlobalFree(hDIB);
         SelectObject(memDC, oldBitmap);
         DeleteDC(memDC);
         DeleteDC(hdcMem);
@@ -297,8 +306,6 @@ HRESULT SaveBitmapAsBMP(HBITMAP hBitmap, LPCWSTR outputPath)
     WriteFile(hFile, lpbitmap, dwBmpSize, &dwBytesWritten, nullptr);
 
     CloseHandle(hFile);
-    GlobalUnlock(hDIB);
-    GlobalFree(hDIB);
     SelectObject(memDC, oldBitmap);
     DeleteDC(memDC);
     DeleteDC(hdcMem);
@@ -319,13 +326,13 @@ HRESULT SaveBitmapToFileImpl(HBITMAP hBitmap, LPCWSTR outputPath)
     if (!hBitmap || !outputPath)
         return E_INVALIDARG;
 
-    std::wstring path(outputPath);
+    // Extension of the file name only; a dot in a directory name does not count
+    std::u16string_view path(reinterpret_cast<const char16_t*>(outputPath), wcslen(outputPath));
+    size_t dotPos = ExtensionOffset(path);
     std::wstring ext;
-    
-    size_t dotPos = path.find_last_of(L".");
-    if (dotPos != std::wstring::npos)
+    if (dotPos < path.size())
     {
-        ext = path.substr(dotPos + 1);
+        ext.assign(outputPath + dotPos + 1);
         // Convert to lowercase for comparison
         std::transform(ext.begin(), ext.end(), ext.begin(), ::towlower);
     }
@@ -333,6 +340,17 @@ HRESULT SaveBitmapToFileImpl(HBITMAP hBitmap, LPCWSTR outputPath)
     // Use WIC for PNG files to handle premultiplied alpha correctly
     if (ext == L"png")
     {
+        // Large outputs: WIC compresses on one thread, so deflate chunks on every core instead
+        BITMAP bmp = {};
+        if (GetObject(hBitmap, sizeof(BITMAP), &bmp) &&
+            static_cast<uint64_t>(bmp.bmWidth) * static_cast<uint64_t>(abs(bmp.bmHeight)) >= PARALLEL_PNG_MIN_PIXELS)
+        {
+            PixelImage image;
+            HRESULT hr = HBITMAPToPixelImage(hBitmap, &image);
+            if (FAILED(hr))
+                return hr;
+            return SavePixelImageAsPngParallel(image, std::filesystem::path(outputPath)) ? S_OK : E_FAIL;
+        }
         return SaveHBITMAPAsPng(hBitmap, outputPath);
     }
     else
@@ -342,3 +360,155 @@ HRESULT SaveBitmapToFileImpl(HBITMAP hBitmap, LPCWSTR outputPath)
     }
 }
 
+HRESULT ReadHBITMAPPixels(HBITMAP hBitmap, const std::function<uint8_t*(uint32_t width, uint32_t height)>& allocate, AlphaMode* pAlpha,
+                          size_t stride)
+{
+    if (!hBitmap || !pAlpha)
+        return E_INVALIDARG;
+
+    BITMAP bmp = {};
+    if (!GetObject(hBitmap, sizeof(BITMAP), &bmp) || bmp.bmWidth <= 0 || bmp.bmHeight <= 0)
+        return E_FAIL;
+
+    // allocate() sees the size first, so it can report what a too-small destination needed
+    uint8_t* pixels = allocate(static_cast<uint32_t>(bmp.bmWidth), static_cast<uint32_t>(bmp.bmHeight));
+    if (!pixels)
+        return E_OUTOFMEMORY;
+
+    size_t rowBytes = static_cast<size_t>(bmp.bmWidth) * 4;
+    if (stride == 0)
+        stride = rowBytes;
+    if (stride < rowBytes)
+        return E_INVALIDARG;
+
+    BITMAPINFO bi = {};
+    bi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bi.bmiHeader.biWidth = bmp.bmWidth;
+    bi.bmiHeader.biHeight = -bmp.bmHeight; // top-down
+    bi.bmiHeader.biPlanes = 1;
+    bi.bmiHeader.biBitCount = 32;
+    bi.bmiHeader.biCompression = BI_RGB;
+
+    HDC hdc = GetDC(nullptr);
+    int lines = GetDIBits(hdc, hBitmap, 0, bmp.bmHeight, pixels, &bi, DIB_RGB_COLORS);
+    ReleaseDC(nullptr, hdc);
+
+    if (lines != bmp.bmHeight)
+        return E_FAIL;
+
+    // GetDIBits packs 32bpp rows; spread them to the wider stride from the bottom up, in place
+    if (stride != rowBytes)
+    {
+        for (size_t y = static_cast<size_t>(bmp.bmHeight) - 1; y > 0; --y)
+            memmove(pixels + y * stride, pixels + y * rowBytes, rowBytes);
+    }
+
+    // Device-dependent bitmaps leave alpha at zero; treat them as opaque
+    bool alphaEmpty = true;
+    for (int y = 0; y < bmp.bmHeight && alphaEmpty; ++y)
+    {
+        const uint8_t* row = pixels + y * stride;
+        for (int x = 0; x < bmp.bmWidth && alphaEmpty; ++x)
+            alphaEmpty = row[x * 4 + 3] == 0;
+    }
+
+    if (bmp.bmBitsPixel < 32 || alphaEmpty)
+    {
+        for (int y = 0; y < bmp.bmHeight; ++y)
+        {
+            uint8_t* row = pixels + y * stride;
+            for (int x = 0; x < bmp.bmWidth; ++x)
+                row[x * 4 + 3] = 255;
+        }
+        *pAlpha = AlphaMode::Ignore;
+    }
+    else
+    {
+        *pAlpha = AlphaMode::Premultiplied;
+    }
+    return S_OK;
+}
+
+HRESULT HBITMAPToPixelImage(HBITMAP hBitmap, PixelImage* pImage)
+{
+    if (!hBitmap || !pImage)
+        return E_INVALIDARG;
+
+    HRESULT hr = ReadHBITMAPPixels(hBitmap, [pImage](uint32_t width, uint32_t height) -> uint8_t*
+    {
+        return pImage->Allocate(width, height) ? pImage->buffer.Data() : nullptr;
+    }, &pImage->alpha);
+
+    if (FAILED(hr))
+        pImage->Reset();
+    return hr;
+}
+
+HRESULT PixelImageToHBITMAP(const PixelImage& image, HBITMAP* phBitmap)
+{
+    if (image.Empty() || !phBitmap)
+        return E_INVALIDARG;
+
+    *phBitmap = nullptr;
+
+    BITMAPINFO bi = {};
+    bi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bi.bmiHeader.biWidth = (LONG)image.width;
+    bi.bmiHeader.biHeight = -(LONG)image.height; // top-down
+    bi.bmiHeader.biPlanes = 1;
+    bi.bmiHeader.biBitCount = 32;
+    bi.bmiHeader.biCompression = BI_RGB;
+
+    void* bits = nullptr;
+    HBITMAP hBitmap = CreateDIBSection(nullptr, &bi, DIB_RGB_COLORS, &bits, nullptr, 0);
+    if (!hBitmap || !bits)
+        return E_OUTOFMEMORY;
+
+    size_t rowBytes = static_cast<size_t>(image.width) * 4;
+    for (uint32_t y = 0; y < image.height; ++y)
+        memcpy(static_cast<uint8_t*>(bits) + y * rowBytes, image.Row(y), rowBytes);
+    GdiFlush();
+
+    *phBitmap = hBitmap;
+    return S_OK;
+}
+
+void ApplyThumbnailAlphaType(WTS_ALPHATYPE type, uint8_t* pixels, uint32_t width, uint32_t height, size_t stride, AlphaMode* pAlpha)
+{
+    if (type != WTSAT_RGB || *pAlpha == AlphaMode::Ignore)
+        return;
+
+    // The handler says opaque; whatever is in the alpha bytes is not transparency
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        uint8_t* row = pixels + y * stride;
+        for (uint32_t x = 0; x < width; ++x)
+            row[x * 4 + 3] = 255;
+    }
+    *pAlpha = AlphaMode::Ignore;
+}
+
+HRESULT CompositeBitmapOverColor(HBITMAP* phBitmap, COLORREF color)
+{
+    PixelImage image;
+    HRESULT hr = HBITMAPToPixelImage(*phBitmap, &image);
+    if (FAILED(hr))
+        return hr;
+
+    // Already opaque bitmaps have nothing to show through
+    if (image.alpha == AlphaMode::Ignore)
+        return S_OK;
+
+    CompositeOverBackground(image.buffer.Data(), image.width, image.height, image.stride, image.alpha,
+                            GetRValue(color), GetGValue(color), GetBValue(color));
+    image.alpha = AlphaMode::Ignore;
+
+    HBITMAP hFlat = nullptr;
+    hr = PixelImageToHBITMAP(image, &hFlat);
+    if (FAILED(hr))
+        return hr;
+
+    DeleteObject(*phBitmap);
+    *phBitmap = hFlat;
+    return S_OK;
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include "framework.h"
+#include "ImageOps.h"
+#include <functional>
 
 // Bitmap utility functions
 HRESULT SaveHBITMAPAsPng(HBITMAP hbmp, LPCWSTR outPath);
@@ -8,3 +10,17 @@ HRESULT SaveBitmapToFileImpl(HBITMAP hBitmap, LPCWSTR outputPath);
 HBITMAP ConvertToCompatibleBitmap(HBITMAP hSourceBitmap, int width, int height);
 HBITMAP CropFromTopLeft(HBITMAP hBitmap, int targetWidth, int targetHeight);
 
+// Conversion between GDI bitmaps and portable 32bpp BGRA images
+// Reads the bitmap as 32bpp top-down BGRA into the rows allocate() returns (stride bytes apart,
+// 0 = width * 4; nullptr to fail). Bitmaps without alpha come back opaque with AlphaMode::Ignore.
+HRESULT ReadHBITMAPPixels(HBITMAP hBitmap, const std::function<uint8_t*(uint32_t width, uint32_t height)>& allocate, AlphaMode* pAlpha,
+                          size_t stride = 0);
+HRESULT HBITMAPToPixelImage(HBITMAP hBitmap, PixelImage* pImage);
+HRESULT PixelImageToHBITMAP(const PixelImage& image, HBITMAP* phBitmap);
+
+// Applies the thumbnail handler's alpha type to pixels read with ReadHBITMAPPixels:
+// WTSAT_RGB forces them opaque, otherwise the detected mode stands
+void ApplyThumbnailAlphaType(WTS_ALPHATYPE type, uint8_t* pixels, uint32_t width, uint32_t height, size_t stride, AlphaMode* pAlpha);
+
+// Composites the bitmap over an opaque color, replacing *phBitmap with the flattened copy
+HRESULT CompositeBitmapOverColor(HBITMAP* phBitmap, COLORREF color);
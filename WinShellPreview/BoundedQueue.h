@@ -0,0 +1,120 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+struct BoundedQueueStats
+{
+    uint64_t pushed;
+    uint64_t popped;
+    uint64_t pushWaitMs;    // Producers blocked on a full queue (backpressure)
+    uint64_t popWaitMs;     // Consumers blocked on an empty queue (starvation)
+};
+
+// Blocking FIFO with a fixed capacity. Push blocks while the queue is full, so a fast
+// producer is held to at most `capacity` items ahead of its consumer.
+// Close() lets consumers drain what is left; Cancel() also drops it. No Windows dependencies.
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity)
+        : m_capacity(capacity ? capacity : 1), m_closed(false), m_stats()
+    {
+    }
+
+    // Returns false (and drops item) once the queue is closed
+    bool Push(T item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_closed && m_items.size() >= m_capacity)
+        {
+            Clock::time_point start = Clock::now();
+            m_notFull.wait(lock, [this]() { return m_closed || m_items.size() < m_capacity; });
+            m_stats.pushWaitMs += ElapsedMs(start);
+        }
+        if (m_closed)
+            return false;
+
+        m_items.push_back(std::move(item));
+        m_stats.pushed++;
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    // Returns false when the queue is closed and empty
+    bool Pop(T* item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_closed && m_items.empty())
+        {
+            Clock::time_point start = Clock::now();
+            m_notEmpty.wait(lock, [this]() { return m_closed || !m_items.empty(); });
+            m_stats.popWaitMs += ElapsedMs(start);
+        }
+        if (m_items.empty())
+            return false;
+
+        *item = std::move(m_items.front());
+        m_items.pop_front();
+        m_stats.popped++;
+        m_notFull.notify_one();
+        return true;
+    }
+
+    // No more pushes; queued items can still be popped
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+
+    // Close and discard queued items
+    void Cancel()
+    {
+        std::deque<T> dropped;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+            dropped.swap(m_items);
+            m_notEmpty.notify_all();
+            m_notFull.notify_all();
+        }
+        // Items are destroyed outside the lock
+    }
+
+    size_t Size() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_items.size();
+    }
+
+    size_t Capacity() const { return m_capacity; }
+
+    BoundedQueueStats Stats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static uint64_t ElapsedMs(Clock::time_point start)
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count());
+    }
+
+    const size_t m_capacity;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+    std::deque<T> m_items;
+    bool m_closed;
+    BoundedQueueStats m_stats;
+};
@@ -0,0 +1,348 @@
+#include "BufferPool.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    const size_t CLASS_COUNT = 15; // 4KB .. 64MB in powers of two
+
+    std::atomic<uint64_t> g_acquireCount{0};
+    std::atomic<uint64_t> g_reuseCount{0};
+    std::atomic<uint64_t> g_systemAllocCount{0};
+    std::atomic<uint64_t> g_systemFreeCount{0};
+    std::atomic<uint64_t> g_bytesInUse{0};
+    std::atomic<uint64_t> g_peakBytesInUse{0};
+    std::atomic<uint64_t> g_bytesCached{0};
+    std::atomic<uint64_t> g_arenaPeakBytes{0};
+
+    void UpdateMax(std::atomic<uint64_t>& target, uint64_t value)
+    {
+        uint64_t current = target.load(std::memory_order_relaxed);
+        while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void* SystemAlloc(size_t bytes)
+    {
+        g_systemAllocCount.fetch_add(1, std::memory_order_relaxed);
+#if defined(_MSC_VER)
+        return _aligned_malloc(bytes, BufferPool::ALIGNMENT);
+#else
+        return std::aligned_alloc(BufferPool::ALIGNMENT, bytes);
+#endif
+    }
+
+    void SystemFree(void* p)
+    {
+        g_systemFreeCount.fetch_add(1, std::memory_order_relaxed);
+#if defined(_MSC_VER)
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+
+    // Returns the size class for `bytes`, or CLASS_COUNT when the request bypasses the pool
+    size_t SizeClassOf(size_t bytes)
+    {
+        if (bytes > BufferPool::MAX_CLASS_SIZE)
+            return CLASS_COUNT;
+
+        size_t index = 0;
+        size_t classSize = BufferPool::MIN_CLASS_SIZE;
+        while (classSize < bytes)
+        {
+            classSize <<= 1;
+            ++index;
+        }
+        return index;
+    }
+
+    size_t ClassSize(size_t index)
+    {
+        return BufferPool::MIN_CLASS_SIZE << index;
+    }
+
+    // Free lists owned by one thread. Buffers released on a different thread than the one that
+    // acquired them simply migrate to the releasing thread's cache.
+    struct ThreadCache
+    {
+        std::vector<void*> freeLists[CLASS_COUNT];
+        size_t cachedBytes = 0;
+
+        ~ThreadCache()
+        {
+            Trim();
+        }
+
+        void Trim()
+        {
+            for (size_t i = 0; i < CLASS_COUNT; ++i)
+            {
+                for (void* p : freeLists[i])
+                    SystemFree(p);
+                freeLists[i].clear();
+            }
+            g_bytesCached.fetch_sub(cachedBytes, std::memory_order_relaxed);
+            cachedBytes = 0;
+        }
+    };
+
+    ThreadCache& CurrentThreadCache()
+    {
+        thread_local ThreadCache cache;
+        return cache;
+    }
+}
+
+void* BufferPool::Acquire(size_t bytes, size_t* pCapacity)
+{
+    if (bytes == 0)
+        bytes = 1;
+
+    g_acquireCount.fetch_add(1, std::memory_order_relaxed);
+
+    size_t index = SizeClassOf(bytes);
+    size_t capacity = (index < CLASS_COUNT) ? ClassSize(index) : (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    void* p = nullptr;
+
+    if (index < CLASS_COUNT)
+    {
+        ThreadCache& cache = CurrentThreadCache();
+        std::vector<void*>& freeList = cache.freeLists[index];
+        if (!freeList.empty())
+        {
+            p = freeList.back();
+            freeList.pop_back();
+            cache.cachedBytes -= capacity;
+            g_bytesCached.fetch_sub(capacity, std::memory_order_relaxed);
+            g_reuseCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (!p)
+    {
+        p = SystemAlloc(capacity);
+        if (!p)
+        {
+            if (pCapacity) *pCapacity = 0;
+            return nullptr;
+        }
+    }
+
+    uint64_t inUse = g_bytesInUse.fetch_add(capacity, std::memory_order_relaxed) + capacity;
+    UpdateMax(g_peakBytesInUse, inUse);
+
+    if (pCapacity) *pCapacity = capacity;
+    return p;
+}
+
+void BufferPool::Release(void* p, size_t capacity)
+{
+    if (!p)
+        return;
+
+    g_bytesInUse.fetch_sub(capacity, std::memory_order_relaxed);
+
+    size_t index = SizeClassOf(capacity);
+    if (index < CLASS_COUNT && ClassSize(index) == capacity)
+    {
+        ThreadCache& cache = CurrentThreadCache();
+        std::vector<void*>& freeList = cache.freeLists[index];
+        if (freeList.size() < MAX_CACHED_PER_CLASS &&
+            cache.cachedBytes + capacity <= MAX_CACHED_BYTES_PER_THREAD)
+        {
+            freeList.push_back(p);
+            cache.cachedBytes += capacity;
+            g_bytesCached.fetch_add(capacity, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    SystemFree(p);
+}
+
+void BufferPool::TrimCurrentThread()
+{
+    CurrentThreadCache().Trim();
+}
+
+BufferPoolStats BufferPool::GetStats()
+{
+    BufferPoolStats stats = {};
+    stats.acquireCount = g_acquireCount.load(std::memory_order_relaxed);
+    stats.reuseCount = g_reuseCount.load(std::memory_order_relaxed);
+    stats.systemAllocCount = g_systemAllocCount.load(std::memory_order_relaxed);
+    stats.systemFreeCount = g_systemFreeCount.load(std::memory_order_relaxed);
+    stats.bytesInUse = g_bytesInUse.load(std::memory_order_relaxed);
+    stats.peakBytesInUse = g_peakBytesInUse.load(std::memory_order_relaxed);
+    stats.bytesCached = g_bytesCached.load(std::memory_order_relaxed);
+    stats.arenaPeakBytes = g_arenaPeakBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void BufferPool::ResetStats()
+{
+    // bytesInUse / bytesCached describe live state and are not reset
+    g_acquireCount = 0;
+    g_reuseCount = 0;
+    g_systemAllocCount = 0;
+    g_systemFreeCount = 0;
+    g_peakBytesInUse = g_bytesInUse.load();
+    g_arenaPeakBytes = 0;
+}
+
+void BufferPool::ReportArenaPeak(size_t bytes)
+{
+    UpdateMax(g_arenaPeakBytes, bytes);
+}
+
+// PooledBuffer
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+    : m_data(other.m_data), m_size(other.m_size), m_capacity(other.m_capacity)
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+    other.m_capacity = 0;
+}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        Reset();
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        std::swap(m_capacity, other.m_capacity);
+    }
+    return *this;
+}
+
+bool PooledBuffer::Allocate(size_t bytes)
+{
+    Reset();
+    size_t capacity = 0;
+    m_data = static_cast<uint8_t*>(BufferPool::Acquire(bytes, &capacity));
+    if (!m_data)
+        return false;
+    m_size = bytes;
+    m_capacity = capacity;
+    return true;
+}
+
+void PooledBuffer::Reset()
+{
+    if (m_data)
+    {
+        BufferPool::Release(m_data, m_capacity);
+        m_data = nullptr;
+        m_size = 0;
+        m_capacity = 0;
+    }
+}
+
+// ScratchArena
+
+ScratchArena::ScratchArena(size_t blockSize)
+    : m_blockSize(blockSize < BufferPool::MIN_CLASS_SIZE ? BufferPool::MIN_CLASS_SIZE : blockSize)
+{
+}
+
+ScratchArena::~ScratchArena()
+{
+    BufferPool::ReportArenaPeak(m_peakBytes);
+    FreeBlocks(m_head);
+}
+
+ScratchArena::Block* ScratchArena::NewBlock(size_t minBytes)
+{
+    // Grow geometrically so a large request touches only a handful of blocks
+    size_t want = sizeof(Block) + minBytes + BufferPool::ALIGNMENT;
+    if (want < m_blockSize)
+        want = m_blockSize;
+    if (want < m_reserved)
+        want = m_reserved;
+
+    size_t capacity = 0;
+    void* p = BufferPool::Acquire(want, &capacity);
+    if (!p)
+        return nullptr;
+
+    Block* block = static_cast<Block*>(p);
+    block->next = nullptr;
+    block->capacity = capacity;
+    block->offset = sizeof(Block);
+    m_reserved += capacity;
+    return block;
+}
+
+void ScratchArena::FreeBlocks(Block* block)
+{
+    while (block)
+    {
+        Block* next = block->next;
+        BufferPool::Release(block, block->capacity);
+        block = next;
+    }
+}
+
+void* ScratchArena::Allocate(size_t bytes, size_t alignment)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+        return nullptr;
+
+    if (m_head)
+    {
+        uintptr_t base = reinterpret_cast<uintptr_t>(m_head);
+        size_t offset = (m_head->offset + alignment - 1) & ~(alignment - 1);
+        // Block starts are 64-byte aligned, so aligning the offset aligns the address for alignment <= 64
+        if (alignment > BufferPool::ALIGNMENT)
+            offset = ((base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+        if (offset + bytes <= m_head->capacity)
+        {
+            m_bytesUsed += (offset - m_head->offset) + bytes;
+            m_head->offset = offset + bytes;
+            if (m_bytesUsed > m_peakBytes)
+                m_peakBytes = m_bytesUsed;
+            return reinterpret_cast<uint8_t*>(m_head) + offset;
+        }
+    }
+
+    Block* block = NewBlock(bytes + alignment);
+    if (!block)
+        return nullptr;
+    block->next = m_head;
+    m_head = block;
+    return Allocate(bytes, alignment);
+}
+
+void ScratchArena::Reset()
+{
+    if (m_peakBytes)
+        BufferPool::ReportArenaPeak(m_peakBytes);
+
+    if (m_head)
+    {
+        // Keep the oldest block (normally the default-sized one) for the next round
+        Block* keep = m_head;
+        while (keep->next)
+            keep = keep->next;
+
+        Block* block = m_head;
+        while (block != keep)
+        {
+            Block* next = block->next;
+            BufferPool::Release(block, block->capacity);
+            block = next;
+        }
+        keep->offset = sizeof(Block);
+        m_head = keep;
+        m_reserved = keep->capacity;
+    }
+    m_bytesUsed = 0;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Size-class pool for pixel buffers and a bump arena for per-request scratch memory.
+// This module does not depend on Windows headers so it can be built and measured on any platform.
+
+struct BufferPoolStats
+{
+    uint64_t acquireCount;      // Number of Acquire calls
+    uint64_t reuseCount;        // Acquires served from a thread-local free list
+    uint64_t systemAllocCount;  // Allocations that went to the system allocator
+    uint64_t systemFreeCount;   // Buffers returned to the system allocator
+    uint64_t bytesInUse;        // Bytes currently handed out to callers
+    uint64_t peakBytesInUse;    // High-water mark of bytesInUse
+    uint64_t bytesCached;       // Bytes parked in free lists across all threads
+    uint64_t arenaPeakBytes;    // Largest scratch usage seen by a single ScratchArena
+};
+
+class BufferPool
+{
+public:
+    static const size_t ALIGNMENT = 64;
+    static const size_t MIN_CLASS_SIZE = 4 * 1024;           // 4KB
+    static const size_t MAX_CLASS_SIZE = 64 * 1024 * 1024;   // 64MB, larger requests bypass the pool
+    static const size_t MAX_CACHED_PER_CLASS = 8;
+    static const size_t MAX_CACHED_BYTES_PER_THREAD = 128 * 1024 * 1024;
+
+    // Returns a 64-byte aligned buffer of at least `bytes`. *pCapacity receives the real size,
+    // which must be passed back to Release.
+    static void* Acquire(size_t bytes, size_t* pCapacity);
+    static void Release(void* p, size_t capacity);
+
+    // Frees everything cached by the calling thread
+    static void TrimCurrentThread();
+
+    static BufferPoolStats GetStats();
+    static void ResetStats();
+
+    // Internal: used by ScratchArena to publish its high-water mark
+    static void ReportArenaPeak(size_t bytes);
+};
+
+// RAII owner of a pooled buffer
+class PooledBuffer
+{
+public:
+    PooledBuffer() = default;
+    explicit PooledBuffer(size_t bytes) { Allocate(bytes); }
+    ~PooledBuffer() { Reset(); }
+
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+    PooledBuffer(PooledBuffer&& other) noexcept;
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+
+    // Replaces the current contents. Returns false on allocation failure.
+    bool Allocate(size_t bytes);
+    void Reset();
+
+    uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+    size_t Capacity() const { return m_capacity; }
+    bool Empty() const { return m_data == nullptr; }
+
+private:
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_capacity = 0;
+};
+
+// Bump allocator for short-lived scratch memory inside one request.
+// Blocks come from BufferPool, so they are recycled across requests on the same thread.
+class ScratchArena
+{
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    explicit ScratchArena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+    ~ScratchArena();
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    void* Allocate(size_t bytes, size_t alignment = 16);
+
+    template <typename T>
+    T* AllocateArray(size_t count)
+    {
+        return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T) > 16 ? alignof(T) : 16));
+    }
+
+    // Releases every allocation but keeps the first block for reuse
+    void Reset();
+
+    size_t BytesUsed() const { return m_bytesUsed; }
+    size_t PeakBytes() const { return m_peakBytes; }
+
+private:
+    struct Block
+    {
+        Block* next;
+        size_t capacity;
+        size_t offset;
+    };
+
+    Block* NewBlock(size_t minBytes);
+    void FreeBlocks(Block* block);
+
+    Block* m_head = nullptr;
+    size_t m_blockSize;
+    size_t m_reserved = 0;
+    size_t m_bytesUsed = 0;
+    size_t m_peakBytes = 0;
+};
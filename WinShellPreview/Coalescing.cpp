@@ -0,0 +1,140 @@
+#include "pch.h"
+#include "CoalescingImpl.h"
+#include "BitmapUtils.h"
+#include "PathsImpl.h"
+#include "RequestCoalescer.h"
+#include <algorithm>
+#include <memory>
+
+namespace
+{
+    struct CoalescedResult
+    {
+        HRESULT hr = E_FAIL;
+        std::shared_ptr<const PixelImage> image;
+        UINT requestSize = 0;
+    };
+
+    RequestCoalescer<CoalescedResult>& Coalescer()
+    {
+        static RequestCoalescer<CoalescedResult> coalescer;
+        return coalescer;
+    }
+
+    const char* ModeTag(CoalesceMode mode)
+    {
+        switch (mode)
+        {
+        case CoalesceMode::Preview: return "P";
+        case CoalesceMode::Icon:    return "I";
+        default:                    return "T";
+        }
+    }
+
+    // Builds the caller's own bitmap from the leader's pixels, scaling it to the requested size
+    HRESULT BitmapFromShared(const CoalescedResult& result, UINT size, HBITMAP* phBitmap)
+    {
+        if (FAILED(result.hr))
+            return result.hr;
+        if (!result.image)
+            return E_FAIL;
+
+        const PixelImage& source = *result.image;
+        if (size >= result.requestSize)
+            return PixelImageToHBITMAP(source, phBitmap);
+
+        double scale = static_cast<double>(size) / result.requestSize;
+        UINT width = (std::max)(1u, static_cast<UINT>(source.width * scale + 0.5));
+        UINT height = (std::max)(1u, static_cast<UINT>(source.height * scale + 0.5));
+
+        PixelImage scaled;
+        if (!ResizePixelImage(source, width, height, &scaled))
+            return E_OUTOFMEMORY;
+        return PixelImageToHBITMAP(scaled, phBitmap);
+    }
+}
+
+std::string MakePathKey(LPCWSTR filePath)
+{
+    PathRef record = InternPath(filePath);
+    return record ? record->key : std::string();
+}
+
+std::string MakeFileIdentityKey(LPCWSTR filePath)
+{
+    PathRef record = InternPath(filePath);
+    if (!record)
+        return std::string();
+    std::string key = record->key;
+
+    // A rewritten file must not share a result with the previous version
+    WIN32_FILE_ATTRIBUTE_DATA data = {};
+    if (GetFileAttributesExW(NativePath(*record), GetFileExInfoStandard, &data))
+    {
+        char suffix[64];
+        sprintf_s(suffix, "|%08lx%08lx|%08lx%08lx",
+                  data.nFileSizeHigh, data.nFileSizeLow,
+                  data.ftLastWriteTime.dwHighDateTime, data.ftLastWriteTime.dwLowDateTime);
+        key += suffix;
+    }
+    return key;
+}
+
+HRESULT RunCoalesced(CoalesceMode mode, LPCWSTR filePath, UINT width, UINT height, HBITMAP* phBitmap,
+                     const std::function<HRESULT(HBITMAP*)>& extract)
+{
+    if (!filePath || !phBitmap)
+        return E_INVALIDARG;
+
+    *phBitmap = nullptr;
+
+    // Preview layout depends on both dimensions, so only identical sizes are shared
+    std::string group = MakeFileIdentityKey(filePath) + "|" + ModeTag(mode);
+    bool allowLarger = (mode != CoalesceMode::Preview);
+    if (!allowLarger)
+        group += "|" + std::to_string(height);
+
+    bool leader = false;
+    RequestCoalescer<CoalescedResult>::FlightPtr flight = Coalescer().Join(group, width, allowLarger, &leader);
+
+    if (!leader)
+    {
+        CoalescedResult shared = Coalescer().Wait(flight);
+        return BitmapFromShared(shared, width, phBitmap);
+    }
+
+    HRESULT hr = E_FAIL;
+    try
+    {
+        hr = extract(phBitmap);
+    }
+    catch (...)
+    {
+        // Followers must never wait forever on a leader that failed
+        Coalescer().Finish(flight, []() { CoalescedResult failed; failed.hr = E_UNEXPECTED; return failed; });
+        throw;
+    }
+
+    HBITMAP hResult = *phBitmap;
+    Coalescer().Finish(flight, [hr, hResult, width]()
+    {
+        CoalescedResult result;
+        result.hr = hr;
+        result.requestSize = width;
+        if (SUCCEEDED(hr) && hResult)
+        {
+            std::shared_ptr<PixelImage> image = std::make_shared<PixelImage>();
+            result.hr = HBITMAPToPixelImage(hResult, image.get());
+            if (SUCCEEDED(result.hr))
+                result.image = image;
+        }
+        return result;
+    });
+
+    return hr;
+}
+
+RequestCoalescerStats GetCoalescingStatsImpl()
+{
+    return Coalescer().GetStats();
+}
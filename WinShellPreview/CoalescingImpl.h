@@ -0,0 +1,27 @@
+#pragma once
+#include "framework.h"
+#include "RequestCoalescer.h"
+#include <functional>
+#include <string>
+
+// Request kinds that are coalesced separately
+enum class CoalesceMode
+{
+    Thumbnail,
+    Preview,
+    Icon
+};
+
+// Runs extract() once per concurrent (file identity, mode, size) and shares the result with
+// every other caller that arrives while it is running. Thumbnail and icon requests may also be
+// served by downscaling an in-flight request for a larger size of the same file.
+HRESULT RunCoalesced(CoalesceMode mode, LPCWSTR filePath, UINT width, UINT height, HBITMAP* phBitmap,
+                     const std::function<HRESULT(HBITMAP*)>& extract);
+
+// Key of the interned path (InternPath): normalized, ASCII-lowercased UTF-8; the prefix of MakeFileIdentityKey
+std::string MakePathKey(LPCWSTR filePath);
+
+// UTF-8 key identifying a file's current content: lowercased path, size and last write time
+std::string MakeFileIdentityKey(LPCWSTR filePath);
+
+RequestCoalescerStats GetCoalescingStatsImpl();
@@ -0,0 +1,166 @@
+#include "ColorQuantizer.h"
+#include <algorithm>
+
+namespace
+{
+    struct ColorBox
+    {
+        size_t first;       // Range in the occupied-bin list
+        size_t last;
+        uint64_t count;
+        int longestChannel;
+        int range;
+    };
+
+    // Bin with exact sums, the unit median cut works on
+    struct Bin
+    {
+        uint8_t key[3];     // Quantized r, g, b
+        uint32_t count;
+        uint64_t sum[3];
+    };
+
+    void MeasureBox(const std::vector<Bin>& bins, ColorBox* box)
+    {
+        int lo[3] = { 255, 255, 255 };
+        int hi[3] = { 0, 0, 0 };
+        box->count = 0;
+        for (size_t i = box->first; i < box->last; ++i)
+        {
+            box->count += bins[i].count;
+            for (int c = 0; c < 3; ++c)
+            {
+                lo[c] = std::min(lo[c], static_cast<int>(bins[i].key[c]));
+                hi[c] = std::max(hi[c], static_cast<int>(bins[i].key[c]));
+            }
+        }
+        box->longestChannel = 0;
+        box->range = hi[0] - lo[0];
+        for (int c = 1; c < 3; ++c)
+        {
+            if (hi[c] - lo[c] > box->range)
+            {
+                box->range = hi[c] - lo[c];
+                box->longestChannel = c;
+            }
+        }
+    }
+}
+
+ColorHistogram::ColorHistogram(uint32_t bitsPerChannel)
+    : m_bits(std::min(std::max(bitsPerChannel, 1u), 8u)), m_total(0)
+{
+    m_counts.assign(BinCount(), 0);
+    m_sums.assign(static_cast<size_t>(BinCount()) * 3, 0);
+}
+
+void ColorHistogram::Clear()
+{
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    std::fill(m_sums.begin(), m_sums.end(), 0);
+    m_total = 0;
+}
+
+std::vector<QuantizedColor> MedianCut(const ColorHistogram& histogram, uint32_t maxColors)
+{
+    const uint32_t bits = histogram.Bits();
+    const uint32_t mask = (1u << bits) - 1;
+
+    std::vector<Bin> bins;
+    for (uint32_t i = 0; i < histogram.BinCount(); ++i)
+    {
+        if (histogram.Count(i) == 0)
+            continue;
+        Bin bin;
+        bin.key[0] = static_cast<uint8_t>(i >> (bits * 2));
+        bin.key[1] = static_cast<uint8_t>((i >> bits) & mask);
+        bin.key[2] = static_cast<uint8_t>(i & mask);
+        bin.count = histogram.Count(i);
+        for (int c = 0; c < 3; ++c)
+            bin.sum[c] = histogram.Sum(i, c);
+        bins.push_back(bin);
+    }
+
+    std::vector<QuantizedColor> colors;
+    if (bins.empty() || maxColors == 0)
+        return colors;
+
+    std::vector<ColorBox> boxes;
+    ColorBox all = { 0, bins.size(), 0, 0, 0 };
+    MeasureBox(bins, &all);
+    boxes.push_back(all);
+
+    while (boxes.size() < maxColors)
+    {
+        // Split the box that covers the most pixels times color range
+        size_t target = boxes.size();
+        uint64_t bestScore = 0;
+        for (size_t i = 0; i < boxes.size(); ++i)
+        {
+            uint64_t score = boxes[i].count * static_cast<uint64_t>(boxes[i].range);
+            if (boxes[i].last - boxes[i].first > 1 && score > bestScore)
+            {
+                bestScore = score;
+                target = i;
+            }
+        }
+        if (target == boxes.size())
+            break;
+
+        ColorBox box = boxes[target];
+        int channel = box.longestChannel;
+        // Bin keys are unique, so sorting by (channel, key) is fully deterministic
+        std::sort(bins.begin() + box.first, bins.begin() + box.last, [channel](const Bin& a, const Bin& b)
+        {
+            if (a.key[channel] != b.key[channel])
+                return a.key[channel] < b.key[channel];
+            return std::lexicographical_compare(a.key, a.key + 3, b.key, b.key + 3);
+        });
+
+        // Weighted median, keeping at least one bin on each side
+        uint64_t running = 0;
+        size_t split = box.first + 1;
+        for (size_t i = box.first; i < box.last - 1; ++i)
+        {
+            running += bins[i].count;
+            split = i + 1;
+            if (running * 2 >= box.count)
+                break;
+        }
+
+        ColorBox lower = { box.first, split, 0, 0, 0 };
+        ColorBox upper = { split, box.last, 0, 0, 0 };
+        MeasureBox(bins, &lower);
+        MeasureBox(bins, &upper);
+        boxes[target] = lower;
+        boxes.push_back(upper);
+    }
+
+    for (const ColorBox& box : boxes)
+    {
+        uint64_t sum[3] = { 0, 0, 0 };
+        for (size_t i = box.first; i < box.last; ++i)
+        {
+            for (int c = 0; c < 3; ++c)
+                sum[c] += bins[i].sum[c];
+        }
+        QuantizedColor color;
+        color.r = static_cast<uint8_t>((sum[0] + box.count / 2) / box.count);
+        color.g = static_cast<uint8_t>((sum[1] + box.count / 2) / box.count);
+        color.b = static_cast<uint8_t>((sum[2] + box.count / 2) / box.count);
+        color.count = box.count;
+        colors.push_back(color);
+    }
+
+    std::sort(colors.begin(), colors.end(), [](const QuantizedColor& a, const QuantizedColor& b)
+    {
+        if (a.count != b.count)
+            return a.count > b.count;
+        if (a.r != b.r)
+            return a.r < b.r;
+        if (a.g != b.g)
+            return a.g < b.g;
+        return a.b < b.b;
+    });
+    return colors;
+}
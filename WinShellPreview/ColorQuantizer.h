@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Color histogram and median-cut palette selection, shared by the image signatures (dominant
+// colors) and the GIF encoder (256-color frames). No Windows dependencies.
+
+// Histogram over `bitsPerChannel` bits of r, g and b. Each bin keeps its pixel count and exact
+// color sums, so palette entries are true averages rather than bin centers.
+class ColorHistogram
+{
+public:
+    explicit ColorHistogram(uint32_t bitsPerChannel);
+
+    uint32_t Bits() const { return m_bits; }
+    uint32_t BinCount() const { return 1u << (m_bits * 3); }
+    uint64_t Total() const { return m_total; }
+
+    uint32_t BinOf(uint32_t r, uint32_t g, uint32_t b) const
+    {
+        uint32_t shift = 8 - m_bits;
+        return ((r >> shift) << (m_bits * 2)) | ((g >> shift) << m_bits) | (b >> shift);
+    }
+
+    void Add(uint32_t r, uint32_t g, uint32_t b)
+    {
+        Add(BinOf(r, g, b), 1, r, g, b);
+    }
+
+    // A run of `count` pixels that all fall into `bin`, with their summed channels
+    void Add(uint32_t bin, uint32_t count, uint64_t sumR, uint64_t sumG, uint64_t sumB)
+    {
+        m_counts[bin] += count;
+        m_sums[bin * 3 + 0] += sumR;
+        m_sums[bin * 3 + 1] += sumG;
+        m_sums[bin * 3 + 2] += sumB;
+        m_total += count;
+    }
+
+    void Clear();
+
+    uint32_t Count(uint32_t bin) const { return m_counts[bin]; }
+    uint64_t Sum(uint32_t bin, int channel) const { return m_sums[bin * 3 + channel]; }
+
+private:
+    uint32_t m_bits;
+    std::vector<uint32_t> m_counts;
+    std::vector<uint64_t> m_sums;
+    uint64_t m_total;
+};
+
+struct QuantizedColor
+{
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+    uint64_t count = 0;     // Pixels the color stands for
+};
+
+// Up to maxColors colors by recursive median cut, most common first. Deterministic.
+std::vector<QuantizedColor> MedianCut(const ColorHistogram& histogram, uint32_t maxColors);
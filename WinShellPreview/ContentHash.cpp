@@ -0,0 +1,169 @@
+#include "ContentHash.h"
+#include <cstring>
+
+namespace
+{
+    const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+    const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+    inline uint64_t Rotl(uint64_t x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    // Little-endian loads regardless of alignment
+    inline uint64_t Read64(const uint8_t* p)
+    {
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; --i)
+            v = (v << 8) | p[i];
+        return v;
+    }
+
+    inline uint32_t Read32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    inline uint64_t Round(uint64_t acc, uint64_t input)
+    {
+        acc += input * PRIME2;
+        acc = Rotl(acc, 31);
+        return acc * PRIME1;
+    }
+
+    inline uint64_t MergeRound(uint64_t acc, uint64_t value)
+    {
+        acc ^= Round(0, value);
+        return acc * PRIME1 + PRIME4;
+    }
+}
+
+Xxh64::Xxh64(uint64_t seed) : m_buffered(0), m_total(0), m_seed(seed)
+{
+    m_acc[0] = seed + PRIME1 + PRIME2;
+    m_acc[1] = seed + PRIME2;
+    m_acc[2] = seed;
+    m_acc[3] = seed - PRIME1;
+}
+
+void Xxh64::Update(const void* data, size_t size)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + size;
+    m_total += size;
+
+    if (m_buffered + size < sizeof(m_buffer))
+    {
+        memcpy(m_buffer + m_buffered, p, size);
+        m_buffered += size;
+        return;
+    }
+
+    if (m_buffered)
+    {
+        size_t fill = sizeof(m_buffer) - m_buffered;
+        memcpy(m_buffer + m_buffered, p, fill);
+        for (int lane = 0; lane < 4; ++lane)
+            m_acc[lane] = Round(m_acc[lane], Read64(m_buffer + lane * 8));
+        p += fill;
+        m_buffered = 0;
+    }
+
+    while (end - p >= 32)
+    {
+        m_acc[0] = Round(m_acc[0], Read64(p));
+        m_acc[1] = Round(m_acc[1], Read64(p + 8));
+        m_acc[2] = Round(m_acc[2], Read64(p + 16));
+        m_acc[3] = Round(m_acc[3], Read64(p + 24));
+        p += 32;
+    }
+
+    m_buffered = static_cast<size_t>(end - p);
+    memcpy(m_buffer, p, m_buffered);
+}
+
+uint64_t Xxh64::Digest() const
+{
+    uint64_t hash;
+    if (m_total >= 32)
+    {
+        hash = Rotl(m_acc[0], 1) + Rotl(m_acc[1], 7) + Rotl(m_acc[2], 12) + Rotl(m_acc[3], 18);
+        for (int lane = 0; lane < 4; ++lane)
+            hash = MergeRound(hash, m_acc[lane]);
+    }
+    else
+    {
+        hash = m_seed + PRIME5;
+    }
+    hash += m_total;
+
+    const uint8_t* p = m_buffer;
+    const uint8_t* end = m_buffer + m_buffered;
+    while (end - p >= 8)
+    {
+        hash ^= Round(0, Read64(p));
+        hash = Rotl(hash, 27) * PRIME1 + PRIME4;
+        p += 8;
+    }
+    if (end - p >= 4)
+    {
+        hash ^= static_cast<uint64_t>(Read32(p)) * PRIME1;
+        hash = Rotl(hash, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    while (p < end)
+    {
+        hash ^= (*p) * PRIME5;
+        hash = Rotl(hash, 11) * PRIME1;
+        ++p;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t HashXxh64(const void* data, size_t size, uint64_t seed)
+{
+    Xxh64 state(seed);
+    state.Update(data, size);
+    return state.Digest();
+}
+
+std::string HashToHex(uint64_t hash)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string text(16, '0');
+    for (int i = 15; i >= 0; --i, hash >>= 4)
+        text[i] = digits[hash & 0xF];
+    return text;
+}
+
+bool HexToHash(const std::string& text, uint64_t* hash)
+{
+    if (text.size() != 16)
+        return false;
+
+    uint64_t value = 0;
+    for (char c : text)
+    {
+        int digit;
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else
+            return false;
+        value = (value << 4) | static_cast<uint64_t>(digit);
+    }
+    *hash = value;
+    return true;
+}
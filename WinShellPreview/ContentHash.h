@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// XXH64 (xxHash, 64-bit variant), streaming. Fast non-cryptographic hash used to address
+// identical content. No Windows dependencies.
+class Xxh64
+{
+public:
+    explicit Xxh64(uint64_t seed = 0);
+
+    void Update(const void* data, size_t size);
+    uint64_t Digest() const;
+
+private:
+    uint64_t m_acc[4];
+    uint8_t m_buffer[32];
+    size_t m_buffered;
+    uint64_t m_total;
+    uint64_t m_seed;
+};
+
+uint64_t HashXxh64(const void* data, size_t size, uint64_t seed = 0);
+
+// 16 lowercase hex digits
+std::string HashToHex(uint64_t hash);
+bool HexToHash(const std::string& text, uint64_t* hash);
@@ -0,0 +1,385 @@
+#include "ContentStore.h"
+#include "ContentHash.h"
+#include "PngWriter.h"
+#include <atomic>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const char JOURNAL_MAGIC[] = "WSP-CAS 1";
+    const char JOURNAL_NAME[] = "refs.log";
+    const char OBJECT_DIRECTORY[] = "objects";
+    const char OBJECT_EXTENSION[] = ".png";
+
+    // Compact once the journal is this much longer than the live reference list
+    const uint64_t COMPACT_MIN_LINES = 1024;
+    const uint64_t COMPACT_RATIO = 2;
+
+    bool IsValidRef(const std::string& ref)
+    {
+        return !ref.empty() && ref.find('\n') == std::string::npos && ref.find('\r') == std::string::npos;
+    }
+
+    std::string AddLine(uint64_t hash, uint64_t bytes, const std::string& ref)
+    {
+        return "+ " + HashToHex(hash) + " " + std::to_string(bytes) + " " + ref;
+    }
+}
+
+ContentStore::ContentStore(const fs::path& root, int level)
+    : m_root(root), m_level(level), m_journalLines(0), m_encodesSkipped(0), m_pendingWrites(0), m_open(false)
+{
+}
+
+ContentStore::~ContentStore()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_journal.is_open())
+        m_journal.close();
+}
+
+uint64_t ContentStore::HashImage(const PixelImage& image)
+{
+    Xxh64 state;
+    uint32_t header[3] = { image.width, image.height, static_cast<uint32_t>(image.alpha) };
+    state.Update(header, sizeof(header));
+    // Rows only; stride padding is not content
+    for (uint32_t y = 0; y < image.height; ++y)
+        state.Update(image.Row(y), static_cast<size_t>(image.width) * 4);
+    return state.Digest();
+}
+
+fs::path ContentStore::ObjectPath(uint64_t hash) const
+{
+    std::string name = HashToHex(hash);
+    return m_root / OBJECT_DIRECTORY / name.substr(0, 2) / (name + OBJECT_EXTENSION);
+}
+
+bool ContentStore::Open()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_open)
+        return true;
+
+    std::error_code ec;
+    fs::create_directories(m_root / OBJECT_DIRECTORY, ec);
+    if (ec)
+        return false;
+
+    if (!Replay())
+        return false;
+
+    // Rewriting on open drops torn tail lines and starts the journal fresh
+    if (!Compact())
+        return false;
+
+    m_open = true;
+    return true;
+}
+
+bool ContentStore::Replay()
+{
+    m_refs.clear();
+    m_objects.clear();
+
+    std::ifstream in(m_root / JOURNAL_NAME, std::ios::binary);
+    if (!in)
+        return true;
+
+    std::string line;
+    if (!std::getline(in, line) || line != JOURNAL_MAGIC)
+        return true;    // Unknown or empty journal: start over, orphans are collected later
+
+    while (std::getline(in, line))
+    {
+        // A crash can leave a partial last line; getline cannot tell, so validate each field
+        if (line.size() > 2 && line[0] == '+' && line[1] == ' ')
+        {
+            std::istringstream fields(line.substr(2));
+            std::string hex;
+            uint64_t bytes = 0;
+            uint64_t hash = 0;
+            if (!(fields >> hex >> bytes) || !HexToHash(hex, &hash))
+                continue;
+            fields.ignore(1);
+            std::string ref;
+            std::getline(fields, ref);
+            if (!IsValidRef(ref))
+                continue;
+
+            std::error_code ec;
+            if (m_objects.count(hash) == 0 && !fs::is_regular_file(ObjectPath(hash), ec))
+                continue;
+
+            std::map<std::string, Ref>::iterator existing = m_refs.find(ref);
+            if (existing != m_refs.end())
+                DropRef(existing);
+            AddRef(ref, hash, bytes);
+        }
+        else if (line.size() > 2 && line[0] == '-' && line[1] == ' ')
+        {
+            std::map<std::string, Ref>::iterator existing = m_refs.find(line.substr(2));
+            if (existing != m_refs.end())
+                DropRef(existing);
+        }
+    }
+    return true;
+}
+
+bool ContentStore::Compact()
+{
+    if (m_journal.is_open())
+        m_journal.close();
+
+    fs::path journal = m_root / JOURNAL_NAME;
+    fs::path temp = journal;
+    temp += ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        out << JOURNAL_MAGIC << '\n';
+        for (const std::pair<const std::string, Ref>& ref : m_refs)
+            out << AddLine(ref.second.hash, m_objects[ref.second.hash].bytes, ref.first) << '\n';
+        out.flush();
+        if (!out)
+            return false;
+    }
+
+    std::error_code ec;
+    fs::rename(temp, journal, ec);
+    if (ec)
+        return false;
+
+    m_journalLines = m_refs.size();
+    m_journal.open(journal, std::ios::binary | std::ios::app);
+    return static_cast<bool>(m_journal);
+}
+
+bool ContentStore::AppendLine(const std::string& line)
+{
+    m_journal << line << '\n';
+    m_journal.flush();
+    if (!m_journal)
+        return false;
+
+    if (++m_journalLines > COMPACT_MIN_LINES && m_journalLines > m_refs.size() * COMPACT_RATIO)
+        return Compact();
+    return true;
+}
+
+void ContentStore::AddRef(const std::string& ref, uint64_t hash, uint64_t bytes)
+{
+    Object& object = m_objects[hash];
+    object.bytes = bytes;
+    object.refCount++;
+    m_refs[ref].hash = hash;
+}
+
+void ContentStore::DropRef(std::map<std::string, Ref>::iterator ref)
+{
+    std::unordered_map<uint64_t, Object>::iterator object = m_objects.find(ref->second.hash);
+    if (object != m_objects.end() && object->second.refCount > 0)
+        object->second.refCount--;
+    m_refs.erase(ref);
+}
+
+bool ContentStore::WriteObject(uint64_t hash, const PixelImage& image, uint64_t* pBytes)
+{
+    std::vector<uint8_t> encoded;
+    if (!EncodePng(image, &encoded, m_level))
+        return false;
+
+    fs::path path = ObjectPath(hash);
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+    if (ec)
+        return false;
+
+    // Written under a unique temporary name so a crash never leaves a truncated object at its address
+    static std::atomic<uint64_t> sequence{0};
+    fs::path temp = path;
+    temp += "." + std::to_string(sequence.fetch_add(1, std::memory_order_relaxed)) + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        out.write(reinterpret_cast<const char*>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+        out.flush();
+        if (!out)
+            return false;
+    }
+    fs::rename(temp, path, ec);
+    if (ec)
+        return false;
+
+    *pBytes = encoded.size();
+    return true;
+}
+
+bool ContentStore::Put(const std::string& ref, const PixelImage& image, uint64_t* pHash, bool* pReused)
+{
+    if (!IsValidRef(ref) || image.Empty())
+        return false;
+
+    uint64_t hash = HashImage(image);
+    if (pHash)
+        *pHash = hash;
+    if (pReused)
+        *pReused = true;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_open)
+            return false;
+
+        std::unordered_map<uint64_t, Object>::iterator object = m_objects.find(hash);
+        if (object != m_objects.end())
+        {
+            m_encodesSkipped++;
+            std::map<std::string, Ref>::iterator existing = m_refs.find(ref);
+            if (existing != m_refs.end())
+            {
+                if (existing->second.hash == hash)
+                    return true;
+                DropRef(existing);
+            }
+            AddRef(ref, hash, object->second.bytes);
+            return AppendLine(AddLine(hash, object->second.bytes, ref));
+        }
+
+        // Keeps CollectGarbage from taking the file for an orphan before it is indexed
+        m_pendingWrites++;
+    }
+
+    // Encoding runs outside the lock; two writers of the same new image both produce the same file
+    uint64_t bytes = 0;
+    bool written = WriteObject(hash, image, &bytes);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pendingWrites--;
+    if (!written)
+        return false;
+
+    if (pReused)
+        *pReused = false;
+    std::map<std::string, Ref>::iterator existing = m_refs.find(ref);
+    if (existing != m_refs.end())
+        DropRef(existing);
+    AddRef(ref, hash, bytes);
+    return AppendLine(AddLine(hash, bytes, ref));
+}
+
+bool ContentStore::Find(const std::string& ref, uint64_t* pHash) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::map<std::string, Ref>::const_iterator found = m_refs.find(ref);
+    if (found == m_refs.end())
+        return false;
+    if (pHash)
+        *pHash = found->second.hash;
+    return true;
+}
+
+bool ContentStore::Remove(const std::string& ref)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::map<std::string, Ref>::iterator found = m_refs.find(ref);
+    if (!m_open || found == m_refs.end())
+        return false;
+
+    DropRef(found);
+    return AppendLine("- " + ref);
+}
+
+size_t ContentStore::RemovePrefix(const std::string& prefix)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_open)
+        return 0;
+
+    // References are ordered, so a prefix is one contiguous range
+    size_t removed = 0;
+    std::map<std::string, Ref>::iterator ref = m_refs.lower_bound(prefix);
+    while (ref != m_refs.end() && ref->first.compare(0, prefix.size(), prefix) == 0)
+    {
+        std::string name = ref->first;
+        std::map<std::string, Ref>::iterator next = std::next(ref);
+        DropRef(ref);
+        ref = next;
+        ++removed;
+        if (!AppendLine("- " + name))
+            break;
+    }
+    return removed;
+}
+
+uint64_t ContentStore::CollectGarbage()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_open)
+        return 0;
+
+    uint64_t freed = 0;
+    std::error_code ec;
+    for (std::unordered_map<uint64_t, Object>::iterator object = m_objects.begin(); object != m_objects.end();)
+    {
+        if (object->second.refCount == 0)
+        {
+            fs::remove(ObjectPath(object->first), ec);
+            freed += object->second.bytes;
+            object = m_objects.erase(object);
+        }
+        else
+        {
+            ++object;
+        }
+    }
+
+    // Files the index does not know: objects written right before a crash, stale temporaries.
+    // Skipped while a Put is writing, since its file is not indexed yet.
+    if (m_pendingWrites > 0)
+        return freed;
+
+    fs::recursive_directory_iterator it(m_root / OBJECT_DIRECTORY, ec), end;
+    std::vector<fs::path> orphans;
+    for (; !ec && it != end; it.increment(ec))
+    {
+        if (!it->is_regular_file(ec))
+            continue;
+        uint64_t hash = 0;
+        fs::path file = it->path();
+        bool known = file.extension() == OBJECT_EXTENSION && HexToHash(file.stem().string(), &hash) &&
+                     m_objects.count(hash) != 0;
+        if (!known)
+            orphans.push_back(file);
+    }
+    for (const fs::path& orphan : orphans)
+    {
+        uint64_t size = fs::file_size(orphan, ec);
+        if (!ec && fs::remove(orphan, ec))
+            freed += size;
+    }
+    return freed;
+}
+
+ContentStoreStats ContentStore::Stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ContentStoreStats stats = {};
+    stats.refs = m_refs.size();
+    stats.objects = m_objects.size();
+    stats.encodesSkipped = m_encodesSkipped;
+    for (const std::pair<const uint64_t, Object>& object : m_objects)
+    {
+        stats.storedBytes += object.second.bytes;
+        stats.logicalBytes += object.second.bytes * object.second.refCount;
+        if (object.second.refCount == 0)
+            stats.garbageObjects++;
+    }
+    return stats;
+}
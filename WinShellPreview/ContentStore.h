@@ -0,0 +1,90 @@
+#pragma once
+#include "ImageOps.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct ContentStoreStats
+{
+    uint64_t refs;              // Live references (e.g. file + size)
+    uint64_t objects;           // Distinct encoded images on disk, including unreferenced ones
+    uint64_t storedBytes;       // Size of the object files
+    uint64_t logicalBytes;      // What one file per reference would take
+    uint64_t encodesSkipped;    // Puts whose pixels were already stored
+    uint64_t garbageObjects;    // Unreferenced objects waiting for CollectGarbage
+};
+
+// Content-addressed store of encoded images. Each distinct image is encoded once as
+// objects/<hh>/<hash>.png, where the hash is XXH64 over the pixels, and any number of
+// references (keys such as "path|size") point at it. Identical images from copied files or
+// shared type icons are stored and encoded only once.
+//
+// References are persisted in an append-only journal (refs.log) that is compacted when it
+// grows; reference counts are rebuilt from it on Open. Objects whose count drops to zero
+// stay on disk until CollectGarbage, so a re-added image still skips its encode.
+// Thread-safe. No Windows dependencies.
+class ContentStore
+{
+public:
+    explicit ContentStore(const std::filesystem::path& root, int level = 6);
+    ~ContentStore();
+
+    ContentStore(const ContentStore&) = delete;
+    ContentStore& operator=(const ContentStore&) = delete;
+
+    // Creates the directory if needed and replays the journal
+    bool Open();
+
+    // Points ref at the image's content, encoding it only when no identical image is stored.
+    // pHash receives the content hash, pReused whether the encode was skipped.
+    bool Put(const std::string& ref, const PixelImage& image, uint64_t* pHash, bool* pReused);
+
+    bool Find(const std::string& ref, uint64_t* pHash) const;
+    std::filesystem::path ObjectPath(uint64_t hash) const;
+
+    bool Remove(const std::string& ref);
+    // Removes every reference starting with prefix; returns how many
+    size_t RemovePrefix(const std::string& prefix);
+
+    // Deletes unreferenced objects and orphan files left by a crash. Returns bytes freed.
+    uint64_t CollectGarbage();
+
+    ContentStoreStats Stats() const;
+
+    // Hash of the pixels and format, the object's address
+    static uint64_t HashImage(const PixelImage& image);
+
+private:
+    struct Object
+    {
+        uint64_t bytes = 0;
+        uint32_t refCount = 0;
+    };
+
+    struct Ref
+    {
+        uint64_t hash = 0;
+    };
+
+    bool Replay();
+    bool Compact();
+    bool AppendLine(const std::string& line);
+    void AddRef(const std::string& ref, uint64_t hash, uint64_t bytes);
+    void DropRef(std::map<std::string, Ref>::iterator ref);
+    bool WriteObject(uint64_t hash, const PixelImage& image, uint64_t* pBytes);
+
+    std::filesystem::path m_root;
+    int m_level;
+    mutable std::mutex m_mutex;
+    std::map<std::string, Ref> m_refs;
+    std::unordered_map<uint64_t, Object> m_objects;
+    std::ofstream m_journal;
+    uint64_t m_journalLines;
+    uint64_t m_encodesSkipped;
+    uint32_t m_pendingWrites;
+    bool m_open;
+};
@@ -0,0 +1,772 @@
+#include "Deflate.h"
+#include <algorithm>
+#include <cstring>
+#include <queue>
+
+namespace
+{
+    const size_t MIN_MATCH = 3;
+    const size_t MAX_MATCH = 258;
+    const size_t HASH_BITS = 15;
+    const size_t HASH_SIZE = size_t(1) << HASH_BITS;
+    const size_t WINDOW_MASK = DeflateEncoder::WINDOW_SIZE - 1;
+    const size_t MAX_STORED = 65535;
+
+    const int LITLEN_CODES = 286;
+    const int DIST_CODES = 30;
+    const int CODELEN_CODES = 19;
+    const int END_OF_BLOCK = 256;
+    // The fixed code (RFC 1951 3.2.6) is defined over all 288 literal/length and 32 distance
+    // symbols; the two unused ones of each shift the canonical codes of the longer lengths
+    const int FIXED_LITLEN_CODES = 288;
+    const int FIXED_DIST_CODES = 32;
+
+    const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                       35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                       3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const uint16_t DIST_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                     257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                     8193, 12289, 16385, 24577 };
+    const uint8_t DIST_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                     7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    const uint8_t CODELEN_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    // Per-level search effort, zlib's configuration table: stop lazy evaluation after a match of
+    // maxLazy, search a quarter of the chain once a match of goodLength is in hand
+    struct LevelConfig
+    {
+        uint16_t goodLength;
+        uint16_t maxLazy;
+        uint16_t niceLength;
+        uint16_t maxChain;
+        bool lazy;
+    };
+    const LevelConfig LEVELS[10] = {
+        { 0, 0, 0, 0, false },
+        { 4, 4, 8, 4, false }, { 4, 5, 16, 8, false }, { 4, 6, 32, 32, false },
+        { 4, 4, 16, 16, true }, { 8, 16, 32, 32, true }, { 8, 16, 128, 128, true },
+        { 8, 32, 128, 256, true }, { 32, 128, 258, 1024, true }, { 32, 258, 258, 4096, true }
+    };
+
+    struct Tables
+    {
+        uint8_t lengthCode[MAX_MATCH + 1];
+        uint32_t crc[256];
+
+        Tables()
+        {
+            for (int code = 0; code < 29; ++code)
+            {
+                int count = 1 << LENGTH_EXTRA[code];
+                for (int k = 0; k < count && LENGTH_BASE[code] + k <= (int)MAX_MATCH; ++k)
+                    lengthCode[LENGTH_BASE[code] + k] = static_cast<uint8_t>(code);
+            }
+            // 258 has its own code even though 227 + 31 also reaches it
+            lengthCode[MAX_MATCH] = 28;
+
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                crc[n] = c;
+            }
+        }
+    };
+
+    const Tables& GetTables()
+    {
+        static const Tables tables;
+        return tables;
+    }
+
+    inline int DistCode(uint32_t dist)
+    {
+        return static_cast<int>(std::upper_bound(DIST_BASE, DIST_BASE + DIST_CODES, dist) - DIST_BASE) - 1;
+    }
+
+    inline uint32_t HashAt(const uint8_t* p)
+    {
+        uint32_t v = p[0] | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16);
+        return (v * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    // Huffman code lengths limited to maxBits; repeatedly flattens frequencies if the tree is too deep
+    void BuildCodeLengths(const uint32_t* freqIn, int count, int maxBits, uint8_t* lengths)
+    {
+        std::vector<uint32_t> freq(freqIn, freqIn + count);
+        struct Node
+        {
+            uint64_t weight;
+            int left;
+            int right;      // Symbol index for leaves (left == -1)
+        };
+
+        for (;;)
+        {
+            std::vector<Node> nodes;
+            typedef std::pair<uint64_t, int> Entry;     // (weight, node) - node index breaks ties
+            std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+
+            for (int s = 0; s < count; ++s)
+            {
+                lengths[s] = 0;
+                if (freq[s])
+                {
+                    heap.push(Entry(freq[s], static_cast<int>(nodes.size())));
+                    nodes.push_back(Node{ freq[s], -1, s });
+                }
+            }
+            if (nodes.empty())
+                return;
+            if (nodes.size() == 1)
+            {
+                lengths[nodes[0].right] = 1;
+                return;
+            }
+
+            while (heap.size() > 1)
+            {
+                Entry a = heap.top(); heap.pop();
+                Entry b = heap.top(); heap.pop();
+                heap.push(Entry(a.first + b.first, static_cast<int>(nodes.size())));
+                nodes.push_back(Node{ a.first + b.first, a.second, b.second });
+            }
+
+            int maxDepth = 0;
+            std::vector<std::pair<int, int>> stack(1, std::make_pair(heap.top().second, 0));
+            while (!stack.empty())
+            {
+                std::pair<int, int> item = stack.back();
+                stack.pop_back();
+                const Node& node = nodes[item.first];
+                if (node.left < 0)
+                {
+                    lengths[node.right] = static_cast<uint8_t>(item.second);
+                    maxDepth = (std::max)(maxDepth, item.second);
+                }
+                else
+                {
+                    stack.push_back(std::make_pair(node.left, item.second + 1));
+                    stack.push_back(std::make_pair(node.right, item.second + 1));
+                }
+            }
+
+            if (maxDepth <= maxBits)
+                return;
+
+            for (uint32_t& f : freq)
+            {
+                if (f)
+                    f = (f >> 1) | 1;
+            }
+        }
+    }
+
+    // Canonical codes, bit-reversed for LSB-first output
+    void AssignCodes(const uint8_t* lengths, int count, uint16_t* codes)
+    {
+        uint16_t lengthCount[16] = {};
+        for (int s = 0; s < count; ++s)
+            lengthCount[lengths[s]]++;
+        lengthCount[0] = 0;
+
+        uint16_t next[16] = {};
+        uint16_t code = 0;
+        for (int bits = 1; bits < 16; ++bits)
+        {
+            code = static_cast<uint16_t>((code + lengthCount[bits - 1]) << 1);
+            next[bits] = code;
+        }
+
+        for (int s = 0; s < count; ++s)
+        {
+            int len = lengths[s];
+            if (!len)
+            {
+                codes[s] = 0;
+                continue;
+            }
+            uint16_t c = next[len]++;
+            uint16_t reversed = 0;
+            for (int k = 0; k < len; ++k)
+            {
+                reversed = static_cast<uint16_t>((reversed << 1) | (c & 1));
+                c >>= 1;
+            }
+            codes[s] = reversed;
+        }
+    }
+
+    // Run-length encoded code lengths for the dynamic block header
+    struct CodeLengthSymbol
+    {
+        uint8_t symbol;
+        uint8_t extra;
+    };
+
+    void EncodeCodeLengths(const uint8_t* lengths, int count, std::vector<CodeLengthSymbol>* out)
+    {
+        for (int i = 0; i < count;)
+        {
+            uint8_t value = lengths[i];
+            int run = 1;
+            while (i + run < count && lengths[i + run] == value)
+                run++;
+
+            int remaining = run;
+            if (value == 0)
+            {
+                while (remaining >= 11)
+                {
+                    int n = (std::min)(remaining, 138);
+                    out->push_back(CodeLengthSymbol{ 18, static_cast<uint8_t>(n - 11) });
+                    remaining -= n;
+                }
+                if (remaining >= 3)
+                {
+                    out->push_back(CodeLengthSymbol{ 17, static_cast<uint8_t>(remaining - 3) });
+                    remaining = 0;
+                }
+            }
+            else
+            {
+                out->push_back(CodeLengthSymbol{ value, 0 });
+                remaining--;
+                while (remaining >= 3)
+                {
+                    int n = (std::min)(remaining, 6);
+                    out->push_back(CodeLengthSymbol{ 16, static_cast<uint8_t>(n - 3) });
+                    remaining -= n;
+                }
+            }
+            while (remaining-- > 0)
+                out->push_back(CodeLengthSymbol{ value, 0 });
+
+            i += run;
+        }
+    }
+
+    inline int CodeLengthExtraBits(int symbol)
+    {
+        return symbol == 16 ? 2 : symbol == 17 ? 3 : symbol == 18 ? 7 : 0;
+    }
+}
+
+uint32_t Adler32(uint32_t adler, const uint8_t* data, size_t size)
+{
+    const uint32_t MOD = 65521;
+    const size_t NMAX = 5552;   // Largest n such that the sums cannot overflow 32 bits
+    uint32_t a = adler & 0xffff;
+    uint32_t b = adler >> 16;
+    while (size)
+    {
+        size_t n = (std::min)(size, NMAX);
+        size -= n;
+        while (n--)
+        {
+            a += *data++;
+            b += a;
+        }
+        a %= MOD;
+        b %= MOD;
+    }
+    return (b << 16) | a;
+}
+
+uint32_t Adler32Combine(uint32_t adler1, uint32_t adler2, uint64_t size2)
+{
+    // B's running sum picks up A's sum once per byte of B: b = b1 + b2 + size2 * (a1 - 1)
+    const uint32_t MOD = 65521;
+    uint32_t rem = static_cast<uint32_t>(size2 % MOD);
+    uint32_t a1 = adler1 & 0xffff;
+    uint32_t a = (a1 + (adler2 & 0xffff) + MOD - 1) % MOD;
+    uint32_t b = static_cast<uint32_t>((static_cast<uint64_t>(rem) * a1 + (adler1 >> 16) + (adler2 >> 16) + MOD - rem) % MOD);
+    return (b << 16) | a;
+}
+
+uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+    const uint32_t* table = GetTables().crc;
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+void DeflateEncoder::BitWriter::Put(uint32_t value, int count)
+{
+    m_bits |= static_cast<uint64_t>(value) << m_count;
+    m_count += count;
+    while (m_count >= 8)
+    {
+        m_out->push_back(static_cast<uint8_t>(m_bits));
+        m_bits >>= 8;
+        m_count -= 8;
+    }
+}
+
+void DeflateEncoder::BitWriter::AlignToByte()
+{
+    if (m_count > 0)
+        Put(0, 8 - m_count);
+}
+
+DeflateEncoder::DeflateEncoder(int level)
+    : m_level(level < 0 ? 6 : (std::min)(level, 9)),
+      m_pendingStart(0), m_finished(false), m_totalIn(0)
+{
+    m_maxChain = LEVELS[m_level].maxChain;
+    m_niceLength = LEVELS[m_level].niceLength;
+    m_goodLength = LEVELS[m_level].goodLength;
+    m_maxLazy = LEVELS[m_level].maxLazy;
+    m_lazy = LEVELS[m_level].lazy;
+    if (m_level > 0)
+    {
+        m_head.assign(HASH_SIZE, 0);
+        m_prev.assign(WINDOW_SIZE, 0);
+    }
+    m_buffer.reserve(2 * WINDOW_SIZE + BLOCK_SIZE);
+}
+
+void DeflateEncoder::SetDictionary(const uint8_t* data, size_t size)
+{
+    if (size > WINDOW_SIZE)
+    {
+        data += size - WINDOW_SIZE;
+        size = WINDOW_SIZE;
+    }
+    m_buffer.insert(m_buffer.end(), data, data + size);
+    if (m_level > 0)
+    {
+        for (size_t pos = 0; pos + MIN_MATCH <= m_buffer.size(); ++pos)
+            InsertHash(pos);
+    }
+    m_pendingStart = m_buffer.size();
+}
+
+void DeflateEncoder::InsertHash(size_t pos)
+{
+    uint32_t h = HashAt(&m_buffer[pos]);
+    m_prev[pos & WINDOW_MASK] = m_head[h];
+    m_head[h] = static_cast<uint32_t>(pos + 1);
+}
+
+size_t DeflateEncoder::LongestMatch(size_t pos, size_t end, size_t prevLength, size_t* pDist)
+{
+    size_t maxLen = (std::min)(MAX_MATCH, end - pos);
+    if (maxLen < MIN_MATCH)
+        return 0;
+
+    const uint8_t* data = m_buffer.data();
+    const uint8_t* scan = data + pos;
+    size_t limit = pos > WINDOW_SIZE ? pos - WINDOW_SIZE : 0;
+    size_t best = MIN_MATCH - 1;
+    size_t chain = prevLength >= m_goodLength ? m_maxChain >> 2 : m_maxChain;
+
+    uint32_t candidate = m_prev[pos & WINDOW_MASK];
+    size_t previous = pos;
+    while (candidate && chain--)
+    {
+        size_t c = candidate - 1;
+        // Chains must move strictly backwards and stay inside the window
+        if (c < limit || c >= previous)
+            break;
+        previous = c;
+
+        const uint8_t* match = data + c;
+        if (match[best] == scan[best] && match[0] == scan[0] && match[1] == scan[1])
+        {
+            size_t len = 2;
+            while (len < maxLen && match[len] == scan[len])
+                len++;
+            if (len > best)
+            {
+                best = len;
+                *pDist = pos - c;
+                if (len >= maxLen || len >= m_niceLength)
+                    break;
+            }
+        }
+        candidate = m_prev[c & WINDOW_MASK];
+    }
+    return best >= MIN_MATCH ? best : 0;
+}
+
+void DeflateEncoder::FindSymbols(size_t start, size_t end)
+{
+    m_symbols.clear();
+
+    size_t pos = start;
+    size_t prevLen = 0;
+    size_t prevDist = 0;
+    bool prevValid = false;
+
+    while (pos < end)
+    {
+        size_t curLen = 0;
+        size_t curDist = 0;
+        if (pos + MIN_MATCH <= end)
+        {
+            InsertHash(pos);
+            // A long enough pending match is taken without looking for a better one here
+            if (!prevValid || prevLen < m_maxLazy)
+                curLen = LongestMatch(pos, end, prevValid ? prevLen : 0, &curDist);
+        }
+
+        if (prevValid)
+        {
+            // Lazy evaluation: keep the previous match unless this position found a longer one
+            if (prevLen >= MIN_MATCH && curLen <= prevLen)
+            {
+                m_symbols.push_back(Symbol{ static_cast<uint16_t>(prevLen), static_cast<uint16_t>(prevDist) });
+                size_t matchEnd = pos - 1 + prevLen;
+                for (size_t p = pos + 1; p < matchEnd; ++p)
+                {
+                    if (p + MIN_MATCH <= end)
+                        InsertHash(p);
+                }
+                pos = matchEnd;
+                prevValid = false;
+                continue;
+            }
+            m_symbols.push_back(Symbol{ m_buffer[pos - 1], 0 });
+        }
+
+        if (curLen >= MIN_MATCH && (!m_lazy || curLen >= m_niceLength))
+        {
+            m_symbols.push_back(Symbol{ static_cast<uint16_t>(curLen), static_cast<uint16_t>(curDist) });
+            for (size_t p = pos + 1; p < pos + curLen; ++p)
+            {
+                if (p + MIN_MATCH <= end)
+                    InsertHash(p);
+            }
+            pos += curLen;
+            prevValid = false;
+            continue;
+        }
+
+        prevLen = curLen;
+        prevDist = curDist;
+        prevValid = true;
+        pos++;
+    }
+
+    // A match found at the last position cannot extend past `end`, so this is always a literal
+    if (prevValid)
+        m_symbols.push_back(Symbol{ m_buffer[pos - 1], 0 });
+}
+
+void DeflateEncoder::EmitStored(size_t start, size_t end, bool final)
+{
+    do
+    {
+        size_t len = (std::min)(end - start, MAX_STORED);
+        bool last = (start + len == end);
+        m_writer.Put(final && last ? 1 : 0, 1);
+        m_writer.Put(0, 2);
+        m_writer.AlignToByte();
+        m_writer.Put(static_cast<uint32_t>(len), 16);
+        m_writer.Put(static_cast<uint32_t>(~len & 0xffff), 16);
+        for (size_t i = 0; i < len; ++i)
+            m_writer.Put(m_buffer[start + i], 8);
+        start += len;
+    } while (start < end);
+}
+
+void DeflateEncoder::EmitBlock(size_t start, size_t end, bool final)
+{
+    if (m_level == 0)
+    {
+        EmitStored(start, end, final);
+        return;
+    }
+
+    const Tables& tables = GetTables();
+
+    uint32_t litFreq[LITLEN_CODES] = {};
+    uint32_t distFreq[DIST_CODES] = {};
+    uint64_t extraBits = 0;
+    for (const Symbol& s : m_symbols)
+    {
+        if (s.dist == 0)
+        {
+            litFreq[s.litLen]++;
+        }
+        else
+        {
+            int lc = tables.lengthCode[s.litLen];
+            int dc = DistCode(s.dist);
+            litFreq[257 + lc]++;
+            distFreq[dc]++;
+            extraBits += LENGTH_EXTRA[lc] + DIST_EXTRA[dc];
+        }
+    }
+    litFreq[END_OF_BLOCK] = 1;
+
+    // Two used codes per tree keep both trees complete, which every inflater accepts
+    if (std::count_if(distFreq, distFreq + DIST_CODES, [](uint32_t f) { return f != 0; }) < 2)
+    {
+        if (!distFreq[0]) distFreq[0] = 1;
+        else distFreq[1] = 1;
+    }
+    if (std::count_if(litFreq, litFreq + LITLEN_CODES, [](uint32_t f) { return f != 0; }) < 2)
+        litFreq[0] = litFreq[0] ? litFreq[0] : 1;
+
+    uint8_t litLen[FIXED_LITLEN_CODES] = {};
+    uint8_t distLen[FIXED_DIST_CODES] = {};
+    BuildCodeLengths(litFreq, LITLEN_CODES, 15, litLen);
+    BuildCodeLengths(distFreq, DIST_CODES, 15, distLen);
+
+    int hlit = LITLEN_CODES;
+    while (hlit > 257 && litLen[hlit - 1] == 0)
+        hlit--;
+    int hdist = DIST_CODES;
+    while (hdist > 1 && distLen[hdist - 1] == 0)
+        hdist--;
+
+    uint8_t combined[LITLEN_CODES + DIST_CODES];
+    memcpy(combined, litLen, hlit);
+    memcpy(combined + hlit, distLen, hdist);
+    std::vector<CodeLengthSymbol> rle;
+    EncodeCodeLengths(combined, hlit + hdist, &rle);
+
+    uint32_t clFreq[CODELEN_CODES] = {};
+    for (const CodeLengthSymbol& s : rle)
+        clFreq[s.symbol]++;
+    uint8_t clLen[CODELEN_CODES];
+    BuildCodeLengths(clFreq, CODELEN_CODES, 7, clLen);
+
+    int hclen = CODELEN_CODES;
+    while (hclen > 4 && clLen[CODELEN_ORDER[hclen - 1]] == 0)
+        hclen--;
+
+    // Sizes in bits of the three encodings (excluding the 3-bit block header)
+    uint64_t dynamicBits = 5 + 5 + 4 + 3 * hclen + extraBits;
+    for (const CodeLengthSymbol& s : rle)
+        dynamicBits += clLen[s.symbol] + CodeLengthExtraBits(s.symbol);
+    uint64_t fixedBits = extraBits;
+    for (int s = 0; s < LITLEN_CODES; ++s)
+    {
+        dynamicBits += uint64_t(litFreq[s]) * litLen[s];
+        fixedBits += uint64_t(litFreq[s]) * (s < 144 ? 8 : s < 256 ? 9 : s < 280 ? 7 : 8);
+    }
+    for (int s = 0; s < DIST_CODES; ++s)
+    {
+        dynamicBits += uint64_t(distFreq[s]) * distLen[s];
+        fixedBits += uint64_t(distFreq[s]) * 5;
+    }
+    size_t storedChunks = (end - start + MAX_STORED - 1) / MAX_STORED;
+    uint64_t storedBits = uint64_t(end - start) * 8 + (std::max<size_t>)(storedChunks, 1) * (32 + 7 + 3);
+
+    if (storedBits <= dynamicBits && storedBits <= fixedBits)
+    {
+        EmitStored(start, end, final);
+        return;
+    }
+
+    uint16_t litCodes[FIXED_LITLEN_CODES];
+    uint16_t distCodes[FIXED_DIST_CODES];
+    int litCount = LITLEN_CODES;
+    int distCount = DIST_CODES;
+    if (fixedBits <= dynamicBits)
+    {
+        litCount = FIXED_LITLEN_CODES;
+        distCount = FIXED_DIST_CODES;
+        for (int s = 0; s < litCount; ++s)
+            litLen[s] = static_cast<uint8_t>(s < 144 ? 8 : s < 256 ? 9 : s < 280 ? 7 : 8);
+        for (int s = 0; s < distCount; ++s)
+            distLen[s] = 5;
+        m_writer.Put(final ? 1 : 0, 1);
+        m_writer.Put(1, 2);
+    }
+    else
+    {
+        uint16_t clCodes[CODELEN_CODES];
+        AssignCodes(clLen, CODELEN_CODES, clCodes);
+
+        m_writer.Put(final ? 1 : 0, 1);
+        m_writer.Put(2, 2);
+        m_writer.Put(hlit - 257, 5);
+        m_writer.Put(hdist - 1, 5);
+        m_writer.Put(hclen - 4, 4);
+        for (int i = 0; i < hclen; ++i)
+            m_writer.Put(clLen[CODELEN_ORDER[i]], 3);
+        for (const CodeLengthSymbol& s : rle)
+        {
+            m_writer.Put(clCodes[s.symbol], clLen[s.symbol]);
+            int extra = CodeLengthExtraBits(s.symbol);
+            if (extra)
+                m_writer.Put(s.extra, extra);
+        }
+    }
+    AssignCodes(litLen, litCount, litCodes);
+    AssignCodes(distLen, distCount, distCodes);
+
+    for (const Symbol& s : m_symbols)
+    {
+        if (s.dist == 0)
+        {
+            m_writer.Put(litCodes[s.litLen], litLen[s.litLen]);
+            continue;
+        }
+        int lc = tables.lengthCode[s.litLen];
+        m_writer.Put(litCodes[257 + lc], litLen[257 + lc]);
+        if (LENGTH_EXTRA[lc])
+            m_writer.Put(s.litLen - LENGTH_BASE[lc], LENGTH_EXTRA[lc]);
+        int dc = DistCode(s.dist);
+        m_writer.Put(distCodes[dc], distLen[dc]);
+        if (DIST_EXTRA[dc])
+            m_writer.Put(s.dist - DIST_BASE[dc], DIST_EXTRA[dc]);
+    }
+    m_writer.Put(litCodes[END_OF_BLOCK], litLen[END_OF_BLOCK]);
+}
+
+void DeflateEncoder::Slide()
+{
+    // Slide by whole windows so hash-chain slots (index & mask) stay valid
+    if (m_buffer.size() < 2 * WINDOW_SIZE)
+        return;
+
+    size_t shift = ((m_buffer.size() - WINDOW_SIZE) / WINDOW_SIZE) * WINDOW_SIZE;
+    m_buffer.erase(m_buffer.begin(), m_buffer.begin() + shift);
+    m_pendingStart -= shift;
+
+    uint32_t s = static_cast<uint32_t>(shift);
+    for (uint32_t& v : m_head)
+        v = v > s ? v - s : 0;
+    for (uint32_t& v : m_prev)
+        v = v > s ? v - s : 0;
+}
+
+void DeflateEncoder::CompressPending(bool final, std::vector<uint8_t>* out)
+{
+    m_writer.Attach(out);
+    size_t start = m_pendingStart;
+    size_t end = m_buffer.size();
+
+    if (m_level > 0)
+        FindSymbols(start, end);
+    EmitBlock(start, end, final);
+
+    m_pendingStart = end;
+    Slide();
+}
+
+void DeflateEncoder::Write(const uint8_t* data, size_t size, std::vector<uint8_t>* out)
+{
+    if (m_finished)
+        return;
+
+    m_totalIn += size;
+    while (size)
+    {
+        size_t room = BLOCK_SIZE - (m_buffer.size() - m_pendingStart);
+        size_t n = (std::min)(room, size);
+        m_buffer.insert(m_buffer.end(), data, data + n);
+        data += n;
+        size -= n;
+        if (m_buffer.size() - m_pendingStart >= BLOCK_SIZE)
+            CompressPending(false, out);
+    }
+}
+
+void DeflateEncoder::Flush(DeflateFlush mode, std::vector<uint8_t>* out)
+{
+    if (m_finished || mode == DeflateFlush::None)
+        return;
+
+    m_writer.Attach(out);
+    if (mode == DeflateFlush::Finish)
+    {
+        CompressPending(true, out);
+        m_writer.AlignToByte();
+        m_finished = true;
+        return;
+    }
+
+    if (m_pendingStart < m_buffer.size())
+        CompressPending(false, out);
+
+    // Empty stored block: everything so far becomes decodable and the stream is byte-aligned
+    m_writer.Put(0, 3);
+    m_writer.AlignToByte();
+    m_writer.Put(0x0000, 16);
+    m_writer.Put(0xffff, 16);
+}
+
+ZlibEncoder::ZlibEncoder(int level)
+    : m_deflate(level), m_adler(1), m_headerWritten(false), m_level(level), m_syncedIn(0), m_restart(false)
+{
+}
+
+void ZlibEncoder::WriteHeader(std::vector<uint8_t>* out)
+{
+    if (m_headerWritten)
+        return;
+
+    // CMF: deflate with 32KB window; FLG: level hint, check bits make the pair divisible by 31
+    uint8_t cmf = 0x78;
+    uint8_t levelHint = m_level <= 1 ? 0 : m_level <= 5 ? 1 : m_level == 6 ? 2 : 3;
+    uint8_t flg = static_cast<uint8_t>(levelHint << 6);
+    flg = static_cast<uint8_t>(flg + (31 - ((cmf * 256 + flg) % 31)) % 31);
+    out->push_back(cmf);
+    out->push_back(flg);
+    m_headerWritten = true;
+}
+
+void ZlibEncoder::Write(const uint8_t* data, size_t size, std::vector<uint8_t>* out)
+{
+    WriteHeader(out);
+    if (m_restart)
+    {
+        m_deflate = DeflateEncoder(m_level);
+        m_syncedIn = 0;
+        m_restart = false;
+    }
+    m_adler = Adler32(m_adler, data, size);
+    m_deflate.Write(data, size, out);
+}
+
+void ZlibEncoder::Flush(DeflateFlush mode, std::vector<uint8_t>* out)
+{
+    if (m_deflate.Finished())
+        return;
+
+    WriteHeader(out);
+    m_deflate.Flush(mode, out);
+    if (mode == DeflateFlush::Sync)
+        m_syncedIn = m_deflate.TotalIn();
+    if (mode == DeflateFlush::Finish)
+    {
+        out->push_back(static_cast<uint8_t>(m_adler >> 24));
+        out->push_back(static_cast<uint8_t>(m_adler >> 16));
+        out->push_back(static_cast<uint8_t>(m_adler >> 8));
+        out->push_back(static_cast<uint8_t>(m_adler));
+    }
+}
+
+void ZlibEncoder::WriteDeflated(const uint8_t* deflate, size_t deflateSize, uint32_t adler, uint64_t size, std::vector<uint8_t>* out)
+{
+    if (m_deflate.Finished())
+        return;
+
+    // Our own blocks must end on a byte boundary before foreign ones can follow
+    WriteHeader(out);
+    if (m_deflate.TotalIn() != m_syncedIn)
+        Flush(DeflateFlush::Sync, out);
+
+    out->insert(out->end(), deflate, deflate + deflateSize);
+    m_adler = Adler32Combine(m_adler, adler, size);
+    m_restart = true;
+}
+
+std::vector<uint8_t> ZlibCompress(const uint8_t* data, size_t size, int level)
+{
+    std::vector<uint8_t> out;
+    ZlibEncoder encoder(level);
+    encoder.Write(data, size, &out);
+    encoder.Flush(DeflateFlush::Finish, &out);
+    return out;
+}
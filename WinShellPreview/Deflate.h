@@ -0,0 +1,116 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Streaming DEFLATE (RFC 1951) encoder with zlib (RFC 1950) framing helpers and checksums.
+// LZ77 with hash chains and lazy matching; each block is emitted with whichever of dynamic
+// Huffman, fixed Huffman or stored coding is smallest. No Windows dependencies.
+
+uint32_t Adler32(uint32_t adler, const uint8_t* data, size_t size);
+uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size);
+
+// Checksum of A followed by B from Adler32 of each and B's length (for chunks checksummed in parallel)
+uint32_t Adler32Combine(uint32_t adler1, uint32_t adler2, uint64_t size2);
+
+enum class DeflateFlush
+{
+    None,       // Buffer input until a block is full
+    Sync,       // Emit pending input and byte-align with an empty stored block
+    Finish      // Emit pending input as the final block
+};
+
+class DeflateEncoder
+{
+public:
+    static const size_t WINDOW_SIZE = 32768;
+    static const size_t BLOCK_SIZE = 64 * 1024;    // Input bytes per emitted block
+
+    // level 0 stores only; 1..9 trade speed for ratio like zlib
+    explicit DeflateEncoder(int level = 6);
+
+    // Primes the match window with data that precedes the stream (e.g. the previous chunk
+    // when compressing independent chunks in parallel). Call before the first Write.
+    void SetDictionary(const uint8_t* data, size_t size);
+
+    // Appends compressed bytes to *out
+    void Write(const uint8_t* data, size_t size, std::vector<uint8_t>* out);
+    void Flush(DeflateFlush mode, std::vector<uint8_t>* out);
+
+    bool Finished() const { return m_finished; }
+    uint64_t TotalIn() const { return m_totalIn; }
+
+private:
+    struct Symbol
+    {
+        uint16_t litLen;    // Literal byte, or match length when dist != 0
+        uint16_t dist;
+    };
+
+    class BitWriter
+    {
+    public:
+        BitWriter() : m_bits(0), m_count(0), m_out(nullptr) {}
+        void Attach(std::vector<uint8_t>* out) { m_out = out; }
+        void Put(uint32_t value, int count);
+        void AlignToByte();
+        uint64_t PendingBits() const { return m_count; }
+
+    private:
+        uint64_t m_bits;
+        int m_count;
+        std::vector<uint8_t>* m_out;
+    };
+
+    void CompressPending(bool final, std::vector<uint8_t>* out);
+    void FindSymbols(size_t start, size_t end);
+    size_t LongestMatch(size_t pos, size_t end, size_t prevLength, size_t* pDist);
+    void InsertHash(size_t pos);
+    void Slide();
+    void EmitBlock(size_t start, size_t end, bool final);
+    void EmitStored(size_t start, size_t end, bool final);
+
+    int m_level;
+    size_t m_maxChain;
+    size_t m_niceLength;
+    size_t m_goodLength;
+    size_t m_maxLazy;
+    bool m_lazy;
+
+    std::vector<uint8_t> m_buffer;      // History (up to WINDOW_SIZE) followed by pending input
+    size_t m_pendingStart;              // Index in m_buffer where unprocessed input starts
+    std::vector<uint32_t> m_head;       // Hash -> buffer index + 1 (0 = empty)
+    std::vector<uint32_t> m_prev;       // Buffer index & window mask -> previous index + 1
+    std::vector<Symbol> m_symbols;
+    BitWriter m_writer;
+    bool m_finished;
+    uint64_t m_totalIn;
+};
+
+// zlib stream framing around DeflateEncoder: 2-byte header, deflate data, Adler-32 trailer
+class ZlibEncoder
+{
+public:
+    explicit ZlibEncoder(int level = 6);
+
+    void Write(const uint8_t* data, size_t size, std::vector<uint8_t>* out);
+    void Flush(DeflateFlush mode, std::vector<uint8_t>* out);
+
+    // Appends deflate blocks compressed by another encoder (non-final, ending byte-aligned with
+    // a sync flush) whose uncompressed bytes have checksum `adler` and length `size`. Later
+    // Write calls start a fresh match window, since the appended data is not in this one.
+    void WriteDeflated(const uint8_t* deflate, size_t deflateSize, uint32_t adler, uint64_t size, std::vector<uint8_t>* out);
+
+private:
+    void WriteHeader(std::vector<uint8_t>* out);
+
+    DeflateEncoder m_deflate;
+    uint32_t m_adler;
+    bool m_headerWritten;
+    int m_level;
+    uint64_t m_syncedIn;        // m_deflate input already flushed to a byte boundary
+    bool m_restart;             // Blocks were appended; m_deflate's window is stale
+};
+
+// One-shot helper
+std::vector<uint8_t> ZlibCompress(const uint8_t* data, size_t size, int level = 6);
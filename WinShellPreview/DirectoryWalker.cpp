@@ -0,0 +1,228 @@
+#include "DirectoryWalker.h"
+#include <algorithm>
+#include <fstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const char CHECKPOINT_MAGIC[] = "WSP-WALK 1";
+
+    bool EntryLess(const fs::directory_entry& a, const fs::directory_entry& b)
+    {
+        return a.path().filename().native() < b.path().filename().native();
+    }
+
+    // Components of `path` below `root`, or empty if path is not under root
+    std::vector<fs::path> RelativeComponents(const fs::path& root, const fs::path& path)
+    {
+        std::vector<fs::path> components;
+        fs::path::const_iterator r = root.begin();
+        fs::path::const_iterator p = path.begin();
+        for (; r != root.end(); ++r, ++p)
+        {
+            // A trailing separator shows up as an empty last component
+            if (r->empty())
+                break;
+            if (p == path.end() || *r != *p)
+                return std::vector<fs::path>();
+        }
+        for (; p != path.end(); ++p)
+        {
+            if (!p->empty())
+                components.push_back(*p);
+        }
+        return components;
+    }
+}
+
+DirectoryWalker::DirectoryWalker(const std::vector<fs::path>& roots)
+    : m_roots(roots), m_rootIndex(0), m_started(false), m_directoriesVisited(0)
+{
+}
+
+bool DirectoryWalker::PushDirectory(const fs::path& directory)
+{
+    Frame frame;
+    frame.index = 0;
+
+    std::error_code ec;
+    fs::directory_iterator it(directory, fs::directory_options::skip_permission_denied, ec);
+    if (ec)
+        return false;
+
+    for (fs::directory_iterator end; it != end; it.increment(ec))
+    {
+        if (ec)
+            break;
+        frame.entries.push_back(*it);
+    }
+
+    std::sort(frame.entries.begin(), frame.entries.end(), EntryLess);
+    m_stack.push_back(std::move(frame));
+    ++m_directoriesVisited;
+    return true;
+}
+
+bool DirectoryWalker::StartRoot(size_t rootIndex)
+{
+    m_stack.clear();
+    m_rootIndex = rootIndex;
+    m_started = true;
+    return rootIndex < m_roots.size() && PushDirectory(m_roots[rootIndex]);
+}
+
+bool DirectoryWalker::ResumeAfter(size_t rootIndex, const fs::path& lastCompleted)
+{
+    if (rootIndex >= m_roots.size())
+        return false;
+
+    std::vector<fs::path> components = RelativeComponents(m_roots[rootIndex], lastCompleted);
+    if (components.empty() || !StartRoot(rootIndex))
+    {
+        StartRoot(0);
+        return false;
+    }
+
+    // Descend along the checkpoint; at each level skip what sorts before it. Directories on the
+    // path are entered, and the file itself is skipped because it was already completed.
+    for (size_t level = 0; level < components.size(); ++level)
+    {
+        Frame& frame = m_stack.back();
+        const fs::path::string_type& name = components[level].native();
+        std::vector<fs::directory_entry>::iterator pos = std::lower_bound(
+            frame.entries.begin(), frame.entries.end(), name,
+            [](const fs::directory_entry& entry, const fs::path::string_type& value)
+            {
+                return entry.path().filename().native() < value;
+            });
+        frame.index = static_cast<size_t>(pos - frame.entries.begin());
+
+        bool found = pos != frame.entries.end() && pos->path().filename().native() == name;
+        if (!found)
+            break;
+
+        std::error_code ec;
+        bool isLast = (level + 1 == components.size());
+        if (isLast || !pos->is_directory(ec) || pos->is_symlink(ec))
+        {
+            frame.index++;
+            break;
+        }
+
+        frame.index++;
+        if (!PushDirectory(pos->path()))
+            break;
+    }
+    return true;
+}
+
+bool DirectoryWalker::Next(fs::path* file)
+{
+    if (!m_started)
+    {
+        if (m_roots.empty())
+            return false;
+        StartRoot(0);   // An unreadable root leaves the stack empty and moves on below
+    }
+
+    for (;;)
+    {
+        if (m_stack.empty())
+        {
+            if (m_rootIndex + 1 >= m_roots.size())
+                return false;
+            StartRoot(m_rootIndex + 1);
+            continue;
+        }
+
+        Frame& frame = m_stack.back();
+        if (frame.index >= frame.entries.size())
+        {
+            m_stack.pop_back();
+            continue;
+        }
+
+        const fs::directory_entry& entry = frame.entries[frame.index++];
+        std::error_code ec;
+        if (entry.is_symlink(ec))
+            continue;
+
+        if (entry.is_directory(ec))
+        {
+            fs::path directory = entry.path();
+            PushDirectory(directory);   // Unreadable directories are skipped
+            continue;
+        }
+
+        if (entry.is_regular_file(ec))
+        {
+            *file = entry.path();
+            return true;
+        }
+    }
+}
+
+uint64_t ComputeRootsSignature(const std::vector<fs::path>& roots)
+{
+    // FNV-1a over the native root strings
+    uint64_t hash = 1469598103934665603ULL;
+    for (const fs::path& root : roots)
+    {
+        for (fs::path::value_type c : root.native())
+        {
+            hash ^= static_cast<uint64_t>(c);
+            hash *= 1099511628211ULL;
+        }
+        hash ^= 0xff;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool SaveWalkCheckpoint(const fs::path& file, const WalkCheckpoint& checkpoint)
+{
+    fs::path temp = file;
+    temp += ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+
+        out << CHECKPOINT_MAGIC << '\n'
+            << checkpoint.rootsSignature << '\n'
+            << checkpoint.rootIndex << '\n'
+            << checkpoint.filesCompleted << '\n'
+            << checkpoint.lastCompleted.u8string() << '\n';
+        out.flush();
+        if (!out)
+            return false;
+    }
+
+    std::error_code ec;
+    fs::rename(temp, file, ec);
+    return !ec;
+}
+
+bool LoadWalkCheckpoint(const fs::path& file, WalkCheckpoint* checkpoint)
+{
+    std::ifstream in(file, std::ios::binary);
+    if (!in)
+        return false;
+
+    std::string magic;
+    std::string last;
+    WalkCheckpoint loaded;
+    if (!std::getline(in, magic) || magic != CHECKPOINT_MAGIC)
+        return false;
+    if (!(in >> loaded.rootsSignature >> loaded.rootIndex >> loaded.filesCompleted))
+        return false;
+    in.ignore(1);
+    if (!std::getline(in, last))
+        return false;
+
+    loaded.lastCompleted = fs::u8path(last);
+    *checkpoint = loaded;
+    return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Deterministic, resumable depth-first walk over a list of roots. Entries are visited in
+// sorted order so a walk can be resumed from the last completed file after a restart.
+// No Windows dependencies.
+class DirectoryWalker
+{
+public:
+    explicit DirectoryWalker(const std::vector<std::filesystem::path>& roots);
+
+    // Positions the walk right after `lastCompleted` within roots[rootIndex].
+    // Returns false (and starts from the beginning) if the position is not under that root.
+    bool ResumeAfter(size_t rootIndex, const std::filesystem::path& lastCompleted);
+
+    // Next regular file, or false when every root has been walked. Directories that cannot be
+    // read are skipped; symbolic links are not followed.
+    bool Next(std::filesystem::path* file);
+
+    size_t CurrentRoot() const { return m_rootIndex; }
+    uint64_t DirectoriesVisited() const { return m_directoriesVisited; }
+
+private:
+    struct Frame
+    {
+        std::vector<std::filesystem::directory_entry> entries;
+        size_t index;
+    };
+
+    bool PushDirectory(const std::filesystem::path& directory);
+    bool StartRoot(size_t rootIndex);
+
+    std::vector<std::filesystem::path> m_roots;
+    std::vector<Frame> m_stack;
+    size_t m_rootIndex;
+    bool m_started;
+    uint64_t m_directoriesVisited;
+};
+
+// Progress saved between runs: which root and the last file that was fully processed
+struct WalkCheckpoint
+{
+    uint64_t rootsSignature = 0;    // Detects a changed root list
+    size_t rootIndex = 0;
+    std::filesystem::path lastCompleted;
+    uint64_t filesCompleted = 0;
+};
+
+uint64_t ComputeRootsSignature(const std::vector<std::filesystem::path>& roots);
+
+// Text format, written to a temporary file and renamed so a crash never leaves a torn checkpoint
+bool SaveWalkCheckpoint(const std::filesystem::path& file, const WalkCheckpoint& checkpoint);
+bool LoadWalkCheckpoint(const std::filesystem::path& file, WalkCheckpoint* checkpoint);
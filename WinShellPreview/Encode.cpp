@@ -0,0 +1,83 @@
+#include "pch.h"
+#include "EncodeImpl.h"
+#include "BitmapUtils.h"
+#include "EncodePipeline.h"
+#include "PathTable.h"
+#include <string>
+
+namespace
+{
+    // Leaked on purpose: encoder threads must not be joined under the loader lock
+    EncodePipeline& Pipeline()
+    {
+        static EncodePipeline* pipeline = new EncodePipeline();
+        return *pipeline;
+    }
+
+    bool IsPngPath(LPCWSTR path)
+    {
+        size_t length = wcslen(path);
+        size_t dot = ExtensionOffset(std::u16string_view(reinterpret_cast<const char16_t*>(path), length));
+        return dot < length && _wcsicmp(path + dot, L".png") == 0;
+    }
+}
+
+HRESULT SaveBitmapToFileAsyncImpl(HBITMAP hBitmap, LPCWSTR outputPath, WSP_SAVE_CALLBACK callback, void* context)
+{
+    if (!hBitmap || !outputPath)
+        return E_INVALIDARG;
+
+    if (!IsPngPath(outputPath))
+    {
+        HRESULT hr = SaveBitmapToFileImpl(hBitmap, outputPath);
+        if (callback)
+            callback(hr, outputPath, context);
+        return S_OK;
+    }
+
+    // The only work left on the extraction thread is one pixel copy
+    EncodeJob job;
+    HRESULT hr = HBITMAPToPixelImage(hBitmap, &job.image);
+    if (FAILED(hr))
+        return hr;
+
+    std::wstring path(outputPath);
+    job.path = path;
+    if (callback)
+    {
+        job.completion = [callback, context, path](bool ok)
+        {
+            callback(ok ? S_OK : E_FAIL, path.c_str(), context);
+        };
+    }
+
+    Pipeline().Submit(std::move(job));
+    return S_OK;
+}
+
+HRESULT WaitForPendingSavesImpl(UINT timeoutMs)
+{
+    return Pipeline().WaitIdle(timeoutMs == INFINITE ? UINT32_MAX : timeoutMs)
+        ? S_OK : HRESULT_FROM_WIN32(WAIT_TIMEOUT);
+}
+
+HRESULT GetEncodePipelineStatsImpl(WSP_ENCODE_PIPELINE_STATS* pStats)
+{
+    if (!pStats)
+        return E_INVALIDARG;
+
+    EncodePipelineStats stats = Pipeline().Stats();
+    pStats->jobsSubmitted = stats.jobsSubmitted;
+    pStats->jobsCompleted = stats.jobsCompleted;
+    pStats->jobsFailed = stats.jobsFailed;
+    pStats->jobsInFlight = stats.jobsInFlight;
+    pStats->bytesWritten = stats.bytesWritten;
+    pStats->producerStallMs = stats.producerStallMs;
+    pStats->encodeThreads = stats.encodeThreads;
+    pStats->encodeBusyMs = stats.encodeBusyMs;
+    pStats->elapsedMs = stats.elapsedMs;
+    pStats->encodeUtilization = stats.encodeUtilization;
+    pStats->queueHighWater = stats.queueHighWater;
+    pStats->stolen = stats.stolen;
+    return S_OK;
+}
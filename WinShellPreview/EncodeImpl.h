@@ -0,0 +1,10 @@
+#pragma once
+#include "framework.h"
+#include "WinShellPreview.h"
+
+// Copies the bitmap's pixels on the calling thread and queues PNG compression on the shared
+// encode pool; other extensions are saved synchronously. The callback runs on an encoder thread.
+HRESULT SaveBitmapToFileAsyncImpl(HBITMAP hBitmap, LPCWSTR outputPath, WSP_SAVE_CALLBACK callback, void* context);
+
+HRESULT WaitForPendingSavesImpl(UINT timeoutMs);
+HRESULT GetEncodePipelineStatsImpl(WSP_ENCODE_PIPELINE_STATS* pStats);
@@ -0,0 +1,108 @@
+#include "EncodePipeline.h"
+#include "PngWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <system_error>
+
+namespace
+{
+    uint32_t ResolveThreads(uint32_t threads)
+    {
+        return threads ? threads : (std::max)(std::thread::hardware_concurrency(), 1u);
+    }
+}
+
+EncodePipeline::EncodePipeline(uint32_t threads, size_t queueCapacity)
+    : m_pool(ResolveThreads(threads), queueCapacity ? queueCapacity : ResolveThreads(threads) * 2),
+      m_submitted(0), m_completed(0), m_failed(0), m_pixels(0), m_bytes(0)
+{
+}
+
+EncodePipeline::~EncodePipeline()
+{
+    WaitIdle();
+}
+
+void EncodePipeline::Submit(EncodeJob job)
+{
+    m_submitted.fetch_add(1);
+
+    // Tasks must be copyable; the job (and its pixel buffer) moves only once
+    std::shared_ptr<EncodeJob> shared = std::make_shared<EncodeJob>(std::move(job));
+    m_pool.Submit([this, shared]() { Run(*shared); });
+}
+
+void EncodePipeline::Run(EncodeJob& job)
+{
+    // Large images are split into chunks on this same pool, so one big job doesn't leave the
+    // other encoder threads idle
+    bool ok;
+    if (static_cast<uint64_t>(job.image.width) * job.image.height >= PARALLEL_PNG_MIN_PIXELS)
+    {
+        ParallelPngOptions options;
+        options.pool = &m_pool;
+        ok = SavePixelImageAsPngParallel(job.image, job.path, job.level, options);
+    }
+    else
+    {
+        ok = SavePixelImageAsPng(job.image, job.path, job.level);
+    }
+    if (ok)
+    {
+        m_pixels.fetch_add(static_cast<uint64_t>(job.image.width) * job.image.height, std::memory_order_relaxed);
+        std::error_code ec;
+        uintmax_t size = std::filesystem::file_size(job.path, ec);
+        if (!ec)
+            m_bytes.fetch_add(static_cast<uint64_t>(size), std::memory_order_relaxed);
+    }
+    else
+    {
+        m_failed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Give the pixels back to the pool before the caller sees the result
+    job.image.Reset();
+    if (job.completion)
+        job.completion(ok);
+
+    std::lock_guard<std::mutex> lock(m_idleMutex);
+    m_completed.fetch_add(1);
+    m_idle.notify_all();
+}
+
+bool EncodePipeline::WaitIdle(uint32_t timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(m_idleMutex);
+    auto idle = [this]() { return m_completed.load() == m_submitted.load(); };
+    if (timeoutMs == UINT32_MAX)
+    {
+        m_idle.wait(lock, idle);
+        return true;
+    }
+    return m_idle.wait_for(lock, std::chrono::milliseconds(timeoutMs), idle);
+}
+
+EncodePipelineStats EncodePipeline::Stats() const
+{
+    WorkStealingPoolStats pool = m_pool.Stats();
+
+    EncodePipelineStats stats = {};
+    stats.jobsCompleted = m_completed.load();
+    stats.jobsSubmitted = (std::max)(m_submitted.load(), stats.jobsCompleted);
+    stats.jobsFailed = m_failed.load();
+    stats.jobsInFlight = stats.jobsSubmitted - stats.jobsCompleted;
+    stats.pixelsEncoded = m_pixels.load();
+    stats.bytesWritten = m_bytes.load();
+    stats.producerStallMs = pool.submitWaitMs;
+    stats.encodeThreads = pool.threads;
+    stats.encodeBusyMs = pool.busyMs;
+    stats.elapsedMs = pool.elapsedMs;
+    stats.queueHighWater = pool.queueHighWater;
+    stats.stolen = pool.stolen;
+
+    uint64_t capacity = static_cast<uint64_t>(pool.threads) * pool.elapsedMs;
+    if (capacity)
+        stats.encodeUtilization = static_cast<uint32_t>((std::min)(pool.busyMs * 65536 / capacity, uint64_t(65536)));
+    return stats;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "ImageOps.h"
+#include "WorkStealingPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+
+// One image to compress and write. Extraction threads hand over the pixels and return to
+// extracting; completion runs on the encoder thread after the file is written.
+struct EncodeJob
+{
+    PixelImage image;
+    std::filesystem::path path;     // PNG file to write
+    int level = 6;
+    std::function<void(bool ok)> completion;
+};
+
+struct EncodePipelineStats
+{
+    uint64_t jobsSubmitted;
+    uint64_t jobsCompleted;
+    uint64_t jobsFailed;
+    uint64_t jobsInFlight;          // Submitted, not yet completed
+    uint64_t pixelsEncoded;
+    uint64_t bytesWritten;
+
+    // Extraction stage: time producers spent blocked handing off work (backpressure)
+    uint64_t producerStallMs;
+
+    // Encode stage
+    uint32_t encodeThreads;
+    uint64_t encodeBusyMs;          // Summed over encoder threads
+    uint64_t elapsedMs;
+    uint32_t encodeUtilization;     // encodeBusyMs / (encodeThreads * elapsedMs), 65536 = all threads busy
+    uint64_t queueHighWater;
+    uint64_t stolen;
+};
+
+// Staged save path: producers Submit pixel buffers into the pool's bounded lock-free injection
+// queue and a work-stealing pool sized to the cores runs the PNG compression. Submit blocks
+// while `queueCapacity` jobs are waiting, so memory held by pending images stays bounded.
+// No Windows dependencies.
+class EncodePipeline
+{
+public:
+    // threads 0 = hardware threads; queueCapacity 0 = 2 per thread
+    explicit EncodePipeline(uint32_t threads = 0, size_t queueCapacity = 0);
+
+    // Waits for pending jobs
+    ~EncodePipeline();
+
+    void Submit(EncodeJob job);
+
+    // Waits until every submitted job completed; false on timeout (timeoutMs UINT32_MAX = forever)
+    bool WaitIdle(uint32_t timeoutMs = UINT32_MAX);
+
+    EncodePipelineStats Stats() const;
+
+private:
+    void Run(EncodeJob& job);
+
+    WorkStealingPool m_pool;
+    std::atomic<uint64_t> m_submitted;
+    std::atomic<uint64_t> m_completed;
+    std::atomic<uint64_t> m_failed;
+    std::atomic<uint64_t> m_pixels;
+    std::atomic<uint64_t> m_bytes;
+
+    mutable std::mutex m_idleMutex;
+    std::condition_variable m_idle;
+};
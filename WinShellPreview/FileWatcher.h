@@ -0,0 +1,180 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Directory change notifications behind one interface: ReadDirectoryChangesW on Windows
+// (FileWatcherWin.cpp), inotify on Linux (FileWatcherInotify.cpp). Paths are UTF-8 with the
+// platform's native separator. No Windows dependencies in this header.
+
+enum class FileChangeKind
+{
+    Added,      // Created or renamed into place
+    Modified,   // Content or timestamps changed
+    Removed,    // Deleted or renamed away
+    Overflow    // Notifications were lost; everything under the root may have changed
+};
+
+struct FileChange
+{
+    FileChangeKind kind;
+    std::string path;       // Empty for Overflow
+    int rootId;
+    bool isDirectory;       // Best effort: unknown (false) for removed entries on Windows
+};
+
+class FileWatcher
+{
+public:
+    // Called on the watcher thread with changes that have settled (see ChangeBatcher)
+    typedef std::function<void(const std::vector<FileChange>& changes)> Handler;
+
+    virtual ~FileWatcher() {}
+
+    // Returns a root id > 0, or 0 if the directory cannot be watched
+    virtual int AddRoot(const std::string& directory, bool recursive) = 0;
+    virtual void RemoveRoot(int rootId) = 0;
+
+    // Joins the watcher thread; the handler is not called after this returns
+    virtual void Stop() = 0;
+};
+
+// Starts a watcher thread for the current platform. settleMs delays delivery until a path has
+// been quiet that long, so a burst of writes to one file is reported once.
+std::unique_ptr<FileWatcher> CreateFileWatcher(FileWatcher::Handler handler, uint32_t settleMs);
+
+// Merges raw notifications per (root, path) and releases them once they have been quiet for
+// settleMs. Roots that share a directory each keep their own change.
+class ChangeBatcher
+{
+public:
+    static const size_t MAX_PENDING = 4096;
+
+    explicit ChangeBatcher(uint32_t settleMs) : m_settleMs(settleMs), m_lastEventMs(0) {}
+
+    void Add(const FileChange& change, uint64_t nowMs)
+    {
+        m_lastEventMs = nowMs;
+
+        if (change.kind == FileChangeKind::Overflow)
+        {
+            // Individual changes for this root are meaningless now
+            RemoveRoot(change.rootId);
+            m_pending.push_back(Entry{ change, false });
+            return;
+        }
+
+        std::string key = IndexKey(change);
+        std::unordered_map<std::string, size_t>::iterator found = m_index.find(key);
+        if (found == m_index.end())
+        {
+            m_index[key] = m_pending.size();
+            m_pending.push_back(Entry{ change, false });
+            return;
+        }
+
+        Entry& existing = m_pending[found->second];
+        existing.change.isDirectory = existing.change.isDirectory || change.isDirectory;
+
+        if (existing.dropped)
+        {
+            // Created, deleted and created again: still new to the consumer
+            existing.dropped = (change.kind == FileChangeKind::Removed);
+            existing.change.kind = existing.dropped ? FileChangeKind::Removed : FileChangeKind::Added;
+        }
+        else if (existing.change.kind == FileChangeKind::Added && change.kind == FileChangeKind::Removed)
+        {
+            // The consumer never saw this path, so there is nothing to report
+            existing.dropped = true;
+            existing.change.kind = FileChangeKind::Removed;
+        }
+        else
+        {
+            existing.change.kind = Merge(existing.change.kind, change.kind);
+        }
+    }
+
+    bool Empty() const { return m_pending.empty(); }
+
+    // True once the pending set has been quiet for settleMs (or has grown too large to hold)
+    bool Ready(uint64_t nowMs) const
+    {
+        if (m_pending.empty())
+            return false;
+        return m_pending.size() >= MAX_PENDING || nowMs - m_lastEventMs >= m_settleMs;
+    }
+
+    // Milliseconds until Ready(), or -1 when nothing is pending
+    int NextTimeoutMs(uint64_t nowMs) const
+    {
+        if (m_pending.empty())
+            return -1;
+        if (m_pending.size() >= MAX_PENDING)
+            return 0;
+        uint64_t elapsed = nowMs - m_lastEventMs;
+        return elapsed >= m_settleMs ? 0 : static_cast<int>(m_settleMs - elapsed);
+    }
+
+    // Returns the merged changes in arrival order; a path that was created and deleted within
+    // the window is dropped
+    std::vector<FileChange> Take()
+    {
+        std::vector<FileChange> out;
+        out.reserve(m_pending.size());
+        for (Entry& entry : m_pending)
+        {
+            if (!entry.dropped)
+                out.push_back(std::move(entry.change));
+        }
+        m_pending.clear();
+        m_index.clear();
+        return out;
+    }
+
+private:
+    struct Entry
+    {
+        FileChange change;
+        bool dropped;
+    };
+
+    static std::string IndexKey(const FileChange& change)
+    {
+        return std::to_string(change.rootId) + "|" + change.path;
+    }
+
+    static FileChangeKind Merge(FileChangeKind before, FileChangeKind after)
+    {
+        if (after == FileChangeKind::Removed)
+            return FileChangeKind::Removed;
+        if (before == FileChangeKind::Added && after == FileChangeKind::Modified)
+            return FileChangeKind::Added;
+        if (before == FileChangeKind::Removed && after == FileChangeKind::Added)
+            return FileChangeKind::Modified;
+        return after;
+    }
+
+    void RemoveRoot(int rootId)
+    {
+        std::vector<Entry> kept;
+        m_index.clear();
+        for (Entry& entry : m_pending)
+        {
+            bool overflow = (entry.change.kind == FileChangeKind::Overflow);
+            if (entry.change.rootId == rootId && !overflow)
+                continue;
+            if (!overflow)
+                m_index[IndexKey(entry.change)] = kept.size();
+            kept.push_back(std::move(entry));
+        }
+        m_pending.swap(kept);
+    }
+
+    uint32_t m_settleMs;
+    uint64_t m_lastEventMs;
+    std::vector<Entry> m_pending;
+    std::unordered_map<std::string, size_t> m_index;
+};
@@ -0,0 +1,277 @@
+// inotify backend for FileWatcher. Built on Linux only; Windows uses FileWatcherWin.cpp.
+#if defined(__linux__)
+
+#include "FileWatcher.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <dirent.h>
+#include <mutex>
+#include <poll.h>
+#include <set>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+    const uint32_t WATCH_MASK = IN_CREATE | IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_DELETE |
+                                IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+    uint64_t NowMs()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    bool IsDirectory(const std::string& path)
+    {
+        struct stat st;
+        return lstat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    }
+
+    class InotifyWatcher : public FileWatcher
+    {
+    public:
+        InotifyWatcher(Handler handler, uint32_t settleMs)
+            : m_handler(std::move(handler)), m_batcher(settleMs), m_nextRootId(1), m_stop(false)
+        {
+            m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (m_fd >= 0 && m_wake >= 0)
+                m_thread = std::thread(&InotifyWatcher::Run, this);
+        }
+
+        ~InotifyWatcher() override
+        {
+            Stop();
+            if (m_fd >= 0)
+                close(m_fd);
+            if (m_wake >= 0)
+                close(m_wake);
+        }
+
+        int AddRoot(const std::string& directory, bool recursive) override
+        {
+            if (!m_thread.joinable() || !IsDirectory(directory))
+                return 0;
+
+            std::string root(directory);
+            while (root.size() > 1 && root.back() == '/')
+                root.pop_back();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            int rootId = m_nextRootId++;
+            m_recursive[rootId] = recursive;
+            if (!AddWatch(root, rootId, recursive, nullptr))
+            {
+                m_recursive.erase(rootId);
+                return 0;
+            }
+            return rootId;
+        }
+
+        void RemoveRoot(int rootId) override
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (std::unordered_map<int, Watch>::iterator it = m_watches.begin(); it != m_watches.end();)
+            {
+                // The directory stays watched while another root still covers it
+                if (it->second.rootIds.erase(rootId) && it->second.rootIds.empty())
+                {
+                    inotify_rm_watch(m_fd, it->first);
+                    it = m_watches.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            m_recursive.erase(rootId);
+        }
+
+        void Stop() override
+        {
+            if (!m_thread.joinable())
+                return;
+            m_stop = true;
+            uint64_t one = 1;
+            ssize_t written = write(m_wake, &one, sizeof(one));
+            (void)written;
+            m_thread.join();
+        }
+
+    private:
+        struct Watch
+        {
+            std::string path;
+            std::set<int> rootIds;      // Nested or repeated roots get the same descriptor
+        };
+
+        // Caller must hold m_mutex. When `found` is given, entries discovered while walking a
+        // newly created directory are reported as Added (they were created before the watch existed).
+        bool AddWatch(const std::string& path, int rootId, bool recursive, std::vector<FileChange>* found)
+        {
+            int wd = inotify_add_watch(m_fd, path.c_str(), WATCH_MASK);
+            if (wd < 0)
+                return false;
+
+            Watch& watch = m_watches[wd];
+            watch.path = path;
+            watch.rootIds.insert(rootId);
+
+            if (!recursive && !found)
+                return true;
+
+            DIR* dir = opendir(path.c_str());
+            if (!dir)
+                return true;
+
+            while (struct dirent* entry = readdir(dir))
+            {
+                if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+                    continue;
+
+                std::string child = path + "/" + entry->d_name;
+                bool isDirectory = IsDirectory(child);
+                if (found)
+                    found->push_back(FileChange{ FileChangeKind::Added, child, rootId, isDirectory });
+                if (recursive && isDirectory)
+                    AddWatch(child, rootId, true, found);
+            }
+            closedir(dir);
+            return true;
+        }
+
+        void Translate(const struct inotify_event* event, std::vector<FileChange>* out)
+        {
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                // The kernel queue is shared, so every root lost events
+                for (const std::pair<const int, bool>& root : m_recursive)
+                    out->push_back(FileChange{ FileChangeKind::Overflow, std::string(), root.first, true });
+                return;
+            }
+
+            std::unordered_map<int, Watch>::iterator found = m_watches.find(event->wd);
+            if (found == m_watches.end())
+                return;
+
+            if (event->mask & IN_IGNORED)
+            {
+                m_watches.erase(found);
+                return;
+            }
+
+            // Copied: AddWatch below may rehash m_watches. Every root sharing the directory
+            // gets its own change.
+            const Watch watch = found->second;
+            for (int rootId : watch.rootIds)
+                TranslateForRoot(event, watch.path, rootId, out);
+        }
+
+        void TranslateForRoot(const struct inotify_event* event, const std::string& directory, int rootId,
+                              std::vector<FileChange>* out)
+        {
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+            {
+                out->push_back(FileChange{ FileChangeKind::Removed, directory, rootId, true });
+                return;
+            }
+
+            if (event->len == 0)
+                return;
+
+            std::string path = directory + "/" + event->name;
+            bool isDirectory = (event->mask & IN_ISDIR) != 0;
+
+            if (event->mask & (IN_CREATE | IN_MOVED_TO))
+            {
+                out->push_back(FileChange{ FileChangeKind::Added, path, rootId, isDirectory });
+                std::unordered_map<int, bool>::iterator root = m_recursive.find(rootId);
+                if (isDirectory && root != m_recursive.end() && root->second)
+                    AddWatch(path, rootId, true, out);
+            }
+            else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+            {
+                out->push_back(FileChange{ FileChangeKind::Removed, path, rootId, isDirectory });
+            }
+            else if (event->mask & (IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB))
+            {
+                out->push_back(FileChange{ FileChangeKind::Modified, path, rootId, isDirectory });
+            }
+        }
+
+        void ReadEvents()
+        {
+            alignas(struct inotify_event) char buffer[64 * 1024];
+            std::vector<FileChange> changes;
+
+            for (;;)
+            {
+                ssize_t length = read(m_fd, buffer, sizeof(buffer));
+                if (length <= 0)
+                    break;
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (char* p = buffer; p < buffer + length;)
+                {
+                    const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+                    Translate(event, &changes);
+                    p += sizeof(struct inotify_event) + event->len;
+                }
+            }
+
+            uint64_t now = NowMs();
+            for (const FileChange& change : changes)
+                m_batcher.Add(change, now);
+        }
+
+        void Run()
+        {
+            while (!m_stop)
+            {
+                struct pollfd fds[2];
+                fds[0].fd = m_fd;
+                fds[0].events = POLLIN;
+                fds[1].fd = m_wake;
+                fds[1].events = POLLIN;
+
+                int ready = poll(fds, 2, m_batcher.NextTimeoutMs(NowMs()));
+                if (ready < 0 && errno != EINTR)
+                    break;
+
+                if (ready > 0 && (fds[0].revents & POLLIN))
+                    ReadEvents();
+
+                if (m_batcher.Ready(NowMs()) && !m_stop)
+                {
+                    std::vector<FileChange> changes = m_batcher.Take();
+                    if (!changes.empty())
+                        m_handler(changes);
+                }
+            }
+        }
+
+        Handler m_handler;
+        ChangeBatcher m_batcher;        // Watcher thread only
+        std::mutex m_mutex;             // Guards m_watches, m_recursive, m_nextRootId
+        std::unordered_map<int, Watch> m_watches;
+        std::unordered_map<int, bool> m_recursive;
+        int m_nextRootId;
+        int m_fd;
+        int m_wake;
+        std::atomic<bool> m_stop;
+        std::thread m_thread;
+    };
+}
+
+std::unique_ptr<FileWatcher> CreateFileWatcher(FileWatcher::Handler handler, uint32_t settleMs)
+{
+    return std::unique_ptr<FileWatcher>(new InotifyWatcher(std::move(handler), settleMs));
+}
+
+#endif
@@ -0,0 +1,305 @@
+#include "pch.h"
+#include "FileWatcher.h"
+#include "TextUtils.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+// ReadDirectoryChangesW backend for FileWatcher. All reads are issued and completed on the
+// watcher thread through one I/O completion port, so no I/O is tied to a caller's thread.
+
+namespace
+{
+    const DWORD NOTIFY_FILTER = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+                                FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE |
+                                FILE_NOTIFY_CHANGE_CREATION;
+    const DWORD NOTIFY_BUFFER_SIZE = 64 * 1024;   // Network shares reject buffers larger than 64KB
+    const ULONG_PTR WAKE_KEY = 0;
+
+    class Win32Watcher : public FileWatcher
+    {
+    public:
+        Win32Watcher(Handler handler, uint32_t settleMs)
+            : m_handler(std::move(handler)), m_batcher(settleMs), m_nextRootId(1), m_stop(false)
+        {
+            m_port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+            if (m_port)
+                m_thread = std::thread(&Win32Watcher::Run, this);
+        }
+
+        ~Win32Watcher() override
+        {
+            Stop();
+            if (m_port)
+                CloseHandle(m_port);
+        }
+
+        int AddRoot(const std::string& directory, bool recursive) override
+        {
+            if (!m_thread.joinable())
+                return 0;
+
+            std::wstring path = Utf8ToWide(directory);
+            while (path.size() > 3 && (path.back() == L'\\' || path.back() == L'/'))
+                path.pop_back();
+
+            HANDLE hDir = CreateFileW(path.c_str(), FILE_LIST_DIRECTORY,
+                                      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                      OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+            if (hDir == INVALID_HANDLE_VALUE)
+                return 0;
+
+            Root* root = new (std::nothrow) Root();
+            if (!root)
+            {
+                CloseHandle(hDir);
+                return 0;
+            }
+            root->hDir = hDir;
+            root->path = path;
+            root->recursive = recursive;
+
+            if (!CreateIoCompletionPort(hDir, m_port, reinterpret_cast<ULONG_PTR>(root), 0))
+            {
+                CloseHandle(hDir);
+                delete root;
+                return 0;
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            root->id = m_nextRootId++;
+            m_added.push_back(root);
+            PostQueuedCompletionStatus(m_port, 0, WAKE_KEY, nullptr);
+            return root->id;
+        }
+
+        void RemoveRoot(int rootId) override
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_removed.push_back(rootId);
+            PostQueuedCompletionStatus(m_port, 0, WAKE_KEY, nullptr);
+        }
+
+        void Stop() override
+        {
+            if (!m_thread.joinable())
+                return;
+            m_stop = true;
+            PostQueuedCompletionStatus(m_port, 0, WAKE_KEY, nullptr);
+            m_thread.join();
+        }
+
+    private:
+        struct Root
+        {
+            int id = 0;
+            HANDLE hDir = INVALID_HANDLE_VALUE;
+            std::wstring path;
+            bool recursive = false;
+            bool closing = false;
+            bool pending = false;               // A read is outstanding
+            OVERLAPPED overlapped = {};
+            DWORD buffer[NOTIFY_BUFFER_SIZE / sizeof(DWORD)];   // DWORD-aligned as required
+        };
+
+        bool IssueRead(Root* root)
+        {
+            ZeroMemory(&root->overlapped, sizeof(root->overlapped));
+            root->pending = ReadDirectoryChangesW(root->hDir, root->buffer, sizeof(root->buffer), root->recursive,
+                                                  NOTIFY_FILTER, nullptr, &root->overlapped, nullptr) != FALSE;
+            return root->pending;
+        }
+
+        // Cancels the outstanding read; the root is freed when the cancellation completes
+        void BeginClose(Root* root)
+        {
+            root->closing = true;
+            if (root->pending)
+                CancelIoEx(root->hDir, &root->overlapped);
+            else
+                FreeRoot(root);
+        }
+
+        void FreeRoot(Root* root)
+        {
+            for (size_t i = 0; i < m_roots.size(); ++i)
+            {
+                if (m_roots[i] == root)
+                {
+                    m_roots.erase(m_roots.begin() + i);
+                    break;
+                }
+            }
+            CloseHandle(root->hDir);
+            delete root;
+        }
+
+        void ApplyCommands()
+        {
+            std::vector<Root*> added;
+            std::vector<int> removed;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                added.swap(m_added);
+                removed.swap(m_removed);
+            }
+
+            for (Root* root : added)
+            {
+                m_roots.push_back(root);
+                if (!IssueRead(root))
+                    BeginClose(root);
+            }
+
+            for (int rootId : removed)
+            {
+                for (Root* root : m_roots)
+                {
+                    if (root->id == rootId && !root->closing)
+                    {
+                        BeginClose(root);
+                        break;
+                    }
+                }
+            }
+        }
+
+        void Translate(Root* root, DWORD bytes, uint64_t now)
+        {
+            if (bytes == 0)
+            {
+                // The buffer overflowed and the system discarded the changes
+                m_batcher.Add(FileChange{ FileChangeKind::Overflow, std::string(), root->id, true }, now);
+                return;
+            }
+
+            const BYTE* p = reinterpret_cast<const BYTE*>(root->buffer);
+            for (;;)
+            {
+                const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(p);
+                std::wstring path = root->path;
+                if (path.back() != L'\\')
+                    path.push_back(L'\\');
+                path.append(info->FileName, info->FileNameLength / sizeof(WCHAR));
+
+                FileChange change;
+                change.path = WideToUtf8(path);
+                change.rootId = root->id;
+                change.isDirectory = false;
+
+                switch (info->Action)
+                {
+                case FILE_ACTION_ADDED:
+                case FILE_ACTION_RENAMED_NEW_NAME:
+                    change.kind = FileChangeKind::Added;
+                    break;
+                case FILE_ACTION_REMOVED:
+                case FILE_ACTION_RENAMED_OLD_NAME:
+                    change.kind = FileChangeKind::Removed;
+                    break;
+                default:
+                    change.kind = FileChangeKind::Modified;
+                    break;
+                }
+
+                if (change.kind != FileChangeKind::Removed)
+                {
+                    DWORD attributes = GetFileAttributesW(path.c_str());
+                    change.isDirectory = attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+                }
+
+                m_batcher.Add(change, now);
+
+                if (info->NextEntryOffset == 0)
+                    break;
+                p += info->NextEntryOffset;
+            }
+        }
+
+        void OnCompletion(Root* root, BOOL ok, DWORD bytes)
+        {
+            root->pending = false;
+
+            if (root->closing)
+            {
+                FreeRoot(root);
+                return;
+            }
+
+            uint64_t now = GetTickCount64();
+            if (!ok)
+            {
+                // ERROR_ACCESS_DENIED etc.: the watched directory itself is gone
+                m_batcher.Add(FileChange{ FileChangeKind::Removed, WideToUtf8(root->path), root->id, true }, now);
+                BeginClose(root);
+                return;
+            }
+
+            Translate(root, bytes, now);
+            if (!IssueRead(root))
+                BeginClose(root);
+        }
+
+        void Run()
+        {
+            for (;;)
+            {
+                if (m_stop)
+                {
+                    // Drain cancellations before the buffers they write into are freed
+                    for (Root* root : std::vector<Root*>(m_roots))
+                    {
+                        if (!root->closing)
+                            BeginClose(root);
+                    }
+                    if (m_roots.empty())
+                        break;
+                }
+
+                int timeout = m_stop ? -1 : m_batcher.NextTimeoutMs(GetTickCount64());
+                DWORD bytes = 0;
+                ULONG_PTR key = 0;
+                OVERLAPPED* overlapped = nullptr;
+                BOOL ok = GetQueuedCompletionStatus(m_port, &bytes, &key, &overlapped,
+                                                    timeout < 0 ? INFINITE : static_cast<DWORD>(timeout));
+
+                if (overlapped)
+                    OnCompletion(reinterpret_cast<Root*>(key), ok, bytes);
+                else if (ok && key == WAKE_KEY)
+                    ApplyCommands();
+
+                if (!m_stop && m_batcher.Ready(GetTickCount64()))
+                {
+                    std::vector<FileChange> changes = m_batcher.Take();
+                    if (!changes.empty())
+                        m_handler(changes);
+                }
+            }
+
+            // Roots added after Stop was requested never had a read issued
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (Root* root : m_added)
+            {
+                CloseHandle(root->hDir);
+                delete root;
+            }
+            m_added.clear();
+        }
+
+        Handler m_handler;
+        ChangeBatcher m_batcher;        // Watcher thread only
+        std::vector<Root*> m_roots;     // Watcher thread only
+        std::mutex m_mutex;             // Guards m_added, m_removed, m_nextRootId
+        std::vector<Root*> m_added;
+        std::vector<int> m_removed;
+        int m_nextRootId;
+        HANDLE m_port;
+        std::atomic<bool> m_stop;
+        std::thread m_thread;
+    };
+}
+
+std::unique_ptr<FileWatcher> CreateFileWatcher(FileWatcher::Handler handler, uint32_t settleMs)
+{
+    return std::unique_ptr<FileWatcher>(new Win32Watcher(std::move(handler), settleMs));
+}
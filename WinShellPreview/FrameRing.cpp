@@ -0,0 +1,188 @@
+#include "FrameRing.h"
+#include <algorithm>
+#include <chrono>
+#include <new>
+
+namespace
+{
+    const size_t SLOT_ALIGNMENT = 64;
+
+    uint64_t NowMs()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    size_t AlignUp(size_t value)
+    {
+        return (value + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT * SLOT_ALIGNMENT;
+    }
+
+    std::string FrameSignalName(const std::string& name) { return name + "-fr"; }
+    std::string SpaceSignalName(const std::string& name) { return name + "-sp"; }
+
+    FrameSlotHeader* Slot(uint8_t* base, const FrameRingHeader* header, uint64_t sequence)
+    {
+        size_t index = static_cast<size_t>(sequence % header->slotCount);
+        return reinterpret_cast<FrameSlotHeader*>(base + header->firstSlotOffset + index * header->slotStride);
+    }
+
+    uint8_t* SlotPixels(FrameSlotHeader* slot)
+    {
+        return reinterpret_cast<uint8_t*>(slot) + FRAME_SLOT_HEADER_BYTES;
+    }
+}
+
+static_assert(sizeof(FrameSlotHeader) <= FRAME_SLOT_HEADER_BYTES, "Slot header must fit before the pixels");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Cross-process atomics must be lock-free");
+
+std::unique_ptr<FrameRingWriter> FrameRingWriter::Create(const std::string& name, uint32_t slotCount, size_t slotBytes)
+{
+    if (slotCount == 0 || slotBytes == 0)
+        return nullptr;
+
+    size_t firstSlotOffset = AlignUp(sizeof(FrameRingHeader));
+    size_t slotStride = AlignUp(FRAME_SLOT_HEADER_BYTES + slotBytes);
+
+    std::unique_ptr<FrameRingWriter> writer(new FrameRingWriter());
+    writer->m_memory = SharedMemory::Create(name, firstSlotOffset + slotStride * slotCount);
+    writer->m_frameSignal = IpcSignal::Create(FrameSignalName(name));
+    writer->m_spaceSignal = IpcSignal::Create(SpaceSignalName(name));
+    if (!writer->m_memory || !writer->m_frameSignal || !writer->m_spaceSignal)
+        return nullptr;
+
+    FrameRingHeader* header = new (writer->m_memory->Data()) FrameRingHeader();
+    header->version = FRAME_RING_VERSION;
+    header->slotCount = slotCount;
+    header->slotBytes = slotBytes;
+    header->slotStride = slotStride;
+    header->firstSlotOffset = firstSlotOffset;
+    header->magic = FRAME_RING_MAGIC;
+    header->written.store(0, std::memory_order_relaxed);
+    header->released.store(0, std::memory_order_relaxed);
+    writer->m_header = header;
+    return writer;
+}
+
+uint8_t* FrameRingWriter::BeginFrame(uint32_t width, uint32_t height, uint32_t timeoutMs)
+{
+    m_open = false;
+    if (width == 0 || height == 0 || static_cast<uint64_t>(width) * height * 4 > m_header->slotBytes)
+    {
+        ++m_stats.oversized;
+        return nullptr;
+    }
+
+    uint64_t written = m_header->written.load(std::memory_order_relaxed);
+    if (written - m_header->released.load(std::memory_order_acquire) >= m_header->slotCount)
+    {
+        ++m_stats.backpressureWaits;
+        uint64_t deadline = NowMs() + timeoutMs;
+        while (written - m_header->released.load(std::memory_order_acquire) >= m_header->slotCount)
+        {
+            uint64_t now = NowMs();
+            if (now >= deadline)
+            {
+                ++m_stats.timeouts;
+                return nullptr;
+            }
+            m_spaceSignal->Wait(static_cast<uint32_t>(deadline - now));
+        }
+    }
+
+    m_width = width;
+    m_height = height;
+    m_open = true;
+    return SlotPixels(Slot(m_memory->Data(), m_header, written));
+}
+
+uint64_t FrameRingWriter::PublishFrame(AlphaMode alpha)
+{
+    uint64_t sequence = m_header->written.load(std::memory_order_relaxed);
+    if (!m_open)
+        return sequence;
+
+    FrameSlotHeader* slot = Slot(m_memory->Data(), m_header, sequence);
+    slot->sequence = sequence;
+    slot->width = m_width;
+    slot->height = m_height;
+    slot->stride = static_cast<uint64_t>(m_width) * 4;
+    slot->alpha = static_cast<uint32_t>(alpha);
+    m_header->written.store(sequence + 1, std::memory_order_release);
+    m_frameSignal->Notify();
+
+    m_open = false;
+    ++m_stats.published;
+    return sequence;
+}
+
+uint32_t FrameRingWriter::Pending() const
+{
+    return static_cast<uint32_t>(m_header->written.load(std::memory_order_relaxed) -
+                                 m_header->released.load(std::memory_order_acquire));
+}
+
+std::unique_ptr<FrameRingReader> FrameRingReader::Open(const std::string& name)
+{
+    std::unique_ptr<FrameRingReader> reader(new FrameRingReader());
+    reader->m_memory = SharedMemory::Open(name);
+    reader->m_frameSignal = IpcSignal::Open(FrameSignalName(name));
+    reader->m_spaceSignal = IpcSignal::Open(SpaceSignalName(name));
+    if (!reader->m_memory || !reader->m_frameSignal || !reader->m_spaceSignal ||
+        reader->m_memory->Size() < sizeof(FrameRingHeader))
+        return nullptr;
+
+    FrameRingHeader* header = reinterpret_cast<FrameRingHeader*>(reader->m_memory->Data());
+    if (header->magic != FRAME_RING_MAGIC || header->version != FRAME_RING_VERSION || header->slotCount == 0)
+        return nullptr;
+    if (header->slotStride < FRAME_SLOT_HEADER_BYTES + header->slotBytes ||
+        header->firstSlotOffset + header->slotStride * header->slotCount > reader->m_memory->Size())
+        return nullptr;
+
+    reader->m_header = header;
+    return reader;
+}
+
+bool FrameRingReader::AcquireFrame(uint32_t timeoutMs, RingFrame* frame)
+{
+    if (m_holding)
+        ReleaseFrame();
+
+    uint64_t released = m_header->released.load(std::memory_order_relaxed);
+    uint64_t deadline = NowMs() + timeoutMs;
+    while (m_header->written.load(std::memory_order_acquire) == released)
+    {
+        uint64_t now = NowMs();
+        if (now >= deadline)
+            return false;
+        m_frameSignal->Wait(static_cast<uint32_t>(deadline - now));
+    }
+
+    FrameSlotHeader* slot = Slot(m_memory->Data(), m_header, released);
+    if (slot->stride * slot->height > m_header->slotBytes)
+        return false;
+
+    frame->pixels = SlotPixels(slot);
+    frame->width = slot->width;
+    frame->height = slot->height;
+    frame->stride = static_cast<size_t>(slot->stride);
+    frame->alpha = static_cast<AlphaMode>(slot->alpha);
+    frame->sequence = slot->sequence;
+    m_holding = true;
+    return true;
+}
+
+void FrameRingReader::ReleaseFrame()
+{
+    if (!m_holding)
+        return;
+    m_header->released.fetch_add(1, std::memory_order_release);
+    m_spaceSignal->Notify();
+    m_holding = false;
+}
+
+uint32_t FrameRingReader::Pending() const
+{
+    return static_cast<uint32_t>(m_header->written.load(std::memory_order_acquire) -
+                                 m_header->released.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include "ImageOps.h"
+#include "IpcPlatform.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Single-producer / single-consumer ring of BGRA frames in named shared memory. The producer
+// renders straight into a slot and publishes it; the consumer (usually another process) maps
+// the same slot and reads the pixels in place. No Windows dependencies.
+//
+// - Slots are recycled in order: frame n lives in slot n % slotCount
+// - Backpressure: when every slot holds a frame the consumer has not released, the producer
+//   waits (up to its timeout) instead of overwriting
+// - The consumer's position is kept in shared memory, so a restarted consumer resumes where
+//   the previous one stopped
+
+// Shared layout, for consumers that map the ring without this code:
+//   FrameRingHeader at offset 0, then slotCount slots of slotStride bytes starting at
+//   firstSlotOffset. Each slot is a FrameSlotHeader followed by pixels at slot + 64.
+//   A frame n is readable once written > n, and its slot is reusable once released > n.
+struct FrameRingHeader
+{
+    uint32_t magic;                     // FRAME_RING_MAGIC
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t reserved;
+    uint64_t slotBytes;                 // Pixel capacity per slot
+    uint64_t slotStride;
+    uint64_t firstSlotOffset;
+    alignas(64) std::atomic<uint64_t> written;      // Frames published by the producer
+    alignas(64) std::atomic<uint64_t> released;     // Frames the consumer is done with
+};
+
+struct FrameSlotHeader
+{
+    uint64_t sequence;                  // Frame number, starting at 0
+    uint32_t width;
+    uint32_t height;
+    uint64_t stride;
+    uint32_t alpha;                     // AlphaMode
+    uint32_t reserved;
+};
+
+const uint32_t FRAME_RING_MAGIC = 0x474E5257;   // "WRNG"
+const uint32_t FRAME_RING_VERSION = 1;
+const size_t FRAME_SLOT_HEADER_BYTES = 64;
+
+struct RingFrame
+{
+    const uint8_t* pixels = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t stride = 0;
+    AlphaMode alpha = AlphaMode::Ignore;
+    uint64_t sequence = 0;
+};
+
+struct FrameRingStats
+{
+    uint64_t published;
+    uint64_t backpressureWaits;         // BeginFrame calls that found the ring full
+    uint64_t timeouts;                  // ...and gave up
+    uint64_t oversized;                 // Frames larger than a slot
+};
+
+class FrameRingWriter
+{
+public:
+    static std::unique_ptr<FrameRingWriter> Create(const std::string& name, uint32_t slotCount, size_t slotBytes);
+
+    // Returns the next slot's pixel rows (width * 4 bytes each), or nullptr if the frame does
+    // not fit a slot or the consumer kept every slot for timeoutMs
+    uint8_t* BeginFrame(uint32_t width, uint32_t height, uint32_t timeoutMs);
+    // Makes the frame begun last visible to the consumer; returns its sequence number
+    uint64_t PublishFrame(AlphaMode alpha);
+
+    // Frames published but not yet released by the consumer
+    uint32_t Pending() const;
+    uint32_t SlotCount() const { return m_header->slotCount; }
+    size_t SlotBytes() const { return static_cast<size_t>(m_header->slotBytes); }
+    FrameRingStats Stats() const { return m_stats; }
+
+private:
+    FrameRingWriter() : m_header(nullptr), m_width(0), m_height(0), m_open(false), m_stats() {}
+
+    std::unique_ptr<SharedMemory> m_memory;
+    std::unique_ptr<IpcSignal> m_frameSignal;
+    std::unique_ptr<IpcSignal> m_spaceSignal;
+    FrameRingHeader* m_header;
+    uint32_t m_width;
+    uint32_t m_height;
+    bool m_open;
+    FrameRingStats m_stats;
+};
+
+class FrameRingReader
+{
+public:
+    static std::unique_ptr<FrameRingReader> Open(const std::string& name);
+
+    // Waits up to timeoutMs for the next frame. The pixels stay valid until ReleaseFrame.
+    bool AcquireFrame(uint32_t timeoutMs, RingFrame* frame);
+    // Hands the acquired frame's slot back to the producer
+    void ReleaseFrame();
+
+    uint32_t Pending() const;
+
+private:
+    FrameRingReader() : m_header(nullptr), m_holding(false) {}
+
+    std::unique_ptr<SharedMemory> m_memory;
+    std::unique_ptr<IpcSignal> m_frameSignal;
+    std::unique_ptr<IpcSignal> m_spaceSignal;
+    FrameRingHeader* m_header;
+    bool m_holding;
+};
@@ -0,0 +1,137 @@
+#include "FrameStrip.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const uint32_t MAX_FRAMES = 256;
+
+    void FillBlack(PixelImage* image)
+    {
+        for (uint32_t y = 0; y < image->height; ++y)
+        {
+            uint8_t* row = image->Row(y);
+            for (uint32_t x = 0; x < image->width; ++x)
+            {
+                row[x * 4 + 0] = 0;
+                row[x * 4 + 1] = 0;
+                row[x * 4 + 2] = 0;
+                row[x * 4 + 3] = 255;
+            }
+        }
+    }
+
+    // Scales frame to fit the cell (aspect ratio kept) and centers it on black
+    bool FitToCell(const PixelImage& frame, uint32_t cellWidth, uint32_t cellHeight, PixelImage* cell)
+    {
+        if (!cell->Allocate(cellWidth, cellHeight))
+            return false;
+        cell->alpha = AlphaMode::Ignore;
+        FillBlack(cell);
+
+        uint64_t scaledWidth = cellWidth;
+        uint64_t scaledHeight = static_cast<uint64_t>(frame.height) * cellWidth / frame.width;
+        if (scaledHeight > cellHeight)
+        {
+            scaledHeight = cellHeight;
+            scaledWidth = static_cast<uint64_t>(frame.width) * cellHeight / frame.height;
+        }
+        scaledWidth = std::max<uint64_t>(scaledWidth, 1);
+        scaledHeight = std::max<uint64_t>(scaledHeight, 1);
+
+        PixelImage scaled;
+        if (!ResizePixelImage(frame, static_cast<uint32_t>(scaledWidth), static_cast<uint32_t>(scaledHeight), &scaled))
+            return false;
+
+        uint32_t left = (cellWidth - scaled.width) / 2;
+        uint32_t top = (cellHeight - scaled.height) / 2;
+        for (uint32_t y = 0; y < scaled.height; ++y)
+        {
+            uint8_t* out = cell->Row(top + y) + static_cast<size_t>(left) * 4;
+            memcpy(out, scaled.Row(y), static_cast<size_t>(scaled.width) * 4);
+            // Video frames carry no alpha; make the cell opaque whatever the decoder left there
+            for (uint32_t x = 0; x < scaled.width; ++x)
+                out[x * 4 + 3] = 255;
+        }
+        return true;
+    }
+}
+
+std::vector<uint64_t> ComputeStripTimestamps(uint64_t durationMs, uint32_t frameCount)
+{
+    std::vector<uint64_t> timestamps;
+    for (uint32_t i = 0; i < frameCount; ++i)
+        timestamps.push_back((durationMs * (2 * i + 1)) / (2 * static_cast<uint64_t>(frameCount)));
+    return timestamps;
+}
+
+bool BuildFrameStrip(FrameSource& source, const FrameStripOptions& options, FrameStripResult* result)
+{
+    if (!result || options.frameWidth == 0 || options.frameHeight == 0)
+        return false;
+
+    *result = FrameStripResult();
+    if (!source.Open(&result->media) || result->media.width == 0 || result->media.height == 0)
+    {
+        source.Close();
+        return false;
+    }
+
+    if (!options.timestampsMs.empty())
+    {
+        result->timestampsMs = options.timestampsMs;
+        std::sort(result->timestampsMs.begin(), result->timestampsMs.end());
+    }
+    else
+    {
+        result->timestampsMs = ComputeStripTimestamps(result->media.durationMs, std::max<uint32_t>(options.frameCount, 1));
+    }
+    if (result->timestampsMs.size() > MAX_FRAMES)
+        result->timestampsMs.resize(MAX_FRAMES);
+
+    uint32_t decoded = 0;
+    PixelImage frame;
+    for (uint64_t timestamp : result->timestampsMs)
+    {
+        PixelImage cell;
+        bool ok = source.ReadFrame(timestamp, &frame) && !frame.Empty() &&
+                  FitToCell(frame, options.frameWidth, options.frameHeight, &cell);
+        if (ok)
+        {
+            ++decoded;
+        }
+        else if (cell.Allocate(options.frameWidth, options.frameHeight))
+        {
+            FillBlack(&cell);
+        }
+        result->frames.push_back(std::move(cell));
+    }
+    source.Close();
+
+    if (decoded == 0)
+        return false;
+
+    uint32_t count = static_cast<uint32_t>(result->frames.size());
+    uint32_t columns = options.columns == 0 ? count : std::min(options.columns, count);
+    uint32_t rows = (count + columns - 1) / columns;
+    uint64_t stripWidth = static_cast<uint64_t>(columns) * options.frameWidth + static_cast<uint64_t>(columns - 1) * options.spacing;
+    uint64_t stripHeight = static_cast<uint64_t>(rows) * options.frameHeight + static_cast<uint64_t>(rows - 1) * options.spacing;
+    if (stripWidth > UINT32_MAX || stripHeight > UINT32_MAX ||
+        !result->strip.Allocate(static_cast<uint32_t>(stripWidth), static_cast<uint32_t>(stripHeight)))
+        return false;
+
+    result->strip.alpha = AlphaMode::Ignore;
+    FillBlack(&result->strip);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const PixelImage& cell = result->frames[i];
+        if (cell.Empty())
+            continue;
+        uint32_t left = (i % columns) * (options.frameWidth + options.spacing);
+        uint32_t top = (i / columns) * (options.frameHeight + options.spacing);
+        for (uint32_t y = 0; y < cell.height; ++y)
+            memcpy(result->strip.Row(top + y) + static_cast<size_t>(left) * 4, cell.Row(y), static_cast<size_t>(cell.width) * 4);
+    }
+    return true;
+}
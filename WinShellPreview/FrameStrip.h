@@ -0,0 +1,52 @@
+#pragma once
+#include "ImageOps.h"
+#include <cstdint>
+#include <vector>
+
+// Frame strips for video files: K frames at even intervals, scaled into uniform cells and
+// composited into one image. Decoding is behind FrameSource so the strip logic runs against
+// Media Foundation on Windows or a synthetic source elsewhere. No Windows dependencies.
+
+struct MediaInfo
+{
+    uint64_t durationMs = 0;
+    uint32_t width = 0;         // Decoded frame size
+    uint32_t height = 0;
+};
+
+// Opened once per strip; frames are requested in increasing timestamp order
+class FrameSource
+{
+public:
+    virtual ~FrameSource() {}
+
+    virtual bool Open(MediaInfo* info) = 0;
+    // The frame shown at timestampMs (the first frame at or after it is close enough)
+    virtual bool ReadFrame(uint64_t timestampMs, PixelImage* frame) = 0;
+    virtual void Close() = 0;
+};
+
+struct FrameStripOptions
+{
+    uint32_t frameCount = 8;
+    uint32_t frameWidth = 160;      // Cell size; frames keep their aspect ratio inside it
+    uint32_t frameHeight = 90;
+    uint32_t columns = 0;           // 0 = all frames in one row
+    uint32_t spacing = 2;           // Pixels between cells
+    std::vector<uint64_t> timestampsMs;     // Explicit timestamps; empty = even intervals
+};
+
+struct FrameStripResult
+{
+    MediaInfo media;
+    std::vector<uint64_t> timestampsMs;     // Timestamps actually extracted
+    std::vector<PixelImage> frames;         // Each frame scaled to the cell, letterboxed
+    PixelImage strip;
+};
+
+// Centers of frameCount equal slices of the duration: (i + 0.5) * duration / frameCount
+std::vector<uint64_t> ComputeStripTimestamps(uint64_t durationMs, uint32_t frameCount);
+
+// Opens source, reads the frames and composites them over black. Frames that fail to decode
+// stay black. Returns false if the source cannot be opened or no frame could be read.
+bool BuildFrameStrip(FrameSource& source, const FrameStripOptions& options, FrameStripResult* result);
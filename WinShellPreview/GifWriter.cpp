@@ -0,0 +1,339 @@
+#include "GifWriter.h"
+#include <algorithm>
+#include <climits>
+#include <fstream>
+
+namespace
+{
+    const uint32_t PALETTE_BITS = 5;    // Histogram resolution per channel for frame palettes
+    const uint32_t MAX_COLORS = 256;
+    const uint32_t MAX_CODE_SIZE = 12;
+    const uint32_t MAX_CODES = 1u << MAX_CODE_SIZE;
+    const uint32_t DICTIONARY_BITS = 13;        // Open-addressed, at least twice MAX_CODES
+    const size_t DICTIONARY_SIZE = size_t(1) << DICTIONARY_BITS;
+
+    inline void PutLE16(std::vector<uint8_t>* out, uint32_t v)
+    {
+        out->push_back(static_cast<uint8_t>(v));
+        out->push_back(static_cast<uint8_t>(v >> 8));
+    }
+
+    // Frame pixel as an opaque color: straight alpha is multiplied out, premultiplied
+    // pixels already are the color over black
+    inline void OpaqueColor(const uint8_t* p, AlphaMode alpha, uint32_t* r, uint32_t* g, uint32_t* b)
+    {
+        if (alpha == AlphaMode::Straight)
+        {
+            *b = (p[0] * p[3] + 127) / 255;
+            *g = (p[1] * p[3] + 127) / 255;
+            *r = (p[2] * p[3] + 127) / 255;
+        }
+        else
+        {
+            *b = p[0];
+            *g = p[1];
+            *r = p[2];
+        }
+    }
+
+    // Packs variable-width codes LSB first into 255-byte data sub-blocks
+    class CodeWriter
+    {
+    public:
+        explicit CodeWriter(std::vector<uint8_t>* out) : m_out(out), m_bits(0), m_count(0) {}
+
+        void Put(uint32_t code, uint32_t size)
+        {
+            m_bits |= static_cast<uint64_t>(code) << m_count;
+            m_count += size;
+            while (m_count >= 8)
+            {
+                PutByte(static_cast<uint8_t>(m_bits));
+                m_bits >>= 8;
+                m_count -= 8;
+            }
+        }
+
+        void Finish()
+        {
+            if (m_count > 0)
+                PutByte(static_cast<uint8_t>(m_bits));
+            if (m_blockLength > 0)
+                FlushBlock();
+            m_out->push_back(0);    // Block terminator
+        }
+
+    private:
+        void PutByte(uint8_t byte)
+        {
+            m_block[m_blockLength++] = byte;
+            if (m_blockLength == 255)
+                FlushBlock();
+        }
+
+        void FlushBlock()
+        {
+            m_out->push_back(static_cast<uint8_t>(m_blockLength));
+            m_out->insert(m_out->end(), m_block, m_block + m_blockLength);
+            m_blockLength = 0;
+        }
+
+        std::vector<uint8_t>* m_out;
+        uint64_t m_bits;
+        uint32_t m_count;
+        uint8_t m_block[255];
+        size_t m_blockLength = 0;
+    };
+}
+
+GifWriter::GifWriter(Sink sink)
+    : m_sink(std::move(sink)), m_width(0), m_height(0), m_framesWritten(0), m_failed(false),
+      m_histogram(PALETTE_BITS)
+{
+}
+
+bool GifWriter::Write(const uint8_t* data, size_t size)
+{
+    if (m_failed)
+        return false;
+    if (size && !m_sink(data, size))
+        m_failed = true;
+    return !m_failed;
+}
+
+bool GifWriter::Begin(uint32_t width, uint32_t height, uint32_t loopCount)
+{
+    if (width == 0 || height == 0 || width > 0xFFFF || height > 0xFFFF)
+        return false;
+
+    m_width = width;
+    m_height = height;
+    m_framesWritten = 0;
+    m_indices.resize(static_cast<size_t>(width) * height);
+
+    std::vector<uint8_t> header = { 'G', 'I', 'F', '8', '9', 'a' };
+    // Logical screen without a global color table; every frame brings its own
+    PutLE16(&header, width);
+    PutLE16(&header, height);
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+
+    // NETSCAPE2.0 application extension: loop count
+    const char application[] = "NETSCAPE2.0";
+    header.push_back(0x21);
+    header.push_back(0xFF);
+    header.push_back(11);
+    header.insert(header.end(), application, application + 11);
+    header.push_back(3);
+    header.push_back(1);
+    PutLE16(&header, std::min<uint32_t>(loopCount, 0xFFFF));
+    header.push_back(0);
+
+    return Write(header.data(), header.size());
+}
+
+void GifWriter::BuildPalette(const PixelImage& frame)
+{
+    m_histogram.Clear();
+    for (uint32_t y = 0; y < frame.height; ++y)
+    {
+        const uint8_t* p = frame.Row(y);
+        for (uint32_t x = 0; x < frame.width; ++x, p += 4)
+        {
+            uint32_t r, g, b;
+            OpaqueColor(p, frame.alpha, &r, &g, &b);
+            m_histogram.Add(r, g, b);
+        }
+    }
+    m_palette = MedianCut(m_histogram, MAX_COLORS);
+    m_lookup.assign(m_histogram.BinCount(), -1);
+}
+
+uint8_t GifWriter::MapColor(uint32_t r, uint32_t g, uint32_t b)
+{
+    uint32_t bin = m_histogram.BinOf(r, g, b);
+    int16_t& cached = m_lookup[bin];
+    if (cached >= 0)
+        return static_cast<uint8_t>(cached);
+
+    // Nearest palette entry to the bin center, so every pixel of a bin maps alike
+    const uint32_t shift = 8 - PALETTE_BITS;
+    int cr = static_cast<int>(((r >> shift) << shift) | (1u << (shift - 1)));
+    int cg = static_cast<int>(((g >> shift) << shift) | (1u << (shift - 1)));
+    int cb = static_cast<int>(((b >> shift) << shift) | (1u << (shift - 1)));
+
+    int best = 0;
+    int bestDistance = INT_MAX;
+    for (size_t i = 0; i < m_palette.size(); ++i)
+    {
+        int dr = m_palette[i].r - cr;
+        int dg = m_palette[i].g - cg;
+        int db = m_palette[i].b - cb;
+        int distance = dr * dr * 3 + dg * dg * 4 + db * db * 2;
+        if (distance < bestDistance)
+        {
+            bestDistance = distance;
+            best = static_cast<int>(i);
+        }
+    }
+    cached = static_cast<int16_t>(best);
+    return static_cast<uint8_t>(best);
+}
+
+bool GifWriter::WriteImageData(uint32_t minCodeSize)
+{
+    const uint32_t clearCode = 1u << minCodeSize;
+    const uint32_t endCode = clearCode + 1;
+
+    // Dictionary entries keyed by (prefix code, next index)
+    std::vector<uint32_t> keys(DICTIONARY_SIZE);
+    std::vector<uint16_t> codes(DICTIONARY_SIZE);
+    std::vector<uint8_t> used(DICTIONARY_SIZE);
+
+    m_output.push_back(static_cast<uint8_t>(minCodeSize));
+    CodeWriter writer(&m_output);
+
+    uint32_t codeSize = minCodeSize + 1;
+    uint32_t nextCode = endCode + 1;
+    writer.Put(clearCode, codeSize);
+
+    uint32_t prefix = m_indices[0];
+    for (size_t i = 1; i < m_indices.size(); ++i)
+    {
+        uint32_t index = m_indices[i];
+        uint32_t key = (prefix << 8) | index;
+        size_t slot = (key * 2654435761u) >> (32 - DICTIONARY_BITS);
+        while (used[slot] && keys[slot] != key)
+            slot = (slot + 1) & (DICTIONARY_SIZE - 1);
+
+        if (used[slot])
+        {
+            prefix = codes[slot];
+            continue;
+        }
+
+        writer.Put(prefix, codeSize);
+        prefix = index;
+
+        if (nextCode < MAX_CODES)
+        {
+            used[slot] = 1;
+            keys[slot] = key;
+            codes[slot] = static_cast<uint16_t>(nextCode++);
+            // The decoder adds this entry one code later, and widens once its next code
+            // no longer fits; that is one past the encoder's boundary
+            if (nextCode > (1u << codeSize) && codeSize < MAX_CODE_SIZE)
+                ++codeSize;
+        }
+        else
+        {
+            // Table full: start over rather than keep coding against a stale dictionary
+            writer.Put(clearCode, codeSize);
+            std::fill(used.begin(), used.end(), 0);
+            codeSize = minCodeSize + 1;
+            nextCode = endCode + 1;
+        }
+    }
+    writer.Put(prefix, codeSize);
+    writer.Put(endCode, codeSize);
+    writer.Finish();
+    return true;
+}
+
+bool GifWriter::AddFrame(const PixelImage& frame, uint32_t delayMs)
+{
+    if (m_failed || m_width == 0 || frame.Empty() || frame.width != m_width || frame.height != m_height)
+        return false;
+
+    BuildPalette(frame);
+
+    uint8_t* indices = m_indices.data();
+    for (uint32_t y = 0; y < frame.height; ++y)
+    {
+        const uint8_t* p = frame.Row(y);
+        for (uint32_t x = 0; x < frame.width; ++x, p += 4)
+        {
+            uint32_t r, g, b;
+            OpaqueColor(p, frame.alpha, &r, &g, &b);
+            *indices++ = MapColor(r, g, b);
+        }
+    }
+
+    // Color table sizes are powers of two, at least 2 entries
+    uint32_t tableBits = 1;
+    while ((1u << tableBits) < m_palette.size())
+        ++tableBits;
+
+    m_output.clear();
+
+    // Graphic control extension: delay in hundredths of a second, no transparency
+    m_output.push_back(0x21);
+    m_output.push_back(0xF9);
+    m_output.push_back(4);
+    m_output.push_back(1 << 2);     // Disposal: leave in place
+    PutLE16(&m_output, std::min<uint32_t>((delayMs + 5) / 10, 0xFFFF));
+    m_output.push_back(0);
+    m_output.push_back(0);
+
+    // Image descriptor with a local color table
+    m_output.push_back(0x2C);
+    PutLE16(&m_output, 0);
+    PutLE16(&m_output, 0);
+    PutLE16(&m_output, m_width);
+    PutLE16(&m_output, m_height);
+    m_output.push_back(static_cast<uint8_t>(0x80 | (tableBits - 1)));
+
+    for (uint32_t i = 0; i < (1u << tableBits); ++i)
+    {
+        QuantizedColor color = i < m_palette.size() ? m_palette[i] : QuantizedColor();
+        m_output.push_back(color.r);
+        m_output.push_back(color.g);
+        m_output.push_back(color.b);
+    }
+
+    if (!WriteImageData(std::max<uint32_t>(tableBits, 2)))
+        return false;
+
+    if (!Write(m_output.data(), m_output.size()))
+        return false;
+    ++m_framesWritten;
+    return true;
+}
+
+bool GifWriter::Finish()
+{
+    if (m_width == 0)
+        return false;
+    const uint8_t trailer = 0x3B;
+    return Write(&trailer, 1);
+}
+
+bool SaveFramesAsGif(const std::vector<PixelImage>& frames, uint32_t delayMs, const std::filesystem::path& path)
+{
+    if (frames.empty() || frames[0].Empty())
+        return false;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    GifWriter writer([&file](const uint8_t* data, size_t size)
+    {
+        file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(file);
+    });
+
+    if (!writer.Begin(frames[0].width, frames[0].height))
+        return false;
+    for (const PixelImage& frame : frames)
+    {
+        if (!writer.AddFrame(frame, delayMs))
+            return false;
+    }
+    if (!writer.Finish())
+        return false;
+
+    file.close();
+    return static_cast<bool>(file);
+}
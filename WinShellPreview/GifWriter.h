@@ -0,0 +1,47 @@
+#pragma once
+#include "ColorQuantizer.h"
+#include "ImageOps.h"
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+// Streaming animated GIF (GIF89a) encoder. Every frame gets its own 256-color palette from a
+// median cut, pixels map to the nearest palette entry through a lazily filled lookup table,
+// and the LZW stream is handed to the sink frame by frame. No Windows dependencies.
+class GifWriter
+{
+public:
+    // Receives encoded bytes in order; return false to abort
+    typedef std::function<bool(const uint8_t* data, size_t size)> Sink;
+
+    explicit GifWriter(Sink sink);
+
+    // loopCount 0 = repeat forever
+    bool Begin(uint32_t width, uint32_t height, uint32_t loopCount = 0);
+
+    // Frames must match the size passed to Begin. Transparent pixels are composited over black.
+    bool AddFrame(const PixelImage& frame, uint32_t delayMs);
+
+    bool Finish();
+
+    uint32_t FramesWritten() const { return m_framesWritten; }
+
+private:
+    bool Write(const uint8_t* data, size_t size);
+    void BuildPalette(const PixelImage& frame);
+    uint8_t MapColor(uint32_t r, uint32_t g, uint32_t b);
+    bool WriteImageData(uint32_t minCodeSize);
+
+    Sink m_sink;
+    uint32_t m_width;
+    uint32_t m_height;
+    uint32_t m_framesWritten;
+    bool m_failed;
+    ColorHistogram m_histogram;
+    std::vector<QuantizedColor> m_palette;
+    std::vector<int16_t> m_lookup;      // Histogram bin -> palette index, -1 until first use
+    std::vector<uint8_t> m_indices;     // Current frame as palette indices
+    std::vector<uint8_t> m_output;      // Pending bytes of the current frame
+};
+
+bool SaveFramesAsGif(const std::vector<PixelImage>& frames, uint32_t delayMs, const std::filesystem::path& path);
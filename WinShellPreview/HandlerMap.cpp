@@ -0,0 +1,399 @@
+#include "HandlerMap.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // Reader retries while a slot is being rewritten before treating it as a miss
+    const int READ_RETRIES = 64;
+
+    inline uint64_t Mix(uint64_t hash, uint64_t word)
+    {
+        hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+        return hash ^ (hash >> 32);
+    }
+
+    void ToWords(const HandlerClsid& clsid, uint64_t words[2])
+    {
+        memcpy(words, clsid.bytes, sizeof(clsid.bytes));
+    }
+
+    void FromWords(const uint64_t words[2], HandlerClsid* clsid)
+    {
+        memcpy(clsid->bytes, words, sizeof(clsid->bytes));
+    }
+}
+
+void TableHandlerResolver::Set(const std::string& extensionKey, const HandlerClsid& clsid)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_handlers[extensionKey] = clsid;
+}
+
+void TableHandlerResolver::Remove(const std::string& extensionKey)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_handlers.erase(extensionKey);
+}
+
+void TableHandlerResolver::SetFailing(bool failing)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_failing = failing;
+}
+
+uint64_t TableHandlerResolver::ResolveCount() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_resolves;
+}
+
+HandlerResolution TableHandlerResolver::Resolve(const std::string& extensionKey, HandlerClsid* clsid)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_resolves++;
+    if (m_failing)
+        return HandlerResolution::Failed;
+
+    auto found = m_handlers.find(extensionKey);
+    if (found == m_handlers.end())
+        return HandlerResolution::None;
+    *clsid = found->second;
+    return HandlerResolution::Found;
+}
+
+std::vector<std::string> TableHandlerResolver::Enumerate()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    std::vector<std::string> extensions;
+    extensions.reserve(m_handlers.size());
+    for (const auto& entry : m_handlers)
+        extensions.push_back(entry.first);
+    return extensions;
+}
+
+HandlerMap::HandlerMap(std::shared_ptr<HandlerResolver> resolver, size_t capacity)
+    : m_resolver(std::move(resolver)), m_mask(0), m_generation(1), m_entries(0), m_negativeEntries(0),
+      m_hits(0), m_misses(0), m_negativeHits(0), m_resolved(0), m_failures(0), m_uncached(0),
+      m_preloaded(0), m_invalidations(0), m_restored(0)
+{
+    size_t slots = MAX_PROBE;
+    while (slots < capacity)
+        slots *= 2;
+    m_slots.reset(new Slot[slots]);
+    m_mask = slots - 1;
+}
+
+bool HandlerMap::MakeKey(std::string_view extensionKey, Key* key)
+{
+    if (extensionKey.empty() || extensionKey.size() > MAX_KEY_BYTES ||
+        extensionKey.find('\0') != std::string_view::npos)
+        return false;
+
+    // Zero padding keeps keys of different lengths distinct
+    memset(key->words, 0, sizeof(key->words));
+    memcpy(key->words, extensionKey.data(), extensionKey.size());
+
+    uint64_t hash = 0x9e3779b97f4a7c15ull ^ extensionKey.size();
+    for (uint64_t word : key->words)
+        hash = Mix(hash, word);
+    key->hash = hash;
+    return true;
+}
+
+bool HandlerMap::Lookup(const Key& key, uint32_t generation, HandlerResolution* resolution, HandlerClsid* clsid) const
+{
+    const size_t words = MAX_KEY_BYTES / 8;
+    for (size_t probe = 0; probe < MAX_PROBE; ++probe)
+    {
+        const Slot& slot = m_slots[(key.hash + probe) & m_mask];
+
+        uint32_t slotGeneration;
+        uint32_t slotResolution;
+        uint64_t slotKey[words];
+        uint64_t slotClsid[2];
+        int retries = 0;
+        for (;;)
+        {
+            uint32_t before = slot.sequence.load(std::memory_order_acquire);
+            if (!(before & 1))
+            {
+                slotGeneration = slot.generation.load(std::memory_order_relaxed);
+                slotResolution = slot.resolution.load(std::memory_order_relaxed);
+                for (size_t i = 0; i < words; ++i)
+                    slotKey[i] = slot.key[i].load(std::memory_order_relaxed);
+                slotClsid[0] = slot.clsid[0].load(std::memory_order_relaxed);
+                slotClsid[1] = slot.clsid[1].load(std::memory_order_relaxed);
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) == before)
+                    break;
+            }
+            if (++retries >= READ_RETRIES)
+                return false;
+        }
+
+        // Entries of one generation are never removed, so the first slot outside the current
+        // generation ends the probe sequence
+        if (slotGeneration != generation)
+            return false;
+        if (memcmp(slotKey, key.words, sizeof(slotKey)) != 0)
+            continue;
+
+        *resolution = static_cast<HandlerResolution>(slotResolution);
+        FromWords(slotClsid, clsid);
+        return true;
+    }
+    return false;
+}
+
+bool HandlerMap::Store(const Key& key, uint32_t generation, HandlerResolution resolution, const HandlerClsid& clsid)
+{
+    const size_t words = MAX_KEY_BYTES / 8;
+    for (size_t probe = 0; probe < MAX_PROBE; ++probe)
+    {
+        Slot& slot = m_slots[(key.hash + probe) & m_mask];
+
+        // Only writers (serialized by m_writeLock) change a slot, so plain loads are current
+        bool current = slot.generation.load(std::memory_order_relaxed) == generation;
+        bool same = true;
+        for (size_t i = 0; i < words && same; ++i)
+            same = slot.key[i].load(std::memory_order_relaxed) == key.words[i];
+        if (current && !same)
+            continue;
+
+        if (current)
+        {
+            if (static_cast<HandlerResolution>(slot.resolution.load(std::memory_order_relaxed)) == HandlerResolution::None)
+                m_negativeEntries--;
+        }
+        else
+        {
+            m_entries++;
+        }
+        if (resolution == HandlerResolution::None)
+            m_negativeEntries++;
+
+        uint64_t clsidWords[2];
+        ToWords(clsid, clsidWords);
+
+        uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.generation.store(generation, std::memory_order_relaxed);
+        slot.resolution.store(static_cast<uint32_t>(resolution), std::memory_order_relaxed);
+        for (size_t i = 0; i < words; ++i)
+            slot.key[i].store(key.words[i], std::memory_order_relaxed);
+        slot.clsid[0].store(clsidWords[0], std::memory_order_relaxed);
+        slot.clsid[1].store(clsidWords[1], std::memory_order_relaxed);
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+        return true;
+    }
+    return false;
+}
+
+HandlerResolution HandlerMap::Resolve(std::string_view extensionKey, const Key* key, HandlerClsid* clsid, bool* stored)
+{
+    *stored = false;
+
+    // Read before asking, so an Invalidate during the (slow) resolve keeps its answer out
+    uint32_t generation = m_generation.load(std::memory_order_acquire);
+
+    HandlerClsid resolved = {};
+    HandlerResolution resolution = m_resolver->Resolve(std::string(extensionKey), &resolved);
+    m_resolved.fetch_add(1, std::memory_order_relaxed);
+    if (resolution == HandlerResolution::Failed)
+    {
+        m_failures.fetch_add(1, std::memory_order_relaxed);
+        return resolution;
+    }
+    if (resolution == HandlerResolution::None)
+        resolved = HandlerClsid();
+    *clsid = resolved;
+
+    if (key)
+    {
+        std::lock_guard<std::mutex> lock(m_writeLock);
+        if (m_generation.load(std::memory_order_relaxed) == generation)
+        {
+            *stored = Store(*key, generation, resolution, resolved);
+            if (!*stored)
+                m_uncached.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    return resolution;
+}
+
+HandlerResolution HandlerMap::Find(std::string_view extensionKey, HandlerClsid* clsid)
+{
+    bool stored;
+    Key key;
+    if (!MakeKey(extensionKey, &key))
+    {
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        m_uncached.fetch_add(1, std::memory_order_relaxed);
+        return Resolve(extensionKey, nullptr, clsid, &stored);
+    }
+
+    HandlerResolution resolution;
+    if (Lookup(key, m_generation.load(std::memory_order_acquire), &resolution, clsid))
+    {
+        m_hits.fetch_add(1, std::memory_order_relaxed);
+        if (resolution == HandlerResolution::None)
+            m_negativeHits.fetch_add(1, std::memory_order_relaxed);
+        return resolution;
+    }
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return Resolve(extensionKey, &key, clsid, &stored);
+}
+
+bool HandlerMap::Warm(const std::string& extensionKey, bool replace)
+{
+    Key key;
+    if (!MakeKey(extensionKey, &key))
+        return false;
+
+    HandlerResolution resolution;
+    HandlerClsid clsid;
+    if (!replace && Lookup(key, m_generation.load(std::memory_order_acquire), &resolution, &clsid))
+        return false;
+
+    bool stored;
+    Resolve(extensionKey, &key, &clsid, &stored);
+    if (stored)
+        m_preloaded.fetch_add(1, std::memory_order_relaxed);
+    return stored;
+}
+
+size_t HandlerMap::Preload()
+{
+    size_t written = 0;
+    for (const std::string& extension : m_resolver->Enumerate())
+    {
+        if (Warm(extension, false))
+            written++;
+    }
+    return written;
+}
+
+void HandlerMap::Invalidate()
+{
+    const size_t words = MAX_KEY_BYTES / 8;
+    std::lock_guard<std::mutex> lock(m_writeLock);
+
+    uint32_t generation = m_generation.load(std::memory_order_relaxed);
+    for (size_t i = 0; i <= m_mask && m_refreshKeys.size() <= m_mask; ++i)
+    {
+        const Slot& slot = m_slots[i];
+        if (slot.generation.load(std::memory_order_relaxed) != generation)
+            continue;
+
+        uint64_t keyWords[words];
+        for (size_t w = 0; w < words; ++w)
+            keyWords[w] = slot.key[w].load(std::memory_order_relaxed);
+        m_refreshKeys.push_back(KeyText(keyWords));
+    }
+
+    // 0 marks a slot that was never written
+    uint32_t next = generation + 1;
+    if (next == 0)
+        next = 1;
+    m_generation.store(next, std::memory_order_release);
+    m_entries = 0;
+    m_negativeEntries = 0;
+    m_invalidations.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t HandlerMap::Refresh()
+{
+    std::vector<std::string> keys;
+    {
+        std::lock_guard<std::mutex> lock(m_writeLock);
+        keys.swap(m_refreshKeys);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    size_t written = 0;
+    for (const std::string& key : keys)
+    {
+        if (Warm(key, true))
+            written++;
+    }
+    return written;
+}
+
+std::string HandlerMap::KeyText(const uint64_t* words)
+{
+    char text[MAX_KEY_BYTES];
+    memcpy(text, words, MAX_KEY_BYTES);
+    size_t length = 0;
+    while (length < MAX_KEY_BYTES && text[length] != '\0')
+        length++;
+    return std::string(text, length);
+}
+
+std::vector<HandlerMapEntry> HandlerMap::Entries() const
+{
+    const size_t words = MAX_KEY_BYTES / 8;
+    std::vector<HandlerMapEntry> entries;
+
+    std::lock_guard<std::mutex> lock(m_writeLock);
+    uint32_t generation = m_generation.load(std::memory_order_relaxed);
+    for (size_t i = 0; i <= m_mask; ++i)
+    {
+        const Slot& slot = m_slots[i];
+        if (slot.generation.load(std::memory_order_relaxed) != generation)
+            continue;
+
+        uint64_t keyWords[words];
+        for (size_t w = 0; w < words; ++w)
+            keyWords[w] = slot.key[w].load(std::memory_order_relaxed);
+        uint64_t clsidWords[2] = { slot.clsid[0].load(std::memory_order_relaxed), slot.clsid[1].load(std::memory_order_relaxed) };
+
+        HandlerMapEntry entry;
+        entry.extensionKey = KeyText(keyWords);
+        entry.resolution = static_cast<HandlerResolution>(slot.resolution.load(std::memory_order_relaxed));
+        FromWords(clsidWords, &entry.clsid);
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
+
+size_t HandlerMap::Restore(const std::vector<HandlerMapEntry>& entries)
+{
+    size_t stored = 0;
+    std::lock_guard<std::mutex> lock(m_writeLock);
+    uint32_t generation = m_generation.load(std::memory_order_relaxed);
+    for (const HandlerMapEntry& entry : entries)
+    {
+        Key key;
+        if (entry.resolution == HandlerResolution::Failed || !MakeKey(entry.extensionKey, &key))
+            continue;
+        if (m_refreshKeys.size() <= m_mask)
+            m_refreshKeys.push_back(entry.extensionKey);
+        if (Store(key, generation, entry.resolution, entry.resolution == HandlerResolution::Found ? entry.clsid : HandlerClsid()))
+            stored++;
+    }
+    m_restored.fetch_add(stored, std::memory_order_relaxed);
+    return stored;
+}
+
+HandlerMapStats HandlerMap::Stats() const
+{
+    HandlerMapStats stats = {};
+    stats.hits = m_hits.load(std::memory_order_relaxed);
+    stats.lookups = stats.hits + m_misses.load(std::memory_order_relaxed);
+    stats.negativeHits = m_negativeHits.load(std::memory_order_relaxed);
+    stats.resolved = m_resolved.load(std::memory_order_relaxed);
+    stats.failures = m_failures.load(std::memory_order_relaxed);
+    stats.uncached = m_uncached.load(std::memory_order_relaxed);
+    stats.preloaded = m_preloaded.load(std::memory_order_relaxed);
+    stats.invalidations = m_invalidations.load(std::memory_order_relaxed);
+    stats.restored = m_restored.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(m_writeLock);
+    stats.entries = m_entries;
+    stats.negativeEntries = m_negativeEntries;
+    return stats;
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Extension -> preview handler CLSID map in front of a slow resolver (the association registry
+// on Windows). Lookups that hit never lock: entries live in a fixed open-addressing table and are
+// read under a per-slot sequence counter, so a reader racing a writer simply retries. Extensions
+// without a handler are cached too, so unsupported files are rejected before any work starts.
+// No Windows dependencies.
+
+// Same layout as a Windows GUID
+struct HandlerClsid
+{
+    uint8_t bytes[16];
+};
+
+enum class HandlerResolution : uint32_t
+{
+    Found,      // A handler is registered
+    None,       // Nothing registered (cached as a negative entry)
+    Failed      // The lookup itself failed; not cached, the next call asks again
+};
+
+class HandlerResolver
+{
+public:
+    virtual ~HandlerResolver() {}
+
+    // extensionKey is lowercase with the dot (".docx")
+    virtual HandlerResolution Resolve(const std::string& extensionKey, HandlerClsid* clsid) = 0;
+
+    // Every extension that has an association at all, for preloading
+    virtual std::vector<std::string> Enumerate() = 0;
+};
+
+// Resolver backed by a table: the stand-in on platforms without an association registry.
+// Thread-safe; counts Resolve calls so callers can see what the cache saved.
+class TableHandlerResolver : public HandlerResolver
+{
+public:
+    void Set(const std::string& extensionKey, const HandlerClsid& clsid);
+    void Remove(const std::string& extensionKey);
+    void SetFailing(bool failing);              // Resolve reports Failed while set
+    uint64_t ResolveCount() const;
+
+    HandlerResolution Resolve(const std::string& extensionKey, HandlerClsid* clsid) override;
+    std::vector<std::string> Enumerate() override;
+
+private:
+    mutable std::mutex m_lock;
+    std::unordered_map<std::string, HandlerClsid> m_handlers;
+    bool m_failing = false;
+    uint64_t m_resolves = 0;
+};
+
+struct HandlerMapEntry
+{
+    std::string extensionKey;
+    HandlerResolution resolution;   // Found or None
+    HandlerClsid clsid;             // Zero for None
+};
+
+struct HandlerMapStats
+{
+    uint64_t lookups;
+    uint64_t hits;              // Answered from the table, including negative entries
+    uint64_t negativeHits;
+    uint64_t resolved;          // Resolver calls made on a miss or preload
+    uint64_t failures;          // Resolver calls that failed (not cached)
+    uint64_t uncached;          // Lookups the table could not hold (key too long, table full)
+    uint64_t preloaded;         // Entries written by Preload and Refresh
+    uint64_t restored;          // Entries written by Restore
+    uint64_t invalidations;
+    uint64_t entries;           // Valid entries now
+    uint64_t negativeEntries;
+};
+
+class HandlerMap
+{
+public:
+    static const size_t MAX_KEY_BYTES = 32;     // Longer extensions are resolved every time
+    static const size_t MAX_PROBE = 8;
+
+    // capacity is rounded up to a power of two
+    explicit HandlerMap(std::shared_ptr<HandlerResolver> resolver, size_t capacity = 4096);
+
+    HandlerMap(const HandlerMap&) = delete;
+    HandlerMap& operator=(const HandlerMap&) = delete;
+
+    // extensionKey as for HandlerResolver::Resolve. Resolves and caches on a miss.
+    HandlerResolution Find(std::string_view extensionKey, HandlerClsid* clsid);
+
+    // Resolves every extension the resolver enumerates. Returns the entries written.
+    size_t Preload();
+
+    // Drops every entry (the resolver's data changed in an unknown way). Lookups resolve again
+    // from now on, and a resolve that started before the call is not cached. The extensions
+    // that were cached are remembered for Refresh.
+    void Invalidate();
+
+    // Resolves again the extensions cached before the last Invalidate calls (and those passed to
+    // Restore), so the ones in use are warm and current without enumerating everything. Call
+    // once the changes have settled.
+    size_t Refresh();
+
+    // Valid entries, e.g. for a warm-start snapshot
+    std::vector<HandlerMapEntry> Entries() const;
+
+    // Stores entries saved by an earlier process. They are served at once and queued for
+    // Refresh, which checks them against the resolver. Returns the entries stored.
+    size_t Restore(const std::vector<HandlerMapEntry>& entries);
+
+    HandlerMapStats Stats() const;
+
+private:
+    // All fields are atomics so readers may copy them while a writer is mid-update; the
+    // sequence counter tells them whether the copy is consistent
+    struct Slot
+    {
+        std::atomic<uint32_t> sequence{0};          // Odd while being written
+        std::atomic<uint32_t> generation{0};        // Valid only if equal to m_generation
+        std::atomic<uint32_t> resolution{0};
+        std::atomic<uint64_t> key[MAX_KEY_BYTES / 8] = {};
+        std::atomic<uint64_t> clsid[2] = {};
+    };
+
+    struct Key
+    {
+        uint64_t words[MAX_KEY_BYTES / 8];
+        uint64_t hash;
+    };
+
+    static bool MakeKey(std::string_view extensionKey, Key* key);
+    bool Lookup(const Key& key, uint32_t generation, HandlerResolution* resolution, HandlerClsid* clsid) const;
+    // Call with m_writeLock held
+    bool Store(const Key& key, uint32_t generation, HandlerResolution resolution, const HandlerClsid& clsid);
+    // Asks the resolver and caches the answer unless key is null or an Invalidate intervened
+    HandlerResolution Resolve(std::string_view extensionKey, const Key* key, HandlerClsid* clsid, bool* stored);
+    // Resolves and stores extensionKey; unless replace, only if it is not cached yet
+    bool Warm(const std::string& extensionKey, bool replace);
+    static std::string KeyText(const uint64_t* words);
+
+    std::shared_ptr<HandlerResolver> m_resolver;
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask;
+    std::atomic<uint32_t> m_generation;
+
+    mutable std::mutex m_writeLock;
+    std::vector<std::string> m_refreshKeys;         // Guarded by m_writeLock, refreshed with replace
+    uint64_t m_entries;                             // Guarded by m_writeLock
+    uint64_t m_negativeEntries;
+
+    std::atomic<uint64_t> m_hits;                   // Lookups are hits + misses: one counter per hit
+    std::atomic<uint64_t> m_misses;
+    std::atomic<uint64_t> m_negativeHits;
+    std::atomic<uint64_t> m_resolved;
+    std::atomic<uint64_t> m_failures;
+    std::atomic<uint64_t> m_uncached;
+    std::atomic<uint64_t> m_preloaded;
+    std::atomic<uint64_t> m_invalidations;
+    std::atomic<uint64_t> m_restored;
+};
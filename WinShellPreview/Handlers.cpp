@@ -0,0 +1,249 @@
+#include "pch.h"
+#include "HandlersImpl.h"
+#include "HandlerMap.h"
+#include "PathsImpl.h"
+#include "TextUtils.h"
+#include <shlwapi.h>
+#include <algorithm>
+#include <thread>
+
+static_assert(sizeof(CLSID) == sizeof(HandlerClsid), "HandlerClsid must hold a CLSID");
+
+namespace
+{
+    const WCHAR IID_PREVIEW_HANDLER_TEXT[] = L"{8895b1c6-b41f-4c1c-a562-0d564250836f}";
+
+    // Installers write associations in bursts; the extensions in use are resolved again once
+    // the registry has been quiet this long
+    const DWORD REGISTRY_SETTLE_MS = 2000;
+
+    // Why the last Failed resolve on this thread failed, so callers still see the real error
+    thread_local HRESULT t_resolveError = S_OK;
+
+    char AsciiLower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    class RegistryHandlerResolver : public HandlerResolver
+    {
+    public:
+        HandlerResolution Resolve(const std::string& extensionKey, HandlerClsid* clsid) override
+        {
+            std::wstring extension = Utf8ToWide(extensionKey);
+            WCHAR szCLSID[MAX_PATH] = {};
+            DWORD dwSize = MAX_PATH;
+            HRESULT hr = AssocQueryStringW(ASSOCF_INIT_DEFAULTTOSTAR, ASSOCSTR_SHELLEXTENSION, extension.c_str(),
+                                           IID_PREVIEW_HANDLER_TEXT, szCLSID, &dwSize);
+            if (hr == HRESULT_FROM_WIN32(ERROR_NO_ASSOCIATION) || hr == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
+                return HandlerResolution::None;
+            if (FAILED(hr))
+            {
+                t_resolveError = hr;
+                return HandlerResolution::Failed;
+            }
+
+            // A malformed registration fails the same way every time
+            CLSID parsed;
+            if (FAILED(CLSIDFromString(szCLSID, &parsed)))
+                return HandlerResolution::None;
+            memcpy(clsid->bytes, &parsed, sizeof(parsed));
+            return HandlerResolution::Found;
+        }
+
+        std::vector<std::string> Enumerate() override
+        {
+            std::vector<std::string> extensions;
+            WCHAR name[256];
+            for (DWORD index = 0;; ++index)
+            {
+                DWORD length = ARRAYSIZE(name);
+                LONG status = RegEnumKeyExW(HKEY_CLASSES_ROOT, index, name, &length, nullptr, nullptr, nullptr, nullptr);
+                if (status == ERROR_MORE_DATA)
+                    continue;   // Far longer than any extension the map caches
+                if (status != ERROR_SUCCESS)
+                    break;
+                if (name[0] != L'.')
+                    continue;
+
+                std::string key = WideToUtf8(std::wstring(name, length));
+                std::transform(key.begin(), key.end(), key.begin(), AsciiLower);
+                extensions.push_back(std::move(key));
+            }
+            return extensions;
+        }
+    };
+
+    // HKEY_CLASSES_ROOT is a merged view of these; a notification on either may change a handler.
+    // refresh is signaled when entries are restored from a snapshot, so they are checked against
+    // the registry in the background.
+    void WatchAssociations(HandlerMap& map, HANDLE preloaded, HANDLE refresh)
+    {
+        HRESULT hrCom = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+        HKEY keys[2] = {};
+        HANDLE events[3] = {};
+        DWORD count = 0;
+        HKEY roots[2] = { HKEY_CURRENT_USER, HKEY_LOCAL_MACHINE };
+        for (HKEY root : roots)
+        {
+            HKEY key = nullptr;
+            if (RegOpenKeyExW(root, L"Software\\Classes", 0, KEY_NOTIFY, &key) != ERROR_SUCCESS)
+                continue;
+            HANDLE event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+            if (!event)
+            {
+                RegCloseKey(key);
+                continue;
+            }
+            keys[count] = key;
+            events[count] = event;
+            count++;
+        }
+
+        // Notifications are one-shot and must be re-armed after each one
+        auto arm = [&](DWORD i)
+        {
+            RegNotifyChangeKeyValue(keys[i], TRUE, REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET, events[i], TRUE);
+        };
+
+        // Armed before preloading, so a change made during the preload is not missed
+        for (DWORD i = 0; i < count; ++i)
+            arm(i);
+        map.Preload();
+        SetEvent(preloaded);
+
+        DWORD waitCount = count;
+        if (refresh)
+            events[waitCount++] = refresh;
+
+        while (waitCount > 0)
+        {
+            DWORD wait = WaitForMultipleObjects(waitCount, events, FALSE, INFINITE);
+            if (wait >= WAIT_OBJECT_0 + waitCount)
+                break;
+            if (wait == WAIT_OBJECT_0 + count)
+            {
+                map.Refresh();
+                continue;
+            }
+
+            // The notification does not say which association changed, so everything goes at once
+            do
+            {
+                map.Invalidate();
+                arm(wait - WAIT_OBJECT_0);
+                wait = WaitForMultipleObjects(count, events, FALSE, REGISTRY_SETTLE_MS);
+            } while (wait < WAIT_OBJECT_0 + count);
+
+            map.Refresh();
+        }
+
+        for (DWORD i = 0; i < count; ++i)
+        {
+            CloseHandle(events[i]);
+            RegCloseKey(keys[i]);
+        }
+        if (SUCCEEDED(hrCom))
+            CoUninitialize();
+    }
+
+    struct HandlerCache
+    {
+        HandlerMap map;
+        HANDLE preloaded;
+        HANDLE refresh;
+
+        HandlerCache()
+            : map(std::make_shared<RegistryHandlerResolver>()), preloaded(CreateEventW(nullptr, TRUE, FALSE, nullptr)),
+              refresh(CreateEventW(nullptr, FALSE, FALSE, nullptr))
+        {
+            std::thread([this]() { WatchAssociations(map, preloaded, refresh); }).detach();
+        }
+    };
+
+    // Leaked on purpose: the watcher thread uses it until the process exits
+    HandlerCache& Handlers()
+    {
+        static HandlerCache* cache = new HandlerCache();
+        return *cache;
+    }
+}
+
+HRESULT FindPreviewHandlerClsid(const PathRecord& record, CLSID* pClsid)
+{
+    if (pClsid)
+        *pClsid = CLSID_NULL;
+
+    std::string_view extension = record.ExtensionKey();
+    if (extension.empty())
+        return HRESULT_FROM_WIN32(ERROR_NO_ASSOCIATION);
+
+    HandlerClsid clsid;
+    switch (Handlers().map.Find(extension, &clsid))
+    {
+    case HandlerResolution::Found:
+        if (pClsid)
+            memcpy(pClsid, clsid.bytes, sizeof(CLSID));
+        return S_OK;
+    case HandlerResolution::None:
+        return HRESULT_FROM_WIN32(ERROR_NO_ASSOCIATION);
+    default:
+        return FAILED(t_resolveError) ? t_resolveError : E_FAIL;
+    }
+}
+
+HRESULT FindPreviewHandlerClsid(LPCWSTR filePath, CLSID* pClsid)
+{
+    PathRef record = InternPath(filePath);
+    if (!record)
+        return E_INVALIDARG;
+    return FindPreviewHandlerClsid(*record, pClsid);
+}
+
+HRESULT PreloadPreviewHandlersImpl(UINT timeoutMs)
+{
+    HANDLE preloaded = Handlers().preloaded;
+    if (!preloaded)
+        return E_OUTOFMEMORY;
+    if (timeoutMs == 0)
+        return S_OK;
+
+    DWORD wait = WaitForSingleObject(preloaded, timeoutMs);
+    if (wait == WAIT_OBJECT_0)
+        return S_OK;
+    return wait == WAIT_TIMEOUT ? HRESULT_FROM_WIN32(WAIT_TIMEOUT) : HRESULT_FROM_WIN32(GetLastError());
+}
+
+std::vector<HandlerMapEntry> PreviewHandlerEntries()
+{
+    return Handlers().map.Entries();
+}
+
+size_t RestorePreviewHandlers(const std::vector<HandlerMapEntry>& entries)
+{
+    HandlerCache& cache = Handlers();
+    size_t restored = cache.map.Restore(entries);
+    if (restored > 0 && cache.refresh)
+        SetEvent(cache.refresh);
+    return restored;
+}
+
+HRESULT GetPreviewHandlerCacheStatsImpl(WSP_HANDLER_CACHE_STATS* pStats)
+{
+    if (!pStats)
+        return E_INVALIDARG;
+
+    HandlerMapStats stats = Handlers().map.Stats();
+    pStats->lookups = stats.lookups;
+    pStats->hits = stats.hits;
+    pStats->negativeHits = stats.negativeHits;
+    pStats->resolved = stats.resolved;
+    pStats->failures = stats.failures;
+    pStats->uncached = stats.uncached;
+    pStats->preloaded = stats.preloaded;
+    pStats->invalidations = stats.invalidations;
+    pStats->entries = stats.entries;
+    pStats->negativeEntries = stats.negativeEntries;
+    return S_OK;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "framework.h"
+#include "WinShellPreview.h"
+#include "HandlerMap.h"
+#include "PathTable.h"
+#include <vector>
+
+// Preview handler registered for the file's extension, from the shared extension -> CLSID map
+// (see HandlerMap.h). Returns HRESULT_FROM_WIN32(ERROR_NO_ASSOCIATION) when nothing is
+// registered; that answer is cached, so unsupported files fail before any thread or window is
+// created. pClsid may be null when only the answer matters. The first call starts the
+// background preload and the registry watcher.
+HRESULT FindPreviewHandlerClsid(const PathRecord& record, CLSID* pClsid);
+HRESULT FindPreviewHandlerClsid(LPCWSTR filePath, CLSID* pClsid);
+
+HRESULT PreloadPreviewHandlersImpl(UINT timeoutMs);
+// Warm start (see SnapshotImpl.h). Restored entries are answered at once and resolved again on
+// the watcher thread, so an association changed while the process was not running is corrected.
+std::vector<HandlerMapEntry> PreviewHandlerEntries();
+size_t RestorePreviewHandlers(const std::vector<HandlerMapEntry>& entries);
+
+HRESULT GetPreviewHandlerCacheStatsImpl(WSP_HANDLER_CACHE_STATS* pStats);
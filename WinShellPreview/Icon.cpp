@@ -1,11 +1,13 @@
 #include "pch.h"
 #include "IconImpl.h"
+#include "ShellContext.h"
+#include "CoalescingImpl.h"
 #include <shobjidl.h>
 
 #pragma comment(lib, "shell32.lib")
 
 // Get Explorer-style image (thumbnail first, then icon fallback)
-HRESULT GetFileIconImpl(LPCWSTR filePath, UINT size, HBITMAP* phBitmap)
+static HRESULT ExtractFileIcon(LPCWSTR filePath, UINT size, HBITMAP* phBitmap)
 {
     if (!filePath || !phBitmap)
         return E_INVALIDARG;
@@ -13,7 +15,7 @@ HRESULT GetFileIconImpl(LPCWSTR filePath, UINT size, HBITMAP* phBitmap)
     *phBitmap = nullptr;
 
     IShellItemImageFactory* sif = nullptr;
-    HRESULT hr = SHCreateItemFromParsingName(filePath, nullptr, IID_IShellItemImageFactory, reinterpret_cast<void**>(&sif));
+    HRESULT hr = ShellContext::ForCurrentThread().CreateItem(filePath, IID_IShellItemImageFactory, reinterpret_cast<void**>(&sif));
     if (FAILED(hr))
         return hr;
 
@@ -48,3 +50,11 @@ HRESULT GetFileIconImpl(LPCWSTR filePath, UINT size, HBITMAP* phBitmap)
     return hr;
 }
 
+HRESULT GetFileIconImpl(LPCWSTR filePath, UINT size, HBITMAP* phBitmap)
+{
+    if (!filePath || !phBitmap)
+        return E_INVALIDARG;
+
+    return RunCoalesced(CoalesceMode::Icon, filePath, size, size, phBitmap,
+        [filePath, size](HBITMAP* phResult) { return ExtractFileIcon(filePath, size, phResult); });
+}
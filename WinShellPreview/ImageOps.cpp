@@ -0,0 +1,494 @@
+#include "ImageOps.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGEOPS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const int WEIGHT_BITS = 14;
+    const int WEIGHT_ONE = 1 << WEIGHT_BITS;
+
+    // Contributions of source samples to one destination sample
+    struct Contribution
+    {
+        uint32_t first;
+        uint32_t count;
+        size_t weightOffset;
+    };
+
+    // Both arrays live in the caller's ScratchArena
+    struct ContributionTable
+    {
+        Contribution* entries;
+        int32_t* weights;
+    };
+
+    void AddContribution(ContributionTable* table, uint32_t index, uint32_t first, const double* raw, uint32_t count,
+                         size_t* weightCount)
+    {
+        Contribution& entry = table->entries[index];
+        entry.first = first;
+        entry.count = count;
+        entry.weightOffset = *weightCount;
+
+        double total = 0.0;
+        for (uint32_t k = 0; k < count; ++k)
+            total += raw[k];
+
+        int32_t* weights = table->weights + entry.weightOffset;
+        int32_t sum = 0;
+        uint32_t largest = 0;
+        for (uint32_t k = 0; k < count; ++k)
+        {
+            weights[k] = static_cast<int32_t>(std::lround(raw[k] / total * WEIGHT_ONE));
+            sum += weights[k];
+            if (raw[k] > raw[largest])
+                largest = k;
+        }
+        // Make weights sum exactly to WEIGHT_ONE so flat areas stay flat
+        weights[largest] += WEIGHT_ONE - sum;
+        *weightCount += count;
+    }
+
+    bool BuildContributions(uint32_t srcSize, uint32_t dstSize, ScratchArena& arena, ContributionTable* table)
+    {
+        double scale = static_cast<double>(srcSize) / dstSize;
+        // [left, right) spans `scale` source pixels, so it touches at most ceil(scale) + 1 of them;
+        // one more absorbs rounding in i * scale
+        size_t maxTaps = scale >= 1.0 ? static_cast<size_t>(std::ceil(scale)) + 2 : 2;
+        table->entries = arena.AllocateArray<Contribution>(dstSize);
+        table->weights = arena.AllocateArray<int32_t>(dstSize * maxTaps);
+        double* raw = arena.AllocateArray<double>(maxTaps);
+        if (!table->entries || !table->weights || !raw)
+            return false;
+
+        size_t weightCount = 0;
+        for (uint32_t i = 0; i < dstSize; ++i)
+        {
+            uint32_t count = 0;
+            if (scale >= 1.0)
+            {
+                // Area average: overlap of [left, right) with each source pixel
+                double left = i * scale;
+                double right = (i + 1) * scale;
+                uint32_t first = static_cast<uint32_t>(left);
+                uint32_t last = static_cast<uint32_t>(std::ceil(right));
+                if (last > srcSize)
+                    last = srcSize;
+                for (uint32_t j = first; j < last; ++j)
+                {
+                    double lo = left > j ? left : j;
+                    double hi = right < j + 1.0 ? right : j + 1.0;
+                    raw[count++] = hi > lo ? hi - lo : 0.0;
+                }
+                if (count == 0)
+                {
+                    first = srcSize - 1;
+                    raw[count++] = 1.0;
+                }
+                AddContribution(table, i, first, raw, count, &weightCount);
+            }
+            else
+            {
+                // Bilinear between the two nearest source pixels
+                double center = (i + 0.5) * scale - 0.5;
+                if (center < 0.0)
+                    center = 0.0;
+                uint32_t first = static_cast<uint32_t>(center);
+                double frac = center - first;
+                if (first + 1 >= srcSize)
+                {
+                    first = srcSize - 1;
+                    raw[count++] = 1.0;
+                }
+                else
+                {
+                    raw[count++] = 1.0 - frac;
+                    raw[count++] = frac;
+                }
+                AddContribution(table, i, first, raw, count, &weightCount);
+            }
+        }
+        return true;
+    }
+
+    inline uint8_t ClampToByte(int32_t acc)
+    {
+        int32_t v = (acc + (WEIGHT_ONE >> 1)) >> WEIGHT_BITS;
+        return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+    }
+
+#ifndef IMAGEOPS_SSE2
+    void ResampleRowScalar(const uint8_t* in, uint8_t* out, uint32_t dstWidth, const ContributionTable& table)
+    {
+        for (uint32_t x = 0; x < dstWidth; ++x)
+        {
+            const Contribution& c = table.entries[x];
+            const int32_t* w = &table.weights[c.weightOffset];
+            const uint8_t* p = in + static_cast<size_t>(c.first) * 4;
+            int32_t b = 0, g = 0, r = 0, a = 0;
+            for (uint32_t k = 0; k < c.count; ++k, p += 4)
+            {
+                b += p[0] * w[k];
+                g += p[1] * w[k];
+                r += p[2] * w[k];
+                a += p[3] * w[k];
+            }
+            out[x * 4 + 0] = ClampToByte(b);
+            out[x * 4 + 1] = ClampToByte(g);
+            out[x * 4 + 2] = ClampToByte(r);
+            out[x * 4 + 3] = ClampToByte(a);
+        }
+    }
+#else
+    // Same integer arithmetic as the scalar path (bit-exact), four channels per register.
+    // Two source pixels are interleaved per step so _mm_madd_epi16 applies both weights at once;
+    // weights are at most WEIGHT_ONE and never negative, so they fit in int16.
+    void ResampleRowSse2(const uint8_t* in, uint8_t* out, uint32_t dstWidth, const ContributionTable& table)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i half = _mm_set1_epi32(WEIGHT_ONE >> 1);
+
+        for (uint32_t x = 0; x < dstWidth; ++x)
+        {
+            const Contribution& c = table.entries[x];
+            const int32_t* w = &table.weights[c.weightOffset];
+            const uint8_t* p = in + static_cast<size_t>(c.first) * 4;
+            __m128i acc = zero;
+
+            uint32_t k = 0;
+            for (; k + 1 < c.count; k += 2, p += 8)
+            {
+                __m128i pixels = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), zero);
+                __m128i pairs = _mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 8));
+                __m128i weights = _mm_set1_epi32(static_cast<int32_t>((static_cast<uint32_t>(w[k + 1]) << 16) |
+                                                                      (static_cast<uint32_t>(w[k]) & 0xFFFF)));
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(pairs, weights));
+            }
+            if (k < c.count)
+            {
+                int32_t pixel;
+                memcpy(&pixel, p, 4);
+                __m128i single = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), zero), zero);
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(single, _mm_set1_epi32(w[k] & 0xFFFF)));
+            }
+
+            __m128i v = _mm_srai_epi32(_mm_add_epi32(acc, half), WEIGHT_BITS);
+            v = _mm_packus_epi16(_mm_packs_epi32(v, zero), zero);
+            int32_t result = _mm_cvtsi128_si32(v);
+            memcpy(out + x * 4, &result, 4);
+        }
+    }
+#endif
+
+    void ResampleRow(const uint8_t* in, uint8_t* out, uint32_t dstWidth, const ContributionTable& table)
+    {
+#ifdef IMAGEOPS_SSE2
+        ResampleRowSse2(in, out, dstWidth, table);
+#else
+        ResampleRowScalar(in, out, dstWidth, table);
+#endif
+    }
+
+    // Rounded x / 255 for x in [0, 255 * 255], the same formula in both composite paths
+    inline uint32_t Div255(uint32_t x)
+    {
+        uint32_t t = x + 128;
+        return (t + (t >> 8)) >> 8;
+    }
+
+    void CompositePixelScalar(uint8_t* p, bool premultiplied, const uint8_t background[3])
+    {
+        uint32_t a = p[3];
+        uint32_t inverse = 255 - a;
+        for (int c = 0; c < 3; ++c)
+        {
+            uint32_t v = premultiplied ? p[c] + Div255(background[c] * inverse)
+                                       : Div255(p[c] * a + background[c] * inverse);
+            p[c] = static_cast<uint8_t>(v > 255 ? 255 : v);
+        }
+        p[3] = 255;
+    }
+
+#ifdef IMAGEOPS_SSE2
+    inline __m128i Div255Epu16(__m128i x)
+    {
+        __m128i t = _mm_add_epi16(x, _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+
+    // Two pixels widened to 16-bit lanes
+    inline __m128i CompositeHalf(__m128i pixels, bool premultiplied, __m128i background)
+    {
+        const __m128i full = _mm_set1_epi16(255);
+        __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m128i inverse = _mm_sub_epi16(full, alpha);
+        __m128i under = _mm_mullo_epi16(background, inverse);
+        if (premultiplied)
+            return _mm_add_epi16(pixels, Div255Epu16(under));
+        return Div255Epu16(_mm_add_epi16(_mm_mullo_epi16(pixels, alpha), under));
+    }
+
+    // Four pixels per step
+    uint32_t CompositeRowSse2(uint8_t* row, uint32_t width, bool premultiplied, const uint8_t background[3])
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i opaque = _mm_set1_epi32(static_cast<int32_t>(0xFF000000u));
+        const __m128i bg = _mm_setr_epi16(background[0], background[1], background[2], 0,
+                                          background[0], background[1], background[2], 0);
+        uint32_t x = 0;
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i* p = reinterpret_cast<__m128i*>(row + x * 4);
+            __m128i pixels = _mm_loadu_si128(p);
+            __m128i lo = CompositeHalf(_mm_unpacklo_epi8(pixels, zero), premultiplied, bg);
+            __m128i hi = CompositeHalf(_mm_unpackhi_epi8(pixels, zero), premultiplied, bg);
+            _mm_storeu_si128(p, _mm_or_si128(_mm_packus_epi16(lo, hi), opaque));
+        }
+        return x;
+    }
+#endif
+
+    // Full 2x2 blocks of two source rows; returns the number of output pixels done
+    uint32_t HalveRowScalar(const uint8_t* row0, const uint8_t* row1, uint8_t* out, uint32_t start, uint32_t count)
+    {
+        for (uint32_t x = start; x < count; ++x)
+        {
+            const uint8_t* a = row0 + x * 8;
+            const uint8_t* b = row1 + x * 8;
+            for (int c = 0; c < 4; ++c)
+                out[x * 4 + c] = static_cast<uint8_t>((a[c] + a[c + 4] + b[c] + b[c + 4] + 2) >> 2);
+        }
+        return count;
+    }
+
+#ifdef IMAGEOPS_SSE2
+    // Four output pixels (eight source pixels per row) per step
+    uint32_t HalveRowSse2(const uint8_t* row0, const uint8_t* row1, uint8_t* out, uint32_t count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+        uint32_t x = 0;
+        for (; x + 4 <= count; x += 4)
+        {
+            __m128 a0 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8)));
+            __m128 a1 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8 + 16)));
+            __m128 b0 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8)));
+            __m128 b1 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8 + 16)));
+
+            // Even and odd source pixels side by side, then widened and summed
+            __m128i evenA = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)));
+            __m128i oddA = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)));
+            __m128i evenB = _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)));
+            __m128i oddB = _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)));
+
+            __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(evenA, zero), _mm_unpacklo_epi8(oddA, zero)),
+                                       _mm_add_epi16(_mm_unpacklo_epi8(evenB, zero), _mm_unpacklo_epi8(oddB, zero)));
+            __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(evenA, zero), _mm_unpackhi_epi8(oddA, zero)),
+                                       _mm_add_epi16(_mm_unpackhi_epi8(evenB, zero), _mm_unpackhi_epi8(oddB, zero)));
+            lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+            hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(lo, hi));
+        }
+        return x;
+    }
+#endif
+}
+
+bool PixelImage::Allocate(uint32_t w, uint32_t h)
+{
+    Reset();
+    if (w == 0 || h == 0)
+        return false;
+
+    size_t rowBytes = static_cast<size_t>(w) * 4;
+    if (!buffer.Allocate(rowBytes * h))
+        return false;
+
+    width = w;
+    height = h;
+    stride = rowBytes;
+    return true;
+}
+
+void PixelImage::Reset()
+{
+    buffer.Reset();
+    width = 0;
+    height = 0;
+    stride = 0;
+}
+
+bool CopyPixelImage(const PixelImage& src, PixelImage* dst)
+{
+    if (src.Empty() || !dst || !dst->Allocate(src.width, src.height))
+        return false;
+
+    dst->alpha = src.alpha;
+    for (uint32_t y = 0; y < src.height; ++y)
+        memcpy(dst->Row(y), src.Row(y), static_cast<size_t>(src.width) * 4);
+    return true;
+}
+
+bool ResizePixelImage(const PixelImage& src, uint32_t dstWidth, uint32_t dstHeight, PixelImage* dst)
+{
+    if (src.Empty() || !dst || dstWidth == 0 || dstHeight == 0 || dst == &src)
+        return false;
+
+    if (dstWidth == src.width && dstHeight == src.height)
+        return CopyPixelImage(src, dst);
+
+    // Weight tables and the accumulator row are per-call scratch; the arena's blocks come back
+    // from the thread's buffer pool on the next resize
+    ScratchArena scratch;
+    ContributionTable horizontal;
+    ContributionTable vertical;
+    if (!BuildContributions(src.width, dstWidth, scratch, &horizontal) ||
+        !BuildContributions(src.height, dstHeight, scratch, &vertical))
+        return false;
+
+    // Horizontal pass into a dstWidth x srcHeight intermediate
+    PixelImage temp;
+    if (!temp.Allocate(dstWidth, src.height))
+        return false;
+
+    for (uint32_t y = 0; y < src.height; ++y)
+        ResampleRow(src.Row(y), temp.Row(y), dstWidth, horizontal);
+
+    // Vertical pass, row-at-a-time accumulation keeps memory access sequential
+    if (!dst->Allocate(dstWidth, dstHeight))
+        return false;
+    dst->alpha = src.alpha;
+
+    size_t rowValues = static_cast<size_t>(dstWidth) * 4;
+    int32_t* acc = scratch.AllocateArray<int32_t>(rowValues);
+    if (!acc)
+        return false;
+    for (uint32_t y = 0; y < dstHeight; ++y)
+    {
+        const Contribution& c = vertical.entries[y];
+        const int32_t* w = &vertical.weights[c.weightOffset];
+        std::fill(acc, acc + rowValues, 0);
+        for (uint32_t k = 0; k < c.count; ++k)
+        {
+            const uint8_t* in = temp.Row(c.first + k);
+            int32_t weight = w[k];
+            for (size_t i = 0; i < rowValues; ++i)
+                acc[i] += in[i] * weight;
+        }
+        uint8_t* out = dst->Row(y);
+        for (size_t i = 0; i < rowValues; ++i)
+            out[i] = ClampToByte(acc[i]);
+    }
+    return true;
+}
+
+bool HalvePixelImage(const PixelImage& src, PixelImage* dst)
+{
+    if (src.Empty() || !dst || dst == &src)
+        return false;
+
+    uint32_t width = (src.width + 1) / 2;
+    uint32_t height = (src.height + 1) / 2;
+    if (!dst->Allocate(width, height))
+        return false;
+    dst->alpha = src.alpha;
+
+    uint32_t pairs = src.width / 2;     // Output pixels backed by a full 2-pixel span
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint8_t* row0 = src.Row(y * 2);
+        const uint8_t* row1 = src.Row((std::min)(y * 2 + 1, src.height - 1));
+        bool oddRow = y * 2 + 1 >= src.height;
+        uint8_t* out = dst->Row(y);
+
+        if (!oddRow)
+        {
+            uint32_t x = 0;
+#ifdef IMAGEOPS_SSE2
+            x = HalveRowSse2(row0, row1, out, pairs);
+#endif
+            HalveRowScalar(row0, row1, out, x, pairs);
+        }
+        else
+        {
+            // Last row of an odd height: average horizontally only
+            for (uint32_t x = 0; x < pairs; ++x)
+            {
+                for (int c = 0; c < 4; ++c)
+                    out[x * 4 + c] = static_cast<uint8_t>((row0[x * 8 + c] + row0[x * 8 + c + 4] + 1) >> 1);
+            }
+        }
+
+        if (pairs < width)
+        {
+            // Last column of an odd width
+            const uint8_t* a = row0 + pairs * 8;
+            const uint8_t* b = row1 + pairs * 8;
+            for (int c = 0; c < 4; ++c)
+                out[pairs * 4 + c] = static_cast<uint8_t>(oddRow ? a[c] : (a[c] + b[c] + 1) >> 1);
+        }
+    }
+    return true;
+}
+
+bool IsAlphaChannelEmpty(const PixelImage& image)
+{
+    for (uint32_t y = 0; y < image.height; ++y)
+    {
+        const uint8_t* row = image.Row(y);
+        for (uint32_t x = 0; x < image.width; ++x)
+        {
+            if (row[x * 4 + 3] != 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+void FillOpaqueAlpha(PixelImage* image)
+{
+    for (uint32_t y = 0; y < image->height; ++y)
+    {
+        uint8_t* row = image->Row(y);
+        for (uint32_t x = 0; x < image->width; ++x)
+            row[x * 4 + 3] = 255;
+    }
+}
+
+void CopyPixelRows(const uint8_t* src, ptrdiff_t srcStride, uint8_t* dst, size_t dstStride, uint32_t width, uint32_t height)
+{
+    size_t rowBytes = static_cast<size_t>(width) * 4;
+    for (uint32_t y = 0; y < height; ++y)
+        memcpy(dst + y * dstStride, src + static_cast<ptrdiff_t>(y) * srcStride, rowBytes);
+}
+
+void CompositeOverBackground(uint8_t* pixels, uint32_t width, uint32_t height, size_t stride, AlphaMode alpha,
+                             uint8_t red, uint8_t green, uint8_t blue)
+{
+    const uint8_t background[3] = { blue, green, red };
+    bool premultiplied = alpha == AlphaMode::Premultiplied;
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        uint8_t* row = pixels + y * stride;
+        if (alpha == AlphaMode::Ignore)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+                row[x * 4 + 3] = 255;
+            continue;
+        }
+
+        uint32_t x = 0;
+#ifdef IMAGEOPS_SSE2
+        x = CompositeRowSse2(row, width, premultiplied, background);
+#endif
+        for (; x < width; ++x)
+            CompositePixelScalar(row + x * 4, premultiplied, background);
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "BufferPool.h"
+#include <cstddef>
+#include <cstdint>
+
+// Portable 32bpp BGRA image held in a pooled buffer, plus the pixel operations shared by the
+// coalescing, caching and export paths. No Windows dependencies.
+
+enum class AlphaMode
+{
+    Ignore,         // Alpha channel carries no information (treat as opaque)
+    Straight,       // Non-premultiplied alpha
+    Premultiplied   // Color channels already multiplied by alpha
+};
+
+struct PixelImage
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t stride = 0;          // Bytes per row, always a multiple of 4
+    AlphaMode alpha = AlphaMode::Ignore;
+    PooledBuffer buffer;
+
+    bool Allocate(uint32_t w, uint32_t h);
+    void Reset();
+
+    bool Empty() const { return buffer.Empty(); }
+    uint8_t* Row(uint32_t y) { return buffer.Data() + y * stride; }
+    const uint8_t* Row(uint32_t y) const { return buffer.Data() + y * stride; }
+};
+
+// Copies pixels and format from src into dst
+bool CopyPixelImage(const PixelImage& src, PixelImage* dst);
+
+// Separable resampler: area averaging when shrinking, bilinear when enlarging. The horizontal
+// pass uses SSE2 where available and is bit-exact with the scalar path.
+// Returns false on invalid sizes or allocation failure.
+bool ResizePixelImage(const PixelImage& src, uint32_t dstWidth, uint32_t dstHeight, PixelImage* dst);
+
+// 2x box downsample to ceil(width / 2) x ceil(height / 2): each pixel is the rounded mean of a
+// 2x2 block, odd edges average the pixels that exist. SSE2 where available, bit-exact with the
+// scalar path. Correct for premultiplied and opaque images.
+bool HalvePixelImage(const PixelImage& src, PixelImage* dst);
+
+// Returns true if every pixel has alpha == 0 (typical for GDI device-dependent bitmaps)
+bool IsAlphaChannelEmpty(const PixelImage& image);
+
+// Sets alpha to 255 for every pixel
+void FillOpaqueAlpha(PixelImage* image);
+
+// Copies width x height BGRA pixels between row layouts. A negative srcStride walks the source
+// upwards, which turns a bottom-up DIB into top-down rows.
+void CopyPixelRows(const uint8_t* src, ptrdiff_t srcStride, uint8_t* dst, size_t dstStride, uint32_t width, uint32_t height);
+
+// Composites pixels over an opaque background color and leaves them opaque (alpha 255).
+// Premultiplied: c + bg * (255 - a) / 255, saturated; straight: (c * a + bg * (255 - a)) / 255.
+// SSE2 where available, bit-exact with the scalar path.
+void CompositeOverBackground(uint8_t* pixels, uint32_t width, uint32_t height, size_t stride, AlphaMode alpha,
+                             uint8_t red, uint8_t green, uint8_t blue);
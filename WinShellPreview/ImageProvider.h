@@ -0,0 +1,79 @@
+#pragma once
+#include "ProviderSelector.h"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Plugin interface for image extraction backends and the registry that runs them in the order
+// chosen by ProviderSelector. Image is the backend's output type: a GDI bitmap for the Shell
+// providers, PixelImage for portable decoders and test providers. No Windows dependencies.
+
+template <typename Image>
+class IImageProvider
+{
+public:
+    virtual ~IImageProvider() {}
+
+    virtual ProviderDescriptor Describe() const = 0;
+
+    // Status code, negative on failure (an HRESULT on Windows). On failure image is left empty.
+    virtual int32_t Provide(const ImageRequest& request, Image* image) = 0;
+};
+
+struct ProviderRunResult
+{
+    int32_t status = -1;        // Last provider's status, -1 if no provider was eligible
+    int provider = -1;          // Id of the provider that produced the image
+    uint32_t attempts = 0;
+};
+
+template <typename Image>
+class ProviderRegistry
+{
+public:
+    typedef std::shared_ptr<IImageProvider<Image>> ProviderPtr;
+
+    size_t Register(const ProviderPtr& provider)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_providers.push_back(provider);
+        return m_selector.Register(provider->Describe());
+    }
+
+    ProviderSelector& Selector() { return m_selector; }
+    const ProviderSelector& Selector() const { return m_selector; }
+
+    // Tries eligible providers cheapest-first until one succeeds, recording each outcome
+    ProviderRunResult Run(const ImageRequest& request, Image* image)
+    {
+        std::vector<ProviderPtr> providers;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            providers = m_providers;
+        }
+
+        ProviderRunResult result;
+        for (size_t id : m_selector.Order(request))
+        {
+            auto start = std::chrono::steady_clock::now();
+            int32_t status = providers[id]->Provide(request, image);
+            double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            m_selector.Record(id, request.fileType, status >= 0, elapsedMs);
+            ++result.attempts;
+            result.status = status;
+            if (status >= 0)
+            {
+                result.provider = static_cast<int>(id);
+                break;
+            }
+        }
+        return result;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<ProviderPtr> m_providers;
+    ProviderSelector m_selector;
+};
@@ -0,0 +1,331 @@
+#include "ImageSignature.h"
+#include "ColorQuantizer.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    const uint32_t PHASH_GRID = 32;     // Luma image the DCT runs on
+    const uint32_t PHASH_BLOCK = 8;     // Low-frequency coefficients kept
+    const uint32_t DHASH_WIDTH = 9;
+    const uint32_t DHASH_HEIGHT = 8;
+    const uint32_t HISTOGRAM_BITS = 4;  // Per channel: 4096 bins for median cut
+    const uint8_t OPAQUE_THRESHOLD = 128;
+
+    // Accumulated by the single pixel pass
+    struct Accumulator
+    {
+        std::vector<uint64_t> phash;    // Luma sums per 32x32 cell
+        std::vector<uint32_t> phashCount;
+        std::vector<uint64_t> dhash;    // Luma sums per 9x8 cell
+        std::vector<uint32_t> dhashCount;
+        ColorHistogram histogram{HISTOGRAM_BITS};  // Opaque pixels only
+        uint64_t sumR = 0, sumG = 0, sumB = 0;
+    };
+
+    // Consecutive opaque pixels falling into the same histogram bin
+    struct ColorRun
+    {
+        uint32_t bin = UINT32_MAX;
+        uint32_t count = 0;
+        uint64_t r = 0, g = 0, b = 0;
+    };
+
+    inline void FlushRun(const ColorRun& run, Accumulator* acc)
+    {
+        if (run.count == 0)
+            return;
+        acc->histogram.Add(run.bin, run.count, run.r, run.g, run.b);
+    }
+
+    inline uint32_t Luma(uint32_t r, uint32_t g, uint32_t b)
+    {
+        // BT.601 weights in 8-bit fixed point
+        return (r * 77 + g * 150 + b * 29) >> 8;
+    }
+
+    void AccumulatePixels(const PixelImage& image, Accumulator* acc)
+    {
+        uint32_t width = image.width;
+        uint32_t height = image.height;
+
+        // Column -> cell lookups keep the inner loop free of divisions
+        std::vector<uint32_t> phashColumn(width);
+        std::vector<uint32_t> dhashColumn(width);
+        // Cell sizes in pixels; cell counts are their products, kept out of the inner loop
+        uint32_t phashColumns[PHASH_GRID] = {};
+        uint32_t dhashColumns[DHASH_WIDTH] = {};
+        uint32_t phashRows[PHASH_GRID] = {};
+        uint32_t dhashRows[DHASH_HEIGHT] = {};
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            phashColumn[x] = static_cast<uint32_t>(static_cast<uint64_t>(x) * PHASH_GRID / width);
+            dhashColumn[x] = static_cast<uint32_t>(static_cast<uint64_t>(x) * DHASH_WIDTH / width);
+            phashColumns[phashColumn[x]]++;
+            dhashColumns[dhashColumn[x]]++;
+        }
+
+        bool hasAlpha = image.alpha != AlphaMode::Ignore;
+        bool premultiplied = image.alpha == AlphaMode::Premultiplied;
+        ColorRun run;
+
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const uint8_t* row = image.Row(y);
+            uint32_t phashCellRow = static_cast<uint32_t>(static_cast<uint64_t>(y) * PHASH_GRID / height);
+            uint32_t dhashCellRow = static_cast<uint32_t>(static_cast<uint64_t>(y) * DHASH_HEIGHT / height);
+            uint64_t* phashRow = &acc->phash[phashCellRow * PHASH_GRID];
+            uint64_t* dhashRow = &acc->dhash[dhashCellRow * DHASH_WIDTH];
+            phashRows[phashCellRow]++;
+            dhashRows[dhashCellRow]++;
+
+            uint32_t phashCell = 0, dhashCell = 0;
+            uint64_t phashRun = 0, dhashRun = 0;
+            uint64_t rowR = 0, rowG = 0, rowB = 0;
+
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                const uint8_t* p = row + x * 4;
+                uint32_t b = p[0], g = p[1], r = p[2], a = hasAlpha ? p[3] : 255;
+
+                // Straight color, used for the palette
+                uint32_t sr = r, sg = g, sb = b;
+                if (premultiplied && a != 0 && a != 255)
+                {
+                    sr = std::min(255u, (r * 255 + a / 2) / a);
+                    sg = std::min(255u, (g * 255 + a / 2) / a);
+                    sb = std::min(255u, (b * 255 + a / 2) / a);
+                }
+
+                // Composited on white, used for hashes and the average
+                uint32_t cr = r, cg = g, cb = b;
+                if (a != 255)
+                {
+                    uint32_t white = 255 - a;
+                    if (premultiplied)
+                    {
+                        cr = std::min(255u, r + white);
+                        cg = std::min(255u, g + white);
+                        cb = std::min(255u, b + white);
+                    }
+                    else
+                    {
+                        cr = (r * a + 255 * white + 127) / 255;
+                        cg = (g * a + 255 * white + 127) / 255;
+                        cb = (b * a + 255 * white + 127) / 255;
+                    }
+                }
+
+                // Neighbouring pixels usually share a cell and a color bin. Summing runs in registers
+                // and flushing on change avoids a read-modify-write chain on the same memory per pixel.
+                uint32_t luma = Luma(cr, cg, cb);
+                if (phashColumn[x] != phashCell)
+                {
+                    phashRow[phashCell] += phashRun;
+                    phashCell = phashColumn[x];
+                    phashRun = 0;
+                }
+                phashRun += luma;
+                if (dhashColumn[x] != dhashCell)
+                {
+                    dhashRow[dhashCell] += dhashRun;
+                    dhashCell = dhashColumn[x];
+                    dhashRun = 0;
+                }
+                dhashRun += luma;
+                rowR += cr;
+                rowG += cg;
+                rowB += cb;
+
+                if (a >= OPAQUE_THRESHOLD)
+                {
+                    uint32_t bin = acc->histogram.BinOf(sr, sg, sb);
+                    if (bin != run.bin)
+                    {
+                        FlushRun(run, acc);
+                        run = ColorRun();
+                        run.bin = bin;
+                    }
+                    run.count++;
+                    run.r += sr;
+                    run.g += sg;
+                    run.b += sb;
+                }
+            }
+
+            phashRow[phashCell] += phashRun;
+            dhashRow[dhashCell] += dhashRun;
+            acc->sumR += rowR;
+            acc->sumG += rowG;
+            acc->sumB += rowB;
+        }
+        FlushRun(run, acc);
+
+        for (uint32_t cy = 0; cy < PHASH_GRID; ++cy)
+        {
+            for (uint32_t cx = 0; cx < PHASH_GRID; ++cx)
+                acc->phashCount[cy * PHASH_GRID + cx] = phashRows[cy] * phashColumns[cx];
+        }
+        for (uint32_t cy = 0; cy < DHASH_HEIGHT; ++cy)
+        {
+            for (uint32_t cx = 0; cx < DHASH_WIDTH; ++cx)
+                acc->dhashCount[cy * DHASH_WIDTH + cx] = dhashRows[cy] * dhashColumns[cx];
+        }
+    }
+
+    // cos((2x + 1) u pi / 2N) for the low-frequency rows only
+    const float* DctTable()
+    {
+        static const std::vector<float> table = []()
+        {
+            std::vector<float> values(PHASH_BLOCK * PHASH_GRID);
+            const double pi = 3.14159265358979323846;
+            for (uint32_t u = 0; u < PHASH_BLOCK; ++u)
+            {
+                for (uint32_t x = 0; x < PHASH_GRID; ++x)
+                    values[u * PHASH_GRID + x] = static_cast<float>(std::cos((2.0 * x + 1.0) * u * pi / (2.0 * PHASH_GRID)));
+            }
+            return values;
+        }();
+        return table.data();
+    }
+
+    uint64_t PerceptualHash(const Accumulator& acc)
+    {
+        float grid[PHASH_GRID * PHASH_GRID];
+        for (uint32_t i = 0; i < PHASH_GRID * PHASH_GRID; ++i)
+            grid[i] = acc.phashCount[i] ? static_cast<float>(acc.phash[i]) / acc.phashCount[i] : 0.0f;
+
+        // Separable DCT-II, computing only the 8 lowest frequencies in each direction.
+        // Both loops run over contiguous arrays so the compiler can vectorize them.
+        const float* table = DctTable();
+        float rows[PHASH_GRID * PHASH_BLOCK];
+        for (uint32_t y = 0; y < PHASH_GRID; ++y)
+        {
+            const float* line = grid + y * PHASH_GRID;
+            for (uint32_t u = 0; u < PHASH_BLOCK; ++u)
+            {
+                const float* basis = table + u * PHASH_GRID;
+                float sum = 0.0f;
+                for (uint32_t x = 0; x < PHASH_GRID; ++x)
+                    sum += line[x] * basis[x];
+                rows[y * PHASH_BLOCK + u] = sum;
+            }
+        }
+
+        float block[PHASH_BLOCK * PHASH_BLOCK] = {};
+        for (uint32_t v = 0; v < PHASH_BLOCK; ++v)
+        {
+            const float* basis = table + v * PHASH_GRID;
+            float* out = block + v * PHASH_BLOCK;
+            for (uint32_t y = 0; y < PHASH_GRID; ++y)
+            {
+                const float* in = rows + y * PHASH_BLOCK;
+                float weight = basis[y];
+                for (uint32_t u = 0; u < PHASH_BLOCK; ++u)
+                    out[u] += in[u] * weight;
+            }
+        }
+
+        float sorted[PHASH_BLOCK * PHASH_BLOCK];
+        std::copy(block, block + PHASH_BLOCK * PHASH_BLOCK, sorted);
+        const size_t half = PHASH_BLOCK * PHASH_BLOCK / 2;
+        std::nth_element(sorted, sorted + half, sorted + PHASH_BLOCK * PHASH_BLOCK);
+        float upper = sorted[half];
+        float lower = *std::max_element(sorted, sorted + half);
+        float median = (lower + upper) * 0.5f;
+
+        uint64_t hash = 0;
+        for (uint32_t i = 0; i < PHASH_BLOCK * PHASH_BLOCK; ++i)
+        {
+            if (block[i] > median)
+                hash |= 1ull << i;
+        }
+        return hash;
+    }
+
+    uint64_t DifferenceHash(const Accumulator& acc)
+    {
+        uint64_t hash = 0;
+        uint32_t bit = 0;
+        for (uint32_t y = 0; y < DHASH_HEIGHT; ++y)
+        {
+            for (uint32_t x = 0; x + 1 < DHASH_WIDTH; ++x, ++bit)
+            {
+                size_t left = y * DHASH_WIDTH + x;
+                // Compare means without division: l / nl < r / nr
+                uint64_t l = acc.dhash[left] * acc.dhashCount[left + 1];
+                uint64_t r = acc.dhash[left + 1] * acc.dhashCount[left];
+                if (r > l)
+                    hash |= 1ull << bit;
+            }
+        }
+        return hash;
+    }
+
+    void FillPalette(const Accumulator& acc, ImageSignature* signature)
+    {
+        std::vector<QuantizedColor> colors = MedianCut(acc.histogram, ImageSignature::MAX_PALETTE);
+        uint64_t total = acc.histogram.Total();
+
+        signature->paletteCount = static_cast<uint32_t>(colors.size());
+        for (size_t i = 0; i < colors.size(); ++i)
+        {
+            PaletteColor& color = signature->palette[i];
+            color.r = colors[i].r;
+            color.g = colors[i].g;
+            color.b = colors[i].b;
+            color.share = static_cast<uint32_t>((colors[i].count * 65536 + total / 2) / total);
+        }
+    }
+}
+
+bool ComputeImageSignature(const PixelImage& image, ImageSignature* signature)
+{
+    if (image.Empty() || !signature)
+        return false;
+
+    *signature = ImageSignature();
+
+    // Every hash cell needs at least one source pixel
+    const PixelImage* source = &image;
+    PixelImage enlarged;
+    if (image.width < PHASH_GRID || image.height < PHASH_GRID)
+    {
+        if (!ResizePixelImage(image, std::max(image.width, PHASH_GRID), std::max(image.height, PHASH_GRID), &enlarged))
+            return false;
+        source = &enlarged;
+    }
+
+    Accumulator acc;
+    acc.phash.assign(PHASH_GRID * PHASH_GRID, 0);
+    acc.phashCount.assign(PHASH_GRID * PHASH_GRID, 0);
+    acc.dhash.assign(DHASH_WIDTH * DHASH_HEIGHT, 0);
+    acc.dhashCount.assign(DHASH_WIDTH * DHASH_HEIGHT, 0);
+
+    AccumulatePixels(*source, &acc);
+
+    signature->perceptualHash = PerceptualHash(acc);
+    signature->differenceHash = DifferenceHash(acc);
+
+    uint64_t pixels = static_cast<uint64_t>(source->width) * source->height;
+    signature->averageR = static_cast<uint8_t>((acc.sumR + pixels / 2) / pixels);
+    signature->averageG = static_cast<uint8_t>((acc.sumG + pixels / 2) / pixels);
+    signature->averageB = static_cast<uint8_t>((acc.sumB + pixels / 2) / pixels);
+
+    FillPalette(acc, signature);
+    return true;
+}
+
+int HammingDistance(uint64_t a, uint64_t b)
+{
+    uint64_t diff = a ^ b;
+    int count = 0;
+    while (diff)
+    {
+        diff &= diff - 1;
+        ++count;
+    }
+    return count;
+}
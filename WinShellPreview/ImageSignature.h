@@ -0,0 +1,34 @@
+#pragma once
+#include "ImageOps.h"
+#include <cstdint>
+
+// Perceptual signatures of an image for near-duplicate detection and color placeholders,
+// all computed from one pass over the pixels. No Windows dependencies.
+
+struct PaletteColor
+{
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+    uint32_t share = 0;     // Fraction of the opaque pixels, in 1/65536 units
+};
+
+struct ImageSignature
+{
+    static const uint32_t MAX_PALETTE = 8;
+
+    uint64_t perceptualHash = 0;    // pHash: low 8x8 DCT coefficients of a 32x32 luma image vs. their median
+    uint64_t differenceHash = 0;    // dHash: horizontal gradients of a 9x8 luma image
+    uint8_t averageR = 0;           // Mean color composited on white
+    uint8_t averageG = 0;
+    uint8_t averageB = 0;
+    uint32_t paletteCount = 0;      // 0 when the image is fully transparent
+    PaletteColor palette[MAX_PALETTE];  // Median-cut colors, most common first
+};
+
+// Returns false for an empty image or on allocation failure.
+// Transparent pixels are composited on white for the hashes and skipped for the palette.
+bool ComputeImageSignature(const PixelImage& image, ImageSignature* signature);
+
+// Number of differing bits; 0-10 for perceptually similar images with 64-bit hashes
+int HammingDistance(uint64_t a, uint64_t b);
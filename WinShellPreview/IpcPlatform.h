@@ -0,0 +1,110 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Cross-process primitives behind one interface: named shared memory, a named counting signal,
+// child processes and read-only views of files. Windows file mappings, semaphores and
+// CreateProcess (IpcWin.cpp); POSIX shm_open, mmap, sem_open and posix_spawn on Linux (IpcPosix.cpp). Names are short ASCII
+// identifiers without separators; each backend adds its own namespace prefix.
+// No Windows dependencies in this header.
+
+class SharedMemory
+{
+public:
+    ~SharedMemory();
+
+    // Creates a zero-filled region, replacing a stale one of the same name. The creator
+    // removes the name when the object is destroyed.
+    static std::unique_ptr<SharedMemory> Create(const std::string& name, size_t size);
+    // Maps an existing region in full
+    static std::unique_ptr<SharedMemory> Open(const std::string& name);
+
+    uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+    SharedMemory() : m_data(nullptr), m_size(0), m_handle(0), m_owner(false) {}
+
+    std::string m_name;
+    uint8_t* m_data;
+    size_t m_size;
+    intptr_t m_handle;      // Mapping handle (Windows) or unused
+    bool m_owner;
+};
+
+// Read-only mapping of a whole file. Others can still read the file while it is mapped, but on
+// Windows it cannot be replaced until the mapping is destroyed.
+class MappedFile
+{
+public:
+    ~MappedFile();
+
+    // UTF-8 path. nullptr if the file is missing, empty or cannot be mapped.
+    static std::unique_ptr<MappedFile> Open(const std::string& path);
+
+    const uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+    MappedFile() : m_data(nullptr), m_size(0), m_handle(0) {}
+
+    const uint8_t* m_data;
+    size_t m_size;
+    intptr_t m_handle;      // Mapping handle (Windows) or unused
+};
+
+// Counting semaphore visible to other processes. Notify adds one; Wait takes one.
+class IpcSignal
+{
+public:
+    ~IpcSignal();
+
+    static std::unique_ptr<IpcSignal> Create(const std::string& name);
+    static std::unique_ptr<IpcSignal> Open(const std::string& name);
+
+    void Notify();
+    // Returns false on timeout
+    bool Wait(uint32_t timeoutMs);
+
+private:
+    IpcSignal() : m_handle(0), m_owner(false) {}
+
+    std::string m_name;
+    intptr_t m_handle;      // HANDLE (Windows) or sem_t* (POSIX)
+    bool m_owner;
+};
+
+class ChildProcess
+{
+public:
+    ChildProcess() : m_handle(0), m_id(0), m_exited(false), m_exitCode(0) {}
+    ~ChildProcess();
+
+    ChildProcess(const ChildProcess&) = delete;
+    ChildProcess& operator=(const ChildProcess&) = delete;
+
+    // UTF-8 executable path and arguments. On Windows an argument that already contains
+    // quotes is passed through verbatim.
+    bool Start(const std::string& executable, const std::vector<std::string>& arguments);
+
+    // Reaps the process if it has ended
+    bool IsRunning();
+    // Forced termination; waits until the process is gone
+    void Kill();
+
+    uint32_t Id() const { return m_id; }
+    // Valid once IsRunning returned false; negative for death by signal on POSIX
+    int ExitCode() const { return m_exitCode; }
+
+private:
+    intptr_t m_handle;      // Process handle (Windows) or unused
+    uint32_t m_id;
+    bool m_exited;
+    int m_exitCode;
+};
+
+uint32_t CurrentProcessId();
+bool IsProcessAlive(uint32_t processId);
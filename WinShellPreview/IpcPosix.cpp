@@ -0,0 +1,244 @@
+// POSIX backend for IpcPlatform. Built on Linux only; Windows uses IpcWin.cpp.
+#if defined(__linux__)
+
+#include "IpcPlatform.h"
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <semaphore.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace
+{
+    std::string ObjectName(const std::string& name)
+    {
+        return "/" + name;
+    }
+}
+
+SharedMemory::~SharedMemory()
+{
+    if (m_data)
+        munmap(m_data, m_size);
+    if (m_owner)
+        shm_unlink(ObjectName(m_name).c_str());
+}
+
+std::unique_ptr<SharedMemory> SharedMemory::Create(const std::string& name, size_t size)
+{
+    std::string objectName = ObjectName(name);
+    shm_unlink(objectName.c_str());
+
+    int fd = shm_open(objectName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+        return nullptr;
+
+    std::unique_ptr<SharedMemory> region(new SharedMemory());
+    region->m_name = name;
+    region->m_owner = true;
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        close(fd);
+        return nullptr;     // Destructor unlinks the name
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    region->m_data = static_cast<uint8_t*>(data);
+    region->m_size = size;
+    return region;
+}
+
+std::unique_ptr<SharedMemory> SharedMemory::Open(const std::string& name)
+{
+    int fd = shm_open(ObjectName(name).c_str(), O_RDWR, 0);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    std::unique_ptr<SharedMemory> region(new SharedMemory());
+    region->m_name = name;
+    region->m_data = static_cast<uint8_t*>(data);
+    region->m_size = size;
+    return region;
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+}
+
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    file->m_data = static_cast<const uint8_t*>(data);
+    file->m_size = size;
+    return file;
+}
+
+IpcSignal::~IpcSignal()
+{
+    if (m_handle)
+        sem_close(reinterpret_cast<sem_t*>(m_handle));
+    if (m_owner)
+        sem_unlink(ObjectName(m_name).c_str());
+}
+
+std::unique_ptr<IpcSignal> IpcSignal::Create(const std::string& name)
+{
+    std::string objectName = ObjectName(name);
+    sem_unlink(objectName.c_str());
+
+    sem_t* semaphore = sem_open(objectName.c_str(), O_CREAT | O_EXCL, 0600, 0);
+    if (semaphore == SEM_FAILED)
+        return nullptr;
+
+    std::unique_ptr<IpcSignal> signal(new IpcSignal());
+    signal->m_name = name;
+    signal->m_handle = reinterpret_cast<intptr_t>(semaphore);
+    signal->m_owner = true;
+    return signal;
+}
+
+std::unique_ptr<IpcSignal> IpcSignal::Open(const std::string& name)
+{
+    sem_t* semaphore = sem_open(ObjectName(name).c_str(), 0);
+    if (semaphore == SEM_FAILED)
+        return nullptr;
+
+    std::unique_ptr<IpcSignal> signal(new IpcSignal());
+    signal->m_name = name;
+    signal->m_handle = reinterpret_cast<intptr_t>(semaphore);
+    return signal;
+}
+
+void IpcSignal::Notify()
+{
+    sem_post(reinterpret_cast<sem_t*>(m_handle));
+}
+
+bool IpcSignal::Wait(uint32_t timeoutMs)
+{
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += static_cast<long>(timeoutMs % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    sem_t* semaphore = reinterpret_cast<sem_t*>(m_handle);
+    for (;;)
+    {
+        if (sem_timedwait(semaphore, &deadline) == 0)
+            return true;
+        if (errno != EINTR)
+            return false;
+    }
+}
+
+ChildProcess::~ChildProcess()
+{
+    if (m_id && !m_exited)
+        Kill();
+}
+
+bool ChildProcess::Start(const std::string& executable, const std::vector<std::string>& arguments)
+{
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(executable.c_str()));
+    for (const std::string& argument : arguments)
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    argv.push_back(nullptr);
+
+    pid_t pid = 0;
+    if (posix_spawn(&pid, executable.c_str(), nullptr, nullptr, argv.data(), environ) != 0)
+        return false;
+
+    m_id = static_cast<uint32_t>(pid);
+    m_exited = false;
+    m_exitCode = 0;
+    return true;
+}
+
+bool ChildProcess::IsRunning()
+{
+    if (!m_id || m_exited)
+        return false;
+
+    int status = 0;
+    pid_t result = waitpid(static_cast<pid_t>(m_id), &status, WNOHANG);
+    if (result == 0)
+        return true;
+
+    m_exited = true;
+    if (result > 0)
+        m_exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -WTERMSIG(status);
+    return false;
+}
+
+void ChildProcess::Kill()
+{
+    if (!m_id || m_exited)
+        return;
+
+    kill(static_cast<pid_t>(m_id), SIGKILL);
+    int status = 0;
+    if (waitpid(static_cast<pid_t>(m_id), &status, 0) > 0)
+        m_exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -WTERMSIG(status);
+    m_exited = true;
+}
+
+uint32_t CurrentProcessId()
+{
+    return static_cast<uint32_t>(getpid());
+}
+
+bool IsProcessAlive(uint32_t processId)
+{
+    return kill(static_cast<pid_t>(processId), 0) == 0 || errno == EPERM;
+}
+
+#endif
@@ -0,0 +1,279 @@
+#include "pch.h"
+#include "IpcPlatform.h"
+#include "TextUtils.h"
+
+// Win32 backend for IpcPlatform. Objects live in the session's Local\ namespace. Child
+// processes are assigned to a job object that kills them when this process goes away.
+
+namespace
+{
+    std::wstring ObjectName(const std::string& name)
+    {
+        return L"Local\\" + Utf8ToWide(name);
+    }
+
+    // Closed only when the process exits, which is what takes the workers down with it
+    HANDLE GetKillOnCloseJob()
+    {
+        static HANDLE job = []() -> HANDLE
+        {
+            HANDLE handle = CreateJobObjectW(nullptr, nullptr);
+            if (handle)
+            {
+                JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+                limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+                SetInformationJobObject(handle, JobObjectExtendedLimitInformation, &limits, sizeof(limits));
+            }
+            return handle;
+        }();
+        return job;
+    }
+
+    // Quoting per the CommandLineToArgvW rules for the common cases (no trailing backslashes)
+    void AppendArgument(std::wstring* commandLine, const std::wstring& argument)
+    {
+        if (!commandLine->empty())
+            commandLine->push_back(L' ');
+        bool quote = argument.find_first_of(L" \t") != std::wstring::npos && argument.find(L'"') == std::wstring::npos;
+        if (quote)
+            commandLine->push_back(L'"');
+        commandLine->append(argument);
+        if (quote)
+            commandLine->push_back(L'"');
+    }
+}
+
+SharedMemory::~SharedMemory()
+{
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_handle)
+        CloseHandle(reinterpret_cast<HANDLE>(m_handle));
+}
+
+std::unique_ptr<SharedMemory> SharedMemory::Create(const std::string& name, size_t size)
+{
+    ULARGE_INTEGER bytes;
+    bytes.QuadPart = size;
+    HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, bytes.HighPart, bytes.LowPart,
+                                        ObjectName(name).c_str());
+    if (!mapping)
+        return nullptr;
+    if (GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        // Still held by a dead session's process; the caller picks another name
+        CloseHandle(mapping);
+        return nullptr;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        return nullptr;
+    }
+
+    std::unique_ptr<SharedMemory> region(new SharedMemory());
+    region->m_name = name;
+    region->m_handle = reinterpret_cast<intptr_t>(mapping);
+    region->m_data = static_cast<uint8_t*>(data);
+    region->m_size = size;
+    region->m_owner = true;     // Page-file mappings vanish with their last handle
+    return region;
+}
+
+std::unique_ptr<SharedMemory> SharedMemory::Open(const std::string& name)
+{
+    HANDLE mapping = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, ObjectName(name).c_str());
+    if (!mapping)
+        return nullptr;
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info = {};
+    if (!data || VirtualQuery(data, &info, sizeof(info)) == 0)
+    {
+        if (data)
+            UnmapViewOfFile(data);
+        CloseHandle(mapping);
+        return nullptr;
+    }
+
+    std::unique_ptr<SharedMemory> region(new SharedMemory());
+    region->m_name = name;
+    region->m_handle = reinterpret_cast<intptr_t>(mapping);
+    region->m_data = static_cast<uint8_t*>(data);
+    region->m_size = info.RegionSize;
+    return region;
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_handle)
+        CloseHandle(reinterpret_cast<HANDLE>(m_handle));
+}
+
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string& path)
+{
+    HANDLE file = CreateFileW(Utf8ToWide(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0 || static_cast<ULONGLONG>(size.QuadPart) > SIZE_MAX)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);      // The mapping keeps the file open
+    if (!mapping)
+        return nullptr;
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        return nullptr;
+    }
+
+    std::unique_ptr<MappedFile> mapped(new MappedFile());
+    mapped->m_handle = reinterpret_cast<intptr_t>(mapping);
+    mapped->m_data = static_cast<const uint8_t*>(data);
+    mapped->m_size = static_cast<size_t>(size.QuadPart);
+    return mapped;
+}
+
+IpcSignal::~IpcSignal()
+{
+    if (m_handle)
+        CloseHandle(reinterpret_cast<HANDLE>(m_handle));
+}
+
+std::unique_ptr<IpcSignal> IpcSignal::Create(const std::string& name)
+{
+    HANDLE semaphore = CreateSemaphoreW(nullptr, 0, LONG_MAX, ObjectName(name).c_str());
+    if (!semaphore)
+        return nullptr;
+    if (GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        CloseHandle(semaphore);
+        return nullptr;
+    }
+
+    std::unique_ptr<IpcSignal> signal(new IpcSignal());
+    signal->m_name = name;
+    signal->m_handle = reinterpret_cast<intptr_t>(semaphore);
+    signal->m_owner = true;
+    return signal;
+}
+
+std::unique_ptr<IpcSignal> IpcSignal::Open(const std::string& name)
+{
+    HANDLE semaphore = OpenSemaphoreW(SEMAPHORE_MODIFY_STATE | SYNCHRONIZE, FALSE, ObjectName(name).c_str());
+    if (!semaphore)
+        return nullptr;
+
+    std::unique_ptr<IpcSignal> signal(new IpcSignal());
+    signal->m_name = name;
+    signal->m_handle = reinterpret_cast<intptr_t>(semaphore);
+    return signal;
+}
+
+void IpcSignal::Notify()
+{
+    ReleaseSemaphore(reinterpret_cast<HANDLE>(m_handle), 1, nullptr);
+}
+
+bool IpcSignal::Wait(uint32_t timeoutMs)
+{
+    return WaitForSingleObject(reinterpret_cast<HANDLE>(m_handle), timeoutMs) == WAIT_OBJECT_0;
+}
+
+ChildProcess::~ChildProcess()
+{
+    if (m_handle)
+    {
+        if (!m_exited)
+            Kill();
+        CloseHandle(reinterpret_cast<HANDLE>(m_handle));
+    }
+}
+
+bool ChildProcess::Start(const std::string& executable, const std::vector<std::string>& arguments)
+{
+    std::wstring application = Utf8ToWide(executable);
+    std::wstring commandLine;
+    AppendArgument(&commandLine, application);
+    for (const std::string& argument : arguments)
+        AppendArgument(&commandLine, Utf8ToWide(argument));
+
+    STARTUPINFOW startup = { sizeof(startup) };
+    PROCESS_INFORMATION info = {};
+    // Suspended until it is in the job, so it cannot outlive us even if we crash right away
+    if (!CreateProcessW(application.c_str(), &commandLine[0], nullptr, nullptr, FALSE,
+                        CREATE_NO_WINDOW | CREATE_SUSPENDED, nullptr, nullptr, &startup, &info))
+        return false;
+
+    HANDLE job = GetKillOnCloseJob();
+    if (job)
+        AssignProcessToJobObject(job, info.hProcess);
+    ResumeThread(info.hThread);
+    CloseHandle(info.hThread);
+
+    if (m_handle)
+        CloseHandle(reinterpret_cast<HANDLE>(m_handle));
+    m_handle = reinterpret_cast<intptr_t>(info.hProcess);
+    m_id = info.dwProcessId;
+    m_exited = false;
+    m_exitCode = 0;
+    return true;
+}
+
+bool ChildProcess::IsRunning()
+{
+    if (!m_handle || m_exited)
+        return false;
+
+    HANDLE process = reinterpret_cast<HANDLE>(m_handle);
+    if (WaitForSingleObject(process, 0) == WAIT_TIMEOUT)
+        return true;
+
+    DWORD code = 0;
+    GetExitCodeProcess(process, &code);
+    m_exitCode = static_cast<int>(code);
+    m_exited = true;
+    return false;
+}
+
+void ChildProcess::Kill()
+{
+    if (!m_handle || m_exited)
+        return;
+
+    HANDLE process = reinterpret_cast<HANDLE>(m_handle);
+    TerminateProcess(process, ERROR_PROCESS_ABORTED);
+    WaitForSingleObject(process, INFINITE);
+    DWORD code = 0;
+    GetExitCodeProcess(process, &code);
+    m_exitCode = static_cast<int>(code);
+    m_exited = true;
+}
+
+uint32_t CurrentProcessId()
+{
+    return GetCurrentProcessId();
+}
+
+bool IsProcessAlive(uint32_t processId)
+{
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, processId);
+    if (!process)
+        return GetLastError() == ERROR_ACCESS_DENIED;
+    bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+    CloseHandle(process);
+    return alive;
+}
@@ -0,0 +1,244 @@
+#include "pch.h"
+#include "IsolationImpl.h"
+#include "BitmapUtils.h"
+#include "ThumbnailImpl.h"
+#include "PreviewImpl.h"
+#include "ProviderSelector.h"
+#include "TextUtils.h"
+#include "WorkerPool.h"
+#include <atomic>
+#include <cwctype>
+#include <mutex>
+
+namespace
+{
+    const UINT DEFAULT_WORKER_COUNT = 2;
+    const UINT DEFAULT_TIMEOUT_MS = 15000;
+    const UINT DEFAULT_QUARANTINE_FAILURES = 3;
+    const UINT DEFAULT_QUARANTINE_MS = 10 * 60 * 1000;
+    const UINT DEFAULT_MAX_IMAGE_BYTES = 32 * 1024 * 1024;
+
+    std::atomic<bool> g_enabled{false};
+    std::atomic<UINT> g_timeoutMs{DEFAULT_TIMEOUT_MS};
+    std::mutex g_configMutex;   // Serializes Enable/Disable
+
+    // Leaked on purpose: stopping workers from DllMain would wait under the loader lock
+    WorkerPool& Pool()
+    {
+        static WorkerPool* pool = new WorkerPool();
+        return *pool;
+    }
+
+    std::wstring ModulePath()
+    {
+        HMODULE module = nullptr;
+        if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                                reinterpret_cast<LPCWSTR>(&ModulePath), &module))
+            return std::wstring();
+
+        std::wstring path(MAX_PATH, L'\0');
+        for (;;)
+        {
+            DWORD length = GetModuleFileNameW(module, &path[0], static_cast<DWORD>(path.size()));
+            if (length == 0)
+                return std::wstring();
+            if (length < path.size())
+            {
+                path.resize(length);
+                return path;
+            }
+            path.resize(path.size() * 2);
+        }
+    }
+
+    std::wstring Rundll32Path()
+    {
+        WCHAR directory[MAX_PATH] = {};
+        UINT length = GetSystemDirectoryW(directory, MAX_PATH);
+        if (length == 0 || length >= MAX_PATH)
+            return std::wstring();
+        return std::wstring(directory) + L"\\rundll32.exe";
+    }
+
+    int32_t HandleWorkerJob(const WorkerJob& job, WorkerImageWriter& output)
+    {
+        std::wstring path = Utf8ToWide(job.path);
+        HBITMAP hBitmap = nullptr;
+        WTS_ALPHATYPE alphaType = WTSAT_UNKNOWN;
+        HRESULT hr;
+        switch (static_cast<IsolatedJobKind>(job.kind))
+        {
+        case IsolatedJobKind::Thumbnail:
+        case IsolatedJobKind::UncachedThumbnail:
+            hr = ExtractFileThumbnailInProcess(path.c_str(), job.width, &hBitmap, &alphaType,
+                                               job.kind == static_cast<uint32_t>(IsolatedJobKind::UncachedThumbnail));
+            break;
+        case IsolatedJobKind::Preview:
+            hr = ExtractFilePreviewInProcess(path.c_str(), job.width, job.height, &hBitmap);
+            break;
+        default:
+            return E_INVALIDARG;
+        }
+        if (FAILED(hr) || !hBitmap)
+            return FAILED(hr) ? hr : E_FAIL;
+
+        // Straight into the shared area
+        AlphaMode alpha = AlphaMode::Ignore;
+        uint8_t* pixels = nullptr;
+        hr = ReadHBITMAPPixels(hBitmap, [&output, &pixels](uint32_t width, uint32_t height)
+        {
+            pixels = output.Begin(width, height, AlphaMode::Ignore);
+            return pixels;
+        }, &alpha);
+        DeleteObject(hBitmap);
+        if (hr == E_OUTOFMEMORY)
+            return HRESULT_FROM_WIN32(ERROR_BUFFER_OVERFLOW);
+        if (FAILED(hr))
+            return hr;
+
+        ApplyThumbnailAlphaType(alphaType, pixels, output.Width(), output.Height(), static_cast<size_t>(output.Width()) * 4, &alpha);
+        output.SetAlpha(alpha);
+        return hr;
+    }
+
+    // Supervisor side: the one copy out of shared memory. A DIB section over the worker's area
+    // (CreateDIBSection with the mapping handle) would avoid it, but the area belongs to the
+    // worker and is written again by its next job as soon as this one is consumed, while the
+    // caller keeps the HBITMAP as long as it likes. Zero copy would need a new section per job,
+    // sized before the worker knows the image size and opened by the worker for every job.
+    HRESULT CreateBitmapFromView(const SharedImageView& view, HBITMAP* phBitmap)
+    {
+        BITMAPINFO bi = {};
+        bi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bi.bmiHeader.biWidth = (LONG)view.width;
+        bi.bmiHeader.biHeight = -(LONG)view.height; // top-down
+        bi.bmiHeader.biPlanes = 1;
+        bi.bmiHeader.biBitCount = 32;
+        bi.bmiHeader.biCompression = BI_RGB;
+
+        void* bits = nullptr;
+        HBITMAP hBitmap = CreateDIBSection(nullptr, &bi, DIB_RGB_COLORS, &bits, nullptr, 0);
+        if (!hBitmap || !bits)
+            return E_OUTOFMEMORY;
+
+        size_t rowBytes = static_cast<size_t>(view.width) * 4;
+        for (uint32_t y = 0; y < view.height; ++y)
+            memcpy(static_cast<uint8_t*>(bits) + y * rowBytes, view.pixels + y * view.stride, rowBytes);
+        GdiFlush();
+
+        *phBitmap = hBitmap;
+        return S_OK;
+    }
+}
+
+// rundll32 entry point of a worker process: rundll32 "<dll>",WorkerMain <channel>
+extern "C" void CALLBACK WorkerMainW(HWND, HINSTANCE, LPWSTR lpszCmdLine, int)
+{
+    // A crashing handler must end the worker, not wait on an error dialog
+    SetErrorMode(SEM_FAILCRITICALERRORS | SEM_NOGPFAULTERRORBOX | SEM_NOOPENFILEERRORBOX);
+
+    std::wstring channel(lpszCmdLine ? lpszCmdLine : L"");
+    while (!channel.empty() && iswspace(channel.back()))
+        channel.pop_back();
+    if (channel.empty())
+        return;
+
+    HRESULT hrInit = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
+    int exitCode = RunWorkerProcess(WideToUtf8(channel), &HandleWorkerJob);
+    if (SUCCEEDED(hrInit))
+        CoUninitialize();
+    ExitProcess(static_cast<UINT>(exitCode));
+}
+
+bool IsHandlerIsolationEnabled()
+{
+    return g_enabled.load(std::memory_order_acquire);
+}
+
+HRESULT RunIsolatedExtraction(IsolatedJobKind kind, LPCWSTR filePath, UINT width, UINT height, HBITMAP* phBitmap, AlphaMode* pAlpha)
+{
+    if (!filePath || !phBitmap)
+        return E_INVALIDARG;
+
+    *phBitmap = nullptr;
+
+    WorkerJob job;
+    job.kind = static_cast<uint32_t>(kind);
+    job.path = WideToUtf8(filePath);
+    job.width = width;
+    job.height = height;
+    job.handlerKey = FileTypeFromPath(filePath);
+
+    HRESULT hrImage = E_FAIL;
+    WorkerResult result = Pool().Run(job, g_timeoutMs.load(std::memory_order_relaxed),
+        [&hrImage, phBitmap, pAlpha](const SharedImageView& view)
+        {
+            hrImage = CreateBitmapFromView(view, phBitmap);
+            if (pAlpha)
+                *pAlpha = view.alpha;
+        });
+
+    switch (result.outcome)
+    {
+    case WorkerOutcome::Completed:
+        return FAILED(result.status) ? static_cast<HRESULT>(result.status) : hrImage;
+    case WorkerOutcome::Crashed:
+        return HRESULT_FROM_WIN32(ERROR_PROCESS_ABORTED);
+    case WorkerOutcome::TimedOut:
+        return HRESULT_FROM_WIN32(ERROR_TIMEOUT);
+    case WorkerOutcome::Quarantined:
+        return HRESULT_FROM_WIN32(ERROR_CONTENT_BLOCKED);
+    default:
+        return HRESULT_FROM_WIN32(ERROR_SERVICE_NOT_ACTIVE);
+    }
+}
+
+HRESULT EnableHandlerIsolationImpl(const WSP_ISOLATION_OPTIONS* pOptions)
+{
+    std::lock_guard<std::mutex> lock(g_configMutex);
+
+    // New requests go in-process right away; running ones finish before the workers stop
+    g_enabled.store(false, std::memory_order_release);
+    Pool().Stop();
+    if (!pOptions)
+        return S_OK;
+
+    std::wstring modulePath = ModulePath();
+    std::wstring rundll32 = Rundll32Path();
+    if (modulePath.empty() || rundll32.empty())
+        return E_FAIL;
+
+    WorkerPoolOptions options;
+    options.executable = WideToUtf8(rundll32);
+    options.arguments.push_back("\"" + WideToUtf8(modulePath) + "\",WorkerMain");
+    options.workerCount = pOptions->workerCount ? pOptions->workerCount : DEFAULT_WORKER_COUNT;
+    options.pixelCapacity = pOptions->maxImageBytes ? pOptions->maxImageBytes : DEFAULT_MAX_IMAGE_BYTES;
+    options.quarantineFailures = pOptions->quarantineFailures ? pOptions->quarantineFailures : DEFAULT_QUARANTINE_FAILURES;
+    options.quarantineMs = pOptions->quarantineMs ? pOptions->quarantineMs : DEFAULT_QUARANTINE_MS;
+    g_timeoutMs.store(pOptions->timeoutMs ? pOptions->timeoutMs : DEFAULT_TIMEOUT_MS, std::memory_order_relaxed);
+
+    if (!Pool().Start(options))
+        return HRESULT_FROM_WIN32(ERROR_SERVICE_NOT_ACTIVE);
+
+    g_enabled.store(true, std::memory_order_release);
+    return S_OK;
+}
+
+HRESULT GetIsolationStatsImpl(WSP_ISOLATION_STATS* pStats)
+{
+    if (!pStats)
+        return E_INVALIDARG;
+
+    WorkerPoolStats stats = Pool().Stats();
+    pStats->requests = stats.jobs;
+    pStats->completed = stats.completed;
+    pStats->crashes = stats.crashes;
+    pStats->timeouts = stats.timeouts;
+    pStats->hangsDetected = stats.hangsDetected;
+    pStats->workersStarted = stats.spawned;
+    pStats->quarantinedRequests = stats.quarantined;
+    pStats->quarantinedFileTypes = stats.quarantinedKeys;
+    pStats->liveWorkers = stats.liveWorkers;
+    pStats->enabled = IsHandlerIsolationEnabled() ? TRUE : FALSE;
+    return S_OK;
+}
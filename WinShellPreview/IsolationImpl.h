@@ -0,0 +1,26 @@
+#pragma once
+#include "framework.h"
+#include "WinShellPreview.h"
+#include "ImageOps.h"
+
+// Out-of-process handler isolation: thumbnail and preview handlers run in rundll32 worker
+// processes hosting this DLL (entry point WorkerMainW). Results come back through shared
+// memory; a crashing or hanging handler costs a worker restart instead of the host process.
+
+enum class IsolatedJobKind : UINT
+{
+    Thumbnail = 1,
+    Preview = 2,
+    UncachedThumbnail = 3   // Thumbnail after a Shell cache miss: cache-only providers are skipped
+};
+
+bool IsHandlerIsolationEnabled();
+
+// Runs the extraction in a worker. Fails with HRESULT_FROM_WIN32(ERROR_PROCESS_ABORTED) if the
+// worker crashed, ERROR_TIMEOUT if it hung, ERROR_CONTENT_BLOCKED if the file type is
+// quarantined after repeated failures. pAlpha (optional) receives the worker's alpha mode.
+HRESULT RunIsolatedExtraction(IsolatedJobKind kind, LPCWSTR filePath, UINT width, UINT height, HBITMAP* phBitmap,
+                              AlphaMode* pAlpha = nullptr);
+
+HRESULT EnableHandlerIsolationImpl(const WSP_ISOLATION_OPTIONS* pOptions);
+HRESULT GetIsolationStatsImpl(WSP_ISOLATION_STATS* pStats);
@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Bounded lock-free multi-producer multi-consumer FIFO (Vyukov's sequence-numbered ring).
+// Every slot carries a sequence number that tells producers and consumers whose turn it is,
+// so TryPush and TryPop each claim a slot with one compare-and-swap and never block.
+// Capacity is rounded up to a power of two. No Windows dependencies.
+template <typename T>
+class MpmcQueue
+{
+public:
+    explicit MpmcQueue(size_t capacity)
+        : m_mask(RoundUp(capacity) - 1), m_slots(new Slot[m_mask + 1]), m_enqueue(0), m_dequeue(0)
+    {
+        for (size_t i = 0; i <= m_mask; ++i)
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    // Returns false (leaving item untouched) when the queue is full
+    bool TryPush(T& item)
+    {
+        size_t pos = m_enqueue.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot& slot = m_slots[pos & m_mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (m_enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    slot.value = std::move(item);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = m_enqueue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Returns false when the queue is empty
+    bool TryPop(T* item)
+    {
+        size_t pos = m_dequeue.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot& slot = m_slots[pos & m_mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (m_dequeue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    *item = std::move(slot.value);
+                    slot.value = T();
+                    slot.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = m_dequeue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Approximate while other threads are pushing or popping
+    size_t Size() const
+    {
+        size_t enqueue = m_enqueue.load(std::memory_order_relaxed);
+        size_t dequeue = m_dequeue.load(std::memory_order_relaxed);
+        return enqueue > dequeue ? enqueue - dequeue : 0;
+    }
+
+    size_t Capacity() const { return m_mask + 1; }
+
+private:
+    static size_t RoundUp(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        return size;
+    }
+
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    // Producers and consumers update different counters; keep them on separate cache lines
+    const size_t m_mask;
+    std::unique_ptr<Slot[]> m_slots;
+    alignas(64) std::atomic<size_t> m_enqueue;
+    alignas(64) std::atomic<size_t> m_dequeue;
+};
@@ -0,0 +1,157 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+// Small, single-threaded LRU cache used for per-thread object reuse (bound folders, parsed items).
+// No Windows dependencies: the value type decides what "holding" an object means (ComPtr, shared_ptr, ...).
+
+struct ObjectCacheStats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;
+};
+
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache
+{
+public:
+    explicit LruCache(size_t capacity) : m_capacity(capacity ? capacity : 1) {}
+
+    // Returns a pointer to the cached value (valid until the next mutation) or nullptr
+    Value* Find(const Key& key)
+    {
+        auto it = m_index.find(key);
+        if (it == m_index.end())
+        {
+            ++m_stats.misses;
+            return nullptr;
+        }
+        ++m_stats.hits;
+        m_order.splice(m_order.begin(), m_order, it->second);
+        return &it->second->second;
+    }
+
+    Value& Insert(const Key& key, Value value)
+    {
+        auto it = m_index.find(key);
+        if (it != m_index.end())
+        {
+            it->second->second = std::move(value);
+            m_order.splice(m_order.begin(), m_order, it->second);
+            return it->second->second;
+        }
+
+        while (m_index.size() >= m_capacity)
+            EvictOldest();
+
+        m_order.emplace_front(key, std::move(value));
+        m_index[key] = m_order.begin();
+        ++m_stats.insertions;
+        return m_order.front().second;
+    }
+
+    bool Erase(const Key& key)
+    {
+        auto it = m_index.find(key);
+        if (it == m_index.end())
+            return false;
+        m_order.erase(it->second);
+        m_index.erase(it);
+        return true;
+    }
+
+    // Removes every entry for which pred(key) returns true
+    template <typename Pred>
+    size_t EraseIf(Pred pred)
+    {
+        size_t removed = 0;
+        for (auto it = m_order.begin(); it != m_order.end();)
+        {
+            if (pred(it->first))
+            {
+                m_index.erase(it->first);
+                it = m_order.erase(it);
+                ++removed;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        return removed;
+    }
+
+    // Calls fn(key, value) from the most to the least recently used entry
+    template <typename Fn>
+    void ForEach(Fn fn) const
+    {
+        for (const auto& item : m_order)
+            fn(item.first, item.second);
+    }
+
+    void Clear()
+    {
+        m_order.clear();
+        m_index.clear();
+    }
+
+    size_t Size() const { return m_index.size(); }
+    size_t Capacity() const { return m_capacity; }
+    const ObjectCacheStats& Stats() const { return m_stats; }
+
+private:
+    void EvictOldest()
+    {
+        if (m_order.empty())
+            return;
+        m_index.erase(m_order.back().first);
+        m_order.pop_back();
+        ++m_stats.evictions;
+    }
+
+    typedef std::list<std::pair<Key, Value>> OrderList;
+
+    size_t m_capacity;
+    OrderList m_order;
+    std::unordered_map<Key, typename OrderList::iterator, Hash> m_index;
+    ObjectCacheStats m_stats = {};
+};
+
+// Lazily created per-thread instance of T. Release() destroys the calling thread's instance early,
+// e.g. before the thread's COM apartment goes away.
+template <typename T>
+class PerThread
+{
+public:
+    static T& Get()
+    {
+        std::unique_ptr<T>& slot = Slot();
+        if (!slot)
+            slot.reset(new T());
+        return *slot;
+    }
+
+    static T* Peek()
+    {
+        return Slot().get();
+    }
+
+    static void Release()
+    {
+        Slot().reset();
+    }
+
+private:
+    static std::unique_ptr<T>& Slot()
+    {
+        thread_local std::unique_ptr<T> instance;
+        return instance;
+    }
+};
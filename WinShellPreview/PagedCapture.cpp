@@ -0,0 +1,88 @@
+#include "PagedCapture.h"
+#include "BoundedQueue.h"
+#include <thread>
+
+PagedCaptureResult RunPagedCapture(PagedRenderer& renderer, const PagedCaptureOptions& options,
+                                   const std::function<bool(CapturedPage& page)>& deliver)
+{
+    PagedCaptureResult result;
+    if (options.pageCount == 0)
+        return result;
+
+    BoundedQueue<CapturedPage> queue(options.queueDepth);
+    uint32_t rendered = 0;
+    bool openFailed = false;
+    bool renderFailed = false;
+    bool reachedEnd = false;
+    uint32_t documentPages = 0;
+
+    // Written by the render thread only; read after join
+    std::thread renderThread([&]()
+    {
+        if (!renderer.Open(&documentPages))
+        {
+            openFailed = true;
+            renderer.Close();
+            queue.Close();
+            return;
+        }
+
+        uint32_t last = options.firstPage + options.pageCount;
+        if (documentPages != 0 && last > documentPages)
+            last = documentPages;
+        if (options.firstPage >= last && documentPages != 0)
+            reachedEnd = true;
+
+        for (uint32_t page = options.firstPage; page < last; ++page)
+        {
+            CapturedPage captured;
+            captured.page = page;
+            PageStatus status = renderer.RenderPage(page, &captured.image);
+            if (status == PageStatus::End)
+            {
+                reachedEnd = true;
+                break;
+            }
+            if (status == PageStatus::Failed || captured.image.Empty())
+            {
+                renderFailed = true;
+                break;
+            }
+            rendered++;
+
+            // Blocks while the consumer is queueDepth pages behind; fails once it stopped
+            if (!queue.Push(std::move(captured)))
+                break;
+        }
+        if (documentPages != 0 && options.firstPage + options.pageCount > documentPages)
+            reachedEnd = true;
+
+        renderer.Close();
+        queue.Close();
+    });
+
+    CapturedPage page;
+    while (queue.Pop(&page))
+    {
+        if (!deliver(page))
+        {
+            result.stopped = true;
+            queue.Cancel();
+            break;
+        }
+        result.pagesDelivered++;
+        page.image.Reset();
+    }
+
+    renderThread.join();
+
+    BoundedQueueStats stats = queue.Stats();
+    result.documentPages = documentPages;
+    result.pagesRendered = rendered;
+    result.openFailed = openFailed;
+    result.renderFailed = renderFailed;
+    result.reachedEnd = reachedEnd;
+    result.renderStallMs = stats.pushWaitMs;
+    result.deliverStallMs = stats.popWaitMs;
+    return result;
+}
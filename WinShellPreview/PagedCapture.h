@@ -0,0 +1,60 @@
+#pragma once
+#include "ImageOps.h"
+#include <cstdint>
+#include <functional>
+
+// Page-by-page capture pipeline: a renderer produces pages on its own thread while the caller
+// encodes and delivers earlier ones. A bounded queue between the two provides backpressure, so
+// at most `queueDepth` rendered pages wait in memory. No Windows dependencies.
+
+enum class PageStatus
+{
+    Rendered,
+    End,        // No such page (document is shorter than requested)
+    Failed
+};
+
+// Implemented per document source. All methods run on the render thread, in order:
+// Open, RenderPage for increasing page numbers, Close (always, also after a failed Open).
+class PagedRenderer
+{
+public:
+    virtual ~PagedRenderer() {}
+
+    // pageCount receives the number of pages, or 0 if the source cannot tell in advance
+    virtual bool Open(uint32_t* pageCount) = 0;
+    // Pages are zero-based and requested in increasing order; skipped pages are not requested
+    virtual PageStatus RenderPage(uint32_t page, PixelImage* image) = 0;
+    virtual void Close() = 0;
+};
+
+struct PagedCaptureOptions
+{
+    uint32_t firstPage = 0;
+    uint32_t pageCount = 1;     // Pages to capture starting at firstPage
+    uint32_t queueDepth = 2;    // Rendered pages allowed to wait for delivery
+};
+
+struct CapturedPage
+{
+    uint32_t page = 0;
+    PixelImage image;
+};
+
+struct PagedCaptureResult
+{
+    uint32_t documentPages = 0;     // As reported by Open, 0 if unknown
+    uint32_t pagesRendered = 0;
+    uint32_t pagesDelivered = 0;
+    bool openFailed = false;
+    bool renderFailed = false;
+    bool reachedEnd = false;        // The document ended before pageCount pages
+    bool stopped = false;           // deliver returned false
+    uint64_t renderStallMs = 0;     // Renderer blocked because delivery fell behind
+    uint64_t deliverStallMs = 0;    // Delivery waited for the renderer
+};
+
+// Runs renderer on a new thread and deliver on the calling thread. deliver may move the image
+// out; returning false stops rendering and discards queued pages. Returns after both sides finish.
+PagedCaptureResult RunPagedCapture(PagedRenderer& renderer, const PagedCaptureOptions& options,
+                                   const std::function<bool(CapturedPage& page)>& deliver);
@@ -0,0 +1,310 @@
+#include "pch.h"
+#include "PagedPreviewImpl.h"
+#include "BitmapUtils.h"
+#include "ContentHash.h"
+#include "HandlersImpl.h"
+#include "PagedCapture.h"
+#include "PngWriter.h"
+#include "PreviewHandler.h"
+#include "ShellContext.h"
+#include <propkey.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    const DWORD CHILD_WINDOW_TIMEOUT_MS = 3000;
+    const DWORD FIRST_PAGE_SETTLE_MS = 500;     // Let the handler finish its first layout
+    const DWORD PAGE_SETTLE_MS = 300;           // Per page turn
+    const UINT MAX_PAGES = 1000;
+
+    uint64_t HashFrame(const PixelImage& image)
+    {
+        Xxh64 state;
+        for (uint32_t y = 0; y < image.height; ++y)
+            state.Update(image.Row(y), static_cast<size_t>(image.width) * 4);
+        return state.Digest();
+    }
+
+    // Hosts a preview handler in an off-screen window and turns pages by sending Page Down to
+    // the handler's view. IPreviewHandler has no paging interface, so the end of the document
+    // is detected when a page turn no longer changes the captured frame.
+    class PreviewPageRenderer : public PagedRenderer
+    {
+    public:
+        PreviewPageRenderer(LPCWSTR filePath, UINT width, UINT height)
+            : m_filePath(filePath), m_width(width), m_height(height), m_hrCom(E_FAIL), m_lastError(S_OK),
+              m_hwndHost(nullptr), m_hwndView(nullptr), m_currentPage(0), m_lastHash(0), m_captured(false)
+        {
+        }
+
+        HRESULT LastError() const { return m_lastError; }
+
+        bool Open(uint32_t* pageCount) override
+        {
+            *pageCount = 0;
+
+            // Runs on the pipeline's render thread, which becomes the handler's STA
+            m_hrCom = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+            if (FAILED(m_hrCom))
+                return Fail(m_hrCom);
+
+            *pageCount = QueryPageCount();
+
+            PreviewHandler factory;
+            HRESULT hr = factory.GetPreviewHandlerFromExtension(m_filePath.c_str(), &m_handler);
+            if (FAILED(hr))
+                return Fail(hr);
+
+            // Off-screen but visible: some handlers (Excel) do not render into hidden windows
+            m_hwndHost = CreateWindowExW(0, L"STATIC", L"PreviewHost", WS_POPUP | WS_CLIPSIBLINGS | WS_CLIPCHILDREN,
+                                         -10000, -10000, m_width, m_height, nullptr, nullptr, GetModuleHandle(nullptr), nullptr);
+            if (!m_hwndHost)
+                return Fail(HRESULT_FROM_WIN32(GetLastError()));
+            ShowWindow(m_hwndHost, SW_SHOWNOACTIVATE);
+            UpdateWindow(m_hwndHost);
+
+            ComPtr<IInitializeWithFile> initialize;
+            hr = m_handler.As(&initialize);
+            if (SUCCEEDED(hr))
+                hr = initialize->Initialize(m_filePath.c_str(), STGM_READ | STGM_SHARE_DENY_NONE);
+            if (FAILED(hr))
+                return Fail(hr);
+
+            RECT rc = { 0, 0, static_cast<LONG>(m_width), static_cast<LONG>(m_height) };
+            hr = m_handler->SetWindow(m_hwndHost, &rc);
+            if (SUCCEEDED(hr))
+                hr = m_handler->SetRect(&rc);
+            if (SUCCEEDED(hr))
+                hr = m_handler->DoPreview();
+            if (FAILED(hr))
+                return Fail(hr);
+
+            m_hwndView = WaitForView();
+            PumpMessages(FIRST_PAGE_SETTLE_MS);
+            return true;
+        }
+
+        PageStatus RenderPage(uint32_t page, PixelImage* image) override
+        {
+            PixelImage frame;
+            if (!m_captured)
+            {
+                if (!Capture(&frame))
+                    return PageStatus::Failed;
+                m_lastHash = HashFrame(frame);
+                m_captured = true;
+            }
+
+            // Pages before firstPage are turned but not delivered; every turn is still checked
+            // so a range past the end is not answered with copies of the last page
+            while (m_currentPage < page)
+            {
+                TurnPage();
+                if (!Capture(&frame))
+                    return PageStatus::Failed;
+                uint64_t hash = HashFrame(frame);
+                if (hash == m_lastHash)
+                    return PageStatus::End;
+                m_lastHash = hash;
+                ++m_currentPage;
+            }
+
+            *image = std::move(frame);
+            return PageStatus::Rendered;
+        }
+
+        void Close() override
+        {
+            if (m_handler)
+            {
+                m_handler->Unload();
+                m_handler.Reset();
+            }
+            if (m_hwndHost)
+            {
+                DestroyWindow(m_hwndHost);
+                m_hwndHost = nullptr;
+            }
+            ShellContext::ReleaseCurrentThread();
+            if (SUCCEEDED(m_hrCom))
+                CoUninitialize();
+            m_hrCom = E_FAIL;
+        }
+
+    private:
+        bool Fail(HRESULT hr)
+        {
+            m_lastError = hr;
+            return false;
+        }
+
+        // Document or slide count from the property system; 0 when the format does not say
+        uint32_t QueryPageCount()
+        {
+            ComPtr<IShellItem2> item;
+            if (FAILED(ShellContext::ForCurrentThread().CreateItem(m_filePath.c_str(), IID_PPV_ARGS(&item))))
+                return 0;
+
+            int count = 0;
+            if (SUCCEEDED(item->GetInt32(PKEY_Document_PageCount, &count)) && count > 0)
+                return static_cast<uint32_t>(count);
+            if (SUCCEEDED(item->GetInt32(PKEY_Presentation_SlideCount, &count)) && count > 0)
+                return static_cast<uint32_t>(count);
+            return 0;
+        }
+
+        void PumpMessages(DWORD durationMs)
+        {
+            DWORD start = GetTickCount();
+            do
+            {
+                MSG msg;
+                while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+                {
+                    TranslateMessage(&msg);
+                    DispatchMessage(&msg);
+                }
+                MsgWaitForMultipleObjects(0, nullptr, FALSE, 10, QS_ALLINPUT);
+            } while (GetTickCount() - start < durationMs);
+        }
+
+        HWND WaitForView()
+        {
+            DWORD start = GetTickCount();
+            while (GetTickCount() - start < CHILD_WINDOW_TIMEOUT_MS)
+            {
+                PumpMessages(50);
+
+                ComPtr<IOleWindow> window;
+                HWND hwnd = nullptr;
+                if (SUCCEEDED(m_handler.As(&window)) && SUCCEEDED(window->GetWindow(&hwnd)) && hwnd && hwnd != m_hwndHost)
+                    return hwnd;
+            }
+            return nullptr;
+        }
+
+        // The innermost window at the center of the view is the one that scrolls
+        HWND ScrollTarget()
+        {
+            HWND target = m_hwndView ? m_hwndView : m_hwndHost;
+            POINT center = { static_cast<LONG>(m_width / 2), static_cast<LONG>(m_height / 2) };
+            MapWindowPoints(m_hwndHost, target, &center, 1);
+            for (;;)
+            {
+                HWND child = ChildWindowFromPointEx(target, center, CWP_SKIPINVISIBLE | CWP_SKIPTRANSPARENT);
+                if (!child || child == target)
+                    return target;
+                MapWindowPoints(target, child, &center, 1);
+                target = child;
+            }
+        }
+
+        void TurnPage()
+        {
+            HWND target = ScrollTarget();
+            PostMessage(target, WM_KEYDOWN, VK_NEXT, 1);
+            PostMessage(target, WM_KEYUP, VK_NEXT, 0xC0000001);
+            PumpMessages(PAGE_SETTLE_MS);
+        }
+
+        bool Capture(PixelImage* image)
+        {
+            HWND hwndCapture = m_hwndView ? m_hwndView : m_hwndHost;
+            HDC hdcScreen = GetDC(nullptr);
+            HDC hdcMem = CreateCompatibleDC(hdcScreen);
+            HBITMAP hBitmap = CreateCompatibleBitmap(hdcScreen, m_width, m_height);
+            HRESULT hr = E_OUTOFMEMORY;
+            if (hBitmap && hdcMem)
+            {
+                HBITMAP hOld = static_cast<HBITMAP>(SelectObject(hdcMem, hBitmap));
+                RECT fill = { 0, 0, static_cast<LONG>(m_width), static_cast<LONG>(m_height) };
+                FillRect(hdcMem, &fill, static_cast<HBRUSH>(GetStockObject(WHITE_BRUSH)));
+                PrintWindow(hwndCapture, hdcMem, PW_RENDERFULLCONTENT);
+                SelectObject(hdcMem, hOld);
+                hr = HBITMAPToPixelImage(hBitmap, image);
+            }
+            if (hBitmap)
+                DeleteObject(hBitmap);
+            if (hdcMem)
+                DeleteDC(hdcMem);
+            ReleaseDC(nullptr, hdcScreen);
+
+            if (FAILED(hr))
+                return Fail(hr);
+            return true;
+        }
+
+        std::wstring m_filePath;
+        UINT m_width;
+        UINT m_height;
+        HRESULT m_hrCom;
+        HRESULT m_lastError;
+        ComPtr<IPreviewHandler> m_handler;
+        HWND m_hwndHost;
+        HWND m_hwndView;
+        uint32_t m_currentPage;
+        uint64_t m_lastHash;
+        bool m_captured;
+    };
+}
+
+HRESULT GetFilePreviewPagesImpl(LPCWSTR filePath, UINT width, UINT height, UINT firstPage, UINT pageCount,
+                                LPCWSTR outputBasePath, WSP_PAGE_CALLBACK callback, void* context, UINT* pPagesDelivered)
+{
+    if (pPagesDelivered)
+        *pPagesDelivered = 0;
+
+    if (!filePath || width == 0 || height == 0 || pageCount == 0 || pageCount > MAX_PAGES)
+        return E_INVALIDARG;
+    if (!outputBasePath && !callback)
+        return E_INVALIDARG;
+
+    // Cached per extension: no render thread is started for files without a preview handler
+    if (FindPreviewHandlerClsid(filePath, nullptr) == HRESULT_FROM_WIN32(ERROR_NO_ASSOCIATION))
+        return HRESULT_FROM_WIN32(ERROR_NO_ASSOCIATION);
+
+    PreviewPageRenderer renderer(filePath, width, height);
+    PagedCaptureOptions options;
+    options.firstPage = firstPage;
+    options.pageCount = pageCount;
+
+    // Delivery runs here while the render thread turns to the next page
+    HRESULT deliverError = S_OK;
+    PagedCaptureResult result = RunPagedCapture(renderer, options, [&](CapturedPage& page)
+    {
+        std::wstring savedPath;
+        if (outputBasePath)
+        {
+            savedPath = std::wstring(outputBasePath) + L"_" + std::to_wstring(page.page) + L".png";
+            if (!SavePixelImageAsPng(page.image, std::filesystem::path(savedPath)))
+            {
+                deliverError = E_FAIL;
+                return false;
+            }
+        }
+
+        if (!callback)
+            return true;
+
+        HBITMAP hBitmap = nullptr;
+        HRESULT hr = PixelImageToHBITMAP(page.image, &hBitmap);
+        if (FAILED(hr))
+        {
+            deliverError = hr;
+            return false;
+        }
+        return callback(page.page, hBitmap, savedPath.empty() ? nullptr : savedPath.c_str(), context) != FALSE;
+    });
+
+    if (pPagesDelivered)
+        *pPagesDelivered = result.pagesDelivered;
+
+    if (result.openFailed || result.renderFailed)
+        return FAILED(renderer.LastError()) ? renderer.LastError() : E_FAIL;
+    if (FAILED(deliverError))
+        return deliverError;
+    if (result.stopped)
+        return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+    return result.reachedEnd ? S_FALSE : S_OK;
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include "framework.h"
+#include "WinShellPreview.h"
+
+// Captures pages [firstPage, firstPage + pageCount) of the file's preview. Pages render on a
+// dedicated STA thread while earlier ones are saved and delivered on the calling thread.
+HRESULT GetFilePreviewPagesImpl(LPCWSTR filePath, UINT width, UINT height, UINT firstPage, UINT pageCount,
+                                LPCWSTR outputBasePath, WSP_PAGE_CALLBACK callback, void* context, UINT* pPagesDelivered);
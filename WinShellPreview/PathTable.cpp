@@ -0,0 +1,314 @@
+#include "PathTable.h"
+#include "ContentHash.h"
+#include "TextCodec.h"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    inline bool IsAsciiLetter(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+
+    inline char AsciiLower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    bool EqualsNoCase(std::string_view text, const char* lower)
+    {
+        for (char c : text)
+        {
+            if (AsciiLower(c) != *lower++)
+                return false;
+        }
+        return *lower == '\0';
+    }
+
+    // Last '.' after the last separator, like PathFindExtension
+    template <typename Char>
+    size_t FindExtension(std::basic_string_view<Char> path)
+    {
+        for (size_t i = path.size(); i > 0; --i)
+        {
+            Char c = path[i - 1];
+            if (c == Char('.'))
+                return i - 1;
+            if (c == Char('\\') || c == Char('/'))
+                break;
+        }
+        return path.size();
+    }
+
+    // UTF-16 units needed for the first `bytes` bytes of valid UTF-8
+    uint32_t Utf16Length(const std::string& text, size_t bytes)
+    {
+        uint32_t units = 0;
+        for (size_t i = 0; i < bytes; ++i)
+        {
+            uint8_t c = static_cast<uint8_t>(text[i]);
+            if ((c & 0xc0) != 0x80)
+                units += c >= 0xf0 ? 2 : 1;
+        }
+        return units;
+    }
+
+    // Reads one component starting at *pos, skipping separators before it
+    std::string_view NextComponent(const std::string& path, size_t* pos)
+    {
+        while (*pos < path.size() && path[*pos] == '\\')
+            ++*pos;
+        size_t start = *pos;
+        while (*pos < path.size() && path[*pos] != '\\')
+            ++*pos;
+        return std::string_view(path).substr(start, *pos - start);
+    }
+
+    // "C:\a\b" with nothing to clean up, the form almost every caller passes
+    bool IsNormalDrivePath(std::string_view path)
+    {
+        if (path.size() < 3 || !IsAsciiLetter(path[0]) || path[1] != ':' || path[2] != '\\')
+            return false;
+
+        size_t componentStart = 3;
+        for (size_t i = 3; i <= path.size(); ++i)
+        {
+            char c = i < path.size() ? path[i] : '\\';
+            if (c == '/')
+                return false;
+            if (c != '\\')
+                continue;
+
+            size_t length = i - componentStart;
+            if (length == 0)
+                return i == 3 && path.size() == 3;
+            if (path[componentStart] == '.' && (length == 1 || (length == 2 && path[componentStart + 1] == '.')))
+                return false;
+            componentStart = i + 1;
+        }
+        return true;
+    }
+}
+
+bool NormalizePath(std::string_view input, std::string* out, size_t* rootLength)
+{
+    if (input.empty())
+        return false;
+
+    if (IsNormalDrivePath(input))
+    {
+        out->assign(input.data(), input.size());
+        *rootLength = 3;
+        return true;
+    }
+
+    std::string path(input);
+    std::replace(path.begin(), path.end(), '/', '\\');
+
+    std::string root;
+    size_t pos = 0;
+
+    // "\\?\" and "\\.\" only switch off Win32 parsing; drive and UNC paths behind them are
+    // the same files as without the prefix
+    if (path.size() >= 4 && path[0] == '\\' && path[1] == '\\' && (path[2] == '?' || path[2] == '.') && path[3] == '\\')
+    {
+        std::string_view rest = std::string_view(path).substr(4);
+        if (rest.size() >= 4 && EqualsNoCase(rest.substr(0, 3), "unc") && rest[3] == '\\')
+        {
+            path = "\\\\" + std::string(rest.substr(4));
+        }
+        else if (rest.size() >= 2 && IsAsciiLetter(rest[0]) && rest[1] == ':' && (rest.size() == 2 || rest[2] == '\\'))
+        {
+            path = std::string(rest);
+        }
+        else
+        {
+            // Volume GUID or device: its first component is part of the root
+            size_t end = (std::min)(path.find('\\', 4), path.size());
+            root = path.substr(0, end) + "\\";
+            pos = end;
+        }
+    }
+
+    if (root.empty())
+    {
+        if (path.size() >= 2 && path[0] == '\\' && path[1] == '\\')
+        {
+            pos = 2;
+            std::string_view server = NextComponent(path, &pos);
+            std::string_view share = NextComponent(path, &pos);
+            root = "\\\\" + std::string(server) + "\\";
+            if (!share.empty())
+                root += std::string(share) + "\\";
+        }
+        else if (path.size() >= 2 && IsAsciiLetter(path[0]) && path[1] == ':')
+        {
+            // "C:file" is relative to the current directory of drive C
+            pos = path.size() >= 3 && path[2] == '\\' ? 3 : 2;
+            root = path.substr(0, pos);
+        }
+        else if (path[0] == '\\')
+        {
+            root = "\\";
+            pos = 1;
+        }
+    }
+
+    std::vector<std::string_view> components;
+    while (pos < path.size())
+    {
+        std::string_view component = NextComponent(path, &pos);
+        if (component.empty() || component == ".")
+            continue;
+        if (component == "..")
+        {
+            if (!components.empty() && components.back() != "..")
+                components.pop_back();
+            else if (root.empty())
+                components.push_back(component);
+            continue;
+        }
+        components.push_back(component);
+    }
+
+    *rootLength = root.size();
+    *out = std::move(root);
+    for (size_t i = 0; i < components.size(); ++i)
+    {
+        if (i)
+            out->push_back('\\');
+        out->append(components[i].data(), components[i].size());
+    }
+    if (out->empty())
+        out->push_back('.');
+    return true;
+}
+
+size_t ExtensionOffset(std::string_view path)
+{
+    return FindExtension(path);
+}
+
+size_t ExtensionOffset(std::u16string_view path)
+{
+    return FindExtension(path);
+}
+
+PathTable::PathTable()
+    : m_nextId(1), m_lookups(0), m_hits(0), m_created(0)
+{
+}
+
+PathRef PathTable::Intern(std::string_view utf8)
+{
+    std::string path;
+    size_t rootLength = 0;
+    if (!NormalizePath(utf8, &path, &rootLength))
+        return nullptr;
+    return InternNormalized(std::move(path), rootLength);
+}
+
+PathRef PathTable::Intern(std::u16string_view utf16)
+{
+    std::string utf8;
+    Utf16ToUtf8(utf16.data(), utf16.size(), &utf8);
+    return Intern(utf8);
+}
+
+// Call with shard.mutex held
+PathRef PathTable::Lookup(Shard& shard, uint64_t hash, const std::string& key)
+{
+    auto range = shard.records.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        PathRef record = it->second.lock();
+        if (record && record->key == key)
+            return record;
+    }
+    return nullptr;
+}
+
+PathRef PathTable::InternNormalized(std::string path, size_t rootLength)
+{
+    std::string key(path);
+    std::transform(key.begin(), key.end(), key.begin(), AsciiLower);
+    uint64_t hash = HashXxh64(key.data(), key.size());
+    Shard& shard = m_shards[hash % SHARD_COUNT];
+
+    m_lookups.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (PathRef found = Lookup(shard, hash, key))
+        {
+            m_hits.fetch_add(1, std::memory_order_relaxed);
+            return found;
+        }
+    }
+
+    std::shared_ptr<PathRecord> record = std::make_shared<PathRecord>();
+    size_t separator = path.rfind('\\');
+    size_t nameOffset = separator != std::string::npos && separator + 1 > rootLength ? separator + 1 : rootLength;
+
+    // Parents are interned first (outside any lock), so siblings share one directory record
+    if (nameOffset > rootLength)
+        record->parent = InternNormalized(path.substr(0, nameOffset - 1), rootLength);
+    else if (rootLength > 0 && nameOffset < path.size())
+        record->parent = InternNormalized(path.substr(0, rootLength), rootLength);
+
+    record->id = m_nextId.fetch_add(1);
+    record->hash = hash;
+    record->rootLength = static_cast<uint32_t>(rootLength);
+    record->nameOffset = static_cast<uint32_t>(nameOffset);
+    record->extensionOffset = static_cast<uint32_t>(nameOffset < path.size() ? ExtensionOffset(path) : path.size());
+    record->wideNameOffset = Utf16Length(path, record->nameOffset);
+    record->wideExtensionOffset = Utf16Length(path, record->extensionOffset);
+    Utf8ToUtf16(path.data(), path.size(), &record->wide);
+
+    if (record->wide.size() >= LONG_PATH_LENGTH)
+    {
+        bool unc = path.size() > 2 && path[0] == '\\' && path[1] == '\\' && path[2] != '?' && path[2] != '.';
+        if (unc)
+            record->native = u"\\\\?\\UNC\\" + record->wide.substr(2);
+        else if (rootLength == 3 && path[1] == ':')
+            record->native = u"\\\\?\\" + record->wide;
+    }
+    record->path = std::move(path);
+    record->key = std::move(key);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (PathRef existing = Lookup(shard, hash, record->key))
+    {
+        // Another thread interned the same path meanwhile
+        m_hits.fetch_add(1, std::memory_order_relaxed);
+        return existing;
+    }
+    shard.records.emplace(hash, record);
+    m_created.fetch_add(1, std::memory_order_relaxed);
+
+    if (shard.records.size() >= shard.sweepAt)
+    {
+        for (auto it = shard.records.begin(); it != shard.records.end();)
+            it = it->second.expired() ? shard.records.erase(it) : std::next(it);
+        shard.sweepAt = (std::max)(shard.records.size() * 2, size_t(64));
+    }
+    return record;
+}
+
+PathTableStats PathTable::Stats() const
+{
+    PathTableStats stats = {};
+    stats.lookups = m_lookups.load(std::memory_order_relaxed);
+    stats.hits = m_hits.load(std::memory_order_relaxed);
+    stats.created = m_created.load(std::memory_order_relaxed);
+    for (const Shard& shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& entry : shard.records)
+        {
+            if (!entry.second.expired())
+                stats.live++;
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Windows path parsing done once per path. A path is normalized and interned into an immutable
+// PathRecord that carries everything the caches and schedulers derive from it (case-folded key,
+// hash, name, extension, parent directory, UTF-16 forms), so none of them re-parse the string.
+// Records are shared: interning the same path (in any case, with '/' or '\', ".", "..", doubled
+// separators or a "\\?\" prefix) returns the same record while anyone still holds it.
+// No Windows dependencies.
+
+// Paths this long (UTF-16 units) or longer need the "\\?\" prefix for Win32 file APIs. The
+// limit is MAX_PATH minus room for an 8.3 file name, the bound CreateDirectory enforces.
+const size_t LONG_PATH_LENGTH = 248;
+
+struct PathRecord
+{
+    uint64_t id;                // Unique for the table's lifetime (never reused)
+    uint64_t hash;              // XXH64 of key
+    std::string path;           // UTF-8, '\' separators, no "\\?\" prefix, "." / ".." resolved
+    std::string key;            // path with ASCII letters lowercased, as Windows compares names
+    std::u16string wide;        // path in UTF-16, for the Shell
+    std::u16string native;      // "\\?\" form for Win32 file APIs when wide is too long, else empty
+    std::shared_ptr<const PathRecord> parent;   // Containing directory; null for roots and bare names
+
+    uint32_t rootLength;        // "C:\", "\\server\share\", "\", or 0 for relative paths
+    uint32_t nameOffset;        // Last component (path.size() for a root)
+    uint32_t extensionOffset;   // '.' of the extension, path.size() if none
+    uint32_t wideNameOffset;    // Same offsets in wide
+    uint32_t wideExtensionOffset;
+
+    uint64_t ParentId() const { return parent ? parent->id : 0; }
+    std::string_view Name() const { return std::string_view(path).substr(nameOffset); }
+    std::string_view Extension() const { return std::string_view(path).substr(extensionOffset); }
+    std::string_view ExtensionKey() const { return std::string_view(key).substr(extensionOffset); }
+    std::u16string_view WideName() const { return std::u16string_view(wide).substr(wideNameOffset); }
+    std::u16string_view WideExtension() const { return std::u16string_view(wide).substr(wideExtensionOffset); }
+    const std::u16string& NativePath() const { return native.empty() ? wide : native; }
+};
+
+typedef std::shared_ptr<const PathRecord> PathRef;
+
+// Lexical normalization (no file system access): see PathRecord::path. Relative paths stay
+// relative. Returns false for an empty path.
+bool NormalizePath(std::string_view path, std::string* out, size_t* rootLength);
+
+// Offset of the extension's '.' within the last component, or path.size() if there is none
+size_t ExtensionOffset(std::string_view path);
+size_t ExtensionOffset(std::u16string_view path);
+
+struct PathTableStats
+{
+    uint64_t lookups;
+    uint64_t hits;              // Path already had a live record
+    uint64_t created;           // Records built, including parent directories
+    uint64_t live;              // Records currently held by someone
+};
+
+// Thread-safe intern table. Records stay alive while a PathRef (or a child's parent link)
+// holds them; expired entries are swept as the table grows.
+class PathTable
+{
+public:
+    PathTable();
+
+    PathTable(const PathTable&) = delete;
+    PathTable& operator=(const PathTable&) = delete;
+
+    // nullptr for an empty path
+    PathRef Intern(std::string_view utf8);
+    PathRef Intern(std::u16string_view utf16);
+
+    PathTableStats Stats() const;
+
+private:
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        std::unordered_multimap<uint64_t, std::weak_ptr<const PathRecord>> records;   // By hash
+        size_t sweepAt = 64;
+    };
+
+    static const size_t SHARD_COUNT = 16;
+
+    PathRef InternNormalized(std::string path, size_t rootLength);
+    static PathRef Lookup(Shard& shard, uint64_t hash, const std::string& key);
+
+    Shard m_shards[SHARD_COUNT];
+    std::atomic<uint64_t> m_nextId;
+    std::atomic<uint64_t> m_lookups;
+    std::atomic<uint64_t> m_hits;
+    std::atomic<uint64_t> m_created;
+};
@@ -0,0 +1,32 @@
+#include "pch.h"
+#include "PathsImpl.h"
+
+namespace
+{
+    // Leaked on purpose: records may still be released from other threads during shutdown
+    PathTable& Paths()
+    {
+        static PathTable* table = new PathTable();
+        return *table;
+    }
+}
+
+PathRef InternPath(LPCWSTR path)
+{
+    if (!path || !*path)
+        return nullptr;
+    return Paths().Intern(std::u16string_view(reinterpret_cast<const char16_t*>(path), wcslen(path)));
+}
+
+HRESULT GetPathTableStatsImpl(WSP_PATH_TABLE_STATS* pStats)
+{
+    if (!pStats)
+        return E_INVALIDARG;
+
+    PathTableStats stats = Paths().Stats();
+    pStats->lookups = stats.lookups;
+    pStats->hits = stats.hits;
+    pStats->created = stats.created;
+    pStats->live = stats.live;
+    return S_OK;
+}
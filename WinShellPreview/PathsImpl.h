@@ -0,0 +1,34 @@
+#pragma once
+#include "framework.h"
+#include "WinShellPreview.h"
+#include "PathTable.h"
+
+// Process-wide path intern table shared by the caches, the scheduler and the Shell context.
+// Returns nullptr for a null or empty path.
+PathRef InternPath(LPCWSTR path);
+
+// Normalized path for Shell APIs
+inline LPCWSTR WidePath(const PathRecord& record)
+{
+    return reinterpret_cast<LPCWSTR>(record.wide.c_str());
+}
+
+// Path for Win32 file APIs ("\\?\" form when too long for MAX_PATH)
+inline LPCWSTR NativePath(const PathRecord& record)
+{
+    return reinterpret_cast<LPCWSTR>(record.NativePath().c_str());
+}
+
+inline std::wstring WideName(const PathRecord& record)
+{
+    std::u16string_view name = record.WideName();
+    return std::wstring(reinterpret_cast<const wchar_t*>(name.data()), name.size());
+}
+
+inline std::wstring WideExtension(const PathRecord& record)
+{
+    std::u16string_view extension = record.WideExtension();
+    return std::wstring(reinterpret_cast<const wchar_t*>(extension.data()), extension.size());
+}
+
+HRESULT GetPathTableStatsImpl(WSP_PATH_TABLE_STATS* pStats);
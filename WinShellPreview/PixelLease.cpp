@@ -0,0 +1,89 @@
+#include "PixelLease.h"
+#include <cstring>
+
+bool PixelLeaseTable::Lease(PixelImage&& image, PixelDescriptor* descriptor)
+{
+    if (image.Empty() || !descriptor)
+        return false;
+
+    descriptor->pixels = image.buffer.Data();
+    descriptor->width = image.width;
+    descriptor->height = image.height;
+    descriptor->stride = image.stride;
+    descriptor->format = PixelFormat::Bgra32;
+    descriptor->alpha = image.alpha;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_bytes += image.buffer.Capacity();
+    m_leases.emplace(descriptor->pixels, std::move(image));
+    return true;
+}
+
+bool PixelLeaseTable::Release(const uint8_t* pixels)
+{
+    PixelImage image;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_leases.find(pixels);
+        if (it == m_leases.end())
+            return false;
+        m_bytes -= it->second.buffer.Capacity();
+        image = std::move(it->second);
+        m_leases.erase(it);
+    }
+    // The buffer goes back to the pool outside the lock
+    return true;
+}
+
+size_t PixelLeaseTable::Outstanding() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_leases.size();
+}
+
+uint64_t PixelLeaseTable::OutstandingBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+size_t RequiredBufferBytes(uint32_t width, uint32_t height, size_t stride)
+{
+    size_t rowBytes = static_cast<size_t>(width) * 4;
+    if (stride == 0)
+        stride = rowBytes;
+    if (stride < rowBytes || height == 0)
+        return 0;
+    // The last row only needs its pixels, not the full stride
+    return stride * (height - 1) + rowBytes;
+}
+
+bool CopyPixelsToBuffer(const PixelImage& image, uint8_t* buffer, size_t bufferSize, size_t stride,
+                        PixelDescriptor* descriptor, size_t* pRequired)
+{
+    if (image.Empty() || !descriptor)
+        return false;
+
+    size_t rowBytes = static_cast<size_t>(image.width) * 4;
+    if (stride == 0)
+        stride = rowBytes;
+
+    size_t required = RequiredBufferBytes(image.width, image.height, stride);
+    if (pRequired)
+        *pRequired = required;
+
+    descriptor->pixels = nullptr;
+    descriptor->width = image.width;
+    descriptor->height = image.height;
+    descriptor->stride = stride;
+    descriptor->format = PixelFormat::Bgra32;
+    descriptor->alpha = image.alpha;
+
+    if (required == 0 || !buffer || bufferSize < required)
+        return false;
+
+    for (uint32_t y = 0; y < image.height; ++y)
+        memcpy(buffer + y * stride, image.Row(y), rowBytes);
+    descriptor->pixels = buffer;
+    return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "ImageOps.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+// Raw pixel handoff to callers outside the library. No Windows dependencies.
+//
+// - Leased: the library keeps the pooled buffer alive and the caller gets a descriptor; the
+//   caller hands the pixel pointer back exactly once, which returns the buffer to the pool
+// - Caller buffer: pixels land in memory the caller owns, nothing to release
+
+enum class PixelFormat : uint32_t
+{
+    Bgra32 = 0          // 8 bits per channel, B G R A in memory, rows top-down
+};
+
+struct PixelDescriptor
+{
+    uint8_t* pixels = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t stride = 0;                  // Bytes per row
+    PixelFormat format = PixelFormat::Bgra32;
+    AlphaMode alpha = AlphaMode::Ignore;
+};
+
+class PixelLeaseTable
+{
+public:
+    // Takes over the image's buffer. Fails for an empty image.
+    bool Lease(PixelImage&& image, PixelDescriptor* descriptor);
+
+    // False for a pointer that is not leased (never leased or already released)
+    bool Release(const uint8_t* pixels);
+
+    size_t Outstanding() const;
+    uint64_t OutstandingBytes() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::unordered_map<const uint8_t*, PixelImage> m_leases;
+    uint64_t m_bytes = 0;
+};
+
+// Bytes a caller buffer needs for the image at the given stride (0 = width * 4); 0 if the
+// stride is too small for a row
+size_t RequiredBufferBytes(uint32_t width, uint32_t height, size_t stride);
+
+// Copies the image into buffer with the given stride (0 = width * 4) and describes the result.
+// When the buffer is too small nothing is copied, the descriptor carries the image size with
+// pixels == nullptr and *pRequired the bytes needed.
+bool CopyPixelsToBuffer(const PixelImage& image, uint8_t* buffer, size_t bufferSize, size_t stride,
+                        PixelDescriptor* descriptor, size_t* pRequired);
@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "PixelsImpl.h"
+#include "BitmapUtils.h"
+#include "IsolationImpl.h"
+#include "PixelLease.h"
+#include "ThumbnailImpl.h"
+
+namespace
+{
+    // Leaked on purpose: callers may release pixels after DLL_PROCESS_DETACH has started
+    PixelLeaseTable& Leases()
+    {
+        static PixelLeaseTable* table = new PixelLeaseTable();
+        return *table;
+    }
+
+    // Same result as GetFileThumbnail, read into the rows allocate() returns (stride bytes apart,
+    // 0 = width * 4) with the alpha type the handler reported. The descriptor gets the size as
+    // soon as it is known, so a failed allocate() still tells the caller what was needed.
+    HRESULT ReadThumbnailPixels(LPCWSTR filePath, UINT size, size_t stride,
+                                const std::function<uint8_t*(uint32_t width, uint32_t height)>& allocate, PixelDescriptor* pDescriptor)
+    {
+        HBITMAP hBitmap = nullptr;
+        WTS_ALPHATYPE alphaType = WTSAT_UNKNOWN;
+        AlphaMode isolatedAlpha = AlphaMode::Ignore;
+        bool isolated = IsHandlerIsolationEnabled();
+
+        HRESULT hr = isolated
+            ? RunIsolatedExtraction(IsolatedJobKind::Thumbnail, filePath, size, size, &hBitmap, &isolatedAlpha)
+            : ExtractFileThumbnailInProcess(filePath, size, &hBitmap, &alphaType);
+        if (FAILED(hr) || !hBitmap)
+            return FAILED(hr) ? hr : E_FAIL;
+
+        uint8_t* pixels = nullptr;
+        AlphaMode alpha = AlphaMode::Ignore;
+        hr = ReadHBITMAPPixels(hBitmap, [&allocate, &pixels, stride, pDescriptor](uint32_t width, uint32_t height)
+        {
+            pDescriptor->width = width;
+            pDescriptor->height = height;
+            pDescriptor->stride = stride ? stride : static_cast<size_t>(width) * 4;
+            pixels = allocate(width, height);
+            return pixels;
+        }, &alpha, stride);
+        DeleteObject(hBitmap);
+        if (FAILED(hr))
+            return hr;
+
+        // Alpha handling and compositing work on the destination rows in place
+        if (isolated)
+            alpha = isolatedAlpha;
+        else
+            ApplyThumbnailAlphaType(alphaType, pixels, pDescriptor->width, pDescriptor->height, pDescriptor->stride, &alpha);
+
+        COLORREF background;
+        if (alpha != AlphaMode::Ignore && GetThumbnailBackground(&background))
+        {
+            CompositeOverBackground(pixels, pDescriptor->width, pDescriptor->height, pDescriptor->stride, alpha,
+                                    GetRValue(background), GetGValue(background), GetBValue(background));
+            alpha = AlphaMode::Ignore;
+        }
+        pDescriptor->pixels = pixels;
+        pDescriptor->alpha = alpha;
+        return S_OK;
+    }
+
+    void ToPixels(const PixelDescriptor& descriptor, WSP_PIXELS* pPixels)
+    {
+        pPixels->pixels = descriptor.pixels;
+        pPixels->width = descriptor.width;
+        pPixels->height = descriptor.height;
+        pPixels->stride = static_cast<UINT>(descriptor.stride);
+        pPixels->format = WSP_PIXEL_BGRA32;
+        pPixels->alpha = static_cast<WSP_ALPHA_MODE>(descriptor.alpha);
+    }
+}
+
+HRESULT GetFileThumbnailPixelsImpl(LPCWSTR filePath, UINT size, WSP_PIXELS* pPixels)
+{
+    if (!filePath || !pPixels)
+        return E_INVALIDARG;
+
+    *pPixels = {};
+
+    PixelImage image;
+    PixelDescriptor read;
+    HRESULT hr = ReadThumbnailPixels(filePath, size, 0, [&image](uint32_t width, uint32_t height) -> uint8_t*
+    {
+        return image.Allocate(width, height) ? image.buffer.Data() : nullptr;
+    }, &read);
+    if (FAILED(hr))
+        return hr;
+
+    image.alpha = read.alpha;
+    PixelDescriptor descriptor;
+    if (!Leases().Lease(std::move(image), &descriptor))
+        return E_OUTOFMEMORY;
+
+    ToPixels(descriptor, pPixels);
+    return S_OK;
+}
+
+HRESULT GetFileThumbnailPixelsIntoImpl(LPCWSTR filePath, UINT size, BYTE* buffer, UINT bufferSize, UINT stride, WSP_PIXELS* pPixels)
+{
+    if (!filePath || !pPixels)
+        return E_INVALIDARG;
+
+    *pPixels = {};
+
+    // GetDIBits writes straight into the caller's buffer, once its size is known to be enough
+    HRESULT hrBuffer = S_OK;
+    PixelDescriptor descriptor;
+    HRESULT hr = ReadThumbnailPixels(filePath, size, stride, [buffer, bufferSize, stride, &hrBuffer](uint32_t width, uint32_t height) -> uint8_t*
+    {
+        size_t required = RequiredBufferBytes(width, height, stride);
+        if (required == 0)
+            hrBuffer = E_INVALIDARG;
+        else if (!buffer || bufferSize < required)
+            hrBuffer = HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+        return SUCCEEDED(hrBuffer) ? buffer : nullptr;
+    }, &descriptor);
+
+    // On a short buffer the descriptor still tells the caller the size to allocate
+    ToPixels(descriptor, pPixels);
+    if (FAILED(hrBuffer))
+        return hrBuffer;
+    return hr;
+}
+
+HRESULT ReleaseThumbnailPixelsImpl(const BYTE* pixels)
+{
+    if (!pixels)
+        return E_INVALIDARG;
+
+    return Leases().Release(pixels) ? S_OK : HRESULT_FROM_WIN32(ERROR_INVALID_ADDRESS);
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include "framework.h"
+#include "WinShellPreview.h"
+
+// Thumbnail pixels without an HBITMAP: leased from the library or copied into a caller buffer
+HRESULT GetFileThumbnailPixelsImpl(LPCWSTR filePath, UINT size, WSP_PIXELS* pPixels);
+HRESULT GetFileThumbnailPixelsIntoImpl(LPCWSTR filePath, UINT size, BYTE* buffer, UINT bufferSize, UINT stride, WSP_PIXELS* pPixels);
+HRESULT ReleaseThumbnailPixelsImpl(const BYTE* pixels);
@@ -0,0 +1,468 @@
+#include "PngWriter.h"
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+namespace
+{
+    const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+    inline void PutBE32(uint8_t* p, uint32_t v)
+    {
+        p[0] = static_cast<uint8_t>(v >> 24);
+        p[1] = static_cast<uint8_t>(v >> 16);
+        p[2] = static_cast<uint8_t>(v >> 8);
+        p[3] = static_cast<uint8_t>(v);
+    }
+
+    inline uint8_t Paeth(int a, int b, int c)
+    {
+        int p = a + b - c;
+        int pa = std::abs(p - a);
+        int pb = std::abs(p - b);
+        int pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc)
+            return static_cast<uint8_t>(a);
+        return static_cast<uint8_t>(pb <= pc ? b : c);
+    }
+
+    inline uint8_t Unpremultiply(uint8_t value, uint8_t alpha)
+    {
+        if (alpha == 0)
+            return 0;
+        unsigned v = (value * 255u + alpha / 2) / alpha;
+        return static_cast<uint8_t>(v > 255 ? 255 : v);
+    }
+
+    struct DeflatedChunk
+    {
+        uint32_t firstRow = 0;
+        uint32_t rows = 0;
+        std::vector<uint8_t> data;
+        uint32_t adler = 1;
+        uint64_t size = 0;
+        std::atomic<bool> done{false};
+    };
+
+    // Filters chunk.rows rows and compresses them as a standalone run of deflate blocks. The
+    // rows before the chunk are filtered again to rebuild the window a serial encoder would have.
+    void DeflateChunk(const PixelImage& image, int level, DeflatedChunk* chunk)
+    {
+        PngRowFilter filter;
+        filter.Reset(image.width, image.alpha);
+        const size_t rowBytes = filter.FilteredRowBytes();
+
+        uint32_t historyRows = static_cast<uint32_t>((std::min)(
+            static_cast<size_t>(chunk->firstRow), (DeflateEncoder::WINDOW_SIZE + rowBytes - 1) / rowBytes));
+        uint32_t y = chunk->firstRow - historyRows;
+        if (y > 0)
+            filter.SetPriorRow(image.Row(y - 1));
+
+        std::vector<uint8_t> history;
+        history.reserve(historyRows * rowBytes);
+        for (; y < chunk->firstRow; ++y)
+        {
+            const uint8_t* row = filter.FilterRow(image.Row(y));
+            history.insert(history.end(), row, row + rowBytes);
+        }
+
+        std::vector<uint8_t> filtered;
+        filtered.reserve(chunk->rows * rowBytes);
+        for (uint32_t end = chunk->firstRow + chunk->rows; y < end; ++y)
+        {
+            const uint8_t* row = filter.FilterRow(image.Row(y));
+            filtered.insert(filtered.end(), row, row + rowBytes);
+        }
+
+        DeflateEncoder encoder(level);
+        if (!history.empty())
+            encoder.SetDictionary(history.data(), history.size());
+        encoder.Write(filtered.data(), filtered.size(), &chunk->data);
+        encoder.Flush(DeflateFlush::Sync, &chunk->data);
+        chunk->adler = Adler32(1, filtered.data(), filtered.size());
+        chunk->size = filtered.size();
+        chunk->done.store(true);
+    }
+}
+
+PngRowFilter::PngRowFilter()
+    : m_width(0), m_channels(0), m_alpha(AlphaMode::Ignore)
+{
+}
+
+void PngRowFilter::Reset(uint32_t width, AlphaMode alpha)
+{
+    m_width = width;
+    m_alpha = alpha;
+    m_channels = (alpha == AlphaMode::Ignore) ? 3 : 4;
+
+    size_t rowBytes = static_cast<size_t>(width) * m_channels;
+    m_row.resize(rowBytes);
+    m_prior.assign(rowBytes, 0);
+    m_filtered.resize(rowBytes + 1);
+    m_candidate.resize(rowBytes + 1);
+}
+
+void PngRowFilter::Convert(const uint8_t* bgra, uint8_t* out) const
+{
+    for (uint32_t x = 0; x < m_width; ++x, bgra += 4)
+    {
+        uint8_t a = bgra[3];
+        if (m_alpha == AlphaMode::Premultiplied && a != 255)
+        {
+            out[0] = Unpremultiply(bgra[2], a);
+            out[1] = Unpremultiply(bgra[1], a);
+            out[2] = Unpremultiply(bgra[0], a);
+        }
+        else
+        {
+            out[0] = bgra[2];
+            out[1] = bgra[1];
+            out[2] = bgra[0];
+        }
+        if (m_channels == 4)
+            out[3] = a;
+        out += m_channels;
+    }
+}
+
+void PngRowFilter::SetPriorRow(const uint8_t* bgra)
+{
+    Convert(bgra, m_prior.data());
+}
+
+const uint8_t* PngRowFilter::FilterRow(const uint8_t* bgra)
+{
+    Convert(bgra, m_row.data());
+
+    // Pick the filter with the smallest sum of absolute (signed) residuals, as libpng does
+    const size_t bpp = m_channels;
+    const size_t n = m_row.size();
+    const uint8_t* cur = m_row.data();
+    const uint8_t* up = m_prior.data();
+    uint64_t bestCost = UINT64_MAX;
+
+    for (uint8_t filter = 0; filter <= 4; ++filter)
+    {
+        uint8_t* out = m_candidate.data() + 1;
+        m_candidate[0] = filter;
+
+        // The first pixel has no left neighbour; predicting from zero covers it for every filter
+        for (size_t i = 0; i < bpp; ++i)
+        {
+            uint8_t predicted = filter == 2 || filter == 4 ? up[i] : filter == 3 ? static_cast<uint8_t>(up[i] >> 1) : 0;
+            out[i] = static_cast<uint8_t>(cur[i] - predicted);
+        }
+        switch (filter)
+        {
+        case 0:
+            memcpy(out, cur, n);
+            break;
+        case 1:
+            for (size_t i = bpp; i < n; ++i)
+                out[i] = static_cast<uint8_t>(cur[i] - cur[i - bpp]);
+            break;
+        case 2:
+            for (size_t i = bpp; i < n; ++i)
+                out[i] = static_cast<uint8_t>(cur[i] - up[i]);
+            break;
+        case 3:
+            for (size_t i = bpp; i < n; ++i)
+                out[i] = static_cast<uint8_t>(cur[i] - ((cur[i - bpp] + up[i]) >> 1));
+            break;
+        default:
+            for (size_t i = bpp; i < n; ++i)
+                out[i] = static_cast<uint8_t>(cur[i] - Paeth(cur[i - bpp], up[i], up[i - bpp]));
+            break;
+        }
+
+        uint64_t cost = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            int8_t residual = static_cast<int8_t>(out[i]);
+            cost += static_cast<uint64_t>(residual < 0 ? -residual : residual);
+        }
+        if (cost < bestCost)
+        {
+            bestCost = cost;
+            m_filtered.swap(m_candidate);
+        }
+    }
+
+    m_prior.swap(m_row);
+    return m_filtered.data();
+}
+
+PngWriter::PngWriter(Sink sink, int level)
+    : m_sink(std::move(sink)), m_zlib(level), m_width(0), m_height(0), m_rowsWritten(0),
+      m_channels(0), m_failed(false)
+{
+}
+
+bool PngWriter::WriteChunk(const char type[4], const uint8_t* data, size_t size)
+{
+    if (m_failed)
+        return false;
+
+    uint8_t header[8];
+    PutBE32(header, static_cast<uint32_t>(size));
+    memcpy(header + 4, type, 4);
+
+    uint32_t crc = Crc32(0, header + 4, 4);
+    crc = Crc32(crc, data, size);
+    uint8_t trailer[4];
+    PutBE32(trailer, crc);
+
+    if (!m_sink(header, 8) || (size && !m_sink(data, size)) || !m_sink(trailer, 4))
+        m_failed = true;
+    return !m_failed;
+}
+
+bool PngWriter::Begin(uint32_t width, uint32_t height, AlphaMode alpha)
+{
+    if (width == 0 || height == 0 || m_width != 0)
+        return false;
+
+    m_width = width;
+    m_height = height;
+    m_filter.Reset(width, alpha);
+    m_channels = m_filter.Channels();
+
+    if (!m_sink(PNG_SIGNATURE, sizeof(PNG_SIGNATURE)))
+    {
+        m_failed = true;
+        return false;
+    }
+
+    uint8_t ihdr[13];
+    PutBE32(ihdr, width);
+    PutBE32(ihdr + 4, height);
+    ihdr[8] = 8;                                // Bit depth
+    ihdr[9] = m_channels == 4 ? 6 : 2;          // Truecolor with / without alpha
+    ihdr[10] = 0;                               // Deflate
+    ihdr[11] = 0;                               // Adaptive filtering
+    ihdr[12] = 0;                               // No interlace
+    return WriteChunk("IHDR", ihdr, sizeof(ihdr));
+}
+
+bool PngWriter::EmitIdat(bool force)
+{
+    const size_t chunkSize = IDAT_CHUNK_SIZE;
+    while (m_compressed.size() >= chunkSize || (force && !m_compressed.empty()))
+    {
+        size_t size = (std::min)(m_compressed.size(), chunkSize);
+        if (!WriteChunk("IDAT", m_compressed.data(), size))
+            return false;
+        m_compressed.erase(m_compressed.begin(), m_compressed.begin() + size);
+    }
+    return !m_failed;
+}
+
+bool PngWriter::WriteRow(const uint8_t* bgra)
+{
+    if (m_failed || m_width == 0 || m_rowsWritten >= m_height)
+        return false;
+
+    const uint8_t* filtered = m_filter.FilterRow(bgra);
+    m_zlib.Write(filtered, m_filter.FilteredRowBytes(), &m_compressed);
+    m_rowsWritten++;
+    return EmitIdat(false);
+}
+
+bool PngWriter::WriteFilteredRows(const uint8_t* filtered, uint32_t rows)
+{
+    if (m_failed || m_width == 0 || rows > m_height - m_rowsWritten)
+        return false;
+
+    m_zlib.Write(filtered, m_filter.FilteredRowBytes() * rows, &m_compressed);
+    m_rowsWritten += rows;
+    return EmitIdat(false);
+}
+
+bool PngWriter::WriteDeflatedRows(const uint8_t* deflate, size_t deflateSize, uint32_t rows, uint32_t adler, uint64_t size)
+{
+    if (m_failed || m_width == 0 || rows > m_height - m_rowsWritten)
+        return false;
+
+    m_zlib.WriteDeflated(deflate, deflateSize, adler, size, &m_compressed);
+    m_rowsWritten += rows;
+    return EmitIdat(false);
+}
+
+bool PngWriter::Flush()
+{
+    if (m_failed || m_width == 0)
+        return false;
+    m_zlib.Flush(DeflateFlush::Sync, &m_compressed);
+    return EmitIdat(true);
+}
+
+bool PngWriter::Finish()
+{
+    if (m_failed || m_width == 0 || m_rowsWritten != m_height)
+        return false;
+
+    m_zlib.Flush(DeflateFlush::Finish, &m_compressed);
+    if (!EmitIdat(true))
+        return false;
+    return WriteChunk("IEND", nullptr, 0);
+}
+
+bool EncodePng(const PixelImage& image, std::vector<uint8_t>* out, int level)
+{
+    if (image.Empty() || !out)
+        return false;
+
+    PngWriter writer([out](const uint8_t* data, size_t size)
+    {
+        out->insert(out->end(), data, data + size);
+        return true;
+    }, level);
+
+    if (!writer.Begin(image.width, image.height, image.alpha))
+        return false;
+    for (uint32_t y = 0; y < image.height; ++y)
+    {
+        if (!writer.WriteRow(image.Row(y)))
+            return false;
+    }
+    return writer.Finish();
+}
+
+bool SavePixelImageAsPng(const PixelImage& image, const std::filesystem::path& path, int level)
+{
+    if (image.Empty())
+        return false;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    PngWriter writer([&file](const uint8_t* data, size_t size)
+    {
+        file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(file);
+    }, level);
+
+    if (!writer.Begin(image.width, image.height, image.alpha))
+        return false;
+    for (uint32_t y = 0; y < image.height; ++y)
+    {
+        if (!writer.WriteRow(image.Row(y)))
+            return false;
+    }
+    if (!writer.Finish())
+        return false;
+
+    file.close();
+    return static_cast<bool>(file);
+}
+
+bool WritePngParallel(const PixelImage& image, const PngWriter::Sink& sink, int level, const ParallelPngOptions& options)
+{
+    if (image.Empty())
+        return false;
+
+    PngWriter writer(sink, level);
+    if (!writer.Begin(image.width, image.height, image.alpha))
+        return false;
+
+    size_t rowBytes = static_cast<size_t>(image.width) * (image.alpha == AlphaMode::Ignore ? 3 : 4) + 1;
+    uint32_t chunkRows = static_cast<uint32_t>((std::min)(
+        (std::max)((options.chunkBytes + rowBytes - 1) / rowBytes, size_t(1)), static_cast<size_t>(image.height)));
+    size_t chunkCount = (image.height + chunkRows - 1) / chunkRows;
+
+    std::vector<std::unique_ptr<DeflatedChunk>> chunks(chunkCount);
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        chunks[i].reset(new DeflatedChunk());
+        chunks[i]->firstRow = static_cast<uint32_t>(i * chunkRows);
+        chunks[i]->rows = (std::min)(chunkRows, image.height - chunks[i]->firstRow);
+    }
+
+    // The calling thread stitches and helps compress, so a private pool needs one thread less
+    uint32_t threads = options.threads ? options.threads : (std::max)(std::thread::hardware_concurrency(), 1u);
+    std::unique_ptr<WorkStealingPool> ownPool;
+    WorkStealingPool* pool = options.pool;
+    if (!pool && threads > 1 && chunkCount > 1)
+    {
+        ownPool.reset(new WorkStealingPool(threads - 1, threads * 2));
+        pool = ownPool.get();
+    }
+
+    // Keep a bounded window of chunks in flight ahead of the one being written
+    size_t window = pool ? static_cast<size_t>(pool->ThreadCount()) * 2 + 1 : 1;
+    size_t submitted = 0;
+    bool ok = true;
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        for (; submitted < chunkCount && submitted < i + window; ++submitted)
+        {
+            DeflatedChunk* chunk = chunks[submitted].get();
+            if (pool)
+                pool->Submit([&image, level, chunk]() { DeflateChunk(image, level, chunk); });
+            else
+                DeflateChunk(image, level, chunk);
+        }
+
+        DeflatedChunk& chunk = *chunks[i];
+        if (pool)
+            pool->RunUntil([&chunk]() { return chunk.done.load(); });
+        ok = writer.WriteDeflatedRows(chunk.data.data(), chunk.data.size(), chunk.rows, chunk.adler, chunk.size);
+        std::vector<uint8_t>().swap(chunk.data);
+        if (!ok)
+            break;
+    }
+
+    // Chunks still queued after a failed write reference this frame
+    if (pool)
+    {
+        pool->RunUntil([&chunks, submitted]()
+        {
+            for (size_t i = 0; i < submitted; ++i)
+            {
+                if (!chunks[i]->done.load())
+                    return false;
+            }
+            return true;
+        });
+    }
+    return ok && writer.Finish();
+}
+
+bool EncodePngParallel(const PixelImage& image, std::vector<uint8_t>* out, int level, const ParallelPngOptions& options)
+{
+    if (!out)
+        return false;
+
+    return WritePngParallel(image, [out](const uint8_t* data, size_t size)
+    {
+        out->insert(out->end(), data, data + size);
+        return true;
+    }, level, options);
+}
+
+bool SavePixelImageAsPngParallel(const PixelImage& image, const std::filesystem::path& path, int level, const ParallelPngOptions& options)
+{
+    if (image.Empty())
+        return false;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    bool written = WritePngParallel(image, [&file](const uint8_t* data, size_t size)
+    {
+        file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(file);
+    }, level, options);
+    if (!written)
+        return false;
+
+    file.close();
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "Deflate.h"
+#include "ImageOps.h"
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+// Converts 32bpp BGRA rows to PNG scanlines (RGB or RGBA) and applies the adaptive filter.
+// Rows are independent given the previous row, so separate filters can prepare different
+// bands of one image in parallel. No Windows dependencies.
+class PngRowFilter
+{
+public:
+    PngRowFilter();
+
+    void Reset(uint32_t width, AlphaMode alpha);
+
+    // Sets the row above the next one (a band's first row is filtered against the previous
+    // band's last). Without it the next row is filtered against zeros, as the image's first is.
+    void SetPriorRow(const uint8_t* bgra);
+
+    // Returns the filter byte followed by the filtered scanline (FilteredRowBytes() bytes),
+    // valid until the next call
+    const uint8_t* FilterRow(const uint8_t* bgra);
+
+    size_t FilteredRowBytes() const { return m_filtered.size(); }
+    size_t Channels() const { return m_channels; }
+
+private:
+    void Convert(const uint8_t* bgra, uint8_t* out) const;
+
+    uint32_t m_width;
+    size_t m_channels;
+    AlphaMode m_alpha;
+    std::vector<uint8_t> m_row;         // Current row converted to RGB(A)
+    std::vector<uint8_t> m_prior;       // Previous converted row (zeros before the first)
+    std::vector<uint8_t> m_filtered;    // Filter byte + filtered row
+    std::vector<uint8_t> m_candidate;
+};
+
+// Streaming PNG encoder over DeflateEncoder. Rows are filtered and compressed as they arrive,
+// and IDAT chunks are handed to the sink as soon as they fill, so an image never has to be
+// held in memory in full. No Windows dependencies.
+class PngWriter
+{
+public:
+    static const size_t IDAT_CHUNK_SIZE = 64 * 1024;
+
+    // Receives encoded bytes in order; return false to abort
+    typedef std::function<bool(const uint8_t* data, size_t size)> Sink;
+
+    explicit PngWriter(Sink sink, int level = 6);
+
+    // Ignore -> 8-bit RGB; Straight/Premultiplied -> 8-bit RGBA (premultiplied input is unpremultiplied)
+    bool Begin(uint32_t width, uint32_t height, AlphaMode alpha);
+
+    // One row of `width` 32bpp BGRA pixels, top to bottom
+    bool WriteRow(const uint8_t* bgra);
+
+    // Rows already prepared by a PngRowFilter with the same width and alpha, in order
+    bool WriteFilteredRows(const uint8_t* filtered, uint32_t rows);
+
+    // Rows filtered and deflated elsewhere (see WritePngParallel): `deflate` holds non-final
+    // blocks ending in a sync flush, `adler` and `size` describe the filtered bytes. Don't
+    // follow with WriteRow, whose filter has not seen these rows.
+    bool WriteDeflatedRows(const uint8_t* deflate, size_t deflateSize, uint32_t rows, uint32_t adler, uint64_t size);
+
+    // Makes everything written so far decodable by a streaming reader (zlib sync flush)
+    bool Flush();
+
+    bool Finish();
+
+    uint32_t RowsWritten() const { return m_rowsWritten; }
+
+private:
+    bool WriteChunk(const char type[4], const uint8_t* data, size_t size);
+    bool EmitIdat(bool force);
+
+    Sink m_sink;
+    ZlibEncoder m_zlib;
+    PngRowFilter m_filter;
+    uint32_t m_width;
+    uint32_t m_height;
+    uint32_t m_rowsWritten;
+    size_t m_channels;
+    bool m_failed;
+    std::vector<uint8_t> m_compressed;
+};
+
+bool EncodePng(const PixelImage& image, std::vector<uint8_t>* out, int level = 6);
+bool SavePixelImageAsPng(const PixelImage& image, const std::filesystem::path& path, int level = 6);
+
+class WorkStealingPool;
+
+// Parallel deflate in the style of pigz: the image is cut into chunks of whole rows, each chunk
+// is filtered and compressed on its own (primed with the previous chunk's last 32KB so matches
+// still reach back across the cut) and ends in a sync flush, and the chunks are stitched in
+// order with a combined Adler-32. The output depends only on chunkBytes, not on the thread count.
+struct ParallelPngOptions
+{
+    uint32_t threads = 0;               // 0 = hardware threads; ignored when pool is set
+    size_t chunkBytes = 256 * 1024;     // Filtered bytes per chunk, rounded up to whole rows
+    WorkStealingPool* pool = nullptr;   // Run chunks here (also from inside one of its tasks)
+};
+
+// Below this size the serial writer is about as fast
+const uint64_t PARALLEL_PNG_MIN_PIXELS = 1024 * 1024;
+
+bool WritePngParallel(const PixelImage& image, const PngWriter::Sink& sink, int level = 6,
+                      const ParallelPngOptions& options = ParallelPngOptions());
+bool EncodePngParallel(const PixelImage& image, std::vector<uint8_t>* out, int level = 6,
+                       const ParallelPngOptions& options = ParallelPngOptions());
+bool SavePixelImageAsPngParallel(const PixelImage& image, const std::filesystem::path& path, int level = 6,
+                                 const ParallelPngOptions& options = ParallelPngOptions());
@@ -0,0 +1,424 @@
+#include "pch.h"
+#include "PregeneratorImpl.h"
+#include "DirectoryWalker.h"
+#include "PreviewHandler.h"
+#include "ShellContext.h"
+#include "ThrottleController.h"
+#include "ThumbnailImpl.h"
+#include <pdh.h>
+#include <algorithm>
+#include <atomic>
+#include <cwctype>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#pragma comment(lib, "pdh.lib")
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const ULONGLONG CHECKPOINT_INTERVAL_MS = 10000;
+    const ULONGLONG CHECKPOINT_INTERVAL_FILES = 64;
+
+    // Files that must not be opened in the background: cloud placeholders would be downloaded
+    const DWORD SKIP_ATTRIBUTES = FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM | FILE_ATTRIBUTE_TEMPORARY |
+                                  FILE_ATTRIBUTE_OFFLINE | FILE_ATTRIBUTE_RECALL_ON_OPEN |
+                                  FILE_ATTRIBUTE_RECALL_ON_DATA_ACCESS;
+
+    // Shared with the interactive entry points even when no generator is running
+    ThrottleController& Throttle()
+    {
+        static ThrottleController* throttle = new ThrottleController();
+        return *throttle;
+    }
+
+    std::atomic<ULONGLONG> g_filesVisited{0};
+    std::atomic<ULONGLONG> g_generated{0};
+    std::atomic<ULONGLONG> g_alreadyCached{0};
+    std::atomic<ULONGLONG> g_failures{0};
+    std::atomic<ULONGLONG> g_throttledMs{0};
+
+    // System CPU load from GetSystemTimes deltas
+    class CpuSampler
+    {
+    public:
+        CpuSampler() : m_idle(0), m_total(0) { Sample(); }
+
+        double Sample()
+        {
+            FILETIME idle, kernel, user;
+            if (!GetSystemTimes(&idle, &kernel, &user))
+                return -1.0;
+
+            ULONGLONG idleNow = ToUInt64(idle);
+            ULONGLONG totalNow = ToUInt64(kernel) + ToUInt64(user);   // Kernel time includes idle
+            ULONGLONG idleDelta = idleNow - m_idle;
+            ULONGLONG totalDelta = totalNow - m_total;
+            m_idle = idleNow;
+            m_total = totalNow;
+
+            if (totalDelta == 0)
+                return -1.0;
+            return 1.0 - static_cast<double>(idleDelta) / totalDelta;
+        }
+
+    private:
+        static ULONGLONG ToUInt64(const FILETIME& ft)
+        {
+            return (static_cast<ULONGLONG>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+        }
+
+        ULONGLONG m_idle;
+        ULONGLONG m_total;
+    };
+
+    // Disk queue length from the PhysicalDisk performance counter; unknown if PDH is unavailable
+    class DiskQueueSampler
+    {
+    public:
+        DiskQueueSampler() : m_query(nullptr), m_counter(nullptr)
+        {
+            if (PdhOpenQueryW(nullptr, 0, &m_query) != ERROR_SUCCESS)
+            {
+                m_query = nullptr;
+                return;
+            }
+            if (PdhAddEnglishCounterW(m_query, L"\\PhysicalDisk(_Total)\\Current Disk Queue Length", 0, &m_counter) != ERROR_SUCCESS)
+            {
+                PdhCloseQuery(m_query);
+                m_query = nullptr;
+            }
+        }
+
+        ~DiskQueueSampler()
+        {
+            if (m_query)
+                PdhCloseQuery(m_query);
+        }
+
+        double Sample()
+        {
+            if (!m_query || PdhCollectQueryData(m_query) != ERROR_SUCCESS)
+                return -1.0;
+
+            PDH_FMT_COUNTERVALUE value = {};
+            if (PdhGetFormattedCounterValue(m_counter, PDH_FMT_DOUBLE, nullptr, &value) != ERROR_SUCCESS)
+                return -1.0;
+            return value.doubleValue;
+        }
+
+    private:
+        PDH_HQUERY m_query;
+        PDH_HCOUNTER m_counter;
+    };
+
+    struct PregenerationJob
+    {
+        std::vector<fs::path> roots;
+        std::vector<UINT> sizes;
+        std::vector<std::wstring> extensions;   // Lowercased with leading dot; empty = all
+        fs::path checkpointPath;
+    };
+
+    class Pregenerator
+    {
+    public:
+        explicit Pregenerator(PregenerationJob job)
+            : m_job(std::move(job)), m_stopEvent(CreateEventW(nullptr, TRUE, FALSE, nullptr)), m_finished(false)
+        {
+        }
+
+        ~Pregenerator()
+        {
+            Stop();
+            if (m_stopEvent)
+                CloseHandle(m_stopEvent);
+        }
+
+        bool Start()
+        {
+            if (!m_stopEvent)
+                return false;
+            m_thread = std::thread(&Pregenerator::Run, this);
+            return true;
+        }
+
+        void Stop()
+        {
+            if (!m_thread.joinable())
+                return;
+            SetEvent(m_stopEvent);
+            m_thread.join();
+        }
+
+        bool Running() const { return m_thread.joinable() && !m_finished; }
+
+    private:
+        bool Stopped() const { return WaitForSingleObject(m_stopEvent, 0) == WAIT_OBJECT_0; }
+
+        // Blocks until the throttle allows the next unit of work; false if stopped meanwhile
+        bool WaitForTurn()
+        {
+            for (;;)
+            {
+                ThrottleSample sample = { m_cpu.Sample(), m_disk.Sample() };
+                uint32_t delay = Throttle().NextDelayMs(sample, GetTickCount64());
+                if (delay == 0)
+                    return !Stopped();
+
+                g_throttledMs.fetch_add(delay, std::memory_order_relaxed);
+                if (WaitForSingleObject(m_stopEvent, delay) == WAIT_OBJECT_0)
+                    return false;
+            }
+        }
+
+        bool ShouldProcess(const fs::path& file) const
+        {
+            DWORD attributes = GetFileAttributesW(file.c_str());
+            if (attributes == INVALID_FILE_ATTRIBUTES || (attributes & SKIP_ATTRIBUTES))
+                return false;
+
+            if (m_job.extensions.empty())
+                return true;
+
+            std::wstring extension = file.extension().native();
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::towlower);
+            return std::find(m_job.extensions.begin(), m_job.extensions.end(), extension) != m_job.extensions.end();
+        }
+
+        void ProcessFile(const fs::path& file)
+        {
+            for (UINT size : m_job.sizes)
+            {
+                if (!WaitForTurn())
+                    return;
+
+                PreviewHandler handler;
+                HBITMAP hCached = nullptr;
+                WTS_ALPHATYPE alphaType;
+                if (SUCCEEDED(handler.GetThumbnailFromCache(file.c_str(), size, &hCached, &alphaType)) && hCached)
+                {
+                    DeleteObject(hCached);
+                    g_alreadyCached.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                // Extraction goes through IThumbnailCache with WTS_EXTRACT, which stores the result
+                HBITMAP hBitmap = nullptr;
+                HRESULT hr = GetFileThumbnailImpl(file.c_str(), size, &hBitmap);
+                if (SUCCEEDED(hr) && hBitmap)
+                {
+                    DeleteObject(hBitmap);
+                    g_generated.fetch_add(1, std::memory_order_relaxed);
+                }
+                else
+                {
+                    g_failures.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        void Run()
+        {
+            HRESULT hrCo = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
+            // Lowers CPU, I/O and memory priority for everything this thread does
+            SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+
+            DirectoryWalker walker(m_job.roots);
+            WalkCheckpoint checkpoint;
+            uint64_t signature = ComputeRootsSignature(m_job.roots);
+            if (!m_job.checkpointPath.empty() && LoadWalkCheckpoint(m_job.checkpointPath, &checkpoint) &&
+                checkpoint.rootsSignature == signature)
+            {
+                walker.ResumeAfter(checkpoint.rootIndex, checkpoint.lastCompleted);
+            }
+            else
+            {
+                checkpoint = WalkCheckpoint();
+                checkpoint.rootsSignature = signature;
+            }
+
+            ULONGLONG lastSave = GetTickCount64();
+            ULONGLONG unsaved = 0;
+            bool completed = false;
+
+            for (;;)
+            {
+                if (Stopped())
+                    break;
+
+                fs::path file;
+                if (!walker.Next(&file))
+                {
+                    completed = true;
+                    break;
+                }
+
+                g_filesVisited.fetch_add(1, std::memory_order_relaxed);
+                if (ShouldProcess(file))
+                {
+                    ProcessFile(file);
+                    if (Stopped())
+                        break;  // The file may be incomplete; redo it on resume
+                }
+
+                checkpoint.rootIndex = walker.CurrentRoot();
+                checkpoint.lastCompleted = file;
+                checkpoint.filesCompleted++;
+                unsaved++;
+
+                if (!m_job.checkpointPath.empty() &&
+                    (unsaved >= CHECKPOINT_INTERVAL_FILES || GetTickCount64() - lastSave >= CHECKPOINT_INTERVAL_MS))
+                {
+                    SaveWalkCheckpoint(m_job.checkpointPath, checkpoint);
+                    lastSave = GetTickCount64();
+                    unsaved = 0;
+                }
+            }
+
+            if (!m_job.checkpointPath.empty())
+            {
+                if (completed)
+                {
+                    // A finished pass starts over next time
+                    std::error_code ec;
+                    fs::remove(m_job.checkpointPath, ec);
+                }
+                else if (unsaved)
+                {
+                    SaveWalkCheckpoint(m_job.checkpointPath, checkpoint);
+                }
+            }
+
+            SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+            ShellContext::ReleaseCurrentThread();
+            if (SUCCEEDED(hrCo))
+                CoUninitialize();
+            m_finished = true;
+        }
+
+        PregenerationJob m_job;
+        HANDLE m_stopEvent;
+        CpuSampler m_cpu;
+        DiskQueueSampler m_disk;
+        std::atomic<bool> m_finished;
+        std::thread m_thread;
+    };
+
+    std::mutex g_pregeneratorLock;
+    // Intentionally leaked unless StopPregeneration is called (same reason as the scheduler)
+    Pregenerator* g_pregenerator = nullptr;
+
+    std::vector<std::wstring> ParseExtensions(LPCWSTR list)
+    {
+        std::vector<std::wstring> extensions;
+        if (!list)
+            return extensions;
+
+        std::wstring current;
+        for (LPCWSTR p = list;; ++p)
+        {
+            if (*p == L';' || *p == L'\0')
+            {
+                if (!current.empty())
+                {
+                    if (current[0] != L'.')
+                        current.insert(current.begin(), L'.');
+                    std::transform(current.begin(), current.end(), current.begin(), ::towlower);
+                    extensions.push_back(current);
+                    current.clear();
+                }
+                if (*p == L'\0')
+                    break;
+            }
+            else if (*p != L' ')
+            {
+                current.push_back(*p);
+            }
+        }
+        return extensions;
+    }
+}
+
+HRESULT StartPregenerationImpl(const WSP_PREGENERATION_OPTIONS* pOptions)
+{
+    if (!pOptions || !pOptions->roots || pOptions->rootCount == 0 || !pOptions->sizes || pOptions->sizeCount == 0)
+        return E_INVALIDARG;
+
+    PregenerationJob job;
+    for (UINT i = 0; i < pOptions->rootCount; ++i)
+    {
+        if (!pOptions->roots[i] || !*pOptions->roots[i])
+            return E_INVALIDARG;
+        job.roots.push_back(fs::path(pOptions->roots[i]));
+    }
+    for (UINT i = 0; i < pOptions->sizeCount; ++i)
+    {
+        if (pOptions->sizes[i] == 0)
+            return E_INVALIDARG;
+        job.sizes.push_back(pOptions->sizes[i]);
+    }
+    job.extensions = ParseExtensions(pOptions->extensions);
+    if (pOptions->checkpointPath)
+        job.checkpointPath = pOptions->checkpointPath;
+
+    std::lock_guard<std::mutex> lock(g_pregeneratorLock);
+    if (g_pregenerator && g_pregenerator->Running())
+        return HRESULT_FROM_WIN32(ERROR_BUSY);
+
+    delete g_pregenerator;
+    g_pregenerator = new (std::nothrow) Pregenerator(std::move(job));
+    if (!g_pregenerator)
+        return E_OUTOFMEMORY;
+
+    if (!g_pregenerator->Start())
+    {
+        delete g_pregenerator;
+        g_pregenerator = nullptr;
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+    return S_OK;
+}
+
+void StopPregenerationImpl()
+{
+    Pregenerator* pregenerator = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_pregeneratorLock);
+        pregenerator = g_pregenerator;
+        g_pregenerator = nullptr;
+    }
+    // Saves the checkpoint and joins the thread
+    delete pregenerator;
+}
+
+void GetPregenerationStatsImpl(WSP_PREGENERATION_STATS* pStats)
+{
+    pStats->filesVisited = g_filesVisited.load(std::memory_order_relaxed);
+    pStats->thumbnailsGenerated = g_generated.load(std::memory_order_relaxed);
+    pStats->alreadyCached = g_alreadyCached.load(std::memory_order_relaxed);
+    pStats->failures = g_failures.load(std::memory_order_relaxed);
+    pStats->throttledMs = g_throttledMs.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(g_pregeneratorLock);
+    pStats->running = (g_pregenerator && g_pregenerator->Running()) ? TRUE : FALSE;
+}
+
+void ForegroundRequestBegin()
+{
+    Throttle().ForegroundBegin(GetTickCount64());
+}
+
+void ForegroundRequestEnd()
+{
+    Throttle().ForegroundEnd(GetTickCount64());
+}
+
+void NoteForegroundActivity()
+{
+    ULONGLONG now = GetTickCount64();
+    Throttle().ForegroundBegin(now);
+    Throttle().ForegroundEnd(now);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "framework.h"
+#include "WinShellPreview.h"
+
+// Background thumbnail pre-generation over configured roots
+HRESULT StartPregenerationImpl(const WSP_PREGENERATION_OPTIONS* pOptions);
+void StopPregenerationImpl();
+void GetPregenerationStatsImpl(WSP_PREGENERATION_STATS* pStats);
+
+// Marks an interactive request so background generation yields to it
+void ForegroundRequestBegin();
+void ForegroundRequestEnd();
+
+// Activity without a duration (e.g. an asynchronous submission)
+void NoteForegroundActivity();
+
+class ForegroundRequestScope
+{
+public:
+    ForegroundRequestScope() { ForegroundRequestBegin(); }
+    ~ForegroundRequestScope() { ForegroundRequestEnd(); }
+
+    ForegroundRequestScope(const ForegroundRequestScope&) = delete;
+    ForegroundRequestScope& operator=(const ForegroundRequestScope&) = delete;
+};
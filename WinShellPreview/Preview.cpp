@@ -1,8 +1,12 @@
 #include "pch.h"
 #include "PreviewImpl.h"
 #include "PreviewHandler.h"
+#include "CoalescingImpl.h"
+#include "IsolationImpl.h"
+#include "HandlersImpl.h"
+#include <fstream>
 
-HRESULT GetFilePreviewImpl(LPCWSTR filePath, UINT width, UINT height, HBITMAP* phBitmap)
+HRESULT ExtractFilePreviewInProcess(LPCWSTR filePath, UINT width, UINT height, HBITMAP* phBitmap)
 {
     if (!filePath || !phBitmap)
         return E_INVALIDARG;
@@ -13,3 +17,54 @@ HRESULT GetFilePreviewImpl(LPCWSTR filePath, UINT width, UINT height, HBITMAP* p
     return handler.GetPreviewBitmap(filePath, width, height, phBitmap);
 }
 
+static HRESULT ExtractFilePreview(LPCWSTR filePath, UINT width, UINT height, HBITMAP* phBitmap)
+{
+    if (IsHandlerIsolationEnabled())
+        return RunIsolatedExtraction(IsolatedJobKind::Preview, filePath, width, height, phBitmap);
+    return ExtractFilePreviewInProcess(filePath, width, height, phBitmap);
+}
+
+HRESULT GetFilePreviewImpl(LPCWSTR filePath, UINT width, UINT height, HBITMAP* phBitmap)
+{
+    if (!filePath || !phBitmap)
+        return E_INVALIDARG;
+
+    *phBitmap = nullptr;
+
+    // Cached per extension: files without a preview handler never reach a worker or STA thread
+    HRESULT hr = FindPreviewHandlerClsid(filePath, nullptr);
+    if (hr == HRESULT_FROM_WIN32(ERROR_NO_ASSOCIATION))
+        return hr;
+
+    return RunCoalesced(CoalesceMode::Preview, filePath, width, height, phBitmap,
+        [filePath, width, height](HBITMAP* phResult) { return ExtractFilePreview(filePath, width, height, phResult); });
+}
+
+HRESULT SaveFilePreviewAsPngImpl(LPCWSTR filePath, UINT width, UINT height, LPCWSTR outputPath)
+{
+    if (!filePath || !outputPath || width == 0 || height == 0)
+        return E_INVALIDARG;
+
+    HRESULT hr = FindPreviewHandlerClsid(filePath, nullptr);
+    if (hr == HRESULT_FROM_WIN32(ERROR_NO_ASSOCIATION))
+        return hr;
+
+    std::ofstream file(outputPath, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return HRESULT_FROM_WIN32(ERROR_CANNOT_MAKE);
+
+    // Streaming needs the handler in this process; isolation only covers bitmap results
+    PreviewHandler handler;
+    hr = handler.SavePreviewAsPng(filePath, width, height, [&file](const uint8_t* data, size_t size)
+    {
+        file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(file);
+    }, nullptr);
+
+    file.close();
+    if (SUCCEEDED(hr) && !file)
+        hr = HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+    if (FAILED(hr))
+        DeleteFileW(outputPath);
+    return hr;
+}
@@ -1,5 +1,11 @@
 #include "pch.h"
 #include "PreviewHandler.h"
+#include "ShellContext.h"
+#include "ShellProviders.h"
+#include "BitmapUtils.h"
+#include "ImageOps.h"
+#include "PathsImpl.h"
+#include "HandlersImpl.h"
 #include <commoncontrols.h>
 #include <shellapi.h>
 #include <shobjidl.h>
@@ -14,6 +20,96 @@
 static const GUID GUID_BHID_PreviewHandler = {0x7f73be3f, 0xfb79, 0x493c, {0xa6, 0xc7, 0x7e, 0xe1, 0x4e, 0x24, 0x5a, 0x19}};
 static const GUID GUID_IInitializeWithFile = {0xb7d14566, 0x0509, 0x4cce, {0xa7, 0x1f, 0x0a, 0x55, 0x42, 0x33, 0xbd, 0x9b}};
 
+namespace
+{
+    const DWORD PREVIEW_TIMEOUT_MS = 30000;
+    const DWORD TILED_SAVE_TIMEOUT_MS = 10 * 60 * 1000;
+    const ULONGLONG TILED_CAPTURE_PIXELS = 4096ull * 4096ull;   // Larger previews are captured in tiles
+    const size_t LONG_PATH_CCH = 32768;                         // Longest "\\?\" path plus terminator
+
+    // Captures a window tile by tile: PrintWindow into a tile-sized DIB section whose viewport
+    // origin is shifted to the tile, so no bitmap the size of the whole window is ever created
+    class WindowTileRenderer : public TileRenderer
+    {
+    public:
+        explicit WindowTileRenderer(HWND hwnd)
+            : m_hwnd(hwnd), m_dc(CreateCompatibleDC(nullptr)), m_bitmap(nullptr), m_oldBitmap(nullptr),
+              m_bits(nullptr), m_width(0), m_height(0)
+        {
+        }
+
+        ~WindowTileRenderer()
+        {
+            if (m_oldBitmap)
+                SelectObject(m_dc, m_oldBitmap);
+            if (m_bitmap)
+                DeleteObject(m_bitmap);
+            if (m_dc)
+                DeleteDC(m_dc);
+        }
+
+        bool RenderTile(const TileRect& tile, uint8_t* pixels, size_t stride) override
+        {
+            if (!m_dc || !EnsureBitmap(tile.width, tile.height))
+                return false;
+
+            PatBlt(m_dc, 0, 0, (int)tile.width, (int)tile.height, WHITENESS);
+            SetViewportOrgEx(m_dc, -(int)tile.x, -(int)tile.y, nullptr);
+            BOOL printed = PrintWindow(m_hwnd, m_dc, PW_RENDERFULLCONTENT);
+            SetViewportOrgEx(m_dc, 0, 0, nullptr);
+            GdiFlush();
+            if (!printed)
+                return false;
+
+            CopyPixelRows(static_cast<const uint8_t*>(m_bits), static_cast<ptrdiff_t>(m_width) * 4,
+                          pixels, stride, tile.width, tile.height);
+            return true;
+        }
+
+    private:
+        bool EnsureBitmap(uint32_t width, uint32_t height)
+        {
+            if (m_bitmap && width <= m_width && height <= m_height)
+                return true;
+
+            if (m_oldBitmap)
+            {
+                SelectObject(m_dc, m_oldBitmap);
+                m_oldBitmap = nullptr;
+            }
+            if (m_bitmap)
+            {
+                DeleteObject(m_bitmap);
+                m_bitmap = nullptr;
+            }
+
+            BITMAPINFO bi = {};
+            bi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+            bi.bmiHeader.biWidth = (LONG)width;
+            bi.bmiHeader.biHeight = -(LONG)height; // top-down
+            bi.bmiHeader.biPlanes = 1;
+            bi.bmiHeader.biBitCount = 32;
+            bi.bmiHeader.biCompression = BI_RGB;
+            m_bitmap = CreateDIBSection(nullptr, &bi, DIB_RGB_COLORS, &m_bits, nullptr, 0);
+            if (!m_bitmap || !m_bits)
+                return false;
+
+            m_oldBitmap = SelectObject(m_dc, m_bitmap);
+            m_width = width;
+            m_height = height;
+            return true;
+        }
+
+        HWND m_hwnd;
+        HDC m_dc;
+        HBITMAP m_bitmap;
+        HGDIOBJ m_oldBitmap;
+        void* m_bits;
+        uint32_t m_width;
+        uint32_t m_height;
+    };
+}
+
 PreviewHandler::PreviewHandler()
 {
     // COM initialization is handled by the application
@@ -24,136 +120,114 @@ PreviewHandler::~PreviewHandler()
     // COM cleanup is handled by the application
 }
 
-HRESULT PreviewHandler::GetThumbnail(LPCWSTR pszFilePath, UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha)
+HRESULT PreviewHandler::GetThumbnail(LPCWSTR pszFilePath, UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha, bool skipCacheLookup)
 {
     if (!pszFilePath || !phbmp)
         return E_INVALIDARG;
 
     *phbmp = nullptr;
-    
-    char debugMsg[256];
-    IThumbnailCache* pThumbCache;
-    IShellItem* pShellItem;
-    HRESULT hr;
-    
-    // 1. (最優先) IThumbnailCache を使う - Shell のサムネイル共有キャッシュを正しく使う
-    pThumbCache = nullptr;
-    hr = CoCreateInstance(CLSID_LocalThumbnailCache, nullptr, CLSCTX_INPROC_SERVER, IID_IThumbnailCache, reinterpret_cast<void**>(&pThumbCache));
-    
-    sprintf_s(debugMsg, "GetThumbnail: IThumbnailCache CoCreateInstance returned 0x%08x\n", hr);
-    OutputDebugStringA(debugMsg);
-    
-    if (SUCCEEDED(hr))
+
+    // Thumbnail providers (IThumbnailCache, IShellItemImageFactory, ...) in the order that has
+    // been cheapest for this file type so far
+    ImageRequest request = MakeImageRequest(pszFilePath, cx, cx);
+    request.requiredCapabilities = PROVIDER_CAP_THUMBNAIL;
+    if (skipCacheLookup)
+        request.excludedCapabilities |= PROVIDER_CAP_CACHE_ONLY;
+    return RunImageProviders(request, phbmp, pdwAlpha);
+}
+
+HRESULT PreviewHandler::GetThumbnailFromCache(LPCWSTR pszFilePath, UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha)
+{
+    if (!pszFilePath || !phbmp)
+        return E_INVALIDARG;
+
+    *phbmp = nullptr;
+
+    // Cache lookups only - 抽出は行わない
+    ImageRequest request = MakeImageRequest(pszFilePath, cx, cx);
+    request.requiredCapabilities = PROVIDER_CAP_THUMBNAIL | PROVIDER_CAP_CACHE_ONLY;
+    return RunImageProviders(request, phbmp, pdwAlpha);
+}
+
+// Copies the cache-owned shared bitmap once into a cx x cx top-down 32bpp DIB section owned by
+// the caller. Transparency survives: alpha thumbnails keep their premultiplied pixels over a
+// transparent margin, opaque ones get alpha 255 and the white margin the cache path always had.
+HRESULT PreviewHandler::CopySharedBitmap(HBITMAP hSharedBmp, UINT cx, WTS_ALPHATYPE alphaType, HBITMAP* phbmp)
+{
+    BITMAPINFO bi = {};
+    bi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bi.bmiHeader.biWidth = (LONG)cx;
+    bi.bmiHeader.biHeight = -(LONG)cx; // top-down
+    bi.bmiHeader.biPlanes = 1;
+    bi.bmiHeader.biBitCount = 32;
+    bi.bmiHeader.biCompression = BI_RGB;
+
+    void* bits = nullptr;
+    HBITMAP hCopy = CreateDIBSection(nullptr, &bi, DIB_RGB_COLORS, &bits, nullptr, 0);
+    if (!hCopy || !bits)
+        return E_OUTOFMEMORY;
+
+    uint8_t* dst = static_cast<uint8_t*>(bits);
+    size_t dstStride = static_cast<size_t>(cx) * 4;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    bool opaque = alphaType == WTSAT_RGB;
+
+    DIBSECTION dib = {};
+    if (GetObject(hSharedBmp, sizeof(dib), &dib) == sizeof(dib) && dib.dsBm.bmBits && dib.dsBm.bmBitsPixel == 32)
     {
-        pShellItem = nullptr;
-        hr = SHCreateItemFromParsingName(pszFilePath, nullptr, IID_IShellItem, reinterpret_cast<void**>(&pShellItem));
-        
-        sprintf_s(debugMsg, "GetThumbnail: SHCreateItemFromParsingName returned 0x%08x\n", hr);
-        OutputDebugStringA(debugMsg);
-        
-        if (SUCCEEDED(hr))
+        // Read the section's memory directly; bottom-up sections are walked backwards
+        width = min(static_cast<uint32_t>(dib.dsBm.bmWidth), static_cast<uint32_t>(cx));
+        height = min(static_cast<uint32_t>(dib.dsBm.bmHeight), static_cast<uint32_t>(cx));
+        const uint8_t* src = static_cast<const uint8_t*>(dib.dsBm.bmBits);
+        ptrdiff_t srcStride = dib.dsBm.bmWidthBytes;
+        if (dib.dsBmih.biHeight > 0)
         {
-            ISharedBitmap* pSharedBitmap = nullptr;
-            WTS_CACHEFLAGS cacheFlags;
-            WTS_THUMBNAILID thumbId;
-            
-            // まず WTS_INCACHEONLY でキャッシュ命中を確認
-            hr = pThumbCache->GetThumbnail(pShellItem, cx, WTS_INCACHEONLY, &pSharedBitmap, &cacheFlags, &thumbId);
-            
-            sprintf_s(debugMsg, "GetThumbnail: IThumbnailCache WTS_INCACHEONLY returned 0x%08x\n", hr);
-            OutputDebugStringA(debugMsg);
-            
-            // キャッシュミスの場合は WTS_EXTRACT で取得
-            if (FAILED(hr))
-            {
-                sprintf_s(debugMsg, "GetThumbnail: Cache miss, trying WTS_EXTRACT\n");
-                OutputDebugStringA(debugMsg);
-                
-                hr = pThumbCache->GetThumbnail(pShellItem, cx, WTS_EXTRACT, &pSharedBitmap, &cacheFlags, &thumbId);
-                
-                sprintf_s(debugMsg, "GetThumbnail: IThumbnailCache WTS_EXTRACT returned 0x%08x\n", hr);
-                OutputDebugStringA(debugMsg);
-            }
-            
-            if (SUCCEEDED(hr) && pSharedBitmap)
-            {
-                HBITMAP hSharedBmp = nullptr;
-                hr = pSharedBitmap->GetSharedBitmap(&hSharedBmp);
-                
-                if (SUCCEEDED(hr) && hSharedBmp)
-                {
-                    // Convert shared bitmap to a regular bitmap
-                    HDC hdcScreen = GetDC(nullptr);
-                    HDC hdcSrc = CreateCompatibleDC(hdcScreen);
-                    HDC hdcDst = CreateCompatibleDC(hdcScreen);
-                    
-                    HBITMAP hRegularBmp = CreateCompatibleBitmap(hdcScreen, cx, cx);
-                    
-                    if (hRegularBmp)
-                    {
-                        HBITMAP oldSrc = (HBITMAP)SelectObject(hdcSrc, hSharedBmp);
-                        HBITMAP oldDst = (HBITMAP)SelectObject(hdcDst, hRegularBmp);
-                        
-                        // Fill with white background
-                        RECT rect = {0, 0, (LONG)cx, (LONG)cx};
-                        HBRUSH whiteBrush = CreateSolidBrush(RGB(255, 255, 255));
-                        FillRect(hdcDst, &rect, whiteBrush);
-                        DeleteObject(whiteBrush);
-                        
-                        // Copy the shared bitmap content
-                        BitBlt(hdcDst, 0, 0, cx, cx, hdcSrc, 0, 0, SRCCOPY);
-                        
-                        SelectObject(hdcSrc, oldSrc);
-                        SelectObject(hdcDst, oldDst);
-                        
-                        *phbmp = hRegularBmp;
-                        if (pdwAlpha) *pdwAlpha = WTSAT_UNKNOWN;
-                        hr = S_OK;
-                        
-                        sprintf_s(debugMsg, "GetThumbnail: IThumbnailCache success\n");
-                        OutputDebugStringA(debugMsg);
-                    }
-                    else
-                    {
-                        hr = E_FAIL;
-                    }
-                    
-                    DeleteDC(hdcSrc);
-                    DeleteDC(hdcDst);
-                    ReleaseDC(nullptr, hdcScreen);
-                }
-                
-                pSharedBitmap->Release();
-            }
-            
-            pShellItem->Release();
+            src += static_cast<ptrdiff_t>(dib.dsBm.bmHeight - 1) * srcStride;
+            srcStride = -srcStride;
         }
-        
-        pThumbCache->Release();
-        
-        // IThumbnailCache が成功したら終了
-        if (SUCCEEDED(hr))
+        GdiFlush();
+        CopyPixelRows(src, srcStride, dst, dstStride, width, height);
+    }
+    else
+    {
+        // Device-dependent or other depths: let GDI convert
+        PixelImage image;
+        HRESULT hr = HBITMAPToPixelImage(hSharedBmp, &image);
+        if (FAILED(hr))
+        {
+            DeleteObject(hCopy);
             return hr;
+        }
+        width = min(image.width, static_cast<uint32_t>(cx));
+        height = min(image.height, static_cast<uint32_t>(cx));
+        CopyPixelRows(image.Row(0), static_cast<ptrdiff_t>(image.stride), dst, dstStride, width, height);
+        opaque = opaque || image.alpha == AlphaMode::Ignore;
     }
-    
-    sprintf_s(debugMsg, "GetThumbnail: IThumbnailCache failed, trying IShellItemImageFactory\n");
-    OutputDebugStringA(debugMsg);
-    
-    // 2. (簡易ルート) IShellItemImageFactory::GetImage を使う
-    // Shell が内部でキャッシュ利用＆必要なら抽出してくれる
-    hr = GetImageUsingIShellItemImageFactory(pszFilePath, cx, phbmp);
-    if (SUCCEEDED(hr))
+
+    if (!opaque && alphaType == WTSAT_UNKNOWN)
     {
-        if (pdwAlpha) *pdwAlpha = WTSAT_UNKNOWN;
-        sprintf_s(debugMsg, "GetThumbnail: IShellItemImageFactory success\n");
-        OutputDebugStringA(debugMsg);
-        return hr;
+        opaque = true;
+        for (uint32_t y = 0; y < height && opaque; ++y)
+        {
+            for (uint32_t x = 0; x < width && opaque; ++x)
+                opaque = dst[y * dstStride + x * 4 + 3] == 0;
+        }
     }
-    
-    sprintf_s(debugMsg, "GetThumbnail: All methods failed, returning 0x%08x\n", hr);
-    OutputDebugStringA(debugMsg);
-    
-    return hr;
+
+    if (opaque)
+    {
+        CompositeOverBackground(dst, width, height, dstStride, AlphaMode::Ignore, 255, 255, 255);
+        for (uint32_t y = 0; y < cx; ++y)
+        {
+            uint32_t first = y < height ? width : 0;
+            memset(dst + y * dstStride + first * 4, 0xFF, (cx - first) * 4);
+        }
+    }
+
+    GdiFlush();
+    *phbmp = hCopy;
+    return S_OK;
 }
 
 HRESULT PreviewHandler::GetPreviewBitmap(LPCWSTR pszFilePath, UINT cx, UINT cy, HBITMAP* phbmp)
@@ -169,15 +243,14 @@ HRESULT PreviewHandler::GetPreviewBitmap(LPCWSTR pszFilePath, UINT cx, UINT cy,
 
 HRESULT PreviewHandler::ExtractImage(LPCWSTR pszFilePath, UINT cx, UINT cy, HBITMAP* phbmp)
 {
-    HRESULT hr = GetThumbnailUsingIExtractImage(pszFilePath, cx, cy, phbmp);
+    if (!pszFilePath || !phbmp)
+        return E_INVALIDARG;
 
-    if (FAILED(hr))
-    {
-        WTS_ALPHATYPE alphaType;
-        hr = GetThumbnail(pszFilePath, min(cx, cy), phbmp, &alphaType);
-    }
+    *phbmp = nullptr;
 
-    return hr;
+    // Every provider may answer; square-only providers use the shorter side
+    WTS_ALPHATYPE alphaType;
+    return RunImageProviders(MakeImageRequest(pszFilePath, cx, cy), phbmp, &alphaType);
 }
 
 HRESULT PreviewHandler::GetThumbnailUsingIThumbnailProvider(LPCWSTR pszFilePath, UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha)
@@ -185,11 +258,10 @@ HRESULT PreviewHandler::GetThumbnailUsingIThumbnailProvider(LPCWSTR pszFilePath,
     char debugMsg[256];
     
     IShellItem* pShellItem = nullptr;
-    HRESULT hr = SHCreateItemFromParsingName(pszFilePath, nullptr, IID_PPV_ARGS(&pShellItem));
+    HRESULT hr = ShellContext::ForCurrentThread().CreateItem(pszFilePath, IID_PPV_ARGS(&pShellItem));
     
-    sprintf_s(debugMsg, "IThumbnailProvider: SHCreateItemFromParsingName returned 0x%08x\n", hr);
+    sprintf_s(debugMsg, "IThumbnailProvider: CreateItem returned 0x%08x\n", hr);
     OutputDebugStringA(debugMsg);
-    printf("%s", debugMsg);
 
     if (SUCCEEDED(hr))
     {
@@ -198,7 +270,6 @@ HRESULT PreviewHandler::GetThumbnailUsingIThumbnailProvider(LPCWSTR pszFilePath,
         
         sprintf_s(debugMsg, "IThumbnailProvider: BindToHandler returned 0x%08x\n", hr);
         OutputDebugStringA(debugMsg);
-        printf("%s", debugMsg);
 
         if (SUCCEEDED(hr))
         {
@@ -206,7 +277,6 @@ HRESULT PreviewHandler::GetThumbnailUsingIThumbnailProvider(LPCWSTR pszFilePath,
             
             sprintf_s(debugMsg, "IThumbnailProvider: GetThumbnail returned 0x%08x\n", hr);
             OutputDebugStringA(debugMsg);
-            printf("%s", debugMsg);
             
             pThumbProvider->Release();
         }
@@ -225,93 +295,122 @@ HRESULT PreviewHandler::GetThumbnailUsingIExtractImage(LPCWSTR pszFilePath, UINT
     *phbmp = nullptr;
 
     char debugMsg[256];
+    ShellContext& context = ShellContext::ForCurrentThread();
+
+    // Resolve the parent folder and a child PIDL. Files in the same directory reuse the bound
+    // folder, so only the file name is parsed per request.
+    IShellFolder* pFolder = nullptr;
+    PIDLIST_RELATIVE pidlRelative = nullptr;
+    PIDLIST_ABSOLUTE pidlAbsolute = nullptr;
+    PCUITEMID_CHILD pidlChild = nullptr;
+    std::wstring childName;
+
+    HRESULT hr = context.GetParentFolder(pszFilePath, &pFolder, &childName);
     
-    IShellFolder* pDesktop = nullptr;
-    HRESULT hr = SHGetDesktopFolder(&pDesktop);
-    
-    sprintf_s(debugMsg, "IExtractImage: SHGetDesktopFolder returned 0x%08x\n", hr);
+    sprintf_s(debugMsg, "IExtractImage: GetParentFolder returned 0x%08x\n", hr);
     OutputDebugStringA(debugMsg);
 
     if (SUCCEEDED(hr))
     {
-        PIDLIST_ABSOLUTE pidl = nullptr;
-        hr = pDesktop->ParseDisplayName(nullptr, nullptr, const_cast<LPWSTR>(pszFilePath), nullptr, &pidl, nullptr);
+        hr = pFolder->ParseDisplayName(nullptr, nullptr, const_cast<LPWSTR>(childName.c_str()), nullptr, &pidlRelative, nullptr);
+        pidlChild = reinterpret_cast<PCUITEMID_CHILD>(pidlRelative);
         
-        sprintf_s(debugMsg, "IExtractImage: ParseDisplayName returned 0x%08x\n", hr);
+        sprintf_s(debugMsg, "IExtractImage: ParseDisplayName (child) returned 0x%08x\n", hr);
         OutputDebugStringA(debugMsg);
+    }
+    else
+    {
+        // No usable directory part: parse the whole path from the desktop
+        IShellFolder* pDesktop = nullptr;
+        hr = context.GetDesktopFolder(&pDesktop);
 
         if (SUCCEEDED(hr))
         {
-            IShellFolder* pFolder = nullptr;
-            PCUITEMID_CHILD pidlChild = nullptr;
-            hr = SHBindToParent(pidl, IID_IShellFolder, (void**)&pFolder, &pidlChild);
+            hr = pDesktop->ParseDisplayName(nullptr, nullptr, const_cast<LPWSTR>(pszFilePath), nullptr, &pidlAbsolute, nullptr);
             
-            sprintf_s(debugMsg, "IExtractImage: SHBindToParent returned 0x%08x\n", hr);
+            sprintf_s(debugMsg, "IExtractImage: ParseDisplayName returned 0x%08x\n", hr);
             OutputDebugStringA(debugMsg);
 
             if (SUCCEEDED(hr))
             {
-                IExtractImage* pExtract = nullptr;
-                hr = pFolder->GetUIObjectOf(nullptr, 1, &pidlChild, IID_IExtractImage, nullptr, (void**)&pExtract);
+                hr = SHBindToParent(pidlAbsolute, IID_IShellFolder, (void**)&pFolder, &pidlChild);
                 
-                sprintf_s(debugMsg, "IExtractImage: GetUIObjectOf returned 0x%08x\n", hr);
+                sprintf_s(debugMsg, "IExtractImage: SHBindToParent returned 0x%08x\n", hr);
                 OutputDebugStringA(debugMsg);
+            }
 
-                if (SUCCEEDED(hr))
-                {
-                    SIZE size = { (LONG)cx, (LONG)cy };
-                    DWORD dwPriority = 0;
-                    DWORD dwFlags = IEIFLAG_SCREEN | IEIFLAG_OFFLINE;
-                    WCHAR szPath[MAX_PATH] = { 0 };
+            pDesktop->Release();
+        }
+    }
 
-                    hr = pExtract->GetLocation(szPath, MAX_PATH, &dwPriority, &size, 32, &dwFlags);
-                    
-                    sprintf_s(debugMsg, "IExtractImage: GetLocation returned 0x%08x\n", hr);
-                    OutputDebugStringA(debugMsg);
+    if (SUCCEEDED(hr))
+    {
+        IExtractImage* pExtract = nullptr;
+        hr = pFolder->GetUIObjectOf(nullptr, 1, &pidlChild, IID_IExtractImage, nullptr, (void**)&pExtract);
+        
+        sprintf_s(debugMsg, "IExtractImage: GetUIObjectOf returned 0x%08x\n", hr);
+        OutputDebugStringA(debugMsg);
 
-                    if (SUCCEEDED(hr))
-                    {
-                        hr = pExtract->Extract(phbmp);
-                        
-                        sprintf_s(debugMsg, "IExtractImage: Extract returned 0x%08x\n", hr);
-                        OutputDebugStringA(debugMsg);
-                    }
+        if (SUCCEEDED(hr))
+        {
+            SIZE size = { (LONG)cx, (LONG)cy };
+            DWORD dwPriority = 0;
+            DWORD dwFlags = IEIFLAG_SCREEN | IEIFLAG_OFFLINE;
+            // Sized for "\\?\" paths, not MAX_PATH: handlers may report the item's full path
+            std::wstring location(LONG_PATH_CCH, L'\0');
 
-                    pExtract->Release();
-                }
+            hr = pExtract->GetLocation(&location[0], static_cast<DWORD>(location.size()), &dwPriority, &size, 32, &dwFlags);
+            
+            sprintf_s(debugMsg, "IExtractImage: GetLocation returned 0x%08x\n", hr);
+            OutputDebugStringA(debugMsg);
 
-                if (pFolder)
-                    pFolder->Release();
+            if (SUCCEEDED(hr))
+            {
+                hr = pExtract->Extract(phbmp);
+                
+                sprintf_s(debugMsg, "IExtractImage: Extract returned 0x%08x\n", hr);
+                OutputDebugStringA(debugMsg);
             }
 
-            if (pidl)
-                CoTaskMemFree(pidl);
+            pExtract->Release();
         }
-
-        pDesktop->Release();
     }
 
+    if (pFolder)
+        pFolder->Release();
+    if (pidlRelative)
+        CoTaskMemFree(pidlRelative);
+    if (pidlAbsolute)
+        CoTaskMemFree(pidlAbsolute);
+
     return hr;
 }
 
-HRESULT PreviewHandler::GetThumbnailUsingIThumbnailCache(LPCWSTR pszFilePath, UINT cx, HBITMAP* phbmp)
+HRESULT PreviewHandler::GetThumbnailUsingIThumbnailCache(LPCWSTR pszFilePath, UINT cx, WTS_FLAGS flags, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha)
 {
+    if (!pszFilePath || !phbmp)
+        return E_INVALIDARG;
+
+    *phbmp = nullptr;
+    if (pdwAlpha)
+        *pdwAlpha = WTSAT_UNKNOWN;
+
+    // Shell のサムネイル共有キャッシュ。インスタンスはスレッドごとのコンテキストで再利用する
+    ShellContext& context = ShellContext::ForCurrentThread();
     IThumbnailCache* pThumbCache = nullptr;
-    HRESULT hr = CoCreateInstance(CLSID_LocalThumbnailCache, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pThumbCache));
+    HRESULT hr = context.GetThumbnailCache(&pThumbCache);
     
     char debugMsg[256];
-    sprintf_s(debugMsg, "IThumbnailCache: CoCreateInstance returned 0x%08x\n", hr);
+    sprintf_s(debugMsg, "IThumbnailCache: GetThumbnailCache returned 0x%08x\n", hr);
     OutputDebugStringA(debugMsg);
-    printf("%s", debugMsg);
 
     if (SUCCEEDED(hr))
     {
         IShellItem* pShellItem = nullptr;
-        hr = SHCreateItemFromParsingName(pszFilePath, nullptr, IID_PPV_ARGS(&pShellItem));
+        hr = context.CreateItem(pszFilePath, IID_PPV_ARGS(&pShellItem));
         
-        sprintf_s(debugMsg, "IThumbnailCache: SHCreateItemFromParsingName returned 0x%08x\n", hr);
+        sprintf_s(debugMsg, "IThumbnailCache: CreateItem returned 0x%08x\n", hr);
         OutputDebugStringA(debugMsg);
-        printf("%s", debugMsg);
 
         if (SUCCEEDED(hr))
         {
@@ -319,59 +418,36 @@ HRESULT PreviewHandler::GetThumbnailUsingIThumbnailCache(LPCWSTR pszFilePath, UI
             WTS_CACHEFLAGS cacheFlags;
             WTS_THUMBNAILID thumbId;
 
-            hr = pThumbCache->GetThumbnail(pShellItem, cx, WTS_EXTRACT, &pSharedBitmap, &cacheFlags, &thumbId);
+            hr = pThumbCache->GetThumbnail(pShellItem, cx, flags, &pSharedBitmap, &cacheFlags, &thumbId);
             
-            sprintf_s(debugMsg, "IThumbnailCache: GetThumbnail returned 0x%08x\n", hr);
+            sprintf_s(debugMsg, "IThumbnailCache: GetThumbnail (flags 0x%x) returned 0x%08x\n", flags, hr);
             OutputDebugStringA(debugMsg);
-            printf("%s", debugMsg);
 
             if (SUCCEEDED(hr) && pSharedBitmap)
             {
+                // The cache knows whether the thumbnail carries transparency
+                WTS_ALPHATYPE alphaType = WTSAT_UNKNOWN;
+                if (FAILED(pSharedBitmap->GetFormat(&alphaType)))
+                    alphaType = WTSAT_UNKNOWN;
+
                 HBITMAP hSharedBmp = nullptr;
                 hr = pSharedBitmap->GetSharedBitmap(&hSharedBmp);
                 
                 if (SUCCEEDED(hr) && hSharedBmp)
                 {
-                    // Convert shared bitmap to a regular bitmap we can work with
-                    HDC hdcScreen = GetDC(nullptr);
-                    HDC hdcSrc = CreateCompatibleDC(hdcScreen);
-                    HDC hdcDst = CreateCompatibleDC(hdcScreen);
-                    
-                    // Create a compatible bitmap for the destination
-                    HBITMAP hRegularBmp = CreateCompatibleBitmap(hdcScreen, cx, cx);
-                    
-                    if (hRegularBmp)
-                    {
-                        HBITMAP oldSrc = (HBITMAP)SelectObject(hdcSrc, hSharedBmp);
-                        HBITMAP oldDst = (HBITMAP)SelectObject(hdcDst, hRegularBmp);
-                        
-                        // Fill with white background
-                        RECT rect = {0, 0, (LONG)cx, (LONG)cx};
-                        HBRUSH whiteBrush = CreateSolidBrush(RGB(255, 255, 255));
-                        FillRect(hdcDst, &rect, whiteBrush);
-                        DeleteObject(whiteBrush);
-                        
-                        // Copy the shared bitmap content
-                        BitBlt(hdcDst, 0, 0, cx, cx, hdcSrc, 0, 0, SRCCOPY);
-                        
-                        SelectObject(hdcSrc, oldSrc);
-                        SelectObject(hdcDst, oldDst);
-                        
-                        *phbmp = hRegularBmp;
-                        hr = S_OK;
-                    }
-                    else
-                    {
-                        hr = E_FAIL;
-                    }
-                    
-                    DeleteDC(hdcSrc);
-                    DeleteDC(hdcDst);
-                    ReleaseDC(nullptr, hdcScreen);
+                    hr = CopySharedBitmap(hSharedBmp, cx, alphaType, phbmp);
                 }
+
+                if (SUCCEEDED(hr) && pdwAlpha)
+                    *pdwAlpha = alphaType;
                 
                 pSharedBitmap->Release();
             }
+            else if (SUCCEEDED(hr))
+            {
+                // S_FALSE with WTS_INCACHEONLY: not in cache
+                hr = WTS_E_FAILEDEXTRACTION;
+            }
 
             pShellItem->Release();
         }
@@ -391,13 +467,12 @@ HRESULT PreviewHandler::GetImageUsingIShellItemImageFactory(LPCWSTR pszFilePath,
     
     char debugMsg[256];
     
-    // Create IShellItem from file path
+    // Create IShellItem from file path (parent folder is reused from the thread context)
     IShellItem* pShellItem = nullptr;
-    HRESULT hr = SHCreateItemFromParsingName(pszFilePath, nullptr, IID_PPV_ARGS(&pShellItem));
+    HRESULT hr = ShellContext::ForCurrentThread().CreateItem(pszFilePath, IID_PPV_ARGS(&pShellItem));
     
-    sprintf_s(debugMsg, "IShellItemImageFactory: SHCreateItemFromParsingName returned 0x%08x\n", hr);
+    sprintf_s(debugMsg, "IShellItemImageFactory: CreateItem returned 0x%08x\n", hr);
     OutputDebugStringA(debugMsg);
-    printf("%s", debugMsg);
     
     if (SUCCEEDED(hr))
     {
@@ -407,7 +482,6 @@ HRESULT PreviewHandler::GetImageUsingIShellItemImageFactory(LPCWSTR pszFilePath,
         
         sprintf_s(debugMsg, "IShellItemImageFactory: QueryInterface returned 0x%08x\n", hr);
         OutputDebugStringA(debugMsg);
-        printf("%s", debugMsg);
         
         if (SUCCEEDED(hr))
         {
@@ -420,7 +494,6 @@ HRESULT PreviewHandler::GetImageUsingIShellItemImageFactory(LPCWSTR pszFilePath,
             
             sprintf_s(debugMsg, "IShellItemImageFactory: GetImage (THUMBNAILONLY) returned 0x%08x\n", hr);
             OutputDebugStringA(debugMsg);
-            printf("%s", debugMsg);
             
             // If thumbnail-only failed, try without the THUMBNAILONLY flag (allows icons)
             if (FAILED(hr))
@@ -430,7 +503,6 @@ HRESULT PreviewHandler::GetImageUsingIShellItemImageFactory(LPCWSTR pszFilePath,
                 
                 sprintf_s(debugMsg, "IShellItemImageFactory: GetImage (fallback) returned 0x%08x\n", hr);
                 OutputDebugStringA(debugMsg);
-                printf("%s", debugMsg);
             }
             
             pImageFactory->Release();
@@ -448,7 +520,51 @@ HRESULT PreviewHandler::GetPreviewUsingIPreviewHandler(LPCWSTR pszFilePath, UINT
         return E_INVALIDARG;
     
     *phbmp = nullptr;
-    
+
+    // Unsupported files fail here, before a thread or window is created for them
+    HRESULT hr = FindPreviewHandlerClsid(pszFilePath, nullptr);
+    if (hr == HRESULT_FROM_WIN32(ERROR_NO_ASSOCIATION))
+        return hr;
+
+    return RunOnSTAThread([&]()
+    {
+        return HostPreview(pszFilePath, cx, cy, [&](HWND hwndCapture) { return CaptureWindowBitmap(hwndCapture, cx, cy, phbmp); });
+    }, PREVIEW_TIMEOUT_MS);
+}
+
+HRESULT PreviewHandler::SavePreviewAsPng(LPCWSTR pszFilePath, UINT cx, UINT cy, const PngWriter::Sink& sink, TiledCaptureResult* pResult)
+{
+    if (!pszFilePath || cx == 0 || cy == 0)
+        return E_INVALIDARG;
+
+    if (pResult)
+        *pResult = TiledCaptureResult();
+
+    HRESULT hr = FindPreviewHandlerClsid(pszFilePath, nullptr);
+    if (hr == HRESULT_FROM_WIN32(ERROR_NO_ASSOCIATION))
+        return hr;
+
+    TiledCaptureResult result;
+    hr = RunOnSTAThread([&]()
+    {
+        return HostPreview(pszFilePath, cx, cy, [&](HWND hwndCapture)
+        {
+            WindowTileRenderer renderer(hwndCapture);
+            TiledCaptureOptions options;
+            result = RunTiledPngCapture(renderer, cx, cy, AlphaMode::Ignore, options, sink);
+            if (result.ok)
+                return S_OK;
+            return result.renderFailed ? E_FAIL : HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+        });
+    }, TILED_SAVE_TIMEOUT_MS);
+
+    if (pResult)
+        *pResult = result;
+    return hr;
+}
+
+HRESULT PreviewHandler::RunOnSTAThread(const std::function<HRESULT()>& work, DWORD timeoutMs)
+{
     char debugMsg[256];
     
     // Check if current thread is already COM initialized
@@ -458,14 +574,10 @@ HRESULT PreviewHandler::GetPreviewUsingIPreviewHandler(LPCWSTR pszFilePath, UINT
     {
         sprintf_s(debugMsg, "IPreviewHandler: Thread is MTA - creating dedicated STA thread\n");
         OutputDebugStringA(debugMsg);
-        printf("%s", debugMsg);
         
         // Create dedicated STA thread for preview
         PreviewThreadData threadData = {};
-        threadData.filePath = pszFilePath;
-        threadData.width = cx;
-        threadData.height = cy;
-        threadData.pBitmap = phbmp;
+        threadData.work = &work;
         threadData.result = E_FAIL;
         threadData.completionEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
         
@@ -476,14 +588,12 @@ HRESULT PreviewHandler::GetPreviewUsingIPreviewHandler(LPCWSTR pszFilePath, UINT
         
         if (hThread)
         {
-            // Wait for completion (30 second timeout)
-            DWORD waitResult = WaitForSingleObject(threadData.completionEvent, 30000);
+            DWORD waitResult = WaitForSingleObject(threadData.completionEvent, timeoutMs);
             
             if (waitResult == WAIT_OBJECT_0)
             {
                 sprintf_s(debugMsg, "IPreviewHandler: STA thread completed with result 0x%08x\n", threadData.result);
                 OutputDebugStringA(debugMsg);
-                printf("%s", debugMsg);
                 
                 CloseHandle(hThread);
                 CloseHandle(threadData.completionEvent);
@@ -493,7 +603,6 @@ HRESULT PreviewHandler::GetPreviewUsingIPreviewHandler(LPCWSTR pszFilePath, UINT
             {
                 sprintf_s(debugMsg, "IPreviewHandler: STA thread timeout or error\n");
                 OutputDebugStringA(debugMsg);
-                printf("%s", debugMsg);
                 
                 TerminateThread(hThread, 0);
                 CloseHandle(hThread);
@@ -509,16 +618,14 @@ HRESULT PreviewHandler::GetPreviewUsingIPreviewHandler(LPCWSTR pszFilePath, UINT
     {
         sprintf_s(debugMsg, "IPreviewHandler: CoInitialize failed 0x%08x\n", hrCom);
         OutputDebugStringA(debugMsg);
-        printf("%s", debugMsg);
         return hrCom;
     }
     
     sprintf_s(debugMsg, "IPreviewHandler: Using current STA thread\n");
     OutputDebugStringA(debugMsg);
-    printf("%s", debugMsg);
     
     // Continue with current thread - call the STA implementation directly
-    HRESULT hr = GetPreviewInSTAThread(pszFilePath, cx, cy, phbmp);
+    HRESULT hr = work();
     
     if (SUCCEEDED(hrCom))
     {
@@ -528,12 +635,92 @@ HRESULT PreviewHandler::GetPreviewUsingIPreviewHandler(LPCWSTR pszFilePath, UINT
     return hr;
 }
 
-HRESULT PreviewHandler::GetPreviewInSTAThread(LPCWSTR pszFilePath, UINT cx, UINT cy, HBITMAP* phbmp)
+// Captures the hosting window into a cx x cy bitmap. Large canvases are captured tile by tile
+// into a DIB section instead of one device-dependent bitmap the size of the output.
+HRESULT PreviewHandler::CaptureWindowBitmap(HWND hwndCapture, UINT cx, UINT cy, HBITMAP* phbmp)
 {
-    if (!pszFilePath || !phbmp)
-        return E_INVALIDARG;
+    char debugMsg[256];
+
+    if (static_cast<ULONGLONG>(cx) * cy > TILED_CAPTURE_PIXELS)
+    {
+        BITMAPINFO bi = {};
+        bi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bi.bmiHeader.biWidth = (LONG)cx;
+        bi.bmiHeader.biHeight = -(LONG)cy; // top-down
+        bi.bmiHeader.biPlanes = 1;
+        bi.bmiHeader.biBitCount = 32;
+        bi.bmiHeader.biCompression = BI_RGB;
+
+        void* bits = nullptr;
+        HBITMAP hBitmap = CreateDIBSection(nullptr, &bi, DIB_RGB_COLORS, &bits, nullptr, 0);
+        if (!hBitmap || !bits)
+            return E_OUTOFMEMORY;
+
+        WindowTileRenderer renderer(hwndCapture);
+        size_t stride = static_cast<size_t>(cx) * 4;
+        TiledCaptureOptions options;
+        for (UINT y = 0; y < cy; y += options.tileHeight)
+        {
+            for (UINT x = 0; x < cx; x += options.tileWidth)
+            {
+                TileRect tile;
+                tile.x = x;
+                tile.y = y;
+                tile.width = min(options.tileWidth, cx - x);
+                tile.height = min(options.tileHeight, cy - y);
+                if (!renderer.RenderTile(tile, static_cast<uint8_t*>(bits) + y * stride + static_cast<size_t>(x) * 4, stride))
+                {
+                    DeleteObject(hBitmap);
+                    return E_FAIL;
+                }
+            }
+        }
+
+        sprintf_s(debugMsg, "IPreviewHandler: Captured %ux%u in tiles\n", cx, cy);
+        OutputDebugStringA(debugMsg);
+        *phbmp = hBitmap;
+        return S_OK;
+    }
+
+    HRESULT hr = E_FAIL;
+
+    // Create bitmap for capture
+    HDC hdcScreen = GetDC(nullptr);
+    HDC hdcMem = CreateCompatibleDC(hdcScreen);
+    HBITMAP hBitmap = CreateCompatibleBitmap(hdcScreen, cx, cy);
     
-    *phbmp = nullptr;
+    if (hBitmap)
+    {
+        HBITMAP hOldBitmap = (HBITMAP)SelectObject(hdcMem, hBitmap);
+        
+        // Fill with white background first
+        RECT fillRect = {0, 0, (LONG)cx, (LONG)cy};
+        HBRUSH whiteBrush = CreateSolidBrush(RGB(255, 255, 255));
+        FillRect(hdcMem, &fillRect, whiteBrush);
+        DeleteObject(whiteBrush);
+        
+        // Capture from the appropriate window
+        BOOL printResult = PrintWindow(hwndCapture, hdcMem, PW_RENDERFULLCONTENT);
+        
+        sprintf_s(debugMsg, "IPreviewHandler: PrintWindow returned %s\n", 
+                 printResult ? "SUCCESS" : "FAILED");
+        OutputDebugStringA(debugMsg);
+        
+        SelectObject(hdcMem, hOldBitmap);
+        *phbmp = hBitmap;
+        hr = S_OK;
+    }
+    
+    DeleteDC(hdcMem);
+    ReleaseDC(nullptr, hdcScreen);
+
+    return hr;
+}
+
+HRESULT PreviewHandler::HostPreview(LPCWSTR pszFilePath, UINT cx, UINT cy, const std::function<HRESULT(HWND hwndCapture)>& capture)
+{
+    if (!pszFilePath)
+        return E_INVALIDARG;
     
     char debugMsg[256];
     
@@ -545,13 +732,11 @@ HRESULT PreviewHandler::GetPreviewInSTAThread(LPCWSTR pszFilePath, UINT cx, UINT
     {
         sprintf_s(debugMsg, "IPreviewHandler: GetPreviewHandlerFromExtension failed 0x%08x\n", hr);
         OutputDebugStringA(debugMsg);
-        printf("%s", debugMsg);
         return hr;
     }
     
     sprintf_s(debugMsg, "IPreviewHandler: Preview handler created successfully\n");
     OutputDebugStringA(debugMsg);
-    printf("%s", debugMsg);
     
     // Create a visible window for hosting the preview (Excel requires visible window)
     // Place it off-screen to avoid user distraction
@@ -572,7 +757,6 @@ HRESULT PreviewHandler::GetPreviewInSTAThread(LPCWSTR pszFilePath, UINT cx, UINT
     
     sprintf_s(debugMsg, "IPreviewHandler: CreateWindow hwnd=0x%p\n", hwndParent);
     OutputDebugStringA(debugMsg);
-    printf("%s", debugMsg);
     
     // Show window as visible but not activated (Excel requires visible window)
     ShowWindow(hwndParent, SW_SHOWNOACTIVATE);
@@ -589,7 +773,6 @@ HRESULT PreviewHandler::GetPreviewInSTAThread(LPCWSTR pszFilePath, UINT cx, UINT
         
         sprintf_s(debugMsg, "IPreviewHandler: Initialize returned 0x%08x\n", hr);
         OutputDebugStringA(debugMsg);
-        printf("%s", debugMsg);
     }
     
     if (SUCCEEDED(hr))
@@ -608,7 +791,6 @@ HRESULT PreviewHandler::GetPreviewInSTAThread(LPCWSTR pszFilePath, UINT cx, UINT
                 
                 sprintf_s(debugMsg, "IPreviewHandler: DoPreview returned 0x%08x\n", hr);
                 OutputDebugStringA(debugMsg);
-                printf("%s", debugMsg);
                 
                 if (SUCCEEDED(hr))
                 {
@@ -620,7 +802,6 @@ HRESULT PreviewHandler::GetPreviewInSTAThread(LPCWSTR pszFilePath, UINT cx, UINT
                     
                     sprintf_s(debugMsg, "IPreviewHandler: Waiting for child window creation...\n");
                     OutputDebugStringA(debugMsg);
-                    printf("%s", debugMsg);
                     
                     // Wait for child window to be created by preview handler
                     while ((GetTickCount() - startTime) < timeout)
@@ -643,7 +824,6 @@ HRESULT PreviewHandler::GetPreviewInSTAThread(LPCWSTR pszFilePath, UINT cx, UINT
                             {
                                 sprintf_s(debugMsg, "IPreviewHandler: Child window found: 0x%p\n", hwndChild);
                                 OutputDebugStringA(debugMsg);
-                                printf("%s", debugMsg);
                                 break;
                             }
                         }
@@ -656,38 +836,8 @@ HRESULT PreviewHandler::GetPreviewInSTAThread(LPCWSTR pszFilePath, UINT cx, UINT
                     
                     sprintf_s(debugMsg, "IPreviewHandler: Capturing from window 0x%p\n", hwndCapture);
                     OutputDebugStringA(debugMsg);
-                    printf("%s", debugMsg);
                     
-                    // Create bitmap for capture
-                    HDC hdcScreen = GetDC(nullptr);
-                    HDC hdcMem = CreateCompatibleDC(hdcScreen);
-                    HBITMAP hBitmap = CreateCompatibleBitmap(hdcScreen, cx, cy);
-                    
-                    if (hBitmap)
-                    {
-                        HBITMAP hOldBitmap = (HBITMAP)SelectObject(hdcMem, hBitmap);
-                        
-                        // Fill with white background first
-                        RECT fillRect = {0, 0, (LONG)cx, (LONG)cy};
-                        HBRUSH whiteBrush = CreateSolidBrush(RGB(255, 255, 255));
-                        FillRect(hdcMem, &fillRect, whiteBrush);
-                        DeleteObject(whiteBrush);
-                        
-                        // Capture from the appropriate window
-                        BOOL printResult = PrintWindow(hwndCapture, hdcMem, PW_RENDERFULLCONTENT);
-                        
-                        sprintf_s(debugMsg, "IPreviewHandler: PrintWindow returned %s\n", 
-                                 printResult ? "SUCCESS" : "FAILED");
-                        OutputDebugStringA(debugMsg);
-                        printf("%s", debugMsg);
-                        
-                        SelectObject(hdcMem, hOldBitmap);
-                        *phbmp = hBitmap;
-                        hr = S_OK;
-                    }
-                    
-                    DeleteDC(hdcMem);
-                    ReleaseDC(nullptr, hdcScreen);
+                    hr = capture(hwndCapture);
                 }
             }
         }
@@ -710,7 +860,6 @@ DWORD WINAPI PreviewHandler::PreviewSTAThread(LPVOID lpParam)
     char debugMsg[256];
     sprintf_s(debugMsg, "IPreviewHandler: STA thread started\n");
     OutputDebugStringA(debugMsg);
-    printf("%s", debugMsg);
     
     // Initialize COM in STA mode
     HRESULT hrCom = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
@@ -718,25 +867,19 @@ DWORD WINAPI PreviewHandler::PreviewSTAThread(LPVOID lpParam)
     {
         sprintf_s(debugMsg, "IPreviewHandler: STA thread CoInitialize failed 0x%08x\n", hrCom);
         OutputDebugStringA(debugMsg);
-        printf("%s", debugMsg);
         
         pData->result = hrCom;
         SetEvent(pData->completionEvent);
         return 1;
     }
     
-    // Create temporary PreviewHandler instance for the actual work
-    PreviewHandler handler;
-    
-    // Call the actual preview implementation (we'll implement this next)
-    pData->result = handler.GetPreviewInSTAThread(pData->filePath, pData->width, pData->height, pData->pBitmap);
+    pData->result = (*pData->work)();
     
     CoUninitialize();
     SetEvent(pData->completionEvent);
     
     sprintf_s(debugMsg, "IPreviewHandler: STA thread completed with result 0x%08x\n", pData->result);
     OutputDebugStringA(debugMsg);
-    printf("%s", debugMsg);
     
     return 0;
 }
@@ -751,48 +894,18 @@ HRESULT PreviewHandler::GetPreviewHandlerFromExtension(LPCWSTR pszFilePath, IPre
     
     char debugMsg[256];
     
-    // Get file extension
-    LPCWSTR pszExt = wcsrchr(pszFilePath, L'.');
-    if (!pszExt)
-        return E_FAIL;
-    
-    sprintf_s(debugMsg, "IPreviewHandler: Getting CLSID for extension %S\n", pszExt);
-    OutputDebugStringA(debugMsg);
-    printf("%s", debugMsg);
-    
-    // Get preview handler CLSID from extension
-    WCHAR szCLSID[MAX_PATH] = {};
-    DWORD dwSize = MAX_PATH;
-    
-    HRESULT hr = AssocQueryStringW(
-        ASSOCF_INIT_DEFAULTTOSTAR,
-        ASSOCSTR_SHELLEXTENSION,
-        pszExt,
-        L"{8895b1c6-b41f-4c1c-a562-0d564250836f}", // BHID_PreviewHandler
-        szCLSID,
-        &dwSize
-    );
-    
-    if (FAILED(hr))
-    {
-        sprintf_s(debugMsg, "IPreviewHandler: AssocQueryString failed 0x%08x\n", hr);
-        OutputDebugStringA(debugMsg);
-        printf("%s", debugMsg);
-        return hr;
-    }
-    
-    sprintf_s(debugMsg, "IPreviewHandler: Found CLSID %S\n", szCLSID);
-    OutputDebugStringA(debugMsg);
-    printf("%s", debugMsg);
-    
-    // Convert string to CLSID
+    // Resolved once per extension (see HandlersImpl.h); the record gives the extension of the
+    // last path component only
+    PathRef record = InternPath(pszFilePath);
+    if (!record)
+        return E_INVALIDARG;
+
     CLSID clsid;
-    hr = CLSIDFromString(szCLSID, &clsid);
+    HRESULT hr = FindPreviewHandlerClsid(*record, &clsid);
     if (FAILED(hr))
     {
-        sprintf_s(debugMsg, "IPreviewHandler: CLSIDFromString failed 0x%08x\n", hr);
+        sprintf_s(debugMsg, "IPreviewHandler: No preview handler for extension %S (0x%08x)\n", WideExtension(*record).c_str(), hr);
         OutputDebugStringA(debugMsg);
-        printf("%s", debugMsg);
         return hr;
     }
     
@@ -801,7 +914,6 @@ HRESULT PreviewHandler::GetPreviewHandlerFromExtension(LPCWSTR pszFilePath, IPre
     
     sprintf_s(debugMsg, "IPreviewHandler: CoCreateInstance (LOCAL_SERVER) returned 0x%08x\n", hr);
     OutputDebugStringA(debugMsg);
-    printf("%s", debugMsg);
     
     return hr;
 }
\ No newline at end of file
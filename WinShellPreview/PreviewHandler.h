@@ -1,5 +1,7 @@
 #pragma once
 #include "framework.h"
+#include "TiledCapture.h"
+#include <functional>
 
 class PreviewHandler
 {
@@ -7,7 +9,11 @@ public:
     PreviewHandler();
     ~PreviewHandler();
 
-    HRESULT GetThumbnail(LPCWSTR pszFilePath, UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha);
+    // Runs the registered image providers (see ShellProviders.h) in their learned order.
+    // skipCacheLookup leaves out the cache-only providers when the caller already missed the cache.
+    HRESULT GetThumbnail(LPCWSTR pszFilePath, UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha, bool skipCacheLookup = false);
+    // Cache-only providers (IThumbnailCache with WTS_INCACHEONLY), never extracts
+    HRESULT GetThumbnailFromCache(LPCWSTR pszFilePath, UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha);
     HRESULT GetPreviewBitmap(LPCWSTR pszFilePath, UINT cx, UINT cy, HBITMAP* phbmp);
     HRESULT ExtractImage(LPCWSTR pszFilePath, UINT cx, UINT cy, HBITMAP* phbmp);
     
@@ -17,23 +23,36 @@ public:
     // IPreviewHandler method (for actual file content preview)
     HRESULT GetPreviewUsingIPreviewHandler(LPCWSTR pszFilePath, UINT cx, UINT cy, HBITMAP* phbmp);
 
+    // Renders the preview in tiles straight into a PNG stream, so memory stays bounded by the
+    // tile size however large cx x cy is. pResult (optional) receives the capture counters.
+    HRESULT SavePreviewAsPng(LPCWSTR pszFilePath, UINT cx, UINT cy, const PngWriter::Sink& sink, TiledCaptureResult* pResult);
+
+    // Out-of-process preview handler registered for the file's extension (call on an STA thread)
+    HRESULT GetPreviewHandlerFromExtension(LPCWSTR pszFilePath, IPreviewHandler** ppPreviewHandler);
+
+    // Individual Shell methods, wrapped as image providers
+    HRESULT GetThumbnailUsingIThumbnailProvider(LPCWSTR pszFilePath, UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha);
+    HRESULT GetThumbnailUsingIExtractImage(LPCWSTR pszFilePath, UINT cx, UINT cy, HBITMAP* phbmp);
+    HRESULT GetThumbnailUsingIThumbnailCache(LPCWSTR pszFilePath, UINT cx, WTS_FLAGS flags, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha);
+
 private:
     // Helper structures for STA thread
     struct PreviewThreadData {
-        LPCWSTR filePath;
-        UINT width;
-        UINT height;
-        HBITMAP* pBitmap;
+        const std::function<HRESULT()>* work;
         HRESULT result;
         HANDLE completionEvent;
     };
     
     static DWORD WINAPI PreviewSTAThread(LPVOID lpParam);
-    HRESULT GetPreviewHandlerFromExtension(LPCWSTR pszFilePath, IPreviewHandler** ppPreviewHandler);
-    HRESULT GetPreviewInSTAThread(LPCWSTR pszFilePath, UINT cx, UINT cy, HBITMAP* phbmp);
+
+    // Runs work on the calling thread if it is (or can become) STA, otherwise on a dedicated STA thread
+    static HRESULT RunOnSTAThread(const std::function<HRESULT()>& work, DWORD timeoutMs);
+
+    // Hosts the file's preview handler in an off-screen cx x cy window and hands the window to
+    // render to capture (call on an STA thread)
+    HRESULT HostPreview(LPCWSTR pszFilePath, UINT cx, UINT cy, const std::function<HRESULT(HWND hwndCapture)>& capture);
+    static HRESULT CaptureWindowBitmap(HWND hwndCapture, UINT cx, UINT cy, HBITMAP* phbmp);
 
 private:
-    HRESULT GetThumbnailUsingIThumbnailProvider(LPCWSTR pszFilePath, UINT cx, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha);
-    HRESULT GetThumbnailUsingIExtractImage(LPCWSTR pszFilePath, UINT cx, UINT cy, HBITMAP* phbmp);
-    HRESULT GetThumbnailUsingIThumbnailCache(LPCWSTR pszFilePath, UINT cx, HBITMAP* phbmp);
+    static HRESULT CopySharedBitmap(HBITMAP hSharedBmp, UINT cx, WTS_ALPHATYPE alphaType, HBITMAP* phbmp);
 };
\ No newline at end of file
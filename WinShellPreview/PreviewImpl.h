@@ -4,3 +4,8 @@
 // Preview implementation
 HRESULT GetFilePreviewImpl(LPCWSTR filePath, UINT width, UINT height, HBITMAP* phBitmap);
 
+// Extraction in the calling process, bypassing coalescing and handler isolation
+HRESULT ExtractFilePreviewInProcess(LPCWSTR filePath, UINT width, UINT height, HBITMAP* phBitmap);
+
+// Tiled capture streamed into a PNG file; memory is bounded by the tile size, not width x height
+HRESULT SaveFilePreviewAsPngImpl(LPCWSTR filePath, UINT width, UINT height, LPCWSTR outputPath);
@@ -0,0 +1,210 @@
+#include "pch.h"
+#include "ProgressiveImpl.h"
+#include "BitmapUtils.h"
+#include "CoalescingImpl.h"
+#include "IconImpl.h"
+#include "PathsImpl.h"
+#include "SharedImageCache.h"
+#include "SignatureImpl.h"
+#include "ThumbnailImpl.h"
+#include <algorithm>
+
+namespace
+{
+    // Small copies of earlier results (mips) are kept per file content; icons per extension
+    const UINT MIP_SIZE = 64;
+    const size_t MIP_CACHE_CAPACITY = 4096;
+    const size_t ICON_CACHE_CAPACITY = 256;
+
+    SharedImageCache& MipCache()
+    {
+        static SharedImageCache* cache = new SharedImageCache(MIP_CACHE_CAPACITY);
+        return *cache;
+    }
+
+    SharedImageCache& IconCache()
+    {
+        static SharedImageCache* cache = new SharedImageCache(ICON_CACHE_CAPACITY);
+        return *cache;
+    }
+
+    // Extensions whose icon differs per file, so an extension-wide icon would be wrong
+    bool HasPerFileIcon(std::string_view extension)
+    {
+        static const char* const perFile[] = { ".exe", ".lnk", ".ico", ".cur", ".url", ".appref-ms" };
+        for (const char* candidate : perFile)
+        {
+            if (extension == candidate)
+                return true;
+        }
+        return false;
+    }
+
+    std::string MakeIconKey(LPCWSTR filePath, UINT size)
+    {
+        PathRef record = InternPath(filePath);
+        if (!record || record->ExtensionKey().empty() || HasPerFileIcon(record->ExtensionKey()))
+            return std::string();
+
+        return std::string(record->ExtensionKey()) + "|" + std::to_string(size);
+    }
+
+    // Scales image so its longer side equals size
+    HRESULT ScaledBitmap(const PixelImage& image, UINT size, HBITMAP* phBitmap)
+    {
+        UINT longer = (std::max)(image.width, image.height);
+        if (longer == size)
+            return PixelImageToHBITMAP(image, phBitmap);
+
+        double scale = static_cast<double>(size) / longer;
+        UINT width = (std::max)(1u, static_cast<UINT>(image.width * scale + 0.5));
+        UINT height = (std::max)(1u, static_cast<UINT>(image.height * scale + 0.5));
+
+        PixelImage scaled;
+        if (!ResizePixelImage(image, width, height, &scaled))
+            return E_OUTOFMEMORY;
+        return PixelImageToHBITMAP(scaled, phBitmap);
+    }
+
+    // The mip and the signature come from the same readback of the delivered bitmap
+    void StoreMip(const std::string& identity, HBITMAP hBitmap)
+    {
+        PixelImage full;
+        if (FAILED(HBITMAPToPixelImage(hBitmap, &full)))
+            return;
+
+        ImageSignature signature;
+        if (ComputeImageSignature(full, &signature))
+            StoreImageSignature(identity, signature);
+        StoreThumbnailMip(identity, full);
+    }
+
+    bool FetchPlaceholder(LPCWSTR filePath, UINT size, const std::string& identity, HBITMAP* phBitmap)
+    {
+        SharedImageCache::ImagePtr mip = MipCache().Find(identity);
+        if (mip && SUCCEEDED(ScaledBitmap(*mip, size, phBitmap)))
+            return true;
+
+        std::string iconKey = MakeIconKey(filePath, size);
+        if (iconKey.empty())
+            return false;
+
+        SharedImageCache::ImagePtr icon = IconCache().Find(iconKey);
+        if (icon)
+            return SUCCEEDED(PixelImageToHBITMAP(*icon, phBitmap));
+
+        HBITMAP hIcon = nullptr;
+        if (FAILED(GetFileIconImpl(filePath, size, &hIcon)) || !hIcon)
+            return false;
+
+        std::shared_ptr<PixelImage> image = std::make_shared<PixelImage>();
+        if (SUCCEEDED(HBITMAPToPixelImage(hIcon, image.get())))
+            IconCache().Insert(iconKey, image);
+
+        *phBitmap = hIcon;
+        return true;
+    }
+}
+
+SharedImageCache& ThumbnailMipCache()
+{
+    return MipCache();
+}
+
+SharedImageCache& ExtensionIconCache()
+{
+    return IconCache();
+}
+
+void StoreThumbnailMip(const std::string& identity, const PixelImage& image)
+{
+    UINT longer = (std::max)(image.width, image.height);
+    std::shared_ptr<PixelImage> mip = std::make_shared<PixelImage>();
+    if (longer <= MIP_SIZE)
+    {
+        if (!CopyPixelImage(image, mip.get()))
+            return;
+    }
+    else
+    {
+        double scale = static_cast<double>(MIP_SIZE) / longer;
+        UINT width = (std::max)(1u, static_cast<UINT>(image.width * scale + 0.5));
+        UINT height = (std::max)(1u, static_cast<UINT>(image.height * scale + 0.5));
+        if (!ResizePixelImage(image, width, height, mip.get()))
+            return;
+    }
+    MipCache().Insert(identity, mip);
+}
+
+HRESULT GetFileThumbnailProgressiveImpl(LPCWSTR filePath, UINT size, ProgressiveCallback callback, void* context)
+{
+    if (!filePath || !callback || size == 0)
+        return E_INVALIDARG;
+
+    std::string identity = MakeFileIdentityKey(filePath);
+    HRESULT lastError = E_FAIL;
+    bool cacheMissed = false;
+
+    ProgressiveLoader<HBITMAP> loader;
+    loader.AddStage(ResultQuality::Placeholder, [&](HBITMAP* phBitmap)
+    {
+        return FetchPlaceholder(filePath, size, identity, phBitmap);
+    }, false);
+
+    // A Shell cache hit is the same image a full extraction would produce
+    loader.AddStage(ResultQuality::Cached, [&](HBITMAP* phBitmap)
+    {
+        HRESULT hr = GetCachedFileThumbnailImpl(filePath, size, phBitmap);
+        if (SUCCEEDED(hr) && *phBitmap)
+        {
+            StoreMip(identity, *phBitmap);
+            return true;
+        }
+        cacheMissed = true;
+        return false;
+    }, true);
+
+    // After a miss above, the extraction does not probe the cache (WTS_INCACHEONLY) again
+    loader.AddStage(ResultQuality::Full, [&](HBITMAP* phBitmap)
+    {
+        HRESULT hr = GetFileThumbnailImpl(filePath, size, phBitmap, cacheMissed);
+        if (SUCCEEDED(hr) && *phBitmap)
+        {
+            StoreMip(identity, *phBitmap);
+            return true;
+        }
+        lastError = FAILED(hr) ? hr : E_FAIL;
+        return false;
+    }, true);
+
+    // Stopped by the caller unless a final result was delivered
+    HRESULT result = HRESULT_FROM_WIN32(ERROR_CANCELLED);
+    loader.Run([&](bool hasImage, HBITMAP hBitmap, ResultQuality quality, bool isFinal)
+    {
+        HRESULT hr = hasImage ? S_OK : lastError;
+        if (isFinal)
+            result = hr;
+        return callback(hr, hasImage ? hBitmap : nullptr, quality, isFinal, context);
+    });
+
+    return result;
+}
+
+void InvalidateThumbnailPlaceholders(LPCWSTR path, bool includeChildren)
+{
+    if (!path)
+        return;
+
+    // Mip keys are MakeFileIdentityKey values: path key, then "|size|time"
+    std::string key = MakePathKey(path);
+    MipCache().ErasePrefix(key + "|");
+    if (includeChildren)
+        MipCache().ErasePrefix(key + "\\");
+    InvalidateImageSignatures(key, includeChildren);
+}
+
+void ClearThumbnailPlaceholders()
+{
+    MipCache().Clear();
+    ClearImageSignatures();
+}
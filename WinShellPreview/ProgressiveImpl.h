@@ -0,0 +1,27 @@
+#pragma once
+#include "framework.h"
+#include "ImageOps.h"
+#include "ProgressiveLoader.h"
+#include <string>
+
+class SharedImageCache;
+
+// Delivered in increasing quality; exactly one call has isFinal == true.
+// Bitmaps are owned by the callee (release with DeleteObject / ReleasePreviewBitmap).
+// Return false to stop early.
+typedef bool (*ProgressiveCallback)(HRESULT hr, HBITMAP hBitmap, ResultQuality quality, bool isFinal, void* context);
+
+// Placeholder (cached icon or small copy) -> Shell cache hit -> full extraction, all on the calling thread
+HRESULT GetFileThumbnailProgressiveImpl(LPCWSTR filePath, UINT size, ProgressiveCallback callback, void* context);
+
+// Keeps a small copy of a full thumbnail as the placeholder for later requests
+void StoreThumbnailMip(const std::string& identity, const PixelImage& image);
+
+// Drops cached placeholders (and their signatures) for a file, or for everything below a directory
+void InvalidateThumbnailPlaceholders(LPCWSTR path, bool includeChildren);
+void ClearThumbnailPlaceholders();
+
+// Placeholder caches: small copies keyed by MakeFileIdentityKey and icons keyed by extension
+// and size. Exposed for the warm-start snapshot (see SnapshotImpl.h).
+SharedImageCache& ThumbnailMipCache();
+SharedImageCache& ExtensionIconCache();
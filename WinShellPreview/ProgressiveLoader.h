@@ -0,0 +1,89 @@
+#pragma once
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Staging logic for progressive results: run providers from cheapest to most expensive and
+// deliver each result that improves on what the caller already has, all through one callback.
+// No Windows dependencies; Image is whatever handle the stages produce.
+
+enum class ResultQuality
+{
+    Placeholder = 0,    // Per-extension icon or a cached small copy of an earlier result
+    Cached = 1,         // Thumbnail cache hit at the requested size
+    Full = 2            // Freshly extracted, full quality
+};
+
+template <typename Image>
+class ProgressiveLoader
+{
+public:
+    // Produces an image into *out and returns true, or returns false when unavailable
+    typedef std::function<bool(Image* out)> Fetch;
+
+    // Receives ownership of `image`. On the final call after all stages failed, hasImage is false.
+    // Return false to stop (remaining stages are skipped and no final call is made).
+    typedef std::function<bool(bool hasImage, Image image, ResultQuality quality, bool isFinal)> Deliver;
+
+    // finalOnSuccess: a result from this stage is as good as it gets, so later stages are skipped
+    void AddStage(ResultQuality quality, Fetch fetch, bool finalOnSuccess)
+    {
+        Stage stage;
+        stage.quality = quality;
+        stage.fetch = std::move(fetch);
+        stage.finalOnSuccess = finalOnSuccess;
+        m_stages.push_back(std::move(stage));
+    }
+
+    // Returns true if a final-quality result was delivered
+    bool Run(const Deliver& deliver) const
+    {
+        bool delivered = false;
+        ResultQuality best = ResultQuality::Placeholder;
+
+        for (size_t i = 0; i < m_stages.size(); ++i)
+        {
+            const Stage& stage = m_stages[i];
+
+            // Never fetch something that cannot improve on what was already delivered
+            if (delivered && stage.quality <= best)
+                continue;
+
+            Image image = Image();
+            if (!stage.fetch(&image))
+                continue;
+
+            bool isFinal = stage.finalOnSuccess || IsLastUsefulStage(i, stage.quality);
+            delivered = true;
+            best = stage.quality;
+            if (!deliver(true, image, stage.quality, isFinal))
+                return false;
+            if (isFinal)
+                return true;
+        }
+
+        // Everything after the last delivery failed: close the sequence
+        deliver(false, Image(), best, true);
+        return false;
+    }
+
+private:
+    struct Stage
+    {
+        ResultQuality quality;
+        Fetch fetch;
+        bool finalOnSuccess;
+    };
+
+    bool IsLastUsefulStage(size_t index, ResultQuality quality) const
+    {
+        for (size_t j = index + 1; j < m_stages.size(); ++j)
+        {
+            if (m_stages[j].quality > quality)
+                return false;
+        }
+        return true;
+    }
+
+    std::vector<Stage> m_stages;
+};
@@ -0,0 +1,391 @@
+#include "ProviderSelector.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+const double ProviderSelector::PRIOR_SUCCESS = 0.5;
+const double ProviderSelector::PRIOR_WEIGHT = 2.0;
+const double ProviderSelector::AGING = 63.0 / 64.0;
+const double ProviderSelector::LATENCY_SMOOTHING = 0.2;
+const double ProviderSelector::SKIP_MIN_ATTEMPTS = 8.0;
+const double ProviderSelector::SKIP_SUCCESS_RATE = 0.02;
+const uint32_t ProviderSelector::RETRY_INTERVAL = 32;
+
+namespace
+{
+    const double MIN_LATENCY_MS = 0.1;
+    const char STATS_MAGIC[] = "WSP-PROVIDERS 1";
+
+    void AppendUtf8(std::string* out, uint32_t cp)
+    {
+        if (cp < 0x80)
+        {
+            out->push_back(static_cast<char>(cp));
+        }
+        else if (cp < 0x800)
+        {
+            out->push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            out->push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else if (cp < 0x10000)
+        {
+            out->push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            out->push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else
+        {
+            out->push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            out->push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+}
+
+std::string FileTypeFromPath(const std::wstring& path)
+{
+    size_t nameStart = path.find_last_of(L"\\/");
+    nameStart = nameStart == std::wstring::npos ? 0 : nameStart + 1;
+    size_t dot = path.rfind(L'.');
+    if (dot == std::wstring::npos || dot < nameStart || dot + 1 >= path.size())
+        return std::string();
+
+    std::string type;
+    for (size_t i = dot + 1; i < path.size(); ++i)
+    {
+        uint32_t c = static_cast<uint32_t>(path[i]);
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        // UTF-16 surrogate pair (wchar_t is 16 bits on Windows)
+        if (c >= 0xD800 && c < 0xDC00 && i + 1 < path.size())
+        {
+            uint32_t low = static_cast<uint32_t>(path[i + 1]);
+            if (low >= 0xDC00 && low < 0xE000)
+            {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                ++i;
+            }
+        }
+        AppendUtf8(&type, c);
+    }
+    return type;
+}
+
+size_t ProviderSelector::Register(const ProviderDescriptor& descriptor)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry entry;
+    entry.descriptor = descriptor;
+    m_entries.push_back(entry);
+    return m_entries.size() - 1;
+}
+
+size_t ProviderSelector::Count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+ProviderDescriptor ProviderSelector::Descriptor(size_t id) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return id < m_entries.size() ? m_entries[id].descriptor : ProviderDescriptor();
+}
+
+bool ProviderSelector::Find(const std::string& name, size_t* id) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_entries.size(); ++i)
+    {
+        if (m_entries[i].descriptor.name == name)
+        {
+            *id = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ProviderSelector::SetEnabled(size_t id, bool enabled)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (id < m_entries.size())
+        m_entries[id].enabled = enabled;
+}
+
+bool ProviderSelector::IsEnabled(size_t id) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return id < m_entries.size() && m_entries[id].enabled;
+}
+
+bool ProviderSelector::IsEligible(const Entry& entry, const ImageRequest& request) const
+{
+    const ProviderDescriptor& d = entry.descriptor;
+    if (!entry.enabled)
+        return false;
+    if ((d.capabilities & request.requiredCapabilities) != request.requiredCapabilities)
+        return false;
+    if (d.capabilities & request.excludedCapabilities)
+        return false;
+
+    uint32_t size = std::max(request.width, request.height);
+    if ((d.minSize && size < d.minSize) || (d.maxSize && size > d.maxSize))
+        return false;
+
+    return d.fileTypes.empty() ||
+           std::find(d.fileTypes.begin(), d.fileTypes.end(), request.fileType) != d.fileTypes.end();
+}
+
+double ProviderSelector::ExpectedCostLocked(size_t id, const std::string& fileType) const
+{
+    double latency = m_entries[id].descriptor.estimatedCostMs;
+    double attempts = 0.0;
+    double successes = 0.0;
+
+    auto it = m_stats.find(fileType);
+    if (it != m_stats.end() && id < it->second.size() && it->second[id].attempts > 0)
+    {
+        const ProviderStats& stats = it->second[id];
+        latency = stats.meanLatencyMs;
+        attempts = stats.recentAttempts;
+        successes = stats.recentSuccesses;
+    }
+
+    double successRate = (successes + PRIOR_SUCCESS * PRIOR_WEIGHT) / (attempts + PRIOR_WEIGHT);
+    return std::max(latency, MIN_LATENCY_MS) / successRate;
+}
+
+double ProviderSelector::ExpectedCost(size_t id, const std::string& fileType) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return id < m_entries.size() ? ExpectedCostLocked(id, fileType) : 0.0;
+}
+
+bool ProviderSelector::IsHopeless(const ProviderStats& stats) const
+{
+    return stats.recentAttempts >= SKIP_MIN_ATTEMPTS &&
+           stats.recentSuccesses < stats.recentAttempts * SKIP_SUCCESS_RATE;
+}
+
+std::vector<ProviderStats>& ProviderSelector::StatsFor(const std::string& fileType)
+{
+    std::vector<ProviderStats>& perProvider = m_stats[fileType];
+    if (perProvider.size() < m_entries.size())
+        perProvider.resize(m_entries.size());
+    return perProvider;
+}
+
+std::vector<size_t> ProviderSelector::Order(const ImageRequest& request)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_stats.find(request.fileType);
+    std::vector<ProviderStats>* perProvider = it != m_stats.end() ? &it->second : nullptr;
+    if (perProvider && perProvider->size() < m_entries.size())
+        perProvider->resize(m_entries.size());
+
+    std::vector<std::pair<double, size_t>> ranked;
+    for (size_t id = 0; id < m_entries.size(); ++id)
+    {
+        if (!IsEligible(m_entries[id], request))
+            continue;
+
+        if (perProvider && IsHopeless((*perProvider)[id]))
+        {
+            ProviderStats& stats = (*perProvider)[id];
+            if (++stats.skippedSinceAttempt < RETRY_INTERVAL)
+            {
+                ++stats.skipped;
+                continue;
+            }
+            stats.skippedSinceAttempt = 0;
+        }
+        ranked.push_back(std::make_pair(ExpectedCostLocked(id, request.fileType), id));
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const std::pair<double, size_t>& a, const std::pair<double, size_t>& b)
+    {
+        return a.first < b.first;
+    });
+
+    std::vector<size_t> order;
+    for (const auto& item : ranked)
+        order.push_back(item.second);
+    return order;
+}
+
+void ProviderSelector::Record(size_t id, const std::string& fileType, bool success, double latencyMs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (id >= m_entries.size())
+        return;
+
+    ProviderStats& stats = StatsFor(fileType)[id];
+    latencyMs = std::max(latencyMs, 0.0);
+    if (stats.attempts == 0)
+        stats.meanLatencyMs = latencyMs;
+    else
+        stats.meanLatencyMs += (latencyMs - stats.meanLatencyMs) * LATENCY_SMOOTHING;
+
+    ++stats.attempts;
+    if (success)
+        ++stats.successes;
+    stats.recentAttempts = stats.recentAttempts * AGING + 1.0;
+    stats.recentSuccesses = stats.recentSuccesses * AGING + (success ? 1.0 : 0.0);
+    stats.skippedSinceAttempt = 0;
+    ++m_unsavedRecords;
+}
+
+ProviderStats ProviderSelector::Stats(size_t id, const std::string& fileType) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ProviderStats total;
+    double latencySum = 0.0;
+
+    for (const auto& item : m_stats)
+    {
+        if (!fileType.empty() && item.first != fileType)
+            continue;
+        if (id >= item.second.size())
+            continue;
+        const ProviderStats& stats = item.second[id];
+        total.attempts += stats.attempts;
+        total.successes += stats.successes;
+        total.recentAttempts += stats.recentAttempts;
+        total.recentSuccesses += stats.recentSuccesses;
+        total.skipped += stats.skipped;
+        latencySum += stats.meanLatencyMs * static_cast<double>(stats.attempts);
+    }
+    if (total.attempts > 0)
+        total.meanLatencyMs = latencySum / static_cast<double>(total.attempts);
+    return total;
+}
+
+std::vector<std::string> ProviderSelector::FileTypes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::string> types;
+    for (const auto& item : m_stats)
+        types.push_back(item.first);
+    std::sort(types.begin(), types.end());
+    return types;
+}
+
+void ProviderSelector::ResetStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.clear();
+    m_unsavedRecords = 0;
+}
+
+uint64_t ProviderSelector::UnsavedRecords() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_unsavedRecords;
+}
+
+// Call with m_mutex held
+void ProviderSelector::WriteStats(std::ostream& text) const
+{
+    // One line per (file type, provider): type, name, attempts, successes, latency, aged counts
+    text.precision(17);
+    text << STATS_MAGIC << '\n';
+    for (const auto& item : m_stats)
+    {
+        for (size_t id = 0; id < item.second.size() && id < m_entries.size(); ++id)
+        {
+            const ProviderStats& stats = item.second[id];
+            if (stats.attempts == 0)
+                continue;
+            text << item.first << '\t' << m_entries[id].descriptor.name << '\t'
+                 << stats.attempts << '\t' << stats.successes << '\t' << stats.meanLatencyMs << '\t'
+                 << stats.recentAttempts << '\t' << stats.recentSuccesses << '\n';
+        }
+    }
+}
+
+std::string ProviderSelector::Serialize() const
+{
+    std::ostringstream text;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    WriteStats(text);
+    return text.str();
+}
+
+bool ProviderSelector::Save(const std::filesystem::path& file)
+{
+    std::ostringstream text;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        WriteStats(text);
+        m_unsavedRecords = 0;
+    }
+    std::string data = text.str();
+
+    std::filesystem::path temp = file;
+    temp += ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        out.flush();
+        if (!out)
+            return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp, file, ec);
+    return !ec;
+}
+
+bool ProviderSelector::Load(const std::filesystem::path& file)
+{
+    std::ifstream in(file, std::ios::binary);
+    if (!in)
+        return false;
+
+    std::ostringstream text;
+    text << in.rdbuf();
+    return Deserialize(text.str());
+}
+
+bool ProviderSelector::Deserialize(const std::string& data)
+{
+    std::istringstream in(data);
+    std::string line;
+    if (!std::getline(in, line) || line != STATS_MAGIC)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (std::getline(in, line))
+    {
+        size_t typeEnd = line.find('\t');
+        size_t nameEnd = typeEnd == std::string::npos ? std::string::npos : line.find('\t', typeEnd + 1);
+        if (nameEnd == std::string::npos)
+            continue;
+
+        std::string fileType = line.substr(0, typeEnd);
+        std::string name = line.substr(typeEnd + 1, nameEnd - typeEnd - 1);
+
+        ProviderStats loaded;
+        std::istringstream fields(line.substr(nameEnd + 1));
+        if (!(fields >> loaded.attempts >> loaded.successes >> loaded.meanLatencyMs >> loaded.recentAttempts >> loaded.recentSuccesses))
+            continue;
+        if (loaded.successes > loaded.attempts || loaded.meanLatencyMs < 0.0 ||
+            loaded.recentSuccesses > loaded.recentAttempts || loaded.recentSuccesses < 0.0)
+            continue;
+
+        for (size_t id = 0; id < m_entries.size(); ++id)
+        {
+            if (m_entries[id].descriptor.name == name)
+            {
+                StatsFor(fileType)[id] = loaded;
+                break;
+            }
+        }
+    }
+    m_unsavedRecords = 0;
+    return true;
+}
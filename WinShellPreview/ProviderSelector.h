@@ -0,0 +1,127 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Selection engine for image providers: filters providers by capability, size and file type,
+// and orders the rest by what they have cost per successful image for that file type so far.
+// Thread-safe. No Windows dependencies.
+
+enum ProviderCapability : uint32_t
+{
+    PROVIDER_CAP_THUMBNAIL = 0x1,       // Square thumbnails (size = longest side)
+    PROVIDER_CAP_RECTANGULAR = 0x2,     // Honors separate width and height
+    PROVIDER_CAP_ALPHA = 0x4,           // Can return transparency
+    PROVIDER_CAP_CACHE_ONLY = 0x8,      // Looks up earlier results, never decodes
+    PROVIDER_CAP_NEEDS_STA = 0x10,      // Must be called on a COM single-threaded apartment
+    PROVIDER_CAP_ICON_FALLBACK = 0x20   // May return a generic icon instead of the content
+};
+
+struct ProviderDescriptor
+{
+    std::string name;
+    uint32_t capabilities = 0;
+    uint32_t minSize = 0;               // Longest requested side accepted, 0 = no limit
+    uint32_t maxSize = 0;
+    std::vector<std::string> fileTypes; // Lowercase extensions without the dot; empty = all
+    double estimatedCostMs = 100.0;     // Assumed per-attempt latency until measured
+};
+
+struct ImageRequest
+{
+    std::wstring path;
+    std::string fileType;               // See FileTypeFromPath
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t requiredCapabilities = 0;  // Providers must have all of these
+    uint32_t excludedCapabilities = 0;  // ...and none of these
+};
+
+struct ProviderStats
+{
+    uint64_t attempts = 0;
+    uint64_t successes = 0;
+    double meanLatencyMs = 0.0;         // Smoothed over recent attempts, successful or not
+    double recentAttempts = 0.0;        // Aged counts: older outcomes weigh less
+    double recentSuccesses = 0.0;
+    uint64_t skipped = 0;               // Requests that left the provider out as hopeless
+    uint32_t skippedSinceAttempt = 0;
+};
+
+// Lowercase UTF-8 extension of the file name without the dot, "" if there is none
+std::string FileTypeFromPath(const std::wstring& path);
+
+class ProviderSelector
+{
+public:
+    static const double PRIOR_SUCCESS;      // Success rate assumed before any attempt
+    static const double PRIOR_WEIGHT;       // Attempts the prior is worth
+    static const double AGING;              // Weight kept by earlier outcomes per new attempt
+    static const double LATENCY_SMOOTHING;  // EWMA weight of the newest latency
+    static const double SKIP_MIN_ATTEMPTS;  // Recent attempts needed before a provider can be skipped
+    static const double SKIP_SUCCESS_RATE;  // Recent success rate below which it is skipped
+    static const uint32_t RETRY_INTERVAL;   // A skipped provider is tried again every Nth request
+
+    // Returns the provider id (registration order, starting at 0)
+    size_t Register(const ProviderDescriptor& descriptor);
+
+    size_t Count() const;
+    ProviderDescriptor Descriptor(size_t id) const;
+    bool Find(const std::string& name, size_t* id) const;
+
+    void SetEnabled(size_t id, bool enabled);
+    bool IsEnabled(size_t id) const;
+
+    // Eligible providers for the request, cheapest expected cost per success first.
+    // Trying providers in increasing latency / successRate order minimizes the expected time to
+    // the first image when outcomes are independent. Ties keep registration order.
+    // Providers that have kept failing for this file type are left out, except on every
+    // RETRY_INTERVAL-th request so a fixed handler is noticed.
+    std::vector<size_t> Order(const ImageRequest& request);
+
+    void Record(size_t id, const std::string& fileType, bool success, double latencyMs);
+
+    // Per file type; an empty fileType sums every type (latency weighted by attempts)
+    ProviderStats Stats(size_t id, const std::string& fileType) const;
+    std::vector<std::string> FileTypes() const;
+
+    // Expected milliseconds per successful image, as used by Order
+    double ExpectedCost(size_t id, const std::string& fileType) const;
+
+    void ResetStats();
+
+    // Outcomes recorded since the last Save or Load
+    uint64_t UnsavedRecords() const;
+
+    // Text file keyed by provider name, so ids may change between runs. Save writes a temporary
+    // file and renames it. Load merges into the current stats; unknown providers are ignored.
+    bool Save(const std::filesystem::path& file);
+    bool Load(const std::filesystem::path& file);
+
+    // The same text in memory, e.g. for a warm-start snapshot. Serialize leaves
+    // UnsavedRecords alone, so the stats file is still written when due.
+    std::string Serialize() const;
+    bool Deserialize(const std::string& text);
+
+private:
+    struct Entry
+    {
+        ProviderDescriptor descriptor;
+        bool enabled = true;
+    };
+
+    bool IsEligible(const Entry& entry, const ImageRequest& request) const;
+    bool IsHopeless(const ProviderStats& stats) const;
+    double ExpectedCostLocked(size_t id, const std::string& fileType) const;
+    std::vector<ProviderStats>& StatsFor(const std::string& fileType);
+    void WriteStats(std::ostream& text) const;
+
+    mutable std::mutex m_mutex;
+    std::vector<Entry> m_entries;
+    std::unordered_map<std::string, std::vector<ProviderStats>> m_stats;   // fileType -> per provider
+    uint64_t m_unsavedRecords = 0;
+};
@@ -0,0 +1,78 @@
+#include "pch.h"
+#include "PyramidImpl.h"
+#include "PreviewImpl.h"
+#include "BitmapUtils.h"
+#include "ZoomPyramid.h"
+
+HRESULT BuildFilePreviewPyramidImpl(LPCWSTR filePath, UINT width, UINT height, LPCWSTR outputPath,
+                                    const WSP_PYRAMID_OPTIONS* pOptions, WSP_PYRAMID_STATS* pStats)
+{
+    if (!filePath || !outputPath || width == 0 || height == 0)
+        return E_INVALIDARG;
+
+    if (pStats)
+        *pStats = {};
+
+    PyramidOptions options;
+    bool pack = false;
+    WSP_TILE_CALLBACK callback = nullptr;
+    void* context = nullptr;
+    if (pOptions)
+    {
+        if (pOptions->tileSize)
+            options.tileSize = pOptions->tileSize;
+        options.overlap = pOptions->overlap;
+        pack = (pOptions->flags & WSP_PYRAMID_PACK) != 0;
+        callback = pOptions->callback;
+        context = pOptions->context;
+    }
+    if (options.overlap >= options.tileSize)
+        return E_INVALIDARG;
+
+    // One capture at full resolution; every smaller level is derived from it
+    HBITMAP hBitmap = nullptr;
+    HRESULT hr = GetFilePreviewImpl(filePath, width, height, &hBitmap);
+    if (FAILED(hr) || !hBitmap)
+        return FAILED(hr) ? hr : E_FAIL;
+
+    PixelImage image;
+    hr = HBITMAPToPixelImage(hBitmap, &image);
+    DeleteObject(hBitmap);
+    if (FAILED(hr))
+        return hr;
+
+    DziDirectoryWriter directory;
+    PyramidPackWriter packFile;
+    bool opened = pack ? packFile.Create(outputPath, image.width, image.height, options)
+                       : directory.Open(outputPath, image.width, image.height, options);
+    if (!opened)
+        return HRESULT_FROM_WIN32(ERROR_CANNOT_MAKE);
+
+    bool writeFailed = false;
+    PyramidResult result = BuildZoomPyramid(image, options, [&](const PyramidTile& tile)
+    {
+        if (!(pack ? packFile.WriteTile(tile) : directory.WriteTile(tile)))
+        {
+            writeFailed = true;
+            return false;
+        }
+        return !callback || callback(tile.level, tile.column, tile.row, context) != FALSE;
+    });
+
+    if (pack && !packFile.Finish())
+        writeFailed = true;
+
+    if (pStats)
+    {
+        pStats->levels = result.levels;
+        pStats->tiles = result.tiles;
+        pStats->encodedBytes = result.encodedBytes;
+        pStats->downsampleMs = result.downsampleMs;
+    }
+
+    if (writeFailed)
+        return HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+    if (result.stopped)
+        return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+    return result.ok ? S_OK : E_OUTOFMEMORY;
+}
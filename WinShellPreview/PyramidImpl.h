@@ -0,0 +1,8 @@
+#pragma once
+#include "framework.h"
+#include "WinShellPreview.h"
+
+// Captures the preview once at width x height and writes a deep-zoom tile pyramid from it:
+// a .dzi descriptor with its _files directory, or a single pack file (WSP_PYRAMID_PACK).
+HRESULT BuildFilePreviewPyramidImpl(LPCWSTR filePath, UINT width, UINT height, LPCWSTR outputPath,
+                                    const WSP_PYRAMID_OPTIONS* pOptions, WSP_PYRAMID_STATS* pStats);
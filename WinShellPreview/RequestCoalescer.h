@@ -0,0 +1,142 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Single-flight coalescing of identical concurrent requests.
+//
+// Requests are grouped by a string key (file identity + mode) and carry a size. The first request
+// of a (group, size) pair becomes the leader and runs the extraction; later requests for the same
+// pair wait for the leader's value. When allowLarger is set, a request may also follow an
+// in-flight leader of the same group with a larger size; the caller then downscales the value.
+//
+// The leader only materialises the shared value when somebody is actually waiting, so the
+// uncontended path costs one map insert/erase. No Windows dependencies.
+
+struct RequestCoalescerStats
+{
+    uint64_t leaders;
+    uint64_t exactFollowers;    // Waited for a leader of the same size
+    uint64_t largerFollowers;   // Waited for a leader of a larger size
+    uint64_t sharedValues;      // Leaders that published a value to followers
+};
+
+template <typename Value>
+class RequestCoalescer
+{
+public:
+    class Flight
+    {
+    public:
+        uint32_t Size() const { return m_size; }
+
+    private:
+        friend class RequestCoalescer;
+        std::string m_group;
+        uint32_t m_size = 0;
+        size_t m_waiters = 0;
+        bool m_done = false;
+        Value m_value = Value();
+        std::mutex m_mutex;
+        std::condition_variable m_doneSignal;
+    };
+
+    typedef std::shared_ptr<Flight> FlightPtr;
+
+    // Registers interest in (group, size). Returns the flight and sets *pLeader when the caller
+    // must run the work and call Finish. Followers call Wait.
+    FlightPtr Join(const std::string& group, uint32_t size, bool allowLarger, bool* pLeader)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::map<uint32_t, FlightPtr>& flights = m_groups[group];
+
+        // Prefer an exact match, otherwise the smallest larger flight
+        auto it = allowLarger ? flights.lower_bound(size) : flights.find(size);
+        if (it != flights.end())
+        {
+            FlightPtr flight = it->second;
+            {
+                std::lock_guard<std::mutex> flightLock(flight->m_mutex);
+                ++flight->m_waiters;
+            }
+            if (flight->m_size == size)
+                ++m_stats.exactFollowers;
+            else
+                ++m_stats.largerFollowers;
+            *pLeader = false;
+            return flight;
+        }
+
+        FlightPtr flight = std::make_shared<Flight>();
+        flight->m_group = group;
+        flight->m_size = size;
+        flights[size] = flight;
+        ++m_stats.leaders;
+        *pLeader = true;
+        return flight;
+    }
+
+    // Leader: closes the flight to new followers, then calls makeShared() only if followers are
+    // waiting and hands its value to them. Returns the number of followers served.
+    size_t Finish(const FlightPtr& flight, const std::function<Value()>& makeShared)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto group = m_groups.find(flight->m_group);
+            if (group != m_groups.end())
+            {
+                auto it = group->second.find(flight->m_size);
+                if (it != group->second.end() && it->second == flight)
+                    group->second.erase(it);
+                if (group->second.empty())
+                    m_groups.erase(group);
+            }
+        }
+
+        // No new followers can join now, so m_waiters is final
+        size_t waiters;
+        {
+            std::lock_guard<std::mutex> flightLock(flight->m_mutex);
+            waiters = flight->m_waiters;
+        }
+
+        Value value = waiters ? makeShared() : Value();
+        {
+            std::lock_guard<std::mutex> flightLock(flight->m_mutex);
+            flight->m_value = value;
+            flight->m_done = true;
+        }
+        flight->m_doneSignal.notify_all();
+
+        if (waiters)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_stats.sharedValues;
+        }
+        return waiters;
+    }
+
+    // Follower: blocks until the leader finishes and returns its shared value
+    Value Wait(const FlightPtr& flight)
+    {
+        std::unique_lock<std::mutex> flightLock(flight->m_mutex);
+        flight->m_doneSignal.wait(flightLock, [&flight]() { return flight->m_done; });
+        return flight->m_value;
+    }
+
+    RequestCoalescerStats GetStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, std::map<uint32_t, FlightPtr>> m_groups;
+    RequestCoalescerStats m_stats = {};
+};
@@ -0,0 +1,443 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Priority scheduler for thumbnail requests.
+//
+// - Three priority classes (Visible, Normal, Background), FIFO within a class
+// - SetViewport() boosts the given requests to Visible and demotes requests that left the viewport
+// - Anti-starvation: a request waiting longer than its class's aging limit is promoted one class,
+//   and a request past its deadline is picked before anything else
+// - Identical requests (same key) are deduplicated while pending or running; every subscriber
+//   receives the single result
+//
+// No Windows dependencies. Workers are optional: RunNext() executes one item on the calling
+// thread, which allows deterministic simulation with an injected clock.
+
+enum class RequestPriority
+{
+    Visible = 0,
+    Normal = 1,
+    Background = 2
+};
+
+struct RequestSchedulerStats
+{
+    uint64_t submitted;
+    uint64_t deduplicated;      // Submits that joined an existing pending/running item
+    uint64_t executed;          // Jobs actually run
+    uint64_t cancelled;
+    uint64_t agingPromotions;
+    uint64_t deadlinePicks;
+    uint64_t completedByClass[3];
+    uint64_t totalWaitMsByClass[3]; // Submit-to-completion time summed per original class
+};
+
+template <typename Result>
+class RequestScheduler
+{
+public:
+    typedef uint64_t RequestId;
+    typedef std::function<Result()> Job;
+    typedef std::function<void(RequestId id, const Result& result)> Completion;
+    typedef std::function<uint64_t()> Clock; // milliseconds
+
+    static const size_t CLASS_COUNT = 3;
+
+    RequestScheduler()
+        : m_clock(&RequestScheduler::SteadyNowMs)
+    {
+        m_agingLimitMs[0] = 0;
+        m_agingLimitMs[1] = 2000;
+        m_agingLimitMs[2] = 10000;
+    }
+
+    ~RequestScheduler()
+    {
+        Stop();
+    }
+
+    RequestScheduler(const RequestScheduler&) = delete;
+    RequestScheduler& operator=(const RequestScheduler&) = delete;
+
+    void SetClock(Clock clock)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_clock = clock ? clock : Clock(&RequestScheduler::SteadyNowMs);
+    }
+
+    // Maximum time a request of `priority` waits before it is promoted one class
+    void SetAgingLimit(RequestPriority priority, uint64_t limitMs)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_agingLimitMs[static_cast<size_t>(priority)] = limitMs;
+    }
+
+    // Starts worker threads. onThreadStart/onThreadExit run on each worker (e.g. COM init).
+    void Start(size_t workerCount, std::function<void()> onThreadStart = nullptr, std::function<void()> onThreadExit = nullptr)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_workers.empty())
+            return;
+        m_stopping = false;
+        for (size_t i = 0; i < workerCount; ++i)
+        {
+            m_workers.emplace_back([this, onThreadStart, onThreadExit]()
+            {
+                if (onThreadStart) onThreadStart();
+                while (RunNext(true))
+                {
+                }
+                if (onThreadExit) onThreadExit();
+            });
+        }
+    }
+
+    // Stops workers after the item each is running; pending items stay queued
+    void Stop()
+    {
+        std::vector<std::thread> workers;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+            workers.swap(m_workers);
+        }
+        m_wake.notify_all();
+        for (std::thread& worker : workers)
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = false;
+    }
+
+    // deadlineMs is relative to now; 0 means no deadline
+    RequestId Submit(const std::string& key, RequestPriority priority, Job job, Completion completion, uint64_t deadlineMs = 0)
+    {
+        RequestId id;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            uint64_t now = m_clock();
+            id = ++m_lastId;
+            ++m_stats.submitted;
+
+            std::shared_ptr<Item> item;
+            auto existing = m_byKey.find(key);
+            if (existing != m_byKey.end())
+            {
+                item = existing->second;
+                ++m_stats.deduplicated;
+                // The most urgent subscriber decides, also after a viewport boost ends
+                if (priority < item->basePriority)
+                    item->basePriority = priority;
+                // A running or finished item must not go back into the queues
+                if (item->queued)
+                {
+                    if (priority < item->priority)
+                        Requeue(item, priority);
+                    if (deadlineMs && (!item->deadline || now + deadlineMs < item->deadline))
+                        SetDeadline(item, now + deadlineMs);
+                }
+            }
+            else
+            {
+                item = std::make_shared<Item>();
+                item->key = key;
+                item->job = std::move(job);
+                item->basePriority = priority;
+                item->sequence = ++m_lastSequence;
+                m_byKey[key] = item;
+                Enqueue(item, priority, now);
+                if (deadlineMs)
+                    SetDeadline(item, now + deadlineMs);
+            }
+
+            Subscriber subscriber;
+            subscriber.id = id;
+            subscriber.completion = std::move(completion);
+            subscriber.submitTime = now;
+            subscriber.priority = priority;
+            item->subscribers.push_back(std::move(subscriber));
+            m_byId[id] = item;
+        }
+        m_wake.notify_one();
+        return id;
+    }
+
+    // Boosts the given requests to Visible; previously boosted requests that are not in
+    // `ids` go back to the priority they were submitted with.
+    void SetViewport(const RequestId* ids, size_t count)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::unordered_set<Item*> inView;
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto it = m_byId.find(ids[i]);
+            if (it == m_byId.end())
+                continue;
+            std::shared_ptr<Item> item = it->second;
+            inView.insert(item.get());
+            item->viewportBoosted = true;
+            if (item->queued && item->priority != RequestPriority::Visible)
+                Requeue(item, RequestPriority::Visible);
+        }
+
+        for (auto& entry : m_byKey)
+        {
+            std::shared_ptr<Item>& item = entry.second;
+            if (item->viewportBoosted && !inView.count(item.get()))
+            {
+                item->viewportBoosted = false;
+                if (item->queued && item->priority < item->basePriority)
+                    Requeue(item, item->basePriority);
+            }
+        }
+    }
+
+    // Removes one subscriber. The job itself is dropped only if nobody else waits for it
+    // and it has not started yet.
+    bool Cancel(RequestId id)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_byId.find(id);
+        if (it == m_byId.end())
+            return false;
+
+        std::shared_ptr<Item> item = it->second;
+        m_byId.erase(it);
+        for (auto sub = item->subscribers.begin(); sub != item->subscribers.end(); ++sub)
+        {
+            if (sub->id == id)
+            {
+                item->subscribers.erase(sub);
+                break;
+            }
+        }
+        ++m_stats.cancelled;
+
+        if (item->subscribers.empty() && item->queued)
+        {
+            Dequeue(item);
+            m_byKey.erase(item->key);
+        }
+        return true;
+    }
+
+    // Runs the next item on the calling thread. With wait=true blocks until work arrives or
+    // Stop() is called. Returns false when nothing was run and the scheduler is stopping
+    // (wait=true) or the queue is empty (wait=false).
+    bool RunNext(bool wait = false)
+    {
+        std::shared_ptr<Item> item;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            for (;;)
+            {
+                if (m_stopping)
+                    return false;
+                item = PickNext();
+                if (item || !wait)
+                    break;
+                // Sleep until new work arrives; wake periodically so aging and deadlines progress
+                m_wake.wait_for(lock, std::chrono::milliseconds(100));
+            }
+            if (!item)
+                return false;
+        }
+
+        Result result = item->job();
+
+        std::vector<Subscriber> subscribers;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            uint64_t now = m_clock();
+            ++m_stats.executed;
+            EraseDeadline(item);
+            auto keyIt = m_byKey.find(item->key);
+            if (keyIt != m_byKey.end() && keyIt->second == item)
+                m_byKey.erase(keyIt);
+            subscribers.swap(item->subscribers);
+            for (const Subscriber& subscriber : subscribers)
+            {
+                m_byId.erase(subscriber.id);
+                size_t cls = static_cast<size_t>(subscriber.priority);
+                ++m_stats.completedByClass[cls];
+                m_stats.totalWaitMsByClass[cls] += now - subscriber.submitTime;
+            }
+        }
+
+        for (const Subscriber& subscriber : subscribers)
+        {
+            if (subscriber.completion)
+                subscriber.completion(subscriber.id, result);
+        }
+        return true;
+    }
+
+    size_t PendingCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t count = 0;
+        for (size_t i = 0; i < CLASS_COUNT; ++i)
+            count += m_queues[i].size();
+        return count;
+    }
+
+    RequestSchedulerStats GetStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+private:
+    struct Subscriber
+    {
+        RequestId id;
+        Completion completion;
+        uint64_t submitTime;
+        RequestPriority priority;
+    };
+
+    struct Item
+    {
+        std::string key;
+        Job job;
+        RequestPriority basePriority = RequestPriority::Normal;
+        RequestPriority priority = RequestPriority::Normal;
+        uint64_t sequence = 0;
+        uint64_t classEnterTime = 0;
+        uint64_t deadline = 0;
+        bool queued = false;
+        bool viewportBoosted = false;
+        std::vector<Subscriber> subscribers;
+    };
+
+    static uint64_t SteadyNowMs()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void Enqueue(const std::shared_ptr<Item>& item, RequestPriority priority, uint64_t now)
+    {
+        item->priority = priority;
+        item->classEnterTime = now;
+        item->queued = true;
+        m_queues[static_cast<size_t>(priority)][item->sequence] = item;
+        m_entered[static_cast<size_t>(priority)][std::make_pair(now, item->sequence)] = item;
+    }
+
+    void EraseFromClass(const std::shared_ptr<Item>& item)
+    {
+        size_t cls = static_cast<size_t>(item->priority);
+        m_queues[cls].erase(item->sequence);
+        m_entered[cls].erase(std::make_pair(item->classEnterTime, item->sequence));
+    }
+
+    void Dequeue(const std::shared_ptr<Item>& item)
+    {
+        EraseFromClass(item);
+        EraseDeadline(item);
+        item->queued = false;
+    }
+
+    void Requeue(const std::shared_ptr<Item>& item, RequestPriority priority)
+    {
+        EraseFromClass(item);
+        Enqueue(item, priority, m_clock());
+    }
+
+    void SetDeadline(const std::shared_ptr<Item>& item, uint64_t deadline)
+    {
+        EraseDeadline(item);
+        item->deadline = deadline;
+        m_deadlines.emplace(deadline, item);
+    }
+
+    void EraseDeadline(const std::shared_ptr<Item>& item)
+    {
+        if (!item->deadline)
+            return;
+        auto range = m_deadlines.equal_range(item->deadline);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == item)
+            {
+                m_deadlines.erase(it);
+                break;
+            }
+        }
+        item->deadline = 0;
+    }
+
+    std::shared_ptr<Item> PickNext()
+    {
+        uint64_t now = m_clock();
+
+        // 1. Overdue requests first
+        if (!m_deadlines.empty() && m_deadlines.begin()->first <= now)
+        {
+            std::shared_ptr<Item> item = m_deadlines.begin()->second;
+            Dequeue(item);
+            ++m_stats.deadlinePicks;
+            return item;
+        }
+
+        // 2. Promote requests that waited too long in a lower class. Longest in the class first:
+        //    a demoted item re-enters with a fresh time but keeps its place in the FIFO order.
+        for (size_t cls = 1; cls < CLASS_COUNT; ++cls)
+        {
+            uint64_t limit = m_agingLimitMs[cls];
+            if (!limit)
+                continue;
+            while (!m_entered[cls].empty())
+            {
+                std::shared_ptr<Item> head = m_entered[cls].begin()->second;
+                if (now - head->classEnterTime < limit)
+                    break;
+                Requeue(head, static_cast<RequestPriority>(cls - 1));
+                ++m_stats.agingPromotions;
+            }
+        }
+
+        // 3. Highest class, oldest first
+        for (size_t cls = 0; cls < CLASS_COUNT; ++cls)
+        {
+            if (!m_queues[cls].empty())
+            {
+                std::shared_ptr<Item> item = m_queues[cls].begin()->second;
+                Dequeue(item);
+                return item;
+            }
+        }
+        return nullptr;
+    }
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::vector<std::thread> m_workers;
+    bool m_stopping = false;
+    Clock m_clock;
+    uint64_t m_agingLimitMs[CLASS_COUNT];
+    RequestId m_lastId = 0;
+    uint64_t m_lastSequence = 0;
+
+    std::map<uint64_t, std::shared_ptr<Item>> m_queues[CLASS_COUNT];   // sequence -> item
+    std::map<std::pair<uint64_t, uint64_t>, std::shared_ptr<Item>> m_entered[CLASS_COUNT]; // (class enter time, sequence) -> item
+    std::multimap<uint64_t, std::shared_ptr<Item>> m_deadlines;       // deadline -> item
+    std::unordered_map<std::string, std::shared_ptr<Item>> m_byKey;
+    std::unordered_map<RequestId, std::shared_ptr<Item>> m_byId;
+    RequestSchedulerStats m_stats = {};
+};
@@ -0,0 +1,213 @@
+#include "pch.h"
+#include "RingImpl.h"
+#include "BitmapUtils.h"
+#include "FrameRing.h"
+#include "TextUtils.h"
+#include "ThumbnailImpl.h"
+#include <cwctype>
+#include <mutex>
+
+namespace
+{
+    const UINT MAX_SLOT_COUNT = 64;
+    const UINT MAX_NAME_LENGTH = 64;
+
+    // Behind the opaque WSP_FRAME_RING handle; exactly one of writer/reader is set
+    struct RingHandle
+    {
+        std::mutex lock;
+        std::unique_ptr<FrameRingWriter> writer;
+        std::unique_ptr<FrameRingReader> reader;
+    };
+
+    RingHandle* FromHandle(WSP_FRAME_RING hRing)
+    {
+        return reinterpret_cast<RingHandle*>(hRing);
+    }
+
+    // Names become kernel object names; keep them to a plain identifier
+    bool IsValidRingName(LPCWSTR name)
+    {
+        if (!name || !*name || wcslen(name) > MAX_NAME_LENGTH)
+            return false;
+        for (LPCWSTR p = name; *p; ++p)
+        {
+            if (!iswalnum(*p) && *p != L'-' && *p != L'_' && *p != L'.')
+                return false;
+        }
+        return true;
+    }
+
+    HRESULT WriteBitmap(RingHandle* handle, HBITMAP hBitmap, UINT timeoutMs, ULONGLONG* pSequence)
+    {
+        std::lock_guard<std::mutex> lock(handle->lock);
+        FrameRingWriter* writer = handle->writer.get();
+        if (!writer)
+            return E_ILLEGAL_METHOD_CALL;
+
+        // GetDIBits writes straight into the slot the consumer will map
+        HRESULT hrSlot = S_OK;
+        AlphaMode alpha = AlphaMode::Ignore;
+        HRESULT hr = ReadHBITMAPPixels(hBitmap, [writer, timeoutMs, &hrSlot](uint32_t width, uint32_t height) -> uint8_t*
+        {
+            uint8_t* pixels = writer->BeginFrame(width, height, timeoutMs);
+            if (!pixels)
+            {
+                bool tooLarge = static_cast<uint64_t>(width) * height * 4 > writer->SlotBytes();
+                hrSlot = HRESULT_FROM_WIN32(tooLarge ? ERROR_INSUFFICIENT_BUFFER : ERROR_TIMEOUT);
+            }
+            return pixels;
+        }, &alpha);
+
+        if (FAILED(hrSlot))
+            return hrSlot;
+        if (FAILED(hr))
+            return hr;
+
+        ULONGLONG sequence = writer->PublishFrame(alpha);
+        if (pSequence)
+            *pSequence = sequence;
+        return S_OK;
+    }
+}
+
+HRESULT CreateFrameRingImpl(LPCWSTR name, UINT slotCount, UINT slotBytes, WSP_FRAME_RING* phRing)
+{
+    if (!phRing)
+        return E_INVALIDARG;
+
+    *phRing = nullptr;
+
+    if (!IsValidRingName(name) || slotCount == 0 || slotCount > MAX_SLOT_COUNT || slotBytes == 0)
+        return E_INVALIDARG;
+
+    RingHandle* handle = new (std::nothrow) RingHandle();
+    if (!handle)
+        return E_OUTOFMEMORY;
+
+    handle->writer = FrameRingWriter::Create(WideToUtf8(name), slotCount, slotBytes);
+    if (!handle->writer)
+    {
+        delete handle;
+        return E_OUTOFMEMORY;
+    }
+
+    *phRing = reinterpret_cast<WSP_FRAME_RING>(handle);
+    return S_OK;
+}
+
+HRESULT OpenFrameRingImpl(LPCWSTR name, WSP_FRAME_RING* phRing)
+{
+    if (!phRing)
+        return E_INVALIDARG;
+
+    *phRing = nullptr;
+
+    if (!IsValidRingName(name))
+        return E_INVALIDARG;
+
+    RingHandle* handle = new (std::nothrow) RingHandle();
+    if (!handle)
+        return E_OUTOFMEMORY;
+
+    handle->reader = FrameRingReader::Open(WideToUtf8(name));
+    if (!handle->reader)
+    {
+        delete handle;
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+
+    *phRing = reinterpret_cast<WSP_FRAME_RING>(handle);
+    return S_OK;
+}
+
+HRESULT WriteBitmapToFrameRingImpl(WSP_FRAME_RING hRing, HBITMAP hBitmap, UINT timeoutMs, ULONGLONG* pSequence)
+{
+    if (!hRing || !hBitmap)
+        return E_INVALIDARG;
+
+    return WriteBitmap(FromHandle(hRing), hBitmap, timeoutMs, pSequence);
+}
+
+HRESULT WriteFileThumbnailToFrameRingImpl(WSP_FRAME_RING hRing, LPCWSTR filePath, UINT size, UINT timeoutMs, ULONGLONG* pSequence)
+{
+    if (!hRing || !filePath)
+        return E_INVALIDARG;
+
+    // Extraction runs outside the ring lock
+    HBITMAP hBitmap = nullptr;
+    HRESULT hr = GetFileThumbnailImpl(filePath, size, &hBitmap);
+    if (FAILED(hr) || !hBitmap)
+        return FAILED(hr) ? hr : E_FAIL;
+
+    hr = WriteBitmap(FromHandle(hRing), hBitmap, timeoutMs, pSequence);
+    DeleteObject(hBitmap);
+    return hr;
+}
+
+HRESULT AcquireRingFrameImpl(WSP_FRAME_RING hRing, UINT timeoutMs, WSP_RING_FRAME* pFrame)
+{
+    if (!hRing || !pFrame)
+        return E_INVALIDARG;
+
+    RingHandle* handle = FromHandle(hRing);
+    std::lock_guard<std::mutex> lock(handle->lock);
+    if (!handle->reader)
+        return E_ILLEGAL_METHOD_CALL;
+
+    RingFrame frame;
+    if (!handle->reader->AcquireFrame(timeoutMs, &frame))
+        return HRESULT_FROM_WIN32(ERROR_TIMEOUT);
+
+    pFrame->pixels = frame.pixels;
+    pFrame->width = frame.width;
+    pFrame->height = frame.height;
+    pFrame->stride = static_cast<UINT>(frame.stride);
+    pFrame->alpha = static_cast<WSP_ALPHA_MODE>(frame.alpha);
+    pFrame->sequence = frame.sequence;
+    return S_OK;
+}
+
+HRESULT ReleaseRingFrameImpl(WSP_FRAME_RING hRing)
+{
+    if (!hRing)
+        return E_INVALIDARG;
+
+    RingHandle* handle = FromHandle(hRing);
+    std::lock_guard<std::mutex> lock(handle->lock);
+    if (!handle->reader)
+        return E_ILLEGAL_METHOD_CALL;
+
+    handle->reader->ReleaseFrame();
+    return S_OK;
+}
+
+HRESULT GetFrameRingStatsImpl(WSP_FRAME_RING hRing, WSP_FRAME_RING_STATS* pStats)
+{
+    if (!hRing || !pStats)
+        return E_INVALIDARG;
+
+    RingHandle* handle = FromHandle(hRing);
+    std::lock_guard<std::mutex> lock(handle->lock);
+
+    *pStats = {};
+    if (handle->writer)
+    {
+        FrameRingStats stats = handle->writer->Stats();
+        pStats->published = stats.published;
+        pStats->backpressureWaits = stats.backpressureWaits;
+        pStats->timeouts = stats.timeouts;
+        pStats->oversized = stats.oversized;
+        pStats->pending = handle->writer->Pending();
+    }
+    else if (handle->reader)
+    {
+        pStats->pending = handle->reader->Pending();
+    }
+    return S_OK;
+}
+
+void CloseFrameRingImpl(WSP_FRAME_RING hRing)
+{
+    delete FromHandle(hRing);
+}
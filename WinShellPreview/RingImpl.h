@@ -0,0 +1,13 @@
+#pragma once
+#include "framework.h"
+#include "WinShellPreview.h"
+
+// Shared-memory frame ring handles: the creating process writes, one other process reads
+HRESULT CreateFrameRingImpl(LPCWSTR name, UINT slotCount, UINT slotBytes, WSP_FRAME_RING* phRing);
+HRESULT OpenFrameRingImpl(LPCWSTR name, WSP_FRAME_RING* phRing);
+HRESULT WriteBitmapToFrameRingImpl(WSP_FRAME_RING hRing, HBITMAP hBitmap, UINT timeoutMs, ULONGLONG* pSequence);
+HRESULT WriteFileThumbnailToFrameRingImpl(WSP_FRAME_RING hRing, LPCWSTR filePath, UINT size, UINT timeoutMs, ULONGLONG* pSequence);
+HRESULT AcquireRingFrameImpl(WSP_FRAME_RING hRing, UINT timeoutMs, WSP_RING_FRAME* pFrame);
+HRESULT ReleaseRingFrameImpl(WSP_FRAME_RING hRing);
+HRESULT GetFrameRingStatsImpl(WSP_FRAME_RING hRing, WSP_FRAME_RING_STATS* pStats);
+void CloseFrameRingImpl(WSP_FRAME_RING hRing);
@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "SchedulerImpl.h"
+#include "ThumbnailImpl.h"
+#include "ShellContext.h"
+#include "CoalescingImpl.h"
+#include "RequestScheduler.h"
+#include <algorithm>
+#include <mutex>
+
+namespace
+{
+    // One extraction result shared by every deduplicated subscriber
+    struct ThumbnailJobResult
+    {
+        HRESULT hr;
+        std::shared_ptr<void> bitmap; // owns the HBITMAP
+    };
+
+    typedef RequestScheduler<ThumbnailJobResult> ThumbnailScheduler;
+
+    const size_t MIN_WORKERS = 2;
+    const size_t MAX_WORKERS = 8;
+
+    std::mutex g_schedulerLock;
+    // Intentionally leaked unless ShutdownThumbnailScheduler is called: joining worker threads
+    // from a static destructor during DLL unload would deadlock on the loader lock.
+    ThumbnailScheduler* g_scheduler = nullptr;
+
+    // Caller must hold g_schedulerLock
+    ThumbnailScheduler* GetScheduler(bool create)
+    {
+        if (!g_scheduler && create)
+        {
+            g_scheduler = new (std::nothrow) ThumbnailScheduler();
+            if (g_scheduler)
+            {
+                size_t workers = std::thread::hardware_concurrency();
+                workers = (std::min)((std::max)(workers, MIN_WORKERS), MAX_WORKERS);
+                g_scheduler->Start(workers,
+                    []() { CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE); },
+                    []() { ShellContext::ReleaseCurrentThread(); CoUninitialize(); });
+            }
+        }
+        return g_scheduler;
+    }
+}
+
+HRESULT SubmitThumbnailRequestImpl(LPCWSTR filePath, UINT size, WSP_PRIORITY priority,
+                                   WSP_THUMBNAIL_CALLBACK callback, void* context, ULONGLONG* pRequestId)
+{
+    if (!filePath || !callback || !pRequestId)
+        return E_INVALIDARG;
+    if (priority < WSP_PRIORITY_VISIBLE || priority > WSP_PRIORITY_BACKGROUND)
+        return E_INVALIDARG;
+
+    *pRequestId = 0;
+
+    // Opens the file; done before taking the lock so a slow volume does not block other callers
+    std::string key = MakeFileIdentityKey(filePath) + "|" + std::to_string(size);
+
+    std::lock_guard<std::mutex> lock(g_schedulerLock);
+    ThumbnailScheduler* scheduler = GetScheduler(true);
+    if (!scheduler)
+        return E_OUTOFMEMORY;
+
+    std::wstring path(filePath);
+
+    ThumbnailScheduler::Job job = [path, size]()
+    {
+        ThumbnailJobResult result = {};
+        HBITMAP hBitmap = nullptr;
+        result.hr = GetFileThumbnailImpl(path.c_str(), size, &hBitmap);
+        if (SUCCEEDED(result.hr) && hBitmap)
+            result.bitmap.reset(hBitmap, [](void* p) { DeleteObject(static_cast<HBITMAP>(p)); });
+        return result;
+    };
+
+    // Every subscriber gets its own bitmap and releases it with ReleasePreviewBitmap
+    ThumbnailScheduler::Completion completion = [callback, context](ULONGLONG id, const ThumbnailJobResult& result)
+    {
+        HBITMAP hCopy = nullptr;
+        HRESULT hr = result.hr;
+        if (SUCCEEDED(hr) && result.bitmap)
+        {
+            // LR_CREATEDIBSECTION keeps the 32bpp DIB section (and its premultiplied alpha)
+            // instead of converting it to a device-dependent bitmap
+            hCopy = static_cast<HBITMAP>(CopyImage(static_cast<HBITMAP>(result.bitmap.get()), IMAGE_BITMAP, 0, 0, LR_CREATEDIBSECTION));
+            if (!hCopy)
+                hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        callback(id, hr, hCopy, context);
+    };
+
+    *pRequestId = scheduler->Submit(key, static_cast<RequestPriority>(priority), job, completion);
+    return S_OK;
+}
+
+HRESULT SetVisibleThumbnailRequestsImpl(const ULONGLONG* requestIds, UINT count)
+{
+    if (!requestIds && count)
+        return E_INVALIDARG;
+
+    std::lock_guard<std::mutex> lock(g_schedulerLock);
+    ThumbnailScheduler* scheduler = GetScheduler(false);
+    if (!scheduler)
+        return S_FALSE;
+
+    std::vector<ThumbnailScheduler::RequestId> ids(requestIds, requestIds + count);
+    scheduler->SetViewport(ids.data(), ids.size());
+    return S_OK;
+}
+
+HRESULT CancelThumbnailRequestImpl(ULONGLONG requestId)
+{
+    std::lock_guard<std::mutex> lock(g_schedulerLock);
+    ThumbnailScheduler* scheduler = GetScheduler(false);
+    if (!scheduler)
+        return S_FALSE;
+
+    return scheduler->Cancel(requestId) ? S_OK : S_FALSE;
+}
+
+void ShutdownThumbnailSchedulerImpl()
+{
+    ThumbnailScheduler* scheduler = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_schedulerLock);
+        scheduler = g_scheduler;
+        g_scheduler = nullptr;
+    }
+    // Stops workers after their current job; queued requests are dropped without callbacks
+    delete scheduler;
+}
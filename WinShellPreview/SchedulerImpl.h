@@ -0,0 +1,10 @@
+#pragma once
+#include "framework.h"
+#include "WinShellPreview.h"
+
+// Scheduled (asynchronous) thumbnail requests
+HRESULT SubmitThumbnailRequestImpl(LPCWSTR filePath, UINT size, WSP_PRIORITY priority,
+                                   WSP_THUMBNAIL_CALLBACK callback, void* context, ULONGLONG* pRequestId);
+HRESULT SetVisibleThumbnailRequestsImpl(const ULONGLONG* requestIds, UINT count);
+HRESULT CancelThumbnailRequestImpl(ULONGLONG requestId);
+void ShutdownThumbnailSchedulerImpl();
@@ -0,0 +1,76 @@
+#pragma once
+#include "ImageOps.h"
+#include "ObjectCache.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Thread-safe LRU of immutable images keyed by string (extension icons, small mips, ...).
+// No Windows dependencies.
+class SharedImageCache
+{
+public:
+    typedef std::shared_ptr<const PixelImage> ImagePtr;
+
+    explicit SharedImageCache(size_t capacity) : m_cache(capacity) {}
+
+    ImagePtr Find(const std::string& key)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ImagePtr* found = m_cache.Find(key);
+        return found ? *found : ImagePtr();
+    }
+
+    void Insert(const std::string& key, ImagePtr image)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cache.Insert(key, std::move(image));
+    }
+
+    bool Erase(const std::string& key)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_cache.Erase(key);
+    }
+
+    // Drops every entry whose key starts with prefix
+    size_t ErasePrefix(const std::string& prefix)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_cache.EraseIf([&prefix](const std::string& key)
+        {
+            return key.compare(0, prefix.size(), prefix) == 0;
+        });
+    }
+
+    // Most recently used first; inserting them in reverse order rebuilds the same LRU order
+    std::vector<std::pair<std::string, ImagePtr>> Entries() const
+    {
+        std::vector<std::pair<std::string, ImagePtr>> entries;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        entries.reserve(m_cache.Size());
+        m_cache.ForEach([&entries](const std::string& key, const ImagePtr& image)
+        {
+            entries.emplace_back(key, image);
+        });
+        return entries;
+    }
+
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cache.Clear();
+    }
+
+    ObjectCacheStats Stats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_cache.Stats();
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    LruCache<std::string, ImagePtr> m_cache;
+};
@@ -0,0 +1,347 @@
+#include "pch.h"
+#include "ShellContext.h"
+#include "PathsImpl.h"
+#include <atomic>
+#include <mutex>
+#include <set>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    std::atomic<ULONGLONG> g_thumbnailCacheCreated{0};
+    std::atomic<ULONGLONG> g_thumbnailCacheReused{0};
+    std::atomic<ULONGLONG> g_desktopFolderCreated{0};
+    std::atomic<ULONGLONG> g_desktopFolderReused{0};
+    std::atomic<ULONGLONG> g_folderHits{0};
+    std::atomic<ULONGLONG> g_folderMisses{0};
+    std::atomic<ULONGLONG> g_folderEvictions{0};
+    std::atomic<ULONG> g_folderGeneration{0};
+
+    // Directory keys bound by any thread since the last InvalidateAllThreads. Past the limit
+    // the registry is dropped together with every thread's folders, so it stays a superset.
+    const size_t BOUND_FOLDER_LIMIT = 4096;
+    std::mutex g_boundFoldersLock;
+    std::set<std::string> g_boundFolders;
+
+    std::string TrimSeparators(std::string key)
+    {
+        while (!key.empty() && key.back() == '\\')
+            key.pop_back();
+        return key;
+    }
+
+    void RegisterBoundFolder(const std::string& key)
+    {
+        std::lock_guard<std::mutex> lock(g_boundFoldersLock);
+        if (g_boundFolders.size() >= BOUND_FOLDER_LIMIT)
+        {
+            g_boundFolders.clear();
+            g_folderGeneration.fetch_add(1, std::memory_order_acq_rel);
+        }
+        g_boundFolders.insert(TrimSeparators(key));
+    }
+}
+
+// Releases the thread's Shell objects right before its COM apartment is torn down.
+// Holding apartment-bound interfaces past the final CoUninitialize would crash on release.
+class ShellContext::UninitializeSpy : public IInitializeSpy
+{
+public:
+    explicit UninitializeSpy(ShellContext* owner) : m_refCount(1), m_owner(owner) {}
+
+    void Detach() { m_owner = nullptr; }
+
+    // IUnknown
+    IFACEMETHODIMP QueryInterface(REFIID riid, void** ppv)
+    {
+        if (!ppv)
+            return E_POINTER;
+        if (riid == IID_IUnknown || riid == IID_IInitializeSpy)
+        {
+            *ppv = static_cast<IInitializeSpy*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *ppv = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    IFACEMETHODIMP_(ULONG) AddRef() { return InterlockedIncrement(&m_refCount); }
+
+    IFACEMETHODIMP_(ULONG) Release()
+    {
+        ULONG count = InterlockedDecrement(&m_refCount);
+        if (count == 0)
+            delete this;
+        return count;
+    }
+
+    // IInitializeSpy
+    IFACEMETHODIMP PreInitialize(DWORD, DWORD) { return S_OK; }
+    IFACEMETHODIMP PostInitialize(HRESULT hrCoInit, DWORD, DWORD) { return hrCoInit; }
+
+    IFACEMETHODIMP PreUninitialize(DWORD dwCurThreadAptRefs)
+    {
+        // Only the outermost CoUninitialize ends the apartment
+        if (dwCurThreadAptRefs == 1 && m_owner)
+            m_owner->Reset();
+        return S_OK;
+    }
+
+    IFACEMETHODIMP PostUninitialize(DWORD) { return S_OK; }
+
+private:
+    LONG m_refCount;
+    ShellContext* m_owner;
+};
+
+ShellContext::ShellContext()
+    : m_folders(FOLDER_CACHE_CAPACITY), m_spy(nullptr),
+      m_folderGeneration(g_folderGeneration.load(std::memory_order_acquire))
+{
+    m_spyCookie.QuadPart = 0;
+}
+
+ShellContext::~ShellContext()
+{
+    Reset();
+
+    if (m_spy)
+    {
+        m_spy->Detach();
+        CoRevokeInitializeSpy(m_spyCookie);
+        m_spy->Release();
+        m_spy = nullptr;
+    }
+}
+
+ShellContext& ShellContext::ForCurrentThread()
+{
+    ShellContext& context = PerThread<ShellContext>::Get();
+    context.EnsureUninitializeSpy();
+
+    ULONG generation = g_folderGeneration.load(std::memory_order_acquire);
+    if (context.m_folderGeneration != generation)
+    {
+        context.m_folders.Clear();
+        context.m_folderGeneration = generation;
+    }
+    return context;
+}
+
+void ShellContext::InvalidateAllThreads()
+{
+    std::lock_guard<std::mutex> lock(g_boundFoldersLock);
+    g_boundFolders.clear();
+    g_folderGeneration.fetch_add(1, std::memory_order_acq_rel);
+}
+
+bool ShellContext::IsFolderBound(LPCWSTR pszDirectory)
+{
+    if (!pszDirectory)
+        return false;
+
+    PathRef directory = InternPath(pszDirectory);
+    if (!directory)
+        return false;
+
+    // The directory itself or anything below it (bound through it)
+    std::string prefix = TrimSeparators(directory->key);
+    std::lock_guard<std::mutex> lock(g_boundFoldersLock);
+    std::set<std::string>::const_iterator it = g_boundFolders.lower_bound(prefix);
+    for (; it != g_boundFolders.end() && it->compare(0, prefix.size(), prefix) == 0; ++it)
+    {
+        if (it->size() == prefix.size() || (*it)[prefix.size()] == '\\')
+            return true;
+    }
+    return false;
+}
+
+void ShellContext::ReleaseCurrentThread()
+{
+    PerThread<ShellContext>::Release();
+}
+
+void ShellContext::EnsureUninitializeSpy()
+{
+    if (m_spy)
+        return;
+
+    UninitializeSpy* spy = new (std::nothrow) UninitializeSpy(this);
+    if (!spy)
+        return;
+
+    if (SUCCEEDED(CoRegisterInitializeSpy(spy, &m_spyCookie)))
+    {
+        m_spy = spy;
+    }
+    else
+    {
+        spy->Release();
+    }
+}
+
+HRESULT ShellContext::GetThumbnailCache(IThumbnailCache** ppCache)
+{
+    if (!ppCache)
+        return E_INVALIDARG;
+
+    *ppCache = nullptr;
+
+    if (m_thumbnailCache)
+    {
+        g_thumbnailCacheReused.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        HRESULT hr = CoCreateInstance(CLSID_LocalThumbnailCache, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&m_thumbnailCache));
+        if (FAILED(hr))
+            return hr;
+        g_thumbnailCacheCreated.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return m_thumbnailCache.CopyTo(ppCache);
+}
+
+HRESULT ShellContext::GetDesktopFolder(IShellFolder** ppFolder)
+{
+    if (!ppFolder)
+        return E_INVALIDARG;
+
+    *ppFolder = nullptr;
+
+    if (m_desktopFolder)
+    {
+        g_desktopFolderReused.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        HRESULT hr = SHGetDesktopFolder(&m_desktopFolder);
+        if (FAILED(hr))
+            return hr;
+        g_desktopFolderCreated.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return m_desktopFolder.CopyTo(ppFolder);
+}
+
+HRESULT ShellContext::GetFolderEntry(const PathRecord& directory, FolderEntry** ppEntry)
+{
+    *ppEntry = nullptr;
+
+    FolderEntry* entry = m_folders.Find(directory.key);
+    if (entry)
+    {
+        g_folderHits.fetch_add(1, std::memory_order_relaxed);
+        *ppEntry = entry;
+        return S_OK;
+    }
+
+    g_folderMisses.fetch_add(1, std::memory_order_relaxed);
+
+    FolderEntry newEntry;
+    HRESULT hr = SHCreateItemFromParsingName(WidePath(directory), nullptr, IID_PPV_ARGS(&newEntry.item));
+    if (FAILED(hr))
+        return hr;
+
+    hr = newEntry.item->BindToHandler(nullptr, BHID_SFObject, IID_PPV_ARGS(&newEntry.folder));
+    if (FAILED(hr))
+        return hr;
+
+    RegisterBoundFolder(directory.key);
+    ULONGLONG evictionsBefore = m_folders.Stats().evictions;
+    *ppEntry = &m_folders.Insert(directory.key, std::move(newEntry));
+    g_folderEvictions.fetch_add(m_folders.Stats().evictions - evictionsBefore, std::memory_order_relaxed);
+    return S_OK;
+}
+
+HRESULT ShellContext::GetParentFolder(LPCWSTR pszFilePath, IShellFolder** ppFolder, std::wstring* pChildName)
+{
+    if (!pszFilePath || !ppFolder || !pChildName)
+        return E_INVALIDARG;
+
+    *ppFolder = nullptr;
+
+    // The interned record already knows its directory; siblings share it
+    PathRef record = InternPath(pszFilePath);
+    if (!record || !record->parent)
+        return E_INVALIDARG;
+
+    FolderEntry* entry = nullptr;
+    HRESULT hr = GetFolderEntry(*record->parent, &entry);
+    if (FAILED(hr))
+        return hr;
+
+    *pChildName = WideName(*record);
+    return entry->folder.CopyTo(ppFolder);
+}
+
+HRESULT ShellContext::CreateItem(LPCWSTR pszFilePath, REFIID riid, void** ppv)
+{
+    if (!pszFilePath || !ppv)
+        return E_INVALIDARG;
+
+    *ppv = nullptr;
+
+    PathRef record = InternPath(pszFilePath);
+    if (record && record->parent)
+    {
+        FolderEntry* entry = nullptr;
+        if (SUCCEEDED(GetFolderEntry(*record->parent, &entry)))
+        {
+            HRESULT hr = SHCreateItemFromRelativeName(entry->item.Get(), WideName(*record).c_str(), nullptr, riid, ppv);
+            if (SUCCEEDED(hr))
+                return hr;
+
+            // If a full parse works, the bound folder was stale (renamed or replaced directory)
+            hr = SHCreateItemFromParsingName(WidePath(*record), nullptr, riid, ppv);
+            if (SUCCEEDED(hr))
+                m_folders.Erase(record->parent->key);
+            return hr;
+        }
+    }
+
+    return SHCreateItemFromParsingName(record ? WidePath(*record) : pszFilePath, nullptr, riid, ppv);
+}
+
+void ShellContext::InvalidateDirectory(LPCWSTR pszDirectory)
+{
+    if (!pszDirectory)
+        return;
+
+    PathRef directory = InternPath(pszDirectory);
+    if (!directory)
+        return;
+
+    std::string prefix = directory->key;
+    while (!prefix.empty() && prefix.back() == '\\')
+        prefix.pop_back();
+
+    // Subdirectories are bound through their parents, so drop them as well
+    m_folders.EraseIf([&prefix](const std::string& key)
+    {
+        return key.compare(0, prefix.size(), prefix) == 0 &&
+               (key.size() == prefix.size() || key[prefix.size()] == '\\');
+    });
+}
+
+void ShellContext::Reset()
+{
+    m_folders.Clear();
+    m_desktopFolder.Reset();
+    m_thumbnailCache.Reset();
+}
+
+ShellContextStats ShellContext::GetStats()
+{
+    ShellContextStats stats = {};
+    stats.thumbnailCacheCreated = g_thumbnailCacheCreated.load(std::memory_order_relaxed);
+    stats.thumbnailCacheReused = g_thumbnailCacheReused.load(std::memory_order_relaxed);
+    stats.desktopFolderCreated = g_desktopFolderCreated.load(std::memory_order_relaxed);
+    stats.desktopFolderReused = g_desktopFolderReused.load(std::memory_order_relaxed);
+    stats.folderHits = g_folderHits.load(std::memory_order_relaxed);
+    stats.folderMisses = g_folderMisses.load(std::memory_order_relaxed);
+    stats.folderEvictions = g_folderEvictions.load(std::memory_order_relaxed);
+    return stats;
+}
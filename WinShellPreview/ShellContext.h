@@ -0,0 +1,75 @@
+#pragma once
+#include "framework.h"
+#include "ObjectCache.h"
+#include "PathTable.h"
+
+// Process-wide reuse counters across all thread contexts
+struct ShellContextStats
+{
+    ULONGLONG thumbnailCacheCreated;
+    ULONGLONG thumbnailCacheReused;
+    ULONGLONG desktopFolderCreated;
+    ULONGLONG desktopFolderReused;
+    ULONGLONG folderHits;
+    ULONGLONG folderMisses;
+    ULONGLONG folderEvictions;
+};
+
+// Per-thread holder of Shell objects that are expensive to create and safe to reuse across
+// requests on the same apartment: the IThumbnailCache instance, the desktop folder and bound
+// parent folders keyed by directory.
+//
+// The context is released automatically when the thread's last CoUninitialize runs
+// (via IInitializeSpy), or explicitly with ShellContext::ReleaseCurrentThread().
+class ShellContext
+{
+public:
+    static const size_t FOLDER_CACHE_CAPACITY = 64;
+
+    ShellContext();
+    ~ShellContext();
+
+    static ShellContext& ForCurrentThread();
+    static void ReleaseCurrentThread();
+    static ShellContextStats GetStats();
+
+    HRESULT GetThumbnailCache(IThumbnailCache** ppCache);
+    HRESULT GetDesktopFolder(IShellFolder** ppFolder);
+
+    // Returns the bound parent folder of pszFilePath and the child's display name within it
+    HRESULT GetParentFolder(LPCWSTR pszFilePath, IShellFolder** ppFolder, std::wstring* pChildName);
+
+    // SHCreateItemFromParsingName equivalent that reuses the cached parent item
+    HRESULT CreateItem(LPCWSTR pszFilePath, REFIID riid, void** ppv);
+
+    // Drops cached folders (e.g. after a directory was renamed or deleted)
+    void InvalidateDirectory(LPCWSTR pszDirectory);
+    void Reset();
+
+    // Makes every thread drop its cached folders on its next ForCurrentThread()
+    static void InvalidateAllThreads();
+
+    // True if some thread may hold a bound folder for pszDirectory or a directory below it.
+    // Bound folders are registered process-wide until the next InvalidateAllThreads, so a
+    // false answer is exact and a true one may be stale (evicted entries stay registered).
+    static bool IsFolderBound(LPCWSTR pszDirectory);
+
+private:
+    struct FolderEntry
+    {
+        Microsoft::WRL::ComPtr<IShellItem> item;
+        Microsoft::WRL::ComPtr<IShellFolder> folder;
+    };
+
+    HRESULT GetFolderEntry(const PathRecord& directory, FolderEntry** ppEntry);
+    void EnsureUninitializeSpy();
+
+    Microsoft::WRL::ComPtr<IThumbnailCache> m_thumbnailCache;
+    Microsoft::WRL::ComPtr<IShellFolder> m_desktopFolder;
+    LruCache<std::string, FolderEntry> m_folders;       // By interned directory key
+
+    class UninitializeSpy;
+    UninitializeSpy* m_spy;
+    ULARGE_INTEGER m_spyCookie;
+    ULONG m_folderGeneration;
+};
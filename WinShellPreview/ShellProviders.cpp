@@ -0,0 +1,367 @@
+#include "pch.h"
+#include "ShellProviders.h"
+#include "PreviewHandler.h"
+#include "ImageOps.h"
+#include "TextUtils.h"
+#include <mutex>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    const uint64_t SAVE_RECORDS = 64;
+    const ULONGLONG SAVE_INTERVAL_MS = 60 * 1000;
+
+    // Where provider statistics persist between runs (empty = not persisted)
+    struct StatsFileState
+    {
+        std::mutex mutex;
+        std::wstring path;
+        ULONGLONG lastSaveTick = 0;
+    };
+
+    StatsFileState& GetStatsFileState()
+    {
+        static StatsFileState* state = new StatsFileState();
+        return *state;
+    }
+
+    void SaveStatsIfDue()
+    {
+        ProviderSelector& selector = GetImageProviderRegistry().Selector();
+        uint64_t unsaved = selector.UnsavedRecords();
+        if (unsaved == 0)
+            return;
+
+        StatsFileState& state = GetStatsFileState();
+        std::unique_lock<std::mutex> lock(state.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || state.path.empty())
+            return;     // Another thread is saving, or persistence is off
+
+        ULONGLONG now = GetTickCount64();
+        if (unsaved < SAVE_RECORDS && now - state.lastSaveTick < SAVE_INTERVAL_MS)
+            return;
+
+        state.lastSaveTick = now;
+        selector.Save(std::filesystem::path(state.path));
+    }
+
+    // Shorter side for providers that only produce square thumbnails
+    UINT SquareSize(const ImageRequest& request)
+    {
+        if (request.width == 0)
+            return request.height;
+        if (request.height == 0)
+            return request.width;
+        return min(request.width, request.height);
+    }
+
+    ProviderDescriptor MakeDescriptor(const char* name, uint32_t capabilities, double estimatedCostMs)
+    {
+        ProviderDescriptor descriptor;
+        descriptor.name = name;
+        descriptor.capabilities = capabilities;
+        descriptor.estimatedCostMs = estimatedCostMs;
+        return descriptor;
+    }
+
+    class ThumbnailCacheProvider : public ShellImageProvider
+    {
+    public:
+        explicit ThumbnailCacheProvider(bool cacheOnly) : m_cacheOnly(cacheOnly) {}
+
+        ProviderDescriptor Describe() const override
+        {
+            // Priors keep the historical order: cache probe, extraction through the cache,
+            // then the other methods
+            if (m_cacheOnly)
+                return MakeDescriptor("ThumbnailCacheLookup", PROVIDER_CAP_THUMBNAIL | PROVIDER_CAP_CACHE_ONLY, 5.0);
+            return MakeDescriptor("ThumbnailCache", PROVIDER_CAP_THUMBNAIL, 40.0);
+        }
+
+        int32_t Provide(const ImageRequest& request, ShellImage* image) override
+        {
+            PreviewHandler handler;
+            return handler.GetThumbnailUsingIThumbnailCache(request.path.c_str(), SquareSize(request),
+                                                            m_cacheOnly ? WTS_INCACHEONLY : WTS_EXTRACT, &image->bitmap, &image->alpha);
+        }
+
+    private:
+        bool m_cacheOnly;
+    };
+
+    class ImageFactoryProvider : public ShellImageProvider
+    {
+    public:
+        ProviderDescriptor Describe() const override
+        {
+            return MakeDescriptor("ShellItemImageFactory", PROVIDER_CAP_THUMBNAIL | PROVIDER_CAP_ICON_FALLBACK, 60.0);
+        }
+
+        int32_t Provide(const ImageRequest& request, ShellImage* image) override
+        {
+            PreviewHandler handler;
+            HRESULT hr = handler.GetImageUsingIShellItemImageFactory(request.path.c_str(), SquareSize(request), &image->bitmap);
+            image->alpha = WTSAT_UNKNOWN;
+            return hr;
+        }
+    };
+
+    class ExtractImageProvider : public ShellImageProvider
+    {
+    public:
+        ProviderDescriptor Describe() const override
+        {
+            return MakeDescriptor("ExtractImage", PROVIDER_CAP_RECTANGULAR, 30.0);
+        }
+
+        int32_t Provide(const ImageRequest& request, ShellImage* image) override
+        {
+            PreviewHandler handler;
+            HRESULT hr = handler.GetThumbnailUsingIExtractImage(request.path.c_str(), request.width, request.height, &image->bitmap);
+            image->alpha = WTSAT_UNKNOWN;
+            return hr;
+        }
+    };
+
+    class ThumbnailProviderProvider : public ShellImageProvider
+    {
+    public:
+        ProviderDescriptor Describe() const override
+        {
+            return MakeDescriptor("ThumbnailProvider", PROVIDER_CAP_THUMBNAIL | PROVIDER_CAP_ALPHA, 120.0);
+        }
+
+        int32_t Provide(const ImageRequest& request, ShellImage* image) override
+        {
+            PreviewHandler handler;
+            image->alpha = WTSAT_UNKNOWN;
+            return handler.GetThumbnailUsingIThumbnailProvider(request.path.c_str(), SquareSize(request), &image->bitmap, &image->alpha);
+        }
+    };
+
+    // Decodes the file itself with WIC, scaled to fit and placed top-left on a white canvas of
+    // the requested size (the layout the Shell cache providers return)
+    class WicDecoderProvider : public ShellImageProvider
+    {
+    public:
+        ProviderDescriptor Describe() const override
+        {
+            ProviderDescriptor descriptor = MakeDescriptor("WicDecoder", PROVIDER_CAP_THUMBNAIL | PROVIDER_CAP_RECTANGULAR, 150.0);
+            descriptor.fileTypes = { "bmp", "gif", "ico", "jpe", "jpeg", "jpg", "png", "tif", "tiff", "wdp", "jxr", "dds" };
+            return descriptor;
+        }
+
+        int32_t Provide(const ImageRequest& request, ShellImage* image) override
+        {
+            UINT canvasWidth = request.width ? request.width : request.height;
+            UINT canvasHeight = request.height ? request.height : request.width;
+            if (canvasWidth == 0 || canvasHeight == 0)
+                return E_INVALIDARG;
+
+            ComPtr<IWICImagingFactory> factory;
+            HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+            if (FAILED(hr))
+                return hr;
+
+            ComPtr<IWICBitmapDecoder> decoder;
+            hr = factory->CreateDecoderFromFilename(request.path.c_str(), nullptr, GENERIC_READ,
+                                                    WICDecodeMetadataCacheOnDemand, &decoder);
+            ComPtr<IWICBitmapFrameDecode> frame;
+            if (SUCCEEDED(hr))
+                hr = decoder->GetFrame(0, &frame);
+            UINT width = 0, height = 0;
+            if (SUCCEEDED(hr))
+                hr = frame->GetSize(&width, &height);
+            if (SUCCEEDED(hr) && (width == 0 || height == 0))
+                hr = WINCODEC_ERR_BADIMAGE;
+            if (FAILED(hr))
+                return hr;
+
+            // Fit inside the canvas; never enlarge
+            double scale = min(1.0, min(static_cast<double>(canvasWidth) / width, static_cast<double>(canvasHeight) / height));
+            UINT scaledWidth = max(1u, static_cast<UINT>(width * scale + 0.5));
+            UINT scaledHeight = max(1u, static_cast<UINT>(height * scale + 0.5));
+
+            ComPtr<IWICBitmapScaler> scaler;
+            hr = factory->CreateBitmapScaler(&scaler);
+            if (SUCCEEDED(hr))
+                hr = scaler->Initialize(frame.Get(), scaledWidth, scaledHeight, WICBitmapInterpolationModeFant);
+            ComPtr<IWICFormatConverter> converter;
+            if (SUCCEEDED(hr))
+                hr = factory->CreateFormatConverter(&converter);
+            if (SUCCEEDED(hr))
+                hr = converter->Initialize(scaler.Get(), GUID_WICPixelFormat32bppPBGRA, WICBitmapDitherTypeNone,
+                                           nullptr, 0.0, WICBitmapPaletteTypeCustom);
+            if (FAILED(hr))
+                return hr;
+
+            BITMAPINFO bmi = {};
+            bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+            bmi.bmiHeader.biWidth = static_cast<LONG>(canvasWidth);
+            bmi.bmiHeader.biHeight = -static_cast<LONG>(canvasHeight);
+            bmi.bmiHeader.biPlanes = 1;
+            bmi.bmiHeader.biBitCount = 32;
+            bmi.bmiHeader.biCompression = BI_RGB;
+
+            BYTE* bits = nullptr;
+            HBITMAP hBitmap = CreateDIBSection(nullptr, &bmi, DIB_RGB_COLORS, reinterpret_cast<void**>(&bits), nullptr, 0);
+            if (!hBitmap)
+                return E_OUTOFMEMORY;
+
+            UINT canvasStride = canvasWidth * 4;
+            memset(bits, 0xFF, static_cast<size_t>(canvasStride) * canvasHeight);
+
+            WICRect rect = { 0, 0, static_cast<INT>(scaledWidth), static_cast<INT>(scaledHeight) };
+            hr = converter->CopyPixels(&rect, canvasStride, canvasStride * scaledHeight, bits);
+            if (FAILED(hr))
+            {
+                DeleteObject(hBitmap);
+                return hr;
+            }
+
+            // Premultiplied pixels over white, then opaque
+            CompositeOverBackground(bits, scaledWidth, scaledHeight, canvasStride, AlphaMode::Premultiplied, 255, 255, 255);
+
+            image->bitmap = hBitmap;
+            image->alpha = WTSAT_RGB;
+            return S_OK;
+        }
+    };
+
+    ProviderRegistry<ShellImage>* CreateRegistry()
+    {
+        ProviderRegistry<ShellImage>* registry = new ProviderRegistry<ShellImage>();
+        registry->Register(std::make_shared<ThumbnailCacheProvider>(true));
+        registry->Register(std::make_shared<ThumbnailCacheProvider>(false));
+        registry->Register(std::make_shared<ImageFactoryProvider>());
+        registry->Register(std::make_shared<ExtractImageProvider>());
+        registry->Register(std::make_shared<ThumbnailProviderProvider>());
+        registry->Register(std::make_shared<WicDecoderProvider>());
+        return registry;
+    }
+}
+
+ProviderRegistry<ShellImage>& GetImageProviderRegistry()
+{
+    // Leaked on purpose: providers may hold COM state that must not be torn down under the loader lock
+    static ProviderRegistry<ShellImage>* registry = CreateRegistry();
+    return *registry;
+}
+
+ImageRequest MakeImageRequest(LPCWSTR pszFilePath, UINT cx, UINT cy)
+{
+    ImageRequest request;
+    request.path = pszFilePath;
+    request.fileType = FileTypeFromPath(request.path);
+    request.width = cx;
+    request.height = cy;
+
+    APTTYPE type;
+    APTTYPEQUALIFIER qualifier;
+    if (FAILED(CoGetApartmentType(&type, &qualifier)) || (type != APTTYPE_STA && type != APTTYPE_MAINSTA))
+        request.excludedCapabilities |= PROVIDER_CAP_NEEDS_STA;
+    return request;
+}
+
+HRESULT RunImageProviders(const ImageRequest& request, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha)
+{
+    *phbmp = nullptr;
+
+    ShellImage image;
+    ProviderRunResult result = GetImageProviderRegistry().Run(request, &image);
+
+    char debugMsg[256];
+    sprintf_s(debugMsg, "ImageProviders: %u attempt(s), provider %d, returned 0x%08x\n",
+              result.attempts, result.provider, static_cast<unsigned>(result.status));
+    OutputDebugStringA(debugMsg);
+
+    SaveStatsIfDue();
+
+    if (result.provider < 0)
+    {
+        if (image.bitmap)
+            DeleteObject(image.bitmap);
+        return result.attempts == 0 ? WTS_E_FAILEDEXTRACTION : static_cast<HRESULT>(result.status);
+    }
+    if (!image.bitmap)
+        return E_FAIL;
+
+    *phbmp = image.bitmap;
+    if (pdwAlpha)
+        *pdwAlpha = image.alpha;
+    return static_cast<HRESULT>(result.status);
+}
+
+HRESULT SetImageProviderEnabledImpl(LPCWSTR providerName, BOOL enabled)
+{
+    if (!providerName)
+        return E_INVALIDARG;
+
+    ProviderSelector& selector = GetImageProviderRegistry().Selector();
+    size_t id = 0;
+    if (!selector.Find(WideToUtf8(providerName), &id))
+        return HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+
+    selector.SetEnabled(id, enabled != FALSE);
+    return S_OK;
+}
+
+HRESULT GetImageProviderStatsImpl(LPCWSTR extension, WSP_PROVIDER_STATS* pStats, UINT capacity, UINT* pCount)
+{
+    if (!pCount || (capacity > 0 && !pStats))
+        return E_INVALIDARG;
+
+    std::string fileType;
+    if (extension)
+    {
+        // "jpg", ".JPG" and "photo.jpg" all name the same type
+        std::wstring name(extension);
+        fileType = FileTypeFromPath(name.find(L'.') == std::wstring::npos ? L"." + name : name);
+    }
+
+    const ProviderSelector& selector = GetImageProviderRegistry().Selector();
+    UINT count = static_cast<UINT>(selector.Count());
+    *pCount = count;
+    if (capacity < count)
+        return HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+
+    for (UINT id = 0; id < count; ++id)
+    {
+        ProviderDescriptor descriptor = selector.Descriptor(id);
+        ProviderStats stats = selector.Stats(id, fileType);
+
+        WSP_PROVIDER_STATS& out = pStats[id];
+        ZeroMemory(&out, sizeof(out));
+        wcsncpy_s(out.name, Utf8ToWide(descriptor.name).c_str(), _TRUNCATE);
+        out.capabilities = descriptor.capabilities;
+        out.enabled = selector.IsEnabled(id) ? TRUE : FALSE;
+        out.attempts = stats.attempts;
+        out.successes = stats.successes;
+        out.skipped = stats.skipped;
+        out.meanLatencyMs = stats.meanLatencyMs;
+        out.expectedCostMs = selector.ExpectedCost(id, fileType);
+    }
+    return S_OK;
+}
+
+HRESULT SetImageProviderStatsFileImpl(LPCWSTR statsPath)
+{
+    ProviderSelector& selector = GetImageProviderRegistry().Selector();
+    StatsFileState& state = GetStatsFileState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    // Keep what the previous file has not seen yet
+    if (!state.path.empty() && selector.UnsavedRecords() > 0)
+        selector.Save(std::filesystem::path(state.path));
+
+    state.path = statsPath ? statsPath : L"";
+    state.lastSaveTick = GetTickCount64();
+    if (state.path.empty())
+        return S_OK;
+
+    std::error_code ec;
+    if (!std::filesystem::exists(std::filesystem::path(state.path), ec))
+        return S_FALSE;     // Nothing learned yet; the file is created on the first save
+    return selector.Load(std::filesystem::path(state.path)) ? S_OK : HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "framework.h"
+#include "ImageProvider.h"
+#include "WinShellPreview.h"
+
+// Output of the Windows image providers: a bitmap owned by the caller
+struct ShellImage
+{
+    HBITMAP bitmap = nullptr;
+    WTS_ALPHATYPE alpha = WTSAT_UNKNOWN;
+};
+
+typedef IImageProvider<ShellImage> ShellImageProvider;
+
+// Process-wide registry, created with the built-in providers on first use:
+//   ThumbnailCacheLookup   IThumbnailCache, WTS_INCACHEONLY
+//   ThumbnailCache         IThumbnailCache, WTS_EXTRACT
+//   ShellItemImageFactory  IShellItemImageFactory::GetImage (icon fallback)
+//   ExtractImage           IExtractImage (rectangular)
+//   ThumbnailProvider      The file type's IThumbnailProvider, bound directly
+//   WicDecoder             Windows Imaging Component decode for common image formats
+ProviderRegistry<ShellImage>& GetImageProviderRegistry();
+
+// Request for pszFilePath; providers that need an STA are excluded on other threads
+ImageRequest MakeImageRequest(LPCWSTR pszFilePath, UINT cx, UINT cy);
+
+// Runs the request through the registry. Fails with the last provider's HRESULT, or
+// WTS_E_FAILEDEXTRACTION if no provider applies.
+HRESULT RunImageProviders(const ImageRequest& request, HBITMAP* phbmp, WTS_ALPHATYPE* pdwAlpha);
+
+// Exported controls. extension may be NULL (all file types) and may include the leading dot.
+HRESULT SetImageProviderEnabledImpl(LPCWSTR providerName, BOOL enabled);
+HRESULT GetImageProviderStatsImpl(LPCWSTR extension, WSP_PROVIDER_STATS* pStats, UINT capacity, UINT* pCount);
+
+// Statistics persistence: loaded once, then saved by RunImageProviders every SAVE_RECORDS
+// outcomes or SAVE_INTERVAL_MS, whichever comes first
+HRESULT SetImageProviderStatsFileImpl(LPCWSTR statsPath);
@@ -0,0 +1,185 @@
+#include "pch.h"
+#include "SignatureImpl.h"
+#include "BitmapUtils.h"
+#include "CoalescingImpl.h"
+#include "ObjectCache.h"
+#include "ProgressiveImpl.h"
+#include "ThumbnailImpl.h"
+#include <mutex>
+
+namespace
+{
+    const size_t SIGNATURE_CACHE_CAPACITY = 16384;
+
+    // Signatures are small, so they outlive the mips they were computed alongside
+    class SignatureCache
+    {
+    public:
+        SignatureCache() : m_cache(SIGNATURE_CACHE_CAPACITY) {}
+
+        bool Find(const std::string& key, ImageSignature* pSignature)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ImageSignature* found = m_cache.Find(key);
+            if (!found)
+                return false;
+            *pSignature = *found;
+            return true;
+        }
+
+        void Insert(const std::string& key, const ImageSignature& signature)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cache.Insert(key, signature);
+        }
+
+        void ErasePrefix(const std::string& prefix)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cache.EraseIf([&prefix](const std::string& key)
+            {
+                return key.compare(0, prefix.size(), prefix) == 0;
+            });
+        }
+
+        void Clear()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cache.Clear();
+        }
+
+        std::vector<std::pair<std::string, ImageSignature>> Entries()
+        {
+            std::vector<std::pair<std::string, ImageSignature>> entries;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            entries.reserve(m_cache.Size());
+            m_cache.ForEach([&entries](const std::string& key, const ImageSignature& signature)
+            {
+                entries.emplace_back(key, signature);
+            });
+            return entries;
+        }
+
+        ObjectCacheStats Stats()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_cache.Stats();
+        }
+
+    private:
+        std::mutex m_mutex;
+        LruCache<std::string, ImageSignature> m_cache;
+    };
+
+    SignatureCache& Signatures()
+    {
+        static SignatureCache* cache = new SignatureCache();
+        return *cache;
+    }
+
+    void ToWspSignature(const ImageSignature& signature, WSP_IMAGE_SIGNATURE* pSignature)
+    {
+        ZeroMemory(pSignature, sizeof(*pSignature));
+        pSignature->perceptualHash = signature.perceptualHash;
+        pSignature->differenceHash = signature.differenceHash;
+        pSignature->averageColor = RGB(signature.averageR, signature.averageG, signature.averageB);
+        pSignature->paletteCount = signature.paletteCount;
+        for (UINT i = 0; i < signature.paletteCount && i < WSP_MAX_PALETTE; ++i)
+        {
+            const PaletteColor& color = signature.palette[i];
+            pSignature->palette[i] = RGB(color.r, color.g, color.b);
+            pSignature->paletteShare[i] = color.share;
+        }
+    }
+}
+
+void StoreImageSignature(const std::string& identity, const ImageSignature& signature)
+{
+    Signatures().Insert(identity, signature);
+}
+
+void InvalidateImageSignatures(const std::string& pathKey, bool includeChildren)
+{
+    Signatures().ErasePrefix(pathKey + "|");
+    if (includeChildren)
+        Signatures().ErasePrefix(pathKey + "\\");
+}
+
+void ClearImageSignatures()
+{
+    Signatures().Clear();
+}
+
+std::vector<std::pair<std::string, ImageSignature>> ImageSignatureEntries()
+{
+    return Signatures().Entries();
+}
+
+ObjectCacheStats ImageSignatureCacheStats()
+{
+    return Signatures().Stats();
+}
+
+HRESULT GetFileThumbnailWithSignatureImpl(LPCWSTR filePath, UINT size, HBITMAP* phBitmap, WSP_IMAGE_SIGNATURE* pSignature)
+{
+    if (!filePath || !phBitmap || !pSignature || size == 0)
+        return E_INVALIDARG;
+
+    *phBitmap = nullptr;
+
+    HBITMAP hBitmap = nullptr;
+    HRESULT hr = GetFileThumbnailImpl(filePath, size, &hBitmap);
+    if (FAILED(hr))
+        return hr;
+
+    // One readback of the cropped pixels feeds the hashes, the palette and the placeholder mip
+    PixelImage image;
+    hr = HBITMAPToPixelImage(hBitmap, &image);
+    ImageSignature signature;
+    if (SUCCEEDED(hr) && !ComputeImageSignature(image, &signature))
+        hr = E_OUTOFMEMORY;
+    if (FAILED(hr))
+    {
+        DeleteObject(hBitmap);
+        return hr;
+    }
+
+    std::string identity = MakeFileIdentityKey(filePath);
+    StoreImageSignature(identity, signature);
+    StoreThumbnailMip(identity, image);
+
+    ToWspSignature(signature, pSignature);
+    *phBitmap = hBitmap;
+    return S_OK;
+}
+
+HRESULT GetBitmapSignatureImpl(HBITMAP hBitmap, WSP_IMAGE_SIGNATURE* pSignature)
+{
+    if (!hBitmap || !pSignature)
+        return E_INVALIDARG;
+
+    PixelImage image;
+    HRESULT hr = HBITMAPToPixelImage(hBitmap, &image);
+    if (FAILED(hr))
+        return hr;
+
+    ImageSignature signature;
+    if (!ComputeImageSignature(image, &signature))
+        return E_OUTOFMEMORY;
+
+    ToWspSignature(signature, pSignature);
+    return S_OK;
+}
+
+HRESULT GetCachedFileSignatureImpl(LPCWSTR filePath, WSP_IMAGE_SIGNATURE* pSignature)
+{
+    if (!filePath || !pSignature)
+        return E_INVALIDARG;
+
+    ImageSignature signature;
+    if (!Signatures().Find(MakeFileIdentityKey(filePath), &signature))
+        return HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+
+    ToWspSignature(signature, pSignature);
+    return S_OK;
+}
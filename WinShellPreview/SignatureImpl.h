@@ -0,0 +1,26 @@
+#pragma once
+#include "framework.h"
+#include "ImageSignature.h"
+#include "ObjectCache.h"
+#include "WinShellPreview.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+// Thumbnail plus its perceptual hashes and palette, computed from the same pixels
+HRESULT GetFileThumbnailWithSignatureImpl(LPCWSTR filePath, UINT size, HBITMAP* phBitmap, WSP_IMAGE_SIGNATURE* pSignature);
+
+// Signatures of an arbitrary bitmap, e.g. one about to be passed to SaveBitmapToFile
+HRESULT GetBitmapSignatureImpl(HBITMAP hBitmap, WSP_IMAGE_SIGNATURE* pSignature);
+
+// Signature stored by an earlier thumbnail pass for the file's current content
+HRESULT GetCachedFileSignatureImpl(LPCWSTR filePath, WSP_IMAGE_SIGNATURE* pSignature);
+
+// Cache metadata keyed by MakeFileIdentityKey
+void StoreImageSignature(const std::string& identity, const ImageSignature& signature);
+void InvalidateImageSignatures(const std::string& pathKey, bool includeChildren);
+void ClearImageSignatures();
+
+// Cached signatures, most recently used first (for the warm-start snapshot)
+std::vector<std::pair<std::string, ImageSignature>> ImageSignatureEntries();
+ObjectCacheStats ImageSignatureCacheStats();
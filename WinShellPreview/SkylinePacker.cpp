@@ -0,0 +1,121 @@
+#include "SkylinePacker.h"
+#include <algorithm>
+
+SkylinePacker::SkylinePacker(uint32_t width, uint32_t height)
+    : m_width(width), m_height(height), m_usedArea(0)
+{
+    m_skyline.push_back(Segment{ 0, 0, width });
+}
+
+bool SkylinePacker::FitAt(size_t index, uint32_t width, uint32_t height, uint32_t* y) const
+{
+    uint32_t x = m_skyline[index].x;
+    if (x + width > m_width)
+        return false;
+
+    // The rectangle rests on the highest segment it spans
+    uint32_t top = 0;
+    uint32_t remaining = width;
+    for (size_t i = index; remaining > 0; ++i)
+    {
+        if (i >= m_skyline.size())
+            return false;
+        top = (std::max)(top, m_skyline[i].y);
+        if (top + height > m_height)
+            return false;
+        remaining -= (std::min)(remaining, m_skyline[i].width);
+    }
+    *y = top;
+    return true;
+}
+
+bool SkylinePacker::Insert(uint32_t width, uint32_t height, AtlasRect* rect)
+{
+    if (width == 0 || height == 0 || width > m_width || height > m_height)
+        return false;
+
+    size_t bestIndex = m_skyline.size();
+    uint32_t bestBottom = UINT32_MAX;
+    uint32_t bestWidth = UINT32_MAX;
+    uint32_t bestY = 0;
+
+    for (size_t i = 0; i < m_skyline.size(); ++i)
+    {
+        uint32_t y;
+        if (!FitAt(i, width, height, &y))
+            continue;
+
+        // Lowest bottom edge first, then the narrowest supporting segment to limit waste
+        uint32_t bottom = y + height;
+        if (bottom < bestBottom || (bottom == bestBottom && m_skyline[i].width < bestWidth))
+        {
+            bestIndex = i;
+            bestBottom = bottom;
+            bestWidth = m_skyline[i].width;
+            bestY = y;
+        }
+    }
+
+    if (bestIndex == m_skyline.size())
+        return false;
+
+    rect->x = m_skyline[bestIndex].x;
+    rect->y = bestY;
+    rect->width = width;
+    rect->height = height;
+    Place(bestIndex, *rect);
+    m_usedArea += static_cast<uint64_t>(width) * height;
+    return true;
+}
+
+void SkylinePacker::Place(size_t index, const AtlasRect& rect)
+{
+    Segment placed = { rect.x, rect.y + rect.height, rect.width };
+    m_skyline.insert(m_skyline.begin() + index, placed);
+
+    // Trim or drop the segments now covered by the new one
+    uint32_t right = placed.x + placed.width;
+    size_t i = index + 1;
+    while (i < m_skyline.size() && m_skyline[i].x < right)
+    {
+        uint32_t segmentRight = m_skyline[i].x + m_skyline[i].width;
+        if (segmentRight <= right)
+        {
+            m_skyline.erase(m_skyline.begin() + i);
+            continue;
+        }
+        m_skyline[i].width = segmentRight - right;
+        m_skyline[i].x = right;
+        break;
+    }
+
+    // Merge neighbours at the same height
+    for (size_t j = 0; j + 1 < m_skyline.size();)
+    {
+        if (m_skyline[j].y == m_skyline[j + 1].y)
+        {
+            m_skyline[j].width += m_skyline[j + 1].width;
+            m_skyline.erase(m_skyline.begin() + j + 1);
+        }
+        else
+        {
+            ++j;
+        }
+    }
+}
+
+uint32_t SkylinePacker::UsedHeight() const
+{
+    uint32_t used = 0;
+    for (const Segment& segment : m_skyline)
+        used = (std::max)(used, segment.y);
+    return used;
+}
+
+double SkylinePacker::Occupancy() const
+{
+    uint32_t used = UsedHeight();
+    if (used == 0)
+        return 0.0;
+    return static_cast<double>(m_usedArea) / (static_cast<double>(m_width) * used);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct AtlasRect
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+};
+
+// Skyline bottom-left rectangle packer: keeps the top edge of the packed area as a list of
+// horizontal segments and places each rectangle where its top ends lowest. Rectangles can be
+// added incrementally. No Windows dependencies.
+class SkylinePacker
+{
+public:
+    SkylinePacker(uint32_t width, uint32_t height);
+
+    // Returns false if the rectangle does not fit anywhere
+    bool Insert(uint32_t width, uint32_t height, AtlasRect* rect);
+
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+    uint32_t UsedHeight() const;        // Bottom of the lowest-reaching rectangle
+    double Occupancy() const;           // Packed area / (width * UsedHeight)
+
+private:
+    struct Segment
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+    };
+
+    // Top of a width-wide rectangle whose left edge is at segment `index`, or false if it overflows
+    bool FitAt(size_t index, uint32_t width, uint32_t height, uint32_t* y) const;
+    void Place(size_t index, const AtlasRect& rect);
+
+    uint32_t m_width;
+    uint32_t m_height;
+    uint64_t m_usedArea;
+    std::vector<Segment> m_skyline;
+};
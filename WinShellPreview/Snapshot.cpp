@@ -0,0 +1,195 @@
+#include "pch.h"
+#include "SnapshotImpl.h"
+#include "HandlersImpl.h"
+#include "ProgressiveImpl.h"
+#include "ShellProviders.h"
+#include "SignatureImpl.h"
+#include "WarmSnapshot.h"
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    // Snapshots are only needed for the next start; saving more often than this buys nothing
+    const DWORD SAVE_INTERVAL_MS = 5 * 60 * 1000;
+
+    struct WarmStartState
+    {
+        std::mutex mutex;           // Held while saving or restoring
+        std::wstring path;
+        uint64_t savedChangeCount = 0;
+        bool saverStarted = false;
+        WSP_WARM_START_STATS stats = {};
+    };
+
+    // Leaked on purpose: the saver thread uses it until the process exits
+    WarmStartState& GetWarmStartState()
+    {
+        static WarmStartState* state = new WarmStartState();
+        return *state;
+    }
+
+    ULONGLONG MicrosecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return static_cast<ULONGLONG>(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    // Grows whenever something a snapshot would hold is learned
+    uint64_t ChangeCount()
+    {
+        WSP_HANDLER_CACHE_STATS handlers = {};
+        GetPreviewHandlerCacheStatsImpl(&handlers);
+        uint64_t count = ThumbnailMipCache().Stats().insertions + ExtensionIconCache().Stats().insertions +
+                         ImageSignatureCacheStats().insertions + handlers.resolved;
+
+        const ProviderSelector& selector = GetImageProviderRegistry().Selector();
+        for (size_t id = 0; id < selector.Count(); ++id)
+            count += selector.Stats(id, "").attempts;
+        return count;
+    }
+
+    // Caller holds state.mutex
+    HRESULT SaveLocked(WarmStartState& state)
+    {
+        if (state.path.empty())
+            return S_FALSE;
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t changeCount = ChangeCount();
+
+        SnapshotWriter writer;
+        writer.AddHandlers(PreviewHandlerEntries());
+        writer.AddImages(SnapshotSection::Icons, ExtensionIconCache().Entries());
+        writer.AddImages(SnapshotSection::Mips, ThumbnailMipCache().Entries());
+        writer.AddSignatures(ImageSignatureEntries());
+        writer.AddText(SnapshotSection::ProviderStats, GetImageProviderRegistry().Selector().Serialize());
+
+        uint64_t bytes = 0;
+        if (!writer.Save(std::filesystem::path(state.path), &bytes))
+        {
+            state.stats.saveFailures++;
+            return E_FAIL;
+        }
+
+        state.savedChangeCount = changeCount;
+        state.stats.saves++;
+        state.stats.lastSaveUs = MicrosecondsSince(start);
+        state.stats.lastSaveBytes = bytes;
+        return S_OK;
+    }
+
+    // Entries come most recently used first; inserting them in reverse keeps that order
+    void RestoreImages(const SnapshotReader& reader, SnapshotSection section, SharedImageCache& cache, ULONGLONG* restored)
+    {
+        SnapshotImages images;
+        if (!reader.ReadImages(section, &images))
+            return;
+        for (auto it = images.rbegin(); it != images.rend(); ++it)
+            cache.Insert(it->first, std::move(it->second));
+        *restored = images.size();
+    }
+
+    // Caller holds state.mutex
+    HRESULT RestoreLocked(WarmStartState& state)
+    {
+        auto start = std::chrono::steady_clock::now();
+        SnapshotReader reader;
+        if (!reader.Open(std::filesystem::path(state.path)))
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+        WSP_WARM_START_STATS& stats = state.stats;
+        stats.restoredHandlers = stats.restoredIcons = stats.restoredMips = stats.restoredSignatures = 0;
+        stats.providerStatsRestored = FALSE;
+
+        // A damaged section is skipped; the others are still good
+        std::vector<HandlerMapEntry> handlers;
+        if (reader.ReadHandlers(&handlers))
+            stats.restoredHandlers = RestorePreviewHandlers(handlers);
+
+        RestoreImages(reader, SnapshotSection::Icons, ExtensionIconCache(), &stats.restoredIcons);
+        RestoreImages(reader, SnapshotSection::Mips, ThumbnailMipCache(), &stats.restoredMips);
+
+        SnapshotSignatures signatures;
+        if (reader.ReadSignatures(&signatures))
+        {
+            for (auto it = signatures.rbegin(); it != signatures.rend(); ++it)
+                StoreImageSignature(it->first, it->second);
+            stats.restoredSignatures = signatures.size();
+        }
+
+        std::string providerStats;
+        if (reader.ReadText(SnapshotSection::ProviderStats, &providerStats))
+            stats.providerStatsRestored = GetImageProviderRegistry().Selector().Deserialize(providerStats) ? TRUE : FALSE;
+
+        stats.restoredBytes = reader.Size();
+        reader.Close();     // The next save replaces the file
+        stats.restoreUs = MicrosecondsSince(start);
+        return S_OK;
+    }
+
+    void SaveWhenChanged()
+    {
+        WarmStartState& state = GetWarmStartState();
+        for (;;)
+        {
+            Sleep(SAVE_INTERVAL_MS);
+
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (!state.path.empty() && ChangeCount() != state.savedChangeCount)
+                SaveLocked(state);
+        }
+    }
+}
+
+HRESULT SetWarmStartFileImpl(LPCWSTR snapshotPath)
+{
+    WarmStartState& state = GetWarmStartState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    std::wstring path = snapshotPath ? snapshotPath : L"";
+    if (path == state.path)
+        return S_OK;
+
+    // Keep what the previous file has not seen yet
+    if (!state.path.empty() && ChangeCount() != state.savedChangeCount)
+        SaveLocked(state);
+
+    state.path = path;
+    if (state.path.empty())
+        return S_OK;
+
+    if (!state.saverStarted)
+    {
+        std::thread(SaveWhenChanged).detach();
+        state.saverStarted = true;
+    }
+
+    HRESULT hr = S_FALSE;   // Nothing learned yet; the file is created on the first save
+    std::error_code ec;
+    if (std::filesystem::exists(std::filesystem::path(state.path), ec))
+        hr = RestoreLocked(state);
+
+    // Restored entries are already in the file
+    state.savedChangeCount = ChangeCount();
+    return hr;
+}
+
+HRESULT SaveWarmStartSnapshotImpl()
+{
+    WarmStartState& state = GetWarmStartState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return SaveLocked(state);
+}
+
+HRESULT GetWarmStartStatsImpl(WSP_WARM_START_STATS* pStats)
+{
+    if (!pStats)
+        return E_INVALIDARG;
+
+    WarmStartState& state = GetWarmStartState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    *pStats = state.stats;
+    return S_OK;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "framework.h"
+#include "WinShellPreview.h"
+
+// Warm start: the extension -> preview handler map, the placeholder caches (icons and small
+// copies of thumbnails), the image signatures and the provider statistics are saved to one
+// snapshot file (see WarmSnapshot.h) and restored by the next process.
+//
+// SetWarmStartFileImpl restores the file at once and then saves to it every SAVE_INTERVAL_MS
+// if anything changed. Cached entries are keyed by file identity, so entries for files that
+// changed in between are never matched, and restored handlers are checked against the registry
+// in the background. Returns S_FALSE when the file does not exist yet and
+// HRESULT_FROM_WIN32(ERROR_INVALID_DATA) when it is damaged; it is replaced on the next save.
+HRESULT SetWarmStartFileImpl(LPCWSTR snapshotPath);
+
+// Saves now, e.g. before the process exits. S_FALSE if no file is set.
+HRESULT SaveWarmStartSnapshotImpl();
+
+HRESULT GetWarmStartStatsImpl(WSP_WARM_START_STATS* pStats);
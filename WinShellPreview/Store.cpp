@@ -0,0 +1,157 @@
+#include "pch.h"
+#include "StoreImpl.h"
+#include "BitmapUtils.h"
+#include "CoalescingImpl.h"
+#include "ContentStore.h"
+#include "IconImpl.h"
+#include "ThumbnailImpl.h"
+#include <memory>
+#include <mutex>
+
+namespace
+{
+    std::mutex g_storeLock;
+    std::shared_ptr<ContentStore> g_store;
+
+    std::shared_ptr<ContentStore> CurrentStore()
+    {
+        std::lock_guard<std::mutex> lock(g_storeLock);
+        return g_store;
+    }
+
+    // "<path>|<kind><size>" groups every version of one image; the identity suffix
+    // ("|size|time") makes a rewritten file miss instead of returning the old image
+    std::string MakeImagePrefix(const std::string& pathKey, UINT size, WSP_STORE_SOURCE source)
+    {
+        return pathKey + (source == WSP_STORE_ICON ? "|I" : "|T") + std::to_string(size) + "|";
+    }
+
+    HRESULT CopyObjectPath(const ContentStore& store, uint64_t hash, LPWSTR objectPath, UINT objectPathLength)
+    {
+        if (!objectPath)
+            return S_OK;
+
+        std::wstring path = store.ObjectPath(hash).wstring();
+        if (path.size() + 1 > objectPathLength)
+            return HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+        wcscpy_s(objectPath, objectPathLength, path.c_str());
+        return S_OK;
+    }
+}
+
+HRESULT OpenThumbnailStoreImpl(LPCWSTR directory)
+{
+    if (!directory)
+        return E_INVALIDARG;
+
+    std::shared_ptr<ContentStore> store = std::make_shared<ContentStore>(std::filesystem::path(directory));
+    if (!store->Open())
+        return E_FAIL;
+
+    std::lock_guard<std::mutex> lock(g_storeLock);
+    g_store = store;
+    return S_OK;
+}
+
+void CloseThumbnailStoreImpl()
+{
+    // Requests still running keep their own reference until they finish
+    std::lock_guard<std::mutex> lock(g_storeLock);
+    g_store.reset();
+}
+
+HRESULT StoreFileImageImpl(LPCWSTR filePath, UINT size, WSP_STORE_SOURCE source, LPWSTR objectPath, UINT objectPathLength)
+{
+    if (!filePath || size == 0 || (objectPath && objectPathLength == 0))
+        return E_INVALIDARG;
+    if (source != WSP_STORE_THUMBNAIL && source != WSP_STORE_ICON)
+        return E_INVALIDARG;
+
+    std::shared_ptr<ContentStore> store = CurrentStore();
+    if (!store)
+        return HRESULT_FROM_WIN32(ERROR_NOT_READY);
+
+    std::string pathKey = MakePathKey(filePath);
+    std::string identity = MakeFileIdentityKey(filePath);
+    std::string prefix = MakeImagePrefix(pathKey, size, source);
+    std::string ref = prefix + identity.substr((std::min)(identity.size(), pathKey.size() + 1));
+
+    // Unchanged file: no extraction, no encode
+    uint64_t hash = 0;
+    if (store->Find(ref, &hash))
+        return CopyObjectPath(*store, hash, objectPath, objectPathLength);
+
+    HBITMAP hBitmap = nullptr;
+    HRESULT hr = (source == WSP_STORE_ICON) ? GetFileIconImpl(filePath, size, &hBitmap)
+                                            : GetFileThumbnailImpl(filePath, size, &hBitmap);
+    if (FAILED(hr))
+        return hr;
+    if (!hBitmap)
+        return E_FAIL;
+
+    PixelImage image;
+    hr = HBITMAPToPixelImage(hBitmap, &image);
+    DeleteObject(hBitmap);
+    if (FAILED(hr))
+        return hr;
+
+    // Earlier versions of this file's image no longer apply
+    store->RemovePrefix(prefix);
+
+    // An identical image stored for another file (a copy, a shared type icon) skips the encode
+    bool reused = false;
+    if (!store->Put(ref, image, &hash, &reused))
+        return E_FAIL;
+
+    hr = CopyObjectPath(*store, hash, objectPath, objectPathLength);
+    if (SUCCEEDED(hr) && reused)
+        hr = S_FALSE;
+    return hr;
+}
+
+HRESULT CollectThumbnailStoreGarbageImpl(ULONGLONG* pBytesFreed)
+{
+    std::shared_ptr<ContentStore> store = CurrentStore();
+    if (!store)
+        return HRESULT_FROM_WIN32(ERROR_NOT_READY);
+
+    ULONGLONG freed = store->CollectGarbage();
+    if (pBytesFreed)
+        *pBytesFreed = freed;
+    return S_OK;
+}
+
+HRESULT GetThumbnailStoreStatsImpl(WSP_STORE_STATS* pStats)
+{
+    if (!pStats)
+        return E_INVALIDARG;
+
+    ZeroMemory(pStats, sizeof(*pStats));
+    std::shared_ptr<ContentStore> store = CurrentStore();
+    if (!store)
+        return HRESULT_FROM_WIN32(ERROR_NOT_READY);
+
+    ContentStoreStats stats = store->Stats();
+    pStats->refs = stats.refs;
+    pStats->objects = stats.objects;
+    pStats->storedBytes = stats.storedBytes;
+    pStats->logicalBytes = stats.logicalBytes;
+    pStats->encodesSkipped = stats.encodesSkipped;
+    pStats->garbageObjects = stats.garbageObjects;
+    return S_OK;
+}
+
+void ReleaseStoredImages(LPCWSTR path, bool includeChildren)
+{
+    if (!path)
+        return;
+
+    std::shared_ptr<ContentStore> store = CurrentStore();
+    if (!store)
+        return;
+
+    std::string key = MakePathKey(path);
+    store->RemovePrefix(key + "|");
+    if (includeChildren)
+        store->RemovePrefix(key + "\\");
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "framework.h"
+#include "WinShellPreview.h"
+
+// Process-wide content-addressed thumbnail store (see ContentStore)
+HRESULT OpenThumbnailStoreImpl(LPCWSTR directory);
+void CloseThumbnailStoreImpl();
+
+// Returns the object file holding the file's image, extracting and storing it on a miss
+HRESULT StoreFileImageImpl(LPCWSTR filePath, UINT size, WSP_STORE_SOURCE source, LPWSTR objectPath, UINT objectPathLength);
+
+HRESULT CollectThumbnailStoreGarbageImpl(ULONGLONG* pBytesFreed);
+HRESULT GetThumbnailStoreStatsImpl(WSP_STORE_STATS* pStats);
+
+// Drops references for a changed file, or for everything below a directory
+void ReleaseStoredImages(LPCWSTR path, bool includeChildren);
@@ -0,0 +1,221 @@
+#include "TextCodec.h"
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTCODEC_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const char16_t REPLACEMENT = 0xfffd;
+
+    inline int CountTrailingZeros(unsigned mask)
+    {
+        int n = 0;
+        while (!(mask & 1))
+        {
+            mask >>= 1;
+            ++n;
+        }
+        return n;
+    }
+
+    // Copies the ASCII prefix of [in, end) and returns how many bytes it covered
+    inline size_t WidenAscii(const uint8_t* in, const uint8_t* end, char16_t* out)
+    {
+        const uint8_t* start = in;
+#ifdef TEXTCODEC_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        while (end - in >= 16)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(bytes));
+            if (mask)
+            {
+                int ascii = CountTrailingZeros(mask);
+                for (int i = 0; i < ascii; ++i)
+                    *out++ = in[i];
+                return static_cast<size_t>(in - start) + ascii;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(bytes, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_unpackhi_epi8(bytes, zero));
+            in += 16;
+            out += 16;
+        }
+#endif
+        while (in < end && *in < 0x80)
+            *out++ = *in++;
+        return static_cast<size_t>(in - start);
+    }
+
+    inline size_t NarrowAscii(const char16_t* in, const char16_t* end, uint8_t* out)
+    {
+        const char16_t* start = in;
+#ifdef TEXTCODEC_SSE2
+        const __m128i highBits = _mm_set1_epi16(static_cast<short>(0xff80));
+        const __m128i zero = _mm_setzero_si128();
+        while (end - in >= 8)
+        {
+            __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+            unsigned ascii = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(units, highBits), zero)));
+            if (ascii != 0xffff)
+                break;
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(units, units));
+            in += 8;
+            out += 8;
+        }
+#endif
+        while (in < end && *in < 0x80)
+            *out++ = static_cast<uint8_t>(*in++);
+        return static_cast<size_t>(in - start);
+    }
+
+    // Decodes one multi-byte sequence at in[0] (not ASCII). Returns the bytes consumed and
+    // the code point, or 1 and U+FFFD when the sequence is invalid.
+    inline size_t DecodeSequence(const uint8_t* in, const uint8_t* end, uint32_t* cp)
+    {
+        uint8_t lead = in[0];
+        size_t length;
+        uint32_t min;
+        if (lead >= 0xc2 && lead <= 0xdf)
+        {
+            length = 2;
+            min = 0x80;
+            *cp = lead & 0x1f;
+        }
+        else if (lead >= 0xe0 && lead <= 0xef)
+        {
+            length = 3;
+            min = 0x800;
+            *cp = lead & 0x0f;
+        }
+        else if (lead >= 0xf0 && lead <= 0xf4)
+        {
+            length = 4;
+            min = 0x10000;
+            *cp = lead & 0x07;
+        }
+        else
+        {
+            *cp = REPLACEMENT;
+            return 1;
+        }
+
+        if (static_cast<size_t>(end - in) < length)
+        {
+            *cp = REPLACEMENT;
+            return 1;
+        }
+        for (size_t i = 1; i < length; ++i)
+        {
+            if ((in[i] & 0xc0) != 0x80)
+            {
+                *cp = REPLACEMENT;
+                return 1;
+            }
+            *cp = (*cp << 6) | (in[i] & 0x3f);
+        }
+        if (*cp < min || *cp > 0x10ffff || (*cp >= 0xd800 && *cp <= 0xdfff))
+        {
+            *cp = REPLACEMENT;
+            return 1;
+        }
+        return length;
+    }
+}
+
+bool Utf8ToUtf16(const char* text, size_t length, std::u16string* out)
+{
+    // Never more UTF-16 units than UTF-8 bytes
+    out->resize(length);
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(text);
+    const uint8_t* end = in + length;
+    char16_t* start = length ? &(*out)[0] : nullptr;
+    char16_t* dst = start;
+    bool valid = true;
+
+    while (in < end)
+    {
+        size_t ascii = WidenAscii(in, end, dst);
+        in += ascii;
+        dst += ascii;
+        if (in == end)
+            break;
+
+        uint32_t cp;
+        size_t used = DecodeSequence(in, end, &cp);
+        if (used == 1)
+            valid = false;
+        in += used;
+        if (cp >= 0x10000)
+        {
+            cp -= 0x10000;
+            *dst++ = static_cast<char16_t>(0xd800 + (cp >> 10));
+            *dst++ = static_cast<char16_t>(0xdc00 + (cp & 0x3ff));
+        }
+        else
+        {
+            *dst++ = static_cast<char16_t>(cp);
+        }
+    }
+
+    out->resize(static_cast<size_t>(dst - start));
+    return valid;
+}
+
+bool Utf16ToUtf8(const char16_t* text, size_t length, std::string* out)
+{
+    // At most 3 bytes per UTF-16 unit (a surrogate pair is 2 units -> 4 bytes)
+    out->resize(length * 3);
+    const char16_t* in = text;
+    const char16_t* end = text + length;
+    uint8_t* start = length ? reinterpret_cast<uint8_t*>(&(*out)[0]) : nullptr;
+    uint8_t* dst = start;
+    bool valid = true;
+
+    while (in < end)
+    {
+        size_t ascii = NarrowAscii(in, end, dst);
+        in += ascii;
+        dst += ascii;
+        if (in == end)
+            break;
+
+        uint32_t cp = *in++;
+        if (cp >= 0xd800 && cp <= 0xdfff)
+        {
+            if (cp <= 0xdbff && in < end && *in >= 0xdc00 && *in <= 0xdfff)
+            {
+                cp = 0x10000 + ((cp - 0xd800) << 10) + (*in++ - 0xdc00);
+            }
+            else
+            {
+                cp = REPLACEMENT;
+                valid = false;
+            }
+        }
+
+        if (cp < 0x800)
+        {
+            *dst++ = static_cast<uint8_t>(0xc0 | (cp >> 6));
+            *dst++ = static_cast<uint8_t>(0x80 | (cp & 0x3f));
+        }
+        else if (cp < 0x10000)
+        {
+            *dst++ = static_cast<uint8_t>(0xe0 | (cp >> 12));
+            *dst++ = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3f));
+            *dst++ = static_cast<uint8_t>(0x80 | (cp & 0x3f));
+        }
+        else
+        {
+            *dst++ = static_cast<uint8_t>(0xf0 | (cp >> 18));
+            *dst++ = static_cast<uint8_t>(0x80 | ((cp >> 12) & 0x3f));
+            *dst++ = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3f));
+            *dst++ = static_cast<uint8_t>(0x80 | (cp & 0x3f));
+        }
+    }
+
+    out->resize(static_cast<size_t>(dst - start));
+    return valid;
+}
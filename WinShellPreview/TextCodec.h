@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// UTF-8 <-> UTF-16 transcoding. ASCII runs are converted 16 bytes at a time with SSE2 where
+// available; everything else goes through a strict decoder (no overlong forms, surrogates or
+// code points above U+10FFFF). Invalid input is replaced with U+FFFD, as the Win32 converters
+// do without MB_ERR_INVALID_CHARS, and reported through the return value.
+// No Windows dependencies (wchar_t on Windows is char16_t-compatible).
+
+// Replaces *out; false if the input contained invalid sequences
+bool Utf8ToUtf16(const char* text, size_t length, std::u16string* out);
+bool Utf16ToUtf8(const char16_t* text, size_t length, std::string* out);
+
+inline std::u16string Utf8ToUtf16(const std::string& text)
+{
+    std::u16string out;
+    Utf8ToUtf16(text.data(), text.size(), &out);
+    return out;
+}
+
+inline std::string Utf16ToUtf8(const std::u16string& text)
+{
+    std::string out;
+    Utf16ToUtf8(text.data(), text.size(), &out);
+    return out;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "framework.h"
+#include "TextCodec.h"
+
+static_assert(sizeof(wchar_t) == sizeof(char16_t), "wchar_t must be UTF-16");
+
+// UTF-16 <-> UTF-8 conversion for keys and portable modules
+inline std::string WideToUtf8(const std::wstring& text)
+{
+    std::string out;
+    Utf16ToUtf8(reinterpret_cast<const char16_t*>(text.data()), text.size(), &out);
+    return out;
+}
+
+inline std::wstring Utf8ToWide(const std::string& text)
+{
+    std::u16string out;
+    Utf8ToUtf16(text.data(), text.size(), &out);
+    return std::wstring(reinterpret_cast<const wchar_t*>(out.data()), out.size());
+}
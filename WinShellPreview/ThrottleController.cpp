@@ -0,0 +1,69 @@
+#include "ThrottleController.h"
+
+ThrottleController::ThrottleController(const ThrottleConfig& config)
+    : m_config(config), m_foregroundActive(0), m_lastForegroundMs(0),
+      m_cpu(-1.0), m_io(-1.0), m_backoffMs(0), m_stats()
+{
+}
+
+void ThrottleController::ForegroundBegin(uint64_t nowMs)
+{
+    m_foregroundActive.fetch_add(1, std::memory_order_acq_rel);
+    m_lastForegroundMs.store(nowMs, std::memory_order_release);
+}
+
+void ThrottleController::ForegroundEnd(uint64_t nowMs)
+{
+    m_lastForegroundMs.store(nowMs, std::memory_order_release);
+    m_foregroundActive.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+double ThrottleController::Smooth(double previous, double sample) const
+{
+    if (sample < 0.0)
+        return previous;
+    if (previous < 0.0)
+        return sample;
+    return previous + (sample - previous) * m_config.smoothing;
+}
+
+uint32_t ThrottleController::NextDelayMs(const ThrottleSample& sample, uint64_t nowMs)
+{
+    m_stats.decisions++;
+    m_cpu = Smooth(m_cpu, sample.cpuLoad);
+    m_io = Smooth(m_io, sample.ioQueueDepth);
+
+    // Interactive requests always win: wait until they have been quiet for a while
+    uint64_t lastForeground = m_lastForegroundMs.load(std::memory_order_acquire);
+    bool foregroundBusy = m_foregroundActive.load(std::memory_order_acquire) > 0;
+    // lastForeground can be ahead of nowMs when another thread read the clock later
+    uint64_t quietUntil = lastForeground + m_config.foregroundQuietMs;
+    if (foregroundBusy || (lastForeground != 0 && nowMs < quietUntil))
+    {
+        uint64_t remaining = foregroundBusy ? m_config.foregroundQuietMs : quietUntil - nowMs;
+        uint32_t wait = static_cast<uint32_t>(remaining < m_config.foregroundQuietMs ? remaining : m_config.foregroundQuietMs);
+        m_stats.foregroundYields++;
+        m_stats.delayedMs += wait;
+        return wait;
+    }
+
+    bool overloaded = m_cpu > m_config.cpuHigh || m_io > m_config.ioHigh;
+    bool idle = (m_cpu < 0.0 || m_cpu < m_config.cpuLow) && (m_io < 0.0 || m_io < m_config.ioLow);
+
+    // Multiplicative backoff and decay; between the low and high marks the delay is held
+    if (overloaded)
+    {
+        uint32_t next = m_backoffMs == 0 ? m_config.minBackoffMs : m_backoffMs * 2;
+        m_backoffMs = next > m_config.maxBackoffMs ? m_config.maxBackoffMs : next;
+        m_stats.backoffs++;
+    }
+    else if (idle)
+    {
+        m_backoffMs /= 2;
+        if (m_backoffMs < m_config.minBackoffMs / 2)
+            m_backoffMs = 0;
+    }
+
+    m_stats.delayedMs += m_backoffMs;
+    return m_backoffMs;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Decides how long background work should wait before its next unit, based on system CPU load,
+// disk queue depth and foreground (interactive) request activity. Pure logic: the caller
+// supplies samples and the clock, so it can be driven by synthetic load. No Windows dependencies.
+
+struct ThrottleConfig
+{
+    double cpuHigh = 0.60;              // Back off above this smoothed system CPU load (0..1)
+    double cpuLow = 0.40;               // Speed up again below this
+    double ioHigh = 2.0;                // Back off above this smoothed disk queue depth
+    double ioLow = 1.0;
+    uint32_t foregroundQuietMs = 2000;  // Stay idle this long after the last interactive request
+    uint32_t minBackoffMs = 50;         // First delay when backing off
+    uint32_t maxBackoffMs = 5000;
+    double smoothing = 0.3;             // EWMA weight of the newest sample
+};
+
+struct ThrottleSample
+{
+    double cpuLoad;         // 0..1, negative if unknown
+    double ioQueueDepth;    // Outstanding disk requests, negative if unknown
+};
+
+struct ThrottleStats
+{
+    uint64_t decisions;
+    uint64_t foregroundYields;  // Decisions that waited for interactive requests
+    uint64_t backoffs;          // Decisions that increased the delay
+    uint64_t delayedMs;         // Total delay handed out
+};
+
+class ThrottleController
+{
+public:
+    explicit ThrottleController(const ThrottleConfig& config = ThrottleConfig());
+
+    // Interactive request bracket. Thread-safe; may be called from any thread.
+    void ForegroundBegin(uint64_t nowMs);
+    void ForegroundEnd(uint64_t nowMs);
+
+    // Milliseconds to wait before the next unit of background work (0 = run now).
+    // Call from the background thread only.
+    uint32_t NextDelayMs(const ThrottleSample& sample, uint64_t nowMs);
+
+    double SmoothedCpu() const { return m_cpu; }
+    double SmoothedIo() const { return m_io; }
+    ThrottleStats Stats() const { return m_stats; }
+
+private:
+    double Smooth(double previous, double sample) const;
+
+    ThrottleConfig m_config;
+    std::atomic<int> m_foregroundActive;
+    std::atomic<uint64_t> m_lastForegroundMs;
+    double m_cpu;
+    double m_io;
+    uint32_t m_backoffMs;
+    ThrottleStats m_stats;
+};
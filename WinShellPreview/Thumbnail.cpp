@@ -2,6 +2,10 @@
 #include "ThumbnailImpl.h"
 #include "BitmapUtils.h"
 #include "PreviewHandler.h"
+#include "ShellContext.h"
+#include "CoalescingImpl.h"
+#include "IsolationImpl.h"
+#include <atomic>
 #include <memory>
 #include <gdiplus.h>
 #include <algorithm>
@@ -13,13 +17,49 @@
 
 using namespace Gdiplus;
 
+// Background color in the low 24 bits, THUMBNAIL_BACKGROUND_NONE when transparency is kept.
+// White by default, as thumbnails have always been returned.
+static const uint32_t THUMBNAIL_BACKGROUND_NONE = 0xFFFFFFFFu;
+static std::atomic<uint32_t> g_thumbnailBackground{RGB(255, 255, 255)};
+
+HRESULT SetThumbnailBackgroundImpl(const COLORREF* pColor)
+{
+    g_thumbnailBackground.store(pColor ? (*pColor & 0x00FFFFFFu) : THUMBNAIL_BACKGROUND_NONE, std::memory_order_relaxed);
+    return S_OK;
+}
+
+bool GetThumbnailBackground(COLORREF* pColor)
+{
+    uint32_t value = g_thumbnailBackground.load(std::memory_order_relaxed);
+    if (value == THUMBNAIL_BACKGROUND_NONE)
+        return false;
+    *pColor = value;
+    return true;
+}
+
+// Flattens a finished thumbnail onto the configured background, if any
+static HRESULT ApplyThumbnailBackground(HBITMAP* phBitmap)
+{
+    COLORREF color;
+    if (!GetThumbnailBackground(&color))
+        return S_OK;
+
+    HRESULT hr = CompositeBitmapOverColor(phBitmap, color);
+    if (FAILED(hr))
+    {
+        DeleteObject(*phBitmap);
+        *phBitmap = nullptr;
+    }
+    return hr;
+}
+
 // Get original media dimensions from Shell property store
 HRESULT GetMediaDimensions(LPCWSTR filePath, UINT* width, UINT* height)
 {
     *width = *height = 0;
 
     IShellItem2* psi = nullptr;
-    HRESULT hr = SHCreateItemFromParsingName(filePath, nullptr, IID_IShellItem2, reinterpret_cast<void**>(&psi));
+    HRESULT hr = ShellContext::ForCurrentThread().CreateItem(filePath, IID_IShellItem2, reinterpret_cast<void**>(&psi));
     if (FAILED(hr))
         return hr;
 
@@ -61,36 +101,13 @@ HRESULT GetMediaDimensions(LPCWSTR filePath, UINT* width, UINT* height)
     return E_FAIL;
 }
 
-HRESULT GetFileThumbnailImpl(LPCWSTR filePath, UINT size, HBITMAP* phBitmap)
+// Crops the square raw thumbnail to the media's aspect ratio. Takes ownership of hRawBitmap.
+static HRESULT FinishThumbnail(LPCWSTR filePath, UINT size, HBITMAP hRawBitmap, WTS_ALPHATYPE alphaType, HBITMAP* phBitmap)
 {
-    if (!filePath || !phBitmap)
-        return E_INVALIDARG;
-
-    *phBitmap = nullptr;
-
-    PreviewHandler handler;
-    WTS_ALPHATYPE alphaType;
-    HBITMAP hRawBitmap = nullptr;
-    HRESULT hr = handler.GetThumbnail(filePath, size, &hRawBitmap, &alphaType);
-    
-    if (FAILED(hr) || !hRawBitmap)
-        return hr;
-    
-    // Get original size
-    BITMAP bmpInfo = {};
-    GetObject(hRawBitmap, sizeof(BITMAP), &bmpInfo);
+    HRESULT hr;
     char debugMsg[256];
-    sprintf_s(debugMsg, "Original bitmap size: %dx%d\n", bmpInfo.bmWidth, bmpInfo.bmHeight);
-    printf("%s", debugMsg);
-    
-    // Check alpha type
-    const char* alphaTypeStr = "UNKNOWN";
-    if (alphaType == WTSAT_ARGB) alphaTypeStr = "WTSAT_ARGB (transparent)";
-    else if (alphaType == WTSAT_RGB) alphaTypeStr = "WTSAT_RGB (opaque)";
-    else if (alphaType == WTSAT_UNKNOWN) alphaTypeStr = "WTSAT_UNKNOWN";
-    
-    sprintf_s(debugMsg, "WTS_ALPHATYPE: %s (%d)\n", alphaTypeStr, alphaType);
-    printf("%s", debugMsg);
+    sprintf_s(debugMsg, "FinishThumbnail: WTS_ALPHATYPE %d\n", alphaType);
+    OutputDebugStringA(debugMsg);
     
     // Get original media dimensions
     UINT origWidth = 0, origHeight = 0;
@@ -98,9 +115,6 @@ HRESULT GetFileThumbnailImpl(LPCWSTR filePath, UINT size, HBITMAP* phBitmap)
     
     if (SUCCEEDED(hr) && origWidth > 0 && origHeight > 0)
     {
-        sprintf_s(debugMsg, "Original media dimensions: %dx%d\n", origWidth, origHeight);
-        printf("%s", debugMsg);
-        
         // Calculate aspect ratio and determine crop size
         float aspectRatio = (float)origWidth / (float)origHeight;
         int cropWidth = size;
@@ -114,19 +128,14 @@ HRESULT GetFileThumbnailImpl(LPCWSTR filePath, UINT size, HBITMAP* phBitmap)
             cropWidth = (int)(size * aspectRatio);
         }
         
-        sprintf_s(debugMsg, "Calculated crop size: %dx%d (aspect ratio: %.2f)\n", cropWidth, cropHeight, aspectRatio);
-        printf("%s", debugMsg);
+        sprintf_s(debugMsg, "FinishThumbnail: media %ux%u, crop %dx%d\n", origWidth, origHeight, cropWidth, cropHeight);
+        OutputDebugStringA(debugMsg);
         
         // Crop using calculated dimensions
         HBITMAP hCropped = CropFromTopLeft(hRawBitmap, cropWidth, cropHeight);
         
         if (hCropped)
         {
-            BITMAP cropInfo = {};
-            GetObject(hCropped, sizeof(BITMAP), &cropInfo);
-            sprintf_s(debugMsg, "Cropped bitmap size: %dx%d\n", cropInfo.bmWidth, cropInfo.bmHeight);
-            printf("%s", debugMsg);
-            
             DeleteObject(hRawBitmap);
             *phBitmap = hCropped;
             return S_OK;
@@ -134,8 +143,73 @@ HRESULT GetFileThumbnailImpl(LPCWSTR filePath, UINT size, HBITMAP* phBitmap)
     }
     
     // Fallback: use original bitmap if dimension detection failed
-    printf("Using original bitmap (dimension detection failed or crop failed)\n");
+    OutputDebugStringA("FinishThumbnail: using the uncropped bitmap\n");
     *phBitmap = hRawBitmap;
     return S_OK;
 }
 
+HRESULT ExtractFileThumbnailInProcess(LPCWSTR filePath, UINT size, HBITMAP* phBitmap, WTS_ALPHATYPE* pAlphaType, bool skipCacheLookup)
+{
+    if (!filePath || !phBitmap)
+        return E_INVALIDARG;
+
+    *phBitmap = nullptr;
+
+    PreviewHandler handler;
+    WTS_ALPHATYPE alphaType = WTSAT_UNKNOWN;
+    HBITMAP hRawBitmap = nullptr;
+    HRESULT hr = handler.GetThumbnail(filePath, size, &hRawBitmap, &alphaType, skipCacheLookup);
+    
+    if (FAILED(hr) || !hRawBitmap)
+        return hr;
+
+    if (pAlphaType)
+        *pAlphaType = alphaType;
+    
+    return FinishThumbnail(filePath, size, hRawBitmap, alphaType, phBitmap);
+}
+
+static HRESULT ExtractFileThumbnail(LPCWSTR filePath, UINT size, HBITMAP* phBitmap, bool skipCacheLookup)
+{
+    // Third-party thumbnail handlers run in a worker process when isolation is on
+    HRESULT hr = IsHandlerIsolationEnabled()
+        ? RunIsolatedExtraction(skipCacheLookup ? IsolatedJobKind::UncachedThumbnail : IsolatedJobKind::Thumbnail,
+                                filePath, size, size, phBitmap)
+        : ExtractFileThumbnailInProcess(filePath, size, phBitmap, nullptr, skipCacheLookup);
+    if (FAILED(hr) || !*phBitmap)
+        return hr;
+
+    return ApplyThumbnailBackground(phBitmap);
+}
+
+HRESULT GetCachedFileThumbnailImpl(LPCWSTR filePath, UINT size, HBITMAP* phBitmap)
+{
+    if (!filePath || !phBitmap)
+        return E_INVALIDARG;
+
+    *phBitmap = nullptr;
+
+    PreviewHandler handler;
+    WTS_ALPHATYPE alphaType;
+    HBITMAP hRawBitmap = nullptr;
+    HRESULT hr = handler.GetThumbnailFromCache(filePath, size, &hRawBitmap, &alphaType);
+    
+    if (FAILED(hr) || !hRawBitmap)
+        return FAILED(hr) ? hr : E_FAIL;
+    
+    hr = FinishThumbnail(filePath, size, hRawBitmap, alphaType, phBitmap);
+    if (FAILED(hr) || !*phBitmap)
+        return hr;
+
+    return ApplyThumbnailBackground(phBitmap);
+}
+
+HRESULT GetFileThumbnailImpl(LPCWSTR filePath, UINT size, HBITMAP* phBitmap, bool skipCacheLookup)
+{
+    if (!filePath || !phBitmap)
+        return E_INVALIDARG;
+
+    // Concurrent requests for the same file share one extraction
+    return RunCoalesced(CoalesceMode::Thumbnail, filePath, size, size, phBitmap,
+        [filePath, size, skipCacheLookup](HBITMAP* phResult) { return ExtractFileThumbnail(filePath, size, phResult, skipCacheLookup); });
+}
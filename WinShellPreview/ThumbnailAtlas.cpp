@@ -0,0 +1,363 @@
+#include "ThumbnailAtlas.h"
+#include "PngWriter.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const char INDEX_MAGIC[8] = { 'W', 'S', 'P', 'A', 'T', 'L', 'S', '1' };
+
+    void PutU32(std::vector<uint8_t>* out, uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i)
+            out->push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    bool GetU32(const std::vector<uint8_t>& in, size_t* pos, uint32_t* v)
+    {
+        if (*pos + 4 > in.size())
+            return false;
+        *v = in[*pos] | (uint32_t(in[*pos + 1]) << 8) | (uint32_t(in[*pos + 2]) << 16) | (uint32_t(in[*pos + 3]) << 24);
+        *pos += 4;
+        return true;
+    }
+
+    void AppendJsonString(std::string* out, const std::string& value)
+    {
+        out->push_back('"');
+        for (unsigned char c : value)
+        {
+            switch (c)
+            {
+            case '"':  out->append("\\\""); break;
+            case '\\': out->append("\\\\"); break;
+            case '\n': out->append("\\n"); break;
+            case '\r': out->append("\\r"); break;
+            case '\t': out->append("\\t"); break;
+            default:
+                if (c < 0x20)
+                {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out->append(escaped);
+                }
+                else
+                {
+                    out->push_back(static_cast<char>(c));
+                }
+                break;
+            }
+        }
+        out->push_back('"');
+    }
+
+    bool IsOpaque(const PixelImage& image)
+    {
+        for (uint32_t y = 0; y < image.height; ++y)
+        {
+            const uint8_t* row = image.Row(y);
+            for (uint32_t x = 0; x < image.width; ++x)
+            {
+                if (row[x * 4 + 3] != 255)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    std::string PageFileName(const std::string& prefix, size_t page)
+    {
+        return prefix + "_" + std::to_string(page) + ".png";
+    }
+
+    bool WriteFile(const fs::path& path, const void* data, size_t size)
+    {
+        fs::path temp = path;
+        temp += ".tmp";
+        {
+            std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+            file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            if (!file)
+                return false;
+        }
+        std::error_code ec;
+        fs::rename(temp, path, ec);
+        return !ec;
+    }
+
+    bool CopyPageFile(const fs::path& from, const fs::path& to)
+    {
+        // Through a temporary, so copying a file onto itself leaves it intact
+        fs::path temp = to;
+        temp += ".tmp";
+        std::error_code ec;
+        if (!fs::copy_file(from, temp, fs::copy_options::overwrite_existing, ec))
+            return false;
+        fs::rename(temp, to, ec);
+        return !ec;
+    }
+}
+
+ThumbnailAtlas::ThumbnailAtlas(uint32_t pageWidth, uint32_t pageHeight, uint32_t padding)
+    : m_pageWidth(pageWidth), m_pageHeight(pageHeight), m_padding(padding)
+{
+}
+
+const ThumbnailAtlas::Entry* ThumbnailAtlas::Find(const std::string& id) const
+{
+    std::unordered_map<std::string, size_t>::const_iterator found = m_index.find(id);
+    return found == m_index.end() ? nullptr : &m_entries[found->second];
+}
+
+ThumbnailAtlas::Page* ThumbnailAtlas::PageWithRoom(uint32_t width, uint32_t height, AtlasRect* rect, uint32_t* pageIndex)
+{
+    // Only the newest page is open: earlier pages are full enough not to be worth searching
+    if (!m_pages.empty() && m_pages.back().packer && m_pages.back().packer->Insert(width, height, rect))
+    {
+        *pageIndex = static_cast<uint32_t>(m_pages.size() - 1);
+        return &m_pages.back();
+    }
+
+    Page page;
+    page.packer.reset(new SkylinePacker(m_pageWidth, m_pageHeight));
+    if (!page.packer->Insert(width, height, rect))
+        return nullptr;
+    if (!page.pixels.Allocate(m_pageWidth, m_pageHeight))
+        return nullptr;
+
+    page.pixels.alpha = AlphaMode::Premultiplied;
+    for (uint32_t y = 0; y < m_pageHeight; ++y)
+        memset(page.pixels.Row(y), 0, static_cast<size_t>(m_pageWidth) * 4);
+
+    m_pages.push_back(std::move(page));
+    *pageIndex = static_cast<uint32_t>(m_pages.size() - 1);
+    return &m_pages.back();
+}
+
+void ThumbnailAtlas::Blit(const PixelImage& image, PixelImage* page, uint32_t x, uint32_t y)
+{
+    // Pages hold premultiplied pixels; opaque and straight-alpha sources are converted
+    for (uint32_t row = 0; row < image.height; ++row)
+    {
+        const uint8_t* src = image.Row(row);
+        uint8_t* dst = page->Row(y + row) + static_cast<size_t>(x) * 4;
+        if (image.alpha == AlphaMode::Premultiplied)
+        {
+            memcpy(dst, src, static_cast<size_t>(image.width) * 4);
+            continue;
+        }
+        for (uint32_t col = 0; col < image.width; ++col, src += 4, dst += 4)
+        {
+            if (image.alpha == AlphaMode::Ignore)
+            {
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+                dst[3] = 255;
+            }
+            else
+            {
+                uint32_t a = src[3];
+                dst[0] = static_cast<uint8_t>((src[0] * a + 127) / 255);
+                dst[1] = static_cast<uint8_t>((src[1] * a + 127) / 255);
+                dst[2] = static_cast<uint8_t>((src[2] * a + 127) / 255);
+                dst[3] = static_cast<uint8_t>(a);
+            }
+        }
+    }
+}
+
+bool ThumbnailAtlas::Add(const std::string& id, const PixelImage& image, Entry* entry)
+{
+    const Entry* existing = Find(id);
+    if (existing)
+    {
+        if (entry)
+            *entry = *existing;
+        return true;
+    }
+
+    if (image.Empty() || image.width + m_padding > m_pageWidth || image.height + m_padding > m_pageHeight)
+        return false;
+
+    // Padding on the right and bottom keeps filtering in GPU samplers from bleeding neighbours in
+    AtlasRect slot;
+    uint32_t pageIndex = 0;
+    Page* page = PageWithRoom(image.width + m_padding, image.height + m_padding, &slot, &pageIndex);
+    if (!page)
+        return false;
+
+    Blit(image, &page->pixels, slot.x, slot.y);
+    page->dirty = true;
+    if (image.alpha != AlphaMode::Ignore && !page->translucent)
+        page->translucent = !IsOpaque(image);
+
+    Entry added;
+    added.id = id;
+    added.page = pageIndex;
+    added.rect.x = slot.x;
+    added.rect.y = slot.y;
+    added.rect.width = image.width;
+    added.rect.height = image.height;
+
+    m_index[id] = m_entries.size();
+    m_entries.push_back(added);
+    if (entry)
+        *entry = added;
+    return true;
+}
+
+std::string ThumbnailAtlas::IndexJson(const std::string& pageNamePrefix) const
+{
+    std::string json;
+    json.reserve(64 + m_entries.size() * 96);
+    json += "{\"pageWidth\":" + std::to_string(m_pageWidth);
+    json += ",\"pageHeight\":" + std::to_string(m_pageHeight);
+    json += ",\"pages\":[";
+    for (size_t i = 0; i < m_pages.size(); ++i)
+    {
+        if (i)
+            json.push_back(',');
+        AppendJsonString(&json, PageFileName(pageNamePrefix, i));
+    }
+    json += "],\"entries\":[";
+    for (size_t i = 0; i < m_entries.size(); ++i)
+    {
+        const Entry& e = m_entries[i];
+        if (i)
+            json.push_back(',');
+        json += "{\"id\":";
+        AppendJsonString(&json, e.id);
+        json += ",\"page\":" + std::to_string(e.page);
+        json += ",\"x\":" + std::to_string(e.rect.x);
+        json += ",\"y\":" + std::to_string(e.rect.y);
+        json += ",\"w\":" + std::to_string(e.rect.width);
+        json += ",\"h\":" + std::to_string(e.rect.height);
+        json.push_back('}');
+    }
+    json += "]}";
+    return json;
+}
+
+std::vector<uint8_t> ThumbnailAtlas::IndexBinary() const
+{
+    // Little-endian: magic, page size, padding, page count, entry count,
+    // then per entry page/x/y/w/h and a length-prefixed UTF-8 id
+    std::vector<uint8_t> out(INDEX_MAGIC, INDEX_MAGIC + sizeof(INDEX_MAGIC));
+    PutU32(&out, m_pageWidth);
+    PutU32(&out, m_pageHeight);
+    PutU32(&out, m_padding);
+    PutU32(&out, static_cast<uint32_t>(m_pages.size()));
+    PutU32(&out, static_cast<uint32_t>(m_entries.size()));
+    for (const Entry& e : m_entries)
+    {
+        PutU32(&out, e.page);
+        PutU32(&out, e.rect.x);
+        PutU32(&out, e.rect.y);
+        PutU32(&out, e.rect.width);
+        PutU32(&out, e.rect.height);
+        PutU32(&out, static_cast<uint32_t>(e.id.size()));
+        out.insert(out.end(), e.id.begin(), e.id.end());
+    }
+    return out;
+}
+
+bool ThumbnailAtlas::Save(const fs::path& basePath, int level)
+{
+    std::string prefix = basePath.filename().u8string();
+    fs::path directory = basePath.parent_path();
+    // The index names every page, so a new base needs all of them, not just the changed ones
+    bool moved = basePath != m_basePath;
+
+    for (size_t i = 0; i < m_pages.size(); ++i)
+    {
+        Page& page = m_pages[i];
+        if (!page.dirty && !moved)
+            continue;
+
+        if (!page.packer)
+        {
+            // Sealed pages have no pixels in memory; their file is copied from the old base
+            fs::path from = m_basePath.parent_path() / fs::u8path(PageFileName(m_basePath.filename().u8string(), i));
+            if (!CopyPageFile(from, directory / fs::u8path(PageFileName(prefix, i))))
+                return false;
+            continue;
+        }
+
+        // Encode only down to the lowest packed row; the rest of the page is empty
+        PixelImage used;
+        uint32_t usedHeight = page.packer->UsedHeight();
+        if (!used.Allocate(m_pageWidth, usedHeight))
+            return false;
+        // Fully opaque pages are written as RGB; padding then reads as black instead of transparent
+        used.alpha = page.translucent ? page.pixels.alpha : AlphaMode::Ignore;
+        for (uint32_t y = 0; y < usedHeight; ++y)
+            memcpy(used.Row(y), page.pixels.Row(y), static_cast<size_t>(m_pageWidth) * 4);
+
+        if (!SavePixelImageAsPng(used, directory / fs::u8path(PageFileName(prefix, i)), level))
+            return false;
+        page.dirty = false;
+    }
+
+    std::string json = IndexJson(prefix);
+    std::vector<uint8_t> binary = IndexBinary();
+
+    fs::path jsonPath = basePath;
+    jsonPath += ".json";
+    fs::path binaryPath = basePath;
+    binaryPath += ".atlas";
+    if (!WriteFile(jsonPath, json.data(), json.size()) || !WriteFile(binaryPath, binary.data(), binary.size()))
+        return false;
+    m_basePath = basePath;
+    return true;
+}
+
+bool ThumbnailAtlas::Load(const fs::path& basePath)
+{
+    fs::path binaryPath = basePath;
+    binaryPath += ".atlas";
+    std::ifstream file(binaryPath, std::ios::binary);
+    if (!file)
+        return false;
+    std::vector<uint8_t> in((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (in.size() < sizeof(INDEX_MAGIC) || memcmp(in.data(), INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0)
+        return false;
+
+    size_t pos = sizeof(INDEX_MAGIC);
+    uint32_t pageWidth, pageHeight, padding, pageCount, entryCount;
+    if (!GetU32(in, &pos, &pageWidth) || !GetU32(in, &pos, &pageHeight) || !GetU32(in, &pos, &padding) ||
+        !GetU32(in, &pos, &pageCount) || !GetU32(in, &pos, &entryCount))
+        return false;
+
+    std::vector<Entry> entries;
+    for (uint32_t i = 0; i < entryCount; ++i)
+    {
+        Entry e;
+        uint32_t idLength;
+        if (!GetU32(in, &pos, &e.page) || !GetU32(in, &pos, &e.rect.x) || !GetU32(in, &pos, &e.rect.y) ||
+            !GetU32(in, &pos, &e.rect.width) || !GetU32(in, &pos, &e.rect.height) || !GetU32(in, &pos, &idLength))
+            return false;
+        if (pos + idLength > in.size() || e.page >= pageCount)
+            return false;
+        e.id.assign(reinterpret_cast<const char*>(&in[pos]), idLength);
+        pos += idLength;
+        entries.push_back(std::move(e));
+    }
+
+    m_pageWidth = pageWidth;
+    m_pageHeight = pageHeight;
+    m_padding = padding;
+    m_pages.clear();
+    m_pages.resize(pageCount);     // Sealed: no packer, no pixels, not dirty
+    m_entries.swap(entries);
+    m_index.clear();
+    for (size_t i = 0; i < m_entries.size(); ++i)
+        m_index[m_entries[i].id] = i;
+    m_basePath = basePath;
+    return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "ImageOps.h"
+#include "SkylinePacker.h"
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Packs many small images into a few large pages that are encoded once, with an index of where
+// each image landed (JSON for web clients, compact binary for reloading). Images can be appended
+// after a save; only pages that changed are re-encoded. No Windows dependencies.
+//
+// Files written by Save(base):  base.json, base.atlas (binary index), base_<page>.png
+class ThumbnailAtlas
+{
+public:
+    struct Entry
+    {
+        std::string id;         // UTF-8, unique within the atlas
+        uint32_t page;
+        AtlasRect rect;
+    };
+
+    ThumbnailAtlas(uint32_t pageWidth, uint32_t pageHeight, uint32_t padding);
+
+    // Copies image into the atlas. An id that is already present returns its existing entry.
+    // Returns false if the image is larger than a page or memory runs out.
+    bool Add(const std::string& id, const PixelImage& image, Entry* entry);
+
+    const Entry* Find(const std::string& id) const;
+    const std::vector<Entry>& Entries() const { return m_entries; }
+    size_t PageCount() const { return m_pages.size(); }
+    uint32_t PageWidth() const { return m_pageWidth; }
+    uint32_t PageHeight() const { return m_pageHeight; }
+
+    // Encodes dirty pages and rewrites both index files. Saving under a different base than
+    // the last Save or Load writes every page there, copying the files of sealed pages.
+    bool Save(const std::filesystem::path& basePath, int level = 6);
+
+    // Restores the index written by Save. Pages from disk are kept as they are; images added
+    // afterwards go to new pages.
+    bool Load(const std::filesystem::path& basePath);
+
+    std::string IndexJson(const std::string& pageNamePrefix) const;
+    std::vector<uint8_t> IndexBinary() const;
+
+private:
+    struct Page
+    {
+        std::unique_ptr<SkylinePacker> packer;  // Null for sealed pages loaded from disk
+        PixelImage pixels;
+        bool dirty = false;
+        bool translucent = false;               // Encode with an alpha channel
+    };
+
+    Page* PageWithRoom(uint32_t width, uint32_t height, AtlasRect* rect, uint32_t* pageIndex);
+    static void Blit(const PixelImage& image, PixelImage* page, uint32_t x, uint32_t y);
+
+    uint32_t m_pageWidth;
+    uint32_t m_pageHeight;
+    uint32_t m_padding;
+    std::vector<Page> m_pages;
+    std::vector<Entry> m_entries;
+    std::unordered_map<std::string, size_t> m_index;
+    std::filesystem::path m_basePath;   // Where the page files were last saved or loaded
+};
@@ -1,8 +1,22 @@
 #pragma once
 #include "framework.h"
 
-// Thumbnail implementation
-HRESULT GetFileThumbnailImpl(LPCWSTR filePath, UINT size, HBITMAP* phBitmap);
+// Thumbnail implementation. skipCacheLookup: the caller has just missed the Shell thumbnail
+// cache (GetCachedFileThumbnailImpl), so the cache-only providers are not asked again.
+HRESULT GetFileThumbnailImpl(LPCWSTR filePath, UINT size, HBITMAP* phBitmap, bool skipCacheLookup = false);
+
+// Same output as GetFileThumbnailImpl, but only if the Shell thumbnail cache already has it
+HRESULT GetCachedFileThumbnailImpl(LPCWSTR filePath, UINT size, HBITMAP* phBitmap);
+
+// Extraction in the calling process, bypassing coalescing and handler isolation
+// pAlphaType (optional) receives the handler's WTS_ALPHATYPE
+HRESULT ExtractFileThumbnailInProcess(LPCWSTR filePath, UINT size, HBITMAP* phBitmap, WTS_ALPHATYPE* pAlphaType = nullptr,
+                                      bool skipCacheLookup = false);
+
+// Background the thumbnail APIs flatten transparent thumbnails onto, white by default.
+// nullptr opts into keeping transparency.
+HRESULT SetThumbnailBackgroundImpl(const COLORREF* pColor);
+bool GetThumbnailBackground(COLORREF* pColor);
 
 // Helper function (thumbnail-specific)
 HRESULT GetMediaDimensions(LPCWSTR filePath, UINT* width, UINT* height);
@@ -0,0 +1,191 @@
+#include "TiledCapture.h"
+#include "BoundedQueue.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const uint32_t MAX_ENCODE_THREADS = 8;
+
+    struct Band
+    {
+        uint32_t index = 0;
+        uint32_t y = 0;
+        uint32_t rows = 0;
+        bool hasPrior = false;
+        std::vector<uint8_t> pixels;    // rows x width BGRA
+        std::vector<uint8_t> prior;     // Last BGRA row of the previous band
+        std::vector<uint8_t> filtered;  // rows x filtered scanline
+    };
+
+    uint32_t EncodeThreadCount(const TiledCaptureOptions& options)
+    {
+        uint32_t threads = options.encodeThreads;
+        if (threads == 0)
+        {
+            threads = std::thread::hardware_concurrency();
+            threads = (std::min)((std::max)(threads, 1u), MAX_ENCODE_THREADS);
+        }
+        return threads;
+    }
+}
+
+uint32_t TiledBandHeight(uint32_t width, const TiledCaptureOptions& options)
+{
+    // Pixels plus the filtered copy: about 8 bytes per pixel of a band row
+    uint64_t rowBytes = static_cast<uint64_t>(width) * 8 + 1;
+    uint64_t budgetRows = options.maxBandBytes / rowBytes;
+    uint32_t height = options.tileHeight ? options.tileHeight : 256;
+    if (budgetRows < height)
+        height = static_cast<uint32_t>((std::max)(budgetRows, static_cast<uint64_t>(1)));
+    return height;
+}
+
+TiledCaptureResult RunTiledPngCapture(TileRenderer& renderer, uint32_t width, uint32_t height, AlphaMode alpha,
+                                      const TiledCaptureOptions& options, const PngWriter::Sink& sink)
+{
+    TiledCaptureResult result;
+    if (width == 0 || height == 0)
+        return result;
+
+    const uint32_t tileWidth = options.tileWidth ? (std::min)(options.tileWidth, width) : width;
+    const uint32_t bandHeight = (std::min)(TiledBandHeight(width, options), height);
+    const uint32_t bandCount = (height + bandHeight - 1) / bandHeight;
+    const uint32_t threads = EncodeThreadCount(options);
+    const uint32_t bandsInFlight = options.bandsInFlight ? options.bandsInFlight : threads + 2;
+    const size_t pixelStride = static_cast<size_t>(width) * 4;
+
+    result.tileWidth = tileWidth;
+    result.tileHeight = bandHeight;
+
+    bool sinkFailed = false;
+    PngWriter writer([&sink, &sinkFailed](const uint8_t* data, size_t size)
+    {
+        if (!sink(data, size))
+            sinkFailed = true;
+        return !sinkFailed;
+    }, options.level);
+    if (!writer.Begin(width, height, alpha))
+    {
+        result.sinkFailed = true;
+        return result;
+    }
+
+    PngRowFilter probe;
+    probe.Reset(width, alpha);
+    const size_t filteredRowBytes = probe.FilteredRowBytes();
+    result.bandBytes = static_cast<uint64_t>(bandHeight) * (pixelStride + filteredRowBytes) + pixelStride;
+
+    // Band buffers cycle renderer -> filter workers -> in-order writer -> renderer
+    std::vector<std::unique_ptr<Band>> bands;
+    BoundedQueue<Band*> freeBands(bandsInFlight);
+    BoundedQueue<Band*> work(bandsInFlight);
+    std::mutex writeMutex;
+    std::map<uint32_t, Band*> finished;     // Filtered bands waiting for their turn
+    uint32_t nextWrite = 0;
+    std::atomic<bool> failed{false};
+
+    auto commit = [&](Band* band)
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        finished[band->index] = band;
+        for (auto it = finished.begin(); it != finished.end() && it->first == nextWrite; it = finished.erase(it))
+        {
+            Band* ready = it->second;
+            if (!failed.load(std::memory_order_relaxed) && !writer.WriteFilteredRows(ready->filtered.data(), ready->rows))
+                failed.store(true, std::memory_order_relaxed);
+            nextWrite++;
+            freeBands.Push(ready);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < threads; ++i)
+    {
+        workers.emplace_back([&]()
+        {
+            PngRowFilter filter;
+            Band* band = nullptr;
+            while (work.Pop(&band))
+            {
+                if (!failed.load(std::memory_order_relaxed))
+                {
+                    filter.Reset(width, alpha);
+                    if (band->hasPrior)
+                        filter.SetPriorRow(band->prior.data());
+                    uint8_t* out = band->filtered.data();
+                    for (uint32_t row = 0; row < band->rows; ++row, out += filteredRowBytes)
+                        memcpy(out, filter.FilterRow(band->pixels.data() + row * pixelStride), filteredRowBytes);
+                }
+                commit(band);
+            }
+        });
+    }
+
+    // Render on the calling thread: tile sources are often bound to it (windows, STA objects)
+    std::vector<uint8_t> lastRow;
+    for (uint32_t index = 0; index < bandCount && !failed.load(std::memory_order_relaxed); ++index)
+    {
+        Band* band = nullptr;
+        if (freeBands.Size() == 0 && bands.size() < bandsInFlight)
+        {
+            bands.emplace_back(new Band());
+            band = bands.back().get();
+            band->pixels.resize(static_cast<size_t>(bandHeight) * pixelStride);
+            band->prior.resize(pixelStride);
+            band->filtered.resize(static_cast<size_t>(bandHeight) * filteredRowBytes);
+        }
+        else if (!freeBands.Pop(&band))
+        {
+            break;
+        }
+        if (failed.load(std::memory_order_relaxed))
+            break;
+
+        band->index = index;
+        band->y = index * bandHeight;
+        band->rows = (std::min)(bandHeight, height - band->y);
+        band->hasPrior = index > 0;
+        if (band->hasPrior)
+            memcpy(band->prior.data(), lastRow.data(), pixelStride);
+
+        for (uint32_t x = 0; x < width; x += tileWidth)
+        {
+            TileRect tile;
+            tile.x = x;
+            tile.y = band->y;
+            tile.width = (std::min)(tileWidth, width - x);
+            tile.height = band->rows;
+            if (!renderer.RenderTile(tile, band->pixels.data() + static_cast<size_t>(x) * 4, pixelStride))
+            {
+                result.renderFailed = true;
+                failed.store(true, std::memory_order_relaxed);
+                break;
+            }
+            result.tilesRendered++;
+        }
+        if (result.renderFailed)
+            break;
+
+        const uint8_t* last = band->pixels.data() + static_cast<size_t>(band->rows - 1) * pixelStride;
+        lastRow.assign(last, last + pixelStride);
+        work.Push(band);
+        result.bands++;
+    }
+
+    work.Close();
+    for (std::thread& worker : workers)
+        worker.join();
+
+    result.peakBandBytes = static_cast<uint64_t>(bands.size()) * result.bandBytes;
+    result.renderStallMs = freeBands.Stats().popWaitMs;
+    result.ok = !failed.load() && result.bands == bandCount && writer.Finish();
+    result.sinkFailed = sinkFailed;
+    return result;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "ImageOps.h"
+#include "PngWriter.h"
+#include <cstddef>
+#include <cstdint>
+
+// Tiled capture of very large images straight into a PNG stream. The renderer fills fixed-size
+// tiles one band (a row of tiles) at a time; filter workers prepare finished bands in parallel
+// and the deflate stage consumes them in order. Only `bandsInFlight` bands exist at once, so
+// peak memory follows the tile size and band budget, never the output height.
+// No Windows dependencies.
+
+struct TileRect
+{
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+// Implemented per image source
+class TileRenderer
+{
+public:
+    virtual ~TileRenderer() {}
+
+    // Fills tile.width x tile.height BGRA pixels, top-down rows `stride` bytes apart. Runs on the
+    // thread that called RunTiledPngCapture, in row-major tile order.
+    virtual bool RenderTile(const TileRect& tile, uint8_t* pixels, size_t stride) = 0;
+};
+
+struct TiledCaptureOptions
+{
+    uint32_t tileWidth = 1024;
+    uint32_t tileHeight = 256;
+    size_t maxBandBytes = 16 * 1024 * 1024;     // Lowers tileHeight for very wide images
+    uint32_t encodeThreads = 0;                 // Filter workers, 0 = hardware threads (at most 8)
+    uint32_t bandsInFlight = 0;                 // Band buffers, 0 = encodeThreads + 2
+    int level = 6;
+};
+
+struct TiledCaptureResult
+{
+    bool ok = false;
+    bool renderFailed = false;
+    bool sinkFailed = false;
+    uint32_t tileWidth = 0;         // Effective tile size
+    uint32_t tileHeight = 0;
+    uint32_t tilesRendered = 0;
+    uint32_t bands = 0;
+    uint64_t bandBytes = 0;         // One band buffer (pixels + filtered scanlines)
+    uint64_t peakBandBytes = 0;     // Band buffers allocated at the same time
+    uint64_t renderStallMs = 0;     // Renderer waited for the encoders (backpressure)
+};
+
+// Band height RunTiledPngCapture uses for the given width
+uint32_t TiledBandHeight(uint32_t width, const TiledCaptureOptions& options);
+
+// Renders width x height in tiles and streams the PNG to sink. Returns after the last byte is
+// written or the first failure; a failing renderer or sink stops the remaining tiles.
+TiledCaptureResult RunTiledPngCapture(TileRenderer& renderer, uint32_t width, uint32_t height, AlphaMode alpha,
+                                      const TiledCaptureOptions& options, const PngWriter::Sink& sink);
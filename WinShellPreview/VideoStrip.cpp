@@ -0,0 +1,258 @@
+#include "pch.h"
+#include "VideoStripImpl.h"
+#include "BitmapUtils.h"
+#include "FrameStrip.h"
+#include "GifWriter.h"
+#include <mfapi.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+#include <mferror.h>
+#include <filesystem>
+
+#pragma comment(lib, "mfplat.lib")
+#pragma comment(lib, "mfreadwrite.lib")
+#pragma comment(lib, "mfuuid.lib")
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    const LONGLONG TICKS_PER_MS = 10000;        // Media Foundation time is in 100 ns units
+    const UINT MAX_SAMPLES_PER_SEEK = 600;      // Decoded samples allowed between a seek and the target
+    const UINT DEFAULT_GIF_DELAY_MS = 500;
+
+    // Decodes video frames as RGB32 through IMFSourceReader. Seeks land on the preceding key
+    // frame, so samples are read forward until the target timestamp is reached.
+    class MediaFoundationFrameSource : public FrameSource
+    {
+    public:
+        explicit MediaFoundationFrameSource(LPCWSTR filePath)
+            : m_filePath(filePath), m_hrStartup(E_FAIL), m_lastError(S_OK), m_width(0), m_height(0), m_stride(0)
+        {
+        }
+
+        HRESULT LastError() const { return m_lastError; }
+
+        bool Open(MediaInfo* info) override
+        {
+            m_hrStartup = MFStartup(MF_VERSION, MFSTARTUP_LITE);
+            if (FAILED(m_hrStartup))
+                return Fail(m_hrStartup);
+
+            ComPtr<IMFAttributes> attributes;
+            HRESULT hr = MFCreateAttributes(&attributes, 1);
+            if (SUCCEEDED(hr))
+                hr = attributes->SetUINT32(MF_SOURCE_READER_ENABLE_VIDEO_PROCESSING, TRUE);
+            if (SUCCEEDED(hr))
+                hr = MFCreateSourceReaderFromURL(m_filePath.c_str(), attributes.Get(), &m_reader);
+            if (FAILED(hr))
+                return Fail(hr);
+
+            // Decode the first video stream only
+            m_reader->SetStreamSelection(static_cast<DWORD>(MF_SOURCE_READER_ALL_STREAMS), FALSE);
+            hr = m_reader->SetStreamSelection(static_cast<DWORD>(MF_SOURCE_READER_FIRST_VIDEO_STREAM), TRUE);
+            if (FAILED(hr))
+                return Fail(hr);
+
+            ComPtr<IMFMediaType> type;
+            hr = MFCreateMediaType(&type);
+            if (SUCCEEDED(hr))
+                hr = type->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+            if (SUCCEEDED(hr))
+                hr = type->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_RGB32);
+            if (SUCCEEDED(hr))
+                hr = m_reader->SetCurrentMediaType(static_cast<DWORD>(MF_SOURCE_READER_FIRST_VIDEO_STREAM), nullptr, type.Get());
+            if (SUCCEEDED(hr))
+                hr = ReadFormat();
+            if (FAILED(hr))
+                return Fail(hr);
+
+            PROPVARIANT duration;
+            PropVariantInit(&duration);
+            if (SUCCEEDED(m_reader->GetPresentationAttribute(static_cast<DWORD>(MF_SOURCE_READER_MEDIASOURCE), MF_PD_DURATION, &duration)))
+                info->durationMs = duration.uhVal.QuadPart / TICKS_PER_MS;
+            PropVariantClear(&duration);
+
+            info->width = m_width;
+            info->height = m_height;
+            return true;
+        }
+
+        bool ReadFrame(uint64_t timestampMs, PixelImage* frame) override
+        {
+            LONGLONG target = static_cast<LONGLONG>(timestampMs) * TICKS_PER_MS;
+
+            PROPVARIANT position;
+            HRESULT hr = InitPropVariantFromInt64(target, &position);
+            if (SUCCEEDED(hr))
+            {
+                hr = m_reader->SetCurrentPosition(GUID_NULL, position);
+                PropVariantClear(&position);
+            }
+            if (FAILED(hr))
+                return Fail(hr);
+
+            // The last decoded sample stands in when the stream ends before the target
+            ComPtr<IMFSample> candidate;
+            for (UINT i = 0; i < MAX_SAMPLES_PER_SEEK; ++i)
+            {
+                DWORD flags = 0;
+                LONGLONG sampleTime = 0;
+                ComPtr<IMFSample> sample;
+                hr = m_reader->ReadSample(static_cast<DWORD>(MF_SOURCE_READER_FIRST_VIDEO_STREAM), 0, nullptr,
+                                          &flags, &sampleTime, &sample);
+                if (FAILED(hr))
+                    return Fail(hr);
+
+                if (flags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED)
+                {
+                    hr = ReadFormat();
+                    if (FAILED(hr))
+                        return Fail(hr);
+                }
+                if (sample)
+                    candidate = sample;
+                if ((flags & MF_SOURCE_READERF_ENDOFSTREAM) || (sample && sampleTime >= target))
+                    break;
+            }
+            if (!candidate)
+                return Fail(MF_E_END_OF_STREAM);
+
+            hr = CopySample(candidate.Get(), frame);
+            return SUCCEEDED(hr) || Fail(hr);
+        }
+
+        void Close() override
+        {
+            m_reader.Reset();
+            if (SUCCEEDED(m_hrStartup))
+            {
+                MFShutdown();
+                m_hrStartup = E_FAIL;
+            }
+        }
+
+    private:
+        bool Fail(HRESULT hr)
+        {
+            m_lastError = hr;
+            return false;
+        }
+
+        HRESULT ReadFormat()
+        {
+            ComPtr<IMFMediaType> type;
+            HRESULT hr = m_reader->GetCurrentMediaType(static_cast<DWORD>(MF_SOURCE_READER_FIRST_VIDEO_STREAM), &type);
+            if (FAILED(hr))
+                return hr;
+
+            UINT32 width = 0;
+            UINT32 height = 0;
+            hr = MFGetAttributeSize(type.Get(), MF_MT_FRAME_SIZE, &width, &height);
+            if (FAILED(hr))
+                return hr;
+            if (width == 0 || height == 0)
+                return MF_E_INVALIDMEDIATYPE;
+
+            m_width = width;
+            m_height = height;
+            m_stride = static_cast<LONG>(MFGetAttributeUINT32(type.Get(), MF_MT_DEFAULT_STRIDE, width * 4));
+            return S_OK;
+        }
+
+        HRESULT CopySample(IMFSample* sample, PixelImage* frame)
+        {
+            ComPtr<IMFMediaBuffer> buffer;
+            HRESULT hr = sample->ConvertToContiguousBuffer(&buffer);
+            if (FAILED(hr))
+                return hr;
+
+            if (!frame->Allocate(m_width, m_height))
+                return E_OUTOFMEMORY;
+            frame->alpha = AlphaMode::Ignore;     // RGB32: the fourth byte is undefined
+
+            // Prefer the 2D lock, which reports the real pitch (and bottom-up layouts)
+            ComPtr<IMF2DBuffer> buffer2d;
+            BYTE* scan0 = nullptr;
+            LONG pitch = 0;
+            bool locked2d = SUCCEEDED(buffer.As(&buffer2d)) && SUCCEEDED(buffer2d->Lock2D(&scan0, &pitch));
+            DWORD length = 0;
+            if (!locked2d)
+            {
+                hr = buffer->Lock(&scan0, nullptr, &length);
+                if (FAILED(hr))
+                    return hr;
+                pitch = m_stride;
+                if (pitch < 0)
+                    scan0 += static_cast<size_t>(m_height - 1) * static_cast<size_t>(-pitch);
+                if (static_cast<size_t>(pitch < 0 ? -pitch : pitch) * m_height > length)
+                {
+                    buffer->Unlock();
+                    return MF_E_BUFFERTOOSMALL;
+                }
+            }
+
+            for (UINT y = 0; y < m_height; ++y)
+                memcpy(frame->Row(y), scan0 + static_cast<ptrdiff_t>(y) * pitch, static_cast<size_t>(m_width) * 4);
+
+            if (locked2d)
+                buffer2d->Unlock2D();
+            else
+                buffer->Unlock();
+            return S_OK;
+        }
+
+        std::wstring m_filePath;
+        HRESULT m_hrStartup;
+        HRESULT m_lastError;
+        ComPtr<IMFSourceReader> m_reader;
+        UINT m_width;
+        UINT m_height;
+        LONG m_stride;
+    };
+}
+
+HRESULT GetFileFrameStripImpl(LPCWSTR filePath, const WSP_FRAME_STRIP_OPTIONS* pOptions, HBITMAP* phStrip)
+{
+    if (phStrip)
+        *phStrip = nullptr;
+
+    if (!filePath || !pOptions || (!phStrip && !pOptions->gifPath))
+        return E_INVALIDARG;
+    if (pOptions->frameWidth == 0 || pOptions->frameHeight == 0)
+        return E_INVALIDARG;
+    if (!pOptions->timestampsMs && pOptions->frameCount == 0)
+        return E_INVALIDARG;
+
+    FrameStripOptions options;
+    options.frameCount = pOptions->frameCount;
+    options.frameWidth = pOptions->frameWidth;
+    options.frameHeight = pOptions->frameHeight;
+    options.columns = pOptions->columns;
+    options.spacing = pOptions->spacing;
+    if (pOptions->timestampsMs)
+        options.timestampsMs.assign(pOptions->timestampsMs, pOptions->timestampsMs + pOptions->frameCount);
+
+    HRESULT hrCom = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+
+    MediaFoundationFrameSource source(filePath);
+    FrameStripResult result;
+    bool built = BuildFrameStrip(source, options, &result);
+
+    if (SUCCEEDED(hrCom))
+        CoUninitialize();
+
+    if (!built)
+        return FAILED(source.LastError()) ? source.LastError() : E_FAIL;
+
+    if (pOptions->gifPath)
+    {
+        UINT delay = pOptions->gifDelayMs ? pOptions->gifDelayMs : DEFAULT_GIF_DELAY_MS;
+        if (!SaveFramesAsGif(result.frames, delay, std::filesystem::path(pOptions->gifPath)))
+            return E_FAIL;
+    }
+
+    if (!phStrip)
+        return S_OK;
+    return PixelImageToHBITMAP(result.strip, phStrip);
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include "framework.h"
+#include "WinShellPreview.h"
+
+// Opens the media file once with a Media Foundation source reader and extracts frames at even
+// intervals (or the given timestamps) into one strip bitmap, optionally also an animated GIF.
+HRESULT GetFileFrameStripImpl(LPCWSTR filePath, const WSP_FRAME_STRIP_OPTIONS* pOptions, HBITMAP* phStrip);
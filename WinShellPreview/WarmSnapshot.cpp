@@ -0,0 +1,449 @@
+#include "WarmSnapshot.h"
+#include "ContentHash.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    const char SNAPSHOT_MAGIC[8] = { 'W', 'S', 'P', 'S', 'N', 'A', 'P', '\0' };
+    const size_t SECTION_ALIGNMENT = 64;
+    const size_t PIXEL_ALIGNMENT = 16;
+    const uint32_t MAX_SECTIONS = 64;
+    const uint32_t MAX_IMAGE_SIDE = 4096;       // Icons and mips are small; anything larger is damage
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t sectionCount;
+        uint64_t fileSize;
+        uint64_t tableHash;                     // XXH64 of the section table
+        uint8_t reserved[32];
+    };
+
+    struct SectionRecord
+    {
+        uint32_t kind;
+        uint32_t count;
+        uint64_t offset;                        // From the start of the file, SECTION_ALIGNMENT aligned
+        uint64_t size;
+        uint64_t hash;                          // XXH64 of the section's bytes
+    };
+
+    struct HandlerRecord
+    {
+        char key[HandlerMap::MAX_KEY_BYTES];    // Zero padded
+        uint32_t resolution;
+        uint32_t reserved;
+        uint8_t clsid[16];
+    };
+
+    // Offsets are from the start of the section
+    struct ImageRecord
+    {
+        uint64_t keyOffset;
+        uint32_t keyLength;
+        uint32_t width;
+        uint32_t height;
+        uint32_t alpha;
+        uint64_t pixelOffset;                   // width * 4 bytes per row, no padding
+    };
+
+    struct SignatureRecord
+    {
+        uint64_t keyOffset;
+        uint32_t keyLength;
+        uint32_t paletteCount;
+        uint64_t perceptualHash;
+        uint64_t differenceHash;
+        uint8_t average[4];                     // R, G, B, unused
+        uint32_t reserved;
+        struct
+        {
+            uint8_t color[4];                   // R, G, B, unused
+            uint32_t share;
+        } palette[ImageSignature::MAX_PALETTE];
+    };
+
+    static_assert(sizeof(FileHeader) == 64, "snapshot header layout");
+    static_assert(sizeof(SectionRecord) == 32, "snapshot section table layout");
+    static_assert(sizeof(HandlerRecord) == 56, "snapshot handler layout");
+    static_assert(sizeof(ImageRecord) == 32, "snapshot image layout");
+    static_assert(sizeof(SignatureRecord) == 104, "snapshot signature layout");
+
+    size_t AlignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void Append(std::vector<uint8_t>* data, const void* bytes, size_t size)
+    {
+        const uint8_t* begin = static_cast<const uint8_t*>(bytes);
+        data->insert(data->end(), begin, begin + size);
+    }
+
+    template <typename Record>
+    void WriteRecord(std::vector<uint8_t>* data, size_t index, const Record& record)
+    {
+        memcpy(data->data() + index * sizeof(Record), &record, sizeof(Record));
+    }
+
+    // Records are copied out rather than cast, so the mapping needs no particular alignment
+    template <typename Record>
+    Record ReadRecord(const uint8_t* data, size_t index)
+    {
+        Record record;
+        memcpy(&record, data + index * sizeof(Record), sizeof(Record));
+        return record;
+    }
+
+    // An empty vector may have no storage at all
+    uint64_t Hash(const void* data, size_t size)
+    {
+        static const uint8_t none = 0;
+        return HashXxh64(size ? data : &none, size);
+    }
+
+    bool InBounds(uint64_t offset, uint64_t size, uint64_t limit)
+    {
+        return offset <= limit && size <= limit - offset;
+    }
+}
+
+SnapshotWriter::Section& SnapshotWriter::NewSection(SnapshotSection kind, uint32_t count)
+{
+    m_sections.erase(std::remove_if(m_sections.begin(), m_sections.end(),
+                                    [kind](const Section& section) { return section.kind == kind; }),
+                     m_sections.end());
+    m_sections.push_back(Section{ kind, count, std::vector<uint8_t>() });
+    return m_sections.back();
+}
+
+void SnapshotWriter::AddHandlers(const std::vector<HandlerMapEntry>& entries)
+{
+    std::vector<HandlerRecord> records;
+    records.reserve(entries.size());
+    for (const HandlerMapEntry& entry : entries)
+    {
+        if (entry.resolution == HandlerResolution::Failed || entry.extensionKey.size() > HandlerMap::MAX_KEY_BYTES)
+            continue;
+
+        HandlerRecord record = {};
+        memcpy(record.key, entry.extensionKey.data(), entry.extensionKey.size());
+        record.resolution = static_cast<uint32_t>(entry.resolution);
+        memcpy(record.clsid, entry.clsid.bytes, sizeof(record.clsid));
+        records.push_back(record);
+    }
+
+    Section& section = NewSection(SnapshotSection::Handlers, static_cast<uint32_t>(records.size()));
+    Append(&section.data, records.data(), records.size() * sizeof(HandlerRecord));
+}
+
+void SnapshotWriter::AddImages(SnapshotSection kind, const SnapshotImages& images)
+{
+    std::vector<const std::pair<std::string, SharedImageCache::ImagePtr>*> kept;
+    kept.reserve(images.size());
+    for (const auto& image : images)
+    {
+        const PixelImage* pixels = image.second.get();
+        if (pixels && !pixels->Empty() && pixels->width <= MAX_IMAGE_SIDE && pixels->height <= MAX_IMAGE_SIDE)
+            kept.push_back(&image);
+    }
+
+    // Records, then every key, then the pixels of each image at PIXEL_ALIGNMENT
+    Section& section = NewSection(kind, static_cast<uint32_t>(kept.size()));
+    std::vector<uint8_t>& data = section.data;
+    data.resize(kept.size() * sizeof(ImageRecord));
+
+    std::vector<ImageRecord> records(kept.size());
+    for (size_t i = 0; i < kept.size(); ++i)
+    {
+        records[i].keyOffset = data.size();
+        records[i].keyLength = static_cast<uint32_t>(kept[i]->first.size());
+        Append(&data, kept[i]->first.data(), kept[i]->first.size());
+    }
+
+    for (size_t i = 0; i < kept.size(); ++i)
+    {
+        const PixelImage& image = *kept[i]->second;
+        size_t rowBytes = static_cast<size_t>(image.width) * 4;
+
+        data.resize(AlignUp(data.size(), PIXEL_ALIGNMENT));
+        records[i].width = image.width;
+        records[i].height = image.height;
+        records[i].alpha = static_cast<uint32_t>(image.alpha);
+        records[i].pixelOffset = data.size();
+        for (uint32_t y = 0; y < image.height; ++y)
+            Append(&data, image.Row(y), rowBytes);
+        WriteRecord(&data, i, records[i]);
+    }
+}
+
+void SnapshotWriter::AddSignatures(const SnapshotSignatures& signatures)
+{
+    Section& section = NewSection(SnapshotSection::Signatures, static_cast<uint32_t>(signatures.size()));
+    std::vector<uint8_t>& data = section.data;
+    data.resize(signatures.size() * sizeof(SignatureRecord));
+
+    for (size_t i = 0; i < signatures.size(); ++i)
+    {
+        const ImageSignature& signature = signatures[i].second;
+        SignatureRecord record = {};
+        record.keyOffset = data.size();
+        record.keyLength = static_cast<uint32_t>(signatures[i].first.size());
+        record.paletteCount = signature.paletteCount < ImageSignature::MAX_PALETTE ? signature.paletteCount
+                                                                                    : ImageSignature::MAX_PALETTE;
+        record.perceptualHash = signature.perceptualHash;
+        record.differenceHash = signature.differenceHash;
+        record.average[0] = signature.averageR;
+        record.average[1] = signature.averageG;
+        record.average[2] = signature.averageB;
+        for (uint32_t c = 0; c < record.paletteCount; ++c)
+        {
+            record.palette[c].color[0] = signature.palette[c].r;
+            record.palette[c].color[1] = signature.palette[c].g;
+            record.palette[c].color[2] = signature.palette[c].b;
+            record.palette[c].share = signature.palette[c].share;
+        }
+        WriteRecord(&data, i, record);
+        Append(&data, signatures[i].first.data(), signatures[i].first.size());
+    }
+}
+
+void SnapshotWriter::AddText(SnapshotSection kind, const std::string& text)
+{
+    Section& section = NewSection(kind, 1);
+    Append(&section.data, text.data(), text.size());
+}
+
+bool SnapshotWriter::Save(const std::filesystem::path& path, uint64_t* bytes) const
+{
+    std::vector<SectionRecord> table(m_sections.size());
+    size_t offset = AlignUp(sizeof(FileHeader) + table.size() * sizeof(SectionRecord), SECTION_ALIGNMENT);
+    for (size_t i = 0; i < m_sections.size(); ++i)
+    {
+        const Section& section = m_sections[i];
+        table[i].kind = static_cast<uint32_t>(section.kind);
+        table[i].count = section.count;
+        table[i].offset = offset;
+        table[i].size = section.data.size();
+        table[i].hash = Hash(section.data.data(), section.data.size());
+        offset = AlignUp(offset + section.data.size(), SECTION_ALIGNMENT);
+    }
+
+    FileHeader header = {};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.sectionCount = static_cast<uint32_t>(table.size());
+    header.fileSize = offset;
+    header.tableHash = Hash(table.data(), table.size() * sizeof(SectionRecord));
+
+    std::filesystem::path temp = path;
+    temp += ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+
+        static const char padding[SECTION_ALIGNMENT] = {};
+        size_t written = 0;
+        auto write = [&](const void* data, size_t size)
+        {
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            written += size;
+        };
+        auto pad = [&]() { write(padding, AlignUp(written, SECTION_ALIGNMENT) - written); };
+
+        write(&header, sizeof(header));
+        write(table.data(), table.size() * sizeof(SectionRecord));
+        for (const Section& section : m_sections)
+        {
+            pad();
+            write(section.data.data(), section.data.size());
+        }
+        pad();
+        out.flush();
+        if (!out)
+        {
+            out.close();
+            std::error_code ignored;
+            std::filesystem::remove(temp, ignored);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp, path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    if (bytes)
+        *bytes = offset;
+    return true;
+}
+
+bool SnapshotReader::Open(const std::filesystem::path& path)
+{
+    Close();
+
+    std::unique_ptr<MappedFile> file = MappedFile::Open(path.u8string());
+    if (!file || file->Size() < sizeof(FileHeader))
+        return false;
+
+    FileHeader header = ReadRecord<FileHeader>(file->Data(), 0);
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != SNAPSHOT_VERSION ||
+        header.fileSize != file->Size() || header.sectionCount > MAX_SECTIONS)
+        return false;
+
+    size_t tableSize = header.sectionCount * sizeof(SectionRecord);
+    const uint8_t* table = file->Data() + sizeof(FileHeader);
+    if (!InBounds(sizeof(FileHeader), tableSize, file->Size()) || Hash(table, tableSize) != header.tableHash)
+        return false;
+
+    std::vector<SectionView> sections;
+    for (uint32_t i = 0; i < header.sectionCount; ++i)
+    {
+        SectionRecord record = ReadRecord<SectionRecord>(table, i);
+        if (!InBounds(record.offset, record.size, file->Size()))
+            return false;
+        sections.push_back(SectionView{ static_cast<SnapshotSection>(record.kind), record.count,
+                                        file->Data() + record.offset, static_cast<size_t>(record.size), record.hash });
+    }
+
+    m_file = std::move(file);
+    m_sections.swap(sections);
+    return true;
+}
+
+void SnapshotReader::Close()
+{
+    m_sections.clear();
+    m_file.reset();
+}
+
+bool SnapshotReader::Has(SnapshotSection section) const
+{
+    for (const SectionView& view : m_sections)
+    {
+        if (view.kind == section)
+            return true;
+    }
+    return false;
+}
+
+const SnapshotReader::SectionView* SnapshotReader::Verified(SnapshotSection section) const
+{
+    for (const SectionView& view : m_sections)
+    {
+        if (view.kind == section)
+            return Hash(view.data, view.size) == view.hash ? &view : nullptr;
+    }
+    return nullptr;
+}
+
+bool SnapshotReader::ReadHandlers(std::vector<HandlerMapEntry>* entries) const
+{
+    const SectionView* view = Verified(SnapshotSection::Handlers);
+    if (!view || static_cast<uint64_t>(view->count) * sizeof(HandlerRecord) > view->size)
+        return false;
+
+    std::vector<HandlerMapEntry> read;
+    read.reserve(view->count);
+    for (uint32_t i = 0; i < view->count; ++i)
+    {
+        HandlerRecord record = ReadRecord<HandlerRecord>(view->data, i);
+        if (record.resolution != static_cast<uint32_t>(HandlerResolution::Found) &&
+            record.resolution != static_cast<uint32_t>(HandlerResolution::None))
+            return false;
+
+        HandlerMapEntry entry;
+        entry.extensionKey.assign(record.key, std::find(record.key, record.key + sizeof(record.key), '\0'));
+        entry.resolution = static_cast<HandlerResolution>(record.resolution);
+        memcpy(entry.clsid.bytes, record.clsid, sizeof(record.clsid));
+        read.push_back(std::move(entry));
+    }
+    entries->swap(read);
+    return true;
+}
+
+bool SnapshotReader::ReadImages(SnapshotSection section, SnapshotImages* images) const
+{
+    const SectionView* view = Verified(section);
+    if (!view || static_cast<uint64_t>(view->count) * sizeof(ImageRecord) > view->size)
+        return false;
+
+    SnapshotImages read;
+    read.reserve(view->count);
+    for (uint32_t i = 0; i < view->count; ++i)
+    {
+        ImageRecord record = ReadRecord<ImageRecord>(view->data, i);
+        if (record.width == 0 || record.height == 0 || record.width > MAX_IMAGE_SIDE || record.height > MAX_IMAGE_SIDE ||
+            record.alpha > static_cast<uint32_t>(AlphaMode::Premultiplied))
+            return false;
+
+        size_t rowBytes = static_cast<size_t>(record.width) * 4;
+        if (!InBounds(record.keyOffset, record.keyLength, view->size) ||
+            !InBounds(record.pixelOffset, static_cast<uint64_t>(rowBytes) * record.height, view->size))
+            return false;
+
+        std::shared_ptr<PixelImage> image = std::make_shared<PixelImage>();
+        if (!image->Allocate(record.width, record.height))
+            return false;
+        image->alpha = static_cast<AlphaMode>(record.alpha);
+        CopyPixelRows(view->data + record.pixelOffset, static_cast<ptrdiff_t>(rowBytes), image->Row(0), image->stride,
+                      record.width, record.height);
+
+        std::string key(reinterpret_cast<const char*>(view->data + record.keyOffset), record.keyLength);
+        read.emplace_back(std::move(key), std::move(image));
+    }
+    images->swap(read);
+    return true;
+}
+
+bool SnapshotReader::ReadSignatures(SnapshotSignatures* signatures) const
+{
+    const SectionView* view = Verified(SnapshotSection::Signatures);
+    if (!view || static_cast<uint64_t>(view->count) * sizeof(SignatureRecord) > view->size)
+        return false;
+
+    SnapshotSignatures read;
+    read.reserve(view->count);
+    for (uint32_t i = 0; i < view->count; ++i)
+    {
+        SignatureRecord record = ReadRecord<SignatureRecord>(view->data, i);
+        if (record.paletteCount > ImageSignature::MAX_PALETTE || !InBounds(record.keyOffset, record.keyLength, view->size))
+            return false;
+
+        ImageSignature signature;
+        signature.perceptualHash = record.perceptualHash;
+        signature.differenceHash = record.differenceHash;
+        signature.averageR = record.average[0];
+        signature.averageG = record.average[1];
+        signature.averageB = record.average[2];
+        signature.paletteCount = record.paletteCount;
+        for (uint32_t c = 0; c < record.paletteCount; ++c)
+        {
+            signature.palette[c].r = record.palette[c].color[0];
+            signature.palette[c].g = record.palette[c].color[1];
+            signature.palette[c].b = record.palette[c].color[2];
+            signature.palette[c].share = record.palette[c].share;
+        }
+
+        std::string key(reinterpret_cast<const char*>(view->data + record.keyOffset), record.keyLength);
+        read.emplace_back(std::move(key), signature);
+    }
+    signatures->swap(read);
+    return true;
+}
+
+bool SnapshotReader::ReadText(SnapshotSection section, std::string* text) const
+{
+    const SectionView* view = Verified(section);
+    if (!view)
+        return false;
+    text->assign(reinterpret_cast<const char*>(view->data), view->size);
+    return true;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "HandlerMap.h"
+#include "ImageSignature.h"
+#include "IpcPlatform.h"
+#include "SharedImageCache.h"
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Warm-start snapshot: the caches and learned statistics of one process, saved so the next one
+// does not start cold. One file holding a header, a section table and fixed-layout sections
+// aligned to 64 bytes, each with its own XXH64. Sections are read in place from a read-only
+// mapping, so restoring costs one copy per entry and no parsing. The writer renames a finished
+// temporary file into place, so readers never see a partial snapshot. Little-endian hosts.
+// No Windows dependencies.
+
+// Files from another version are ignored rather than converted
+const uint32_t SNAPSHOT_VERSION = 1;
+
+enum class SnapshotSection : uint32_t
+{
+    Handlers = 1,           // Extension -> preview handler (HandlerMap entries)
+    Icons = 2,              // Extension icons
+    Mips = 3,               // Small copies of thumbnails by file identity
+    Signatures = 4,         // Image signatures by file identity
+    ProviderStats = 5       // ProviderSelector::Serialize text
+};
+
+// Most recently used first, as SharedImageCache::Entries returns them
+typedef std::vector<std::pair<std::string, SharedImageCache::ImagePtr>> SnapshotImages;
+typedef std::vector<std::pair<std::string, ImageSignature>> SnapshotSignatures;
+
+class SnapshotWriter
+{
+public:
+    // A section kind added twice keeps the last one
+    void AddHandlers(const std::vector<HandlerMapEntry>& entries);
+    void AddImages(SnapshotSection section, const SnapshotImages& images);
+    void AddSignatures(const SnapshotSignatures& signatures);
+    void AddText(SnapshotSection section, const std::string& text);
+
+    // Writes path + ".tmp" and renames it over path. bytes (optional) receives the file size.
+    bool Save(const std::filesystem::path& path, uint64_t* bytes = nullptr) const;
+
+private:
+    struct Section
+    {
+        SnapshotSection kind;
+        uint32_t count;
+        std::vector<uint8_t> data;
+    };
+
+    Section& NewSection(SnapshotSection kind, uint32_t count);
+
+    std::vector<Section> m_sections;
+};
+
+class SnapshotReader
+{
+public:
+    // Maps the file and checks the header and section table. False if the file is missing,
+    // truncated, from another version or damaged.
+    bool Open(const std::filesystem::path& path);
+
+    // Unmaps the file; on Windows it cannot be replaced while mapped
+    void Close();
+
+    uint64_t Size() const { return m_file ? m_file->Size() : 0; }
+    bool Has(SnapshotSection section) const;
+
+    // Each checks its section's hash and bounds first and returns false (with nothing read)
+    // if the section is missing or damaged. Entries keep the order they were written in.
+    bool ReadHandlers(std::vector<HandlerMapEntry>* entries) const;
+    bool ReadImages(SnapshotSection section, SnapshotImages* images) const;
+    bool ReadSignatures(SnapshotSignatures* signatures) const;
+    bool ReadText(SnapshotSection section, std::string* text) const;
+
+private:
+    struct SectionView
+    {
+        SnapshotSection kind;
+        uint32_t count;
+        const uint8_t* data;
+        size_t size;
+        uint64_t hash;
+    };
+
+    // nullptr if missing or its hash does not match
+    const SectionView* Verified(SnapshotSection section) const;
+
+    std::unique_ptr<MappedFile> m_file;
+    std::vector<SectionView> m_sections;
+};
@@ -0,0 +1,207 @@
+#include "pch.h"
+#include "WatcherImpl.h"
+#include "CoalescingImpl.h"
+#include "FileWatcher.h"
+#include "ProgressiveImpl.h"
+#include "SchedulerImpl.h"
+#include "StoreImpl.h"
+#include "ShellContext.h"
+#include "TextUtils.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    // Editors typically write a file several times in a row; regenerate once it settles
+    const uint32_t SETTLE_MS = 500;
+    const UINT DEFAULT_REGENERATION_SIZE = 256;
+
+    struct WatchedRoot
+    {
+        int rootId;
+        DWORD flags;
+    };
+
+    std::mutex g_watchLock;
+    // Intentionally leaked unless StopWatching is called (same reason as the scheduler)
+    FileWatcher* g_watcher = nullptr;
+    std::map<std::string, WatchedRoot> g_roots;     // Keyed by MakePathKey of the directory
+    std::vector<UINT> g_regenerationSizes(1, DEFAULT_REGENERATION_SIZE);
+
+    std::atomic<ULONGLONG> g_changes{0};
+    std::atomic<ULONGLONG> g_invalidations{0};
+    std::atomic<ULONGLONG> g_regenerations{0};
+    std::atomic<ULONGLONG> g_overflows{0};
+
+    void CALLBACK DiscardRegenerated(ULONGLONG, HRESULT, HBITMAP hBitmap, void*)
+    {
+        // The point was to populate the caches; nobody is waiting for the bitmap
+        if (hBitmap)
+            DeleteObject(hBitmap);
+    }
+
+    // Temporary and system files churn constantly and are never browsed
+    bool IsWorthRegenerating(const std::wstring& path)
+    {
+        DWORD attributes = GetFileAttributesW(path.c_str());
+        if (attributes == INVALID_FILE_ATTRIBUTES)
+            return false;
+        return (attributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_TEMPORARY |
+                              FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM)) == 0;
+    }
+
+    // Runs on the watcher thread: no COM here, extraction is left to the scheduler's workers
+    void HandleChanges(const std::vector<FileChange>& changes)
+    {
+        std::map<int, DWORD> rootFlags;
+        std::vector<UINT> sizes;
+        {
+            std::lock_guard<std::mutex> lock(g_watchLock);
+            for (const std::pair<const std::string, WatchedRoot>& root : g_roots)
+                rootFlags[root.second.rootId] = root.second.flags;
+            sizes = g_regenerationSizes;
+        }
+
+        bool foldersChanged = false;
+        for (const FileChange& change : changes)
+        {
+            g_changes.fetch_add(1, std::memory_order_relaxed);
+
+            if (change.kind == FileChangeKind::Overflow)
+            {
+                g_overflows.fetch_add(1, std::memory_order_relaxed);
+                ClearThumbnailPlaceholders();
+                foldersChanged = true;
+                continue;
+            }
+
+            std::wstring path = Utf8ToWide(change.path);
+
+            // A removed entry may have been a directory; treat it as one to be safe
+            bool maybeDirectory = change.isDirectory || change.kind == FileChangeKind::Removed;
+            InvalidateThumbnailPlaceholders(path.c_str(), maybeDirectory);
+            ReleaseStoredImages(path.c_str(), maybeDirectory);
+            g_invalidations.fetch_add(1, std::memory_order_relaxed);
+
+            // Deleting files must not cost every thread its bound folders; only a directory
+            // some thread has bound (or a parent of one) makes them stale
+            if (maybeDirectory && !foldersChanged && ShellContext::IsFolderBound(path.c_str()))
+                foldersChanged = true;
+
+            std::map<int, DWORD>::const_iterator flags = rootFlags.find(change.rootId);
+            if (change.kind == FileChangeKind::Removed || change.isDirectory ||
+                flags == rootFlags.end() || !(flags->second & WSP_WATCH_REGENERATE) ||
+                !IsWorthRegenerating(path))
+            {
+                continue;
+            }
+
+            for (UINT size : sizes)
+            {
+                ULONGLONG requestId = 0;
+                if (SUCCEEDED(SubmitThumbnailRequestImpl(path.c_str(), size, WSP_PRIORITY_BACKGROUND,
+                                                         DiscardRegenerated, nullptr, &requestId)))
+                {
+                    g_regenerations.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        if (foldersChanged)
+            ShellContext::InvalidateAllThreads();
+    }
+}
+
+HRESULT WatchDirectoryImpl(LPCWSTR directory, DWORD flags)
+{
+    if (!directory || !*directory)
+        return E_INVALIDARG;
+    if (flags & ~(DWORD)(WSP_WATCH_RECURSIVE | WSP_WATCH_REGENERATE))
+        return E_INVALIDARG;
+
+    std::string key = MakePathKey(directory);
+
+    std::lock_guard<std::mutex> lock(g_watchLock);
+    std::map<std::string, WatchedRoot>::iterator existing = g_roots.find(key);
+    if (existing != g_roots.end())
+    {
+        // Recursion is fixed per watch; regeneration can be toggled in place
+        if ((existing->second.flags ^ flags) & WSP_WATCH_RECURSIVE)
+            return HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS);
+        existing->second.flags = flags;
+        return S_FALSE;
+    }
+
+    if (!g_watcher)
+    {
+        g_watcher = CreateFileWatcher(HandleChanges, SETTLE_MS).release();
+        if (!g_watcher)
+            return E_OUTOFMEMORY;
+    }
+
+    int rootId = g_watcher->AddRoot(WideToUtf8(directory), (flags & WSP_WATCH_RECURSIVE) != 0);
+    if (rootId == 0)
+        return HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND);
+
+    WatchedRoot root = { rootId, flags };
+    g_roots[key] = root;
+    return S_OK;
+}
+
+HRESULT UnwatchDirectoryImpl(LPCWSTR directory)
+{
+    if (!directory)
+        return E_INVALIDARG;
+
+    std::lock_guard<std::mutex> lock(g_watchLock);
+    std::map<std::string, WatchedRoot>::iterator found = g_roots.find(MakePathKey(directory));
+    if (found == g_roots.end())
+        return S_FALSE;
+
+    if (g_watcher)
+        g_watcher->RemoveRoot(found->second.rootId);
+    g_roots.erase(found);
+    return S_OK;
+}
+
+HRESULT SetWatchRegenerationSizesImpl(const UINT* sizes, UINT count)
+{
+    if (!sizes && count)
+        return E_INVALIDARG;
+
+    for (UINT i = 0; i < count; ++i)
+    {
+        if (sizes[i] == 0)
+            return E_INVALIDARG;
+    }
+
+    std::lock_guard<std::mutex> lock(g_watchLock);
+    g_regenerationSizes.assign(sizes, sizes + count);
+    return S_OK;
+}
+
+void StopWatchingImpl()
+{
+    FileWatcher* watcher = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_watchLock);
+        watcher = g_watcher;
+        g_watcher = nullptr;
+        g_roots.clear();
+    }
+
+    // The handler takes g_watchLock, so the watcher thread is joined without holding it
+    if (watcher)
+        watcher->Stop();
+    delete watcher;
+}
+
+void GetWatcherStatsImpl(WSP_WATCHER_STATS* pStats)
+{
+    pStats->changes = g_changes.load(std::memory_order_relaxed);
+    pStats->invalidations = g_invalidations.load(std::memory_order_relaxed);
+    pStats->regenerationsQueued = g_regenerations.load(std::memory_order_relaxed);
+    pStats->overflows = g_overflows.load(std::memory_order_relaxed);
+}
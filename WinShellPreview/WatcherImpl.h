@@ -0,0 +1,10 @@
+#pragma once
+#include "framework.h"
+#include "WinShellPreview.h"
+
+// Directory watching with cache invalidation and optional background regeneration
+HRESULT WatchDirectoryImpl(LPCWSTR directory, DWORD flags);
+HRESULT UnwatchDirectoryImpl(LPCWSTR directory);
+HRESULT SetWatchRegenerationSizesImpl(const UINT* sizes, UINT count);
+void StopWatchingImpl();
+void GetWatcherStatsImpl(WSP_WATCHER_STATS* pStats);
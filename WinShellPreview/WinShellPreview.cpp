@@ -4,21 +4,45 @@
 #include "PreviewImpl.h"
 #include "IconImpl.h"
 #include "BitmapUtils.h"
+#include "BufferPool.h"
+#include "ShellContext.h"
+#include "SchedulerImpl.h"
+#include "CoalescingImpl.h"
+#include "ProgressiveImpl.h"
+#include "WatcherImpl.h"
+#include "PregeneratorImpl.h"
+#include "AtlasImpl.h"
+#include "SignatureImpl.h"
+#include "StoreImpl.h"
+#include "PagedPreviewImpl.h"
+#include "VideoStripImpl.h"
+#include "ShellProviders.h"
+#include "IsolationImpl.h"
+#include "RingImpl.h"
+#include "PixelsImpl.h"
+#include "PyramidImpl.h"
+#include "EncodeImpl.h"
+#include "PathsImpl.h"
+#include "HandlersImpl.h"
+#include "SnapshotImpl.h"
 
 extern "C" {
 
 WINSHELLPREVIEW_API HRESULT GetFileThumbnail(LPCWSTR filePath, UINT size, HBITMAP* phBitmap)
 {
+    ForegroundRequestScope foreground;
     return GetFileThumbnailImpl(filePath, size, phBitmap);
 }
 
 WINSHELLPREVIEW_API HRESULT GetFilePreview(LPCWSTR filePath, UINT width, UINT height, HBITMAP* phBitmap)
 {
+    ForegroundRequestScope foreground;
     return GetFilePreviewImpl(filePath, width, height, phBitmap);
 }
 
 WINSHELLPREVIEW_API HRESULT GetFileIcon(LPCWSTR filePath, UINT size, HBITMAP* phBitmap)
 {
+    ForegroundRequestScope foreground;
     return GetFileIconImpl(filePath, size, phBitmap);
 }
 
@@ -35,5 +59,377 @@ WINSHELLPREVIEW_API void ReleasePreviewBitmap(HBITMAP hBitmap)
     }
 }
 
+WINSHELLPREVIEW_API HRESULT GetBufferPoolStats(WSP_BUFFER_POOL_STATS* pStats)
+{
+    if (!pStats)
+        return E_INVALIDARG;
+
+    BufferPoolStats stats = BufferPool::GetStats();
+    pStats->acquireCount = stats.acquireCount;
+    pStats->reuseCount = stats.reuseCount;
+    pStats->systemAllocCount = stats.systemAllocCount;
+    pStats->systemFreeCount = stats.systemFreeCount;
+    pStats->bytesInUse = stats.bytesInUse;
+    pStats->peakBytesInUse = stats.peakBytesInUse;
+    pStats->bytesCached = stats.bytesCached;
+    pStats->arenaPeakBytes = stats.arenaPeakBytes;
+    return S_OK;
+}
+
+WINSHELLPREVIEW_API HRESULT GetShellContextStats(WSP_SHELL_CONTEXT_STATS* pStats)
+{
+    if (!pStats)
+        return E_INVALIDARG;
+
+    ShellContextStats stats = ShellContext::GetStats();
+    pStats->thumbnailCacheCreated = stats.thumbnailCacheCreated;
+    pStats->thumbnailCacheReused = stats.thumbnailCacheReused;
+    pStats->desktopFolderCreated = stats.desktopFolderCreated;
+    pStats->desktopFolderReused = stats.desktopFolderReused;
+    pStats->folderHits = stats.folderHits;
+    pStats->folderMisses = stats.folderMisses;
+    pStats->folderEvictions = stats.folderEvictions;
+    return S_OK;
+}
+
+WINSHELLPREVIEW_API void ReleaseShellContext()
+{
+    ShellContext::ReleaseCurrentThread();
+}
+
+WINSHELLPREVIEW_API HRESULT SubmitThumbnailRequest(LPCWSTR filePath, UINT size, WSP_PRIORITY priority, WSP_THUMBNAIL_CALLBACK callback, void* context, ULONGLONG* pRequestId)
+{
+    // Interactive submissions hold off background generation for a while
+    if (priority != WSP_PRIORITY_BACKGROUND)
+        NoteForegroundActivity();
+    return SubmitThumbnailRequestImpl(filePath, size, priority, callback, context, pRequestId);
+}
+
+WINSHELLPREVIEW_API HRESULT SetVisibleThumbnailRequests(const ULONGLONG* requestIds, UINT count)
+{
+    return SetVisibleThumbnailRequestsImpl(requestIds, count);
+}
+
+WINSHELLPREVIEW_API HRESULT CancelThumbnailRequest(ULONGLONG requestId)
+{
+    return CancelThumbnailRequestImpl(requestId);
+}
+
+WINSHELLPREVIEW_API void ShutdownThumbnailScheduler()
+{
+    ShutdownThumbnailSchedulerImpl();
+}
+
+WINSHELLPREVIEW_API HRESULT GetCoalescingStats(WSP_COALESCING_STATS* pStats)
+{
+    if (!pStats)
+        return E_INVALIDARG;
+
+    RequestCoalescerStats stats = GetCoalescingStatsImpl();
+    pStats->leaders = stats.leaders;
+    pStats->exactFollowers = stats.exactFollowers;
+    pStats->largerFollowers = stats.largerFollowers;
+    return S_OK;
+}
+
+struct ProgressForward
+{
+    WSP_PROGRESS_CALLBACK callback;
+    void* context;
+};
+
+static bool ForwardProgress(HRESULT hr, HBITMAP hBitmap, ResultQuality quality, bool isFinal, void* context)
+{
+    ProgressForward* forward = static_cast<ProgressForward*>(context);
+    return forward->callback(hr, hBitmap, static_cast<WSP_QUALITY>(quality), isFinal ? TRUE : FALSE, forward->context) != FALSE;
+}
+
+WINSHELLPREVIEW_API HRESULT GetFileThumbnailProgressive(LPCWSTR filePath, UINT size, WSP_PROGRESS_CALLBACK callback, void* context)
+{
+    if (!callback)
+        return E_INVALIDARG;
+
+    ProgressForward forward = { callback, context };
+    ForegroundRequestScope foreground;
+    return GetFileThumbnailProgressiveImpl(filePath, size, ForwardProgress, &forward);
+}
+
+WINSHELLPREVIEW_API HRESULT WatchDirectory(LPCWSTR directory, DWORD flags)
+{
+    return WatchDirectoryImpl(directory, flags);
+}
+
+WINSHELLPREVIEW_API HRESULT UnwatchDirectory(LPCWSTR directory)
+{
+    return UnwatchDirectoryImpl(directory);
+}
+
+WINSHELLPREVIEW_API HRESULT SetWatchRegenerationSizes(const UINT* sizes, UINT count)
+{
+    return SetWatchRegenerationSizesImpl(sizes, count);
+}
+
+WINSHELLPREVIEW_API void StopWatching()
+{
+    StopWatchingImpl();
+}
+
+WINSHELLPREVIEW_API HRESULT GetWatcherStats(WSP_WATCHER_STATS* pStats)
+{
+    if (!pStats)
+        return E_INVALIDARG;
+
+    GetWatcherStatsImpl(pStats);
+    return S_OK;
+}
+
+WINSHELLPREVIEW_API HRESULT StartPregeneration(const WSP_PREGENERATION_OPTIONS* pOptions)
+{
+    return StartPregenerationImpl(pOptions);
+}
+
+WINSHELLPREVIEW_API void StopPregeneration()
+{
+    StopPregenerationImpl();
+}
+
+WINSHELLPREVIEW_API HRESULT GetPregenerationStats(WSP_PREGENERATION_STATS* pStats)
+{
+    if (!pStats)
+        return E_INVALIDARG;
+
+    GetPregenerationStatsImpl(pStats);
+    return S_OK;
+}
+
+WINSHELLPREVIEW_API HRESULT CreateThumbnailAtlas(UINT pageWidth, UINT pageHeight, UINT padding, WSP_ATLAS* phAtlas)
+{
+    return CreateThumbnailAtlasImpl(pageWidth, pageHeight, padding, phAtlas);
+}
+
+WINSHELLPREVIEW_API HRESULT OpenThumbnailAtlas(LPCWSTR basePath, WSP_ATLAS* phAtlas)
+{
+    return OpenThumbnailAtlasImpl(basePath, phAtlas);
+}
+
+WINSHELLPREVIEW_API HRESULT AddFileToAtlas(WSP_ATLAS hAtlas, LPCWSTR filePath, UINT size, WSP_ATLAS_RECT* pRect)
+{
+    return AddFileToAtlasImpl(hAtlas, filePath, size, pRect);
+}
+
+WINSHELLPREVIEW_API HRESULT AddBitmapToAtlas(WSP_ATLAS hAtlas, LPCWSTR id, HBITMAP hBitmap, WSP_ATLAS_RECT* pRect)
+{
+    return AddBitmapToAtlasImpl(hAtlas, id, hBitmap, pRect);
+}
+
+WINSHELLPREVIEW_API HRESULT SaveThumbnailAtlas(WSP_ATLAS hAtlas, LPCWSTR basePath)
+{
+    return SaveThumbnailAtlasImpl(hAtlas, basePath);
+}
+
+WINSHELLPREVIEW_API void CloseThumbnailAtlas(WSP_ATLAS hAtlas)
+{
+    CloseThumbnailAtlasImpl(hAtlas);
+}
+
+WINSHELLPREVIEW_API HRESULT GetFileThumbnailWithSignature(LPCWSTR filePath, UINT size, HBITMAP* phBitmap, WSP_IMAGE_SIGNATURE* pSignature)
+{
+    ForegroundRequestScope foreground;
+    return GetFileThumbnailWithSignatureImpl(filePath, size, phBitmap, pSignature);
+}
+
+WINSHELLPREVIEW_API HRESULT GetBitmapSignature(HBITMAP hBitmap, WSP_IMAGE_SIGNATURE* pSignature)
+{
+    return GetBitmapSignatureImpl(hBitmap, pSignature);
+}
+
+WINSHELLPREVIEW_API HRESULT GetCachedFileSignature(LPCWSTR filePath, WSP_IMAGE_SIGNATURE* pSignature)
+{
+    return GetCachedFileSignatureImpl(filePath, pSignature);
+}
+
+WINSHELLPREVIEW_API HRESULT OpenThumbnailStore(LPCWSTR directory)
+{
+    return OpenThumbnailStoreImpl(directory);
+}
+
+WINSHELLPREVIEW_API void CloseThumbnailStore()
+{
+    CloseThumbnailStoreImpl();
+}
+
+WINSHELLPREVIEW_API HRESULT StoreFileImage(LPCWSTR filePath, UINT size, WSP_STORE_SOURCE source, LPWSTR objectPath, UINT objectPathLength)
+{
+    ForegroundRequestScope foreground;
+    return StoreFileImageImpl(filePath, size, source, objectPath, objectPathLength);
 }
 
+WINSHELLPREVIEW_API HRESULT CollectThumbnailStoreGarbage(ULONGLONG* pBytesFreed)
+{
+    return CollectThumbnailStoreGarbageImpl(pBytesFreed);
+}
+
+WINSHELLPREVIEW_API HRESULT GetThumbnailStoreStats(WSP_STORE_STATS* pStats)
+{
+    return GetThumbnailStoreStatsImpl(pStats);
+}
+
+WINSHELLPREVIEW_API HRESULT GetFilePreviewPages(LPCWSTR filePath, UINT width, UINT height, UINT firstPage, UINT pageCount,
+                                                LPCWSTR outputBasePath, WSP_PAGE_CALLBACK callback, void* context, UINT* pPagesDelivered)
+{
+    ForegroundRequestScope foreground;
+    return GetFilePreviewPagesImpl(filePath, width, height, firstPage, pageCount, outputBasePath, callback, context, pPagesDelivered);
+}
+
+WINSHELLPREVIEW_API HRESULT GetFileFrameStrip(LPCWSTR filePath, const WSP_FRAME_STRIP_OPTIONS* pOptions, HBITMAP* phStrip)
+{
+    ForegroundRequestScope foreground;
+    return GetFileFrameStripImpl(filePath, pOptions, phStrip);
+}
+
+WINSHELLPREVIEW_API HRESULT SetImageProviderEnabled(LPCWSTR providerName, BOOL enabled)
+{
+    return SetImageProviderEnabledImpl(providerName, enabled);
+}
+
+WINSHELLPREVIEW_API HRESULT GetImageProviderStats(LPCWSTR extension, WSP_PROVIDER_STATS* pStats, UINT capacity, UINT* pCount)
+{
+    return GetImageProviderStatsImpl(extension, pStats, capacity, pCount);
+}
+
+WINSHELLPREVIEW_API HRESULT SetImageProviderStatsFile(LPCWSTR statsPath)
+{
+    return SetImageProviderStatsFileImpl(statsPath);
+}
+
+WINSHELLPREVIEW_API HRESULT EnableHandlerIsolation(const WSP_ISOLATION_OPTIONS* pOptions)
+{
+    return EnableHandlerIsolationImpl(pOptions);
+}
+
+WINSHELLPREVIEW_API HRESULT GetIsolationStats(WSP_ISOLATION_STATS* pStats)
+{
+    return GetIsolationStatsImpl(pStats);
+}
+
+WINSHELLPREVIEW_API HRESULT CreateFrameRing(LPCWSTR name, UINT slotCount, UINT slotBytes, WSP_FRAME_RING* phRing)
+{
+    return CreateFrameRingImpl(name, slotCount, slotBytes, phRing);
+}
+
+WINSHELLPREVIEW_API HRESULT OpenFrameRing(LPCWSTR name, WSP_FRAME_RING* phRing)
+{
+    return OpenFrameRingImpl(name, phRing);
+}
+
+WINSHELLPREVIEW_API HRESULT WriteBitmapToFrameRing(WSP_FRAME_RING hRing, HBITMAP hBitmap, UINT timeoutMs, ULONGLONG* pSequence)
+{
+    return WriteBitmapToFrameRingImpl(hRing, hBitmap, timeoutMs, pSequence);
+}
+
+WINSHELLPREVIEW_API HRESULT WriteFileThumbnailToFrameRing(WSP_FRAME_RING hRing, LPCWSTR filePath, UINT size, UINT timeoutMs, ULONGLONG* pSequence)
+{
+    ForegroundRequestScope foreground;
+    return WriteFileThumbnailToFrameRingImpl(hRing, filePath, size, timeoutMs, pSequence);
+}
+
+WINSHELLPREVIEW_API HRESULT AcquireRingFrame(WSP_FRAME_RING hRing, UINT timeoutMs, WSP_RING_FRAME* pFrame)
+{
+    return AcquireRingFrameImpl(hRing, timeoutMs, pFrame);
+}
+
+WINSHELLPREVIEW_API HRESULT ReleaseRingFrame(WSP_FRAME_RING hRing)
+{
+    return ReleaseRingFrameImpl(hRing);
+}
+
+WINSHELLPREVIEW_API HRESULT GetFrameRingStats(WSP_FRAME_RING hRing, WSP_FRAME_RING_STATS* pStats)
+{
+    return GetFrameRingStatsImpl(hRing, pStats);
+}
+
+WINSHELLPREVIEW_API void CloseFrameRing(WSP_FRAME_RING hRing)
+{
+    CloseFrameRingImpl(hRing);
+}
+
+WINSHELLPREVIEW_API HRESULT GetFileThumbnailPixels(LPCWSTR filePath, UINT size, WSP_PIXELS* pPixels)
+{
+    ForegroundRequestScope foreground;
+    return GetFileThumbnailPixelsImpl(filePath, size, pPixels);
+}
+
+WINSHELLPREVIEW_API HRESULT GetFileThumbnailPixelsInto(LPCWSTR filePath, UINT size, BYTE* buffer, UINT bufferSize, UINT stride, WSP_PIXELS* pPixels)
+{
+    ForegroundRequestScope foreground;
+    return GetFileThumbnailPixelsIntoImpl(filePath, size, buffer, bufferSize, stride, pPixels);
+}
+
+WINSHELLPREVIEW_API HRESULT ReleaseThumbnailPixels(const BYTE* pixels)
+{
+    return ReleaseThumbnailPixelsImpl(pixels);
+}
+
+WINSHELLPREVIEW_API HRESULT SetThumbnailBackground(const COLORREF* pColor)
+{
+    return SetThumbnailBackgroundImpl(pColor);
+}
+
+WINSHELLPREVIEW_API HRESULT SaveFilePreviewAsPng(LPCWSTR filePath, UINT width, UINT height, LPCWSTR outputPath)
+{
+    ForegroundRequestScope foreground;
+    return SaveFilePreviewAsPngImpl(filePath, width, height, outputPath);
+}
+
+WINSHELLPREVIEW_API HRESULT BuildFilePreviewPyramid(LPCWSTR filePath, UINT width, UINT height, LPCWSTR outputPath,
+                                                    const WSP_PYRAMID_OPTIONS* pOptions, WSP_PYRAMID_STATS* pStats)
+{
+    ForegroundRequestScope foreground;
+    return BuildFilePreviewPyramidImpl(filePath, width, height, outputPath, pOptions, pStats);
+}
+
+WINSHELLPREVIEW_API HRESULT SaveBitmapToFileAsync(HBITMAP hBitmap, LPCWSTR outputPath, WSP_SAVE_CALLBACK callback, void* context)
+{
+    return SaveBitmapToFileAsyncImpl(hBitmap, outputPath, callback, context);
+}
+
+WINSHELLPREVIEW_API HRESULT WaitForPendingSaves(UINT timeoutMs)
+{
+    return WaitForPendingSavesImpl(timeoutMs);
+}
+
+WINSHELLPREVIEW_API HRESULT GetEncodePipelineStats(WSP_ENCODE_PIPELINE_STATS* pStats)
+{
+    return GetEncodePipelineStatsImpl(pStats);
+}
+
+WINSHELLPREVIEW_API HRESULT GetPathTableStats(WSP_PATH_TABLE_STATS* pStats)
+{
+    return GetPathTableStatsImpl(pStats);
+}
+
+WINSHELLPREVIEW_API HRESULT PreloadPreviewHandlers(UINT timeoutMs)
+{
+    return PreloadPreviewHandlersImpl(timeoutMs);
+}
+
+WINSHELLPREVIEW_API HRESULT GetPreviewHandlerCacheStats(WSP_HANDLER_CACHE_STATS* pStats)
+{
+    return GetPreviewHandlerCacheStatsImpl(pStats);
+}
+
+WINSHELLPREVIEW_API HRESULT SetWarmStartFile(LPCWSTR snapshotPath)
+{
+    return SetWarmStartFileImpl(snapshotPath);
+}
+
+WINSHELLPREVIEW_API HRESULT SaveWarmStartSnapshot()
+{
+    return SaveWarmStartSnapshotImpl();
+}
+
+WINSHELLPREVIEW_API HRESULT GetWarmStartStats(WSP_WARM_START_STATS* pStats)
+{
+    return GetWarmStartStatsImpl(pStats);
+}
+}
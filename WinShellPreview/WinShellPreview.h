@@ -6,10 +6,444 @@
 #define WINSHELLPREVIEW_API __declspec(dllimport)
 #endif
 
+// Buffer pool statistics (see GetBufferPoolStats)
+typedef struct WSP_BUFFER_POOL_STATS
+{
+    ULONGLONG acquireCount;
+    ULONGLONG reuseCount;
+    ULONGLONG systemAllocCount;
+    ULONGLONG systemFreeCount;
+    ULONGLONG bytesInUse;
+    ULONGLONG peakBytesInUse;
+    ULONGLONG bytesCached;
+    ULONGLONG arenaPeakBytes;
+} WSP_BUFFER_POOL_STATS;
+
+// Per-thread Shell object reuse counters (see GetShellContextStats)
+typedef struct WSP_SHELL_CONTEXT_STATS
+{
+    ULONGLONG thumbnailCacheCreated;
+    ULONGLONG thumbnailCacheReused;
+    ULONGLONG desktopFolderCreated;
+    ULONGLONG desktopFolderReused;
+    ULONGLONG folderHits;
+    ULONGLONG folderMisses;
+    ULONGLONG folderEvictions;
+} WSP_SHELL_CONTEXT_STATS;
+
+// Request coalescing counters (see GetCoalescingStats)
+typedef struct WSP_COALESCING_STATS
+{
+    ULONGLONG leaders;          // Extractions actually run
+    ULONGLONG exactFollowers;   // Requests served by an identical in-flight request
+    ULONGLONG largerFollowers;  // Requests served by downscaling a larger in-flight request
+} WSP_COALESCING_STATS;
+
+// Priority classes for scheduled thumbnail requests
+typedef enum WSP_PRIORITY
+{
+    WSP_PRIORITY_VISIBLE = 0,
+    WSP_PRIORITY_NORMAL = 1,
+    WSP_PRIORITY_BACKGROUND = 2
+} WSP_PRIORITY;
+
+// Completion callback for SubmitThumbnailRequest. Runs on a worker thread.
+// hBitmap belongs to the callee and must be released with ReleasePreviewBitmap.
+typedef void (CALLBACK* WSP_THUMBNAIL_CALLBACK)(ULONGLONG requestId, HRESULT hr, HBITMAP hBitmap, void* context);
+
+// Result quality reported by GetFileThumbnailProgressive
+typedef enum WSP_QUALITY
+{
+    WSP_QUALITY_PLACEHOLDER = 0,    // File type icon or a cached low-resolution copy
+    WSP_QUALITY_CACHED = 1,         // Shell thumbnail cache hit
+    WSP_QUALITY_FULL = 2            // Freshly extracted
+} WSP_QUALITY;
+
+// Progress callback for GetFileThumbnailProgressive. Runs on the calling thread.
+// hBitmap (may be NULL on the final call if extraction failed) must be released with ReleasePreviewBitmap.
+// Return FALSE to skip the remaining stages.
+typedef BOOL (CALLBACK* WSP_PROGRESS_CALLBACK)(HRESULT hr, HBITMAP hBitmap, WSP_QUALITY quality, BOOL isFinal, void* context);
+
+// Page callback for GetFilePreviewPages. Runs on the calling thread while the next page renders.
+// page is zero-based; savedPath is NULL unless an output path was given.
+// hBitmap must be released with ReleasePreviewBitmap. Return FALSE to stop.
+typedef BOOL (CALLBACK* WSP_PAGE_CALLBACK)(UINT page, HBITMAP hBitmap, LPCWSTR savedPath, void* context);
+
+// Flags for WatchDirectory
+typedef enum WSP_WATCH_FLAGS
+{
+    WSP_WATCH_RECURSIVE = 0x1,      // Include subdirectories
+    WSP_WATCH_REGENERATE = 0x2      // Queue background thumbnail regeneration for changed files
+} WSP_WATCH_FLAGS;
+
+// Directory watcher counters (see GetWatcherStats)
+typedef struct WSP_WATCHER_STATS
+{
+    ULONGLONG changes;              // Settled change notifications handled
+    ULONGLONG invalidations;        // Cache invalidations performed
+    ULONGLONG regenerationsQueued;  // Background thumbnail requests submitted
+    ULONGLONG overflows;            // Times notifications were lost and all caches were dropped
+} WSP_WATCHER_STATS;
+
+// Options for StartPregeneration
+typedef struct WSP_PREGENERATION_OPTIONS
+{
+    const LPCWSTR* roots;       // Directories to walk (recursively)
+    UINT rootCount;
+    const UINT* sizes;          // Thumbnail sizes to generate for each file
+    UINT sizeCount;
+    LPCWSTR extensions;         // e.g. L".jpg;.png;.mp4", NULL for all files
+    LPCWSTR checkpointPath;     // Progress file for resuming, NULL to disable
+} WSP_PREGENERATION_OPTIONS;
+
+// Background pre-generation counters (see GetPregenerationStats)
+typedef struct WSP_PREGENERATION_STATS
+{
+    ULONGLONG filesVisited;
+    ULONGLONG thumbnailsGenerated;
+    ULONGLONG alreadyCached;    // Sizes skipped because the thumbnail cache already had them
+    ULONGLONG failures;
+    ULONGLONG throttledMs;      // Time spent waiting for CPU, disk or interactive requests
+    BOOL running;
+} WSP_PREGENERATION_STATS;
+
+#define WSP_MAX_PALETTE 8
+
+// Perceptual signatures computed together with a thumbnail (see GetFileThumbnailWithSignature)
+typedef struct WSP_IMAGE_SIGNATURE
+{
+    ULONGLONG perceptualHash;           // pHash (DCT); a Hamming distance of 10 or less means similar images
+    ULONGLONG differenceHash;           // dHash (horizontal gradients)
+    COLORREF averageColor;              // Mean color composited on white, usable as a flat placeholder
+    UINT paletteCount;                  // 0 for a fully transparent image
+    COLORREF palette[WSP_MAX_PALETTE];  // Dominant colors (median cut), most common first
+    UINT paletteShare[WSP_MAX_PALETTE]; // Fraction of opaque pixels, 65536 = all
+} WSP_IMAGE_SIGNATURE;
+
+// What StoreFileImage extracts
+typedef enum WSP_STORE_SOURCE
+{
+    WSP_STORE_THUMBNAIL = 0,
+    WSP_STORE_ICON = 1
+} WSP_STORE_SOURCE;
+
+// Content-addressed thumbnail store counters (see GetThumbnailStoreStats)
+typedef struct WSP_STORE_STATS
+{
+    ULONGLONG refs;             // File images currently stored
+    ULONGLONG objects;          // Distinct image files on disk
+    ULONGLONG storedBytes;      // Disk used by the image files
+    ULONGLONG logicalBytes;     // Disk one file per image would use
+    ULONGLONG encodesSkipped;   // Images that were already stored for another file
+    ULONGLONG garbageObjects;   // Unreferenced images until CollectThumbnailStoreGarbage
+} WSP_STORE_STATS;
+
+// Options for GetFileFrameStrip
+typedef struct WSP_FRAME_STRIP_OPTIONS
+{
+    UINT frameCount;                    // Frames to extract (or entries in timestampsMs)
+    UINT frameWidth;                    // Cell size; frames keep their aspect ratio inside it
+    UINT frameHeight;
+    UINT columns;                       // Cells per row, 0 = a single row
+    UINT spacing;                       // Pixels between cells
+    const ULONGLONG* timestampsMs;      // Optional frame times; NULL = even intervals over the duration
+    LPCWSTR gifPath;                    // Optional animated GIF of the same frames
+    UINT gifDelayMs;                    // Per GIF frame, 0 = 500 ms
+} WSP_FRAME_STRIP_OPTIONS;
+
+// Image provider capabilities (see GetImageProviderStats)
+typedef enum WSP_PROVIDER_CAPS
+{
+    WSP_PROVIDER_THUMBNAIL = 0x1,       // Square thumbnails
+    WSP_PROVIDER_RECTANGULAR = 0x2,     // Separate width and height
+    WSP_PROVIDER_ALPHA = 0x4,           // Can return transparency
+    WSP_PROVIDER_CACHE_ONLY = 0x8,      // Looks up cached results, never extracts
+    WSP_PROVIDER_NEEDS_STA = 0x10,      // Only used on STA threads
+    WSP_PROVIDER_ICON_FALLBACK = 0x20   // May return a generic icon
+} WSP_PROVIDER_CAPS;
+
+#define WSP_PROVIDER_NAME_LENGTH 32
+
+// One image provider and its record, for one extension or all of them
+typedef struct WSP_PROVIDER_STATS
+{
+    WCHAR name[WSP_PROVIDER_NAME_LENGTH];
+    UINT capabilities;                  // WSP_PROVIDER_CAPS
+    BOOL enabled;
+    ULONGLONG attempts;
+    ULONGLONG successes;
+    ULONGLONG skipped;                  // Requests that left the provider out after repeated failures
+    double meanLatencyMs;               // Recent attempts, successful or not
+    double expectedCostMs;              // Latency per successful image; providers run cheapest first
+} WSP_PROVIDER_STATS;
+
+// Options for EnableHandlerIsolation (0 = default for every field)
+typedef struct WSP_ISOLATION_OPTIONS
+{
+    UINT workerCount;           // Worker processes, default 2
+    UINT timeoutMs;             // Per request before the worker is killed, default 15000
+    UINT quarantineFailures;    // Consecutive crashes/timeouts before a file type is refused, default 3
+    UINT quarantineMs;          // How long a file type stays refused, default 10 minutes
+    UINT maxImageBytes;         // Shared image area per worker, default 32 MB
+} WSP_ISOLATION_OPTIONS;
+
+// Handler isolation statistics (see GetIsolationStats)
+typedef struct WSP_ISOLATION_STATS
+{
+    BOOL enabled;
+    ULONGLONG requests;
+    ULONGLONG completed;            // Handler returned (successfully or not)
+    ULONGLONG crashes;              // Worker died during a request
+    ULONGLONG timeouts;             // Worker killed at the request deadline
+    ULONGLONG hangsDetected;        // Idle workers restarted for a missing heartbeat
+    ULONGLONG workersStarted;
+    ULONGLONG quarantinedRequests;  // Refused without running a handler
+    UINT quarantinedFileTypes;
+    UINT liveWorkers;
+} WSP_ISOLATION_STATS;
+
+// Shared-memory frame ring handle (see CreateFrameRing)
+typedef struct WSP_FRAME_RING_T* WSP_FRAME_RING;
+
+// Meaning of the alpha byte in 32bpp BGRA pixels
+typedef enum WSP_ALPHA_MODE
+{
+    WSP_ALPHA_IGNORE = 0,               // Opaque; alpha is 255
+    WSP_ALPHA_STRAIGHT = 1,
+    WSP_ALPHA_PREMULTIPLIED = 2
+} WSP_ALPHA_MODE;
+
+// A frame mapped from a ring; valid until ReleaseRingFrame
+typedef struct WSP_RING_FRAME
+{
+    const BYTE* pixels;                 // Top-down BGRA
+    UINT width;
+    UINT height;
+    UINT stride;                        // Bytes per row
+    WSP_ALPHA_MODE alpha;
+    ULONGLONG sequence;                 // Frame number, starting at 0
+} WSP_RING_FRAME;
+
+typedef struct WSP_FRAME_RING_STATS
+{
+    ULONGLONG published;
+    ULONGLONG backpressureWaits;        // Writes that found every slot in use
+    ULONGLONG timeouts;                 // ...and gave up
+    ULONGLONG oversized;                // Frames larger than a slot
+    UINT pending;                       // Published frames the reader has not released
+} WSP_FRAME_RING_STATS;
+
+typedef enum WSP_PIXEL_FORMAT
+{
+    WSP_PIXEL_BGRA32 = 0                // 8 bits per channel, B G R A in memory, rows top-down
+} WSP_PIXEL_FORMAT;
+
+// Raw thumbnail pixels (see GetFileThumbnailPixels)
+typedef struct WSP_PIXELS
+{
+    BYTE* pixels;
+    UINT width;
+    UINT height;
+    UINT stride;                        // Bytes per row
+    WSP_PIXEL_FORMAT format;
+    WSP_ALPHA_MODE alpha;               // From the handler's WTS_ALPHATYPE where it reports one
+} WSP_PIXELS;
+
+// Tile callback for BuildFilePreviewPyramid, called as each tile is written (largest level
+// first, level 0 is 1x1). Runs on an encoder thread, one call at a time. Return FALSE to stop.
+typedef BOOL (CALLBACK* WSP_TILE_CALLBACK)(UINT level, UINT column, UINT row, void* context);
+
+// Flags for WSP_PYRAMID_OPTIONS
+typedef enum WSP_PYRAMID_FLAGS
+{
+    WSP_PYRAMID_PACK = 0x1          // One pack file with an index instead of a .dzi and its _files directory
+} WSP_PYRAMID_FLAGS;
+
+// Options for BuildFilePreviewPyramid (NULL = 256px tiles, 1px overlap, DZI directory)
+typedef struct WSP_PYRAMID_OPTIONS
+{
+    UINT tileSize;                  // 0 = 256
+    UINT overlap;                   // Pixels shared with neighbouring tiles
+    UINT flags;                     // WSP_PYRAMID_FLAGS
+    WSP_TILE_CALLBACK callback;     // Optional
+    void* context;
+} WSP_PYRAMID_OPTIONS;
+
+typedef struct WSP_PYRAMID_STATS
+{
+    UINT levels;
+    ULONGLONG tiles;
+    ULONGLONG encodedBytes;
+    ULONGLONG downsampleMs;
+} WSP_PYRAMID_STATS;
+
+// Completion callback for SaveBitmapToFileAsync. Runs on an encoder thread.
+typedef void (CALLBACK* WSP_SAVE_CALLBACK)(HRESULT hr, LPCWSTR outputPath, void* context);
+
+typedef struct WSP_ENCODE_PIPELINE_STATS
+{
+    ULONGLONG jobsSubmitted;
+    ULONGLONG jobsCompleted;
+    ULONGLONG jobsFailed;
+    ULONGLONG jobsInFlight;
+    ULONGLONG bytesWritten;
+    ULONGLONG producerStallMs;      // Callers blocked because the encode queue was full
+    UINT encodeThreads;
+    ULONGLONG encodeBusyMs;         // Summed over encoder threads
+    ULONGLONG elapsedMs;
+    UINT encodeUtilization;         // 65536 = every encoder thread busy the whole time
+    ULONGLONG queueHighWater;
+    ULONGLONG stolen;               // Tasks taken from another encoder thread
+} WSP_ENCODE_PIPELINE_STATS;
+
+typedef struct WSP_PATH_TABLE_STATS
+{
+    ULONGLONG lookups;
+    ULONGLONG hits;                 // Path already had a live record
+    ULONGLONG created;              // Records built, including parent directories
+    ULONGLONG live;                 // Records currently held by a cache or request
+} WSP_PATH_TABLE_STATS;
+
+typedef struct WSP_HANDLER_CACHE_STATS
+{
+    ULONGLONG lookups;
+    ULONGLONG hits;                 // Answered without the registry, including negative entries
+    ULONGLONG negativeHits;         // Extensions known to have no preview handler
+    ULONGLONG resolved;             // Registry lookups (misses, preload and refresh)
+    ULONGLONG failures;             // Registry lookups that failed (not cached)
+    ULONGLONG uncached;             // Extensions too long for the cache, or cache full
+    ULONGLONG preloaded;            // Entries written ahead of use
+    ULONGLONG invalidations;        // Association changes seen
+    ULONGLONG entries;
+    ULONGLONG negativeEntries;
+} WSP_HANDLER_CACHE_STATS;
+
+typedef struct WSP_WARM_START_STATS
+{
+    ULONGLONG restoreUs;            // Reading the snapshot and filling the caches
+    ULONGLONG restoredBytes;
+    ULONGLONG restoredHandlers;
+    ULONGLONG restoredIcons;
+    ULONGLONG restoredMips;         // Small copies of thumbnails (progressive placeholders)
+    ULONGLONG restoredSignatures;
+    BOOL providerStatsRestored;
+    ULONGLONG saves;
+    ULONGLONG saveFailures;
+    ULONGLONG lastSaveUs;
+    ULONGLONG lastSaveBytes;
+} WSP_WARM_START_STATS;
+
+// Thumbnail atlas handle (see CreateThumbnailAtlas)
+typedef struct WSP_ATLAS_T* WSP_ATLAS;
+
+// Where an image was placed in an atlas
+typedef struct WSP_ATLAS_RECT
+{
+    UINT page;      // Page number: <base>_<page>.png
+    UINT x;
+    UINT y;
+    UINT width;
+    UINT height;
+} WSP_ATLAS_RECT;
+
 extern "C" {
     WINSHELLPREVIEW_API HRESULT GetFileThumbnail(LPCWSTR filePath, UINT size, HBITMAP* phBitmap);
     WINSHELLPREVIEW_API HRESULT GetFilePreview(LPCWSTR filePath, UINT width, UINT height, HBITMAP* phBitmap);
     WINSHELLPREVIEW_API HRESULT GetFileIcon(LPCWSTR filePath, UINT size, HBITMAP* phBitmap);
     WINSHELLPREVIEW_API HRESULT SaveBitmapToFile(HBITMAP hBitmap, LPCWSTR outputPath);
     WINSHELLPREVIEW_API void ReleasePreviewBitmap(HBITMAP hBitmap);
+    WINSHELLPREVIEW_API HRESULT GetBufferPoolStats(WSP_BUFFER_POOL_STATS* pStats);
+    WINSHELLPREVIEW_API HRESULT GetShellContextStats(WSP_SHELL_CONTEXT_STATS* pStats);
+    WINSHELLPREVIEW_API void ReleaseShellContext();
+    WINSHELLPREVIEW_API HRESULT SubmitThumbnailRequest(LPCWSTR filePath, UINT size, WSP_PRIORITY priority, WSP_THUMBNAIL_CALLBACK callback, void* context, ULONGLONG* pRequestId);
+    WINSHELLPREVIEW_API HRESULT SetVisibleThumbnailRequests(const ULONGLONG* requestIds, UINT count);
+    WINSHELLPREVIEW_API HRESULT CancelThumbnailRequest(ULONGLONG requestId);
+    WINSHELLPREVIEW_API void ShutdownThumbnailScheduler();
+    WINSHELLPREVIEW_API HRESULT GetCoalescingStats(WSP_COALESCING_STATS* pStats);
+    WINSHELLPREVIEW_API HRESULT GetFileThumbnailProgressive(LPCWSTR filePath, UINT size, WSP_PROGRESS_CALLBACK callback, void* context);
+    WINSHELLPREVIEW_API HRESULT WatchDirectory(LPCWSTR directory, DWORD flags);
+    WINSHELLPREVIEW_API HRESULT UnwatchDirectory(LPCWSTR directory);
+    WINSHELLPREVIEW_API HRESULT SetWatchRegenerationSizes(const UINT* sizes, UINT count);
+    WINSHELLPREVIEW_API void StopWatching();
+    WINSHELLPREVIEW_API HRESULT GetWatcherStats(WSP_WATCHER_STATS* pStats);
+    WINSHELLPREVIEW_API HRESULT StartPregeneration(const WSP_PREGENERATION_OPTIONS* pOptions);
+    WINSHELLPREVIEW_API void StopPregeneration();
+    WINSHELLPREVIEW_API HRESULT GetPregenerationStats(WSP_PREGENERATION_STATS* pStats);
+    WINSHELLPREVIEW_API HRESULT CreateThumbnailAtlas(UINT pageWidth, UINT pageHeight, UINT padding, WSP_ATLAS* phAtlas);
+    WINSHELLPREVIEW_API HRESULT OpenThumbnailAtlas(LPCWSTR basePath, WSP_ATLAS* phAtlas);
+    WINSHELLPREVIEW_API HRESULT AddFileToAtlas(WSP_ATLAS hAtlas, LPCWSTR filePath, UINT size, WSP_ATLAS_RECT* pRect);
+    WINSHELLPREVIEW_API HRESULT AddBitmapToAtlas(WSP_ATLAS hAtlas, LPCWSTR id, HBITMAP hBitmap, WSP_ATLAS_RECT* pRect);
+    WINSHELLPREVIEW_API HRESULT SaveThumbnailAtlas(WSP_ATLAS hAtlas, LPCWSTR basePath);
+    WINSHELLPREVIEW_API void CloseThumbnailAtlas(WSP_ATLAS hAtlas);
+    WINSHELLPREVIEW_API HRESULT GetFileThumbnailWithSignature(LPCWSTR filePath, UINT size, HBITMAP* phBitmap, WSP_IMAGE_SIGNATURE* pSignature);
+    WINSHELLPREVIEW_API HRESULT GetBitmapSignature(HBITMAP hBitmap, WSP_IMAGE_SIGNATURE* pSignature);
+    WINSHELLPREVIEW_API HRESULT GetCachedFileSignature(LPCWSTR filePath, WSP_IMAGE_SIGNATURE* pSignature);
+    WINSHELLPREVIEW_API HRESULT OpenThumbnailStore(LPCWSTR directory);
+    WINSHELLPREVIEW_API void CloseThumbnailStore();
+    WINSHELLPREVIEW_API HRESULT StoreFileImage(LPCWSTR filePath, UINT size, WSP_STORE_SOURCE source, LPWSTR objectPath, UINT objectPathLength);
+    WINSHELLPREVIEW_API HRESULT CollectThumbnailStoreGarbage(ULONGLONG* pBytesFreed);
+    WINSHELLPREVIEW_API HRESULT GetThumbnailStoreStats(WSP_STORE_STATS* pStats);
+    WINSHELLPREVIEW_API HRESULT GetFilePreviewPages(LPCWSTR filePath, UINT width, UINT height, UINT firstPage, UINT pageCount,
+                                                    LPCWSTR outputBasePath, WSP_PAGE_CALLBACK callback, void* context, UINT* pPagesDelivered);
+
+    // Video frame strip (release phStrip with ReleasePreviewBitmap; phStrip may be NULL if only the GIF is wanted)
+    WINSHELLPREVIEW_API HRESULT GetFileFrameStrip(LPCWSTR filePath, const WSP_FRAME_STRIP_OPTIONS* pOptions, HBITMAP* phStrip);
+
+    // Image provider selection (thumbnail extraction backends)
+    WINSHELLPREVIEW_API HRESULT SetImageProviderEnabled(LPCWSTR providerName, BOOL enabled);
+    WINSHELLPREVIEW_API HRESULT GetImageProviderStats(LPCWSTR extension, WSP_PROVIDER_STATS* pStats, UINT capacity, UINT* pCount);
+    // Loads provider statistics from statsPath and keeps saving them there (NULL stops saving)
+    WINSHELLPREVIEW_API HRESULT SetImageProviderStatsFile(LPCWSTR statsPath);
+
+    // Runs thumbnail and preview handlers in worker processes (NULL returns to in-process)
+    WINSHELLPREVIEW_API HRESULT EnableHandlerIsolation(const WSP_ISOLATION_OPTIONS* pOptions);
+    WINSHELLPREVIEW_API HRESULT GetIsolationStats(WSP_ISOLATION_STATS* pStats);
+
+    // Shared-memory frame ring: the creator writes frames, one other process maps and reads them
+    WINSHELLPREVIEW_API HRESULT CreateFrameRing(LPCWSTR name, UINT slotCount, UINT slotBytes, WSP_FRAME_RING* phRing);
+    WINSHELLPREVIEW_API HRESULT OpenFrameRing(LPCWSTR name, WSP_FRAME_RING* phRing);
+    WINSHELLPREVIEW_API HRESULT WriteBitmapToFrameRing(WSP_FRAME_RING hRing, HBITMAP hBitmap, UINT timeoutMs, ULONGLONG* pSequence);
+    WINSHELLPREVIEW_API HRESULT WriteFileThumbnailToFrameRing(WSP_FRAME_RING hRing, LPCWSTR filePath, UINT size, UINT timeoutMs, ULONGLONG* pSequence);
+    WINSHELLPREVIEW_API HRESULT AcquireRingFrame(WSP_FRAME_RING hRing, UINT timeoutMs, WSP_RING_FRAME* pFrame);
+    WINSHELLPREVIEW_API HRESULT ReleaseRingFrame(WSP_FRAME_RING hRing);
+    WINSHELLPREVIEW_API HRESULT GetFrameRingStats(WSP_FRAME_RING hRing, WSP_FRAME_RING_STATS* pStats);
+    WINSHELLPREVIEW_API void CloseFrameRing(WSP_FRAME_RING hRing);
+
+    // Thumbnail pixels: leased (release with ReleaseThumbnailPixels) or copied into buffer
+    // (stride 0 = width * 4; a size x size image always fits size * size * 4 bytes)
+    WINSHELLPREVIEW_API HRESULT GetFileThumbnailPixels(LPCWSTR filePath, UINT size, WSP_PIXELS* pPixels);
+    WINSHELLPREVIEW_API HRESULT GetFileThumbnailPixelsInto(LPCWSTR filePath, UINT size, BYTE* buffer, UINT bufferSize, UINT stride, WSP_PIXELS* pPixels);
+    WINSHELLPREVIEW_API HRESULT ReleaseThumbnailPixels(const BYTE* pixels);
+
+    // Flattens transparent thumbnails onto *pColor (white by default, as before);
+    // NULL keeps their alpha: premultiplied pixels with a transparent margin
+    WINSHELLPREVIEW_API HRESULT SetThumbnailBackground(const COLORREF* pColor);
+
+    // Renders a preview of any size in tiles straight into a PNG file (memory bounded by the tile size)
+    WINSHELLPREVIEW_API HRESULT SaveFilePreviewAsPng(LPCWSTR filePath, UINT width, UINT height, LPCWSTR outputPath);
+
+    // Deep-zoom tile pyramid from one preview capture (outputPath: .dzi file, or pack file with WSP_PYRAMID_PACK)
+    WINSHELLPREVIEW_API HRESULT BuildFilePreviewPyramid(LPCWSTR filePath, UINT width, UINT height, LPCWSTR outputPath,
+                                                        const WSP_PYRAMID_OPTIONS* pOptions, WSP_PYRAMID_STATS* pStats);
+
+    // Queues PNG compression on a shared encoder pool and returns once the pixels are copied
+    // (other extensions save synchronously). Blocks while the encode queue is full.
+    WINSHELLPREVIEW_API HRESULT SaveBitmapToFileAsync(HBITMAP hBitmap, LPCWSTR outputPath, WSP_SAVE_CALLBACK callback, void* context);
+    WINSHELLPREVIEW_API HRESULT WaitForPendingSaves(UINT timeoutMs);
+    WINSHELLPREVIEW_API HRESULT GetEncodePipelineStats(WSP_ENCODE_PIPELINE_STATS* pStats);
+
+    // Shared path table: every path argument is normalized and parsed once into a record
+    WINSHELLPREVIEW_API HRESULT GetPathTableStats(WSP_PATH_TABLE_STATS* pStats);
+
+    // Extension -> preview handler cache. Loading starts with the first preview; this starts it
+    // earlier and waits up to timeoutMs (0 = don't wait) for every association to be resolved.
+    WINSHELLPREVIEW_API HRESULT PreloadPreviewHandlers(UINT timeoutMs);
+    WINSHELLPREVIEW_API HRESULT GetPreviewHandlerCacheStats(WSP_HANDLER_CACHE_STATS* pStats);
+
+    // Warm start: caches and learned statistics are restored from snapshotPath now and saved to it
+    // every few minutes while they change. NULL turns it off. Call SaveWarmStartSnapshot before
+    // the process exits; the DLL cannot write files while it is being unloaded.
+    WINSHELLPREVIEW_API HRESULT SetWarmStartFile(LPCWSTR snapshotPath);
+    WINSHELLPREVIEW_API HRESULT SaveWarmStartSnapshot();
+    WINSHELLPREVIEW_API HRESULT GetWarmStartStats(WSP_WARM_START_STATS* pStats);
 }
\ No newline at end of file
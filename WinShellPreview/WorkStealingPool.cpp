@@ -0,0 +1,226 @@
+#include "WorkStealingPool.h"
+#include <algorithm>
+
+namespace
+{
+    // Lets a task find the pool and deque of the worker running it
+    thread_local const WorkStealingPool* t_pool = nullptr;
+    thread_local int t_index = -1;
+    thread_local int t_depth = 0;      // Tasks running on this thread (RunUntil nests them)
+
+    const std::chrono::milliseconds PARK_TIMEOUT(50);
+
+    uint64_t ElapsedUs(std::chrono::steady_clock::time_point start)
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+WorkStealingPool::WorkStealingPool(uint32_t threads, size_t injectionCapacity)
+    : m_injection(injectionCapacity ? injectionCapacity : 64), m_pending(0), m_stopping(false), m_sleepers(0),
+      m_spaceWaiters(0), m_started(Clock::now()), m_submitted(0), m_spawned(0), m_executed(0), m_stolen(0),
+      m_submitWaitUs(0), m_queueHighWater(0)
+{
+    if (threads == 0)
+        threads = (std::max)(std::thread::hardware_concurrency(), 1u);
+
+    for (uint32_t i = 0; i < threads; ++i)
+        m_workers.emplace_back(new Worker());
+    for (uint32_t i = 0; i < threads; ++i)
+        m_workers[i]->thread = std::thread(&WorkStealingPool::WorkerMain, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_parkMutex);
+        m_stopping.store(true);
+        m_wake.notify_all();
+    }
+    for (std::unique_ptr<Worker>& worker : m_workers)
+        worker->thread.join();
+}
+
+int WorkStealingPool::CurrentWorker() const
+{
+    return t_pool == this ? t_index : -1;
+}
+
+void WorkStealingPool::TaskQueued()
+{
+    m_pending.fetch_add(1);
+    if (m_sleepers.load() != 0)
+    {
+        std::lock_guard<std::mutex> lock(m_parkMutex);
+        m_wake.notify_one();
+    }
+}
+
+bool WorkStealingPool::TrySubmit(Task& task)
+{
+    int index = CurrentWorker();
+    if (index >= 0)
+    {
+        // Subtask: stays with this worker unless someone steals it
+        Worker& worker = *m_workers[index];
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks.push_back(std::move(task));
+        }
+        m_spawned.fetch_add(1, std::memory_order_relaxed);
+        TaskQueued();
+        return true;
+    }
+
+    if (!m_injection.TryPush(task))
+        return false;
+
+    m_submitted.fetch_add(1, std::memory_order_relaxed);
+    uint64_t depth = m_injection.Size();
+    uint64_t high = m_queueHighWater.load(std::memory_order_relaxed);
+    while (depth > high && !m_queueHighWater.compare_exchange_weak(high, depth, std::memory_order_relaxed))
+    {
+    }
+    TaskQueued();
+    return true;
+}
+
+void WorkStealingPool::Submit(Task task)
+{
+    if (TrySubmit(task))
+        return;
+
+    // Backpressure: wait for a worker to take something off the injection queue
+    Clock::time_point start = Clock::now();
+    m_spaceWaiters.fetch_add(1);
+    while (!TrySubmit(task))
+    {
+        std::unique_lock<std::mutex> lock(m_parkMutex);
+        m_space.wait_for(lock, PARK_TIMEOUT, [this]() { return m_injection.Size() < m_injection.Capacity(); });
+    }
+    m_spaceWaiters.fetch_sub(1);
+    m_submitWaitUs.fetch_add(ElapsedUs(start), std::memory_order_relaxed);
+}
+
+bool WorkStealingPool::FindTask(int index, Task* task)
+{
+    // Own deque, newest first: its data is most likely still in cache
+    if (index >= 0)
+    {
+        Worker& worker = *m_workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty())
+        {
+            *task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            m_pending.fetch_sub(1);
+            return true;
+        }
+    }
+
+    if (m_injection.TryPop(task))
+    {
+        m_pending.fetch_sub(1);
+        if (m_spaceWaiters.load() != 0)
+        {
+            std::lock_guard<std::mutex> lock(m_parkMutex);
+            m_space.notify_all();
+        }
+        return true;
+    }
+
+    // Steal the oldest task of another worker
+    size_t count = m_workers.size();
+    size_t start = index >= 0 ? static_cast<size_t>(index) + 1 : 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t victim = (start + i) % count;
+        if (static_cast<int>(victim) == index)
+            continue;
+
+        Worker& worker = *m_workers[victim];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty())
+        {
+            *task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+            m_pending.fetch_sub(1);
+            m_stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::RunTask(int index, Task& task)
+{
+    Clock::time_point start = Clock::now();
+    t_depth++;
+    task();
+    t_depth--;
+    task = nullptr;
+
+    // Nested tasks are already inside the outer task's time
+    if (index >= 0 && t_depth == 0)
+        m_workers[index]->busyUs.fetch_add(ElapsedUs(start), std::memory_order_relaxed);
+    m_executed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void WorkStealingPool::WorkerMain(uint32_t index)
+{
+    t_pool = this;
+    t_index = static_cast<int>(index);
+
+    Task task;
+    for (;;)
+    {
+        if (FindTask(static_cast<int>(index), &task))
+        {
+            RunTask(static_cast<int>(index), task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_parkMutex);
+        if (m_stopping.load() && m_pending.load() == 0)
+            break;
+        m_sleepers.fetch_add(1);
+        m_wake.wait_for(lock, PARK_TIMEOUT, [this]() { return m_stopping.load() || m_pending.load() != 0; });
+        m_sleepers.fetch_sub(1);
+    }
+
+    t_pool = nullptr;
+    t_index = -1;
+}
+
+void WorkStealingPool::RunUntil(const std::function<bool()>& done)
+{
+    int index = CurrentWorker();
+    Task task;
+    while (!done())
+    {
+        if (FindTask(index, &task))
+            RunTask(index, task);
+        else
+            std::this_thread::yield();
+    }
+}
+
+WorkStealingPoolStats WorkStealingPool::Stats() const
+{
+    WorkStealingPoolStats stats = {};
+    stats.threads = ThreadCount();
+    stats.submitted = m_submitted.load(std::memory_order_relaxed);
+    stats.spawned = m_spawned.load(std::memory_order_relaxed);
+    stats.executed = m_executed.load(std::memory_order_relaxed);
+    stats.stolen = m_stolen.load(std::memory_order_relaxed);
+    stats.submitWaitMs = m_submitWaitUs.load(std::memory_order_relaxed) / 1000;
+    stats.elapsedMs = ElapsedUs(m_started) / 1000;
+    stats.queueHighWater = m_queueHighWater.load(std::memory_order_relaxed);
+
+    uint64_t busyUs = 0;
+    for (const std::unique_ptr<Worker>& worker : m_workers)
+        busyUs += worker->busyUs.load(std::memory_order_relaxed);
+    stats.busyMs = busyUs / 1000;
+    return stats;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include "MpmcQueue.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct WorkStealingPoolStats
+{
+    uint32_t threads;
+    uint64_t submitted;         // Tasks from outside the pool (through the injection queue)
+    uint64_t spawned;           // Tasks submitted by pool tasks (onto the worker's own deque)
+    uint64_t executed;
+    uint64_t stolen;            // Taken from another worker's deque
+    uint64_t submitWaitMs;      // Outside submitters blocked on a full injection queue (backpressure)
+    uint64_t busyMs;            // Summed over workers: time spent running tasks
+    uint64_t elapsedMs;         // Since the pool started
+    uint64_t queueHighWater;    // Deepest the injection queue has been
+};
+
+// Fixed set of worker threads sized to the cores. Tasks from outside enter through a bounded
+// lock-free MPMC injection queue, so submitters are held back when the workers fall behind.
+// Tasks submitted from inside a task go onto that worker's own deque (run newest first);
+// idle workers take from the injection queue and then steal the oldest task of a busy worker.
+// No Windows dependencies.
+class WorkStealingPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    // threads 0 = hardware threads
+    explicit WorkStealingPool(uint32_t threads = 0, size_t injectionCapacity = 64);
+
+    // Runs every queued task, then joins the workers
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Blocks while the injection queue is full when called from outside the pool
+    void Submit(Task task);
+
+    // Never blocks; false if the injection queue is full
+    bool TrySubmit(Task& task);
+
+    // Runs queued tasks on the calling thread until done() returns true. Use this to wait for
+    // subtasks from inside a task: the worker keeps helping instead of blocking the pool.
+    void RunUntil(const std::function<bool()>& done);
+
+    uint32_t ThreadCount() const { return static_cast<uint32_t>(m_workers.size()); }
+    WorkStealingPoolStats Stats() const;
+
+private:
+    struct Worker
+    {
+        std::thread thread;
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::atomic<uint64_t> busyUs{0};
+    };
+
+    void WorkerMain(uint32_t index);
+    bool FindTask(int index, Task* task);
+    void RunTask(int index, Task& task);
+    void TaskQueued();
+    int CurrentWorker() const;
+
+    typedef std::chrono::steady_clock Clock;
+
+    MpmcQueue<Task> m_injection;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<uint64_t> m_pending;        // Queued anywhere, not yet started
+    std::atomic<bool> m_stopping;
+
+    std::mutex m_parkMutex;
+    std::condition_variable m_wake;         // Idle workers
+    std::atomic<uint32_t> m_sleepers;
+    std::condition_variable m_space;        // Submitters waiting for the injection queue
+    std::atomic<uint32_t> m_spaceWaiters;
+
+    Clock::time_point m_started;
+    std::atomic<uint64_t> m_submitted;
+    std::atomic<uint64_t> m_spawned;
+    std::atomic<uint64_t> m_executed;
+    std::atomic<uint64_t> m_stolen;
+    std::atomic<uint64_t> m_submitWaitUs;
+    std::atomic<uint64_t> m_queueHighWater;
+};
@@ -0,0 +1,252 @@
+#include "WorkerChannel.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+    const uint32_t CHANNEL_MAGIC = 0x43505357;      // "WSPC"
+    const uint32_t CHANNEL_VERSION = 2;
+    const uint32_t HEARTBEAT_INTERVAL_MS = 250;
+    const uint32_t POLL_SLICE_MS = 50;              // Liveness checks while waiting on the worker
+    const size_t PIXEL_ALIGNMENT = 64;
+
+    enum ChannelState : uint32_t
+    {
+        STATE_STARTING = 0,
+        STATE_IDLE,
+        STATE_REQUEST,
+        STATE_WORKING,
+        STATE_RESPONSE,
+        STATE_SHUTDOWN
+    };
+
+    uint64_t NowMs()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    std::string RequestSignalName(const std::string& name) { return name + "-rq"; }
+    std::string ResponseSignalName(const std::string& name) { return name + "-rs"; }
+}
+
+// Lives at the start of the shared block. Plain fields are published by the release store to
+// `state` and read after an acquire load of it.
+struct WorkerChannel::Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t supervisorPid;
+    std::atomic<uint32_t> workerPid;
+    std::atomic<uint64_t> heartbeat;
+    std::atomic<uint32_t> state;
+    uint32_t reserved;
+
+    // Request
+    uint64_t jobId;
+    uint32_t kind;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pathBytes;
+    char path[MAX_PATH_BYTES];
+
+    // Response
+    uint64_t responseJobId;
+    int32_t status;
+    uint32_t imageWidth;
+    uint32_t imageHeight;
+    uint32_t alpha;
+    uint64_t imageStride;
+
+    uint64_t pixelOffset;
+    uint64_t pixelCapacity;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "Cross-process atomics must be lock-free");
+
+WorkerChannel::~WorkerChannel()
+{
+}
+
+WorkerChannel::Header* WorkerChannel::GetHeader() const
+{
+    return reinterpret_cast<Header*>(m_memory->Data());
+}
+
+std::unique_ptr<WorkerChannel> WorkerChannel::Create(const std::string& name, size_t pixelCapacity)
+{
+    size_t pixelOffset = (sizeof(Header) + PIXEL_ALIGNMENT - 1) / PIXEL_ALIGNMENT * PIXEL_ALIGNMENT;
+
+    std::unique_ptr<WorkerChannel> channel(new WorkerChannel());
+    channel->m_name = name;
+    channel->m_memory = SharedMemory::Create(name, pixelOffset + pixelCapacity);
+    channel->m_request = IpcSignal::Create(RequestSignalName(name));
+    channel->m_response = IpcSignal::Create(ResponseSignalName(name));
+    if (!channel->m_memory || !channel->m_request || !channel->m_response)
+        return nullptr;
+
+    Header* header = new (channel->m_memory->Data()) Header();
+    header->magic = CHANNEL_MAGIC;
+    header->version = CHANNEL_VERSION;
+    header->supervisorPid = CurrentProcessId();
+    header->workerPid.store(0);
+    header->heartbeat.store(0);
+    header->pixelOffset = pixelOffset;
+    header->pixelCapacity = pixelCapacity;
+    header->state.store(STATE_STARTING, std::memory_order_release);
+    return channel;
+}
+
+bool WorkerChannel::WaitReady(uint32_t timeoutMs, const std::function<bool()>& alive)
+{
+    uint64_t deadline = NowMs() + timeoutMs;
+    for (;;)
+    {
+        if (GetHeader()->state.load(std::memory_order_acquire) == STATE_IDLE)
+            return true;
+        uint64_t now = NowMs();
+        if (now >= deadline || !alive())
+            return false;
+        m_response->Wait(static_cast<uint32_t>(std::min<uint64_t>(deadline - now, POLL_SLICE_MS)));
+    }
+}
+
+bool WorkerChannel::Post(const WorkerJob& job)
+{
+    Header* header = GetHeader();
+    // The previous response stays in place until the next request replaces it
+    uint32_t state = header->state.load(std::memory_order_acquire);
+    if ((state != STATE_IDLE && state != STATE_RESPONSE) || job.path.size() >= MAX_PATH_BYTES)
+        return false;
+
+    header->jobId = ++m_jobId;
+    header->kind = job.kind;
+    header->width = job.width;
+    header->height = job.height;
+    header->pathBytes = static_cast<uint32_t>(job.path.size());
+    memcpy(header->path, job.path.data(), job.path.size());
+    header->path[job.path.size()] = '\0';
+    header->state.store(STATE_REQUEST, std::memory_order_release);
+    m_request->Notify();
+    return true;
+}
+
+ChannelWait WorkerChannel::WaitResponse(uint32_t timeoutMs, const std::function<bool()>& alive)
+{
+    Header* header = GetHeader();
+    uint64_t deadline = NowMs() + timeoutMs;
+    for (;;)
+    {
+        if (header->state.load(std::memory_order_acquire) == STATE_RESPONSE && header->responseJobId == m_jobId)
+        {
+            return ChannelWait::Done;
+        }
+        if (!alive())
+        {
+            // The response may have landed right before the exit
+            if (header->state.load(std::memory_order_acquire) == STATE_RESPONSE && header->responseJobId == m_jobId)
+                return ChannelWait::Done;
+            return ChannelWait::WorkerDied;
+        }
+        uint64_t now = NowMs();
+        if (now >= deadline)
+            return ChannelWait::TimedOut;
+        m_response->Wait(static_cast<uint32_t>(std::min<uint64_t>(deadline - now, POLL_SLICE_MS)));
+    }
+}
+
+int32_t WorkerChannel::Status() const
+{
+    return GetHeader()->status;
+}
+
+bool WorkerChannel::Image(SharedImageView* view) const
+{
+    const Header* header = GetHeader();
+    if (header->imageWidth == 0 || header->imageHeight == 0)
+        return false;
+    if (header->imageStride * header->imageHeight > header->pixelCapacity)
+        return false;
+
+    view->pixels = m_memory->Data() + header->pixelOffset;
+    view->width = header->imageWidth;
+    view->height = header->imageHeight;
+    view->stride = static_cast<size_t>(header->imageStride);
+    view->alpha = static_cast<AlphaMode>(header->alpha);
+    return true;
+}
+
+uint64_t WorkerChannel::Heartbeat() const
+{
+    return GetHeader()->heartbeat.load(std::memory_order_relaxed);
+}
+
+uint32_t WorkerChannel::WorkerProcessId() const
+{
+    return GetHeader()->workerPid.load(std::memory_order_relaxed);
+}
+
+void WorkerChannel::RequestShutdown()
+{
+    GetHeader()->state.store(STATE_SHUTDOWN, std::memory_order_release);
+    m_request->Notify();
+}
+
+int RunWorkerProcess(const std::string& channelName, const WorkerJobHandler& handler)
+{
+    std::unique_ptr<SharedMemory> memory = SharedMemory::Open(channelName);
+    std::unique_ptr<IpcSignal> request = IpcSignal::Open(RequestSignalName(channelName));
+    std::unique_ptr<IpcSignal> response = IpcSignal::Open(ResponseSignalName(channelName));
+    if (!memory || !request || !response || memory->Size() < sizeof(WorkerChannel::Header))
+        return 2;
+
+    typedef WorkerChannel::Header Header;
+    Header* header = reinterpret_cast<Header*>(memory->Data());
+    if (header->magic != CHANNEL_MAGIC || header->version != CHANNEL_VERSION ||
+        header->pixelOffset + header->pixelCapacity > memory->Size())
+        return 2;
+
+    header->workerPid.store(CurrentProcessId());
+    header->state.store(STATE_IDLE, std::memory_order_release);
+    response->Notify();
+
+    uint32_t supervisorPid = header->supervisorPid;
+    for (;;)
+    {
+        request->Wait(HEARTBEAT_INTERVAL_MS);
+
+        uint32_t state = header->state.load(std::memory_order_acquire);
+        if (state == STATE_SHUTDOWN)
+            return 0;
+
+        if (state == STATE_REQUEST)
+        {
+            header->state.store(STATE_WORKING, std::memory_order_relaxed);
+
+            WorkerJob job;
+            job.kind = header->kind;
+            job.width = header->width;
+            job.height = header->height;
+            job.path.assign(header->path, std::min<uint32_t>(header->pathBytes, WorkerChannel::MAX_PATH_BYTES - 1));
+
+            WorkerImageWriter output(memory->Data() + header->pixelOffset, static_cast<size_t>(header->pixelCapacity));
+            int32_t status = handler(job, output);
+
+            header->status = status;
+            header->imageWidth = output.Width();
+            header->imageHeight = output.Height();
+            header->imageStride = static_cast<uint64_t>(output.Width()) * 4;
+            header->alpha = static_cast<uint32_t>(output.Alpha());
+            header->responseJobId = header->jobId;
+            header->state.store(STATE_RESPONSE, std::memory_order_release);
+            response->Notify();
+        }
+
+        header->heartbeat.fetch_add(1, std::memory_order_relaxed);
+        if (!IsProcessAlive(supervisorPid))
+            return 0;
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include "ImageOps.h"
+#include "IpcPlatform.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+// One supervisor <-> worker process connection: a shared memory block holding a control header
+// and the pixel area, plus two IpcSignals (request, response). The worker renders straight
+// into the shared pixel area, so an image crosses the process boundary without being copied
+// or serialized. No Windows dependencies.
+
+struct WorkerJob
+{
+    uint32_t kind = 0;          // Meaning defined by the worker's handler
+    std::string path;           // UTF-8
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::string handlerKey;     // Supervisor side only: groups jobs for quarantine (e.g. file type)
+};
+
+// Pixels in the shared area, valid until the worker takes its next job
+struct SharedImageView
+{
+    const uint8_t* pixels = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t stride = 0;
+    AlphaMode alpha = AlphaMode::Ignore;
+};
+
+// Worker side: hands out the shared pixel area for the job's result
+class WorkerImageWriter
+{
+public:
+    WorkerImageWriter(uint8_t* area, size_t capacity) : m_area(area), m_capacity(capacity), m_width(0), m_height(0), m_alpha(AlphaMode::Ignore) {}
+
+    // Rows of width * 4 bytes, top to bottom. nullptr if the image does not fit the area.
+    uint8_t* Begin(uint32_t width, uint32_t height, AlphaMode alpha)
+    {
+        if (width == 0 || height == 0 || static_cast<uint64_t>(width) * height * 4 > m_capacity)
+            return nullptr;
+        m_width = width;
+        m_height = height;
+        m_alpha = alpha;
+        return m_area;
+    }
+
+    // Alpha can be settled after the pixels are written
+    void SetAlpha(AlphaMode alpha) { m_alpha = alpha; }
+
+    size_t Capacity() const { return m_capacity; }
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+    AlphaMode Alpha() const { return m_alpha; }
+
+private:
+    uint8_t* m_area;
+    size_t m_capacity;
+    uint32_t m_width;
+    uint32_t m_height;
+    AlphaMode m_alpha;
+};
+
+// Returns a status code, negative on failure (an HRESULT on Windows)
+typedef std::function<int32_t(const WorkerJob& job, WorkerImageWriter& output)> WorkerJobHandler;
+
+enum class ChannelWait
+{
+    Done,
+    TimedOut,
+    WorkerDied
+};
+
+// Supervisor side of a channel
+class WorkerChannel
+{
+public:
+    static const uint32_t MAX_PATH_BYTES = 32767 * 3 + 1;     // Longest "\\?\" path in UTF-8, plus terminator
+
+    ~WorkerChannel();
+
+    static std::unique_ptr<WorkerChannel> Create(const std::string& name, size_t pixelCapacity);
+
+    const std::string& Name() const { return m_name; }
+
+    // Waits for the worker's hello. alive() is polled so a worker that dies at startup is
+    // noticed before the timeout.
+    bool WaitReady(uint32_t timeoutMs, const std::function<bool()>& alive);
+
+    bool Post(const WorkerJob& job);
+    ChannelWait WaitResponse(uint32_t timeoutMs, const std::function<bool()>& alive);
+
+    int32_t Status() const;
+    bool Image(SharedImageView* view) const;
+
+    // Bumped by an idle worker a few times per second
+    uint64_t Heartbeat() const;
+    uint32_t WorkerProcessId() const;
+
+    // Asks the worker to exit after its current job
+    void RequestShutdown();
+
+private:
+    friend int RunWorkerProcess(const std::string& channelName, const WorkerJobHandler& handler);
+
+    WorkerChannel() {}
+
+    struct Header;
+    Header* GetHeader() const;
+
+    std::string m_name;
+    std::unique_ptr<SharedMemory> m_memory;
+    std::unique_ptr<IpcSignal> m_request;
+    std::unique_ptr<IpcSignal> m_response;
+    uint64_t m_jobId = 0;
+};
+
+// Worker process main loop: connects to the channel, runs jobs until the supervisor exits or
+// asks for shutdown. Returns the process exit code.
+int RunWorkerProcess(const std::string& channelName, const WorkerJobHandler& handler);
@@ -0,0 +1,370 @@
+#include "WorkerPool.h"
+#include <chrono>
+
+namespace
+{
+    const uint32_t SHUTDOWN_GRACE_MS = 500;
+
+    uint64_t NowMs()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+WorkerPool::WorkerPool()
+    : m_stats(), m_generation(0), m_running(false), m_stopping(false)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+    Stop();
+}
+
+bool WorkerPool::Start(const WorkerPoolOptions& options)
+{
+    Stop();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_options = options;
+        if (m_options.workerCount == 0)
+            m_options.workerCount = 1;
+        m_workers.clear();
+        for (uint32_t i = 0; i < m_options.workerCount; ++i)
+        {
+            std::unique_ptr<Worker> worker(new Worker());
+            worker->index = i;
+            m_workers.push_back(std::move(worker));
+        }
+        m_stopping = false;
+    }
+
+    // Workers are not shared yet, so they can be spawned without the lock
+    bool anyStarted = false;
+    for (auto& worker : m_workers)
+    {
+        if (Spawn(worker.get()))
+            anyStarted = true;
+    }
+    if (!anyStarted)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_workers.clear();
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = true;
+    }
+    m_healthThread = std::thread(&WorkerPool::HealthLoop, this);
+    return true;
+}
+
+void WorkerPool::Stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_running)
+            return;
+        m_stopping = true;
+        m_healthWake.notify_all();
+        m_workerFree.notify_all();
+    }
+
+    if (m_healthThread.joinable())
+        m_healthThread.join();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // Jobs in flight are bounded by their own deadlines
+    m_workerFree.wait(lock, [this]
+    {
+        for (auto& worker : m_workers)
+        {
+            if (worker->busy)
+                return false;
+        }
+        return true;
+    });
+    for (auto& worker : m_workers)
+        worker->busy = true;
+    lock.unlock();
+
+    for (auto& worker : m_workers)
+        Shutdown(worker.get());
+
+    lock.lock();
+    m_workers.clear();
+    m_running = false;
+}
+
+bool WorkerPool::IsRunning() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running && !m_stopping;
+}
+
+bool WorkerPool::Spawn(Worker* worker)
+{
+    Shutdown(worker);
+
+    std::string name;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // A fresh name per spawn: a killed worker may leave its objects in any state
+        name = m_options.namePrefix + "-" + std::to_string(CurrentProcessId()) + "-" +
+               std::to_string(worker->index) + "-" + std::to_string(++m_generation);
+    }
+
+    std::unique_ptr<WorkerChannel> channel = WorkerChannel::Create(name, m_options.pixelCapacity);
+    std::unique_ptr<ChildProcess> process(new ChildProcess());
+    std::vector<std::string> arguments = m_options.arguments;
+    arguments.push_back(name);
+
+    bool started = channel && process->Start(m_options.executable, arguments);
+    if (started)
+    {
+        ChildProcess* child = process.get();
+        started = channel->WaitReady(m_options.startTimeoutMs, [child] { return child->IsRunning(); });
+        if (!started)
+            process->Kill();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!started)
+    {
+        ++m_stats.spawnFailures;
+        return false;
+    }
+
+    ++m_stats.spawned;
+    worker->live = true;
+    worker->channel = std::move(channel);
+    worker->process = std::move(process);
+    worker->lastHeartbeat = worker->channel->Heartbeat();
+    worker->lastHeartbeatChangeMs = NowMs();
+    return true;
+}
+
+void WorkerPool::Shutdown(Worker* worker)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        worker->live = false;
+    }
+    if (worker->process && worker->channel && worker->process->IsRunning())
+    {
+        worker->channel->RequestShutdown();
+        uint64_t deadline = NowMs() + SHUTDOWN_GRACE_MS;
+        while (worker->process->IsRunning() && NowMs() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (worker->process)
+        worker->process->Kill();
+    worker->process.reset();
+    worker->channel.reset();
+}
+
+bool WorkerPool::IsAlive(Worker* worker)
+{
+    return worker->process && worker->channel && worker->process->IsRunning();
+}
+
+WorkerPool::Worker* WorkerPool::Acquire()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        if (m_stopping || !m_running)
+            return nullptr;
+        for (auto& worker : m_workers)
+        {
+            if (!worker->busy)
+            {
+                worker->busy = true;
+                return worker.get();
+            }
+        }
+        m_workerFree.wait(lock);
+    }
+}
+
+void WorkerPool::Release(Worker* worker)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    worker->busy = false;
+    m_workerFree.notify_all();
+}
+
+void WorkerPool::RecordOutcome(const std::string& handlerKey, bool failed)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!failed)
+    {
+        m_handlers.erase(handlerKey);
+        return;
+    }
+
+    HandlerHealth& health = m_handlers[handlerKey];
+    if (++health.consecutiveFailures >= m_options.quarantineFailures && m_options.quarantineFailures > 0)
+    {
+        health.quarantinedUntilMs = NowMs() + m_options.quarantineMs;
+        health.consecutiveFailures = 0;
+    }
+}
+
+bool WorkerPool::IsQuarantined(const std::string& handlerKey)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_handlers.find(handlerKey);
+    return it != m_handlers.end() && it->second.quarantinedUntilMs > NowMs();
+}
+
+void WorkerPool::ClearQuarantine()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_handlers.clear();
+}
+
+WorkerResult WorkerPool::Run(const WorkerJob& job, uint32_t timeoutMs, const ImageConsumer& consume)
+{
+    WorkerResult result;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.jobs;
+    }
+
+    if (IsQuarantined(job.handlerKey))
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.quarantined;
+        result.outcome = WorkerOutcome::Quarantined;
+        return result;
+    }
+
+    if (job.path.size() >= WorkerChannel::MAX_PATH_BYTES)
+        return result;
+
+    Worker* worker = Acquire();
+    if (!worker)
+        return result;
+
+    if (!IsAlive(worker) && !Spawn(worker))
+    {
+        Release(worker);
+        return result;
+    }
+
+    if (!worker->channel->Post(job))
+    {
+        // A desynchronized worker; start over with a fresh one
+        Spawn(worker);
+        Release(worker);
+        return result;
+    }
+
+    ChildProcess* child = worker->process.get();
+    ChannelWait wait = worker->channel->WaitResponse(timeoutMs, [child] { return child->IsRunning(); });
+    if (wait == ChannelWait::Done)
+    {
+        result.outcome = WorkerOutcome::Completed;
+        result.status = worker->channel->Status();
+        SharedImageView view;
+        if (result.status >= 0 && consume && worker->channel->Image(&view))
+            consume(view);
+        // Long jobs stall the heartbeat; restart the idle clock
+        worker->lastHeartbeatChangeMs = NowMs();
+    }
+    else
+    {
+        result.outcome = wait == ChannelWait::TimedOut ? WorkerOutcome::TimedOut : WorkerOutcome::Crashed;
+        // The health thread brings a replacement up; the caller does not pay for the spawn
+        Shutdown(worker);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (result.outcome == WorkerOutcome::Completed)
+            ++m_stats.completed;
+        else if (result.outcome == WorkerOutcome::TimedOut)
+            ++m_stats.timeouts;
+        else
+            ++m_stats.crashes;
+    }
+    RecordOutcome(job.handlerKey, result.outcome != WorkerOutcome::Completed);
+    Release(worker);
+
+    if (result.outcome != WorkerOutcome::Completed)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_healthWake.notify_all();
+    }
+    return result;
+}
+
+void WorkerPool::HealthLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping)
+    {
+        m_healthWake.wait_for(lock, std::chrono::milliseconds(m_options.healthIntervalMs));
+        if (m_stopping)
+            break;
+
+        for (auto& worker : m_workers)
+        {
+            if (worker->busy)
+                continue;
+            worker->busy = true;
+            lock.unlock();
+
+            bool restart = !IsAlive(worker.get());
+            if (!restart)
+            {
+                uint64_t now = NowMs();
+                uint64_t heartbeat = worker->channel->Heartbeat();
+                if (heartbeat != worker->lastHeartbeat)
+                {
+                    worker->lastHeartbeat = heartbeat;
+                    worker->lastHeartbeatChangeMs = now;
+                }
+                else if (now - worker->lastHeartbeatChangeMs >= m_options.heartbeatTimeoutMs)
+                {
+                    restart = true;
+                    std::lock_guard<std::mutex> statsLock(m_mutex);
+                    ++m_stats.hangsDetected;
+                }
+            }
+            if (restart)
+                Spawn(worker.get());
+
+            lock.lock();
+            worker->busy = false;
+            m_workerFree.notify_all();
+            if (m_stopping)
+                break;
+        }
+    }
+}
+
+WorkerPoolStats WorkerPool::Stats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    WorkerPoolStats stats = m_stats;
+    uint64_t now = NowMs();
+    stats.quarantinedKeys = 0;
+    for (const auto& entry : m_handlers)
+    {
+        if (entry.second.quarantinedUntilMs > now)
+            ++stats.quarantinedKeys;
+    }
+    stats.liveWorkers = 0;
+    for (const auto& worker : m_workers)
+    {
+        if (worker->live)
+            ++stats.liveWorkers;
+    }
+    return stats;
+}
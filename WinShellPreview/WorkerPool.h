@@ -0,0 +1,131 @@
+#pragma once
+#include "WorkerChannel.h"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Supervisor for a pool of out-of-process workers that run untrusted handlers.
+//
+// - Each worker owns a WorkerChannel; results are read in place from shared memory
+// - A crashed worker is detected through its process state, a hung one through the job deadline
+//   (busy) or a stalled heartbeat (idle); either way it is killed and respawned
+// - Handler keys (typically the file type) that keep crashing or hanging are quarantined for a
+//   while, so one broken handler cannot keep burning a worker per request
+//
+// No Windows dependencies; the platform parts live behind IpcPlatform.h.
+
+enum class WorkerOutcome
+{
+    Completed,      // The handler returned; see WorkerResult::status
+    Crashed,        // The worker process died during the job
+    TimedOut,       // No answer before the deadline; the worker was killed
+    Quarantined,    // The handler key is quarantined; nothing was run
+    Unavailable     // No worker could be started
+};
+
+struct WorkerResult
+{
+    WorkerOutcome outcome = WorkerOutcome::Unavailable;
+    int32_t status = -1;        // Handler status, valid for Completed
+};
+
+struct WorkerPoolOptions
+{
+    std::string executable;                 // UTF-8
+    std::vector<std::string> arguments;     // The channel name is appended as the last argument
+    std::string namePrefix = "wsp";
+    uint32_t workerCount = 2;
+    size_t pixelCapacity = 32 * 1024 * 1024;
+    uint32_t startTimeoutMs = 10000;
+    uint32_t heartbeatTimeoutMs = 5000;     // Idle worker without heartbeat for this long is hung
+    uint32_t healthIntervalMs = 1000;
+    uint32_t quarantineFailures = 3;        // Consecutive crashes/timeouts per handler key
+    uint32_t quarantineMs = 10 * 60 * 1000;
+};
+
+struct WorkerPoolStats
+{
+    uint64_t jobs;
+    uint64_t completed;
+    uint64_t crashes;
+    uint64_t timeouts;
+    uint64_t hangsDetected;     // Idle workers restarted by the health check
+    uint64_t spawned;
+    uint64_t spawnFailures;
+    uint64_t quarantined;       // Jobs refused because of quarantine
+    uint32_t quarantinedKeys;   // Keys currently in quarantine
+    uint32_t liveWorkers;
+};
+
+class WorkerPool
+{
+public:
+    // Called with the worker's image while it is still in shared memory
+    typedef std::function<void(const SharedImageView& image)> ImageConsumer;
+
+    WorkerPool();
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Spawns the workers and the health thread. Returns false if no worker came up.
+    bool Start(const WorkerPoolOptions& options);
+    // Waits for running jobs, then shuts the workers down
+    void Stop();
+    bool IsRunning() const;
+
+    // Blocks until a worker is free, runs the job and hands the result to consume (only for a
+    // Completed job that produced an image)
+    WorkerResult Run(const WorkerJob& job, uint32_t timeoutMs, const ImageConsumer& consume);
+
+    bool IsQuarantined(const std::string& handlerKey);
+    void ClearQuarantine();
+
+    WorkerPoolStats Stats();
+
+private:
+    struct Worker
+    {
+        uint32_t index = 0;
+        bool busy = false;
+        bool live = false;
+        std::unique_ptr<ChildProcess> process;
+        std::unique_ptr<WorkerChannel> channel;
+        uint64_t lastHeartbeat = 0;
+        uint64_t lastHeartbeatChangeMs = 0;
+    };
+
+    struct HandlerHealth
+    {
+        uint32_t consecutiveFailures = 0;
+        uint64_t quarantinedUntilMs = 0;
+    };
+
+    bool Spawn(Worker* worker);
+    void Shutdown(Worker* worker);
+    bool IsAlive(Worker* worker);
+    Worker* Acquire();
+    void Release(Worker* worker);
+    void RecordOutcome(const std::string& handlerKey, bool failed);
+    void HealthLoop();
+
+    WorkerPoolOptions m_options;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::unordered_map<std::string, HandlerHealth> m_handlers;
+    WorkerPoolStats m_stats;
+    uint64_t m_generation;
+    bool m_running;
+    bool m_stopping;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_workerFree;
+    std::condition_variable m_healthWake;
+    std::thread m_healthThread;
+};
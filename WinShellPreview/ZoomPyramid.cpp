@@ -0,0 +1,412 @@
+#include "ZoomPyramid.h"
+#include "BoundedQueue.h"
+#include "PngWriter.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    const uint32_t MAX_ENCODE_THREADS = 8;
+    const char PACK_MAGIC[8] = { 'W', 'S', 'P', 'Z', 'P', 'A', 'C', 'K' };
+    const char INDEX_MAGIC[4] = { 'W', 'S', 'P', 'I' };
+    const size_t PACK_HEADER_SIZE = 32;
+    const size_t PACK_ENTRY_SIZE = 32;
+    const size_t PACK_FOOTER_SIZE = 16;
+
+    struct TileJob
+    {
+        uint32_t level = 0;
+        uint32_t column = 0;
+        uint32_t row = 0;
+        PixelImage image;
+    };
+
+    inline void PutLE32(uint8_t* p, uint32_t v)
+    {
+        p[0] = static_cast<uint8_t>(v);
+        p[1] = static_cast<uint8_t>(v >> 8);
+        p[2] = static_cast<uint8_t>(v >> 16);
+        p[3] = static_cast<uint8_t>(v >> 24);
+    }
+
+    inline void PutLE64(uint8_t* p, uint64_t v)
+    {
+        PutLE32(p, static_cast<uint32_t>(v));
+        PutLE32(p + 4, static_cast<uint32_t>(v >> 32));
+    }
+
+    inline uint32_t GetLE32(const uint8_t* p)
+    {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    inline uint64_t GetLE64(const uint8_t* p)
+    {
+        return GetLE32(p) | (static_cast<uint64_t>(GetLE32(p + 4)) << 32);
+    }
+
+    // Pixel span of a tile along one axis, including the overlap with its neighbours
+    void TileSpan(uint32_t index, uint32_t tileSize, uint32_t overlap, uint32_t extent, uint32_t* pStart, uint32_t* pEnd)
+    {
+        uint64_t start = static_cast<uint64_t>(index) * tileSize;
+        uint64_t end = start + tileSize + overlap;
+        start = index ? start - overlap : 0;
+        *pStart = static_cast<uint32_t>(start);
+        *pEnd = static_cast<uint32_t>((std::min)(end, static_cast<uint64_t>(extent)));
+    }
+
+    template <typename Entry>
+    bool EntryLess(const Entry& a, const Entry& b)
+    {
+        if (a.level != b.level)
+            return a.level < b.level;
+        if (a.row != b.row)
+            return a.row < b.row;
+        return a.column < b.column;
+    }
+}
+
+uint32_t PyramidLevelCount(uint32_t width, uint32_t height)
+{
+    // ceil(log2(max(width, height))) + 1
+    uint32_t extent = (std::max)(width, height);
+    uint32_t levels = 1;
+    while (extent > 1)
+    {
+        extent = (extent + 1) / 2;
+        levels++;
+    }
+    return levels;
+}
+
+void PyramidLevelSize(uint32_t width, uint32_t height, uint32_t level, uint32_t* pWidth, uint32_t* pHeight)
+{
+    uint32_t top = PyramidLevelCount(width, height) - 1;
+    for (uint32_t l = top; l > level; --l)
+    {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+    *pWidth = width;
+    *pHeight = height;
+}
+
+void PyramidGridSize(uint32_t levelWidth, uint32_t levelHeight, uint32_t tileSize, uint32_t* pColumns, uint32_t* pRows)
+{
+    *pColumns = (levelWidth + tileSize - 1) / tileSize;
+    *pRows = (levelHeight + tileSize - 1) / tileSize;
+}
+
+PyramidResult BuildZoomPyramid(const PixelImage& image, const PyramidOptions& options, const PyramidSink& sink)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    PyramidResult result;
+    if (image.Empty() || options.tileSize == 0)
+        return result;
+
+    uint32_t threads = options.encodeThreads;
+    if (threads == 0)
+        threads = (std::min)((std::max)(std::thread::hardware_concurrency(), 1u), MAX_ENCODE_THREADS);
+    size_t depth = options.queueDepth ? options.queueDepth : static_cast<size_t>(threads) * 4;
+
+    BoundedQueue<TileJob> queue(depth);
+    std::mutex sinkMutex;
+    std::atomic<bool> failed{false};
+    bool stopped = false;
+    uint64_t tiles = 0;
+    uint64_t encodedBytes = 0;
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < threads; ++i)
+    {
+        workers.emplace_back([&]()
+        {
+            TileJob job;
+            std::vector<uint8_t> png;
+            while (queue.Pop(&job))
+            {
+                png.clear();
+                if (!EncodePng(job.image, &png, options.level))
+                {
+                    failed.store(true);
+                    queue.Cancel();
+                    break;
+                }
+
+                PyramidTile tile;
+                tile.level = job.level;
+                tile.column = job.column;
+                tile.row = job.row;
+                tile.width = job.image.width;
+                tile.height = job.image.height;
+                tile.data = png.data();
+                tile.size = png.size();
+                job.image.Reset();
+
+                std::lock_guard<std::mutex> lock(sinkMutex);
+                if (stopped)
+                    continue;
+                if (!sink(tile))
+                {
+                    stopped = true;
+                    queue.Cancel();
+                    continue;
+                }
+                tiles++;
+                encodedBytes += png.size();
+            }
+        });
+    }
+
+    // Largest level first; each level is cut, then halved while its tiles encode
+    const uint32_t levels = PyramidLevelCount(image.width, image.height);
+    PixelImage scratch[2];
+    const PixelImage* current = &image;
+    bool cutFailed = false;
+
+    for (uint32_t level = levels; level-- > 0 && !cutFailed;)
+    {
+        uint32_t columns, rows;
+        PyramidGridSize(current->width, current->height, options.tileSize, &columns, &rows);
+        for (uint32_t row = 0; row < rows && !cutFailed; ++row)
+        {
+            uint32_t y0, y1;
+            TileSpan(row, options.tileSize, options.overlap, current->height, &y0, &y1);
+            for (uint32_t column = 0; column < columns; ++column)
+            {
+                uint32_t x0, x1;
+                TileSpan(column, options.tileSize, options.overlap, current->width, &x0, &x1);
+
+                TileJob job;
+                job.level = level;
+                job.column = column;
+                job.row = row;
+                if (!job.image.Allocate(x1 - x0, y1 - y0))
+                {
+                    cutFailed = true;
+                    break;
+                }
+                job.image.alpha = current->alpha;
+                for (uint32_t y = y0; y < y1; ++y)
+                    memcpy(job.image.Row(y - y0), current->Row(y) + static_cast<size_t>(x0) * 4, static_cast<size_t>(x1 - x0) * 4);
+
+                // Fails once the sink stopped or an encode failed
+                if (!queue.Push(std::move(job)))
+                {
+                    cutFailed = true;
+                    break;
+                }
+            }
+        }
+
+        if (level > 0 && !cutFailed)
+        {
+            Clock::time_point start = Clock::now();
+            PixelImage& next = scratch[current == &scratch[0] ? 1 : 0];
+            if (!HalvePixelImage(*current, &next))
+                cutFailed = true;
+            current = &next;
+            result.downsampleMs += static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count());
+        }
+    }
+
+    queue.Close();
+    for (std::thread& worker : workers)
+        worker.join();
+
+    result.levels = levels;
+    result.tiles = tiles;
+    result.encodedBytes = encodedBytes;
+    result.stopped = stopped;
+    result.cutStallMs = queue.Stats().pushWaitMs;
+    result.ok = !cutFailed && !stopped && !failed.load();
+    return result;
+}
+
+bool DziDirectoryWriter::Open(const std::filesystem::path& dziPath, uint32_t width, uint32_t height, const PyramidOptions& options)
+{
+    std::error_code ec;
+    std::filesystem::path root = dziPath;
+    root.replace_filename(dziPath.stem().string() + "_files");
+    std::filesystem::create_directories(root, ec);
+    if (ec)
+        return false;
+
+    std::ofstream out(dziPath, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"png\" Overlap=\"" << options.overlap
+        << "\" TileSize=\"" << options.tileSize << "\">\n"
+        << "  <Size Width=\"" << width << "\" Height=\"" << height << "\"/>\n"
+        << "</Image>\n";
+    out.close();
+    if (!out)
+        return false;
+
+    m_tileRoot = root;
+    m_createdLevels = 0;
+    return true;
+}
+
+bool DziDirectoryWriter::WriteTile(const PyramidTile& tile)
+{
+    if (m_tileRoot.empty())
+        return false;
+
+    std::filesystem::path dir = m_tileRoot / std::to_string(tile.level);
+    if (tile.level >= 32 || !(m_createdLevels & (1u << tile.level)))
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if (ec)
+            return false;
+        if (tile.level < 32)
+            m_createdLevels |= 1u << tile.level;
+    }
+
+    std::ofstream out(dir / (std::to_string(tile.column) + "_" + std::to_string(tile.row) + ".png"),
+                      std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+    out.write(reinterpret_cast<const char*>(tile.data), static_cast<std::streamsize>(tile.size));
+    out.close();
+    return static_cast<bool>(out);
+}
+
+bool PyramidPackWriter::Create(const std::filesystem::path& path, uint32_t width, uint32_t height, const PyramidOptions& options)
+{
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file)
+        return false;
+
+    uint8_t header[PACK_HEADER_SIZE] = {};
+    memcpy(header, PACK_MAGIC, sizeof(PACK_MAGIC));
+    PutLE32(header + 8, VERSION);
+    PutLE32(header + 12, options.tileSize);
+    PutLE32(header + 16, options.overlap);
+    PutLE32(header + 20, width);
+    PutLE32(header + 24, height);
+    PutLE32(header + 28, PyramidLevelCount(width, height));
+    m_file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    m_offset = sizeof(header);
+    m_entries.clear();
+    return static_cast<bool>(m_file);
+}
+
+bool PyramidPackWriter::WriteTile(const PyramidTile& tile)
+{
+    if (!m_file.is_open())
+        return false;
+
+    m_file.write(reinterpret_cast<const char*>(tile.data), static_cast<std::streamsize>(tile.size));
+    if (!m_file)
+        return false;
+
+    Entry entry = { tile.level, tile.column, tile.row, m_offset, tile.size };
+    m_entries.push_back(entry);
+    m_offset += tile.size;
+    return true;
+}
+
+bool PyramidPackWriter::Finish()
+{
+    if (!m_file.is_open())
+        return false;
+
+    std::sort(m_entries.begin(), m_entries.end(), EntryLess<Entry>);
+
+    std::vector<uint8_t> index(m_entries.size() * PACK_ENTRY_SIZE + PACK_FOOTER_SIZE);
+    uint8_t* p = index.data();
+    for (const Entry& entry : m_entries)
+    {
+        PutLE32(p, entry.level);
+        PutLE32(p + 4, entry.column);
+        PutLE32(p + 8, entry.row);
+        PutLE32(p + 12, 0);
+        PutLE64(p + 16, entry.offset);
+        PutLE64(p + 24, entry.size);
+        p += PACK_ENTRY_SIZE;
+    }
+    PutLE64(p, m_offset);
+    PutLE32(p + 8, static_cast<uint32_t>(m_entries.size()));
+    memcpy(p + 12, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+
+    m_file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size()));
+    m_file.close();
+    return static_cast<bool>(m_file);
+}
+
+bool PyramidPackReader::Open(const std::filesystem::path& path)
+{
+    m_entries.clear();
+    m_file.open(path, std::ios::binary);
+    if (!m_file)
+        return false;
+
+    uint8_t header[PACK_HEADER_SIZE];
+    if (!m_file.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        memcmp(header, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 || GetLE32(header + 8) != PyramidPackWriter::VERSION)
+        return false;
+    m_tileSize = GetLE32(header + 12);
+    m_overlap = GetLE32(header + 16);
+    m_width = GetLE32(header + 20);
+    m_height = GetLE32(header + 24);
+    m_levels = GetLE32(header + 28);
+
+    uint8_t footer[PACK_FOOTER_SIZE];
+    m_file.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(m_file.tellg());
+    if (fileSize < PACK_HEADER_SIZE + PACK_FOOTER_SIZE)
+        return false;
+    m_file.seekg(static_cast<std::streamoff>(fileSize - PACK_FOOTER_SIZE));
+    if (!m_file.read(reinterpret_cast<char*>(footer), sizeof(footer)) || memcmp(footer + 12, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0)
+        return false;
+
+    uint64_t indexOffset = GetLE64(footer);
+    uint32_t count = GetLE32(footer + 8);
+    if (indexOffset < PACK_HEADER_SIZE || indexOffset + static_cast<uint64_t>(count) * PACK_ENTRY_SIZE + PACK_FOOTER_SIZE != fileSize)
+        return false;
+
+    std::vector<uint8_t> index(static_cast<size_t>(count) * PACK_ENTRY_SIZE);
+    m_file.seekg(static_cast<std::streamoff>(indexOffset));
+    if (!index.empty() && !m_file.read(reinterpret_cast<char*>(index.data()), static_cast<std::streamsize>(index.size())))
+        return false;
+
+    m_entries.resize(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const uint8_t* p = index.data() + static_cast<size_t>(i) * PACK_ENTRY_SIZE;
+        Entry& entry = m_entries[i];
+        entry.level = GetLE32(p);
+        entry.column = GetLE32(p + 4);
+        entry.row = GetLE32(p + 8);
+        entry.offset = GetLE64(p + 16);
+        entry.size = GetLE64(p + 24);
+        if (entry.offset < PACK_HEADER_SIZE || entry.offset + entry.size > indexOffset)
+        {
+            m_entries.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PyramidPackReader::ReadTile(uint32_t level, uint32_t column, uint32_t row, std::vector<uint8_t>* png)
+{
+    Entry key = { level, column, row, 0, 0 };
+    auto it = std::lower_bound(m_entries.begin(), m_entries.end(), key, EntryLess<Entry>);
+    if (it == m_entries.end() || it->level != level || it->column != column || it->row != row)
+        return false;
+
+    png->resize(static_cast<size_t>(it->size));
+    m_file.clear();
+    m_file.seekg(static_cast<std::streamoff>(it->offset));
+    return png->empty() || static_cast<bool>(m_file.read(reinterpret_cast<char*>(png->data()), static_cast<std::streamsize>(png->size())));
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include "ImageOps.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Deep-zoom (DZI layout) tile pyramid built from one full-resolution image. Levels are made
+// by repeated 2x downsampling (HalvePixelImage), cut into square tiles and PNG-encoded on
+// worker threads; tiles reach the sink as soon as they are encoded, largest level first.
+// Level 0 is 1x1, the last level is the source. No Windows dependencies.
+
+struct PyramidOptions
+{
+    uint32_t tileSize = 256;
+    uint32_t overlap = 1;           // Pixels each tile shares with its neighbours (DZI default)
+    uint32_t encodeThreads = 0;     // 0 = hardware threads (at most 8)
+    uint32_t queueDepth = 0;        // Tiles cut ahead of the encoders, 0 = 4 per thread
+    int level = 6;                  // Deflate level
+};
+
+struct PyramidTile
+{
+    uint32_t level = 0;
+    uint32_t column = 0;
+    uint32_t row = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    const uint8_t* data = nullptr;  // PNG file bytes
+    size_t size = 0;
+};
+
+struct PyramidResult
+{
+    bool ok = false;
+    bool stopped = false;           // The sink returned false
+    uint32_t levels = 0;
+    uint64_t tiles = 0;
+    uint64_t encodedBytes = 0;
+    uint64_t downsampleMs = 0;
+    uint64_t cutStallMs = 0;        // Cutting waited for the encoders (backpressure)
+};
+
+// Called once per tile, never concurrently; return false to stop
+typedef std::function<bool(const PyramidTile& tile)> PyramidSink;
+
+uint32_t PyramidLevelCount(uint32_t width, uint32_t height);
+
+// Size of a level and its tile grid
+void PyramidLevelSize(uint32_t width, uint32_t height, uint32_t level, uint32_t* pWidth, uint32_t* pHeight);
+void PyramidGridSize(uint32_t levelWidth, uint32_t levelHeight, uint32_t tileSize, uint32_t* pColumns, uint32_t* pRows);
+
+PyramidResult BuildZoomPyramid(const PixelImage& image, const PyramidOptions& options, const PyramidSink& sink);
+
+// DZI on disk: <name>.dzi descriptor next to <name>_files/<level>/<column>_<row>.png
+class DziDirectoryWriter
+{
+public:
+    // dziPath is the descriptor to create, e.g. C:\out\doc.dzi
+    bool Open(const std::filesystem::path& dziPath, uint32_t width, uint32_t height, const PyramidOptions& options);
+    bool WriteTile(const PyramidTile& tile);
+
+private:
+    std::filesystem::path m_tileRoot;
+    uint32_t m_createdLevels = 0;   // Bit per level whose directory exists (levels < 32)
+};
+
+// All tiles in one file. Layout (little-endian):
+//   header   "WSPZPACK", version, tileSize, overlap, width, height, levels   (32 bytes)
+//   tiles    PNG files back to back, in the order they were encoded
+//   index    per tile: level, column, row, 0, offset (u64), size (u64)      (32 bytes each)
+//   footer   index offset (u64), tile count (u32), "WSPI"                    (16 bytes)
+// The index is sorted by level, row, column.
+class PyramidPackWriter
+{
+public:
+    static const uint32_t VERSION = 1;
+
+    bool Create(const std::filesystem::path& path, uint32_t width, uint32_t height, const PyramidOptions& options);
+    bool WriteTile(const PyramidTile& tile);
+    bool Finish();
+
+private:
+    struct Entry
+    {
+        uint32_t level;
+        uint32_t column;
+        uint32_t row;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    std::ofstream m_file;
+    uint64_t m_offset = 0;
+    std::vector<Entry> m_entries;
+};
+
+class PyramidPackReader
+{
+public:
+    bool Open(const std::filesystem::path& path);
+
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+    uint32_t TileSize() const { return m_tileSize; }
+    uint32_t Overlap() const { return m_overlap; }
+    uint32_t Levels() const { return m_levels; }
+    size_t TileCount() const { return m_entries.size(); }
+
+    // Reads one tile's PNG bytes; false if the pack has no such tile
+    bool ReadTile(uint32_t level, uint32_t column, uint32_t row, std::vector<uint8_t>* png);
+
+private:
+    struct Entry
+    {
+        uint32_t level;
+        uint32_t column;
+        uint32_t row;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    std::ifstream m_file;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_tileSize = 0;
+    uint32_t m_overlap = 0;
+    uint32_t m_levels = 0;
+    std::vector<Entry> m_entries;
+};
@@ -0,0 +1,105 @@
+#include "Benchmark.h"
+#include "Deflate.h"
+#include "PngWriter.h"
+#include "ThumbnailAtlas.h"
+#include <random>
+#include <string>
+
+namespace fs = std::filesystem;
+
+// A gallery page of 96-pixel thumbnails written as one PNG each versus packed into atlas pages,
+// plus raw deflate throughput at a few levels on the same pixels.
+namespace
+{
+    PixelImage Thumbnail(uint32_t index, std::mt19937* random)
+    {
+        PixelImage image;
+        uint32_t width = 64 + (*random)() % 33;
+        uint32_t height = 64 + (*random)() % 33;
+        image.Allocate(width, height);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            uint8_t* p = image.Row(y);
+            for (uint32_t x = 0; x < width; ++x, p += 4)
+            {
+                p[0] = static_cast<uint8_t>(x * 3 + index);
+                p[1] = static_cast<uint8_t>(y * 2 + index * 7);
+                p[2] = static_cast<uint8_t>(((x / 8) ^ (y / 8)) * 16 + ((*random)() & 1));
+                p[3] = 255;
+            }
+        }
+        return image;
+    }
+
+    uint64_t DirectoryBytes(const fs::path& dir, size_t* files)
+    {
+        uint64_t bytes = 0;
+        *files = 0;
+        for (const fs::directory_entry& entry : fs::directory_iterator(dir))
+        {
+            bytes += entry.file_size();
+            ++*files;
+        }
+        return bytes;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t count = static_cast<uint32_t>(500 * BenchmarkScale(argc, argv));
+    std::mt19937 random(1);
+    std::vector<PixelImage> thumbnails;
+    for (uint32_t i = 0; i < count; ++i)
+        thumbnails.push_back(Thumbnail(i, &random));
+
+    fs::path root = fs::temp_directory_path() / ("wsp_atlas_benchmark_" + std::to_string(random()));
+    fs::create_directories(root / "single");
+    fs::create_directories(root / "atlas");
+
+    BenchmarkTimer timer;
+    for (uint32_t i = 0; i < count; ++i)
+        SavePixelImageAsPng(thumbnails[i], root / "single" / (std::to_string(i) + ".png"));
+    double singleMs = timer.Milliseconds();
+
+    timer.Restart();
+    ThumbnailAtlas atlas(2048, 2048, 1);
+    for (uint32_t i = 0; i < count; ++i)
+        atlas.Add(std::to_string(i), thumbnails[i], nullptr);
+    double packMs = timer.Milliseconds();
+    atlas.Save(root / "atlas" / "gallery");
+    double atlasMs = timer.Milliseconds();
+
+    size_t singleFiles = 0, atlasFiles = 0;
+    uint64_t singleBytes = DirectoryBytes(root / "single", &singleFiles);
+    uint64_t atlasBytes = DirectoryBytes(root / "atlas", &atlasFiles);
+
+    ReportResult("thumbnails", count, "");
+    ReportResult("one PNG per thumbnail", singleMs, "ms");
+    ReportResult("one PNG per thumbnail files", static_cast<double>(singleFiles), "");
+    ReportResult("one PNG per thumbnail size", singleBytes / 1024.0, "KB");
+    ReportResult("atlas packing", packMs, "ms");
+    ReportResult("atlas packing and save", atlasMs, "ms");
+    ReportResult("atlas files", static_cast<double>(atlasFiles), "");
+    ReportResult("atlas size", atlasBytes / 1024.0, "KB");
+
+    // Deflate alone over the scanline bytes of every thumbnail
+    std::vector<uint8_t> raw;
+    for (const PixelImage& image : thumbnails)
+    {
+        for (uint32_t y = 0; y < image.height; ++y)
+            raw.insert(raw.end(), image.Row(y), image.Row(y) + image.width * 4);
+    }
+    for (int level : { 1, 6, 9 })
+    {
+        timer.Restart();
+        std::vector<uint8_t> compressed = ZlibCompress(raw.data(), raw.size(), level);
+        double ms = timer.Milliseconds();
+        std::string name = "deflate level " + std::to_string(level);
+        ReportResult((name + " throughput").c_str(), raw.size() / 1048576.0 / (ms / 1000.0), "MB/s");
+        ReportResult((name + " ratio").c_str(), static_cast<double>(compressed.size()) / raw.size(), "");
+    }
+
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    return 0;
+}
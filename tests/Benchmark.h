@@ -0,0 +1,36 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// Shared helpers for the XxxBenchmark executables. Results are printed one per line as
+// "name: value unit" so runs can be compared with diff.
+
+class BenchmarkTimer
+{
+public:
+    BenchmarkTimer() : m_start(std::chrono::steady_clock::now()) {}
+
+    void Restart() { m_start = std::chrono::steady_clock::now(); }
+
+    double Milliseconds() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+inline void ReportResult(const char* name, double value, const char* unit)
+{
+    printf("%s: %.3f %s\n", name, value, unit);
+    fflush(stdout);
+}
+
+// First argument scales the workload (default 1), so a quick run is "XxxBenchmark 0.1"
+inline double BenchmarkScale(int argc, char** argv)
+{
+    double scale = argc > 1 ? atof(argv[1]) : 1.0;
+    return scale > 0.0 ? scale : 1.0;
+}
@@ -0,0 +1,49 @@
+#include "Benchmark.h"
+#include "BufferPool.h"
+#include <cstring>
+#include <memory>
+
+// Simulated thumbnail requests: a 256x256 and a 96x96 BGRA buffer plus resize scratch each,
+// allocated once per request from the pool and from the system allocator.
+int main(int argc, char** argv)
+{
+    const int requests = static_cast<int>(20000 * BenchmarkScale(argc, argv));
+    const size_t sizes[] = { 256 * 256 * 4, 96 * 96 * 4, 4096 * 4 };
+
+    BufferPool::ResetStats();
+    BenchmarkTimer timer;
+    for (int i = 0; i < requests; ++i)
+    {
+        PooledBuffer full(sizes[0]);
+        PooledBuffer small(sizes[1]);
+        ScratchArena scratch;
+        int32_t* acc = scratch.AllocateArray<int32_t>(sizes[2] / 4);
+        memset(full.Data(), i, 64);
+        memset(small.Data(), i, 64);
+        acc[0] = i;
+    }
+    double pooledMs = timer.Milliseconds();
+    BufferPoolStats stats = BufferPool::GetStats();
+
+    timer.Restart();
+    for (int i = 0; i < requests; ++i)
+    {
+        std::unique_ptr<uint8_t[]> full(new uint8_t[sizes[0]]);
+        std::unique_ptr<uint8_t[]> small(new uint8_t[sizes[1]]);
+        std::unique_ptr<int32_t[]> acc(new int32_t[sizes[2] / 4]);
+        memset(full.get(), i, 64);
+        memset(small.get(), i, 64);
+        acc[0] = i;
+    }
+    double systemMs = timer.Milliseconds();
+
+    ReportResult("requests", requests, "");
+    ReportResult("pool system allocations", static_cast<double>(stats.systemAllocCount), "");
+    ReportResult("pool reuse rate", 100.0 * stats.reuseCount / stats.acquireCount, "%");
+    ReportResult("pool peak bytes in use", static_cast<double>(stats.peakBytesInUse), "bytes");
+    ReportResult("arena peak", static_cast<double>(stats.arenaPeakBytes), "bytes");
+    ReportResult("system allocations without pool", 3.0 * requests, "");
+    ReportResult("pooled", pooledMs * 1000.0 / requests, "us/request");
+    ReportResult("system allocator", systemMs * 1000.0 / requests, "us/request");
+    return 0;
+}
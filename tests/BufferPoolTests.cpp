@@ -0,0 +1,244 @@
+#include "TestHarness.h"
+#include "BufferPool.h"
+#include <cstring>
+#include <thread>
+
+namespace
+{
+    bool IsAligned(const void* p, size_t alignment)
+    {
+        return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+    }
+}
+
+TEST_CASE(AcquireRoundsUpToSizeClass)
+{
+    BufferPool::TrimCurrentThread();
+    size_t capacity = 0;
+    void* p = BufferPool::Acquire(5000, &capacity);
+    REQUIRE(p);
+    CHECK_EQ(capacity, size_t(8192));
+    CHECK(IsAligned(p, BufferPool::ALIGNMENT));
+    memset(p, 0xAB, 5000);
+    BufferPool::Release(p, capacity);
+
+    void* small = BufferPool::Acquire(0, &capacity);
+    REQUIRE(small);
+    CHECK_EQ(capacity, BufferPool::MIN_CLASS_SIZE);
+    BufferPool::Release(small, capacity);
+}
+
+TEST_CASE(ReleasedBufferIsReusedOnSameThread)
+{
+    BufferPool::TrimCurrentThread();
+    BufferPool::ResetStats();
+
+    size_t capacity = 0;
+    void* first = BufferPool::Acquire(100000, &capacity);
+    REQUIRE(first);
+    BufferPool::Release(first, capacity);
+
+    size_t again = 0;
+    void* second = BufferPool::Acquire(70000, &again);
+    CHECK(second == first);
+    CHECK_EQ(again, capacity);
+    BufferPool::Release(second, again);
+
+    BufferPoolStats stats = BufferPool::GetStats();
+    CHECK_EQ(stats.acquireCount, uint64_t(2));
+    CHECK_EQ(stats.reuseCount, uint64_t(1));
+    CHECK_EQ(stats.systemAllocCount, uint64_t(1));
+    BufferPool::TrimCurrentThread();
+}
+
+TEST_CASE(OversizedRequestsBypassThePool)
+{
+    BufferPool::TrimCurrentThread();
+    BufferPool::ResetStats();
+
+    size_t bytes = BufferPool::MAX_CLASS_SIZE + 1;
+    size_t capacity = 0;
+    void* p = BufferPool::Acquire(bytes, &capacity);
+    REQUIRE(p);
+    CHECK_EQ(capacity % BufferPool::ALIGNMENT, size_t(0));
+    CHECK(capacity >= bytes && capacity < bytes + BufferPool::ALIGNMENT);
+    BufferPool::Release(p, capacity);
+
+    BufferPoolStats stats = BufferPool::GetStats();
+    CHECK_EQ(stats.systemFreeCount, uint64_t(1));
+    CHECK_EQ(stats.bytesCached, uint64_t(0));
+}
+
+TEST_CASE(FreeListIsBoundedPerClass)
+{
+    BufferPool::TrimCurrentThread();
+    BufferPool::ResetStats();
+
+    const size_t count = BufferPool::MAX_CACHED_PER_CLASS + 3;
+    void* buffers[count];
+    size_t capacity = 0;
+    for (size_t i = 0; i < count; ++i)
+        buffers[i] = BufferPool::Acquire(4096, &capacity);
+    for (size_t i = 0; i < count; ++i)
+        BufferPool::Release(buffers[i], capacity);
+
+    BufferPoolStats stats = BufferPool::GetStats();
+    CHECK_EQ(stats.systemFreeCount, uint64_t(3));
+    CHECK_EQ(stats.bytesCached, uint64_t(BufferPool::MAX_CACHED_PER_CLASS * 4096));
+
+    BufferPool::TrimCurrentThread();
+    stats = BufferPool::GetStats();
+    CHECK_EQ(stats.bytesCached, uint64_t(0));
+    CHECK_EQ(stats.systemFreeCount, uint64_t(count));
+}
+
+TEST_CASE(BytesInUseAndPeakFollowOutstandingBuffers)
+{
+    BufferPool::TrimCurrentThread();
+    BufferPool::ResetStats();
+    uint64_t base = BufferPool::GetStats().bytesInUse;
+
+    size_t a = 0, b = 0;
+    void* pa = BufferPool::Acquire(16384, &a);
+    void* pb = BufferPool::Acquire(32768, &b);
+    CHECK_EQ(BufferPool::GetStats().bytesInUse, base + a + b);
+    BufferPool::Release(pa, a);
+    BufferPool::Release(pb, b);
+
+    BufferPoolStats stats = BufferPool::GetStats();
+    CHECK_EQ(stats.bytesInUse, base);
+    CHECK_EQ(stats.peakBytesInUse, base + a + b);
+    BufferPool::TrimCurrentThread();
+}
+
+TEST_CASE(BufferReleasedOnAnotherThreadMovesToThatThreadsCache)
+{
+    BufferPool::TrimCurrentThread();
+    BufferPool::ResetStats();
+
+    size_t capacity = 0;
+    void* p = BufferPool::Acquire(8192, &capacity);
+    std::thread([&]()
+    {
+        BufferPool::Release(p, capacity);
+        CHECK_EQ(BufferPool::GetStats().bytesCached, uint64_t(capacity));
+    }).join();
+
+    // The other thread's cache was freed when it exited
+    BufferPoolStats stats = BufferPool::GetStats();
+    CHECK_EQ(stats.bytesCached, uint64_t(0));
+    CHECK_EQ(stats.systemFreeCount, uint64_t(1));
+}
+
+TEST_CASE(PooledBufferMovesOwnership)
+{
+    BufferPool::TrimCurrentThread();
+    PooledBuffer a(1000);
+    REQUIRE(!a.Empty());
+    CHECK_EQ(a.Size(), size_t(1000));
+    CHECK_EQ(a.Capacity(), BufferPool::MIN_CLASS_SIZE);
+    uint8_t* data = a.Data();
+
+    PooledBuffer b(std::move(a));
+    CHECK(a.Empty());
+    CHECK(b.Data() == data);
+
+    PooledBuffer c;
+    c = std::move(b);
+    CHECK(b.Empty());
+    CHECK(c.Data() == data);
+
+    c.Reset();
+    CHECK(c.Empty());
+    CHECK_EQ(c.Size(), size_t(0));
+    BufferPool::TrimCurrentThread();
+}
+
+TEST_CASE(ArenaHonorsAlignment)
+{
+    ScratchArena arena;
+    for (size_t alignment : { 1, 2, 8, 16, 64, 128, 4096 })
+    {
+        arena.Allocate(3);
+        void* p = arena.Allocate(10, alignment);
+        REQUIRE(p);
+        CHECK(IsAligned(p, alignment));
+    }
+    CHECK(arena.Allocate(16, 3) == nullptr);
+    CHECK(arena.Allocate(16, 0) == nullptr);
+
+    double* values = arena.AllocateArray<double>(100);
+    REQUIRE(values);
+    CHECK(IsAligned(values, 16));
+}
+
+TEST_CASE(ArenaAllocationsDoNotOverlap)
+{
+    ScratchArena arena(4096);
+    std::vector<std::pair<uint8_t*, size_t>> blocks;
+    for (size_t i = 0; i < 200; ++i)
+    {
+        size_t size = 1 + (i * 37) % 3000;
+        uint8_t* p = static_cast<uint8_t*>(arena.Allocate(size));
+        REQUIRE(p);
+        memset(p, static_cast<int>(i), size);
+        blocks.push_back(std::make_pair(p, size));
+    }
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        for (size_t k = 0; k < blocks[i].second; ++k)
+            REQUIRE(blocks[i].first[k] == static_cast<uint8_t>(i));
+    }
+}
+
+TEST_CASE(ArenaLargerThanBlockGetsItsOwnBlock)
+{
+    ScratchArena arena(4096);
+    uint8_t* big = static_cast<uint8_t*>(arena.Allocate(1 << 20));
+    REQUIRE(big);
+    memset(big, 1, 1 << 20);
+    CHECK(arena.BytesUsed() >= size_t(1 << 20));
+    CHECK(arena.PeakBytes() >= size_t(1 << 20));
+}
+
+TEST_CASE(ArenaResetKeepsFirstBlockAndReusesIt)
+{
+    BufferPool::TrimCurrentThread();
+    ScratchArena arena(16384);
+    arena.Allocate(1000);
+    arena.Allocate(100000);
+    size_t peak = arena.PeakBytes();
+    arena.Reset();
+    CHECK_EQ(arena.BytesUsed(), size_t(0));
+    CHECK_EQ(arena.PeakBytes(), peak);
+
+    BufferPool::ResetStats();
+    for (int round = 0; round < 10; ++round)
+    {
+        REQUIRE(arena.Allocate(8000));
+        arena.Reset();
+    }
+    CHECK_EQ(BufferPool::GetStats().systemAllocCount, uint64_t(0));
+    BufferPool::TrimCurrentThread();
+}
+
+TEST_CASE(ArenaBlocksAreRecycledAcrossRequests)
+{
+    BufferPool::TrimCurrentThread();
+    {
+        ScratchArena warmup;
+        warmup.Allocate(1000);
+    }
+
+    BufferPool::ResetStats();
+    for (int request = 0; request < 20; ++request)
+    {
+        ScratchArena arena;
+        REQUIRE(arena.AllocateArray<int32_t>(1000));
+    }
+    BufferPoolStats stats = BufferPool::GetStats();
+    CHECK_EQ(stats.systemAllocCount, uint64_t(0));
+    CHECK_EQ(stats.reuseCount, uint64_t(20));
+    CHECK(stats.arenaPeakBytes >= 4000);
+    BufferPool::TrimCurrentThread();
+}
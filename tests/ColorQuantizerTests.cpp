@@ -0,0 +1,113 @@
+#include "TestHarness.h"
+#include "ColorQuantizer.h"
+#include <random>
+
+TEST_CASE(HistogramBinsByTopBits)
+{
+    ColorHistogram histogram(5);
+    CHECK_EQ(histogram.BinCount(), uint32_t(32768));
+    CHECK_EQ(histogram.BinOf(0, 0, 0), uint32_t(0));
+    CHECK_EQ(histogram.BinOf(7, 7, 7), uint32_t(0));
+    CHECK_EQ(histogram.BinOf(255, 0, 0), uint32_t(31 << 10));
+    CHECK_EQ(histogram.BinOf(0, 8, 0), uint32_t(1 << 5));
+
+    histogram.Add(10, 20, 30);
+    histogram.Add(12, 22, 28);
+    uint32_t bin = histogram.BinOf(10, 20, 30);
+    CHECK_EQ(histogram.Count(bin), uint32_t(2));
+    CHECK_EQ(histogram.Sum(bin, 0), uint64_t(22));
+    CHECK_EQ(histogram.Sum(bin, 2), uint64_t(58));
+    CHECK_EQ(histogram.Total(), uint64_t(2));
+
+    histogram.Clear();
+    CHECK_EQ(histogram.Count(bin), uint32_t(0));
+    CHECK_EQ(histogram.Total(), uint64_t(0));
+
+    // Out-of-range resolutions are clamped
+    CHECK_EQ(ColorHistogram(0).Bits(), uint32_t(1));
+    CHECK_EQ(ColorHistogram(12).Bits(), uint32_t(8));
+}
+
+TEST_CASE(FewColorsComeBackExactlyMostCommonFirst)
+{
+    ColorHistogram histogram(5);
+    for (int i = 0; i < 50; ++i)
+        histogram.Add(200, 10, 10);
+    for (int i = 0; i < 30; ++i)
+        histogram.Add(10, 200, 10);
+    for (int i = 0; i < 20; ++i)
+        histogram.Add(10, 10, 200);
+
+    std::vector<QuantizedColor> colors = MedianCut(histogram, 256);
+    REQUIRE(colors.size() == 3);
+    CHECK(colors[0].r == 200 && colors[0].g == 10 && colors[0].count == 50);
+    CHECK(colors[1].g == 200 && colors[1].count == 30);
+    CHECK(colors[2].b == 200 && colors[2].count == 20);
+}
+
+TEST_CASE(PaletteIsBoundedAndCoversEveryPixel)
+{
+    ColorHistogram histogram(5);
+    std::mt19937 random(3);
+    for (int i = 0; i < 100000; ++i)
+        histogram.Add(random() & 255, random() & 255, random() & 255);
+
+    for (uint32_t maxColors : { 1u, 2u, 16u, 256u })
+    {
+        std::vector<QuantizedColor> colors = MedianCut(histogram, maxColors);
+        CHECK_EQ(colors.size(), size_t(maxColors));
+        uint64_t total = 0;
+        for (size_t i = 0; i < colors.size(); ++i)
+        {
+            total += colors[i].count;
+            if (i > 0)
+                CHECK(colors[i - 1].count >= colors[i].count);
+        }
+        CHECK_EQ(total, histogram.Total());
+    }
+
+    // One box is the average of everything
+    std::vector<QuantizedColor> one = MedianCut(histogram, 1);
+    CHECK(one[0].r > 120 && one[0].r < 135);
+}
+
+TEST_CASE(EntriesAreTrueAveragesNotBinCenters)
+{
+    // Two shades in one 3-bit bin and one far away; with two colors the shades merge
+    ColorHistogram histogram(3);
+    histogram.Add(1, 1, 1);
+    histogram.Add(3, 3, 3);
+    histogram.Add(250, 250, 250);
+    std::vector<QuantizedColor> colors = MedianCut(histogram, 2);
+    REQUIRE(colors.size() == 2);
+    CHECK(colors[0].r == 2 && colors[0].count == 2);
+    CHECK(colors[1].r == 250);
+}
+
+TEST_CASE(MedianCutIsDeterministic)
+{
+    ColorHistogram a(5), b(5);
+    std::mt19937 random(9);
+    std::vector<uint32_t> pixels(20000);
+    for (uint32_t& pixel : pixels)
+        pixel = random() & 0xFFFFFF;
+    for (uint32_t pixel : pixels)
+        a.Add(pixel & 255, (pixel >> 8) & 255, pixel >> 16);
+    // Same pixels in the opposite order
+    for (size_t i = pixels.size(); i-- > 0;)
+        b.Add(pixels[i] & 255, (pixels[i] >> 8) & 255, pixels[i] >> 16);
+
+    std::vector<QuantizedColor> x = MedianCut(a, 64);
+    std::vector<QuantizedColor> y = MedianCut(b, 64);
+    REQUIRE(x.size() == y.size());
+    for (size_t i = 0; i < x.size(); ++i)
+        CHECK(x[i].r == y[i].r && x[i].g == y[i].g && x[i].b == y[i].b && x[i].count == y[i].count);
+}
+
+TEST_CASE(EmptyHistogramHasNoColors)
+{
+    ColorHistogram histogram(5);
+    CHECK(MedianCut(histogram, 256).empty());
+    histogram.Add(1, 2, 3);
+    CHECK(MedianCut(histogram, 0).empty());
+}
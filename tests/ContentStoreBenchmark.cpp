@@ -0,0 +1,91 @@
+#include "Benchmark.h"
+#include "ContentStore.h"
+#include "PngWriter.h"
+#include <random>
+#include <string>
+
+namespace fs = std::filesystem;
+
+// Synthetic share: most files have a unique thumbnail, some are copies of another file, and
+// the rest fall back to one of a few generic type icons. Stores the corpus with the
+// content-addressed store and with one PNG per file, and reports the dedup ratio.
+namespace
+{
+    PixelImage Thumbnail(uint32_t seed, uint32_t size)
+    {
+        PixelImage image;
+        image.Allocate(size, size);
+        for (uint32_t y = 0; y < size; ++y)
+        {
+            uint8_t* p = image.Row(y);
+            for (uint32_t x = 0; x < size; ++x, p += 4)
+            {
+                p[0] = static_cast<uint8_t>(x * 2 + seed * 13);
+                p[1] = static_cast<uint8_t>(y * 2 + seed * 7);
+                p[2] = static_cast<uint8_t>(((x + seed) ^ y) & 0xf0);
+                p[3] = 255;
+            }
+        }
+        return image;
+    }
+
+    uint64_t DirectoryBytes(const fs::path& dir)
+    {
+        uint64_t bytes = 0;
+        for (fs::recursive_directory_iterator it(dir), end; it != end; ++it)
+        {
+            if (it->is_regular_file())
+                bytes += it->file_size();
+        }
+        return bytes;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t files = static_cast<uint32_t>(2000 * BenchmarkScale(argc, argv));
+    const uint32_t ICONS = 12;
+
+    // 60% unique, 25% copies of an earlier file, 15% generic icons
+    std::mt19937 random(1);
+    std::vector<uint32_t> content(files);
+    for (uint32_t i = 0; i < files; ++i)
+    {
+        uint32_t roll = random() % 100;
+        if (roll < 15)
+            content[i] = random() % ICONS;
+        else if (roll < 40 && i > 0)
+            content[i] = content[random() % i];
+        else
+            content[i] = ICONS + i;
+    }
+
+    fs::path root = fs::temp_directory_path() / ("wsp_store_benchmark_" + std::to_string(random()));
+    fs::create_directories(root / "plain");
+
+    BenchmarkTimer timer;
+    for (uint32_t i = 0; i < files; ++i)
+        SavePixelImageAsPng(Thumbnail(content[i], 96), root / "plain" / (std::to_string(i) + ".png"));
+    double plainMs = timer.Milliseconds();
+
+    timer.Restart();
+    ContentStore store(root / "store");
+    store.Open();
+    for (uint32_t i = 0; i < files; ++i)
+        store.Put("/share/file" + std::to_string(i) + "|1000", Thumbnail(content[i], 96), nullptr, nullptr);
+    double storeMs = timer.Milliseconds();
+
+    ContentStoreStats stats = store.Stats();
+    ReportResult("files", files, "");
+    ReportResult("distinct images", static_cast<double>(stats.objects), "");
+    ReportResult("encodes skipped", static_cast<double>(stats.encodesSkipped), "");
+    ReportResult("dedup ratio (logical / stored)", static_cast<double>(stats.logicalBytes) / stats.storedBytes, "");
+    ReportResult("one PNG per file", plainMs, "ms");
+    ReportResult("one PNG per file size", DirectoryBytes(root / "plain") / 1024.0, "KB");
+    ReportResult("content-addressed store", storeMs, "ms");
+    ReportResult("content-addressed store size", DirectoryBytes(root / "store") / 1024.0, "KB");
+
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    return 0;
+}
@@ -0,0 +1,277 @@
+#include "TestHarness.h"
+#include "ContentHash.h"
+#include "ContentStore.h"
+#include "ReferenceCodecs.h"
+#include "TestData.h"
+#include <algorithm>
+#include <fstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+using TestData::ReadFile;
+
+namespace
+{
+    PixelImage Pattern(uint32_t width, uint32_t height, uint32_t seed, AlphaMode alpha = AlphaMode::Ignore)
+    {
+        PixelImage image;
+        image.Allocate(width, height);
+        image.alpha = alpha;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            uint8_t* p = image.Row(y);
+            for (uint32_t x = 0; x < width; ++x, p += 4)
+            {
+                p[0] = static_cast<uint8_t>(x * 5 + seed * 31);
+                p[1] = static_cast<uint8_t>(y * 3 + seed * 17);
+                p[2] = static_cast<uint8_t>((x ^ y) + seed);
+                p[3] = alpha == AlphaMode::Ignore ? 255 : static_cast<uint8_t>(128 + (x & 127));
+            }
+        }
+        return image;
+    }
+
+    // The object behind ref exists and decodes to image
+    bool StoredAs(const ContentStore& store, const std::string& ref, const PixelImage& image)
+    {
+        uint64_t hash = 0;
+        if (!store.Find(ref, &hash))
+            return false;
+        Reference::DecodedPng decoded;
+        return Reference::DecodePng(ReadFile(store.ObjectPath(hash)), &decoded) && Reference::FirstMismatch(image, decoded) == -1;
+    }
+
+    size_t CountFiles(const fs::path& dir)
+    {
+        size_t count = 0;
+        for (fs::recursive_directory_iterator it(dir), end; it != end; ++it)
+            count += it->is_regular_file() ? 1 : 0;
+        return count;
+    }
+}
+
+TEST_CASE(Xxh64MatchesReferenceVectors)
+{
+    CHECK_EQ(HashXxh64("", 0), 0xef46db3751d8e999ull);
+    CHECK_EQ(HashXxh64("a", 1), 0xd24ec4f1a98c6e5bull);
+    CHECK_EQ(HashXxh64("abc", 3), 0x44bc2cf5ad770999ull);
+
+    // Streaming in odd pieces matches one call, across the 32-byte stripe boundary
+    std::vector<uint8_t> data(1000);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 7);
+    for (size_t piece : { 1, 3, 31, 33, 500 })
+    {
+        Xxh64 state(42);
+        for (size_t pos = 0; pos < data.size(); pos += piece)
+            state.Update(data.data() + pos, (std::min)(piece, data.size() - pos));
+        CHECK_EQ(state.Digest(), HashXxh64(data.data(), data.size(), 42));
+    }
+
+    uint64_t parsed = 0;
+    CHECK_EQ(HashToHex(0x0123456789abcdefull), std::string("0123456789abcdef"));
+    CHECK(HexToHash("0123456789abcdef", &parsed) && parsed == 0x0123456789abcdefull);
+    CHECK(!HexToHash("0123456789abcdeg", &parsed));
+    CHECK(!HexToHash("abc", &parsed));
+}
+
+TEST_CASE(ImageHashIgnoresStridePaddingButNotFormat)
+{
+    PixelImage image = Pattern(13, 9, 1);
+    PixelImage padded;
+    REQUIRE(padded.Allocate(13, 9));
+    CHECK(padded.stride >= image.stride);
+    for (uint32_t y = 0; y < 9; ++y)
+        memcpy(padded.Row(y), image.Row(y), 13 * 4);
+    CHECK_EQ(ContentStore::HashImage(padded), ContentStore::HashImage(image));
+
+    padded.alpha = AlphaMode::Straight;
+    CHECK(ContentStore::HashImage(padded) != ContentStore::HashImage(image));
+}
+
+TEST_CASE(IdenticalImagesAreEncodedOnce)
+{
+    TestHarness::TempDirectory dir;
+    ContentStore store(dir.Path());
+    REQUIRE(store.Open());
+
+    PixelImage icon = Pattern(48, 48, 7, AlphaMode::Straight);
+    for (int i = 0; i < 10; ++i)
+    {
+        bool reused = false;
+        REQUIRE(store.Put("file" + std::to_string(i) + ".txt|100", icon, nullptr, &reused));
+        CHECK_EQ(reused, i > 0);
+    }
+    PixelImage photo = Pattern(64, 40, 8);
+    REQUIRE(store.Put("photo.jpg|5000", photo, nullptr, nullptr));
+
+    ContentStoreStats stats = store.Stats();
+    CHECK_EQ(stats.refs, uint64_t(11));
+    CHECK_EQ(stats.objects, uint64_t(2));
+    CHECK_EQ(stats.encodesSkipped, uint64_t(9));
+    CHECK(stats.logicalBytes > stats.storedBytes * 4);
+    CHECK(StoredAs(store, "file3.txt|100", icon));
+    CHECK(StoredAs(store, "photo.jpg|5000", photo));
+}
+
+TEST_CASE(UnreferencedObjectsWaitForGarbageCollection)
+{
+    TestHarness::TempDirectory dir;
+    ContentStore store(dir.Path());
+    REQUIRE(store.Open());
+
+    uint64_t oldHash = 0, newHash = 0;
+    REQUIRE(store.Put("a|1", Pattern(20, 20, 1), &oldHash, nullptr));
+    REQUIRE(store.Put("a|1", Pattern(20, 20, 2), &newHash, nullptr));     // The file changed
+    CHECK(oldHash != newHash);
+    CHECK_EQ(store.Stats().garbageObjects, uint64_t(1));
+
+    // Until collected, the old image can come back without an encode
+    bool reused = false;
+    REQUIRE(store.Put("b|1", Pattern(20, 20, 1), nullptr, &reused));
+    CHECK(reused);
+    CHECK(store.Remove("b|1"));
+    CHECK(!store.Remove("b|1"));
+
+    CHECK(store.CollectGarbage() > 0);
+    CHECK(!fs::exists(store.ObjectPath(oldHash)));
+    CHECK(fs::exists(store.ObjectPath(newHash)));
+    CHECK_EQ(store.Stats().objects, uint64_t(1));
+    CHECK_EQ(store.CollectGarbage(), uint64_t(0));
+}
+
+TEST_CASE(RemovePrefixDropsAFolder)
+{
+    TestHarness::TempDirectory dir;
+    ContentStore store(dir.Path());
+    REQUIRE(store.Open());
+    PixelImage image = Pattern(8, 8, 3);
+    for (const char* ref : { "c:\\a\\1|1", "c:\\a\\2|1", "c:\\a\\sub\\3|1", "c:\\ab|1", "c:\\b\\4|1" })
+        REQUIRE(store.Put(ref, image, nullptr, nullptr));
+    CHECK_EQ(store.RemovePrefix("c:\\a\\"), size_t(3));
+    CHECK(store.Find("c:\\ab|1", nullptr));
+    CHECK(store.Find("c:\\b\\4|1", nullptr));
+    CHECK_EQ(store.Stats().refs, uint64_t(2));
+}
+
+TEST_CASE(ReferencesSurviveReopenAndTornJournalLines)
+{
+    TestHarness::TempDirectory dir;
+    PixelImage first = Pattern(30, 30, 1);
+    PixelImage second = Pattern(30, 30, 2);
+    uint64_t secondHash = 0;
+    {
+        ContentStore store(dir.Path());
+        REQUIRE(store.Open());
+        REQUIRE(store.Put("one|1", first, nullptr, nullptr));
+        REQUIRE(store.Put("two|1", second, &secondHash, nullptr));
+        REQUIRE(store.Put("three|1", first, nullptr, nullptr));
+        REQUIRE(store.Remove("three|1"));
+    }
+
+    // A crash mid-append leaves half a line; a reference whose object vanished is dropped too
+    {
+        std::ofstream journal(dir / "refs.log", std::ios::binary | std::ios::app);
+        journal << "+ 00000000deadbeef 10 ghost|1\n";
+        journal << "+ " << HashToHex(secondHash).substr(0, 7);
+    }
+
+    ContentStore store(dir.Path());
+    REQUIRE(store.Open());
+    ContentStoreStats stats = store.Stats();
+    CHECK_EQ(stats.refs, uint64_t(2));
+    CHECK_EQ(stats.objects, uint64_t(2));
+    CHECK(!store.Find("three|1", nullptr));
+    CHECK(!store.Find("ghost|1", nullptr));
+    CHECK(StoredAs(store, "one|1", first));
+    CHECK(StoredAs(store, "two|1", second));
+
+    // Open rewrote the journal without the torn line
+    std::vector<uint8_t> journal = ReadFile(dir / "refs.log");
+    CHECK(!journal.empty() && journal.back() == '\n');
+}
+
+TEST_CASE(OrphanFilesFromACrashAreCollected)
+{
+    TestHarness::TempDirectory dir;
+    {
+        ContentStore store(dir.Path());
+        REQUIRE(store.Open());
+        REQUIRE(store.Put("kept|1", Pattern(10, 10, 1), nullptr, nullptr));
+    }
+    fs::create_directories(dir / "objects" / "ab");
+    std::ofstream(dir / "objects" / "ab" / "abababababababab.png") << "object written before the journal line";
+    std::ofstream(dir / "objects" / "ab" / "abababababababab.png.3.tmp") << "torn";
+
+    ContentStore store(dir.Path());
+    REQUIRE(store.Open());
+    CHECK(store.CollectGarbage() > 0);
+    CHECK_EQ(CountFiles(dir / "objects"), size_t(1));
+    CHECK(store.Find("kept|1", nullptr));
+}
+
+TEST_CASE(JournalIsCompactedAsItGrows)
+{
+    TestHarness::TempDirectory dir;
+    PixelImage image = Pattern(4, 4, 1);
+    {
+        ContentStore store(dir.Path());
+        REQUIRE(store.Open());
+        for (int i = 0; i < 3000; ++i)
+        {
+            REQUIRE(store.Put("churn|" + std::to_string(i % 10), image, nullptr, nullptr));
+            if (i % 2)
+                REQUIRE(store.Remove("churn|" + std::to_string(i % 10)));
+        }
+    }
+    // 3000 puts and 1500 removes, but never more than 10 live references
+    CHECK(fs::file_size(dir / "refs.log") < 1024 * 2 * 60);
+
+    ContentStore store(dir.Path());
+    REQUIRE(store.Open());
+    CHECK_EQ(store.Stats().refs, uint64_t(5));
+}
+
+TEST_CASE(ConcurrentPutsKeepCountsConsistent)
+{
+    TestHarness::TempDirectory dir;
+    ContentStore store(dir.Path());
+    REQUIRE(store.Open());
+
+    std::vector<PixelImage> images;
+    for (uint32_t i = 0; i < 5; ++i)
+        images.push_back(Pattern(40, 40, i));
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t)
+    {
+        threads.emplace_back([&store, &images, t]()
+        {
+            for (int i = 0; i < 50; ++i)
+                store.Put("t" + std::to_string(t) + "/" + std::to_string(i), images[(t + i) % 5], nullptr, nullptr);
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    ContentStoreStats stats = store.Stats();
+    CHECK_EQ(stats.refs, uint64_t(400));
+    CHECK_EQ(stats.objects, uint64_t(5));
+    for (uint32_t i = 0; i < 5; ++i)
+        CHECK(StoredAs(store, "t0/" + std::to_string(i), images[i % 5]));
+
+    store.CollectGarbage();
+    CHECK_EQ(CountFiles(dir / "objects"), size_t(5));
+}
+
+TEST_CASE(StoreMustBeOpened)
+{
+    TestHarness::TempDirectory dir;
+    ContentStore store(dir.Path());
+    CHECK(!store.Put("a|1", Pattern(4, 4, 1), nullptr, nullptr));
+    REQUIRE(store.Open());
+    CHECK(!store.Put("bad\nref", Pattern(4, 4, 1), nullptr, nullptr));
+    CHECK(!store.Put("", Pattern(4, 4, 1), nullptr, nullptr));
+    CHECK(!store.Put("empty|1", PixelImage(), nullptr, nullptr));
+}
@@ -0,0 +1,259 @@
+#include "TestHarness.h"
+#include "Deflate.h"
+#include "ReferenceCodecs.h"
+#include <algorithm>
+#include <random>
+#include <string>
+
+namespace
+{
+    std::vector<uint8_t> RandomBytes(size_t size, uint32_t seed, int alphabet = 256)
+    {
+        std::mt19937 random(seed);
+        std::vector<uint8_t> data(size);
+        for (uint8_t& b : data)
+            b = static_cast<uint8_t>(256 - alphabet + random() % alphabet);
+        return data;
+    }
+
+    // Words over a small vocabulary: long matches at every distance, like filtered scanlines
+    std::vector<uint8_t> TextLike(size_t size, uint32_t seed)
+    {
+        static const char* WORDS[] = { "thumbnail ", "preview ", "\xe9\x81\xb8\xe6\x8a\x9e ", "atlas ",
+                                       "\xff\xfe\x90", "page ", "\x80\x81\x82\x83 ", "skyline " };
+        std::mt19937 random(seed);
+        std::vector<uint8_t> data;
+        while (data.size() < size)
+        {
+            const char* word = WORDS[random() % 8];
+            data.insert(data.end(), word, word + strlen(word));
+        }
+        data.resize(size);
+        return data;
+    }
+
+    std::vector<uint8_t> RawDeflate(const std::vector<uint8_t>& data, int level)
+    {
+        DeflateEncoder encoder(level);
+        std::vector<uint8_t> out;
+        encoder.Write(data.data(), data.size(), &out);
+        encoder.Flush(DeflateFlush::Finish, &out);
+        return out;
+    }
+
+    // BTYPE of the first block of a raw deflate stream: 0 stored, 1 fixed, 2 dynamic
+    int FirstBlockType(const std::vector<uint8_t>& deflate)
+    {
+        return deflate.empty() ? -1 : (deflate[0] >> 1) & 3;
+    }
+}
+
+// Short inputs are cheapest with the fixed code, whose literals 144..255 take 9 bits. Every
+// byte value at every length up to 64 must come back through zlib's inflate.
+TEST_CASE(FixedHuffmanBlocksDecodeWithZlib)
+{
+    int fixedBlocks = 0;
+    for (int level = 1; level <= 9; ++level)
+    {
+        for (size_t size = 1; size <= 64; ++size)
+        {
+            for (uint32_t seed = 0; seed < 4; ++seed)
+            {
+                // Seeds 0 and 1 use only bytes >= 144, the range a short table gets wrong
+                std::vector<uint8_t> data = RandomBytes(size, seed * 1000 + static_cast<uint32_t>(size), seed < 2 ? 112 : 256);
+                std::vector<uint8_t> deflate = RawDeflate(data, level);
+                if (FirstBlockType(deflate) == 1)
+                    fixedBlocks++;
+
+                std::vector<uint8_t> inflated;
+                REQUIRE(Reference::Inflate(deflate, &inflated, -15));
+                REQUIRE(inflated == data);
+            }
+        }
+    }
+    CHECK(fixedBlocks > 1000);
+}
+
+TEST_CASE(EveryByteValueRoundTripsInEachBlockType)
+{
+    std::vector<uint8_t> all(512);
+    for (int i = 0; i < 512; ++i)
+        all[i] = static_cast<uint8_t>(i);
+
+    // Fixed (every literal once, then one match), dynamic (many repeats of a skewed mix) and stored (incompressible)
+    std::vector<uint8_t> skewed;
+    for (int r = 0; r < 200; ++r)
+    {
+        skewed.insert(skewed.end(), all.rbegin(), all.rbegin() + 256);
+        skewed.insert(skewed.end(), 50, static_cast<uint8_t>(200 + r % 50));
+    }
+    std::vector<uint8_t> noise = RandomBytes(20000, 7);
+
+    int seenTypes = 0;
+    for (const std::vector<uint8_t>* data : { &all, &skewed, &noise })
+    {
+        std::vector<uint8_t> deflate = RawDeflate(*data, 6);
+        seenTypes |= 1 << FirstBlockType(deflate);
+        std::vector<uint8_t> inflated;
+        REQUIRE(Reference::Inflate(deflate, &inflated, -15));
+        CHECK(inflated == *data);
+    }
+    CHECK_EQ(seenTypes, 7);
+}
+
+TEST_CASE(ZlibStreamsRoundTripAtEveryLevel)
+{
+    const size_t sizes[] = { 0, 1, 3, 257, 40000, DeflateEncoder::BLOCK_SIZE + 1, 300000 };
+    for (int level = 0; level <= 9; ++level)
+    {
+        for (size_t size : sizes)
+        {
+            for (int kind = 0; kind < 3; ++kind)
+            {
+                std::vector<uint8_t> data = kind == 0 ? TextLike(size, 1) : kind == 1 ? RandomBytes(size, 2) : RandomBytes(size, 3, 4);
+                std::vector<uint8_t> compressed = ZlibCompress(data.data(), data.size(), level);
+                std::vector<uint8_t> inflated;
+                REQUIRE(Reference::Inflate(compressed, &inflated));
+                REQUIRE(inflated == data);
+                if (level > 0 && kind == 0 && size >= 40000)
+                    CHECK(compressed.size() < size / 3);
+            }
+        }
+    }
+}
+
+TEST_CASE(WritesInPiecesMatchOneWrite)
+{
+    std::vector<uint8_t> data = TextLike(200000, 4);
+    std::vector<uint8_t> whole = ZlibCompress(data.data(), data.size(), 6);
+
+    ZlibEncoder encoder(6);
+    std::vector<uint8_t> pieces;
+    std::mt19937 random(5);
+    for (size_t pos = 0; pos < data.size();)
+    {
+        size_t n = (std::min)(data.size() - pos, static_cast<size_t>(random() % 5000));
+        encoder.Write(data.data() + pos, n, &pieces);
+        pos += n;
+    }
+    encoder.Flush(DeflateFlush::Finish, &pieces);
+    CHECK(pieces == whole);
+}
+
+TEST_CASE(SyncFlushMakesEverythingSoFarDecodable)
+{
+    std::vector<uint8_t> first = TextLike(70000, 6);
+    std::vector<uint8_t> second = RandomBytes(100, 7);
+
+    ZlibEncoder encoder(6);
+    std::vector<uint8_t> out;
+    encoder.Write(first.data(), first.size(), &out);
+    encoder.Flush(DeflateFlush::Sync, &out);
+    REQUIRE(out.size() >= 4);
+    // An empty stored block ends the flush
+    CHECK(out[out.size() - 4] == 0x00 && out[out.size() - 3] == 0x00 && out[out.size() - 2] == 0xff && out[out.size() - 1] == 0xff);
+
+    std::vector<uint8_t> prefix;
+    REQUIRE(Reference::InflatePrefix(out, &prefix));
+    CHECK(prefix == first);
+
+    encoder.Write(second.data(), second.size(), &out);
+    encoder.Flush(DeflateFlush::Sync, &out);
+    encoder.Flush(DeflateFlush::Finish, &out);
+    std::vector<uint8_t> inflated;
+    REQUIRE(Reference::Inflate(out, &inflated));
+    first.insert(first.end(), second.begin(), second.end());
+    CHECK(inflated == first);
+}
+
+// The parallel PNG path: chunks compressed separately with the previous chunk as dictionary,
+// each ending in a sync flush, then appended to one zlib stream with a combined checksum
+TEST_CASE(ChunksCompressedSeparatelyStitchIntoOneStream)
+{
+    std::vector<uint8_t> data = TextLike(250000, 8);
+    const size_t CHUNK = 60000;
+
+    ZlibEncoder zlib(6);
+    std::vector<uint8_t> out;
+    size_t withDictionary = 0;
+    for (size_t start = 0; start < data.size(); start += CHUNK)
+    {
+        size_t size = (std::min)(CHUNK, data.size() - start);
+        DeflateEncoder chunk(6);
+        if (start > 0)
+        {
+            chunk.SetDictionary(data.data(), start);
+            withDictionary++;
+        }
+        std::vector<uint8_t> deflate;
+        chunk.Write(data.data() + start, size, &deflate);
+        chunk.Flush(DeflateFlush::Sync, &deflate);
+        zlib.WriteDeflated(deflate.data(), deflate.size(), Adler32(1, data.data() + start, size), size, &out);
+    }
+    zlib.Flush(DeflateFlush::Finish, &out);
+
+    std::vector<uint8_t> inflated;
+    REQUIRE(Reference::Inflate(out, &inflated));
+    CHECK(inflated == data);
+    CHECK_EQ(withDictionary, size_t(4));
+    // Matches across the cuts keep the ratio close to a serial stream
+    CHECK(out.size() < ZlibCompress(data.data(), data.size(), 6).size() * 11 / 10);
+}
+
+TEST_CASE(WritesAfterAppendedBlocksStartAFreshWindow)
+{
+    std::vector<uint8_t> head = TextLike(5000, 9);
+    std::vector<uint8_t> middle = TextLike(5000, 10);
+    std::vector<uint8_t> tail = TextLike(5000, 11);
+
+    DeflateEncoder chunk(6);
+    std::vector<uint8_t> deflate;
+    chunk.Write(middle.data(), middle.size(), &deflate);
+    chunk.Flush(DeflateFlush::Sync, &deflate);
+
+    ZlibEncoder zlib(6);
+    std::vector<uint8_t> out;
+    zlib.Write(head.data(), head.size(), &out);
+    zlib.WriteDeflated(deflate.data(), deflate.size(), Adler32(1, middle.data(), middle.size()), middle.size(), &out);
+    zlib.Write(tail.data(), tail.size(), &out);
+    zlib.Flush(DeflateFlush::Finish, &out);
+
+    std::vector<uint8_t> expected = head;
+    expected.insert(expected.end(), middle.begin(), middle.end());
+    expected.insert(expected.end(), tail.begin(), tail.end());
+    std::vector<uint8_t> inflated;
+    REQUIRE(Reference::Inflate(out, &inflated));
+    CHECK(inflated == expected);
+}
+
+TEST_CASE(ChecksumsMatchZlib)
+{
+    for (size_t size : { size_t(0), size_t(1), size_t(5551), size_t(5552), size_t(5553), size_t(100000) })
+    {
+        std::vector<uint8_t> data = RandomBytes(size, static_cast<uint32_t>(size));
+        CHECK_EQ(Adler32(1, data.data(), data.size()), static_cast<uint32_t>(adler32(1, data.data(), static_cast<uInt>(data.size()))));
+        CHECK_EQ(Crc32(0, data.data(), data.size()), static_cast<uint32_t>(crc32(0, data.data(), static_cast<uInt>(data.size()))));
+
+        for (size_t split : { size_t(0), size / 3, size })
+        {
+            uint32_t a = Adler32(1, data.data(), split);
+            uint32_t b = Adler32(1, data.data() + split, size - split);
+            CHECK_EQ(Adler32Combine(a, b, size - split), Adler32(1, data.data(), size));
+        }
+    }
+    // All 0xff bytes push both sums to their largest values
+    std::vector<uint8_t> ones(100000, 0xff);
+    CHECK_EQ(Adler32(1, ones.data(), ones.size()), static_cast<uint32_t>(adler32(1, ones.data(), static_cast<uInt>(ones.size()))));
+}
+
+TEST_CASE(ZlibHeaderIsValid)
+{
+    for (int level = 0; level <= 9; ++level)
+    {
+        std::vector<uint8_t> out = ZlibCompress(nullptr, 0, level);
+        REQUIRE(out.size() >= 2);
+        CHECK_EQ(out[0], uint8_t(0x78));
+        CHECK_EQ((out[0] * 256 + out[1]) % 31, 0);
+        CHECK((out[1] & 0x20) == 0);    // No preset dictionary
+    }
+}
@@ -0,0 +1,174 @@
+#include "TestHarness.h"
+#include "DirectoryWalker.h"
+#include <fstream>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    void Touch(const fs::path& path)
+    {
+        fs::create_directories(path.parent_path());
+        std::ofstream file(path, std::ios::binary);
+        file << "x";
+    }
+
+    // root/a.txt, root/b/c.txt, root/b/d/e.txt, root/b/f.txt, root/g.txt, root/empty/
+    fs::path MakeTree(const fs::path& root)
+    {
+        Touch(root / "a.txt");
+        Touch(root / "b" / "c.txt");
+        Touch(root / "b" / "d" / "e.txt");
+        Touch(root / "b" / "f.txt");
+        Touch(root / "g.txt");
+        fs::create_directories(root / "empty");
+        return root;
+    }
+
+    std::vector<std::string> WalkAll(DirectoryWalker& walker, const fs::path& base)
+    {
+        std::vector<std::string> files;
+        fs::path file;
+        while (walker.Next(&file))
+            files.push_back(fs::relative(file, base).generic_string());
+        return files;
+    }
+}
+
+TEST_CASE(WalkIsDepthFirstInSortedOrder)
+{
+    TestHarness::TempDirectory dir;
+    fs::path root = MakeTree(dir.Path() / "root");
+
+    DirectoryWalker walker({ root });
+    CHECK(WalkAll(walker, root) == std::vector<std::string>({ "a.txt", "b/c.txt", "b/d/e.txt", "b/f.txt", "g.txt" }));
+    CHECK_EQ(walker.DirectoriesVisited(), uint64_t(4));
+
+    fs::path file;
+    CHECK(!walker.Next(&file));
+}
+
+TEST_CASE(WalkCoversEveryRootAndSkipsMissingOnes)
+{
+    TestHarness::TempDirectory dir;
+    fs::path first = MakeTree(dir.Path() / "one");
+    Touch(dir.Path() / "two" / "z.txt");
+
+    DirectoryWalker walker({ first, dir.Path() / "missing", dir.Path() / "two" });
+    std::vector<std::string> files = WalkAll(walker, dir.Path());
+    REQUIRE(files.size() == 6);
+    CHECK_EQ(files.back(), std::string("two/z.txt"));
+    CHECK_EQ(walker.CurrentRoot(), size_t(2));
+}
+
+TEST_CASE(ResumeContinuesAfterTheCheckpoint)
+{
+    TestHarness::TempDirectory dir;
+    fs::path root = MakeTree(dir.Path() / "root");
+
+    const char* checkpoints[] = { "a.txt", "b/c.txt", "b/d/e.txt", "b/f.txt" };
+    const std::vector<std::string> all = { "a.txt", "b/c.txt", "b/d/e.txt", "b/f.txt", "g.txt" };
+    for (size_t i = 0; i < 4; ++i)
+    {
+        DirectoryWalker walker({ root });
+        REQUIRE(walker.ResumeAfter(0, root / checkpoints[i]));
+        CHECK(WalkAll(walker, root) == std::vector<std::string>(all.begin() + i + 1, all.end()));
+    }
+}
+
+TEST_CASE(ResumeAfterADeletedFileStartsAtTheNextName)
+{
+    TestHarness::TempDirectory dir;
+    fs::path root = MakeTree(dir.Path() / "root");
+
+    DirectoryWalker walker({ root });
+    REQUIRE(walker.ResumeAfter(0, root / "b" / "cc.txt"));
+    CHECK(WalkAll(walker, root) == std::vector<std::string>({ "b/d/e.txt", "b/f.txt", "g.txt" }));
+}
+
+TEST_CASE(ResumeOutsideTheRootStartsOver)
+{
+    TestHarness::TempDirectory dir;
+    fs::path root = MakeTree(dir.Path() / "root");
+
+    DirectoryWalker walker({ root });
+    CHECK(!walker.ResumeAfter(0, dir.Path() / "elsewhere" / "x.txt"));
+    CHECK(!walker.ResumeAfter(3, root / "a.txt"));
+    CHECK_EQ(WalkAll(walker, root).size(), size_t(5));
+}
+
+TEST_CASE(SymbolicLinksAreNotFollowed)
+{
+    TestHarness::TempDirectory dir;
+    fs::path root = MakeTree(dir.Path() / "root");
+    std::error_code ec;
+    fs::create_directory_symlink(root / "b", root / "link", ec);
+    if (ec)
+        return;
+
+    DirectoryWalker walker({ root });
+    CHECK_EQ(WalkAll(walker, root).size(), size_t(5));
+}
+
+TEST_CASE(UnreadableDirectoriesAreSkipped)
+{
+    if (geteuid() == 0)
+        return;     // root reads everything
+
+    TestHarness::TempDirectory dir;
+    fs::path root = MakeTree(dir.Path() / "root");
+    fs::permissions(root / "b", fs::perms::none);
+    DirectoryWalker walker({ root });
+    std::vector<std::string> files = WalkAll(walker, root);
+    fs::permissions(root / "b", fs::perms::owner_all);
+    CHECK(files == std::vector<std::string>({ "a.txt", "g.txt" }));
+}
+
+TEST_CASE(CheckpointRoundTripsThroughAFile)
+{
+    TestHarness::TempDirectory dir;
+    WalkCheckpoint saved;
+    saved.rootsSignature = ComputeRootsSignature({ "/a", "/b" });
+    saved.rootIndex = 1;
+    saved.lastCompleted = dir.Path() / "photos" / "2024 summer" / "img 001.jpg";
+    saved.filesCompleted = 123456;
+
+    fs::path file = dir.Path() / "walk.checkpoint";
+    REQUIRE(SaveWalkCheckpoint(file, saved));
+    CHECK(!fs::exists(dir.Path() / "walk.checkpoint.tmp"));
+
+    WalkCheckpoint loaded;
+    REQUIRE(LoadWalkCheckpoint(file, &loaded));
+    CHECK_EQ(loaded.rootsSignature, saved.rootsSignature);
+    CHECK_EQ(loaded.rootIndex, saved.rootIndex);
+    CHECK_EQ(loaded.filesCompleted, saved.filesCompleted);
+    CHECK(loaded.lastCompleted == saved.lastCompleted);
+}
+
+TEST_CASE(DamagedCheckpointIsRejected)
+{
+    TestHarness::TempDirectory dir;
+    fs::path file = dir.Path() / "walk.checkpoint";
+    WalkCheckpoint loaded;
+    CHECK(!LoadWalkCheckpoint(file, &loaded));
+
+    {
+        std::ofstream out(file, std::ios::binary);
+        out << "WSP-WALK 1\n12\n";
+    }
+    CHECK(!LoadWalkCheckpoint(file, &loaded));
+
+    {
+        std::ofstream out(file, std::ios::binary);
+        out << "something else\n1\n0\n0\n/x\n";
+    }
+    CHECK(!LoadWalkCheckpoint(file, &loaded));
+}
+
+TEST_CASE(RootsSignatureDependsOnOrderAndBoundaries)
+{
+    CHECK(ComputeRootsSignature({ "/a", "/b" }) != ComputeRootsSignature({ "/b", "/a" }));
+    CHECK(ComputeRootsSignature({ "/ab" }) != ComputeRootsSignature({ "/a", "b" }));
+    CHECK_EQ(ComputeRootsSignature({ "/a" }), ComputeRootsSignature({ "/a" }));
+}
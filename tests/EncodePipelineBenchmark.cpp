@@ -0,0 +1,152 @@
+#include "Benchmark.h"
+#include "EncodePipeline.h"
+#include "PngWriter.h"
+#include "TestData.h"
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Saving thumbnails from several extraction threads: each thread produces a 512x512 image
+// (standing in for GetDIBits) and either encodes it itself, as SaveBitmapToFile does, or hands
+// it to the encode pipeline and goes back to extracting. Also the injection queue on its own:
+// items per second through MpmcQueue against a mutex-guarded deque, 2 producers 2 consumers.
+namespace
+{
+    const int PRODUCERS = 4;
+
+    void Extract(int index, PixelImage* image)
+    {
+        *image = TestData::Scene(512, 512, AlphaMode::Ignore, index);
+    }
+
+    double RunProducers(int jobs, const std::function<void(int, PixelImage&)>& save)
+    {
+        BenchmarkTimer timer;
+        std::vector<std::thread> threads;
+        for (int p = 0; p < PRODUCERS; ++p)
+        {
+            threads.emplace_back([&save, jobs, p]()
+            {
+                for (int i = p; i < jobs; i += PRODUCERS)
+                {
+                    PixelImage image;
+                    Extract(i, &image);
+                    save(i, image);
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+        return timer.Milliseconds();
+    }
+
+    template <typename Queue>
+    double RunQueue(Queue& queue, uint64_t items)
+    {
+        BenchmarkTimer timer;
+        std::atomic<uint64_t> popped(0);
+        std::vector<std::thread> threads;
+        for (int p = 0; p < 2; ++p)
+        {
+            threads.emplace_back([&queue, items]()
+            {
+                for (uint64_t i = 0; i < items / 2; ++i)
+                {
+                    uint64_t item = i;
+                    while (!queue.TryPush(item))
+                        std::this_thread::yield();
+                }
+            });
+            threads.emplace_back([&queue, &popped, items]()
+            {
+                uint64_t item;
+                while (popped.load(std::memory_order_relaxed) < items)
+                {
+                    if (queue.TryPop(&item))
+                        popped.fetch_add(1, std::memory_order_relaxed);
+                    else
+                        std::this_thread::yield();
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+        return timer.Milliseconds();
+    }
+
+    class LockedQueue
+    {
+    public:
+        explicit LockedQueue(size_t capacity) : m_capacity(capacity) {}
+
+        bool TryPush(uint64_t& item)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_items.size() >= m_capacity)
+                return false;
+            m_items.push_back(item);
+            return true;
+        }
+
+        bool TryPop(uint64_t* item)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_items.empty())
+                return false;
+            *item = m_items.front();
+            m_items.pop_front();
+            return true;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::deque<uint64_t> m_items;
+        size_t m_capacity;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    double scale = BenchmarkScale(argc, argv);
+    const int jobs = (std::max)(static_cast<int>(48 * scale), PRODUCERS);
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / ("wsp-bench-encode-" + std::to_string(std::random_device()()));
+    std::filesystem::create_directories(dir);
+    auto path = [&dir](int i) { return dir / ("job_" + std::to_string(i) + ".png"); };
+
+    double serialMs = RunProducers(jobs, [&path](int i, PixelImage& image) { SavePixelImageAsPng(image, path(i)); });
+
+    EncodePipelineStats stats;
+    double handoffMs, pipelinedMs;
+    {
+        EncodePipeline pipeline;
+        BenchmarkTimer timer;
+        handoffMs = RunProducers(jobs, [&pipeline, &path](int i, PixelImage& image)
+        {
+            EncodeJob job;
+            job.image = std::move(image);
+            job.path = path(i);
+            pipeline.Submit(std::move(job));
+        });
+        pipeline.WaitIdle();
+        pipelinedMs = timer.Milliseconds();
+        stats = pipeline.Stats();
+    }
+    std::filesystem::remove_all(dir);
+
+    ReportResult("512x512 saves, encoded on the extraction threads", serialMs, "ms");
+    ReportResult("512x512 saves, through the pipeline", pipelinedMs, "ms");
+    ReportResult("extraction threads free again after", handoffMs, "ms");
+    ReportResult("encoder threads", stats.encodeThreads, "");
+    ReportResult("encoder utilization", stats.encodeUtilization / 65536.0, "");
+    ReportResult("producer stall", static_cast<double>(stats.producerStallMs), "ms");
+
+    const uint64_t items = static_cast<uint64_t>(2000000 * scale) & ~uint64_t(1);
+    MpmcQueue<uint64_t> lockFree(64);
+    LockedQueue locked(64);
+    double lockFreeMs = RunQueue(lockFree, items);
+    double lockedMs = RunQueue(locked, items);
+    ReportResult("MpmcQueue", items / lockFreeMs / 1000.0, "M items/s");
+    ReportResult("mutex + deque", items / lockedMs / 1000.0, "M items/s");
+    return 0;
+}
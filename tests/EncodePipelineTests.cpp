@@ -0,0 +1,182 @@
+#include "TestHarness.h"
+#include "ReferenceCodecs.h"
+#include "EncodePipeline.h"
+#include "PngWriter.h"
+#include "TestData.h"
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using TestHarness::TempDirectory;
+using TestHarness::WaitUntil;
+using TestData::ReadFile;
+using TestData::Scene;
+using Reference::CheckDecodesTo;
+
+TEST_CASE(JobsFromManyProducersAreWrittenAsDecodablePngs)
+{
+    TempDirectory dir;
+    const int producers = 4, perProducer = 6;
+    const AlphaMode modes[] = { AlphaMode::Ignore, AlphaMode::Straight, AlphaMode::Premultiplied };
+    std::mutex mutex;
+    std::vector<int> results(producers * perProducer, -1);
+    std::vector<std::thread::id> completionThreads;
+    uint64_t pixels = 0;
+
+    EncodePipeline pipeline(3, 2);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&, p]()
+        {
+            for (int i = 0; i < perProducer; ++i)
+            {
+                int index = p * perProducer + i;
+                EncodeJob job;
+                job.image = Scene(17 + index * 13, 9 + index * 7, modes[index % 3], index);
+                job.path = dir / ("job_" + std::to_string(index) + ".png");
+                job.level = index % 10;
+                job.completion = [&, index](bool ok)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    results[index] = ok;
+                    completionThreads.push_back(std::this_thread::get_id());
+                };
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    pixels += static_cast<uint64_t>(job.image.width) * job.image.height;
+                }
+                pipeline.Submit(std::move(job));
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    REQUIRE(pipeline.WaitIdle(30000));
+
+    uint64_t bytes = 0;
+    for (int index = 0; index < producers * perProducer; ++index)
+    {
+        CHECK_EQ(results[index], 1);
+        std::filesystem::path path = dir / ("job_" + std::to_string(index) + ".png");
+        CheckDecodesTo(ReadFile(path), Scene(17 + index * 13, 9 + index * 7, modes[index % 3], index));
+        bytes += std::filesystem::file_size(path);
+    }
+    // Completions run on the encoder threads, not on the producers
+    for (std::thread::id id : completionThreads)
+        CHECK(id != std::this_thread::get_id());
+
+    EncodePipelineStats stats = pipeline.Stats();
+    CHECK_EQ(stats.jobsSubmitted, uint64_t(producers * perProducer));
+    CHECK_EQ(stats.jobsCompleted, uint64_t(producers * perProducer));
+    CHECK_EQ(stats.jobsFailed, uint64_t(0));
+    CHECK_EQ(stats.jobsInFlight, uint64_t(0));
+    CHECK_EQ(stats.pixelsEncoded, pixels);
+    CHECK_EQ(stats.bytesWritten, bytes);
+    CHECK_EQ(stats.encodeThreads, uint32_t(3));
+    CHECK(stats.queueHighWater <= 2);
+    CHECK(stats.encodeUtilization <= 65536);
+}
+
+TEST_CASE(LargeImagesAreSplitAcrossTheSamePool)
+{
+    TempDirectory dir;
+    PixelImage image = Scene(1280, 900, AlphaMode::Straight, 5);
+    REQUIRE(static_cast<uint64_t>(image.width) * image.height >= PARALLEL_PNG_MIN_PIXELS);
+
+    // One thread and a full queue behind the big job: its chunks must still get done
+    EncodePipeline pipeline(1, 1);
+    EncodeJob job;
+    REQUIRE(CopyPixelImage(image, &job.image));
+    job.path = dir / "large.png";
+    job.level = 1;
+    pipeline.Submit(std::move(job));
+    for (int i = 0; i < 3; ++i)
+    {
+        EncodeJob small;
+        small.image = Scene(40, 30, AlphaMode::Ignore, i);
+        small.path = dir / ("small_" + std::to_string(i) + ".png");
+        pipeline.Submit(std::move(small));
+    }
+    REQUIRE(pipeline.WaitIdle(60000));
+    CheckDecodesTo(ReadFile(dir / "large.png"), image);
+    for (int i = 0; i < 3; ++i)
+        CheckDecodesTo(ReadFile(dir / ("small_" + std::to_string(i) + ".png")), Scene(40, 30, AlphaMode::Ignore, i));
+
+    // Same bytes as the parallel encoder run on its own
+    std::vector<uint8_t> expected;
+    REQUIRE(EncodePngParallel(image, &expected, 1));
+    CHECK(ReadFile(dir / "large.png") == expected);
+    CHECK(pipeline.Stats().jobsFailed == 0);
+}
+
+TEST_CASE(FailedWritesReachTheCompletion)
+{
+    TempDirectory dir;
+    EncodePipeline pipeline(2);
+    std::atomic<int> result(-1);
+    EncodeJob job;
+    job.image = Scene(10, 10, AlphaMode::Ignore, 1);
+    job.path = dir / "missing" / "out.png";
+    job.completion = [&result](bool ok) { result.store(ok); };
+    pipeline.Submit(std::move(job));
+
+    EncodeJob empty;
+    empty.path = dir / "empty.png";
+    pipeline.Submit(std::move(empty));
+
+    REQUIRE(pipeline.WaitIdle(10000));
+    CHECK_EQ(result.load(), 0);
+    EncodePipelineStats stats = pipeline.Stats();
+    CHECK_EQ(stats.jobsFailed, uint64_t(2));
+    CHECK_EQ(stats.jobsCompleted, uint64_t(2));
+    CHECK_EQ(stats.pixelsEncoded, uint64_t(0));
+    CHECK_EQ(stats.bytesWritten, uint64_t(0));
+}
+
+TEST_CASE(ProducersStallWhileTheQueueIsFull)
+{
+    TempDirectory dir;
+    EncodePipeline pipeline(1, 1);
+    std::atomic<bool> release(false);
+
+    // The first completion holds the only encoder thread
+    EncodeJob first;
+    first.image = Scene(8, 8, AlphaMode::Ignore, 0);
+    first.path = dir / "first.png";
+    first.completion = [&release](bool)
+    {
+        while (!release.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    };
+    pipeline.Submit(std::move(first));
+    CHECK(!pipeline.WaitIdle(100));
+    CHECK_EQ(pipeline.Stats().jobsInFlight, uint64_t(1));
+
+    std::atomic<int> submitted(0);
+    std::thread producer([&]()
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            EncodeJob job;
+            job.image = Scene(8, 8, AlphaMode::Ignore, i + 1);
+            job.path = dir / ("next_" + std::to_string(i) + ".png");
+            pipeline.Submit(std::move(job));
+            submitted.fetch_add(1);
+        }
+    });
+    // Queue capacity rounds up to 2: two jobs wait, the third Submit blocks
+    REQUIRE(WaitUntil([&submitted]() { return submitted.load() == 2; }, 5000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK_EQ(submitted.load(), 2);
+
+    release.store(true);
+    producer.join();
+    REQUIRE(pipeline.WaitIdle(10000));
+    EncodePipelineStats stats = pipeline.Stats();
+    CHECK_EQ(stats.jobsCompleted, uint64_t(5));
+    CHECK(stats.producerStallMs >= 50);
+    CHECK_EQ(stats.queueHighWater, uint64_t(2));
+    for (int i = 0; i < 4; ++i)
+        CheckDecodesTo(ReadFile(dir / ("next_" + std::to_string(i) + ".png")), Scene(8, 8, AlphaMode::Ignore, i + 1));
+}
@@ -0,0 +1,236 @@
+#include "TestHarness.h"
+#include "FileWatcher.h"
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+
+namespace
+{
+    FileChange Change(FileChangeKind kind, const std::string& path, int rootId = 1, bool isDirectory = false)
+    {
+        return FileChange{ kind, path, rootId, isDirectory };
+    }
+
+    // Collects what a watcher delivers
+    struct Recorder
+    {
+        std::mutex mutex;
+        std::vector<FileChange> changes;
+        size_t batches = 0;
+
+        FileWatcher::Handler Handler()
+        {
+            return [this](const std::vector<FileChange>& batch)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                changes.insert(changes.end(), batch.begin(), batch.end());
+                ++batches;
+            };
+        }
+
+        bool Has(FileChangeKind kind, const std::string& path, int rootId)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return std::any_of(changes.begin(), changes.end(), [&](const FileChange& change)
+            {
+                return change.kind == kind && change.path == path && change.rootId == rootId;
+            });
+        }
+
+        size_t Count(const std::string& path)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return static_cast<size_t>(std::count_if(changes.begin(), changes.end(),
+                [&](const FileChange& change) { return change.path == path; }));
+        }
+
+        void Clear()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            changes.clear();
+        }
+    };
+
+    void WriteFile(const std::filesystem::path& path, const char* text)
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << text;
+    }
+}
+
+TEST_CASE(BatcherMergesABurstOfWritesIntoOneChange)
+{
+    ChangeBatcher batcher(500);
+    batcher.Add(Change(FileChangeKind::Modified, "a"), 1000);
+    batcher.Add(Change(FileChangeKind::Modified, "a"), 1100);
+    batcher.Add(Change(FileChangeKind::Modified, "b"), 1200);
+    batcher.Add(Change(FileChangeKind::Modified, "a"), 1300);
+
+    CHECK(!batcher.Ready(1700));
+    CHECK_EQ(batcher.NextTimeoutMs(1700), 100);
+    CHECK(batcher.Ready(1800));
+
+    std::vector<FileChange> changes = batcher.Take();
+    REQUIRE(changes.size() == 2);
+    CHECK_EQ(changes[0].path, std::string("a"));
+    CHECK(changes[0].kind == FileChangeKind::Modified);
+    CHECK_EQ(changes[1].path, std::string("b"));
+    CHECK(batcher.Empty());
+    CHECK_EQ(batcher.NextTimeoutMs(1800), -1);
+}
+
+TEST_CASE(BatcherMergesKindsPerPath)
+{
+    ChangeBatcher batcher(0);
+    batcher.Add(Change(FileChangeKind::Added, "new"), 0);
+    batcher.Add(Change(FileChangeKind::Modified, "new"), 0);
+    batcher.Add(Change(FileChangeKind::Removed, "replaced"), 0);
+    batcher.Add(Change(FileChangeKind::Added, "replaced"), 0);
+    batcher.Add(Change(FileChangeKind::Modified, "deleted"), 0);
+    batcher.Add(Change(FileChangeKind::Removed, "deleted"), 0);
+    batcher.Add(Change(FileChangeKind::Added, "temp"), 0);
+    batcher.Add(Change(FileChangeKind::Removed, "temp"), 0);
+    batcher.Add(Change(FileChangeKind::Added, "again"), 0);
+    batcher.Add(Change(FileChangeKind::Removed, "again"), 0);
+    batcher.Add(Change(FileChangeKind::Added, "again", 1, true), 0);
+
+    std::vector<FileChange> changes = batcher.Take();
+    REQUIRE(changes.size() == 4);
+    CHECK(changes[0].path == "new" && changes[0].kind == FileChangeKind::Added);
+    CHECK(changes[1].path == "replaced" && changes[1].kind == FileChangeKind::Modified);
+    CHECK(changes[2].path == "deleted" && changes[2].kind == FileChangeKind::Removed);
+    CHECK(changes[3].path == "again" && changes[3].kind == FileChangeKind::Added && changes[3].isDirectory);
+}
+
+TEST_CASE(BatcherOverflowReplacesTheRootsChanges)
+{
+    ChangeBatcher batcher(0);
+    batcher.Add(Change(FileChangeKind::Modified, "a", 1), 0);
+    batcher.Add(Change(FileChangeKind::Modified, "b", 2), 0);
+    batcher.Add(FileChange{ FileChangeKind::Overflow, std::string(), 1, true }, 0);
+    batcher.Add(Change(FileChangeKind::Modified, "c", 1), 0);
+
+    std::vector<FileChange> changes = batcher.Take();
+    REQUIRE(changes.size() == 3);
+    CHECK(changes[0].path == "b");
+    CHECK(changes[1].kind == FileChangeKind::Overflow && changes[1].rootId == 1);
+    CHECK(changes[2].path == "c");
+}
+
+TEST_CASE(BatcherKeepsChangesOfDifferentRootsApart)
+{
+    ChangeBatcher batcher(0);
+    batcher.Add(Change(FileChangeKind::Added, "shared", 1), 0);
+    batcher.Add(Change(FileChangeKind::Added, "shared", 2), 0);
+    batcher.Add(Change(FileChangeKind::Removed, "shared", 1), 0);
+
+    std::vector<FileChange> changes = batcher.Take();
+    REQUIRE(changes.size() == 1);
+    CHECK(changes[0].rootId == 2 && changes[0].kind == FileChangeKind::Added);
+}
+
+TEST_CASE(BatcherReleasesAFullBatchWithoutWaiting)
+{
+    ChangeBatcher batcher(60000);
+    for (size_t i = 0; i < ChangeBatcher::MAX_PENDING; ++i)
+        batcher.Add(Change(FileChangeKind::Added, "f" + std::to_string(i)), 10);
+    CHECK(batcher.Ready(10));
+    CHECK_EQ(batcher.NextTimeoutMs(10), 0);
+    CHECK_EQ(batcher.Take().size(), ChangeBatcher::MAX_PENDING);
+}
+
+#if defined(__linux__)
+
+TEST_CASE(InotifyReportsSettledChanges)
+{
+    TestHarness::TempDirectory dir;
+    Recorder recorder;
+    std::unique_ptr<FileWatcher> watcher = CreateFileWatcher(recorder.Handler(), 50);
+    int root = watcher->AddRoot(dir.Path().string(), true);
+    REQUIRE(root > 0);
+
+    std::string file = (dir.Path() / "a.txt").string();
+    WriteFile(file, "1");
+    WriteFile(file, "22");
+    CHECK(TestHarness::WaitUntil([&]() { return recorder.Has(FileChangeKind::Added, file, root); }, 5000));
+    CHECK_EQ(recorder.Count(file), size_t(1));
+
+    // A directory created later is watched as well
+    std::filesystem::path sub = dir.Path() / "sub";
+    std::filesystem::create_directory(sub);
+    CHECK(TestHarness::WaitUntil([&]() { return recorder.Has(FileChangeKind::Added, sub.string(), root); }, 5000));
+    std::string nested = (sub / "b.txt").string();
+    WriteFile(nested, "x");
+    CHECK(TestHarness::WaitUntil([&]() { return recorder.Has(FileChangeKind::Added, nested, root); }, 5000));
+
+    std::filesystem::remove(file);
+    CHECK(TestHarness::WaitUntil([&]() { return recorder.Has(FileChangeKind::Removed, file, root); }, 5000));
+    watcher->Stop();
+}
+
+TEST_CASE(InotifyNonRecursiveRootIgnoresSubdirectories)
+{
+    TestHarness::TempDirectory dir;
+    std::filesystem::create_directory(dir.Path() / "sub");
+    Recorder recorder;
+    std::unique_ptr<FileWatcher> watcher = CreateFileWatcher(recorder.Handler(), 20);
+    int root = watcher->AddRoot(dir.Path().string(), false);
+    REQUIRE(root > 0);
+
+    WriteFile(dir.Path() / "sub" / "hidden.txt", "x");
+    std::string visible = (dir.Path() / "visible.txt").string();
+    WriteFile(visible, "x");
+    CHECK(TestHarness::WaitUntil([&]() { return recorder.Has(FileChangeKind::Added, visible, root); }, 5000));
+    CHECK_EQ(recorder.Count((dir.Path() / "sub" / "hidden.txt").string()), size_t(0));
+    watcher->Stop();
+}
+
+// The same directory under two roots (here a nested root inside a recursive one) shares one
+// inotify descriptor. Both roots get the change, and removing one keeps the other working.
+TEST_CASE(InotifyRootsSharingADirectoryBothReceiveChanges)
+{
+    TestHarness::TempDirectory dir;
+    std::filesystem::path sub = dir.Path() / "sub";
+    std::filesystem::create_directory(sub);
+
+    Recorder recorder;
+    std::unique_ptr<FileWatcher> watcher = CreateFileWatcher(recorder.Handler(), 20);
+    int outer = watcher->AddRoot(dir.Path().string(), true);
+    int inner = watcher->AddRoot(sub.string(), false);
+    REQUIRE(outer > 0 && inner > 0 && outer != inner);
+
+    std::string first = (sub / "first.txt").string();
+    WriteFile(first, "x");
+    CHECK(TestHarness::WaitUntil([&]() { return recorder.Has(FileChangeKind::Added, first, outer) &&
+                                                recorder.Has(FileChangeKind::Added, first, inner); }, 5000));
+
+    watcher->RemoveRoot(inner);
+    recorder.Clear();
+    std::string second = (sub / "second.txt").string();
+    WriteFile(second, "x");
+    CHECK(TestHarness::WaitUntil([&]() { return recorder.Has(FileChangeKind::Added, second, outer); }, 5000));
+    CHECK(!recorder.Has(FileChangeKind::Added, second, inner));
+
+    // Adding the inner root again and removing the outer one leaves the inner root watching
+    inner = watcher->AddRoot(sub.string(), false);
+    REQUIRE(inner > 0);
+    watcher->RemoveRoot(outer);
+    recorder.Clear();
+    std::string third = (sub / "third.txt").string();
+    WriteFile(third, "x");
+    CHECK(TestHarness::WaitUntil([&]() { return recorder.Has(FileChangeKind::Added, third, inner); }, 5000));
+    CHECK(!recorder.Has(FileChangeKind::Added, third, outer));
+    watcher->Stop();
+}
+
+TEST_CASE(InotifyRejectsMissingDirectories)
+{
+    TestHarness::TempDirectory dir;
+    Recorder recorder;
+    std::unique_ptr<FileWatcher> watcher = CreateFileWatcher(recorder.Handler(), 20);
+    CHECK_EQ(watcher->AddRoot((dir.Path() / "missing").string(), true), 0);
+    WriteFile(dir.Path() / "file", "x");
+    CHECK_EQ(watcher->AddRoot((dir.Path() / "file").string(), true), 0);
+}
+
+#endif
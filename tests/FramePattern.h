@@ -0,0 +1,59 @@
+#pragma once
+#include "ImageOps.h"
+#include <cstddef>
+#include <cstdint>
+
+// Frames the ring tests pass between processes. Size, alpha mode and every pixel depend on the
+// sequence number, so a reader can check a frame completely without being told what to expect:
+// a stale slot, a torn write or a skipped frame all show up as a mismatch.
+namespace FramePattern
+{
+    const uint32_t MAX_WIDTH = 130;
+    const uint32_t MAX_HEIGHT = 70;
+    const size_t SLOT_BYTES = MAX_WIDTH * MAX_HEIGHT * 4;
+
+    inline void Size(uint64_t sequence, uint32_t* width, uint32_t* height)
+    {
+        *width = 17 + static_cast<uint32_t>(sequence * 7 % 113);
+        *height = 9 + static_cast<uint32_t>(sequence * 5 % 61);
+    }
+
+    inline AlphaMode Alpha(uint64_t sequence)
+    {
+        return static_cast<AlphaMode>(sequence % 3);
+    }
+
+    inline uint8_t Value(uint64_t sequence, uint32_t x, uint32_t y, uint32_t channel)
+    {
+        return static_cast<uint8_t>(sequence * 31 + x * 3 + y * 7 + channel * 64);
+    }
+
+    // Rows are width * 4 bytes apart, as FrameRingWriter::BeginFrame hands them out
+    inline void Fill(uint64_t sequence, uint8_t* pixels)
+    {
+        uint32_t width, height;
+        Size(sequence, &width, &height);
+        for (uint32_t y = 0; y < height; ++y)
+            for (uint32_t x = 0; x < width; ++x)
+                for (uint32_t c = 0; c < 4; ++c)
+                    *pixels++ = Value(sequence, x, y, c);
+    }
+
+    inline bool Matches(uint64_t sequence, const uint8_t* pixels, uint32_t width, uint32_t height, size_t stride,
+                        AlphaMode alpha)
+    {
+        uint32_t expectedWidth, expectedHeight;
+        Size(sequence, &expectedWidth, &expectedHeight);
+        if (width != expectedWidth || height != expectedHeight || stride != width * 4 || alpha != Alpha(sequence))
+            return false;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const uint8_t* p = pixels + y * stride;
+            for (uint32_t x = 0; x < width; ++x)
+                for (uint32_t c = 0; c < 4; ++c)
+                    if (*p++ != Value(sequence, x, y, c))
+                        return false;
+        }
+        return true;
+    }
+}
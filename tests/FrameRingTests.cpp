@@ -0,0 +1,251 @@
+#include "TestHarness.h"
+#include "FramePattern.h"
+#include "FrameRing.h"
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+    // Publishes FramePattern frame `sequence`; false if the ring had no room within timeoutMs
+    bool Publish(FrameRingWriter& writer, uint64_t sequence, uint32_t timeoutMs)
+    {
+        uint32_t width, height;
+        FramePattern::Size(sequence, &width, &height);
+        uint8_t* pixels = writer.BeginFrame(width, height, timeoutMs);
+        if (!pixels)
+            return false;
+        FramePattern::Fill(sequence, pixels);
+        return writer.PublishFrame(FramePattern::Alpha(sequence)) == sequence;
+    }
+
+    bool Intact(const RingFrame& frame)
+    {
+        return FramePattern::Matches(frame.sequence, frame.pixels, frame.width, frame.height, frame.stride, frame.alpha);
+    }
+
+    int WaitForExit(ChildProcess& child, int timeoutMs)
+    {
+        if (!TestHarness::WaitUntil([&child]() { return !child.IsRunning(); }, timeoutMs))
+            child.Kill();
+        return child.ExitCode();
+    }
+}
+
+TEST_CASE(FramesArriveInOrderWithTheirHeaders)
+{
+    std::string name = TestHarness::UniqueName("wsp-ring");
+    std::unique_ptr<FrameRingWriter> writer = FrameRingWriter::Create(name, 4, FramePattern::SLOT_BYTES);
+    REQUIRE(writer);
+    CHECK_EQ(writer->SlotCount(), uint32_t(4));
+    CHECK_EQ(writer->SlotBytes(), FramePattern::SLOT_BYTES);
+    std::unique_ptr<FrameRingReader> reader = FrameRingReader::Open(name);
+    REQUIRE(reader);
+
+    RingFrame frame;
+    CHECK(!reader->AcquireFrame(0, &frame));
+    for (uint64_t i = 0; i < 3; ++i)
+        REQUIRE(Publish(*writer, i, 0));
+    CHECK_EQ(writer->Pending(), uint32_t(3));
+    CHECK_EQ(reader->Pending(), uint32_t(3));
+
+    for (uint64_t i = 0; i < 3; ++i)
+    {
+        REQUIRE(reader->AcquireFrame(0, &frame));
+        CHECK_EQ(frame.sequence, i);
+        CHECK(Intact(frame));
+    }
+    // The last frame is still held until released
+    CHECK_EQ(writer->Pending(), uint32_t(1));
+    reader->ReleaseFrame();
+    reader->ReleaseFrame();
+    CHECK_EQ(writer->Pending(), uint32_t(0));
+    CHECK(!reader->AcquireFrame(20, &frame));
+
+    // Slots are reused in order well past the first lap
+    for (uint64_t i = 3; i < 40; ++i)
+    {
+        REQUIRE(Publish(*writer, i, 0));
+        REQUIRE(reader->AcquireFrame(0, &frame));
+        CHECK_EQ(frame.sequence, i);
+        CHECK(Intact(frame));
+    }
+    reader->ReleaseFrame();
+    FrameRingStats stats = writer->Stats();
+    CHECK_EQ(stats.published, uint64_t(40));
+    CHECK_EQ(stats.backpressureWaits, uint64_t(0));
+}
+
+TEST_CASE(AFullRingBlocksTheWriterInsteadOfOverwriting)
+{
+    std::string name = TestHarness::UniqueName("wsp-ring");
+    std::unique_ptr<FrameRingWriter> writer = FrameRingWriter::Create(name, 2, FramePattern::SLOT_BYTES);
+    std::unique_ptr<FrameRingReader> reader = FrameRingReader::Open(name);
+    REQUIRE(writer && reader);
+
+    REQUIRE(Publish(*writer, 0, 0));
+    REQUIRE(Publish(*writer, 1, 0));
+    auto start = std::chrono::steady_clock::now();
+    CHECK(!writer->BeginFrame(32, 32, 60));
+    CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(50));
+    CHECK_EQ(writer->Stats().backpressureWaits, uint64_t(1));
+    CHECK_EQ(writer->Stats().timeouts, uint64_t(1));
+    // Publishing without a successful BeginFrame does nothing
+    CHECK_EQ(writer->PublishFrame(AlphaMode::Ignore), uint64_t(2));
+    CHECK_EQ(writer->Pending(), uint32_t(2));
+
+    // Holding frame 0 keeps its slot; the writer wakes as soon as it is released
+    RingFrame frame;
+    REQUIRE(reader->AcquireFrame(0, &frame));
+    std::thread consumer([&reader]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        reader->ReleaseFrame();
+    });
+    start = std::chrono::steady_clock::now();
+    bool published = Publish(*writer, 2, 5000);
+    auto waited = std::chrono::steady_clock::now() - start;
+    consumer.join();
+    CHECK(published);
+    CHECK(waited >= std::chrono::milliseconds(40) && waited < std::chrono::milliseconds(2000));
+    CHECK_EQ(writer->Stats().backpressureWaits, uint64_t(2));
+    CHECK_EQ(writer->Stats().timeouts, uint64_t(1));
+
+    for (uint64_t i = 1; i <= 2; ++i)
+    {
+        REQUIRE(reader->AcquireFrame(0, &frame));
+        CHECK_EQ(frame.sequence, i);
+        CHECK(Intact(frame));
+    }
+}
+
+TEST_CASE(OversizedFramesAndBadRingsAreRejected)
+{
+    std::string name = TestHarness::UniqueName("wsp-ring");
+    CHECK(!FrameRingWriter::Create(name, 0, 1024));
+    CHECK(!FrameRingWriter::Create(name, 2, 0));
+    CHECK(!FrameRingReader::Open(name));
+
+    std::unique_ptr<FrameRingWriter> writer = FrameRingWriter::Create(name, 2, 64 * 64 * 4);
+    REQUIRE(writer);
+    CHECK(!writer->BeginFrame(65, 64, 0));
+    CHECK(!writer->BeginFrame(0, 64, 0));
+    CHECK(!writer->BeginFrame(64, 0, 0));
+    CHECK(writer->BeginFrame(64, 64, 0) != nullptr);
+    CHECK(writer->BeginFrame(4096, 1, 0) != nullptr);
+    CHECK_EQ(writer->Stats().oversized, uint64_t(3));
+    CHECK_EQ(writer->Pending(), uint32_t(0));
+
+    // Something else living under the name, or a ring from another version
+    std::unique_ptr<SharedMemory> memory = SharedMemory::Open(name);
+    REQUIRE(memory);
+    FrameRingHeader* header = reinterpret_cast<FrameRingHeader*>(memory->Data());
+    header->version = FRAME_RING_VERSION + 1;
+    CHECK(!FrameRingReader::Open(name));
+    header->version = FRAME_RING_VERSION;
+    header->slotCount = 1000;
+    CHECK(!FrameRingReader::Open(name));
+    header->slotCount = 2;
+    header->magic = 0;
+    CHECK(!FrameRingReader::Open(name));
+    header->magic = FRAME_RING_MAGIC;
+    CHECK(FrameRingReader::Open(name) != nullptr);
+
+    std::string other = TestHarness::UniqueName("wsp-ring-shm");
+    std::unique_ptr<SharedMemory> plain = SharedMemory::Create(other, 4096);
+    CHECK(!FrameRingReader::Open(other));
+}
+
+TEST_CASE(AnotherProcessReadsEveryFrameIntact)
+{
+    // Slow reader: the writer spends most of its time blocked on a full ring
+    std::string name = TestHarness::UniqueName("wsp-ring");
+    std::unique_ptr<FrameRingWriter> writer = FrameRingWriter::Create(name, 3, FramePattern::SLOT_BYTES);
+    REQUIRE(writer);
+    ChildProcess slow;
+    REQUIRE(slow.Start(STUB_WORKER_PATH, { "ring-read", name, "300", "200" }));
+    for (uint64_t i = 0; i < 300; ++i)
+        REQUIRE(Publish(*writer, i, 10000));
+    CHECK_EQ(WaitForExit(slow, 10000), 0);
+    CHECK(writer->Stats().backpressureWaits > 0);
+    CHECK_EQ(writer->Stats().timeouts, uint64_t(0));
+
+    // Fast reader on a fresh ring, 20000 frames as quickly as both sides go
+    name = TestHarness::UniqueName("wsp-ring");
+    writer = FrameRingWriter::Create(name, 4, FramePattern::SLOT_BYTES);
+    REQUIRE(writer);
+    ChildProcess fast;
+    REQUIRE(fast.Start(STUB_WORKER_PATH, { "ring-read", name, "20000" }));
+    for (uint64_t i = 0; i < 20000; ++i)
+        REQUIRE(Publish(*writer, i, 10000));
+    CHECK_EQ(WaitForExit(fast, 10000), 0);
+    CHECK_EQ(writer->Stats().published, uint64_t(20000));
+    CHECK_EQ(writer->Pending(), uint32_t(0));
+}
+
+TEST_CASE(FramesFromAnotherProcessAreIntact)
+{
+    std::string name = TestHarness::UniqueName("wsp-ring");
+    ChildProcess producer;
+    REQUIRE(producer.Start(STUB_WORKER_PATH, { "ring-write", name, "20000" }));
+    std::unique_ptr<FrameRingReader> reader;
+    CHECK(TestHarness::WaitUntil([&]() { return (reader = FrameRingReader::Open(name)) != nullptr; }, 5000));
+    REQUIRE(reader);
+
+    RingFrame frame;
+    uint64_t received = 0, damaged = 0;
+    while (received < 20000 && reader->AcquireFrame(10000, &frame))
+    {
+        damaged += frame.sequence != received || !Intact(frame);
+        ++received;
+        // Now and then hold a frame long enough for the producer to fill the ring behind it
+        if (received % 1000 == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            damaged += !Intact(frame);
+        }
+    }
+    reader->ReleaseFrame();
+    CHECK_EQ(received, uint64_t(20000));
+    CHECK_EQ(damaged, uint64_t(0));
+    CHECK_EQ(WaitForExit(producer, 10000), 0);
+}
+
+TEST_CASE(ARestartedReaderResumesWhereTheLastOneStopped)
+{
+    std::string name = TestHarness::UniqueName("wsp-ring");
+    std::unique_ptr<FrameRingWriter> writer = FrameRingWriter::Create(name, 4, FramePattern::SLOT_BYTES);
+    REQUIRE(writer);
+
+    // The first reader dies mid-stream, possibly while holding a frame
+    ChildProcess first;
+    REQUIRE(first.Start(STUB_WORKER_PATH, { "ring-read", name, "1000000", "1000" }));
+    uint64_t next = 0;
+    for (; next < 50; ++next)
+        REQUIRE(Publish(*writer, next, 10000));
+    first.Kill();
+    for (; Publish(*writer, next, 0); ++next)
+    {
+    }
+    CHECK_EQ(writer->Pending(), writer->SlotCount());
+    uint64_t resumeAt = next - writer->SlotCount();
+    CHECK(resumeAt >= 40);
+
+    // The next reader picks up at the first frame not released, nothing skipped or repeated
+    ChildProcess second;
+    uint64_t total = next + 200;
+    REQUIRE(second.Start(STUB_WORKER_PATH, { "ring-read", name, std::to_string(total - resumeAt) }));
+    for (; next < total; ++next)
+        REQUIRE(Publish(*writer, next, 10000));
+    CHECK_EQ(WaitForExit(second, 10000), 0);
+    CHECK_EQ(writer->Pending(), uint32_t(0));
+
+    // Same from an in-process reader, which can see the sequence numbers
+    REQUIRE(Publish(*writer, next, 0));
+    std::unique_ptr<FrameRingReader> reader = FrameRingReader::Open(name);
+    REQUIRE(reader);
+    RingFrame frame;
+    REQUIRE(reader->AcquireFrame(0, &frame));
+    CHECK_EQ(frame.sequence, next);
+    CHECK(Intact(frame));
+}
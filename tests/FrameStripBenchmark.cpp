@@ -0,0 +1,94 @@
+#include "Benchmark.h"
+#include "FrameStrip.h"
+#include "GifWriter.h"
+#include "PngWriter.h"
+#include <vector>
+
+// Strips of 720p frames from a synthetic source: time spent scaling frames into cells and
+// compositing, and the cost and size of the animated GIF against one PNG of the whole strip.
+namespace
+{
+    class SyntheticSource : public FrameSource
+    {
+    public:
+        bool Open(MediaInfo* info) override
+        {
+            info->durationMs = 600000;
+            info->width = 1280;
+            info->height = 720;
+            return true;
+        }
+
+        bool ReadFrame(uint64_t timestampMs, PixelImage* frame) override
+        {
+            if (!frame->Allocate(1280, 720))
+                return false;
+            uint32_t shift = static_cast<uint32_t>(timestampMs / 1000);
+            for (uint32_t y = 0; y < 720; ++y)
+            {
+                uint8_t* p = frame->Row(y);
+                for (uint32_t x = 0; x < 1280; ++x, p += 4)
+                {
+                    p[0] = static_cast<uint8_t>((x + shift) / 5);
+                    p[1] = static_cast<uint8_t>(y / 3 + shift);
+                    p[2] = static_cast<uint8_t>(((x / 40) ^ (y / 40)) * 24 + shift);
+                    p[3] = 255;
+                }
+            }
+            return true;
+        }
+
+        void Close() override {}
+    };
+}
+
+int main(int argc, char** argv)
+{
+    const int strips = static_cast<int>(20 * BenchmarkScale(argc, argv));
+    FrameStripOptions options;
+    options.frameCount = 16;
+    options.frameWidth = 240;
+    options.frameHeight = 135;
+    options.columns = 4;
+
+    SyntheticSource source;
+    FrameStripResult result;
+    double buildMs = 0, gifMs = 0, pngMs = 0;
+    size_t gifBytes = 0, pngBytes = 0;
+    for (int i = 0; i < strips; ++i)
+    {
+        // Frame generation is the stand-in for decoding; time only the strip work around it
+        BenchmarkTimer timer;
+        BuildFrameStrip(source, options, &result);
+        buildMs += timer.Milliseconds();
+
+        timer.Restart();
+        std::vector<uint8_t> gif;
+        GifWriter writer([&gif](const uint8_t* data, size_t size)
+        {
+            gif.insert(gif.end(), data, data + size);
+            return true;
+        });
+        writer.Begin(options.frameWidth, options.frameHeight);
+        for (const PixelImage& frame : result.frames)
+            writer.AddFrame(frame, 500);
+        writer.Finish();
+        gifMs += timer.Milliseconds();
+        gifBytes = gif.size();
+
+        timer.Restart();
+        std::vector<uint8_t> png;
+        EncodePng(result.strip, &png, 6);
+        pngMs += timer.Milliseconds();
+        pngBytes = png.size();
+    }
+
+    double frames = static_cast<double>(strips) * options.frameCount;
+    ReportResult("strips", strips, "");
+    ReportResult("decode + scale per frame (720p -> 240x135)", buildMs / frames, "ms");
+    ReportResult("GIF encode per frame", gifMs / frames, "ms");
+    ReportResult("GIF size (16 frames)", gifBytes / 1024.0, "KB");
+    ReportResult("PNG encode per strip (level 6)", pngMs / strips, "ms");
+    ReportResult("PNG size (4x4 strip)", pngBytes / 1024.0, "KB");
+    return 0;
+}
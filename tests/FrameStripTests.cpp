@@ -0,0 +1,237 @@
+#include "TestHarness.h"
+#include "FrameStrip.h"
+#include "GifReader.h"
+#include "GifWriter.h"
+#include <cstdlib>
+#include <set>
+
+namespace
+{
+    // Synthetic video: every frame is one flat color derived from its timestamp
+    class FakeSource : public FrameSource
+    {
+    public:
+        FakeSource(uint64_t durationMs, uint32_t width, uint32_t height) : m_durationMs(durationMs), m_width(width), m_height(height) {}
+
+        bool Open(MediaInfo* info) override
+        {
+            ++opens;
+            info->durationMs = m_durationMs;
+            info->width = m_width;
+            info->height = m_height;
+            return !failOpen;
+        }
+
+        bool ReadFrame(uint64_t timestampMs, PixelImage* frame) override
+        {
+            if (!requested.empty() && timestampMs < requested.back())
+                outOfOrder = true;
+            requested.push_back(timestampMs);
+            if (failing.count(timestampMs))
+                return false;
+            frame->Allocate(m_width, m_height);
+            frame->alpha = AlphaMode::Ignore;
+            for (uint32_t y = 0; y < m_height; ++y)
+            {
+                uint8_t* p = frame->Row(y);
+                for (uint32_t x = 0; x < m_width; ++x, p += 4)
+                {
+                    ColorAt(timestampMs, p);
+                    p[3] = 17;      // Decoders may leave garbage in the unused channel
+                }
+            }
+            return true;
+        }
+
+        void Close() override { ++closes; }
+
+        static void ColorAt(uint64_t timestampMs, uint8_t* bgr)
+        {
+            bgr[0] = static_cast<uint8_t>(40 + timestampMs % 200);
+            bgr[1] = static_cast<uint8_t>(60 + timestampMs / 7 % 150);
+            bgr[2] = 200;
+        }
+
+        bool failOpen = false;
+        std::set<uint64_t> failing;
+        int opens = 0;
+        int closes = 0;
+        bool outOfOrder = false;
+        std::vector<uint64_t> requested;
+
+    private:
+        uint64_t m_durationMs;
+        uint32_t m_width;
+        uint32_t m_height;
+    };
+
+    FrameStripOptions Cells(uint32_t count, uint32_t width, uint32_t height, uint32_t columns = 0, uint32_t spacing = 2)
+    {
+        FrameStripOptions options;
+        options.frameCount = count;
+        options.frameWidth = width;
+        options.frameHeight = height;
+        options.columns = columns;
+        options.spacing = spacing;
+        return options;
+    }
+
+    bool IsColor(const uint8_t* p, uint8_t b, uint8_t g, uint8_t r)
+    {
+        return std::abs(p[0] - b) <= 1 && std::abs(p[1] - g) <= 1 && std::abs(p[2] - r) <= 1 && p[3] == 255;
+    }
+
+    bool IsFrameColor(const uint8_t* p, uint64_t timestampMs)
+    {
+        uint8_t expected[3];
+        FakeSource::ColorAt(timestampMs, expected);
+        return IsColor(p, expected[0], expected[1], expected[2]);
+    }
+}
+
+TEST_CASE(TimestampsAreSliceCenters)
+{
+    CHECK(ComputeStripTimestamps(1000, 4) == std::vector<uint64_t>({ 125, 375, 625, 875 }));
+    CHECK(ComputeStripTimestamps(60000, 1) == std::vector<uint64_t>({ 30000 }));
+    CHECK(ComputeStripTimestamps(0, 3) == std::vector<uint64_t>({ 0, 0, 0 }));
+    CHECK(ComputeStripTimestamps(1000, 0).empty());
+}
+
+TEST_CASE(StripOpensTheSourceOnceAndReadsInOrder)
+{
+    FakeSource source(8000, 64, 36);
+    FrameStripResult result;
+    REQUIRE(BuildFrameStrip(source, Cells(8, 32, 18), &result));
+    CHECK_EQ(source.opens, 1);
+    CHECK_EQ(source.closes, 1);
+    CHECK(!source.outOfOrder);
+    CHECK(source.requested == ComputeStripTimestamps(8000, 8));
+    CHECK(result.timestampsMs == source.requested);
+    CHECK_EQ(result.media.durationMs, uint64_t(8000));
+    CHECK_EQ(result.frames.size(), size_t(8));
+
+    // One row of 8 cells with 7 gaps
+    CHECK_EQ(result.strip.width, uint32_t(8 * 32 + 7 * 2));
+    CHECK_EQ(result.strip.height, uint32_t(18));
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        uint32_t left = i * 34;
+        CHECK(IsFrameColor(result.strip.Row(9) + (left + 16) * 4, result.timestampsMs[i]));
+        if (i < 7)
+            CHECK(IsColor(result.strip.Row(9) + (left + 32) * 4, 0, 0, 0));
+    }
+}
+
+TEST_CASE(FramesKeepTheirAspectRatioInsideTheCell)
+{
+    // 4:3 video in 16:9 cells: pillarboxed
+    FakeSource source(1000, 80, 60);
+    FrameStripResult result;
+    REQUIRE(BuildFrameStrip(source, Cells(1, 64, 36), &result));
+    const PixelImage& cell = result.frames[0];
+    REQUIRE(cell.width == 64 && cell.height == 36);
+    // 48 pixels wide, 8 black columns on each side
+    CHECK(IsColor(cell.Row(18) + 7 * 4, 0, 0, 0));
+    CHECK(IsFrameColor(cell.Row(18) + 8 * 4, 500));
+    CHECK(IsFrameColor(cell.Row(18) + 55 * 4, 500));
+    CHECK(IsColor(cell.Row(18) + 56 * 4, 0, 0, 0));
+    CHECK(IsFrameColor(cell.Row(0) + 32 * 4, 500));
+
+    // Ultra-wide video in the same cells: letterboxed
+    FakeSource wide(1000, 240, 60);
+    REQUIRE(BuildFrameStrip(wide, Cells(1, 64, 36), &result));
+    CHECK(IsColor(result.frames[0].Row(1) + 32 * 4, 0, 0, 0));
+    CHECK(IsFrameColor(result.frames[0].Row(18) + 32 * 4, 500));
+    CHECK(IsFrameColor(result.frames[0].Row(18) + 0, 500));
+}
+
+TEST_CASE(ColumnsWrapIntoRows)
+{
+    FakeSource source(5000, 32, 32);
+    FrameStripResult result;
+    REQUIRE(BuildFrameStrip(source, Cells(5, 20, 20, 2, 4), &result));
+    CHECK_EQ(result.strip.width, uint32_t(2 * 20 + 4));
+    CHECK_EQ(result.strip.height, uint32_t(3 * 20 + 2 * 4));
+    // Fifth frame: first column of the third row; the cell beside it stays black
+    CHECK(IsFrameColor(result.strip.Row(2 * 24 + 10) + 10 * 4, result.timestampsMs[4]));
+    CHECK(IsColor(result.strip.Row(2 * 24 + 10) + 34 * 4, 0, 0, 0));
+    CHECK(IsFrameColor(result.strip.Row(24 + 10) + 34 * 4, result.timestampsMs[3]));
+
+    // More columns than frames: one row
+    REQUIRE(BuildFrameStrip(source, Cells(3, 20, 20, 10, 0), &result));
+    CHECK_EQ(result.strip.width, uint32_t(60));
+    CHECK_EQ(result.strip.height, uint32_t(20));
+}
+
+TEST_CASE(ExplicitTimestampsAreSortedBeforeReading)
+{
+    FakeSource source(10000, 16, 16);
+    FrameStripOptions options = Cells(0, 16, 16);
+    options.timestampsMs = { 9000, 100, 4000 };
+    FrameStripResult result;
+    REQUIRE(BuildFrameStrip(source, options, &result));
+    CHECK(source.requested == std::vector<uint64_t>({ 100, 4000, 9000 }));
+    CHECK(!source.outOfOrder);
+    CHECK(IsFrameColor(result.frames[2].Row(8), 9000));
+
+    // The strip is capped at 256 frames
+    FakeSource many(100000, 4, 4);
+    REQUIRE(BuildFrameStrip(many, Cells(1000, 4, 4, 16, 0), &result));
+    CHECK_EQ(result.frames.size(), size_t(256));
+    CHECK_EQ(many.requested.size(), size_t(256));
+}
+
+TEST_CASE(UndecodableFramesStayBlack)
+{
+    FakeSource source(4000, 32, 32);
+    source.failing = { 1500 };
+    FrameStripResult result;
+    REQUIRE(BuildFrameStrip(source, Cells(4, 16, 16), &result));
+    CHECK(IsColor(result.frames[1].Row(8) + 8 * 4, 0, 0, 0));
+    CHECK(IsFrameColor(result.frames[2].Row(8) + 8 * 4, 2500));
+
+    FakeSource dead(4000, 32, 32);
+    dead.failing = { 500, 1500, 2500, 3500 };
+    CHECK(!BuildFrameStrip(dead, Cells(4, 16, 16), &result));
+    CHECK_EQ(dead.closes, 1);
+
+    FakeSource closed(4000, 32, 32);
+    closed.failOpen = true;
+    CHECK(!BuildFrameStrip(closed, Cells(4, 16, 16), &result));
+    CHECK_EQ(closed.closes, 1);
+    CHECK(closed.requested.empty());
+
+    CHECK(!BuildFrameStrip(source, Cells(4, 0, 16), &result));
+    CHECK(!BuildFrameStrip(source, Cells(4, 16, 16), nullptr));
+}
+
+// As the video strip API does it: the cells become an animated GIF
+TEST_CASE(StripFramesEncodeAsGif)
+{
+    FakeSource source(6000, 160, 90);
+    FrameStripResult result;
+    REQUIRE(BuildFrameStrip(source, Cells(6, 80, 45), &result));
+
+    std::vector<uint8_t> gif;
+    GifWriter writer([&gif](const uint8_t* data, size_t size)
+    {
+        gif.insert(gif.end(), data, data + size);
+        return true;
+    });
+    REQUIRE(writer.Begin(80, 45));
+    for (const PixelImage& frame : result.frames)
+        REQUIRE(writer.AddFrame(frame, 500));
+    REQUIRE(writer.Finish());
+
+    Reference::DecodedGif decoded;
+    REQUIRE(Reference::DecodeGif(gif, &decoded));
+    REQUIRE(decoded.frames.size() == 6);
+    for (size_t i = 0; i < 6; ++i)
+    {
+        uint8_t expected[3];
+        FakeSource::ColorAt(result.timestampsMs[i], expected);
+        const uint8_t* rgb = decoded.Pixel(i, 40, 22);
+        CHECK(std::abs(rgb[0] - expected[2]) <= 1 && std::abs(rgb[1] - expected[1]) <= 1 && std::abs(rgb[2] - expected[0]) <= 1);
+        CHECK_EQ(decoded.frames[i].delayCs, uint32_t(50));
+    }
+}
@@ -0,0 +1,268 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Minimal GIF87a/89a decoder written from the specification, independent of GifWriter, so the
+// tests can check what the encoder writes. Handles what an animation needs: global and local
+// color tables, graphic control delays, the NETSCAPE loop count and sub-frames; interlaced
+// images are rejected. Any malformed or truncated input fails.
+
+namespace Reference
+{
+    struct GifFrame
+    {
+        uint32_t delayCs = 0;           // Hundredths of a second
+        std::vector<uint8_t> rgb;       // Whole canvas after this frame, width * 3 bytes per row
+    };
+
+    struct DecodedGif
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        int loopCount = -1;             // -1 = no NETSCAPE2.0 extension
+        std::vector<GifFrame> frames;
+
+        const uint8_t* Pixel(size_t frame, uint32_t x, uint32_t y) const
+        {
+            return &frames[frame].rgb[(static_cast<size_t>(y) * width + x) * 3];
+        }
+    };
+
+    namespace GifDetail
+    {
+        class Reader
+        {
+        public:
+            Reader(const uint8_t* data, size_t size) : m_data(data), m_size(size), m_pos(0) {}
+
+            bool Byte(uint8_t* value)
+            {
+                if (m_pos >= m_size)
+                    return false;
+                *value = m_data[m_pos++];
+                return true;
+            }
+
+            bool Word(uint32_t* value)
+            {
+                uint8_t lo, hi;
+                if (!Byte(&lo) || !Byte(&hi))
+                    return false;
+                *value = lo | (hi << 8);
+                return true;
+            }
+
+            bool Bytes(size_t count, std::vector<uint8_t>* out)
+            {
+                if (m_size - m_pos < count)
+                    return false;
+                out->insert(out->end(), m_data + m_pos, m_data + m_pos + count);
+                m_pos += count;
+                return true;
+            }
+
+            // Concatenated data sub-blocks up to the zero-length terminator
+            bool SubBlocks(std::vector<uint8_t>* out)
+            {
+                for (;;)
+                {
+                    uint8_t length;
+                    if (!Byte(&length))
+                        return false;
+                    if (length == 0)
+                        return true;
+                    if (!Bytes(length, out))
+                        return false;
+                }
+            }
+
+        private:
+            const uint8_t* m_data;
+            size_t m_size;
+            size_t m_pos;
+        };
+
+        // Variable-length LZW (GIF89a appendix F). Requires the end code and exactly `count` indices.
+        inline bool DecodeLzw(const std::vector<uint8_t>& data, uint32_t minCodeSize, size_t count, std::vector<uint8_t>* out)
+        {
+            if (minCodeSize < 2 || minCodeSize > 8)
+                return false;
+            const uint32_t clearCode = 1u << minCodeSize;
+            const uint32_t endCode = clearCode + 1;
+
+            std::vector<uint16_t> prefix(4096);
+            std::vector<uint8_t> suffix(4096);
+            std::vector<uint16_t> length(4096);
+            for (uint32_t i = 0; i < clearCode; ++i)
+            {
+                suffix[i] = static_cast<uint8_t>(i);
+                length[i] = 1;
+            }
+
+            uint32_t codeSize = minCodeSize + 1;
+            uint32_t next = endCode + 1;
+            int previous = -1;
+            uint64_t bits = 0;
+            uint32_t bitCount = 0;
+            size_t pos = 0;
+            std::vector<uint8_t> string;
+
+            out->clear();
+            for (;;)
+            {
+                while (bitCount < codeSize)
+                {
+                    if (pos >= data.size())
+                        return false;
+                    bits |= static_cast<uint64_t>(data[pos++]) << bitCount;
+                    bitCount += 8;
+                }
+                uint32_t code = static_cast<uint32_t>(bits & ((1u << codeSize) - 1));
+                bits >>= codeSize;
+                bitCount -= codeSize;
+
+                if (code == clearCode)
+                {
+                    codeSize = minCodeSize + 1;
+                    next = endCode + 1;
+                    previous = -1;
+                    continue;
+                }
+                if (code == endCode)
+                    break;
+
+                if (previous < 0)
+                {
+                    if (code >= clearCode)
+                        return false;
+                    out->push_back(static_cast<uint8_t>(code));
+                    previous = static_cast<int>(code);
+                    continue;
+                }
+
+                uint32_t expand = code;
+                if (code > next || (code == next && next >= 4096))
+                    return false;
+                if (code == next)
+                    expand = static_cast<uint32_t>(previous);
+
+                string.resize(length[expand]);
+                for (uint32_t c = expand, i = length[expand]; i > 0; c = prefix[c])
+                    string[--i] = suffix[c];
+                uint8_t first = string[0];
+                if (code == next)
+                    string.push_back(first);
+                out->insert(out->end(), string.begin(), string.end());
+
+                if (next < 4096)
+                {
+                    prefix[next] = static_cast<uint16_t>(previous);
+                    suffix[next] = first;
+                    length[next] = static_cast<uint16_t>(length[previous] + 1);
+                    ++next;
+                    if (next == (1u << codeSize) && codeSize < 12)
+                        ++codeSize;
+                }
+                previous = static_cast<int>(code);
+            }
+            return out->size() == count;
+        }
+    }
+
+    inline bool DecodeGif(const uint8_t* data, size_t size, DecodedGif* out)
+    {
+        GifDetail::Reader reader(data, size);
+        std::vector<uint8_t> signature;
+        if (!reader.Bytes(6, &signature) ||
+            (memcmp(signature.data(), "GIF89a", 6) != 0 && memcmp(signature.data(), "GIF87a", 6) != 0))
+            return false;
+
+        *out = DecodedGif();
+        uint8_t flags, background, aspect;
+        if (!reader.Word(&out->width) || !reader.Word(&out->height) || !reader.Byte(&flags) ||
+            !reader.Byte(&background) || !reader.Byte(&aspect) || out->width == 0 || out->height == 0)
+            return false;
+
+        std::vector<uint8_t> globalTable;
+        if ((flags & 0x80) && !reader.Bytes(3u << ((flags & 7) + 1), &globalTable))
+            return false;
+
+        std::vector<uint8_t> canvas(static_cast<size_t>(out->width) * out->height * 3, 0);
+        uint32_t delay = 0;
+        for (;;)
+        {
+            uint8_t introducer;
+            if (!reader.Byte(&introducer))
+                return false;
+            if (introducer == 0x3B)
+                return true;
+
+            if (introducer == 0x21)
+            {
+                uint8_t label;
+                std::vector<uint8_t> body;
+                if (!reader.Byte(&label) || !reader.SubBlocks(&body))
+                    return false;
+                if (label == 0xF9)
+                {
+                    if (body.size() != 4)
+                        return false;
+                    delay = body[1] | (body[2] << 8);
+                }
+                else if (label == 0xFF && body.size() == 11 + 3 && memcmp(body.data(), "NETSCAPE2.0", 11) == 0 && body[11] == 1)
+                {
+                    out->loopCount = body[12] | (body[13] << 8);
+                }
+                continue;
+            }
+
+            if (introducer != 0x2C)
+                return false;
+
+            uint32_t left, top, width, height;
+            uint8_t imageFlags, minCodeSize;
+            if (!reader.Word(&left) || !reader.Word(&top) || !reader.Word(&width) || !reader.Word(&height) ||
+                !reader.Byte(&imageFlags))
+                return false;
+            if (imageFlags & 0x40)
+                return false;       // Interlaced
+            if (width == 0 || height == 0 || left + width > out->width || top + height > out->height)
+                return false;
+
+            std::vector<uint8_t> localTable;
+            if ((imageFlags & 0x80) && !reader.Bytes(3u << ((imageFlags & 7) + 1), &localTable))
+                return false;
+            const std::vector<uint8_t>& table = localTable.empty() ? globalTable : localTable;
+            if (table.empty())
+                return false;
+
+            std::vector<uint8_t> codes, indices;
+            if (!reader.Byte(&minCodeSize) || !reader.SubBlocks(&codes) ||
+                !GifDetail::DecodeLzw(codes, minCodeSize, static_cast<size_t>(width) * height, &indices))
+                return false;
+
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    uint32_t index = indices[static_cast<size_t>(y) * width + x];
+                    if (index * 3 + 2 >= table.size())
+                        return false;
+                    memcpy(&canvas[((static_cast<size_t>(top) + y) * out->width + left + x) * 3], &table[index * 3], 3);
+                }
+            }
+
+            GifFrame frame;
+            frame.delayCs = delay;
+            frame.rgb = canvas;
+            out->frames.push_back(std::move(frame));
+            delay = 0;
+        }
+    }
+
+    inline bool DecodeGif(const std::vector<uint8_t>& data, DecodedGif* out)
+    {
+        return DecodeGif(data.data(), data.size(), out);
+    }
+}
@@ -0,0 +1,258 @@
+#include "TestHarness.h"
+#include "GifReader.h"
+#include "GifWriter.h"
+#include "TestData.h"
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+    // Colors at the centers of 5-bit bins, one per bin, so a frame with at most 256 of them
+    // must come back exactly
+    void BinCenter(uint32_t index, uint8_t* bgr)
+    {
+        bgr[0] = static_cast<uint8_t>(((index * 7) & 31) * 8 + 4);
+        bgr[1] = static_cast<uint8_t>(((index * 3) & 31) * 8 + 4);
+        bgr[2] = static_cast<uint8_t>((index & 31) * 8 + 4);
+    }
+
+    PixelImage PaletteImage(uint32_t width, uint32_t height, uint32_t colors, uint32_t seed)
+    {
+        PixelImage image;
+        image.Allocate(width, height);
+        std::mt19937 random(seed);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            uint8_t* p = image.Row(y);
+            for (uint32_t x = 0; x < width; ++x, p += 4)
+            {
+                // Runs of one color, so the LZW table gets long strings as well as short ones
+                uint32_t index = ((x / 5 + y / 3) * 31 + (random() % 4 == 0 ? random() : 0)) % colors;
+                BinCenter(index, p);
+                p[3] = 255;
+            }
+        }
+        return image;
+    }
+
+    PixelImage Photo(uint32_t width, uint32_t height, uint32_t seed)
+    {
+        PixelImage image;
+        image.Allocate(width, height);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            uint8_t* p = image.Row(y);
+            for (uint32_t x = 0; x < width; ++x, p += 4)
+            {
+                p[0] = static_cast<uint8_t>(x * 255 / width);
+                p[1] = static_cast<uint8_t>(y * 255 / height + seed * 20);
+                p[2] = static_cast<uint8_t>((x + y) * 2 + seed * 50);
+                p[3] = 255;
+            }
+        }
+        return image;
+    }
+
+    std::vector<uint8_t> Encode(const std::vector<const PixelImage*>& frames, uint32_t delayMs, uint32_t loopCount = 0)
+    {
+        std::vector<uint8_t> gif;
+        GifWriter writer([&gif](const uint8_t* data, size_t size)
+        {
+            gif.insert(gif.end(), data, data + size);
+            return true;
+        });
+        bool ok = writer.Begin(frames[0]->width, frames[0]->height, loopCount);
+        for (const PixelImage* frame : frames)
+            ok = ok && writer.AddFrame(*frame, delayMs);
+        ok = ok && writer.Finish();
+        return ok ? gif : std::vector<uint8_t>();
+    }
+
+    // Largest channel difference between frame `index` of a decoded GIF and image
+    int MaxError(const Reference::DecodedGif& gif, size_t index, const PixelImage& image)
+    {
+        int worst = 0;
+        for (uint32_t y = 0; y < image.height; ++y)
+        {
+            const uint8_t* p = image.Row(y);
+            for (uint32_t x = 0; x < image.width; ++x, p += 4)
+            {
+                const uint8_t* rgb = gif.Pixel(index, x, y);
+                for (int c = 0; c < 3; ++c)
+                    worst = (std::max)(worst, std::abs(rgb[c] - p[2 - c]));
+            }
+        }
+        return worst;
+    }
+
+    // Share of pixels of frame `index` within `tolerance` of image on every channel
+    double ShareWithin(const Reference::DecodedGif& gif, size_t index, const PixelImage& image, int tolerance)
+    {
+        size_t close = 0;
+        for (uint32_t y = 0; y < image.height; ++y)
+        {
+            const uint8_t* p = image.Row(y);
+            for (uint32_t x = 0; x < image.width; ++x, p += 4)
+            {
+                const uint8_t* rgb = gif.Pixel(index, x, y);
+                close += std::abs(rgb[0] - p[2]) <= tolerance && std::abs(rgb[1] - p[1]) <= tolerance &&
+                         std::abs(rgb[2] - p[0]) <= tolerance;
+            }
+        }
+        return static_cast<double>(close) / (static_cast<size_t>(image.width) * image.height);
+    }
+}
+
+TEST_CASE(FramesWithFewColorsDecodeExactly)
+{
+    for (uint32_t colors : { 1u, 2u, 3u, 5u, 17u, 64u, 200u, 256u })
+    {
+        PixelImage image = PaletteImage(97, 61, colors, colors);
+        std::vector<uint8_t> gif = Encode({ &image }, 100);
+        Reference::DecodedGif decoded;
+        REQUIRE(Reference::DecodeGif(gif, &decoded));
+        REQUIRE(decoded.frames.size() == 1);
+        CHECK_EQ(decoded.width, uint32_t(97));
+        CHECK_EQ(decoded.height, uint32_t(61));
+        CHECK_EQ(MaxError(decoded, 0, image), 0);
+    }
+}
+
+TEST_CASE(LargeFramesOverflowTheCodeTable)
+{
+    // Noise over 256 colors fills the 4096-entry table many times over
+    PixelImage image;
+    image.Allocate(640, 480);
+    std::mt19937 random(5);
+    for (uint32_t y = 0; y < image.height; ++y)
+    {
+        uint8_t* p = image.Row(y);
+        for (uint32_t x = 0; x < image.width; ++x, p += 4)
+        {
+            BinCenter(random() % 256, p);
+            p[3] = 255;
+        }
+    }
+    PixelImage second = PaletteImage(640, 480, 256, 1);
+    std::vector<uint8_t> gif = Encode({ &image, &second }, 40);
+    Reference::DecodedGif decoded;
+    REQUIRE(Reference::DecodeGif(gif, &decoded));
+    REQUIRE(decoded.frames.size() == 2);
+    CHECK_EQ(MaxError(decoded, 0, image), 0);
+    CHECK_EQ(MaxError(decoded, 1, second), 0);
+}
+
+TEST_CASE(PhotosAreCloseWithTheirOwnPalettes)
+{
+    std::vector<PixelImage> frames;
+    std::vector<const PixelImage*> pointers;
+    for (uint32_t i = 0; i < 4; ++i)
+        frames.push_back(Photo(160, 90, i));
+    for (const PixelImage& frame : frames)
+        pointers.push_back(&frame);
+    std::vector<uint8_t> gif = Encode(pointers, 250);
+    Reference::DecodedGif decoded;
+    REQUIRE(Reference::DecodeGif(gif, &decoded));
+    REQUIRE(decoded.frames.size() == 4);
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        // Each frame is quantized on its own; median cut may leave a rare outlier color far off,
+        // so only the bulk of the pixels is held to a bound
+        CHECK(ShareWithin(decoded, i, frames[i], 24) >= 0.999);
+        CHECK(ShareWithin(decoded, i, frames[i], 12) >= 0.9);
+        CHECK_EQ(decoded.frames[i].delayCs, uint32_t(25));
+    }
+}
+
+TEST_CASE(DelayAndLoopCountAreWritten)
+{
+    PixelImage frame = PaletteImage(8, 8, 4, 1);
+    Reference::DecodedGif decoded;
+    REQUIRE(Reference::DecodeGif(Encode({ &frame, &frame }, 33, 3), &decoded));
+    CHECK_EQ(decoded.loopCount, 3);
+    CHECK_EQ(decoded.frames[0].delayCs, uint32_t(3));
+    REQUIRE(Reference::DecodeGif(Encode({ &frame }, 0), &decoded));
+    CHECK_EQ(decoded.loopCount, 0);
+    CHECK_EQ(decoded.frames[0].delayCs, uint32_t(0));
+}
+
+TEST_CASE(TransparencyIsCompositedOverBlack)
+{
+    PixelImage straight;
+    straight.Allocate(10, 10);
+    straight.alpha = AlphaMode::Straight;
+    PixelImage premultiplied;
+    premultiplied.Allocate(10, 10);
+    premultiplied.alpha = AlphaMode::Premultiplied;
+    for (uint32_t y = 0; y < 10; ++y)
+    {
+        uint8_t* s = straight.Row(y);
+        uint8_t* p = premultiplied.Row(y);
+        for (uint32_t x = 0; x < 10; ++x, s += 4, p += 4)
+        {
+            s[0] = 200; s[1] = 100; s[2] = 0; s[3] = 128;
+            p[0] = 100; p[1] = 50; p[2] = 0; p[3] = 128;
+        }
+    }
+
+    Reference::DecodedGif decoded;
+    REQUIRE(Reference::DecodeGif(Encode({ &straight, &premultiplied }, 10), &decoded));
+    for (size_t frame = 0; frame < 2; ++frame)
+    {
+        const uint8_t* rgb = decoded.Pixel(frame, 5, 5);
+        CHECK_EQ(rgb[0], uint8_t(0));
+        CHECK(std::abs(rgb[1] - 50) <= 1);
+        CHECK(std::abs(rgb[2] - 100) <= 1);
+    }
+}
+
+TEST_CASE(WriterRejectsMisuseAndStopsWhenTheSinkFails)
+{
+    PixelImage frame = PaletteImage(16, 16, 8, 1);
+    GifWriter idle([](const uint8_t*, size_t) { return true; });
+    CHECK(!idle.AddFrame(frame, 10));
+    CHECK(!idle.Finish());
+    CHECK(!idle.Begin(0, 10));
+    CHECK(!idle.Begin(70000, 10));
+
+    REQUIRE(idle.Begin(16, 16));
+    CHECK(!idle.AddFrame(PaletteImage(15, 16, 8, 1), 10));
+    CHECK(!idle.AddFrame(PixelImage(), 10));
+    CHECK(idle.AddFrame(frame, 10));
+    CHECK_EQ(idle.FramesWritten(), uint32_t(1));
+
+    size_t budget = 200, written = 0;
+    GifWriter limited([&](const uint8_t*, size_t size)
+    {
+        if (written + size > budget)
+            return false;
+        written += size;
+        return true;
+    });
+    REQUIRE(limited.Begin(16, 16));
+    CHECK(!limited.AddFrame(PaletteImage(16, 16, 256, 2), 10));
+    // Once the sink has failed nothing else is written
+    size_t before = written;
+    CHECK(!limited.AddFrame(frame, 10));
+    CHECK(!limited.Finish());
+    CHECK_EQ(written, before);
+}
+
+TEST_CASE(SavedFileDecodes)
+{
+    TestHarness::TempDirectory dir;
+    std::vector<PixelImage> frames;
+    frames.push_back(Photo(64, 36, 1));
+    frames.push_back(Photo(64, 36, 2));
+    frames.push_back(PaletteImage(64, 36, 30, 3));
+    REQUIRE(SaveFramesAsGif(frames, 500, dir / "strip.gif"));
+    CHECK(!SaveFramesAsGif({}, 500, dir / "empty.gif"));
+
+    std::vector<uint8_t> gif = TestData::ReadFile(dir / "strip.gif");
+    CHECK(gif == Encode({ &frames[0], &frames[1], &frames[2] }, 500));
+    Reference::DecodedGif decoded;
+    REQUIRE(Reference::DecodeGif(gif, &decoded));
+    REQUIRE(decoded.frames.size() == 3);
+    CHECK_EQ(decoded.loopCount, 0);
+    CHECK_EQ(MaxError(decoded, 2, frames[2]), 0);
+}
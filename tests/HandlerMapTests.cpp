@@ -0,0 +1,262 @@
+#include "TestHarness.h"
+#include "HandlerMap.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using TestHarness::WaitUntil;
+
+namespace
+{
+    HandlerClsid Id(int n)
+    {
+        HandlerClsid clsid;
+        memset(clsid.bytes, n, sizeof(clsid.bytes));
+        return clsid;
+    }
+
+    bool SameId(const HandlerClsid& clsid, int n)
+    {
+        HandlerClsid expected = Id(n);
+        return memcmp(clsid.bytes, expected.bytes, sizeof(expected.bytes)) == 0;
+    }
+
+    // Holds every Resolve until released, to race Invalidate against a slow registry lookup
+    class GatedResolver : public TableHandlerResolver
+    {
+    public:
+        HandlerResolution Resolve(const std::string& extensionKey, HandlerClsid* clsid) override
+        {
+            waiting.store(true);
+            while (!release.load())
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return TableHandlerResolver::Resolve(extensionKey, clsid);
+        }
+
+        std::atomic<bool> waiting{false};
+        std::atomic<bool> release{false};
+    };
+}
+
+TEST_CASE(AnswersAreCachedIncludingMissingHandlers)
+{
+    std::shared_ptr<TableHandlerResolver> resolver = std::make_shared<TableHandlerResolver>();
+    resolver->Set(".docx", Id(1));
+    resolver->Set(".pdf", Id(2));
+    HandlerMap map(resolver, 64);
+    HandlerClsid clsid;
+
+    CHECK_EQ(map.Preload(), size_t(2));
+    CHECK_EQ(resolver->ResolveCount(), uint64_t(2));
+    CHECK(map.Find(".docx", &clsid) == HandlerResolution::Found);
+    CHECK(SameId(clsid, 1));
+    CHECK(map.Find(".xyz", &clsid) == HandlerResolution::None);
+    CHECK(SameId(clsid, 0));
+    CHECK(map.Find(".xyz", &clsid) == HandlerResolution::None);
+    CHECK(map.Find(".pdf", &clsid) == HandlerResolution::Found);
+    CHECK(SameId(clsid, 2));
+    CHECK_EQ(resolver->ResolveCount(), uint64_t(3));
+
+    HandlerMapStats stats = map.Stats();
+    CHECK_EQ(stats.lookups, uint64_t(4));
+    CHECK_EQ(stats.hits, uint64_t(3));
+    CHECK_EQ(stats.negativeHits, uint64_t(1));
+    CHECK_EQ(stats.resolved, uint64_t(3));
+    CHECK_EQ(stats.preloaded, uint64_t(2));
+    CHECK_EQ(stats.entries, uint64_t(3));
+    CHECK_EQ(stats.negativeEntries, uint64_t(1));
+}
+
+TEST_CASE(FailuresAndOversizedKeysAreNotCached)
+{
+    std::shared_ptr<TableHandlerResolver> resolver = std::make_shared<TableHandlerResolver>();
+    resolver->Set(".abc", Id(3));
+    HandlerMap map(resolver, 64);
+    HandlerClsid clsid;
+
+    resolver->SetFailing(true);
+    CHECK(map.Find(".abc", &clsid) == HandlerResolution::Failed);
+    resolver->SetFailing(false);
+    CHECK(map.Find(".abc", &clsid) == HandlerResolution::Found);
+    CHECK(SameId(clsid, 3));
+    CHECK_EQ(map.Stats().failures, uint64_t(1));
+
+    // Exactly MAX_KEY_BYTES still fits; one more is resolved every time
+    std::string longest = "." + std::string(HandlerMap::MAX_KEY_BYTES - 1, 'a');
+    std::string tooLong = longest + "a";
+    resolver->Set(tooLong, Id(4));
+    uint64_t before = resolver->ResolveCount();
+    for (int i = 0; i < 3; ++i)
+    {
+        CHECK(map.Find(longest, &clsid) == HandlerResolution::None);
+        CHECK(map.Find(tooLong, &clsid) == HandlerResolution::Found);
+        CHECK(SameId(clsid, 4));
+    }
+    CHECK_EQ(resolver->ResolveCount() - before, uint64_t(1 + 3));
+    CHECK_EQ(map.Stats().uncached, uint64_t(3));
+    CHECK(map.Find(std::string_view(), &clsid) != HandlerResolution::Found);
+}
+
+TEST_CASE(InvalidateDropsEntriesAndRefreshRestoresTheOnesInUse)
+{
+    std::shared_ptr<TableHandlerResolver> resolver = std::make_shared<TableHandlerResolver>();
+    resolver->Set(".docx", Id(1));
+    resolver->Set(".pdf", Id(2));
+    resolver->Set(".unused", Id(9));
+    HandlerMap map(resolver, 64);
+    HandlerClsid clsid;
+    map.Find(".docx", &clsid);
+    map.Find(".pdf", &clsid);
+    map.Find(".xyz", &clsid);
+
+    // The registry changes: .xyz gains a handler, .pdf loses its own
+    resolver->Set(".xyz", Id(7));
+    resolver->Remove(".pdf");
+    map.Invalidate();
+    CHECK_EQ(map.Stats().entries, uint64_t(0));
+    CHECK_EQ(map.Stats().invalidations, uint64_t(1));
+    CHECK(map.Entries().empty());
+
+    uint64_t before = resolver->ResolveCount();
+    CHECK_EQ(map.Refresh(), size_t(3));
+    CHECK_EQ(resolver->ResolveCount() - before, uint64_t(3));
+    CHECK(map.Find(".xyz", &clsid) == HandlerResolution::Found);
+    CHECK(SameId(clsid, 7));
+    CHECK(map.Find(".pdf", &clsid) == HandlerResolution::None);
+    CHECK(map.Find(".docx", &clsid) == HandlerResolution::Found);
+    CHECK_EQ(resolver->ResolveCount() - before, uint64_t(3));
+
+    // Nothing invalidated since: nothing to refresh
+    CHECK_EQ(map.Refresh(), size_t(0));
+}
+
+TEST_CASE(AResolveStartedBeforeInvalidateIsNotStored)
+{
+    std::shared_ptr<GatedResolver> resolver = std::make_shared<GatedResolver>();
+    resolver->Set(".docx", Id(1));
+    HandlerMap map(resolver, 64);
+
+    HandlerResolution result = HandlerResolution::Failed;
+    HandlerClsid clsid;
+    std::thread finder([&]() { result = map.Find(".docx", &clsid); });
+    REQUIRE(WaitUntil([&resolver]() { return resolver->waiting.load(); }, 5000));
+
+    // The answer in flight predates the change
+    resolver->Set(".docx", Id(5));
+    map.Invalidate();
+    resolver->release.store(true);
+    finder.join();
+    CHECK(result == HandlerResolution::Found);
+    CHECK_EQ(map.Stats().entries, uint64_t(0));
+
+    HandlerClsid next;
+    CHECK(map.Find(".docx", &next) == HandlerResolution::Found);
+    CHECK(SameId(next, 5));
+    CHECK_EQ(map.Stats().entries, uint64_t(1));
+}
+
+TEST_CASE(AFullTableStillAnswersEveryLookup)
+{
+    std::shared_ptr<TableHandlerResolver> resolver = std::make_shared<TableHandlerResolver>();
+    for (int i = 0; i < 500; i += 2)
+        resolver->Set(".e" + std::to_string(i), Id(i % 256));
+    HandlerMap map(resolver, 64);
+    for (int round = 0; round < 2; ++round)
+    {
+        for (int i = 0; i < 500; ++i)
+        {
+            HandlerClsid clsid;
+            HandlerResolution resolution = map.Find(".e" + std::to_string(i), &clsid);
+            CHECK(resolution == (i % 2 ? HandlerResolution::None : HandlerResolution::Found));
+            CHECK(SameId(clsid, i % 2 ? 0 : i % 256));
+        }
+    }
+    HandlerMapStats stats = map.Stats();
+    CHECK(stats.entries <= 64);
+    CHECK(stats.entries > 0);
+    CHECK(stats.uncached > 0);
+    CHECK_EQ(map.Entries().size(), static_cast<size_t>(stats.entries));
+}
+
+TEST_CASE(EntriesRestoreIntoAFreshMap)
+{
+    std::shared_ptr<TableHandlerResolver> resolver = std::make_shared<TableHandlerResolver>();
+    resolver->Set(".docx", Id(1));
+    resolver->Set(".pdf", Id(2));
+    HandlerMap first(resolver, 64);
+    HandlerClsid clsid;
+    first.Find(".docx", &clsid);
+    first.Find(".pdf", &clsid);
+    first.Find(".xyz", &clsid);
+
+    std::vector<HandlerMapEntry> entries = first.Entries();
+    std::sort(entries.begin(), entries.end(),
+              [](const HandlerMapEntry& a, const HandlerMapEntry& b) { return a.extensionKey < b.extensionKey; });
+    REQUIRE(entries.size() == 3);
+    CHECK_EQ(entries[0].extensionKey, std::string(".docx"));
+    CHECK(entries[0].resolution == HandlerResolution::Found && SameId(entries[0].clsid, 1));
+    CHECK_EQ(entries[2].extensionKey, std::string(".xyz"));
+    CHECK(entries[2].resolution == HandlerResolution::None && SameId(entries[2].clsid, 0));
+
+    // A later process serves the saved answers without asking the resolver, even stale ones
+    resolver->Remove(".pdf");
+    HandlerMapEntry failed = { ".bad", HandlerResolution::Failed, Id(3) };
+    HandlerMapEntry oversized = { "." + std::string(40, 'z'), HandlerResolution::Found, Id(4) };
+    entries.push_back(failed);
+    entries.push_back(oversized);
+    HandlerMap second(resolver, 64);
+    uint64_t before = resolver->ResolveCount();
+    CHECK_EQ(second.Restore(entries), size_t(3));
+    CHECK(second.Find(".pdf", &clsid) == HandlerResolution::Found);
+    CHECK(SameId(clsid, 2));
+    CHECK(second.Find(".xyz", &clsid) == HandlerResolution::None);
+    CHECK_EQ(resolver->ResolveCount(), before);
+    CHECK_EQ(second.Stats().restored, uint64_t(3));
+
+    // Refresh checks the restored entries against the resolver
+    CHECK_EQ(second.Refresh(), size_t(3));
+    CHECK(second.Find(".pdf", &clsid) == HandlerResolution::None);
+    CHECK(second.Find(".docx", &clsid) == HandlerResolution::Found);
+    CHECK_EQ(resolver->ResolveCount() - before, uint64_t(3));
+}
+
+TEST_CASE(ReadersNeverSeeTornEntries)
+{
+    std::shared_ptr<TableHandlerResolver> resolver = std::make_shared<TableHandlerResolver>();
+    resolver->Set(".docx", Id(1));
+    resolver->Set(".xyz", Id(7));
+    HandlerMap map(resolver, 256);
+    map.Preload();
+
+    std::atomic<bool> stop(false);
+    std::atomic<long> bad(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t)
+    {
+        readers.emplace_back([&]()
+        {
+            HandlerClsid clsid;
+            while (!stop.load())
+            {
+                if (map.Find(".docx", &clsid) != HandlerResolution::Found || !SameId(clsid, 1))
+                    bad++;
+                if (map.Find(".xyz", &clsid) != HandlerResolution::Found || !SameId(clsid, 7))
+                    bad++;
+                if (map.Find(".none", &clsid) != HandlerResolution::None || !SameId(clsid, 0))
+                    bad++;
+            }
+        });
+    }
+    for (int i = 0; i < 2000; ++i)
+    {
+        map.Invalidate();
+        if (i % 3 == 0)
+            map.Refresh();
+    }
+    stop.store(true);
+    for (std::thread& reader : readers)
+        reader.join();
+    CHECK_EQ(bad.load(), long(0));
+}
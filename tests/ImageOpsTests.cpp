@@ -0,0 +1,295 @@
+#include "TestHarness.h"
+#include "ImageOps.h"
+#include "ContentHash.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    void FillPattern(PixelImage* image, uint32_t seed)
+    {
+        for (uint32_t y = 0; y < image->height; ++y)
+        {
+            uint8_t* row = image->Row(y);
+            for (uint32_t x = 0; x < image->width * 4; ++x)
+                row[x] = static_cast<uint8_t>((x * 7 + y * 13 + seed) * 2654435761u >> 24);
+        }
+    }
+
+    void FillRandom(PixelImage* image, std::mt19937& random)
+    {
+        for (uint32_t y = 0; y < image->height; ++y)
+        {
+            uint8_t* row = image->Row(y);
+            for (uint32_t x = 0; x < image->width * 4; ++x)
+                row[x] = static_cast<uint8_t>(random());
+        }
+    }
+
+    void FillColor(PixelImage* image, uint8_t b, uint8_t g, uint8_t r, uint8_t a)
+    {
+        for (uint32_t y = 0; y < image->height; ++y)
+        {
+            uint8_t* row = image->Row(y);
+            for (uint32_t x = 0; x < image->width; ++x)
+            {
+                row[x * 4 + 0] = b;
+                row[x * 4 + 1] = g;
+                row[x * 4 + 2] = r;
+                row[x * 4 + 3] = a;
+            }
+        }
+    }
+
+    uint64_t HashPixels(const PixelImage& image, uint64_t seed)
+    {
+        for (uint32_t y = 0; y < image.height; ++y)
+            seed = HashXxh64(image.Row(y), static_cast<size_t>(image.width) * 4, seed);
+        return seed;
+    }
+}
+
+// Output of the SSE2 and the scalar resampler on a fixed set of shapes. Both paths produced this
+// value when it was recorded, so a change here means the resampler's arithmetic changed.
+TEST_CASE(ResizeMatchesRecordedOutput)
+{
+    const uint32_t shapes[][4] = { { 100, 80, 37, 29 }, { 37, 29, 100, 80 }, { 1, 1, 5, 7 }, { 5, 7, 1, 1 },
+                                   { 640, 480, 256, 192 }, { 333, 17, 1000, 3 }, { 4000, 1, 3, 1 },
+                                   { 3, 3, 3, 300 }, { 8192, 2, 1, 1 } };
+    std::mt19937 random(5);
+    uint64_t hash = 0;
+    for (const auto& shape : shapes)
+    {
+        PixelImage source;
+        REQUIRE(source.Allocate(shape[0], shape[1]));
+        FillRandom(&source, random);
+        PixelImage resized;
+        REQUIRE(ResizePixelImage(source, shape[2], shape[3], &resized));
+        CHECK_EQ(resized.width, shape[2]);
+        CHECK_EQ(resized.height, shape[3]);
+        hash = HashPixels(resized, hash);
+    }
+    CHECK_EQ(hash, uint64_t(0x4efb26d09db142d1ull));
+}
+
+TEST_CASE(ResizeKeepsFlatAreasFlat)
+{
+    PixelImage source;
+    REQUIRE(source.Allocate(317, 211));
+    FillColor(&source, 10, 128, 250, 77);
+    source.alpha = AlphaMode::Premultiplied;
+
+    const uint32_t sizes[][2] = { { 96, 64 }, { 1, 1 }, { 1000, 700 }, { 317, 50 }, { 3, 211 } };
+    for (const auto& size : sizes)
+    {
+        PixelImage resized;
+        REQUIRE(ResizePixelImage(source, size[0], size[1], &resized));
+        CHECK(resized.alpha == AlphaMode::Premultiplied);
+        for (uint32_t y = 0; y < resized.height; ++y)
+        {
+            const uint8_t* row = resized.Row(y);
+            for (uint32_t x = 0; x < resized.width; ++x)
+                REQUIRE(row[x * 4] == 10 && row[x * 4 + 1] == 128 && row[x * 4 + 2] == 250 && row[x * 4 + 3] == 77);
+        }
+    }
+}
+
+TEST_CASE(ResizeByTwoAveragesEachBlock)
+{
+    PixelImage source;
+    REQUIRE(source.Allocate(64, 48));
+    FillPattern(&source, 3);
+
+    PixelImage resized;
+    REQUIRE(ResizePixelImage(source, 32, 24, &resized));
+    for (uint32_t y = 0; y < 24; ++y)
+    {
+        for (uint32_t x = 0; x < 32 * 4; ++x)
+        {
+            uint32_t c = x % 4;
+            uint32_t sx = (x / 4) * 8 + c;
+            int sum = source.Row(y * 2)[sx] + source.Row(y * 2)[sx + 4] + source.Row(y * 2 + 1)[sx] + source.Row(y * 2 + 1)[sx + 4];
+            // Two rounding steps (one per pass) allow one unit of difference
+            REQUIRE(std::abs(resized.Row(y)[x] * 4 - sum) <= 4 + 2);
+        }
+    }
+}
+
+TEST_CASE(ResizeToTheSameSizeCopies)
+{
+    PixelImage source;
+    REQUIRE(source.Allocate(40, 30));
+    FillPattern(&source, 9);
+    source.alpha = AlphaMode::Straight;
+
+    PixelImage copy;
+    REQUIRE(ResizePixelImage(source, 40, 30, &copy));
+    CHECK(copy.alpha == AlphaMode::Straight);
+    CHECK_EQ(HashPixels(copy, 0), HashPixels(source, 0));
+}
+
+TEST_CASE(ResizeRejectsInvalidArguments)
+{
+    PixelImage source;
+    PixelImage out;
+    CHECK(!ResizePixelImage(source, 10, 10, &out));
+    REQUIRE(source.Allocate(8, 8));
+    CHECK(!ResizePixelImage(source, 0, 10, &out));
+    CHECK(!ResizePixelImage(source, 10, 0, &out));
+    CHECK(!ResizePixelImage(source, 4, 4, nullptr));
+    CHECK(!ResizePixelImage(source, 4, 4, &source));
+}
+
+TEST_CASE(ResizeScratchComesFromThePool)
+{
+    PixelImage source;
+    REQUIRE(source.Allocate(640, 480));
+    FillPattern(&source, 1);
+
+    PixelImage first;
+    REQUIRE(ResizePixelImage(source, 256, 192, &first));
+    first.Reset();
+
+    // The second resize of the same shape reuses the first one's buffers and scratch blocks
+    BufferPool::ResetStats();
+    PixelImage second;
+    REQUIRE(ResizePixelImage(source, 256, 192, &second));
+    BufferPoolStats stats = BufferPool::GetStats();
+    CHECK_EQ(stats.systemAllocCount, uint64_t(0));
+    CHECK(stats.reuseCount >= 3);
+    CHECK(stats.arenaPeakBytes >= uint64_t(256) * 4 * sizeof(int32_t));
+}
+
+TEST_CASE(CompositeMatchesTheFormulaForEveryWidth)
+{
+    // Widths below and past the four-pixel SSE2 step, over padded rows; random bytes include
+    // premultiplied colors above their alpha, which saturate
+    std::mt19937 random(11);
+    for (AlphaMode mode : { AlphaMode::Straight, AlphaMode::Premultiplied })
+    {
+        for (uint32_t width = 1; width <= 19; ++width)
+        {
+            const uint32_t height = 3;
+            const size_t stride = width * 4 + 8;
+            std::vector<uint8_t> pixels(stride * height);
+            for (uint8_t& value : pixels)
+                value = static_cast<uint8_t>(random());
+            std::vector<uint8_t> original = pixels;
+            uint8_t bgr[3] = { static_cast<uint8_t>(random()), static_cast<uint8_t>(random()), static_cast<uint8_t>(random()) };
+
+            CompositeOverBackground(pixels.data(), width, height, stride, mode, bgr[2], bgr[1], bgr[0]);
+            int wrong = 0;
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    const uint8_t* in = &original[y * stride + x * 4];
+                    const uint8_t* out = &pixels[y * stride + x * 4];
+                    uint32_t a = in[3];
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        // Rounded division by 255; 255 is odd so there are no ties
+                        uint32_t expected = mode == AlphaMode::Premultiplied
+                            ? in[c] + (2 * bgr[c] * (255 - a) + 255) / 510
+                            : (2 * (in[c] * a + bgr[c] * (255 - a)) + 255) / 510;
+                        wrong += out[c] != (expected > 255 ? 255 : expected);
+                    }
+                    wrong += out[3] != 255;
+                }
+                wrong += memcmp(&pixels[y * stride + width * 4], &original[y * stride + width * 4], 8) != 0;
+            }
+            CHECK_EQ(wrong, 0);
+        }
+    }
+}
+
+TEST_CASE(CompositeFillsTransparentPixelsAndKeepsOpaqueOnes)
+{
+    PixelImage image;
+    REQUIRE(image.Allocate(6, 2));
+    // Transparent premultiplied pixels become the background; opaque ones stay as they are
+    FillColor(&image, 0, 0, 0, 0);
+    image.Row(1)[0] = 10; image.Row(1)[1] = 20; image.Row(1)[2] = 30; image.Row(1)[3] = 255;
+    CompositeOverBackground(image.buffer.Data(), image.width, image.height, image.stride, AlphaMode::Premultiplied, 255, 255, 255);
+    CHECK(image.Row(0)[0] == 255 && image.Row(0)[1] == 255 && image.Row(0)[2] == 255 && image.Row(0)[3] == 255);
+    CHECK(image.Row(1)[0] == 10 && image.Row(1)[1] == 20 && image.Row(1)[2] == 30);
+    CHECK(image.Row(1)[20] == 255 && image.Row(1)[23] == 255);
+
+    // Straight half-transparent red over blue
+    FillColor(&image, 0, 0, 255, 128);
+    CompositeOverBackground(image.buffer.Data(), image.width, image.height, image.stride, AlphaMode::Straight, 0, 0, 255);
+    CHECK(image.Row(1)[4] == 127 && image.Row(1)[5] == 0 && image.Row(1)[6] == 128 && image.Row(1)[7] == 255);
+
+    // Ignore only makes the pixels opaque
+    FillColor(&image, 1, 2, 3, 0);
+    CompositeOverBackground(image.buffer.Data(), image.width, image.height, image.stride, AlphaMode::Ignore, 255, 255, 255);
+    CHECK(image.Row(1)[20] == 1 && image.Row(1)[21] == 2 && image.Row(1)[22] == 3 && image.Row(1)[23] == 255);
+}
+
+TEST_CASE(CopyPixelRowsFlipsWithANegativeStride)
+{
+    PixelImage source;
+    REQUIRE(source.Allocate(5, 4));
+    FillPattern(&source, 3);
+    std::vector<uint8_t> out(4 * 24, 0xEE);
+
+    // Start at the last row and walk up, as for a bottom-up DIB
+    CopyPixelRows(source.Row(3), -static_cast<ptrdiff_t>(source.stride), out.data(), 24, 5, 4);
+    for (uint32_t y = 0; y < 4; ++y)
+    {
+        CHECK(memcmp(&out[y * 24], source.Row(3 - y), 20) == 0);
+        CHECK(out[y * 24 + 20] == 0xEE && out[y * 24 + 23] == 0xEE);
+    }
+    CopyPixelRows(source.Row(0), static_cast<ptrdiff_t>(source.stride), out.data(), 24, 5, 4);
+    CHECK(memcmp(&out[3 * 24], source.Row(3), 20) == 0);
+}
+
+TEST_CASE(HalveAveragesEachBlockWithRounding)
+{
+    // Odd and even sizes on both axes, widths past the four-pixel SSE2 step
+    std::mt19937 random(17);
+    int wrong = 0;
+    for (uint32_t height = 1; height <= 6; ++height)
+    {
+        for (uint32_t width = 1; width <= 21; ++width)
+        {
+            PixelImage source;
+            REQUIRE(source.Allocate(width, height));
+            source.alpha = AlphaMode::Premultiplied;
+            FillRandom(&source, random);
+
+            PixelImage half;
+            REQUIRE(HalvePixelImage(source, &half));
+            REQUIRE(half.width == (width + 1) / 2 && half.height == (height + 1) / 2);
+            CHECK(half.alpha == AlphaMode::Premultiplied);
+            for (uint32_t y = 0; y < half.height; ++y)
+            {
+                for (uint32_t x = 0; x < half.width; ++x)
+                {
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        // Mean of the pixels of the 2x2 block that exist, rounded half up
+                        uint32_t sum = 0, count = 0;
+                        for (uint32_t sy = y * 2; sy < (std::min)(y * 2 + 2, height); ++sy)
+                        {
+                            for (uint32_t sx = x * 2; sx < (std::min)(x * 2 + 2, width); ++sx, ++count)
+                                sum += source.Row(sy)[sx * 4 + c];
+                        }
+                        wrong += half.Row(y)[x * 4 + c] != (sum + count / 2) / count;
+                    }
+                }
+            }
+        }
+    }
+    CHECK_EQ(wrong, 0);
+
+    PixelImage empty, out;
+    CHECK(!HalvePixelImage(empty, &out));
+    PixelImage one;
+    REQUIRE(one.Allocate(2, 2));
+    CHECK(!HalvePixelImage(one, &one));
+    CHECK(!HalvePixelImage(one, nullptr));
+}
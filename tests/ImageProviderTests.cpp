@@ -0,0 +1,211 @@
+#include "TestHarness.h"
+#include "ImageProvider.h"
+#include "ImageOps.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace
+{
+    // Simulated backend: succeeds for the listed file types (all if empty) and stamps the first
+    // letter of its name into the image so the caller can tell who produced it
+    class FakeProvider : public IImageProvider<PixelImage>
+    {
+    public:
+        FakeProvider(const std::string& name, uint32_t capabilities, double costMs, std::vector<std::string> worksFor = {})
+            : m_worksFor(std::move(worksFor))
+        {
+            m_descriptor.name = name;
+            m_descriptor.capabilities = capabilities;
+            m_descriptor.estimatedCostMs = costMs;
+        }
+
+        ProviderDescriptor Describe() const override { return m_descriptor; }
+
+        int32_t Provide(const ImageRequest& request, PixelImage* image) override
+        {
+            ++calls;
+            bool works = m_worksFor.empty() ||
+                         std::find(m_worksFor.begin(), m_worksFor.end(), request.fileType) != m_worksFor.end();
+            if (!works)
+                return -2147467259;     // E_FAIL
+            image->Allocate(request.width ? request.width : 1, request.height ? request.height : 1);
+            image->Row(0)[0] = static_cast<uint8_t>(m_descriptor.name[0]);
+            return 0;
+        }
+
+        std::atomic<int> calls{ 0 };
+
+    private:
+        ProviderDescriptor m_descriptor;
+        std::vector<std::string> m_worksFor;
+    };
+
+    ImageRequest Request(const std::wstring& path, uint32_t size = 96)
+    {
+        ImageRequest request;
+        request.path = path;
+        request.fileType = FileTypeFromPath(path);
+        request.width = size;
+        request.height = size;
+        return request;
+    }
+}
+
+TEST_CASE(FileTypeIsTheLowercaseExtension)
+{
+    CHECK_EQ(FileTypeFromPath(L"C:\\Photos\\IMG_0001.JPG"), std::string("jpg"));
+    CHECK_EQ(FileTypeFromPath(L"/home/user/report.final.Pdf"), std::string("pdf"));
+    CHECK_EQ(FileTypeFromPath(L"C:\\dir.d\\Makefile"), std::string());
+    CHECK_EQ(FileTypeFromPath(L"/srv/archive.d/README"), std::string());
+    CHECK_EQ(FileTypeFromPath(L"trailing."), std::string());
+    CHECK_EQ(FileTypeFromPath(L""), std::string());
+    // Non-ASCII extensions come back as UTF-8, whatever the width of wchar_t
+    CHECK_EQ(FileTypeFromPath(L"x.\u00e9t\u00e9"), std::string("\xc3\xa9t\xc3\xa9"));
+    CHECK_EQ(FileTypeFromPath(L"x.\U0001F600"), std::string("\xf0\x9f\x98\x80"));
+}
+
+TEST_CASE(OnlyEligibleProvidersAreOrdered)
+{
+    ProviderSelector selector;
+    ProviderDescriptor cache;
+    cache.name = "cache";
+    cache.capabilities = PROVIDER_CAP_THUMBNAIL | PROVIDER_CAP_CACHE_ONLY;
+    cache.estimatedCostMs = 1;
+    ProviderDescriptor factory;
+    factory.name = "factory";
+    factory.capabilities = PROVIDER_CAP_THUMBNAIL | PROVIDER_CAP_RECTANGULAR | PROVIDER_CAP_ALPHA | PROVIDER_CAP_NEEDS_STA;
+    factory.estimatedCostMs = 30;
+    ProviderDescriptor raw;
+    raw.name = "raw";
+    raw.capabilities = PROVIDER_CAP_THUMBNAIL;
+    raw.fileTypes = { "cr2", "nef" };
+    raw.maxSize = 256;
+    raw.estimatedCostMs = 10;
+    CHECK_EQ(selector.Register(cache), size_t(0));
+    CHECK_EQ(selector.Register(factory), size_t(1));
+    CHECK_EQ(selector.Register(raw), size_t(2));
+    CHECK_EQ(selector.Count(), size_t(3));
+
+    size_t id = 99;
+    CHECK(selector.Find("raw", &id) && id == 2);
+    CHECK(!selector.Find("missing", &id));
+    CHECK_EQ(selector.Descriptor(1).name, std::string("factory"));
+    CHECK_EQ(selector.Descriptor(7).name, std::string());
+
+    ImageRequest request = Request(L"/photos/a.NEF");
+    CHECK(selector.Order(request) == std::vector<size_t>({ 0, 2, 1 }));
+
+    request.width = 512;        // Too large for the raw decoder
+    CHECK(selector.Order(request) == std::vector<size_t>({ 0, 1 }));
+
+    request = Request(L"/photos/a.nef");
+    request.requiredCapabilities = PROVIDER_CAP_ALPHA;
+    CHECK(selector.Order(request) == std::vector<size_t>({ 1 }));
+
+    // A worker thread without an STA, and a caller that wants fresh content
+    request.requiredCapabilities = 0;
+    request.excludedCapabilities = PROVIDER_CAP_NEEDS_STA | PROVIDER_CAP_CACHE_ONLY;
+    CHECK(selector.Order(request) == std::vector<size_t>({ 2 }));
+
+    CHECK(selector.Order(Request(L"/docs/a.pdf")) == std::vector<size_t>({ 0, 1 }));
+
+    selector.SetEnabled(0, false);
+    CHECK(!selector.IsEnabled(0));
+    CHECK(!selector.IsEnabled(9));
+    CHECK(selector.Order(Request(L"/docs/a.pdf")) == std::vector<size_t>({ 1 }));
+}
+
+TEST_CASE(RunStopsAtTheFirstSuccess)
+{
+    ProviderRegistry<PixelImage> registry;
+    auto cache = std::make_shared<FakeProvider>("cache", PROVIDER_CAP_THUMBNAIL | PROVIDER_CAP_CACHE_ONLY, 1, std::vector<std::string>{ "jpg" });
+    auto shell = std::make_shared<FakeProvider>("shell", PROVIDER_CAP_THUMBNAIL, 40);
+    auto icon = std::make_shared<FakeProvider>("icon", PROVIDER_CAP_THUMBNAIL | PROVIDER_CAP_ICON_FALLBACK, 200);
+    registry.Register(cache);
+    registry.Register(shell);
+    registry.Register(icon);
+
+    PixelImage image;
+    ProviderRunResult result = registry.Run(Request(L"a.jpg"), &image);
+    CHECK_EQ(result.provider, 0);
+    CHECK_EQ(result.attempts, uint32_t(1));
+    CHECK_EQ(result.status, 0);
+    CHECK_EQ(image.Row(0)[0], uint8_t('c'));
+
+    image.Reset();
+    result = registry.Run(Request(L"a.docx"), &image);
+    CHECK_EQ(result.provider, 1);
+    CHECK_EQ(result.attempts, uint32_t(2));
+    CHECK_EQ(image.Row(0)[0], uint8_t('s'));
+    CHECK_EQ(icon->calls.load(), 0);
+
+    // Each attempt is recorded under the request's file type
+    const ProviderSelector& selector = registry.Selector();
+    CHECK_EQ(selector.Stats(0, "docx").attempts, uint64_t(1));
+    CHECK_EQ(selector.Stats(0, "docx").successes, uint64_t(0));
+    CHECK_EQ(selector.Stats(0, "jpg").successes, uint64_t(1));
+    CHECK_EQ(selector.Stats(1, "docx").successes, uint64_t(1));
+    CHECK_EQ(selector.Stats(2, "").attempts, uint64_t(0));
+
+    ImageRequest fresh = Request(L"a.jpg");
+    fresh.excludedCapabilities = PROVIDER_CAP_ICON_FALLBACK | PROVIDER_CAP_THUMBNAIL;
+    result = registry.Run(fresh, &image);
+    CHECK_EQ(result.provider, -1);
+    CHECK_EQ(result.status, -1);
+    CHECK_EQ(result.attempts, uint32_t(0));
+}
+
+TEST_CASE(FailingProvidersMoveBehindForTheirFileTypeOnly)
+{
+    ProviderRegistry<PixelImage> registry;
+    auto picky = std::make_shared<FakeProvider>("picky", PROVIDER_CAP_THUMBNAIL, 1, std::vector<std::string>{ "jpg" });
+    auto general = std::make_shared<FakeProvider>("general", PROVIDER_CAP_THUMBNAIL, 5);
+    registry.Register(picky);
+    registry.Register(general);
+
+    PixelImage image;
+    for (int i = 0; i < 20; ++i)
+        registry.Run(Request(L"scan.tiff"), &image);
+    // picky failed a few times until its expected cost passed general's, then dropped out of the way
+    CHECK(picky->calls.load() < 10);
+    CHECK(registry.Selector().Order(Request(L"b.tiff")).front() == 1);
+
+    // For jpg it still goes first
+    CHECK(registry.Selector().Order(Request(L"b.jpg")) == std::vector<size_t>({ 0, 1 }));
+    ProviderRunResult result = registry.Run(Request(L"b.jpg"), &image);
+    CHECK_EQ(result.provider, 0);
+}
+
+TEST_CASE(ConcurrentRunsRecordEveryAttempt)
+{
+    ProviderRegistry<PixelImage> registry;
+    auto failing = std::make_shared<FakeProvider>("failing", PROVIDER_CAP_THUMBNAIL, 1, std::vector<std::string>{ "none" });
+    auto working = std::make_shared<FakeProvider>("working", PROVIDER_CAP_THUMBNAIL, 2);
+    registry.Register(failing);
+    registry.Register(working);
+
+    std::atomic<int> produced(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t)
+    {
+        threads.emplace_back([&registry, &produced, t]()
+        {
+            for (int i = 0; i < 200; ++i)
+            {
+                PixelImage image;
+                std::wstring path = (t % 2 ? L"f.png" : L"f.mp4");
+                if (registry.Run(Request(path, 8), &image).provider >= 0 && !image.Empty())
+                    produced++;
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    CHECK_EQ(produced.load(), 1600);
+    const ProviderSelector& selector = registry.Selector();
+    CHECK_EQ(selector.Stats(1, "").successes, uint64_t(1600));
+    CHECK_EQ(selector.Stats(0, "").attempts, static_cast<uint64_t>(failing->calls.load()));
+    CHECK(selector.FileTypes() == std::vector<std::string>({ "mp4", "png" }));
+}
@@ -0,0 +1,56 @@
+#include "Benchmark.h"
+#include "ImageSignature.h"
+#include "PngWriter.h"
+#include <vector>
+
+// Signatures of a batch of 256x256 thumbnails computed from the pixels in memory, against the
+// old separate pass that had to read each thumbnail back (here: encode, as a stand-in lower bound
+// for the write + re-read round trip).
+int main(int argc, char** argv)
+{
+    const int count = static_cast<int>(400 * BenchmarkScale(argc, argv));
+    std::vector<PixelImage> images(8);
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        PixelImage& image = images[i];
+        image.Allocate(256, 256);
+        image.alpha = i % 2 ? AlphaMode::Premultiplied : AlphaMode::Ignore;
+        for (uint32_t y = 0; y < 256; ++y)
+        {
+            uint8_t* p = image.Row(y);
+            for (uint32_t x = 0; x < 256; ++x, p += 4)
+            {
+                p[3] = static_cast<uint8_t>(i % 2 ? (x + y) / 2 : 255);
+                p[0] = static_cast<uint8_t>(x * p[3] / 255);
+                p[1] = static_cast<uint8_t>((y * 3 + i * 40) * p[3] / 255);
+                p[2] = static_cast<uint8_t>(((x ^ y) & 0x80) * p[3] / 255);
+            }
+        }
+    }
+
+    uint64_t checksum = 0;
+    BenchmarkTimer timer;
+    for (int i = 0; i < count; ++i)
+    {
+        ImageSignature signature;
+        ComputeImageSignature(images[i % images.size()], &signature);
+        checksum += signature.perceptualHash ^ signature.differenceHash;
+    }
+    double signatureMs = timer.Milliseconds();
+
+    timer.Restart();
+    for (int i = 0; i < count; ++i)
+    {
+        std::vector<uint8_t> png;
+        EncodePng(images[i % images.size()], &png, 1);
+        checksum += png.size();
+    }
+    double encodeMs = timer.Milliseconds();
+
+    ReportResult("thumbnails", count, "");
+    ReportResult("signature per thumbnail", signatureMs * 1000.0 / count, "us");
+    ReportResult("signature throughput", count * 256.0 * 256.0 / 1e6 / (signatureMs / 1000.0), "Mpixel/s");
+    ReportResult("PNG encode per thumbnail (level 1)", encodeMs * 1000.0 / count, "us");
+    ReportResult("checksum", static_cast<double>(checksum % 1000), "");
+    return 0;
+}
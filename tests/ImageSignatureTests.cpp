@@ -0,0 +1,199 @@
+#include "TestHarness.h"
+#include "ImageSignature.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+
+namespace
+{
+    // Soft shapes on a gradient: resizing keeps its structure, like a photo thumbnail
+    PixelImage Scene(uint32_t width, uint32_t height, uint32_t seed)
+    {
+        PixelImage image;
+        image.Allocate(width, height);
+        std::mt19937 random(seed);
+        double cx = 0.2 + (random() % 60) / 100.0, cy = 0.2 + (random() % 60) / 100.0;
+        uint8_t hue = static_cast<uint8_t>(random());
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            uint8_t* p = image.Row(y);
+            for (uint32_t x = 0; x < width; ++x, p += 4)
+            {
+                double fx = double(x) / width, fy = double(y) / height;
+                double d = (fx - cx) * (fx - cx) + (fy - cy) * (fy - cy);
+                bool inside = d < 0.04;
+                p[0] = static_cast<uint8_t>(inside ? hue : 255 * fx);
+                p[1] = static_cast<uint8_t>(inside ? 255 - hue : 255 * fy);
+                p[2] = static_cast<uint8_t>(inside ? 40 : 128);
+                p[3] = 255;
+            }
+        }
+        return image;
+    }
+
+    PixelImage Solid(uint32_t width, uint32_t height, uint8_t b, uint8_t g, uint8_t r, uint8_t a, AlphaMode alpha)
+    {
+        PixelImage image;
+        image.Allocate(width, height);
+        image.alpha = alpha;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            uint8_t* p = image.Row(y);
+            for (uint32_t x = 0; x < width; ++x, p += 4)
+            {
+                p[0] = b;
+                p[1] = g;
+                p[2] = r;
+                p[3] = a;
+            }
+        }
+        return image;
+    }
+
+    bool SameSignature(const ImageSignature& a, const ImageSignature& b)
+    {
+        if (a.perceptualHash != b.perceptualHash || a.differenceHash != b.differenceHash ||
+            a.averageR != b.averageR || a.averageG != b.averageG || a.averageB != b.averageB || a.paletteCount != b.paletteCount)
+            return false;
+        for (uint32_t i = 0; i < a.paletteCount; ++i)
+        {
+            const PaletteColor& x = a.palette[i];
+            const PaletteColor& y = b.palette[i];
+            if (x.r != y.r || x.g != y.g || x.b != y.b || x.share != y.share)
+                return false;
+        }
+        return true;
+    }
+}
+
+TEST_CASE(SignatureIsDeterministicAcrossCallsAndThreads)
+{
+    PixelImage image = Scene(257, 193, 1);
+    ImageSignature first;
+    REQUIRE(ComputeImageSignature(image, &first));
+
+    ImageSignature results[4];
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&image, &results, t]() { ComputeImageSignature(image, &results[t]); });
+    for (std::thread& thread : threads)
+        thread.join();
+    for (const ImageSignature& result : results)
+        CHECK(SameSignature(result, first));
+
+    // A copy in a different buffer gives the same answer
+    PixelImage copy;
+    REQUIRE(CopyPixelImage(image, &copy));
+    ImageSignature again;
+    REQUIRE(ComputeImageSignature(copy, &again));
+    CHECK(SameSignature(again, first));
+}
+
+TEST_CASE(ResizedImagesHaveCloseHashes)
+{
+    for (uint32_t seed = 1; seed <= 5; ++seed)
+    {
+        PixelImage large = Scene(640, 480, seed);
+        PixelImage small;
+        REQUIRE(ResizePixelImage(large, 160, 120, &small));
+        ImageSignature a, b;
+        REQUIRE(ComputeImageSignature(large, &a));
+        REQUIRE(ComputeImageSignature(small, &b));
+        CHECK(HammingDistance(a.perceptualHash, b.perceptualHash) <= 6);
+        CHECK(HammingDistance(a.differenceHash, b.differenceHash) <= 6);
+    }
+}
+
+TEST_CASE(DifferentImagesHaveDistantHashes)
+{
+    int close = 0;
+    for (uint32_t seed = 1; seed <= 10; ++seed)
+    {
+        ImageSignature a, b;
+        REQUIRE(ComputeImageSignature(Scene(200, 200, seed), &a));
+        PixelImage flipped = Scene(200, 200, seed + 100);
+        // Mirror so the background gradient runs the other way as well
+        for (uint32_t y = 0; y < flipped.height; ++y)
+        {
+            uint32_t* row = reinterpret_cast<uint32_t*>(flipped.Row(y));
+            std::reverse(row, row + flipped.width);
+        }
+        REQUIRE(ComputeImageSignature(flipped, &b));
+        if (HammingDistance(a.perceptualHash, b.perceptualHash) <= 10)
+            close++;
+    }
+    CHECK(close == 0);
+}
+
+TEST_CASE(SolidColorHasOnePaletteEntry)
+{
+    ImageSignature signature;
+    REQUIRE(ComputeImageSignature(Solid(50, 40, 30, 120, 220, 255, AlphaMode::Ignore), &signature));
+    REQUIRE(signature.paletteCount == 1);
+    CHECK_EQ(signature.palette[0].r, uint8_t(220));
+    CHECK_EQ(signature.palette[0].g, uint8_t(120));
+    CHECK_EQ(signature.palette[0].b, uint8_t(30));
+    CHECK_EQ(signature.palette[0].share, uint32_t(65536));
+    CHECK_EQ(signature.averageR, uint8_t(220));
+    CHECK_EQ(signature.averageB, uint8_t(30));
+}
+
+TEST_CASE(PaletteOrdersColorsByShare)
+{
+    PixelImage image = Solid(100, 100, 255, 0, 0, 255, AlphaMode::Ignore);      // Blue
+    for (uint32_t y = 0; y < 25; ++y)
+    {
+        uint8_t* p = image.Row(y);
+        for (uint32_t x = 0; x < 100; ++x, p += 4)
+        {
+            p[0] = 0;
+            p[2] = 255;     // Red quarter
+        }
+    }
+    ImageSignature signature;
+    REQUIRE(ComputeImageSignature(image, &signature));
+    REQUIRE(signature.paletteCount == 2);
+    CHECK(signature.palette[0].b > 200 && signature.palette[0].r < 50);
+    CHECK(signature.palette[0].share > signature.palette[1].share);
+    CHECK(signature.palette[0].share + signature.palette[1].share == 65536);
+    CHECK(signature.palette[1].share > 16000 && signature.palette[1].share < 17000);
+}
+
+TEST_CASE(TransparencyIsCompositedOnWhite)
+{
+    ImageSignature clear, white;
+    REQUIRE(ComputeImageSignature(Solid(40, 40, 0, 0, 0, 0, AlphaMode::Straight), &clear));
+    REQUIRE(ComputeImageSignature(Solid(40, 40, 255, 255, 255, 255, AlphaMode::Ignore), &white));
+    CHECK_EQ(clear.paletteCount, uint32_t(0));
+    CHECK_EQ(clear.averageR, uint8_t(255));
+    CHECK_EQ(clear.perceptualHash, white.perceptualHash);
+    CHECK_EQ(clear.differenceHash, white.differenceHash);
+
+    // Half-transparent red, straight and premultiplied, agree
+    ImageSignature straight, premultiplied;
+    REQUIRE(ComputeImageSignature(Solid(40, 40, 0, 0, 200, 128, AlphaMode::Straight), &straight));
+    REQUIRE(ComputeImageSignature(Solid(40, 40, 0, 0, 100, 128, AlphaMode::Premultiplied), &premultiplied));
+    CHECK(std::abs(straight.averageG - premultiplied.averageG) <= 1);
+    CHECK(std::abs(straight.averageR - premultiplied.averageR) <= 1);
+    REQUIRE(straight.paletteCount == 1 && premultiplied.paletteCount == 1);
+    CHECK(std::abs(straight.palette[0].r - premultiplied.palette[0].r) <= 2);
+}
+
+TEST_CASE(TinyAndEmptyImages)
+{
+    ImageSignature signature;
+    CHECK(!ComputeImageSignature(PixelImage(), &signature));
+    CHECK(!ComputeImageSignature(Solid(4, 4, 1, 2, 3, 255, AlphaMode::Ignore), nullptr));
+    REQUIRE(ComputeImageSignature(Solid(1, 1, 10, 20, 30, 255, AlphaMode::Ignore), &signature));
+    CHECK_EQ(signature.paletteCount, uint32_t(1));
+    REQUIRE(ComputeImageSignature(Scene(3, 500, 2), &signature));
+}
+
+TEST_CASE(HammingDistanceCountsBits)
+{
+    CHECK_EQ(HammingDistance(0, 0), 0);
+    CHECK_EQ(HammingDistance(0, ~0ull), 64);
+    CHECK_EQ(HammingDistance(0x0f0f, 0x00ff), 8);
+}
@@ -0,0 +1,122 @@
+#include "TestHarness.h"
+#include "IpcPlatform.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+namespace
+{
+    double ElapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+TEST_CASE(SharedMemoryIsSharedBetweenMappings)
+{
+    std::string name = TestHarness::UniqueName("wsp-ipc-shm");
+    std::unique_ptr<SharedMemory> created = SharedMemory::Create(name, 1 << 20);
+    REQUIRE(created);
+    CHECK_EQ(created->Size(), size_t(1 << 20));
+    CHECK(created->Data()[0] == 0 && created->Data()[(1 << 20) - 1] == 0);
+
+    std::unique_ptr<SharedMemory> opened = SharedMemory::Open(name);
+    REQUIRE(opened);
+    CHECK_EQ(opened->Size(), size_t(1 << 20));
+    CHECK(opened->Data() != created->Data());
+    memcpy(created->Data() + 1000, "pixels", 6);
+    CHECK(memcmp(opened->Data() + 1000, "pixels", 6) == 0);
+    opened->Data()[5] = 42;
+    CHECK_EQ(created->Data()[5], uint8_t(42));
+
+    // Creating again replaces a stale region; the creator removes the name
+    std::unique_ptr<SharedMemory> replaced = SharedMemory::Create(name, 4096);
+    REQUIRE(replaced);
+    CHECK_EQ(replaced->Data()[5], uint8_t(0));
+    replaced.reset();
+    created.reset();
+    CHECK(!SharedMemory::Open(name));
+    // Existing mappings stay valid after the name is gone
+    CHECK_EQ(opened->Data()[5], uint8_t(42));
+}
+
+TEST_CASE(SignalCountsNotificationsAndTimesOut)
+{
+    std::string name = TestHarness::UniqueName("wsp-ipc-sig");
+    std::unique_ptr<IpcSignal> created = IpcSignal::Create(name);
+    std::unique_ptr<IpcSignal> opened = IpcSignal::Open(name);
+    REQUIRE(created && opened);
+    CHECK(!IpcSignal::Open(name + "-missing"));
+
+    created->Notify();
+    created->Notify();
+    CHECK(opened->Wait(0));
+    CHECK(opened->Wait(0));
+
+    auto start = std::chrono::steady_clock::now();
+    CHECK(!opened->Wait(80));
+    CHECK(ElapsedMs(start) >= 70);
+
+    // A waiter blocked in another thread wakes on Notify, well before its timeout
+    std::thread notifier([&created]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        created->Notify();
+    });
+    start = std::chrono::steady_clock::now();
+    CHECK(opened->Wait(5000));
+    CHECK(ElapsedMs(start) < 2000);
+    notifier.join();
+}
+
+TEST_CASE(ChildProcessReportsExitCodesAndSignals)
+{
+    ChildProcess exits;
+    REQUIRE(exits.Start(STUB_WORKER_PATH, { "exit", "3" }));
+    CHECK(exits.Id() != 0);
+    CHECK(TestHarness::WaitUntil([&exits]() { return !exits.IsRunning(); }, 5000));
+    CHECK_EQ(exits.ExitCode(), 3);
+    CHECK(!IsProcessAlive(exits.Id()));
+
+    ChildProcess sleeper;
+    REQUIRE(sleeper.Start(STUB_WORKER_PATH, { "sleep" }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(sleeper.IsRunning());
+    CHECK(IsProcessAlive(sleeper.Id()));
+    sleeper.Kill();
+    CHECK(!sleeper.IsRunning());
+    CHECK_EQ(sleeper.ExitCode(), -9);
+    CHECK(!IsProcessAlive(sleeper.Id()));
+
+    ChildProcess missing;
+    CHECK(!missing.Start("/nonexistent/StubWorker", {}));
+    CHECK(!missing.IsRunning());
+    CHECK(IsProcessAlive(CurrentProcessId()));
+
+    // The destructor does not leave a running child behind
+    uint32_t id = 0;
+    {
+        ChildProcess orphan;
+        REQUIRE(orphan.Start(STUB_WORKER_PATH, { "sleep" }));
+        id = orphan.Id();
+    }
+    CHECK(!IsProcessAlive(id));
+}
+
+TEST_CASE(MappedFileSeesTheWholeFile)
+{
+    TestHarness::TempDirectory dir;
+    std::string data(100000, 'x');
+    data[99999] = 'y';
+    std::ofstream(dir / "data.bin", std::ios::binary) << data;
+    std::ofstream(dir / "empty.bin", std::ios::binary).flush();
+
+    std::unique_ptr<MappedFile> file = MappedFile::Open((dir / "data.bin").string());
+    REQUIRE(file);
+    CHECK_EQ(file->Size(), size_t(100000));
+    CHECK(file->Data()[0] == 'x' && file->Data()[99999] == 'y');
+
+    CHECK(!MappedFile::Open((dir / "empty.bin").string()));
+    CHECK(!MappedFile::Open((dir / "missing.bin").string()));
+}
@@ -0,0 +1,132 @@
+#include "TestHarness.h"
+#include "MpmcQueue.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST_CASE(CapacityRoundsUpToAPowerOfTwo)
+{
+    CHECK_EQ(MpmcQueue<int>(0).Capacity(), size_t(2));
+    CHECK_EQ(MpmcQueue<int>(1).Capacity(), size_t(2));
+    CHECK_EQ(MpmcQueue<int>(3).Capacity(), size_t(4));
+    CHECK_EQ(MpmcQueue<int>(64).Capacity(), size_t(64));
+    CHECK_EQ(MpmcQueue<int>(65).Capacity(), size_t(128));
+}
+
+TEST_CASE(ItemsComeOutInOrderAndAFullQueueRefuses)
+{
+    MpmcQueue<int> queue(4);
+    int item = 0;
+    CHECK(!queue.TryPop(&item));
+
+    // Many laps around the ring, so every slot's sequence number wraps several times
+    int next = 0, expected = 0;
+    for (int lap = 0; lap < 100; ++lap)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            item = next++;
+            REQUIRE(queue.TryPush(item));
+        }
+        CHECK_EQ(queue.Size(), size_t(4));
+        item = -1;
+        CHECK(!queue.TryPush(item));
+        CHECK_EQ(item, -1);
+
+        for (int i = 0; i < 3; ++i)
+        {
+            REQUIRE(queue.TryPop(&item));
+            CHECK_EQ(item, expected++);
+        }
+        item = next++;
+        REQUIRE(queue.TryPush(item));
+        for (int i = 0; i < 2; ++i)
+        {
+            REQUIRE(queue.TryPop(&item));
+            CHECK_EQ(item, expected++);
+        }
+        CHECK_EQ(queue.Size(), size_t(0));
+        CHECK(!queue.TryPop(&item));
+    }
+}
+
+TEST_CASE(PoppedValuesAreNotKeptAliveByTheSlot)
+{
+    MpmcQueue<std::shared_ptr<int>> queue(2);
+    std::shared_ptr<int> value = std::make_shared<int>(7);
+    std::weak_ptr<int> watch = value;
+    REQUIRE(queue.TryPush(value));
+    CHECK(!value);
+
+    std::shared_ptr<int> popped;
+    REQUIRE(queue.TryPop(&popped));
+    CHECK_EQ(*popped, 7);
+    CHECK_EQ(watch.use_count(), long(1));
+    popped.reset();
+    CHECK(watch.expired());
+}
+
+TEST_CASE(EveryItemArrivesOnceUnderContention)
+{
+    const int producers = 4, consumers = 4, perProducer = 50000;
+    MpmcQueue<uint64_t> queue(64);
+    std::vector<std::vector<uint64_t>> received(consumers);
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&queue, p]()
+        {
+            for (int i = 0; i < perProducer; ++i)
+            {
+                uint64_t item = static_cast<uint64_t>(p) << 32 | static_cast<uint32_t>(i);
+                while (!queue.TryPush(item))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    std::atomic<int> remaining(producers * perProducer);
+    for (int c = 0; c < consumers; ++c)
+    {
+        threads.emplace_back([&queue, &received, &remaining, c]()
+        {
+            uint64_t item;
+            while (remaining.load() > 0)
+            {
+                if (queue.TryPop(&item))
+                {
+                    received[c].push_back(item);
+                    remaining.fetch_sub(1);
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    std::vector<std::vector<bool>> seen(producers, std::vector<bool>(perProducer, false));
+    size_t total = 0;
+    for (const std::vector<uint64_t>& list : received)
+    {
+        // One consumer sees each producer's items in the order they were pushed
+        std::vector<int64_t> last(producers, -1);
+        for (uint64_t item : list)
+        {
+            uint32_t p = static_cast<uint32_t>(item >> 32), i = static_cast<uint32_t>(item);
+            REQUIRE(p < static_cast<uint32_t>(producers) && i < static_cast<uint32_t>(perProducer));
+            CHECK(!seen[p][i]);
+            seen[p][i] = true;
+            CHECK(static_cast<int64_t>(i) > last[p]);
+            last[p] = i;
+        }
+        total += list.size();
+    }
+    CHECK_EQ(total, size_t(producers * perProducer));
+    CHECK_EQ(queue.Size(), size_t(0));
+}
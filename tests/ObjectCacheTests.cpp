@@ -0,0 +1,131 @@
+#include "TestHarness.h"
+#include "ObjectCache.h"
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace
+{
+    std::vector<int> Keys(const LruCache<int, std::string>& cache)
+    {
+        std::vector<int> keys;
+        cache.ForEach([&keys](int key, const std::string&) { keys.push_back(key); });
+        return keys;
+    }
+
+    // Stand-in for a per-thread Shell context: counts how often a "bound folder" is created
+    struct FolderContext
+    {
+        LruCache<std::string, std::shared_ptr<int>> folders{ 4 };
+        int binds = 0;
+
+        std::shared_ptr<int> Bind(const std::string& directory)
+        {
+            if (std::shared_ptr<int>* found = folders.Find(directory))
+                return *found;
+            binds++;
+            return folders.Insert(directory, std::make_shared<int>(binds));
+        }
+    };
+}
+
+TEST_CASE(LeastRecentlyUsedEntryIsEvicted)
+{
+    LruCache<int, std::string> cache(3);
+    cache.Insert(1, "a");
+    cache.Insert(2, "b");
+    cache.Insert(3, "c");
+    REQUIRE(cache.Find(1));             // 1 becomes the most recent
+    cache.Insert(4, "d");               // Evicts 2
+
+    CHECK(cache.Find(2) == nullptr);
+    CHECK(Keys(cache) == std::vector<int>({ 4, 1, 3 }));
+    CHECK_EQ(cache.Stats().evictions, uint64_t(1));
+    CHECK_EQ(cache.Size(), size_t(3));
+}
+
+TEST_CASE(InsertingAnExistingKeyReplacesItsValue)
+{
+    LruCache<int, std::string> cache(2);
+    cache.Insert(1, "a");
+    cache.Insert(2, "b");
+    cache.Insert(1, "z");
+
+    REQUIRE(cache.Find(1));
+    CHECK_EQ(*cache.Find(1), std::string("z"));
+    CHECK_EQ(cache.Size(), size_t(2));
+    CHECK_EQ(cache.Stats().insertions, uint64_t(2));
+    CHECK_EQ(cache.Stats().evictions, uint64_t(0));
+}
+
+TEST_CASE(HitAndMissCountersFollowFind)
+{
+    LruCache<int, std::string> cache(2);
+    cache.Insert(1, "a");
+    cache.Find(1);
+    cache.Find(1);
+    cache.Find(7);
+    CHECK_EQ(cache.Stats().hits, uint64_t(2));
+    CHECK_EQ(cache.Stats().misses, uint64_t(1));
+}
+
+TEST_CASE(EraseAndEraseIfRemoveEntries)
+{
+    LruCache<int, std::string> cache(10);
+    for (int i = 0; i < 6; ++i)
+        cache.Insert(i, std::to_string(i));
+
+    CHECK(cache.Erase(3));
+    CHECK(!cache.Erase(3));
+    CHECK_EQ(cache.EraseIf([](int key) { return key % 2 == 0; }), size_t(3));
+    CHECK(Keys(cache) == std::vector<int>({ 5, 1 }));
+
+    cache.Clear();
+    CHECK_EQ(cache.Size(), size_t(0));
+}
+
+TEST_CASE(ZeroCapacityHoldsOneEntry)
+{
+    LruCache<int, std::string> cache(0);
+    CHECK_EQ(cache.Capacity(), size_t(1));
+    cache.Insert(1, "a");
+    cache.Insert(2, "b");
+    CHECK(cache.Find(1) == nullptr);
+    CHECK(cache.Find(2) != nullptr);
+}
+
+TEST_CASE(FilesInTheSameDirectoryReuseTheBoundFolder)
+{
+    FolderContext& context = PerThread<FolderContext>::Get();
+    const char* files[][2] = { { "c:\\a", "1.jpg" }, { "c:\\a", "2.jpg" }, { "c:\\b", "3.jpg" },
+                               { "c:\\a", "4.jpg" }, { "c:\\b", "5.jpg" } };
+    for (const auto& file : files)
+        context.Bind(file[0]);
+
+    CHECK_EQ(context.binds, 2);
+    CHECK_EQ(context.folders.Stats().hits, uint64_t(3));
+    PerThread<FolderContext>::Release();
+}
+
+TEST_CASE(PerThreadInstancesAreSeparateAndReleasable)
+{
+    FolderContext* mine = &PerThread<FolderContext>::Get();
+    CHECK(PerThread<FolderContext>::Peek() == mine);
+    mine->Bind("c:\\x");
+
+    FolderContext* other = nullptr;
+    int otherBinds = -1;
+    std::thread([&]()
+    {
+        CHECK(PerThread<FolderContext>::Peek() == nullptr);
+        other = &PerThread<FolderContext>::Get();
+        otherBinds = other->binds;
+    }).join();
+    CHECK(other != mine);
+    CHECK_EQ(otherBinds, 0);
+
+    PerThread<FolderContext>::Release();
+    CHECK(PerThread<FolderContext>::Peek() == nullptr);
+    CHECK_EQ(PerThread<FolderContext>::Get().binds, 0);
+    PerThread<FolderContext>::Release();
+}
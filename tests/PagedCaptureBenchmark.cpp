@@ -0,0 +1,99 @@
+#include "Benchmark.h"
+#include "PagedCapture.h"
+#include "PngWriter.h"
+#include <algorithm>
+#include <atomic>
+
+// A 20-page document whose pages are "rendered" by downscaling a 2400x3200 scan and delivered
+// by PNG encoding. Renders everything first and then encodes, versus the capture pipeline where
+// encoding overlaps rendering; reports the time and the most pages held in memory at once.
+namespace
+{
+    class ScanRenderer : public PagedRenderer
+    {
+    public:
+        ScanRenderer(const PixelImage& scan, uint32_t pages) : m_scan(scan), m_pages(pages) {}
+
+        bool Open(uint32_t* pageCount) override
+        {
+            *pageCount = m_pages;
+            return true;
+        }
+
+        PageStatus RenderPage(uint32_t, PixelImage* image) override
+        {
+            if (!ResizePixelImage(m_scan, 900, 1200, image))
+                return PageStatus::Failed;
+            uint32_t held = ++live;
+            peak = (std::max)(peak.load(), held);
+            return PageStatus::Rendered;
+        }
+
+        void Close() override {}
+
+        std::atomic<uint32_t> live{ 0 };
+        std::atomic<uint32_t> peak{ 0 };
+
+    private:
+        const PixelImage& m_scan;
+        uint32_t m_pages;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t pages = static_cast<uint32_t>(20 * BenchmarkScale(argc, argv));
+    PixelImage scan;
+    if (!scan.Allocate(2400, 3200))
+        return 1;
+    for (uint32_t y = 0; y < scan.height; ++y)
+    {
+        uint8_t* p = scan.Row(y);
+        for (uint32_t x = 0; x < scan.width; ++x, p += 4)
+        {
+            uint8_t ink = ((y / 40) % 2 == 0 && (x / 12) % 7 != 0) ? 30 : 250;
+            p[0] = p[1] = p[2] = ink;
+            p[3] = 255;
+        }
+    }
+
+    // Everything rendered first, then encoded
+    BenchmarkTimer timer;
+    std::vector<PixelImage> rendered(pages);
+    for (PixelImage& page : rendered)
+        ResizePixelImage(scan, 900, 1200, &page);
+    size_t bytes = 0;
+    for (const PixelImage& page : rendered)
+    {
+        std::vector<uint8_t> png;
+        EncodePng(page, &png, 1);
+        bytes += png.size();
+    }
+    double serialMs = timer.Milliseconds();
+    rendered.clear();
+
+    ScanRenderer renderer(scan, pages);
+    PagedCaptureOptions options;
+    options.pageCount = pages;
+    options.queueDepth = 2;
+    timer.Restart();
+    PagedCaptureResult result = RunPagedCapture(renderer, options, [&](CapturedPage& page)
+    {
+        std::vector<uint8_t> png;
+        EncodePng(page.image, &png, 1);
+        page.image.Reset();
+        renderer.live--;
+        return true;
+    });
+    double pipelineMs = timer.Milliseconds();
+
+    ReportResult("pages", pages, "");
+    ReportResult("render all, then encode", serialMs, "ms");
+    ReportResult("render all, then encode: pages in memory", pages, "");
+    ReportResult("pipeline", pipelineMs, "ms");
+    ReportResult("pipeline: pages in memory", renderer.peak.load(), "");
+    ReportResult("pipeline: renderer stalled", static_cast<double>(result.renderStallMs), "ms");
+    ReportResult("pipeline: delivery stalled", static_cast<double>(result.deliverStallMs), "ms");
+    ReportResult("encoded size", bytes / 1024.0, "KB");
+    return 0;
+}
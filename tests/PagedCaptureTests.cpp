@@ -0,0 +1,263 @@
+#include "TestHarness.h"
+#include "BoundedQueue.h"
+#include "PagedCapture.h"
+#include "PngWriter.h"
+#include "ReferenceCodecs.h"
+#include "TestData.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace
+{
+    // Document of `pages` pages (0 = reports no count and ends after `actualPages`). Each page
+    // is a small image whose pixels encode the page number.
+    class FakeRenderer : public PagedRenderer
+    {
+    public:
+        FakeRenderer(uint32_t pages, uint32_t actualPages) : m_pages(pages), m_actualPages(actualPages) {}
+
+        bool Open(uint32_t* pageCount) override
+        {
+            opened = true;
+            *pageCount = m_pages;
+            return !failOpen;
+        }
+
+        PageStatus RenderPage(uint32_t page, PixelImage* image) override
+        {
+            requested.push_back(page);
+            // Pages rendered but not yet delivered: the queue plus the one being delivered
+            uint32_t ahead = static_cast<uint32_t>(requested.size() - 1) - delivered.load();
+            maxAhead = (std::max)(maxAhead, ahead);
+            if (page >= m_actualPages)
+                return PageStatus::End;
+            if (page == failAt)
+                return PageStatus::Failed;
+            if (renderMs)
+                std::this_thread::sleep_for(std::chrono::milliseconds(renderMs));
+            *image = PageImage(page);
+            return PageStatus::Rendered;
+        }
+
+        void Close() override { closed = true; }
+
+        static PixelImage PageImage(uint32_t page)
+        {
+            PixelImage image;
+            image.Allocate(40, 30);
+            for (uint32_t y = 0; y < 30; ++y)
+            {
+                uint8_t* p = image.Row(y);
+                for (uint32_t x = 0; x < 40; ++x, p += 4)
+                {
+                    p[0] = static_cast<uint8_t>(page * 40 + 150);
+                    p[1] = static_cast<uint8_t>(x * 6);
+                    p[2] = static_cast<uint8_t>(y * 8);
+                    p[3] = 255;
+                }
+            }
+            return image;
+        }
+
+        bool failOpen = false;
+        uint32_t failAt = UINT32_MAX;
+        uint32_t renderMs = 0;
+        bool opened = false;
+        bool closed = false;
+        std::vector<uint32_t> requested;
+        std::atomic<uint32_t> delivered{ 0 };
+        uint32_t maxAhead = 0;
+
+    private:
+        uint32_t m_pages;
+        uint32_t m_actualPages;
+    };
+
+    PagedCaptureOptions Range(uint32_t first, uint32_t count, uint32_t depth = 2)
+    {
+        PagedCaptureOptions options;
+        options.firstPage = first;
+        options.pageCount = count;
+        options.queueDepth = depth;
+        return options;
+    }
+}
+
+TEST_CASE(QueueIsFifoAndCloseDrainsIt)
+{
+    BoundedQueue<int> queue(3);
+    CHECK(queue.Push(1));
+    CHECK(queue.Push(2));
+    queue.Close();
+    CHECK(!queue.Push(3));
+
+    int value = 0;
+    CHECK(queue.Pop(&value) && value == 1);
+    CHECK(queue.Pop(&value) && value == 2);
+    CHECK(!queue.Pop(&value));
+    CHECK_EQ(queue.Stats().pushed, uint64_t(2));
+    CHECK_EQ(queue.Stats().popped, uint64_t(2));
+    CHECK_EQ(BoundedQueue<int>(0).Capacity(), size_t(1));
+}
+
+TEST_CASE(FullQueueBlocksTheProducer)
+{
+    BoundedQueue<int> queue(2);
+    std::atomic<int> pushed(0);
+    std::thread producer([&]()
+    {
+        for (int i = 0; i < 5; ++i)
+        {
+            queue.Push(i);
+            pushed++;
+        }
+        queue.Close();
+    });
+
+    CHECK(TestHarness::WaitUntil([&]() { return pushed.load() == 2; }, 5000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    CHECK_EQ(pushed.load(), 2);
+    CHECK_EQ(queue.Size(), size_t(2));
+
+    int value = 0, expected = 0;
+    while (queue.Pop(&value))
+        CHECK_EQ(value, expected++);
+    producer.join();
+    CHECK_EQ(expected, 5);
+    CHECK(queue.Stats().pushWaitMs >= 20);
+}
+
+TEST_CASE(CancelDropsItemsAndReleasesBothSides)
+{
+    BoundedQueue<std::shared_ptr<int>> queue(1);
+    std::shared_ptr<int> item = std::make_shared<int>(1);
+    std::weak_ptr<int> watch = item;
+    CHECK(queue.Push(std::move(item)));
+
+    std::atomic<bool> blockedPushReturned(false);
+    std::thread producer([&]()
+    {
+        queue.Push(std::make_shared<int>(2));
+        blockedPushReturned = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.Cancel();
+    producer.join();
+    CHECK(blockedPushReturned.load());
+    CHECK(watch.expired());
+    std::shared_ptr<int> value;
+    CHECK(!queue.Pop(&value));
+}
+
+TEST_CASE(CaptureDeliversTheRequestedRangeInOrder)
+{
+    FakeRenderer renderer(10, 10);
+    std::vector<uint32_t> pages;
+    PagedCaptureResult result = RunPagedCapture(renderer, Range(2, 5), [&](CapturedPage& page)
+    {
+        pages.push_back(page.page);
+        CHECK_EQ(page.image.Row(0)[0], static_cast<uint8_t>(page.page * 40 + 150));
+        return true;
+    });
+    CHECK(pages == std::vector<uint32_t>({ 2, 3, 4, 5, 6 }));
+    CHECK(renderer.requested == pages);
+    CHECK_EQ(result.documentPages, uint32_t(10));
+    CHECK_EQ(result.pagesRendered, uint32_t(5));
+    CHECK_EQ(result.pagesDelivered, uint32_t(5));
+    CHECK(!result.reachedEnd && !result.stopped && !result.renderFailed);
+    CHECK(renderer.opened && renderer.closed);
+}
+
+TEST_CASE(SlowDeliveryHoldsTheRendererBack)
+{
+    for (uint32_t depth : { 1u, 3u })
+    {
+        FakeRenderer renderer(12, 12);
+        PagedCaptureResult result = RunPagedCapture(renderer, Range(0, 12, depth), [&](CapturedPage&)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            renderer.delivered++;
+            return true;
+        });
+        CHECK_EQ(result.pagesDelivered, uint32_t(12));
+        // Queued pages plus the one in delivery; never the whole document
+        CHECK(renderer.maxAhead <= depth + 1);
+        CHECK(result.renderStallMs > 0);
+    }
+}
+
+TEST_CASE(StoppingDeliveryEndsRendering)
+{
+    FakeRenderer renderer(100, 100);
+    PagedCaptureResult result = RunPagedCapture(renderer, Range(0, 100, 2), [&](CapturedPage& page)
+    {
+        renderer.delivered++;
+        return page.page < 2;
+    });
+    CHECK(result.stopped);
+    CHECK_EQ(result.pagesDelivered, uint32_t(2));
+    CHECK(result.pagesRendered <= 6);
+    CHECK(renderer.closed);
+}
+
+TEST_CASE(ShortDocumentsEndEarly)
+{
+    // Count known up front: only the existing pages are requested
+    FakeRenderer known(3, 3);
+    PagedCaptureResult result = RunPagedCapture(known, Range(1, 10), [](CapturedPage&) { return true; });
+    CHECK(result.reachedEnd);
+    CHECK_EQ(result.pagesDelivered, uint32_t(2));
+    CHECK(known.requested == std::vector<uint32_t>({ 1, 2 }));
+
+    // Unknown count: the renderer reports the end itself
+    FakeRenderer unknown(0, 3);
+    result = RunPagedCapture(unknown, Range(0, 10), [](CapturedPage&) { return true; });
+    CHECK(result.reachedEnd);
+    CHECK_EQ(result.pagesDelivered, uint32_t(3));
+    CHECK_EQ(result.documentPages, uint32_t(0));
+
+    FakeRenderer past(3, 3);
+    result = RunPagedCapture(past, Range(5, 2), [](CapturedPage&) { return true; });
+    CHECK(result.reachedEnd);
+    CHECK_EQ(result.pagesDelivered, uint32_t(0));
+}
+
+TEST_CASE(FailuresAreReportedAndCloseAlwaysRuns)
+{
+    FakeRenderer cannotOpen(5, 5);
+    cannotOpen.failOpen = true;
+    PagedCaptureResult result = RunPagedCapture(cannotOpen, Range(0, 5), [](CapturedPage&) { return true; });
+    CHECK(result.openFailed);
+    CHECK(cannotOpen.closed);
+    CHECK(cannotOpen.requested.empty());
+
+    FakeRenderer broken(5, 5);
+    broken.failAt = 2;
+    result = RunPagedCapture(broken, Range(0, 5), [](CapturedPage&) { return true; });
+    CHECK(result.renderFailed);
+    CHECK_EQ(result.pagesDelivered, uint32_t(2));
+    CHECK(broken.closed);
+
+    FakeRenderer nothing(5, 5);
+    result = RunPagedCapture(nothing, Range(0, 0), [](CapturedPage&) { return true; });
+    CHECK(!nothing.opened);
+    CHECK_EQ(result.pagesDelivered, uint32_t(0));
+}
+
+// Delivery as the preview code does it: each page is written to its own PNG while the next renders
+TEST_CASE(PagesSavedDuringCaptureDecode)
+{
+    TestHarness::TempDirectory dir;
+    FakeRenderer renderer(6, 6);
+    renderer.renderMs = 2;
+    PagedCaptureResult result = RunPagedCapture(renderer, Range(0, 6), [&](CapturedPage& page)
+    {
+        return SavePixelImageAsPng(page.image, dir / ("page" + std::to_string(page.page) + ".png"));
+    });
+    REQUIRE(result.pagesDelivered == 6);
+
+    for (uint32_t page = 0; page < 6; ++page)
+        Reference::CheckDecodesTo(TestData::ReadFile(dir / ("page" + std::to_string(page) + ".png")), FakeRenderer::PageImage(page));
+}
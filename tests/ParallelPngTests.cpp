@@ -0,0 +1,191 @@
+#include "TestHarness.h"
+#include "PngWriter.h"
+#include "ReferenceCodecs.h"
+#include "WorkStealingPool.h"
+#include "TestData.h"
+#include <atomic>
+#include <random>
+
+using TestHarness::TempDirectory;
+using TestHarness::WaitUntil;
+using TestData::ReadFile;
+using TestData::Scene;
+using Reference::CheckDecodesTo;
+
+namespace
+{
+    // Concatenated IDAT payloads of a PNG: the zlib stream
+    std::vector<uint8_t> ZlibStream(const std::vector<uint8_t>& png)
+    {
+        std::vector<uint8_t> zlib;
+        for (size_t pos = 8; pos + 12 <= png.size();)
+        {
+            uint32_t length = static_cast<uint32_t>(png[pos]) << 24 | png[pos + 1] << 16 | png[pos + 2] << 8 | png[pos + 3];
+            if (memcmp(&png[pos + 4], "IDAT", 4) == 0)
+                zlib.insert(zlib.end(), png.begin() + pos + 8, png.begin() + pos + 8 + length);
+            pos += 12 + length;
+        }
+        return zlib;
+    }
+}
+
+// Against libpng, and against the serial writer's scanlines: same filter choices, only the
+// deflate stream is cut differently
+TEST_CASE(ParallelOutputDecodesToTheSerialScanlines)
+{
+    struct Shape { uint32_t width, height; size_t chunkBytes; };
+    const Shape shapes[] = { { 1, 1, 1 },
+                             { 300, 1, 1000 },              // One row, one chunk
+                             { 97, 211, 1 },                // One row per chunk
+                             { 257, 300, 5000 },            // Chunks smaller than the 32KB window
+                             { 640, 480, 100000 },          // Chunks larger than the window
+                             { 64, 64, 1 << 20 } };         // Whole image in one chunk
+    for (const Shape& shape : shapes)
+    {
+        for (AlphaMode alpha : { AlphaMode::Ignore, AlphaMode::Straight, AlphaMode::Premultiplied })
+        {
+            PixelImage image = Scene(shape.width, shape.height, alpha, shape.width + shape.height);
+            for (int level : { 0, 1, 6, 9 })
+            {
+                ParallelPngOptions options;
+                options.threads = 3;
+                options.chunkBytes = shape.chunkBytes;
+                std::vector<uint8_t> parallel, serial;
+                REQUIRE(EncodePngParallel(image, &parallel, level, options));
+                REQUIRE(EncodePng(image, &serial, level));
+                CheckDecodesTo(parallel, image);
+
+                std::vector<uint8_t> parallelScanlines, serialScanlines;
+                REQUIRE(Reference::Inflate(ZlibStream(parallel), &parallelScanlines));
+                REQUIRE(Reference::Inflate(ZlibStream(serial), &serialScanlines));
+                CHECK(parallelScanlines == serialScanlines);
+            }
+        }
+    }
+}
+
+TEST_CASE(OutputDependsOnlyOnTheChunkSize)
+{
+    PixelImage image = Scene(700, 500, AlphaMode::Straight, 3);
+    for (size_t chunkBytes : { size_t(20000), size_t(256 * 1024) })
+    {
+        ParallelPngOptions options;
+        options.chunkBytes = chunkBytes;
+        options.threads = 1;
+        std::vector<uint8_t> expected;
+        REQUIRE(EncodePngParallel(image, &expected, 6, options));
+
+        for (uint32_t threads : { 2u, 3u, 8u })
+        {
+            options.threads = threads;
+            std::vector<uint8_t> png;
+            REQUIRE(EncodePngParallel(image, &png, 6, options));
+            CHECK(png == expected);
+        }
+
+        WorkStealingPool pool(4);
+        options.pool = &pool;
+        std::vector<uint8_t> pooled;
+        REQUIRE(EncodePngParallel(image, &pooled, 6, options));
+        CHECK(pooled == expected);
+    }
+
+    ParallelPngOptions small, large;
+    small.chunkBytes = 20000;
+    std::vector<uint8_t> a, b;
+    REQUIRE(EncodePngParallel(image, &a, 6, small));
+    REQUIRE(EncodePngParallel(image, &b, 6, large));
+    CHECK(a != b);
+}
+
+TEST_CASE(ChunksKeepTheRatioCloseToSerial)
+{
+    PixelImage image = Scene(1200, 900, AlphaMode::Ignore, 4);
+    std::vector<uint8_t> serial, parallel;
+    REQUIRE(EncodePng(image, &serial, 6));
+    REQUIRE(EncodePngParallel(image, &parallel, 6));
+    CheckDecodesTo(parallel, image);
+    CHECK(parallel.size() < serial.size() * 101 / 100);
+
+    // Noise repeating every 8 rows only compresses through matches 8 rows back. Chunks of
+    // 10 rows find them only if each chunk is primed with the rows before it.
+    PixelImage periodic;
+    periodic.Allocate(200, 400);
+    std::mt19937 random(7);
+    for (uint32_t y = 0; y < 8; ++y)
+    {
+        for (uint32_t x = 0; x < 200 * 4; ++x)
+            periodic.Row(y)[x] = static_cast<uint8_t>(random());
+    }
+    for (uint32_t y = 8; y < periodic.height; ++y)
+        memcpy(periodic.Row(y), periodic.Row(y - 8), 200 * 4);
+
+    ParallelPngOptions options;
+    options.chunkBytes = 10 * (200 * 3 + 1);
+    serial.clear();
+    parallel.clear();
+    REQUIRE(EncodePng(periodic, &serial, 6));
+    REQUIRE(EncodePngParallel(periodic, &parallel, 6, options));
+    CheckDecodesTo(parallel, periodic);
+    CHECK(parallel.size() < serial.size() * 3 / 2);
+}
+
+// EncodePipeline calls this from inside a pool task: the waiting worker has to run the
+// chunks itself, even when it is the pool's only thread
+TEST_CASE(RunsFromInsideATaskOfThePoolItUses)
+{
+    PixelImage image = Scene(400, 300, AlphaMode::Premultiplied, 5);
+    ParallelPngOptions options;
+    options.chunkBytes = 10000;
+    std::vector<uint8_t> expected;
+    REQUIRE(EncodePngParallel(image, &expected, 6, options));
+
+    for (uint32_t threads : { 1u, 3u })
+    {
+        WorkStealingPool pool(threads, 2);
+        std::vector<uint8_t> png;
+        std::atomic<bool> finished(false), ok(false);
+        pool.Submit([&]()
+        {
+            ParallelPngOptions nested = options;
+            nested.pool = &pool;
+            ok.store(EncodePngParallel(image, &png, 6, nested));
+            finished.store(true);
+        });
+        REQUIRE(WaitUntil([&finished]() { return finished.load(); }, 30000));
+        CHECK(ok.load());
+        CHECK(png == expected);
+    }
+}
+
+TEST_CASE(SavedFilesAndFailures)
+{
+    TempDirectory dir;
+    PixelImage image = Scene(300, 200, AlphaMode::Straight, 6);
+    ParallelPngOptions options;
+    options.chunkBytes = 8000;
+    options.threads = 4;
+    std::vector<uint8_t> encoded;
+    REQUIRE(EncodePngParallel(image, &encoded, 6, options));
+    REQUIRE(SavePixelImageAsPngParallel(image, dir / "out.png", 6, options));
+    CHECK(ReadFile(dir / "out.png") == encoded);
+
+    CHECK(!SavePixelImageAsPngParallel(image, dir / "missing" / "out.png", 6, options));
+    CHECK(!SavePixelImageAsPngParallel(PixelImage(), dir / "empty.png", 6, options));
+    CHECK(!EncodePngParallel(PixelImage(), &encoded, 6, options));
+    CHECK(!EncodePngParallel(image, nullptr, 6, options));
+
+    // A sink that gives up part way: chunks still in flight finish before the call returns
+    WorkStealingPool pool(3);
+    options.pool = &pool;
+    size_t accepted = 0;
+    bool written = WritePngParallel(image, [&accepted](const uint8_t*, size_t size)
+    {
+        if (accepted > 5000)
+            return false;
+        accepted += size;
+        return true;
+    }, 6, options);
+    CHECK(!written);
+    CHECK(WaitUntil([&pool]() { WorkStealingPoolStats stats = pool.Stats(); return stats.executed == stats.submitted; }, 5000));
+}
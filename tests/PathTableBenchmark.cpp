@@ -0,0 +1,124 @@
+#include "Benchmark.h"
+#include "PathTable.h"
+#include "TextCodec.h"
+#include <string>
+#include <vector>
+
+// Per-path costs the caches pay: transcoding a typical ASCII path and a Japanese one both
+// ways (against a plain one-unit-at-a-time loop), interning a path the table already holds and
+// a new one, and finding the extension from a record against parsing the string again.
+namespace
+{
+    // What the SIMD ASCII runs replace: every unit through the general case
+    void ScalarWiden(const std::string& text, std::u16string* out)
+    {
+        out->clear();
+        for (size_t i = 0; i < text.size();)
+        {
+            uint8_t c = static_cast<uint8_t>(text[i]);
+            uint32_t cp;
+            size_t length = c < 0x80 ? 1 : c < 0xe0 ? 2 : c < 0xf0 ? 3 : 4;
+            cp = length == 1 ? c : c & (0x3f >> (length - 1));
+            for (size_t k = 1; k < length; ++k)
+                cp = (cp << 6) | (text[i + k] & 0x3f);
+            i += length;
+            if (cp >= 0x10000)
+            {
+                out->push_back(static_cast<char16_t>(0xd800 + ((cp - 0x10000) >> 10)));
+                out->push_back(static_cast<char16_t>(0xdc00 + ((cp - 0x10000) & 0x3ff)));
+            }
+            else
+            {
+                out->push_back(static_cast<char16_t>(cp));
+            }
+        }
+    }
+
+    void MeasureTranscode(const char* label, const std::string& utf8, int iterations)
+    {
+        std::u16string wide;
+        std::string narrow;
+        size_t total = 0;
+        BenchmarkTimer timer;
+        for (int i = 0; i < iterations; ++i)
+        {
+            Utf8ToUtf16(utf8.data(), utf8.size(), &wide);
+            total += wide.size();
+        }
+        double widenNs = timer.Milliseconds() * 1e6 / iterations;
+
+        timer.Restart();
+        for (int i = 0; i < iterations; ++i)
+        {
+            Utf16ToUtf8(wide.data(), wide.size(), &narrow);
+            total += narrow.size();
+        }
+        double narrowNs = timer.Milliseconds() * 1e6 / iterations;
+
+        std::u16string scalar;
+        timer.Restart();
+        for (int i = 0; i < iterations; ++i)
+        {
+            ScalarWiden(utf8, &scalar);
+            total += scalar.size();
+        }
+        double scalarNs = timer.Milliseconds() * 1e6 / iterations;
+
+        std::string name = std::string(label) + " UTF-8 -> UTF-16";
+        ReportResult(name.c_str(), widenNs, "ns");
+        name = std::string(label) + " UTF-8 -> UTF-16, scalar loop";
+        ReportResult(name.c_str(), scalarNs, "ns");
+        name = std::string(label) + " UTF-16 -> UTF-8";
+        ReportResult(name.c_str(), narrowNs, "ns");
+        if (total == 1)
+            printf("\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double scale = BenchmarkScale(argc, argv);
+    int iterations = static_cast<int>(1000000 * scale);
+
+    const std::string ascii = "C:\\Users\\someone\\Pictures\\2024\\Holiday Trip\\IMG_20240812_183012.jpg";
+    const std::string japanese = "C:\\Users\\someone\\\xe5\x86\x99\xe7\x9c\x9f\\\xe6\x97\x85\xe8\xa1\x8c\\\xe5\xa4\x8f\xe4\xbc\x91\xe3\x81\xbf.jpg";
+    MeasureTranscode("ASCII path", ascii, iterations);
+    MeasureTranscode("Japanese path", japanese, iterations);
+
+    PathTable table;
+    PathRef held = table.Intern(ascii);
+    const std::string spelling = "c:/users/someone/pictures/2024/holiday trip/img_20240812_183012.JPG";
+    uint64_t ids = 0;
+    BenchmarkTimer timer;
+    for (int i = 0; i < iterations; ++i)
+        ids += table.Intern(i % 2 ? ascii : spelling)->id;
+    ReportResult("intern a held path", timer.Milliseconds() * 1e6 / iterations, "ns");
+
+    int fresh = iterations / 10;
+    std::vector<PathRef> records;
+    records.reserve(fresh);
+    timer.Restart();
+    for (int i = 0; i < fresh; ++i)
+        records.push_back(table.Intern("C:\\Users\\someone\\Pictures\\" + std::to_string(i / 100) + "\\IMG_" + std::to_string(i) + ".jpg"));
+    ReportResult("intern a new path", timer.Milliseconds() * 1e6 / fresh, "ns");
+
+    size_t lengths = 0;
+    timer.Restart();
+    for (int i = 0; i < iterations; ++i)
+        lengths += records[i % fresh]->ExtensionKey().size();
+    ReportResult("extension from a record", timer.Milliseconds() * 1e6 / iterations, "ns");
+
+    timer.Restart();
+    for (int i = 0; i < iterations; ++i)
+    {
+        std::string normalized;
+        size_t rootLength;
+        const std::string& path = records[i % fresh]->path;
+        NormalizePath(path, &normalized, &rootLength);
+        lengths += normalized.size() - ExtensionOffset(std::string_view(normalized));
+    }
+    ReportResult("extension by parsing the path again", timer.Milliseconds() * 1e6 / iterations, "ns");
+    if (ids + lengths == 1)
+        printf("\n");
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include "TestHarness.h"
+#include "PathTable.h"
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    std::string Normalize(const std::string& path, size_t* rootLength = nullptr)
+    {
+        std::string out;
+        size_t root = 0;
+        if (!NormalizePath(path, &out, &root))
+            return "(failed)";
+        if (rootLength)
+            *rootLength = root;
+        return out;
+    }
+}
+
+TEST_CASE(PathsAreNormalizedLexically)
+{
+    struct Case { const char* input; const char* expected; size_t rootLength; };
+    const Case cases[] = {
+        { "C:\\Photos\\a.jpg", "C:\\Photos\\a.jpg", 3 },
+        { "C:\\", "C:\\", 3 },
+        { "c:/Photos//2024/./a.jpg", "c:\\Photos\\2024\\a.jpg", 3 },
+        { "C:\\Photos\\..\\..\\a.jpg", "C:\\a.jpg", 3 },            // ".." stops at the root
+        { "C:\\Photos\\", "C:\\Photos", 3 },
+        { "C:a.jpg", "C:a.jpg", 2 },                                // Relative to drive C's directory
+        { "\\\\?\\C:\\Photos\\.\\a.jpg", "C:\\Photos\\a.jpg", 3 },
+        { "\\\\.\\C:\\a.jpg", "C:\\a.jpg", 3 },
+        { "\\\\?\\UNC\\server\\share\\dir\\a.jpg", "\\\\server\\share\\dir\\a.jpg", 15 },
+        { "\\\\?\\unc\\server\\share", "\\\\server\\share\\", 15 },
+        { "//server/share/../x", "\\\\server\\share\\x", 15 },
+        { "\\\\?\\Volume{1234}\\dir\\..\\a", "\\\\?\\Volume{1234}\\a", 17 },
+        { "\\Windows\\System32", "\\Windows\\System32", 1 },
+        { "a\\b\\..\\..\\..\\c", "..\\c", 0 },                     // Relative ".." is kept
+        { "a\\..", ".", 0 },
+        { "./a.jpg", "a.jpg", 0 },
+    };
+    for (const Case& c : cases)
+    {
+        size_t rootLength = SIZE_MAX;
+        std::string normalized = Normalize(c.input, &rootLength);
+        CHECK_EQ(normalized, std::string(c.expected));
+        CHECK_EQ(rootLength, c.rootLength);
+    }
+    CHECK_EQ(Normalize(""), std::string("(failed)"));
+
+    CHECK_EQ(ExtensionOffset(std::string_view("C:\\a.b\\file.tar.gz")), size_t(15));
+    CHECK_EQ(ExtensionOffset(std::string_view("C:\\a.b\\file")), size_t(11));
+    CHECK_EQ(ExtensionOffset(std::u16string_view(u"C:\\dir\\.hidden")), size_t(7));
+}
+
+TEST_CASE(SpellingsOfOnePathShareARecord)
+{
+    PathTable table;
+    PathRef record = table.Intern("C:\\Photos\\Holiday.JPG");
+    REQUIRE(record != nullptr);
+    const char* spellings[] = { "c:\\photos\\holiday.jpg", "C:/Photos/Holiday.JPG", "C:\\Photos\\\\.\\Holiday.JPG",
+                                "\\\\?\\C:\\PHOTOS\\x\\..\\holiday.jpg", "C:\\Photos\\Holiday.JPG\\" };
+    for (const char* spelling : spellings)
+        CHECK(table.Intern(spelling) == record);
+    CHECK(table.Intern(u"C:\\PHOTOS\\HOLIDAY.JPG") == record);
+    // The first spelling is what the record keeps
+    CHECK_EQ(record->path, std::string("C:\\Photos\\Holiday.JPG"));
+    CHECK_EQ(record->key, std::string("c:\\photos\\holiday.jpg"));
+
+    // Only ASCII letters fold, as Windows does with an invariant-culture compare of these
+    PathRef upper = table.Intern(u"C:\\\x00c9t\x00e9.png");
+    PathRef lower = table.Intern(u"C:\\\x00e9t\x00e9.png");
+    CHECK(upper != lower);
+    CHECK(table.Intern("C:\\Photos\\Holiday.jpeg") != record);
+    CHECK(table.Intern("") == nullptr);
+    CHECK(table.Intern(std::u16string_view()) == nullptr);
+
+    PathTableStats stats = table.Stats();
+    CHECK_EQ(stats.lookups, uint64_t(15));
+    CHECK_EQ(stats.hits, uint64_t(9));
+}
+
+TEST_CASE(RecordsCarryNameExtensionAndParent)
+{
+    PathTable table;
+    // Non-BMP characters take two UTF-16 units and four UTF-8 bytes
+    PathRef record = table.Intern(u"D:\\\x5199\x771f\\\xd83d\xde00 trip.Final.PNG");
+    REQUIRE(record != nullptr);
+    CHECK_EQ(std::string(record->Name()), std::string("\xf0\x9f\x98\x80 trip.Final.PNG"));
+    CHECK_EQ(std::string(record->Extension()), std::string(".PNG"));
+    CHECK_EQ(std::string(record->ExtensionKey()), std::string(".png"));
+    CHECK(record->WideName() == std::u16string_view(u"\xd83d\xde00 trip.Final.PNG"));
+    CHECK(record->WideExtension() == std::u16string_view(u".PNG"));
+    CHECK(record->wide == u"D:\\\x5199\x771f\\\xd83d\xde00 trip.Final.PNG");
+    CHECK(record->native.empty());
+    CHECK(record->NativePath() == record->wide);
+    CHECK_EQ(record->rootLength, uint32_t(3));
+
+    // Siblings share the directory record, which chains up to the root
+    PathRef sibling = table.Intern("D:\\\xe5\x86\x99\xe7\x9c\x9f\\other");
+    REQUIRE(sibling != nullptr && record->parent != nullptr);
+    CHECK(sibling->parent == record->parent);
+    CHECK_EQ(record->ParentId(), record->parent->id);
+    CHECK(sibling->Extension().empty());
+    PathRef root = record->parent->parent;
+    REQUIRE(root != nullptr);
+    CHECK_EQ(root->path, std::string("D:\\"));
+    CHECK(root->parent == nullptr);
+    CHECK_EQ(root->ParentId(), uint64_t(0));
+    CHECK(root->Name().empty());
+    CHECK(table.Intern("d:/") == root);
+
+    PathRef bare = table.Intern("readme.txt");
+    CHECK(bare->parent == nullptr);
+    CHECK_EQ(std::string(bare->Name()), std::string("readme.txt"));
+    PathRef share = table.Intern("\\\\server\\share\\a.txt");
+    REQUIRE(share->parent != nullptr);
+    CHECK_EQ(share->parent->path, std::string("\\\\server\\share\\"));
+}
+
+TEST_CASE(LongPathsGetANativeForm)
+{
+    PathTable table;
+    std::string dir(240, 'd');
+    PathRef shortPath = table.Intern("C:\\" + std::string(200, 'e'));
+    CHECK(shortPath->native.empty());
+
+    PathRef drive = table.Intern("C:\\" + dir + "\\file.txt");
+    CHECK_EQ(drive->wide.size(), size_t(3 + 240 + 9));
+    CHECK(drive->native == u"\\\\?\\" + drive->wide);
+    CHECK(drive->NativePath() == drive->native);
+
+    PathRef unc = table.Intern("\\\\server\\share\\" + dir);
+    CHECK(unc->native == u"\\\\?\\UNC\\server\\share\\" + std::u16string(240, u'd'));
+
+    // Already-prefixed input comes back with a prefix, the stored path never has one
+    PathRef prefixed = table.Intern("\\\\?\\C:\\" + dir + "\\file.txt");
+    CHECK(prefixed == drive);
+    CHECK_EQ(drive->path.compare(0, 3, "C:\\"), 0);
+
+    // Relative paths have no native form to give
+    PathRef relative = table.Intern(dir + "\\" + dir);
+    CHECK(relative->native.empty());
+}
+
+TEST_CASE(RecordsLiveWhileHeldAndIdsAreNotReused)
+{
+    PathTable table;
+    uint64_t firstId;
+    {
+        PathRef record = table.Intern("C:\\a\\b.txt");
+        firstId = record->id;
+        CHECK_EQ(table.Stats().live, uint64_t(3));      // C:\, C:\a, C:\a\b.txt
+    }
+    CHECK_EQ(table.Stats().live, uint64_t(0));
+    PathRef again = table.Intern("C:\\a\\b.txt");
+    CHECK(again->id > firstId);
+
+    // Expired entries are swept as the table grows
+    for (int i = 0; i < 5000; ++i)
+        table.Intern("C:\\a\\" + std::to_string(i));
+    PathTableStats stats = table.Stats();
+    CHECK_EQ(stats.live, uint64_t(3));
+    CHECK_EQ(stats.created, uint64_t(6 + 5000));
+}
+
+TEST_CASE(ConcurrentInternsAgreeOnOneRecord)
+{
+    PathTable table;
+    const int threadCount = 8, pathCount = 300;
+    std::vector<std::vector<PathRef>> results(threadCount);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&table, &results, t]()
+        {
+            for (int i = 0; i < pathCount; ++i)
+            {
+                // Same files, different spellings per thread
+                std::string path = (t % 2 ? "c:/Shared/Dir" : "C:\\shared\\dir") + std::to_string(i % 10) + "\\File" + std::to_string(i) + ".BIN";
+                results[t].push_back(table.Intern(path));
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    std::set<uint64_t> ids;
+    for (int i = 0; i < pathCount; ++i)
+    {
+        for (int t = 1; t < threadCount; ++t)
+            CHECK(results[t][i] == results[0][i]);
+        ids.insert(results[0][i]->id);
+        CHECK(results[0][i]->parent == results[0][i % 10]->parent);
+    }
+    CHECK_EQ(ids.size(), size_t(pathCount));
+    // The files, ten directories, C:\shared and C:\ were each built once
+    CHECK_EQ(table.Stats().created, uint64_t(pathCount + 10 + 2));
+}
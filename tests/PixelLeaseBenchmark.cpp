@@ -0,0 +1,60 @@
+#include "Benchmark.h"
+#include "PixelLease.h"
+#include <cstring>
+#include <vector>
+
+// Handing a finished thumbnail to a caller: leased (descriptor now, release later) against a
+// copy into the caller's buffer, for a 256x256 thumbnail and a 1920x1080 preview. Each
+// iteration produces a fresh image from the pool, as a request would.
+namespace
+{
+    void Produce(uint32_t width, uint32_t height, int i, PixelImage* image)
+    {
+        image->Allocate(width, height);
+        memset(image->Row(0), i, image->stride);
+    }
+
+    void Measure(const char* label, uint32_t width, uint32_t height, int iterations)
+    {
+        PixelLeaseTable table;
+        uint64_t checksum = 0;
+        BenchmarkTimer timer;
+        for (int i = 0; i < iterations; ++i)
+        {
+            PixelImage image;
+            Produce(width, height, i, &image);
+            PixelDescriptor descriptor;
+            table.Lease(std::move(image), &descriptor);
+            checksum += descriptor.pixels[0];
+            table.Release(descriptor.pixels);
+        }
+        double leaseMs = timer.Milliseconds();
+
+        std::vector<uint8_t> buffer(RequiredBufferBytes(width, height, 0));
+        timer.Restart();
+        for (int i = 0; i < iterations; ++i)
+        {
+            PixelImage image;
+            Produce(width, height, i, &image);
+            PixelDescriptor descriptor;
+            CopyPixelsToBuffer(image, buffer.data(), buffer.size(), 0, &descriptor, nullptr);
+            checksum += descriptor.pixels[0];
+        }
+        double copyMs = timer.Milliseconds();
+
+        std::string name = std::string(label) + " leased";
+        ReportResult(name.c_str(), leaseMs * 1000.0 / iterations, "us");
+        name = std::string(label) + " copied to caller buffer";
+        ReportResult(name.c_str(), copyMs * 1000.0 / iterations, "us");
+        if (checksum == 1)
+            printf("\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double scale = BenchmarkScale(argc, argv);
+    Measure("256x256", 256, 256, static_cast<int>(20000 * scale));
+    Measure("1920x1080", 1920, 1080, static_cast<int>(500 * scale));
+    return 0;
+}
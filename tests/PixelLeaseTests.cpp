@@ -0,0 +1,195 @@
+#include "TestHarness.h"
+#include "PixelLease.h"
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    PixelImage Gradient(uint32_t width, uint32_t height, AlphaMode alpha)
+    {
+        PixelImage image;
+        image.Allocate(width, height);
+        image.alpha = alpha;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            uint8_t* p = image.Row(y);
+            for (uint32_t x = 0; x < width; ++x, p += 4)
+            {
+                p[0] = static_cast<uint8_t>(x);
+                p[1] = static_cast<uint8_t>(y);
+                p[2] = static_cast<uint8_t>(x + y);
+                p[3] = static_cast<uint8_t>(255 - x);
+            }
+        }
+        return image;
+    }
+}
+
+TEST_CASE(LeasedPixelsStayValidUntilReleasedOnce)
+{
+    PixelLeaseTable table;
+    PixelImage image = Gradient(37, 11, AlphaMode::Premultiplied);
+    const uint8_t* original = image.buffer.Data();
+    size_t capacity = image.buffer.Capacity();
+
+    PixelDescriptor descriptor;
+    REQUIRE(table.Lease(std::move(image), &descriptor));
+    // The caller gets the pooled buffer itself, no copy
+    CHECK(descriptor.pixels == original);
+    CHECK(image.Empty());
+    CHECK_EQ(descriptor.width, uint32_t(37));
+    CHECK_EQ(descriptor.height, uint32_t(11));
+    CHECK_EQ(descriptor.stride, size_t(37 * 4));
+    CHECK(descriptor.format == PixelFormat::Bgra32);
+    CHECK(descriptor.alpha == AlphaMode::Premultiplied);
+    CHECK_EQ(descriptor.pixels[10 * descriptor.stride + 5 * 4 + 2], uint8_t(15));
+    CHECK_EQ(table.Outstanding(), size_t(1));
+    CHECK_EQ(table.OutstandingBytes(), uint64_t(capacity));
+
+    // Only the exact pointer, and only once
+    CHECK(!table.Release(descriptor.pixels + 4));
+    CHECK(!table.Release(nullptr));
+    CHECK(table.Release(descriptor.pixels));
+    CHECK(!table.Release(descriptor.pixels));
+    CHECK_EQ(table.Outstanding(), size_t(0));
+    CHECK_EQ(table.OutstandingBytes(), uint64_t(0));
+
+    PixelImage empty;
+    CHECK(!table.Lease(std::move(empty), &descriptor));
+    PixelImage unused = Gradient(2, 2, AlphaMode::Ignore);
+    CHECK(!table.Lease(std::move(unused), nullptr));
+    CHECK_EQ(table.Outstanding(), size_t(0));
+}
+
+TEST_CASE(ReleasedBuffersReturnToThePool)
+{
+    BufferPool::TrimCurrentThread();
+    PixelLeaseTable table;
+    PixelDescriptor descriptor;
+    REQUIRE(table.Lease(Gradient(256, 256, AlphaMode::Ignore), &descriptor));
+    uint8_t* leased = descriptor.pixels;
+    REQUIRE(table.Release(leased));
+
+    BufferPool::ResetStats();
+    PixelImage next;
+    REQUIRE(next.Allocate(256, 256));
+    CHECK(next.buffer.Data() == leased);
+    CHECK_EQ(BufferPool::GetStats().reuseCount, uint64_t(1));
+    next.Reset();
+    BufferPool::TrimCurrentThread();
+}
+
+TEST_CASE(LeasesCanBeReleasedFromAnyThread)
+{
+    PixelLeaseTable table;
+    const int threadCount = 8, perThread = 500;
+    std::vector<std::vector<uint8_t*>> leased(threadCount);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&table, &leased, t]()
+        {
+            for (int i = 0; i < perThread; ++i)
+            {
+                PixelDescriptor descriptor;
+                if (table.Lease(Gradient(8 + i % 16, 8, AlphaMode::Straight), &descriptor))
+                    leased[t].push_back(descriptor.pixels);
+                // Keep some, hand some straight back
+                if (i % 3 == 0)
+                {
+                    table.Release(leased[t].back());
+                    leased[t].pop_back();
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    threads.clear();
+
+    size_t kept = 0;
+    for (const std::vector<uint8_t*>& list : leased)
+        kept += list.size();
+    CHECK_EQ(kept, size_t(threadCount * (perThread - (perThread + 2) / 3)));
+    CHECK_EQ(table.Outstanding(), kept);
+
+    // Each thread releases what another one leased
+    std::vector<int> released(threadCount, 0);
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&table, &leased, &released, t]()
+        {
+            for (uint8_t* pixels : leased[(t + 1) % threadCount])
+                released[t] += table.Release(pixels);
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    size_t total = 0;
+    for (int count : released)
+        total += count;
+    CHECK_EQ(total, kept);
+    CHECK_EQ(table.Outstanding(), size_t(0));
+    CHECK_EQ(table.OutstandingBytes(), uint64_t(0));
+}
+
+TEST_CASE(RequiredBytesSkipThePaddingOfTheLastRow)
+{
+    CHECK_EQ(RequiredBufferBytes(10, 5, 0), size_t(200));
+    CHECK_EQ(RequiredBufferBytes(10, 5, 40), size_t(200));
+    CHECK_EQ(RequiredBufferBytes(10, 5, 64), size_t(64 * 4 + 40));
+    CHECK_EQ(RequiredBufferBytes(10, 1, 64), size_t(40));
+    CHECK_EQ(RequiredBufferBytes(10, 5, 39), size_t(0));
+    CHECK_EQ(RequiredBufferBytes(10, 0, 0), size_t(0));
+}
+
+TEST_CASE(CopiesHonorTheCallersStride)
+{
+    PixelImage image = Gradient(10, 6, AlphaMode::Straight);
+    const size_t stride = 48;
+    std::vector<uint8_t> buffer(RequiredBufferBytes(10, 6, stride) + 16, 0xCD);
+
+    PixelDescriptor descriptor;
+    size_t required = 0;
+    REQUIRE(CopyPixelsToBuffer(image, buffer.data(), buffer.size(), stride, &descriptor, &required));
+    CHECK_EQ(required, size_t(5 * 48 + 40));
+    CHECK(descriptor.pixels == buffer.data());
+    CHECK_EQ(descriptor.stride, stride);
+    CHECK(descriptor.alpha == AlphaMode::Straight);
+    for (uint32_t y = 0; y < 6; ++y)
+    {
+        CHECK(memcmp(buffer.data() + y * stride, image.Row(y), 40) == 0);
+        // Padding and the tail past the last row are left alone
+        for (size_t i = y * stride + 40; i < (y + 1) * stride && i < buffer.size(); ++i)
+            CHECK_EQ(buffer[i], uint8_t(0xCD));
+    }
+
+    // Default stride is tightly packed
+    std::vector<uint8_t> packed(240);
+    REQUIRE(CopyPixelsToBuffer(image, packed.data(), packed.size(), 0, &descriptor, nullptr));
+    CHECK_EQ(descriptor.stride, size_t(40));
+    CHECK(memcmp(packed.data() + 5 * 40, image.Row(5), 40) == 0);
+}
+
+TEST_CASE(ShortBuffersReportTheSizeNeeded)
+{
+    PixelImage image = Gradient(10, 6, AlphaMode::Ignore);
+    std::vector<uint8_t> buffer(239, 0xCD);
+    PixelDescriptor descriptor;
+    size_t required = 0;
+
+    CHECK(!CopyPixelsToBuffer(image, buffer.data(), buffer.size(), 0, &descriptor, &required));
+    CHECK_EQ(required, size_t(240));
+    CHECK(descriptor.pixels == nullptr);
+    CHECK_EQ(descriptor.width, uint32_t(10));
+    CHECK_EQ(descriptor.height, uint32_t(6));
+    CHECK_EQ(buffer[0], uint8_t(0xCD));
+
+    // Asking with no buffer is how a caller sizes one
+    CHECK(!CopyPixelsToBuffer(image, nullptr, 0, 64, &descriptor, &required));
+    CHECK_EQ(required, size_t(5 * 64 + 40));
+    CHECK(!CopyPixelsToBuffer(image, buffer.data(), buffer.size(), 36, &descriptor, &required));
+    CHECK_EQ(required, size_t(0));
+    CHECK(!CopyPixelsToBuffer(PixelImage(), buffer.data(), buffer.size(), 0, &descriptor, &required));
+}
@@ -0,0 +1,177 @@
+#include "TestHarness.h"
+#include "PngWriter.h"
+#include "ReferenceCodecs.h"
+#include "TestData.h"
+#include <random>
+
+using Reference::CheckDecodesTo;
+
+namespace
+{
+    PixelImage RandomImage(uint32_t width, uint32_t height, AlphaMode alpha, uint32_t seed)
+    {
+        PixelImage image;
+        image.Allocate(width, height);
+        image.alpha = alpha;
+        std::mt19937 random(seed);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            uint8_t* p = image.Row(y);
+            for (uint32_t x = 0; x < width; ++x, p += 4)
+            {
+                uint8_t a = static_cast<uint8_t>(random());
+                for (int c = 0; c < 3; ++c)
+                {
+                    uint8_t value = static_cast<uint8_t>(random());
+                    p[c] = alpha == AlphaMode::Premultiplied ? static_cast<uint8_t>(value * a / 255) : value;
+                }
+                p[3] = a;
+            }
+        }
+        return image;
+    }
+
+    // Smooth gradients with a few hard edges, closer to a real thumbnail than noise
+    PixelImage GradientImage(uint32_t width, uint32_t height)
+    {
+        PixelImage image;
+        image.Allocate(width, height);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            uint8_t* p = image.Row(y);
+            for (uint32_t x = 0; x < width; ++x, p += 4)
+            {
+                p[0] = static_cast<uint8_t>(x * 255 / width);
+                p[1] = static_cast<uint8_t>(y * 255 / height);
+                p[2] = static_cast<uint8_t>(((x / 16) ^ (y / 16)) & 1 ? 200 : 40);
+                p[3] = 255;
+            }
+        }
+        return image;
+    }
+}
+
+TEST_CASE(EncodedImagesDecodeWithLibpng)
+{
+    const uint32_t sizes[][2] = { { 1, 1 }, { 2, 1 }, { 1, 7 }, { 13, 5 }, { 64, 64 }, { 301, 77 } };
+    const AlphaMode modes[] = { AlphaMode::Ignore, AlphaMode::Straight, AlphaMode::Premultiplied };
+    uint32_t seed = 0;
+    for (const uint32_t* size : sizes)
+    {
+        for (AlphaMode alpha : modes)
+        {
+            PixelImage image = RandomImage(size[0], size[1], alpha, ++seed);
+            for (int level : { 0, 1, 6, 9 })
+            {
+                std::vector<uint8_t> png;
+                REQUIRE(EncodePng(image, &png, level));
+                CheckDecodesTo(png, image);
+            }
+        }
+    }
+}
+
+TEST_CASE(LargeImagesSpanSeveralIdatChunks)
+{
+    PixelImage image = RandomImage(400, 300, AlphaMode::Straight, 5);
+    std::vector<uint8_t> png;
+    REQUIRE(EncodePng(image, &png));
+    CheckDecodesTo(png, image);
+
+    size_t idatChunks = 0;
+    for (size_t pos = 8; pos + 8 <= png.size();)
+    {
+        uint32_t length = (uint32_t(png[pos]) << 24) | (uint32_t(png[pos + 1]) << 16) | (uint32_t(png[pos + 2]) << 8) | png[pos + 3];
+        if (memcmp(&png[pos + 4], "IDAT", 4) == 0)
+        {
+            CHECK(length <= PngWriter::IDAT_CHUNK_SIZE);
+            idatChunks++;
+        }
+        pos += 12 + length;
+    }
+    CHECK(idatChunks > 1);
+}
+
+TEST_CASE(GradientsCompressWell)
+{
+    PixelImage image = GradientImage(1500, 1100);
+    std::vector<uint8_t> png;
+    REQUIRE(EncodePng(image, &png));
+    CheckDecodesTo(png, image);
+    // Well below the raw 3 bytes per pixel
+    CHECK(png.size() < size_t(1500) * 1100 / 4);
+}
+
+TEST_CASE(FlushedRowsAreDecodableBeforeFinish)
+{
+    PixelImage image = GradientImage(200, 100);
+    std::vector<uint8_t> png;
+    PngWriter writer([&png](const uint8_t* data, size_t size)
+    {
+        png.insert(png.end(), data, data + size);
+        return true;
+    });
+    REQUIRE(writer.Begin(image.width, image.height, image.alpha));
+    for (uint32_t y = 0; y < 40; ++y)
+        REQUIRE(writer.WriteRow(image.Row(y)));
+    REQUIRE(writer.Flush());
+
+    // Everything after the 33-byte signature and IHDR is IDAT data up to here
+    std::vector<uint8_t> zlib;
+    for (size_t pos = 33; pos + 8 <= png.size();)
+    {
+        uint32_t length = (uint32_t(png[pos]) << 24) | (uint32_t(png[pos + 1]) << 16) | (uint32_t(png[pos + 2]) << 8) | png[pos + 3];
+        REQUIRE(memcmp(&png[pos + 4], "IDAT", 4) == 0);
+        zlib.insert(zlib.end(), png.begin() + pos + 8, png.begin() + pos + 8 + length);
+        pos += 12 + length;
+    }
+    std::vector<uint8_t> scanlines;
+    REQUIRE(Reference::InflatePrefix(zlib, &scanlines));
+    CHECK_EQ(scanlines.size(), size_t(40) * (200 * 3 + 1));
+
+    for (uint32_t y = 40; y < image.height; ++y)
+        REQUIRE(writer.WriteRow(image.Row(y)));
+    REQUIRE(writer.Finish());
+    CheckDecodesTo(png, image);
+}
+
+TEST_CASE(WriterRejectsMisuse)
+{
+    std::vector<uint8_t> png;
+    PngWriter::Sink sink = [&png](const uint8_t* data, size_t size)
+    {
+        png.insert(png.end(), data, data + size);
+        return true;
+    };
+    PixelImage image = GradientImage(4, 2);
+
+    PngWriter empty(sink);
+    CHECK(!empty.Begin(0, 5, AlphaMode::Ignore));
+    CHECK(!empty.WriteRow(image.Row(0)));
+
+    PngWriter writer(sink);
+    REQUIRE(writer.Begin(4, 2, AlphaMode::Ignore));
+    CHECK(!writer.Begin(4, 2, AlphaMode::Ignore));
+    REQUIRE(writer.WriteRow(image.Row(0)));
+    CHECK(!writer.Finish());            // One row missing
+    REQUIRE(writer.WriteRow(image.Row(1)));
+    CHECK(!writer.WriteRow(image.Row(1)));
+    CHECK(writer.Finish());
+
+    // A sink that fails stops the writer
+    PngWriter failing([](const uint8_t*, size_t) { return false; });
+    CHECK(!failing.Begin(4, 2, AlphaMode::Ignore));
+    CHECK(!failing.WriteRow(image.Row(0)));
+}
+
+TEST_CASE(SavedFileMatchesTheEncodedBytes)
+{
+    TestHarness::TempDirectory dir;
+    PixelImage image = RandomImage(50, 30, AlphaMode::Straight, 99);
+    std::vector<uint8_t> encoded;
+    REQUIRE(EncodePng(image, &encoded));
+    REQUIRE(SavePixelImageAsPng(image, dir / "out.png"));
+
+    CHECK(TestData::ReadFile(dir / "out.png") == encoded);
+    CHECK(!SavePixelImageAsPng(PixelImage(), dir / "empty.png"));
+}
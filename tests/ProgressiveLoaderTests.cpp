@@ -0,0 +1,256 @@
+#include "TestHarness.h"
+#include "ImageProvider.h"
+#include "ProgressiveLoader.h"
+#include "SharedImageCache.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Delivery
+    {
+        bool hasImage;
+        int image;
+        ResultQuality quality;
+        bool isFinal;
+    };
+
+    // Stage that returns `image` (or fails with 0) and counts its calls
+    ProgressiveLoader<int>::Fetch Tier(int image, int* calls)
+    {
+        return [image, calls](int* out)
+        {
+            ++*calls;
+            *out = image;
+            return image != 0;
+        };
+    }
+
+    std::vector<Delivery> RunCollecting(const ProgressiveLoader<int>& loader, bool* finalDelivered, size_t stopAfter = 0)
+    {
+        std::vector<Delivery> deliveries;
+        *finalDelivered = loader.Run([&](bool hasImage, int image, ResultQuality quality, bool isFinal)
+        {
+            deliveries.push_back(Delivery{ hasImage, image, quality, isFinal });
+            return stopAfter == 0 || deliveries.size() < stopAfter;
+        });
+        return deliveries;
+    }
+
+    // Fake Shell thumbnail providers: a cache lookup and an extractor, sharing one "cache"
+    class FakeProvider : public IImageProvider<int>
+    {
+    public:
+        FakeProvider(const char* name, uint32_t capabilities, const bool* cached, int image)
+            : m_name(name), m_capabilities(capabilities), m_cached(cached), m_image(image) {}
+
+        ProviderDescriptor Describe() const override
+        {
+            ProviderDescriptor descriptor;
+            descriptor.name = m_name;
+            descriptor.capabilities = m_capabilities;
+            descriptor.estimatedCostMs = (m_capabilities & PROVIDER_CAP_CACHE_ONLY) ? 1.0 : 50.0;
+            return descriptor;
+        }
+
+        int32_t Provide(const ImageRequest&, int* image) override
+        {
+            ++calls;
+            if ((m_capabilities & PROVIDER_CAP_CACHE_ONLY) && !*m_cached)
+                return -1;
+            *image = m_image;
+            return 0;
+        }
+
+        int calls = 0;
+
+    private:
+        std::string m_name;
+        uint32_t m_capabilities;
+        const bool* m_cached;
+        int m_image;
+    };
+
+    std::shared_ptr<PixelImage> SolidImage(uint32_t size)
+    {
+        std::shared_ptr<PixelImage> image = std::make_shared<PixelImage>();
+        image->Allocate(size, size);
+        return image;
+    }
+}
+
+TEST_CASE(EachImprovementIsDeliveredInOrder)
+{
+    int placeholderCalls = 0, cachedCalls = 0, fullCalls = 0;
+    ProgressiveLoader<int> loader;
+    loader.AddStage(ResultQuality::Placeholder, Tier(1, &placeholderCalls), false);
+    loader.AddStage(ResultQuality::Cached, Tier(0, &cachedCalls), true);
+    loader.AddStage(ResultQuality::Full, Tier(3, &fullCalls), true);
+
+    bool finalDelivered = false;
+    std::vector<Delivery> deliveries = RunCollecting(loader, &finalDelivered);
+    CHECK(finalDelivered);
+    REQUIRE(deliveries.size() == 2);
+    CHECK_EQ(deliveries[0].image, 1);
+    CHECK(deliveries[0].quality == ResultQuality::Placeholder && !deliveries[0].isFinal);
+    CHECK_EQ(deliveries[1].image, 3);
+    CHECK(deliveries[1].quality == ResultQuality::Full && deliveries[1].isFinal);
+    CHECK_EQ(placeholderCalls + cachedCalls + fullCalls, 3);
+}
+
+TEST_CASE(CacheHitSkipsTheExtraction)
+{
+    int placeholderCalls = 0, cachedCalls = 0, fullCalls = 0;
+    ProgressiveLoader<int> loader;
+    loader.AddStage(ResultQuality::Placeholder, Tier(1, &placeholderCalls), false);
+    loader.AddStage(ResultQuality::Cached, Tier(2, &cachedCalls), true);
+    loader.AddStage(ResultQuality::Full, Tier(3, &fullCalls), true);
+
+    bool finalDelivered = false;
+    std::vector<Delivery> deliveries = RunCollecting(loader, &finalDelivered);
+    CHECK(finalDelivered);
+    REQUIRE(deliveries.size() == 2);
+    CHECK(deliveries[1].quality == ResultQuality::Cached && deliveries[1].isFinal);
+    CHECK_EQ(fullCalls, 0);
+}
+
+TEST_CASE(AllStagesFailingEndsWithAnEmptyFinalCall)
+{
+    int calls = 0;
+    ProgressiveLoader<int> loader;
+    loader.AddStage(ResultQuality::Placeholder, Tier(0, &calls), false);
+    loader.AddStage(ResultQuality::Full, Tier(0, &calls), true);
+
+    bool finalDelivered = true;
+    std::vector<Delivery> deliveries = RunCollecting(loader, &finalDelivered);
+    CHECK(!finalDelivered);
+    REQUIRE(deliveries.size() == 1);
+    CHECK(!deliveries[0].hasImage && deliveries[0].isFinal);
+    CHECK_EQ(calls, 2);
+}
+
+TEST_CASE(StoppingAfterThePlaceholderSkipsTheRest)
+{
+    int placeholderCalls = 0, fullCalls = 0;
+    ProgressiveLoader<int> loader;
+    loader.AddStage(ResultQuality::Placeholder, Tier(1, &placeholderCalls), false);
+    loader.AddStage(ResultQuality::Full, Tier(3, &fullCalls), true);
+
+    bool finalDelivered = true;
+    std::vector<Delivery> deliveries = RunCollecting(loader, &finalDelivered, 1);
+    CHECK(!finalDelivered);
+    CHECK_EQ(deliveries.size(), size_t(1));
+    CHECK_EQ(fullCalls, 0);
+}
+
+TEST_CASE(StagesThatCannotImproveAreNotFetched)
+{
+    int first = 0, second = 0;
+    ProgressiveLoader<int> loader;
+    loader.AddStage(ResultQuality::Cached, Tier(2, &first), false);
+    loader.AddStage(ResultQuality::Placeholder, Tier(1, &second), false);
+
+    bool finalDelivered = false;
+    std::vector<Delivery> deliveries = RunCollecting(loader, &finalDelivered);
+    // Nothing after the Cached stage is better, so its result is final
+    CHECK(finalDelivered);
+    REQUIRE(deliveries.size() == 1);
+    CHECK(deliveries[0].isFinal);
+    CHECK_EQ(second, 0);
+}
+
+// The thumbnail loader's Cached and Full stages over the provider registry: after a cache miss
+// in the Cached stage, the Full stage excludes the cache-only providers instead of asking again.
+TEST_CASE(FullStageAfterACacheMissDoesNotProbeTheCacheAgain)
+{
+    for (bool cached : { false, true })
+    {
+        ProviderRegistry<int> registry;
+        std::shared_ptr<FakeProvider> lookup = std::make_shared<FakeProvider>("CacheLookup",
+            PROVIDER_CAP_THUMBNAIL | PROVIDER_CAP_CACHE_ONLY, &cached, 2);
+        std::shared_ptr<FakeProvider> extractor = std::make_shared<FakeProvider>("Extractor",
+            PROVIDER_CAP_THUMBNAIL, &cached, 3);
+        registry.Register(lookup);
+        registry.Register(extractor);
+
+        ImageRequest request;
+        request.fileType = "jpg";
+        request.width = request.height = 96;
+        request.requiredCapabilities = PROVIDER_CAP_THUMBNAIL;
+
+        bool cacheMissed = false;
+        ProgressiveLoader<int> loader;
+        loader.AddStage(ResultQuality::Cached, [&](int* out)
+        {
+            ImageRequest cacheOnly = request;
+            cacheOnly.requiredCapabilities |= PROVIDER_CAP_CACHE_ONLY;
+            if (registry.Run(cacheOnly, out).status >= 0)
+                return true;
+            cacheMissed = true;
+            return false;
+        }, true);
+        loader.AddStage(ResultQuality::Full, [&](int* out)
+        {
+            ImageRequest full = request;
+            if (cacheMissed)
+                full.excludedCapabilities |= PROVIDER_CAP_CACHE_ONLY;
+            return registry.Run(full, out).status >= 0;
+        }, true);
+
+        bool finalDelivered = false;
+        std::vector<Delivery> deliveries = RunCollecting(loader, &finalDelivered);
+        CHECK(finalDelivered);
+        REQUIRE(deliveries.size() == 1);
+        CHECK_EQ(deliveries[0].image, cached ? 2 : 3);
+        CHECK_EQ(lookup->calls, 1);
+        CHECK_EQ(extractor->calls, cached ? 0 : 1);
+    }
+}
+
+TEST_CASE(SharedImageCacheKeepsTheMostRecentImages)
+{
+    SharedImageCache cache(2);
+    cache.Insert("a|1", SolidImage(4));
+    cache.Insert("b|1", SolidImage(8));
+    REQUIRE(cache.Find("a|1"));
+    cache.Insert("c|1", SolidImage(16));
+
+    CHECK(!cache.Find("b|1"));
+    SharedImageCache::ImagePtr a = cache.Find("a|1");
+    REQUIRE(a);
+    CHECK_EQ(a->width, uint32_t(4));
+
+    std::vector<std::pair<std::string, SharedImageCache::ImagePtr>> entries = cache.Entries();
+    REQUIRE(entries.size() == 2);
+    CHECK_EQ(entries[0].first, std::string("a|1"));
+    CHECK_EQ(entries[1].first, std::string("c|1"));
+    CHECK_EQ(cache.Stats().evictions, uint64_t(1));
+}
+
+TEST_CASE(SharedImageCacheErasesByPrefix)
+{
+    SharedImageCache cache(10);
+    cache.Insert("c:\\dir\\a.jpg|10|1", SolidImage(4));
+    cache.Insert("c:\\dir\\a.jpg.bak|10|1", SolidImage(4));
+    cache.Insert("c:\\dir\\sub\\b.jpg|10|1", SolidImage(4));
+    cache.Insert("c:\\other\\c.jpg|10|1", SolidImage(4));
+
+    CHECK_EQ(cache.ErasePrefix("c:\\dir\\a.jpg|"), size_t(1));
+    CHECK(cache.Find("c:\\dir\\a.jpg.bak|10|1"));
+    CHECK_EQ(cache.ErasePrefix("c:\\dir\\"), size_t(2));
+    CHECK(cache.Find("c:\\other\\c.jpg|10|1"));
+    CHECK(cache.Erase("c:\\other\\c.jpg|10|1"));
+    CHECK(!cache.Erase("c:\\other\\c.jpg|10|1"));
+}
+
+TEST_CASE(SharedImagesOutliveTheirCacheEntry)
+{
+    SharedImageCache cache(1);
+    cache.Insert("a", SolidImage(4));
+    SharedImageCache::ImagePtr held = cache.Find("a");
+    cache.Clear();
+    REQUIRE(held);
+    CHECK_EQ(held->width, uint32_t(4));
+    CHECK(!held->Empty());
+}
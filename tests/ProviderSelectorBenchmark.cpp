@@ -0,0 +1,107 @@
+#include "Benchmark.h"
+#include "ProviderSelector.h"
+#include <random>
+#include <string>
+#include <vector>
+
+// Simulated extraction chain with the PreviewHandler's fixed order (cache probe, shell item
+// factory, IExtractImage, IThumbnailProvider) over a mix of file types, each method with its
+// own latency and success rate per type. Compares the fixed order with the learned one on a
+// simulated clock and reports the real overhead of Order + Record per request.
+namespace
+{
+    struct Method
+    {
+        const char* name;
+        double latencyMs;
+        double success[4];      // jpg, mp4, pdf, xyz
+    };
+
+    const Method METHODS[] =
+    {
+        { "cache", 2.0, { 0.6, 0.0, 0.3, 0.0 } },
+        { "factory", 35.0, { 0.98, 0.95, 0.0, 0.0 } },
+        { "extract", 25.0, { 0.0, 0.0, 0.95, 0.0 } },
+        { "provider", 20.0, { 0.9, 0.98, 0.0, 0.0 } },
+    };
+    const char* TYPES[] = { "jpg", "mp4", "pdf", "xyz" };
+    const int TYPE_SHARE[] = { 50, 20, 20, 10 };     // Percent of requests
+
+    struct Totals
+    {
+        double simulatedMs = 0;
+        uint64_t failedAttempts = 0;
+        uint64_t images = 0;
+    };
+
+    Totals Simulate(int requests, bool adaptive, double* overheadUs)
+    {
+        ProviderSelector selector;
+        for (const Method& method : METHODS)
+        {
+            ProviderDescriptor descriptor;
+            descriptor.name = method.name;
+            descriptor.capabilities = PROVIDER_CAP_THUMBNAIL;
+            descriptor.estimatedCostMs = method.latencyMs;
+            selector.Register(descriptor);
+        }
+        // The fixed chain, in PreviewHandler order
+        std::vector<size_t> fixed = { 0, 1, 2, 3 };
+
+        std::mt19937 random(7);
+        std::uniform_real_distribution<double> roll(0.0, 1.0);
+        Totals totals;
+        double selectorMs = 0;
+        for (int i = 0; i < requests; ++i)
+        {
+            int pick = static_cast<int>(random() % 100);
+            int type = 0;
+            while (pick >= TYPE_SHARE[type])
+                pick -= TYPE_SHARE[type++];
+
+            ImageRequest request;
+            request.fileType = TYPES[type];
+            request.width = request.height = 256;
+
+            BenchmarkTimer timer;
+            std::vector<size_t> order = adaptive ? selector.Order(request) : fixed;
+            selectorMs += timer.Milliseconds();
+
+            for (size_t id : order)
+            {
+                const Method& method = METHODS[id];
+                bool success = roll(random) < method.success[type];
+                totals.simulatedMs += method.latencyMs;
+                timer.Restart();
+                selector.Record(id, request.fileType, success, method.latencyMs);
+                selectorMs += timer.Milliseconds();
+                if (success)
+                {
+                    ++totals.images;
+                    break;
+                }
+                ++totals.failedAttempts;
+            }
+        }
+        *overheadUs = selectorMs * 1000.0 / requests;
+        return totals;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int requests = static_cast<int>(20000 * BenchmarkScale(argc, argv));
+    double fixedUs = 0, adaptiveUs = 0;
+    Totals fixed = Simulate(requests, false, &fixedUs);
+    Totals adaptive = Simulate(requests, true, &adaptiveUs);
+
+    ReportResult("requests", requests, "");
+    ReportResult("fixed order: time per request", fixed.simulatedMs / requests, "ms (simulated)");
+    ReportResult("fixed order: failed attempts per request", static_cast<double>(fixed.failedAttempts) / requests, "");
+    ReportResult("fixed order: images", static_cast<double>(fixed.images), "");
+    ReportResult("learned order: time per request", adaptive.simulatedMs / requests, "ms (simulated)");
+    ReportResult("learned order: failed attempts per request", static_cast<double>(adaptive.failedAttempts) / requests, "");
+    ReportResult("learned order: images", static_cast<double>(adaptive.images), "");
+    ReportResult("selector overhead", adaptiveUs, "us/request");
+    return 0;
+}
@@ -0,0 +1,267 @@
+#include "TestHarness.h"
+#include "ProviderSelector.h"
+#include <cmath>
+#include <fstream>
+#include <thread>
+
+namespace
+{
+    ProviderDescriptor Provider(const std::string& name, double costMs)
+    {
+        ProviderDescriptor descriptor;
+        descriptor.name = name;
+        descriptor.capabilities = PROVIDER_CAP_THUMBNAIL;
+        descriptor.estimatedCostMs = costMs;
+        return descriptor;
+    }
+
+    ImageRequest Request(const std::string& fileType)
+    {
+        ImageRequest request;
+        request.fileType = fileType;
+        request.width = 96;
+        request.height = 96;
+        return request;
+    }
+
+    bool Near(double a, double b)
+    {
+        return std::fabs(a - b) < 1e-9 * (std::fabs(a) + std::fabs(b) + 1.0);
+    }
+}
+
+TEST_CASE(EstimatesOrderProvidersUntilMeasured)
+{
+    ProviderSelector selector;
+    selector.Register(Provider("slow", 50));
+    selector.Register(Provider("fast", 5));
+    selector.Register(Provider("also-fast", 5));
+    // Ties keep registration order
+    CHECK(selector.Order(Request("jpg")) == std::vector<size_t>({ 1, 2, 0 }));
+    // The prior success rate halves every estimate
+    CHECK(Near(selector.ExpectedCost(0, "jpg"), 100.0));
+    CHECK(Near(selector.ExpectedCost(9, "jpg"), 0.0));
+}
+
+TEST_CASE(ExpectedCostIsLatencyOverSmoothedSuccessRate)
+{
+    ProviderSelector selector;
+    selector.Register(Provider("a", 50));
+
+    selector.Record(0, "jpg", true, 10.0);
+    // One success against a prior of one success in two attempts: 2/3
+    CHECK(Near(selector.ExpectedCost(0, "jpg"), 10.0 / (2.0 / 3.0)));
+
+    selector.Record(0, "jpg", false, 20.0);
+    ProviderStats stats = selector.Stats(0, "jpg");
+    CHECK_EQ(stats.attempts, uint64_t(2));
+    CHECK_EQ(stats.successes, uint64_t(1));
+    CHECK(Near(stats.meanLatencyMs, 10.0 + (20.0 - 10.0) * ProviderSelector::LATENCY_SMOOTHING));
+    CHECK(Near(stats.recentAttempts, ProviderSelector::AGING + 1.0));
+    CHECK(Near(stats.recentSuccesses, ProviderSelector::AGING));
+    double rate = (stats.recentSuccesses + 1.0) / (stats.recentAttempts + 2.0);
+    CHECK(Near(selector.ExpectedCost(0, "jpg"), stats.meanLatencyMs / rate));
+
+    // Other types are untouched; tiny latencies are floored so a rate still matters
+    CHECK(Near(selector.ExpectedCost(0, "png"), 100.0));
+    selector.Record(0, "txt", true, 0.0);
+    CHECK(selector.ExpectedCost(0, "txt") > 0.0);
+}
+
+TEST_CASE(AFastFailingProviderFallsBehindASlowerReliableOne)
+{
+    // The PreviewHandler chain: a cheap cache probe first, then the real extractor
+    ProviderSelector selector;
+    selector.Register(Provider("cache", 2));
+    selector.Register(Provider("extract", 40));
+    CHECK(selector.Order(Request("mp4")) == std::vector<size_t>({ 0, 1 }));
+
+    // mp4 is never in the cache but extracts in 30 ms
+    for (int i = 0; i < 40; ++i)
+    {
+        selector.Record(0, "mp4", false, 3.0);
+        selector.Record(1, "mp4", true, 30.0);
+    }
+    // Hopeless by now: skipped outright rather than just moved back
+    CHECK(selector.Order(Request("mp4")) == std::vector<size_t>({ 1 }));
+    CHECK(selector.Order(Request("jpg")) == std::vector<size_t>({ 0, 1 }));
+}
+
+TEST_CASE(HopelessProvidersAreRetriedPeriodically)
+{
+    ProviderSelector selector;
+    selector.Register(Provider("broken", 1));
+    selector.Register(Provider("fine", 10));
+    // Aged, eight failures count for slightly less than SKIP_MIN_ATTEMPTS
+    for (int i = 0; i < 12; ++i)
+        selector.Record(0, "heic", false, 1.0);
+
+    uint32_t included = 0;
+    for (uint32_t i = 1; i <= ProviderSelector::RETRY_INTERVAL * 3; ++i)
+    {
+        std::vector<size_t> order = selector.Order(Request("heic"));
+        if (order.size() == 2)
+        {
+            ++included;
+            CHECK_EQ(i % ProviderSelector::RETRY_INTERVAL, uint32_t(0));
+        }
+    }
+    CHECK_EQ(included, uint32_t(3));
+    CHECK_EQ(selector.Stats(0, "heic").skipped, uint64_t(3 * (ProviderSelector::RETRY_INTERVAL - 1)));
+
+    // A codec got installed: the retry succeeds and the provider is back to normal
+    while (selector.Order(Request("heic")).size() < 2)
+    {
+    }
+    for (int i = 0; i < 3; ++i)
+        selector.Record(0, "heic", true, 1.0);
+    CHECK(selector.Order(Request("heic")) == std::vector<size_t>({ 0, 1 }));
+    CHECK(selector.Order(Request("heic")) == std::vector<size_t>({ 0, 1 }));
+
+    // Too few attempts to call it hopeless
+    selector.Record(0, "avif", false, 1.0);
+    CHECK_EQ(selector.Order(Request("avif")).size(), size_t(2));
+}
+
+TEST_CASE(OldOutcomesAgeOut)
+{
+    ProviderSelector selector;
+    selector.Register(Provider("flaky", 10));
+    for (int i = 0; i < 500; ++i)
+        selector.Record(0, "doc", false, 10.0);
+    for (int i = 0; i < 200; ++i)
+        selector.Record(0, "doc", true, 10.0);
+
+    ProviderStats stats = selector.Stats(0, "doc");
+    CHECK_EQ(stats.attempts, uint64_t(700));
+    // Lifetime rate is 2/7; the recent rate reflects the fix
+    CHECK(stats.recentSuccesses / stats.recentAttempts > 0.9);
+    CHECK(stats.recentAttempts < 64.0);
+}
+
+TEST_CASE(StatsAcrossFileTypesAreWeightedByAttempts)
+{
+    ProviderSelector selector;
+    selector.Register(Provider("a", 10));
+    selector.Record(0, "jpg", true, 10.0);
+    for (int i = 0; i < 3; ++i)
+        selector.Record(0, "png", true, 30.0);
+
+    ProviderStats total = selector.Stats(0, "");
+    CHECK_EQ(total.attempts, uint64_t(4));
+    CHECK(Near(total.meanLatencyMs, (10.0 + 3 * 30.0) / 4));
+    CHECK(selector.FileTypes() == std::vector<std::string>({ "jpg", "png" }));
+
+    selector.Record(5, "jpg", true, 1.0);      // Unknown id is ignored
+    CHECK_EQ(selector.UnsavedRecords(), uint64_t(4));
+    selector.ResetStats();
+    CHECK(selector.FileTypes().empty());
+    CHECK_EQ(selector.UnsavedRecords(), uint64_t(0));
+}
+
+TEST_CASE(StatsPersistByProviderName)
+{
+    TestHarness::TempDirectory dir;
+    ProviderSelector first;
+    first.Register(Provider("cache", 2));
+    first.Register(Provider("factory", 40));
+    first.Register(Provider("retired", 5));
+    for (int i = 0; i < 10; ++i)
+    {
+        first.Record(0, "mp4", false, 2.5);
+        first.Record(1, "mp4", true, 31.25);
+        first.Record(2, "mp4", true, 1.0);
+    }
+    first.Record(1, "\xc3\xa9t\xc3\xa9", true, 7.0);
+    CHECK_EQ(first.UnsavedRecords(), uint64_t(31));
+
+    // Serialize is for snapshots and leaves the save pending
+    std::string text = first.Serialize();
+    CHECK_EQ(first.UnsavedRecords(), uint64_t(31));
+    REQUIRE(first.Save(dir / "providers.txt"));
+    CHECK_EQ(first.UnsavedRecords(), uint64_t(0));
+    CHECK(!std::filesystem::exists(dir / "providers.txt.tmp"));
+
+    // Next run: different registration order, one provider gone, one new
+    ProviderSelector second;
+    second.Register(Provider("new", 3));
+    second.Register(Provider("factory", 40));
+    second.Register(Provider("cache", 2));
+    REQUIRE(second.Load(dir / "providers.txt"));
+
+    ProviderStats before = first.Stats(0, "mp4");
+    ProviderStats after = second.Stats(2, "mp4");
+    CHECK_EQ(after.attempts, before.attempts);
+    CHECK_EQ(after.successes, before.successes);
+    CHECK(Near(after.meanLatencyMs, before.meanLatencyMs));
+    CHECK(Near(after.recentAttempts, before.recentAttempts));
+    CHECK(Near(second.ExpectedCost(1, "mp4"), first.ExpectedCost(1, "mp4")));
+    CHECK_EQ(second.Stats(1, "\xc3\xa9t\xc3\xa9").successes, uint64_t(1));
+    CHECK_EQ(second.Stats(0, "").attempts, uint64_t(0));
+    // The learned order carries over: the cache probe stays skipped for mp4
+    CHECK(second.Order(Request("mp4")) == std::vector<size_t>({ 0, 1 }));
+
+    ProviderSelector third;
+    third.Register(Provider("cache", 2));
+    REQUIRE(third.Deserialize(text));
+    CHECK_EQ(third.Stats(0, "mp4").attempts, uint64_t(10));
+}
+
+TEST_CASE(DamagedStatsFilesAreRejectedOrSkippedLineByLine)
+{
+    TestHarness::TempDirectory dir;
+    ProviderSelector selector;
+    selector.Register(Provider("cache", 2));
+
+    CHECK(!selector.Load(dir / "missing.txt"));
+    CHECK(!selector.Deserialize(""));
+    CHECK(!selector.Deserialize("WSP-PROVIDERS 2\njpg\tcache\t1\t1\t1\t1\t1\n"));
+
+    std::string text = "WSP-PROVIDERS 1\n"
+                       "jpg\tcache\t4\t2\t10\t4\t2\n"
+                       "png\tcache\t2\t5\t10\t2\t1\n"       // More successes than attempts
+                       "gif\tcache\t2\t1\t-3\t2\t1\n"       // Negative latency
+                       "bmp\tcache\tnot numbers\n"
+                       "tif\tcache\n"
+                       "no tabs at all\n"
+                       "webp\tcache\t3\t1\t5\t3";           // Torn: a field short
+    REQUIRE(selector.Deserialize(text));
+    CHECK_EQ(selector.Stats(0, "jpg").attempts, uint64_t(4));
+    CHECK_EQ(selector.Stats(0, "png").attempts, uint64_t(0));
+    CHECK_EQ(selector.Stats(0, "gif").attempts, uint64_t(0));
+    CHECK_EQ(selector.Stats(0, "bmp").attempts, uint64_t(0));
+    CHECK_EQ(selector.Stats(0, "webp").attempts, uint64_t(0));
+
+    std::ofstream(dir / "garbage.txt") << "\x7f" "ELF";
+    CHECK(!selector.Load(dir / "garbage.txt"));
+    CHECK_EQ(selector.Stats(0, "jpg").attempts, uint64_t(4));
+}
+
+TEST_CASE(ConcurrentOrderAndRecordStayConsistent)
+{
+    ProviderSelector selector;
+    selector.Register(Provider("a", 1));
+    selector.Register(Provider("b", 2));
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t)
+    {
+        threads.emplace_back([&selector, t]()
+        {
+            std::string type = t % 2 ? "odd" : "even";
+            for (int i = 0; i < 1000; ++i)
+            {
+                for (size_t id : selector.Order(Request(type)))
+                    selector.Record(id, type, id == 1, 1.0);
+                if (i % 100 == 0)
+                    selector.Serialize();
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    CHECK_EQ(selector.Stats(1, "").successes, uint64_t(8000));
+    CHECK_EQ(selector.Stats(1, "").attempts, uint64_t(8000));
+    CHECK_EQ(selector.UnsavedRecords(), selector.Stats(0, "").attempts + 8000);
+}
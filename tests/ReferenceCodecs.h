@@ -0,0 +1,152 @@
+#pragma once
+#include "ImageOps.h"
+#include "TestHarness.h"
+#include <png.h>
+#include <zlib.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Decoders from the system zlib and libpng, used as the reference for what the portable
+// encoders write. Only tests added with wsp_add_reference_test include this.
+
+namespace Reference
+{
+    // windowBits 15 = zlib stream, -15 = raw deflate. Trailing garbage or a truncated stream fails.
+    inline bool Inflate(const uint8_t* data, size_t size, std::vector<uint8_t>* out, int windowBits = 15)
+    {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (inflateInit2(&stream, windowBits) != Z_OK)
+            return false;
+
+        out->clear();
+        stream.next_in = const_cast<Bytef*>(data);
+        stream.avail_in = static_cast<uInt>(size);
+        uint8_t buffer[64 * 1024];
+        int result = Z_OK;
+        while (result == Z_OK)
+        {
+            stream.next_out = buffer;
+            stream.avail_out = sizeof(buffer);
+            result = inflate(&stream, Z_NO_FLUSH);
+            out->insert(out->end(), buffer, buffer + (sizeof(buffer) - stream.avail_out));
+            if (result == Z_BUF_ERROR && stream.avail_in == 0)
+                break;
+        }
+        bool complete = result == Z_STREAM_END && stream.avail_in == 0;
+        inflateEnd(&stream);
+        return complete;
+    }
+
+    inline bool Inflate(const std::vector<uint8_t>& data, std::vector<uint8_t>* out, int windowBits = 15)
+    {
+        return Inflate(data.data(), data.size(), out, windowBits);
+    }
+
+    // Decodes as much of an unfinished stream as its bytes allow (e.g. up to a sync flush)
+    inline bool InflatePrefix(const std::vector<uint8_t>& data, std::vector<uint8_t>* out, int windowBits = 15)
+    {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (inflateInit2(&stream, windowBits) != Z_OK)
+            return false;
+
+        out->clear();
+        stream.next_in = const_cast<Bytef*>(data.data());
+        stream.avail_in = static_cast<uInt>(data.size());
+        uint8_t buffer[64 * 1024];
+        int result = Z_OK;
+        do
+        {
+            stream.next_out = buffer;
+            stream.avail_out = sizeof(buffer);
+            result = inflate(&stream, Z_SYNC_FLUSH);
+            out->insert(out->end(), buffer, buffer + (sizeof(buffer) - stream.avail_out));
+        } while (result == Z_OK && stream.avail_in > 0);
+        inflateEnd(&stream);
+        return result == Z_OK || result == Z_BUF_ERROR || result == Z_STREAM_END;
+    }
+
+    struct DecodedPng
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        bool hasAlpha = false;
+        std::vector<uint8_t> rgba;      // Straight RGBA, width * 4 bytes per row
+
+        const uint8_t* Pixel(uint32_t x, uint32_t y) const { return &rgba[(static_cast<size_t>(y) * width + x) * 4]; }
+    };
+
+    inline bool DecodePng(const uint8_t* data, size_t size, DecodedPng* out)
+    {
+        png_image image;
+        memset(&image, 0, sizeof(image));
+        image.version = PNG_IMAGE_VERSION;
+        if (!png_image_begin_read_from_memory(&image, data, size))
+            return false;
+
+        out->width = image.width;
+        out->height = image.height;
+        out->hasAlpha = (image.format & PNG_FORMAT_FLAG_ALPHA) != 0;
+        image.format = PNG_FORMAT_RGBA;
+        out->rgba.assign(PNG_IMAGE_SIZE(image), 0);
+        bool ok = png_image_finish_read(&image, nullptr, out->rgba.data(), 0, nullptr) != 0;
+        // Warnings (e.g. a bad CRC libpng chose to tolerate) count as failures too
+        ok = ok && image.warning_or_error == 0;
+        png_image_free(&image);
+        return ok;
+    }
+
+    inline bool DecodePng(const std::vector<uint8_t>& data, DecodedPng* out)
+    {
+        return DecodePng(data.data(), data.size(), out);
+    }
+
+    // Straight RGBA that a PNG of `image` should decode to: opaque sources lose their alpha,
+    // premultiplied ones are unpremultiplied with rounding
+    inline void ExpectedRgba(const uint8_t* bgra, AlphaMode alpha, uint8_t* rgba)
+    {
+        uint8_t a = alpha == AlphaMode::Ignore ? 255 : bgra[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            uint8_t value = bgra[2 - c];
+            if (alpha == AlphaMode::Premultiplied)
+            {
+                unsigned v = a ? (value * 255u + a / 2) / a : 0;
+                value = static_cast<uint8_t>(v > 255 ? 255 : v);
+            }
+            rgba[c] = value;
+        }
+        rgba[3] = a;
+    }
+
+    // Compares a decoded PNG with the image it was encoded from; returns the first mismatch
+    // position as y * width + x, or -1 if every pixel matches
+    inline int64_t FirstMismatch(const PixelImage& image, const DecodedPng& decoded)
+    {
+        if (decoded.width != image.width || decoded.height != image.height)
+            return 0;
+        for (uint32_t y = 0; y < image.height; ++y)
+        {
+            const uint8_t* row = image.Row(y);
+            for (uint32_t x = 0; x < image.width; ++x)
+            {
+                uint8_t expected[4];
+                ExpectedRgba(row + x * 4, image.alpha, expected);
+                if (memcmp(expected, decoded.Pixel(x, y), 4) != 0)
+                    return static_cast<int64_t>(y) * image.width + x;
+            }
+        }
+        return -1;
+    }
+
+    // Decodes png with libpng and checks that it shows image, alpha channel or not included
+    inline void CheckDecodesTo(const std::vector<uint8_t>& png, const PixelImage& image)
+    {
+        DecodedPng decoded;
+        REQUIRE(DecodePng(png, &decoded));
+        CHECK_EQ(decoded.hasAlpha, image.alpha != AlphaMode::Ignore);
+        CHECK_EQ(FirstMismatch(image, decoded), int64_t(-1));
+    }
+}
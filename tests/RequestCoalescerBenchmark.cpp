@@ -0,0 +1,96 @@
+#include "Benchmark.h"
+#include "ImageOps.h"
+#include "RequestCoalescer.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Several views ask for the same folder at once (e.g. Explorer and a file dialog). Every request
+// "extracts" a 512x512 image by resizing a 2048x2048 source, with and without coalescing; callers
+// that asked for a smaller size downscale the shared result.
+namespace
+{
+    const int THREADS = 4;
+
+    typedef std::shared_ptr<const PixelImage> SharedImage;
+
+    SharedImage Extract(const PixelImage& source, uint32_t size)
+    {
+        std::shared_ptr<PixelImage> image = std::make_shared<PixelImage>();
+        ResizePixelImage(source, size, size, image.get());
+        return image;
+    }
+
+    double Run(const PixelImage& source, int items, bool coalesce, int* extractions)
+    {
+        RequestCoalescer<SharedImage> coalescer;
+        std::atomic<int> count(0);
+        BenchmarkTimer timer;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t)
+        {
+            threads.emplace_back([&, t]()
+            {
+                uint32_t size = (t % 2) ? 256 : 512;
+                for (int i = 0; i < items; ++i)
+                {
+                    PixelImage result;
+                    if (!coalesce)
+                    {
+                        ++count;
+                        CopyPixelImage(*Extract(source, size), &result);
+                        continue;
+                    }
+                    bool leader = false;
+                    auto flight = coalescer.Join("item" + std::to_string(i), size, true, &leader);
+                    SharedImage image;
+                    if (leader)
+                    {
+                        ++count;
+                        image = Extract(source, size);
+                        coalescer.Finish(flight, [&image]() { return image; });
+                    }
+                    else
+                    {
+                        image = coalescer.Wait(flight);
+                    }
+                    if (image->width != size)
+                        ResizePixelImage(*image, size, size, &result);
+                    else
+                        CopyPixelImage(*image, &result);
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+        *extractions = count;
+        return timer.Milliseconds();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int items = static_cast<int>(40 * BenchmarkScale(argc, argv));
+    PixelImage source;
+    if (!source.Allocate(2048, 2048))
+        return 1;
+    for (uint32_t y = 0; y < source.height; ++y)
+    {
+        for (uint32_t x = 0; x < source.width * 4; ++x)
+            source.Row(y)[x] = static_cast<uint8_t>(x ^ y);
+    }
+
+    int plainExtractions = 0;
+    int coalescedExtractions = 0;
+    double plainMs = Run(source, items, false, &plainExtractions);
+    double coalescedMs = Run(source, items, true, &coalescedExtractions);
+
+    ReportResult("requests", THREADS * items, "");
+    ReportResult("extractions without coalescing", plainExtractions, "");
+    ReportResult("extractions with coalescing", coalescedExtractions, "");
+    ReportResult("without coalescing", plainMs, "ms");
+    ReportResult("with coalescing", coalescedMs, "ms");
+    return 0;
+}
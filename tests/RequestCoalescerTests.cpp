@@ -0,0 +1,139 @@
+#include "TestHarness.h"
+#include "RequestCoalescer.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    typedef RequestCoalescer<std::shared_ptr<int>> Coalescer;
+}
+
+TEST_CASE(UncontendedLeaderDoesNotMaterialiseAValue)
+{
+    Coalescer coalescer;
+    bool leader = false;
+    Coalescer::FlightPtr flight = coalescer.Join("file", 96, true, &leader);
+    REQUIRE(leader);
+    CHECK_EQ(flight->Size(), uint32_t(96));
+
+    bool made = false;
+    CHECK_EQ(coalescer.Finish(flight, [&made]() { made = true; return std::make_shared<int>(1); }), size_t(0));
+    CHECK(!made);
+
+    // The flight is closed: the next request leads again
+    coalescer.Join("file", 96, true, &leader);
+    CHECK(leader);
+    RequestCoalescerStats stats = coalescer.GetStats();
+    CHECK_EQ(stats.leaders, uint64_t(2));
+    CHECK_EQ(stats.sharedValues, uint64_t(0));
+}
+
+TEST_CASE(FollowersReceiveTheLeadersValue)
+{
+    Coalescer coalescer;
+    bool leader = false;
+    Coalescer::FlightPtr flight = coalescer.Join("file", 96, false, &leader);
+    REQUIRE(leader);
+
+    std::vector<std::shared_ptr<int>> received(3);
+    std::vector<std::thread> followers;
+    for (size_t i = 0; i < received.size(); ++i)
+    {
+        bool followerLeads = true;
+        Coalescer::FlightPtr joined = coalescer.Join("file", 96, false, &followerLeads);
+        CHECK(!followerLeads);
+        CHECK(joined == flight);
+        followers.emplace_back([&coalescer, &received, joined, i]() { received[i] = coalescer.Wait(joined); });
+    }
+
+    CHECK_EQ(coalescer.Finish(flight, []() { return std::make_shared<int>(42); }), size_t(3));
+    for (std::thread& follower : followers)
+        follower.join();
+    for (const std::shared_ptr<int>& value : received)
+    {
+        REQUIRE(value);
+        CHECK_EQ(*value, 42);
+    }
+    RequestCoalescerStats stats = coalescer.GetStats();
+    CHECK_EQ(stats.exactFollowers, uint64_t(3));
+    CHECK_EQ(stats.sharedValues, uint64_t(1));
+}
+
+TEST_CASE(SmallerRequestFollowsTheSmallestLargerFlight)
+{
+    Coalescer coalescer;
+    bool leader = false;
+    Coalescer::FlightPtr big = coalescer.Join("file", 256, true, &leader);
+    Coalescer::FlightPtr medium = coalescer.Join("file", 128, false, &leader);
+    REQUIRE(leader);
+
+    Coalescer::FlightPtr small = coalescer.Join("file", 96, true, &leader);
+    CHECK(!leader);
+    CHECK(small == medium);
+
+    // Without allowLarger (previews) only an exact match is shared
+    coalescer.Join("file", 64, false, &leader);
+    CHECK(leader);
+    // Larger requests never follow smaller flights, and other groups are separate
+    coalescer.Join("file", 512, true, &leader);
+    CHECK(leader);
+    coalescer.Join("other", 96, true, &leader);
+    CHECK(leader);
+
+    CHECK_EQ(coalescer.GetStats().largerFollowers, uint64_t(1));
+    coalescer.Finish(big, nullptr);
+    coalescer.Finish(medium, []() { return std::make_shared<int>(128); });
+    CHECK_EQ(*coalescer.Wait(small), 128);
+}
+
+// Many threads request the same few items at once; every item is extracted exactly once per
+// flight and every caller gets the value of the flight it joined.
+TEST_CASE(ConcurrentRequestsRunOncePerFlight)
+{
+    Coalescer coalescer;
+    const int threads = 8;
+    const int rounds = 300;
+    std::atomic<int> extractions(0);
+    std::atomic<int> mismatches(0);
+    std::atomic<int> ready(0);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&, t]()
+        {
+            ++ready;
+            while (ready < threads)
+                std::this_thread::yield();
+            for (int round = 0; round < rounds; ++round)
+            {
+                std::string key = "item" + std::to_string(round % 4);
+                uint32_t size = (t % 2) ? 96 : 256;
+                bool leader = false;
+                Coalescer::FlightPtr flight = coalescer.Join(key, size, true, &leader);
+                int expected = static_cast<int>(flight->Size());
+                if (leader)
+                {
+                    ++extractions;
+                    std::this_thread::yield();
+                    coalescer.Finish(flight, [expected]() { return std::make_shared<int>(expected); });
+                }
+                else
+                {
+                    std::shared_ptr<int> value = coalescer.Wait(flight);
+                    if (!value || *value != expected || *value < static_cast<int>(size))
+                        ++mismatches;
+                }
+            }
+        });
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+
+    RequestCoalescerStats stats = coalescer.GetStats();
+    CHECK_EQ(mismatches.load(), 0);
+    CHECK_EQ(static_cast<uint64_t>(extractions.load()), stats.leaders);
+    CHECK_EQ(stats.leaders + stats.exactFollowers + stats.largerFollowers, uint64_t(threads * rounds));
+}
@@ -0,0 +1,70 @@
+#include "Benchmark.h"
+#include "RequestScheduler.h"
+#include <string>
+#include <vector>
+
+// Simulated folder view: every item is queued as Background in directory order, then the user
+// scrolls to the end and the last screen is boosted. Jobs take 5 ms on the simulated clock.
+// Reports when the first and the last visible thumbnails are done with and without the viewport
+// boost, and the real cost of the scheduler per request.
+namespace
+{
+    const uint64_t JOB_MS = 5;
+    const int VISIBLE = 40;
+
+    struct VisibleTimes
+    {
+        uint64_t first = 0;
+        uint64_t last = 0;
+    };
+
+    VisibleTimes TimeToVisible(int items, bool boost, double* schedulerUsPerRequest)
+    {
+        RequestScheduler<int> scheduler;
+        uint64_t now = 0;
+        scheduler.SetClock([&now]() { return now; });
+        int visibleLeft = VISIBLE;
+        VisibleTimes times;
+
+        BenchmarkTimer timer;
+        std::vector<RequestScheduler<int>::RequestId> ids;
+        for (int i = 0; i < items; ++i)
+        {
+            bool visible = i >= items - VISIBLE;
+            ids.push_back(scheduler.Submit("item" + std::to_string(i), RequestPriority::Background,
+                [&, visible]()
+                {
+                    now += JOB_MS;
+                    if (visible && visibleLeft-- == VISIBLE)
+                        times.first = now;
+                    if (visible && visibleLeft == 0)
+                        times.last = now;
+                    return 0;
+                }, nullptr));
+        }
+        if (boost)
+            scheduler.SetViewport(ids.data() + items - VISIBLE, VISIBLE);
+        while (scheduler.RunNext())
+        {
+        }
+        *schedulerUsPerRequest = timer.Milliseconds() * 1000.0 / items;
+        return times;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int items = static_cast<int>(5000 * BenchmarkScale(argc, argv));
+    double fifoUs = 0;
+    double boostedUs = 0;
+    VisibleTimes fifo = TimeToVisible(items, false, &fifoUs);
+    VisibleTimes boosted = TimeToVisible(items, true, &boostedUs);
+
+    ReportResult("items", items, "");
+    ReportResult("first visible thumbnail, FIFO", static_cast<double>(fifo.first), "ms (simulated)");
+    ReportResult("first visible thumbnail, viewport boost", static_cast<double>(boosted.first), "ms (simulated)");
+    ReportResult("last visible thumbnail, FIFO", static_cast<double>(fifo.last), "ms (simulated)");
+    ReportResult("last visible thumbnail, viewport boost", static_cast<double>(boosted.last), "ms (simulated)");
+    ReportResult("scheduler overhead", boostedUs, "us/request");
+    return 0;
+}
@@ -0,0 +1,280 @@
+#include "TestHarness.h"
+#include "RequestScheduler.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace
+{
+    typedef RequestScheduler<int> Scheduler;
+
+    // Scheduler driven by RunNext() on the test thread with a manual clock
+    struct Simulation
+    {
+        Scheduler scheduler;
+        uint64_t now = 1000;
+        std::vector<std::string> order;
+
+        Simulation()
+        {
+            scheduler.SetClock([this]() { return now; });
+        }
+
+        Scheduler::RequestId Submit(const std::string& key, RequestPriority priority, uint64_t deadlineMs = 0)
+        {
+            return scheduler.Submit(key, priority, [this, key]() { order.push_back(key); return 0; }, nullptr, deadlineMs);
+        }
+
+        void RunAll()
+        {
+            while (scheduler.RunNext())
+            {
+            }
+        }
+    };
+}
+
+TEST_CASE(HigherClassRunsFirstAndFifoWithinAClass)
+{
+    Simulation sim;
+    sim.Submit("bg1", RequestPriority::Background);
+    sim.Submit("n1", RequestPriority::Normal);
+    sim.Submit("v1", RequestPriority::Visible);
+    sim.Submit("n2", RequestPriority::Normal);
+    sim.Submit("v2", RequestPriority::Visible);
+    CHECK_EQ(sim.scheduler.PendingCount(), size_t(5));
+
+    sim.RunAll();
+    CHECK(sim.order == std::vector<std::string>({ "v1", "v2", "n1", "n2", "bg1" }));
+    CHECK_EQ(sim.scheduler.PendingCount(), size_t(0));
+    CHECK(!sim.scheduler.RunNext());
+}
+
+TEST_CASE(ViewportBoostsAndDemotesRequests)
+{
+    Simulation sim;
+    Scheduler::RequestId a = sim.Submit("a", RequestPriority::Background);
+    Scheduler::RequestId b = sim.Submit("b", RequestPriority::Normal);
+    sim.Submit("c", RequestPriority::Normal);
+
+    sim.scheduler.SetViewport(&a, 1);
+    REQUIRE(sim.scheduler.RunNext());
+    CHECK_EQ(sim.order.back(), std::string("a"));
+
+    // b is boosted and scrolled out again: back in Normal it keeps its place ahead of c
+    sim.scheduler.SetViewport(&b, 1);
+    sim.scheduler.SetViewport(nullptr, 0);
+    sim.RunAll();
+    CHECK(sim.order == std::vector<std::string>({ "a", "b", "c" }));
+}
+
+TEST_CASE(AgingPromotesStarvedRequests)
+{
+    Simulation sim;
+    sim.scheduler.SetAgingLimit(RequestPriority::Background, 500);
+    sim.Submit("old", RequestPriority::Background);
+
+    sim.now += 600;
+    sim.Submit("fresh", RequestPriority::Normal);
+    REQUIRE(sim.scheduler.RunNext());
+    // Promoted to Normal, where it is older than the fresh request
+    CHECK_EQ(sim.order.back(), std::string("old"));
+    CHECK_EQ(sim.scheduler.GetStats().agingPromotions, uint64_t(1));
+}
+
+TEST_CASE(AgingIsNotBlockedByAnItemJustDemotedFromTheViewport)
+{
+    Simulation sim;
+    sim.scheduler.SetAgingLimit(RequestPriority::Background, 500);
+    Scheduler::RequestId scrolled = sim.Submit("scrolled", RequestPriority::Background);
+    sim.Submit("waiter", RequestPriority::Background);
+    sim.scheduler.SetViewport(&scrolled, 1);
+
+    // Back in Background with a fresh enter time, but still first in FIFO order
+    sim.now += 400;
+    sim.scheduler.SetViewport(nullptr, 0);
+
+    sim.now += 200;
+    sim.Submit("fresh", RequestPriority::Normal);
+    REQUIRE(sim.scheduler.RunNext());
+    CHECK_EQ(sim.order.back(), std::string("waiter"));
+    CHECK_EQ(sim.scheduler.GetStats().agingPromotions, uint64_t(1));
+
+    sim.RunAll();
+    CHECK_EQ(sim.order.back(), std::string("scrolled"));
+    CHECK_EQ(sim.scheduler.PendingCount(), size_t(0));
+}
+
+TEST_CASE(OverdueDeadlineIsPickedBeforeAnythingElse)
+{
+    Simulation sim;
+    sim.Submit("v", RequestPriority::Visible);
+    sim.Submit("late", RequestPriority::Background, 50);
+
+    REQUIRE(sim.scheduler.RunNext());
+    CHECK_EQ(sim.order.back(), std::string("v"));
+
+    sim.Submit("v2", RequestPriority::Visible);
+    sim.now += 51;
+    REQUIRE(sim.scheduler.RunNext());
+    CHECK_EQ(sim.order.back(), std::string("late"));
+    CHECK_EQ(sim.scheduler.GetStats().deadlinePicks, uint64_t(1));
+}
+
+TEST_CASE(DuplicateSubmitsShareOneRunAndEverySubscriberIsCalled)
+{
+    Scheduler scheduler;
+    int runs = 0;
+    std::vector<Scheduler::RequestId> completed;
+    auto job = [&runs]() { return ++runs * 10; };
+    auto completion = [&completed](Scheduler::RequestId id, const int& result)
+    {
+        CHECK_EQ(result, 10);
+        completed.push_back(id);
+    };
+
+    Scheduler::RequestId a = scheduler.Submit("k", RequestPriority::Normal, job, completion);
+    Scheduler::RequestId b = scheduler.Submit("k", RequestPriority::Background, job, completion);
+    CHECK(a != b);
+    CHECK_EQ(scheduler.PendingCount(), size_t(1));
+    scheduler.RunNext();
+
+    CHECK_EQ(runs, 1);
+    CHECK(completed == std::vector<Scheduler::RequestId>({ a, b }));
+    RequestSchedulerStats stats = scheduler.GetStats();
+    CHECK_EQ(stats.submitted, uint64_t(2));
+    CHECK_EQ(stats.deduplicated, uint64_t(1));
+    CHECK_EQ(stats.executed, uint64_t(1));
+    CHECK_EQ(stats.completedByClass[1], uint64_t(1));
+    CHECK_EQ(stats.completedByClass[2], uint64_t(1));
+}
+
+TEST_CASE(DuplicateWithHigherPriorityMovesThePendingItemUp)
+{
+    Simulation sim;
+    sim.Submit("first", RequestPriority::Normal);
+    sim.Submit("dup", RequestPriority::Background);
+    sim.Submit("dup", RequestPriority::Visible);
+    REQUIRE(sim.scheduler.RunNext());
+    CHECK_EQ(sim.order.back(), std::string("dup"));
+}
+
+TEST_CASE(DuplicateWithHigherPriorityOutlivesTheViewport)
+{
+    Simulation sim;
+    Scheduler::RequestId dup = sim.Submit("dup", RequestPriority::Background);
+    sim.Submit("dup", RequestPriority::Normal);
+    sim.Submit("bg", RequestPriority::Background);
+
+    // Boost and drop: the item returns to Normal (its best subscriber), not Background
+    sim.scheduler.SetViewport(&dup, 1);
+    sim.scheduler.SetViewport(nullptr, 0);
+    sim.Submit("normal", RequestPriority::Normal);
+    sim.RunAll();
+    CHECK(sim.order == std::vector<std::string>({ "dup", "normal", "bg" }));
+}
+
+TEST_CASE(DuplicateWithDeadlineOfARunningItemDoesNotRunItTwice)
+{
+    Scheduler scheduler;
+    uint64_t now = 1000;
+    scheduler.SetClock([&now]() { return now; });
+
+    int runs = 0;
+    int completions = 0;
+    auto completion = [&completions](Scheduler::RequestId, const int&) { ++completions; };
+    // The job joins a duplicate with a deadline while it runs, then the deadline passes
+    auto job = [&]()
+    {
+        ++runs;
+        scheduler.Submit("k", RequestPriority::Visible, []() { return 0; }, completion, 10);
+        now += 100;
+        return 0;
+    };
+    scheduler.Submit("k", RequestPriority::Normal, job, completion);
+
+    REQUIRE(scheduler.RunNext());
+    CHECK(!scheduler.RunNext());
+    CHECK_EQ(runs, 1);
+    CHECK_EQ(completions, 2);
+    CHECK_EQ(scheduler.GetStats().deadlinePicks, uint64_t(0));
+}
+
+TEST_CASE(DeadlineIsDroppedWhenTheItemRuns)
+{
+    Simulation sim;
+    sim.Submit("a", RequestPriority::Visible, 10);
+    REQUIRE(sim.scheduler.RunNext());
+
+    // A new item with the same key is a new request; the old deadline must not pick it
+    sim.now += 100;
+    sim.Submit("b", RequestPriority::Visible);
+    sim.Submit("a", RequestPriority::Background);
+    sim.RunAll();
+    CHECK(sim.order == std::vector<std::string>({ "a", "b", "a" }));
+    CHECK_EQ(sim.scheduler.GetStats().deadlinePicks, uint64_t(0));
+}
+
+TEST_CASE(CancelDropsTheJobOnlyWhenNobodyElseWaits)
+{
+    Simulation sim;
+    Scheduler::RequestId a = sim.Submit("k", RequestPriority::Normal, 10);
+    Scheduler::RequestId b = sim.Submit("k", RequestPriority::Normal);
+
+    CHECK(sim.scheduler.Cancel(a));
+    CHECK(!sim.scheduler.Cancel(a));
+    CHECK_EQ(sim.scheduler.PendingCount(), size_t(1));
+    CHECK(sim.scheduler.Cancel(b));
+    CHECK_EQ(sim.scheduler.PendingCount(), size_t(0));
+
+    // The cancelled item's deadline is gone with it
+    sim.now += 100;
+    CHECK(!sim.scheduler.RunNext());
+    CHECK(sim.order.empty());
+    CHECK_EQ(sim.scheduler.GetStats().cancelled, uint64_t(2));
+}
+
+TEST_CASE(WorkersRunEverySubmittedJob)
+{
+    Scheduler scheduler;
+    std::atomic<int> runs(0);
+    std::atomic<int> completions(0);
+    const int count = 200;
+    for (int i = 0; i < count; ++i)
+    {
+        scheduler.Submit(std::to_string(i % 150), static_cast<RequestPriority>(i % 3),
+                         [&runs]() { ++runs; return 0; },
+                         [&completions](Scheduler::RequestId, const int&) { ++completions; });
+    }
+    scheduler.Start(4);
+    CHECK(TestHarness::WaitUntil([&]() { return completions == count; }, 10000));
+    scheduler.Stop();
+
+    RequestSchedulerStats stats = scheduler.GetStats();
+    CHECK_EQ(static_cast<uint64_t>(runs.load()), stats.executed);
+    CHECK_EQ(stats.executed + stats.deduplicated, uint64_t(count));
+}
+
+// A folder view: 200 thumbnails queued as Background in directory order, the user scrolls to
+// the end and the 20 visible ones are boosted. They all finish before any off-screen request.
+TEST_CASE(VisibleItemsFinishFirstAfterScrolling)
+{
+    Simulation sim;
+    std::vector<Scheduler::RequestId> ids;
+    for (int i = 0; i < 200; ++i)
+        ids.push_back(sim.Submit("item" + std::to_string(i), RequestPriority::Background));
+
+    sim.scheduler.SetViewport(ids.data() + 180, 20);
+    for (int i = 0; i < 20; ++i)
+    {
+        REQUIRE(sim.scheduler.RunNext());
+        sim.now += 5;
+    }
+    for (int i = 0; i < 20; ++i)
+        CHECK_EQ(sim.order[i], "item" + std::to_string(180 + i));
+
+    RequestSchedulerStats stats = sim.scheduler.GetStats();
+    CHECK_EQ(stats.completedByClass[2], uint64_t(20));
+    // The k-th visible thumbnail waited for k jobs of 5 ms
+    CHECK_EQ(stats.totalWaitMsByClass[2], uint64_t(5 * 19 * 20 / 2));
+}
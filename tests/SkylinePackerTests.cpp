@@ -0,0 +1,71 @@
+#include "TestHarness.h"
+#include "SkylinePacker.h"
+#include <random>
+
+namespace
+{
+    bool Overlaps(const AtlasRect& a, const AtlasRect& b)
+    {
+        return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+    }
+}
+
+TEST_CASE(RectanglesStayInsideAndNeverOverlap)
+{
+    SkylinePacker packer(512, 512);
+    std::mt19937 random(1);
+    std::vector<AtlasRect> placed;
+    for (int i = 0; i < 2000; ++i)
+    {
+        AtlasRect rect;
+        if (!packer.Insert(8 + random() % 56, 8 + random() % 56, &rect))
+            continue;
+        CHECK(rect.x + rect.width <= 512 && rect.y + rect.height <= 512);
+        for (const AtlasRect& other : placed)
+            REQUIRE(!Overlaps(rect, other));
+        placed.push_back(rect);
+    }
+    CHECK(placed.size() > 100);
+    CHECK(packer.Occupancy() > 0.75);
+}
+
+TEST_CASE(EqualTilesFillThePageRowByRow)
+{
+    SkylinePacker packer(256, 128);
+    AtlasRect rect;
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        REQUIRE(packer.Insert(64, 64, &rect));
+        CHECK_EQ(rect.x, (i % 4) * 64);
+        CHECK_EQ(rect.y, (i / 4) * 64);
+    }
+    CHECK(!packer.Insert(1, 1, &rect));
+    CHECK_EQ(packer.UsedHeight(), uint32_t(128));
+    CHECK_EQ(packer.Occupancy(), 1.0);
+}
+
+TEST_CASE(LowestPlacementFillsGapsFirst)
+{
+    SkylinePacker packer(100, 100);
+    AtlasRect tall, shortRect, filler;
+    REQUIRE(packer.Insert(50, 80, &tall));
+    REQUIRE(packer.Insert(50, 20, &shortRect));
+    CHECK_EQ(shortRect.x, uint32_t(50));
+    // The hole under the short rectangle's top is the lowest place for another one
+    REQUIRE(packer.Insert(50, 30, &filler));
+    CHECK_EQ(filler.x, uint32_t(50));
+    CHECK_EQ(filler.y, uint32_t(20));
+    CHECK_EQ(packer.UsedHeight(), uint32_t(80));
+}
+
+TEST_CASE(OversizedOrEmptyRectanglesAreRejected)
+{
+    SkylinePacker packer(64, 32);
+    AtlasRect rect;
+    CHECK(!packer.Insert(65, 1, &rect));
+    CHECK(!packer.Insert(1, 33, &rect));
+    CHECK(!packer.Insert(0, 5, &rect));
+    CHECK(packer.Insert(64, 32, &rect));
+    CHECK(!packer.Insert(1, 1, &rect));
+    CHECK_EQ(SkylinePacker(10, 10).Occupancy(), 0.0);
+}
@@ -0,0 +1,176 @@
+#include "FramePattern.h"
+#include "FrameRing.h"
+#include "WorkerChannel.h"
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// Worker process for the IPC and worker pool tests. Job kinds (StubJob in WorkerPoolTests.cpp):
+//   0 pattern image of width x height, 1 fail with a status, 2 crash, 3 hang inside the job,
+//   4 succeed and then freeze while idle, 5 echo the path as one row of pixels,
+//   6 exit without answering, 7 ask for more pixels than the channel holds
+// Without a channel it runs as a plain child process:
+//   StubWorker exit <code> | StubWorker sleep (anything after that is ignored)
+// or as one end of a frame ring carrying FramePattern frames (FrameRingTests.cpp):
+//   StubWorker ring-read <name> <frames> [holdUs]  checks each frame, holding it holdUs first
+//   StubWorker ring-write <name> <frames>          creates the ring and waits until it is drained
+//   StubWorker ring-drain <name> <frames>          reads every pixel unchecked (FrameRingBenchmark)
+//   Exit codes: 0 ok, 3 cannot open or create, 4 timed out, 5 out of sequence, 6 wrong pixels
+namespace
+{
+    const uint32_t RING_TIMEOUT_MS = 10000;
+
+    int ReadRing(const std::string& name, uint64_t frames, uint32_t holdUs, bool check)
+    {
+        std::unique_ptr<FrameRingReader> reader;
+        for (int attempt = 0; attempt < 500 && !reader; ++attempt)
+        {
+            reader = FrameRingReader::Open(name);
+            if (!reader)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (!reader)
+            return 3;
+
+        // A restarted reader starts wherever the last one stopped
+        RingFrame frame;
+        uint64_t expected = 0;
+        for (uint64_t i = 0; i < frames; ++i)
+        {
+            if (!reader->AcquireFrame(RING_TIMEOUT_MS, &frame))
+                return 4;
+            if (i > 0 && frame.sequence != expected)
+                return 5;
+            expected = frame.sequence + 1;
+            if (!check)
+            {
+                // Read in place, as a consumer blitting the frame would
+                uint64_t sum = 0;
+                for (size_t offset = 0; offset + 8 <= frame.stride * frame.height; offset += 8)
+                {
+                    uint64_t word;
+                    memcpy(&word, frame.pixels + offset, 8);
+                    sum += word;
+                }
+                volatile uint64_t sink = sum;
+                (void)sink;
+                continue;
+            }
+            if (holdUs)
+                std::this_thread::sleep_for(std::chrono::microseconds(holdUs));
+            if (!FramePattern::Matches(frame.sequence, frame.pixels, frame.width, frame.height, frame.stride, frame.alpha))
+                return 6;
+        }
+        reader->ReleaseFrame();
+        return 0;
+    }
+
+    int WriteRing(const std::string& name, uint64_t frames)
+    {
+        std::unique_ptr<FrameRingWriter> writer = FrameRingWriter::Create(name, 3, FramePattern::SLOT_BYTES);
+        if (!writer)
+            return 3;
+        for (uint64_t sequence = 0; sequence < frames; ++sequence)
+        {
+            uint32_t width, height;
+            FramePattern::Size(sequence, &width, &height);
+            uint8_t* pixels = writer->BeginFrame(width, height, RING_TIMEOUT_MS);
+            if (!pixels)
+                return 4;
+            FramePattern::Fill(sequence, pixels);
+            if (writer->PublishFrame(FramePattern::Alpha(sequence)) != sequence)
+                return 5;
+        }
+        // The name goes away with the writer; let the reader finish first
+        for (uint32_t waited = 0; writer->Pending() > 0; waited += 5)
+        {
+            if (waited >= RING_TIMEOUT_MS)
+                return 4;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return 0;
+    }
+
+    int32_t RunJob(const WorkerJob& job, WorkerImageWriter& output)
+    {
+        switch (job.kind)
+        {
+        case 0:
+        {
+            uint8_t* pixels = output.Begin(job.width, job.height, AlphaMode::Straight);
+            if (!pixels)
+                return -6;
+            for (uint32_t y = 0; y < job.height; ++y)
+            {
+                for (uint32_t x = 0; x < job.width; ++x, pixels += 4)
+                {
+                    pixels[0] = static_cast<uint8_t>(x);
+                    pixels[1] = static_cast<uint8_t>(y);
+                    pixels[2] = static_cast<uint8_t>(job.path.size());
+                    pixels[3] = static_cast<uint8_t>(x ^ y);
+                }
+            }
+            return 0;
+        }
+        case 1:
+            return -5;
+        case 2:
+            raise(SIGSEGV);
+            return 0;
+        case 3:
+            for (;;)
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+        case 4:
+            std::thread([]()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                raise(SIGSTOP);
+            }).detach();
+            return 0;
+        case 5:
+        {
+            uint32_t width = static_cast<uint32_t>((job.path.size() + 3) / 4);
+            uint8_t* pixels = output.Begin(width ? width : 1, 1, AlphaMode::Ignore);
+            if (!pixels)
+                return -6;
+            memcpy(pixels, job.path.data(), job.path.size());
+            return static_cast<int32_t>(job.path.size());
+        }
+        case 6:
+            _exit(0);
+        case 7:
+            return output.Begin(static_cast<uint32_t>(output.Capacity() / 4) + 1, 1, AlphaMode::Ignore) ? 0 : -6;
+        default:
+            return -1;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    // Crashes are expected here; keep them from writing core files
+    rlimit noCore = { 0, 0 };
+    setrlimit(RLIMIT_CORE, &noCore);
+
+    if (argc >= 3 && strcmp(argv[1], "exit") == 0)
+        return atoi(argv[2]);
+    if (argc >= 2 && strcmp(argv[1], "sleep") == 0)
+    {
+        for (;;)
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    if (argc >= 4 && strcmp(argv[1], "ring-read") == 0)
+        return ReadRing(argv[2], strtoull(argv[3], nullptr, 10), argc >= 5 ? static_cast<uint32_t>(atoi(argv[4])) : 0, true);
+    if (argc >= 4 && strcmp(argv[1], "ring-drain") == 0)
+        return ReadRing(argv[2], strtoull(argv[3], nullptr, 10), 0, false);
+    if (argc >= 4 && strcmp(argv[1], "ring-write") == 0)
+        return WriteRing(argv[2], strtoull(argv[3], nullptr, 10));
+    if (argc < 2)
+        return 2;
+    return RunWorkerProcess(argv[argc - 1], RunJob);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "ImageOps.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+// Inputs shared by the encoder tests and benchmarks, and whole-file reads and writes for tests
+// that inspect or damage what a writer left on disk.
+namespace TestData
+{
+    // Gradients, hard edges and blocks of noise, so every PNG filter type gets picked somewhere
+    // and parts of the image differ in how well they compress. Premultiplied images keep every
+    // channel at or below alpha.
+    inline PixelImage Scene(uint32_t width, uint32_t height, AlphaMode alpha, uint32_t seed)
+    {
+        PixelImage image;
+        image.Allocate(width, height);
+        image.alpha = alpha;
+        std::mt19937 random(seed);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            uint8_t* p = image.Row(y);
+            for (uint32_t x = 0; x < width; ++x, p += 4)
+            {
+                bool noisy = (x / 24 + y / 24) % 5 == 0;
+                uint8_t a = static_cast<uint8_t>(alpha == AlphaMode::Ignore ? 255 : (x * 2 + y) % 256);
+                for (int c = 0; c < 3; ++c)
+                {
+                    uint8_t value = static_cast<uint8_t>(noisy ? random() : ((x / 16) ^ (y / 16)) & 1 ? 200 - c * 30 : x + y * c);
+                    p[c] = alpha == AlphaMode::Premultiplied ? static_cast<uint8_t>(value * a / 255) : value;
+                }
+                p[3] = a;
+            }
+        }
+        return image;
+    }
+
+    inline std::vector<uint8_t> ReadFile(const std::filesystem::path& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+
+    inline void WriteFile(const std::filesystem::path& path, const std::vector<uint8_t>& data)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Minimal self-registering test runner for the portable modules. Each tests/XxxTests.cpp is one
+// executable and one ctest entry. A failed CHECK reports and the test goes on; a failed REQUIRE
+// ends the current test. Arguments filter tests by substring of their name.
+
+namespace TestHarness
+{
+    typedef void (*TestFunction)();
+
+    struct TestCase
+    {
+        const char* name;
+        TestFunction function;
+    };
+
+    std::vector<TestCase>& Registry();
+
+    struct Registrar
+    {
+        Registrar(const char* name, TestFunction function) { Registry().push_back(TestCase{ name, function }); }
+    };
+
+    // Thrown by REQUIRE; caught by the runner
+    struct RequireFailed
+    {
+    };
+
+    void Fail(const char* file, int line, const std::string& message);
+
+    template <typename T, typename = void>
+    struct Printable : std::false_type
+    {
+    };
+
+    template <typename T>
+    struct Printable<T, decltype(void(std::declval<std::ostream&>() << std::declval<const T&>()))> : std::true_type
+    {
+    };
+
+    template <typename T>
+    std::string Format(const T& value)
+    {
+        if constexpr (std::is_enum<T>::value)
+        {
+            return std::to_string(static_cast<long long>(value));
+        }
+        else if constexpr (std::is_same<T, uint8_t>::value || std::is_same<T, int8_t>::value)
+        {
+            return std::to_string(static_cast<int>(value));
+        }
+        else if constexpr (Printable<T>::value)
+        {
+            std::ostringstream text;
+            text << value;
+            return text.str();
+        }
+        else
+        {
+            return "(unprintable)";
+        }
+    }
+
+    template <typename A, typename B>
+    std::string DescribeEqual(const char* actualText, const char* expectedText, const A& actual, const B& expected)
+    {
+        return std::string(actualText) + " == " + expectedText + " (" + Format(actual) + " vs " + Format(expected) + ")";
+    }
+
+    // Unique directory under the system temp directory, removed with everything in it
+    class TempDirectory
+    {
+    public:
+        TempDirectory();
+        ~TempDirectory();
+
+        TempDirectory(const TempDirectory&) = delete;
+        TempDirectory& operator=(const TempDirectory&) = delete;
+
+        const std::filesystem::path& Path() const { return m_path; }
+        std::filesystem::path operator/(const std::string& name) const { return m_path / name; }
+
+    private:
+        std::filesystem::path m_path;
+    };
+
+    // Name unique to this process and call, for shared-memory and semaphore objects
+    std::string UniqueName(const char* prefix);
+
+    // Polls condition every millisecond until it holds or timeoutMs passes
+    template <typename Condition>
+    bool WaitUntil(Condition condition, int timeoutMs)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (!condition())
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return condition();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+}
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static TestHarness::Registrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+            TestHarness::Fail(__FILE__, __LINE__, #condition); \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) \
+    do \
+    { \
+        const auto checkActual = (actual); \
+        const auto checkExpected = (expected); \
+        if (!(checkActual == checkExpected)) \
+            TestHarness::Fail(__FILE__, __LINE__, TestHarness::DescribeEqual(#actual, #expected, checkActual, checkExpected)); \
+    } while (0)
+
+#define REQUIRE(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            TestHarness::Fail(__FILE__, __LINE__, #condition); \
+            throw TestHarness::RequireFailed(); \
+        } \
+    } while (0)
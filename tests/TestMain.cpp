@@ -0,0 +1,105 @@
+#include "TestHarness.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <random>
+
+#if defined(_WIN32)
+#include <process.h>
+#define TEST_PROCESS_ID _getpid()
+#else
+#include <unistd.h>
+#define TEST_PROCESS_ID getpid()
+#endif
+
+namespace
+{
+    int g_failures = 0;
+
+    bool Selected(const char* name, int argc, char** argv)
+    {
+        if (argc < 2)
+            return true;
+        for (int i = 1; i < argc; ++i)
+        {
+            if (strstr(name, argv[i]))
+                return true;
+        }
+        return false;
+    }
+}
+
+namespace TestHarness
+{
+    std::vector<TestCase>& Registry()
+    {
+        static std::vector<TestCase> tests;
+        return tests;
+    }
+
+    void Fail(const char* file, int line, const std::string& message)
+    {
+        g_failures++;
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, message.c_str());
+    }
+
+    std::string UniqueName(const char* prefix)
+    {
+        static std::atomic<uint32_t> counter{ 0 };
+        return std::string(prefix) + std::to_string(TEST_PROCESS_ID) + "_" + std::to_string(counter++);
+    }
+
+    TempDirectory::TempDirectory()
+    {
+        std::random_device random;
+        for (;;)
+        {
+            m_path = std::filesystem::temp_directory_path() / (UniqueName("wsp_test_") + "_" + std::to_string(random()));
+            if (std::filesystem::create_directory(m_path))
+                break;
+        }
+    }
+
+    TempDirectory::~TempDirectory()
+    {
+        std::error_code ignored;
+        std::filesystem::remove_all(m_path, ignored);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int failedTests = 0;
+    int run = 0;
+    for (const TestHarness::TestCase& test : TestHarness::Registry())
+    {
+        if (!Selected(test.name, argc, argv))
+            continue;
+
+        run++;
+        printf("[ RUN  ] %s\n", test.name);
+        fflush(stdout);
+        int before = g_failures;
+        try
+        {
+            test.function();
+        }
+        catch (const TestHarness::RequireFailed&)
+        {
+        }
+        catch (const std::exception& e)
+        {
+            TestHarness::Fail(__FILE__, __LINE__, std::string("unexpected exception: ") + e.what());
+        }
+
+        bool passed = g_failures == before;
+        if (!passed)
+            failedTests++;
+        printf("[ %s ] %s\n", passed ? " OK " : "FAIL", test.name);
+        fflush(stdout);
+    }
+
+    printf("%d of %d tests passed\n", run - failedTests, run);
+    return failedTests == 0 && run > 0 ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+#include "TestHarness.h"
+#include "TextCodec.h"
+#include <cstdint>
+#include <string>
+
+namespace
+{
+    // Straightforward encoders, one code point at a time, to compare the fast paths with
+    void AppendUtf8(uint32_t cp, std::string* out)
+    {
+        if (cp < 0x80)
+        {
+            out->push_back(static_cast<char>(cp));
+        }
+        else if (cp < 0x800)
+        {
+            out->push_back(static_cast<char>(0xc0 | (cp >> 6)));
+            out->push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+        }
+        else if (cp < 0x10000)
+        {
+            out->push_back(static_cast<char>(0xe0 | (cp >> 12)));
+            out->push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+            out->push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+        }
+        else
+        {
+            out->push_back(static_cast<char>(0xf0 | (cp >> 18)));
+            out->push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+            out->push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+            out->push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+        }
+    }
+
+    void AppendUtf16(uint32_t cp, std::u16string* out)
+    {
+        if (cp < 0x10000)
+        {
+            out->push_back(static_cast<char16_t>(cp));
+        }
+        else
+        {
+            out->push_back(static_cast<char16_t>(0xd800 + ((cp - 0x10000) >> 10)));
+            out->push_back(static_cast<char16_t>(0xdc00 + ((cp - 0x10000) & 0x3ff)));
+        }
+    }
+
+    std::string Bytes(std::initializer_list<int> bytes)
+    {
+        std::string text;
+        for (int b : bytes)
+            text.push_back(static_cast<char>(b));
+        return text;
+    }
+}
+
+TEST_CASE(EveryCodePointRoundTrips)
+{
+    // In blocks, so ASCII and multi-byte runs meet at all sorts of offsets
+    for (uint32_t first = 0; first <= 0x10ffff; first += 0x1000)
+    {
+        std::string utf8;
+        std::u16string utf16;
+        for (uint32_t cp = first; cp < first + 0x1000; ++cp)
+        {
+            if (cp >= 0xd800 && cp <= 0xdfff)
+                continue;
+            AppendUtf8(cp, &utf8);
+            AppendUtf16(cp, &utf16);
+            // An ASCII letter after every code point
+            AppendUtf8('a' + cp % 26, &utf8);
+            AppendUtf16('a' + cp % 26, &utf16);
+        }
+
+        std::u16string wide;
+        CHECK(Utf8ToUtf16(utf8.data(), utf8.size(), &wide));
+        CHECK(wide == utf16);
+        std::string narrow;
+        CHECK(Utf16ToUtf8(utf16.data(), utf16.size(), &narrow));
+        CHECK(narrow == utf8);
+    }
+}
+
+TEST_CASE(AsciiRunsOfEveryLengthAndOffset)
+{
+    // A non-ASCII character at each position of runs around the 8 and 16 unit SIMD blocks
+    for (size_t length = 0; length <= 70; ++length)
+    {
+        for (size_t at = 0; at <= length; ++at)
+        {
+            std::string utf8;
+            std::u16string utf16;
+            for (size_t i = 0; i < length; ++i)
+            {
+                uint32_t cp = i == at ? 0x00e9 + static_cast<uint32_t>(i) * 0x101 : 'A' + static_cast<uint32_t>(i % 50);
+                AppendUtf8(cp, &utf8);
+                AppendUtf16(cp, &utf16);
+            }
+            std::u16string wide;
+            CHECK(Utf8ToUtf16(utf8.data(), utf8.size(), &wide));
+            CHECK(wide == utf16);
+            std::string narrow;
+            CHECK(Utf16ToUtf8(utf16.data(), utf16.size(), &narrow));
+            CHECK(narrow == utf8);
+        }
+    }
+    CHECK(Utf8ToUtf16(std::string()).empty());
+    CHECK(Utf16ToUtf8(std::u16string()).empty());
+}
+
+TEST_CASE(InvalidUtf8BecomesReplacementCharacters)
+{
+    struct Case { std::string input; std::u16string expected; };
+    const Case cases[] = {
+        { Bytes({ 0x80 }), u"\xfffd" },                                     // Lone continuation
+        { Bytes({ 0xc0, 0x80 }), u"\xfffd\xfffd" },                         // Overlong NUL
+        { Bytes({ 0xc1, 0xbf }), u"\xfffd\xfffd" },
+        { Bytes({ 0xe0, 0x80, 0x80 }), u"\xfffd\xfffd\xfffd" },             // Overlong 3 bytes
+        { Bytes({ 0xf0, 0x80, 0x80, 0x80 }), u"\xfffd\xfffd\xfffd\xfffd" }, // Overlong 4 bytes
+        { Bytes({ 0xed, 0xa0, 0x80 }), u"\xfffd\xfffd\xfffd" },             // Encoded surrogate
+        { Bytes({ 0xf4, 0x90, 0x80, 0x80 }), u"\xfffd\xfffd\xfffd\xfffd" }, // Above U+10FFFF
+        { Bytes({ 0xf5, 'a' }), u"\xfffd" u"a" },
+        { Bytes({ 0xff, 0xfe }), u"\xfffd\xfffd" },
+        { Bytes({ 'x', 0xe2, 0x82 }), u"x\xfffd\xfffd" },                   // Truncated at the end
+        { Bytes({ 0xe2, 'y', 0xac }), u"\xfffd" u"y\xfffd" },               // Interrupted
+    };
+    for (const Case& c : cases)
+    {
+        std::u16string wide;
+        CHECK(!Utf8ToUtf16(c.input.data(), c.input.size(), &wide));
+        CHECK(wide == c.expected);
+    }
+
+    // Valid neighbours are untouched; the largest code point and U+FFFD itself are valid
+    std::u16string wide;
+    std::string text = "0123456789abcdef" + Bytes({ 0x80 }) + "0123456789abcdef" + Bytes({ 0xf4, 0x8f, 0xbf, 0xbf, 0xef, 0xbf, 0xbd });
+    CHECK(!Utf8ToUtf16(text.data(), text.size(), &wide));
+    CHECK(wide == u"0123456789abcdef\xfffd" u"0123456789abcdef\xdbff\xdfff\xfffd");
+    text = Bytes({ 0xf4, 0x8f, 0xbf, 0xbf });
+    CHECK(Utf8ToUtf16(text.data(), text.size(), &wide));
+}
+
+TEST_CASE(UnpairedSurrogatesBecomeReplacementCharacters)
+{
+    const std::string replacement = "\xef\xbf\xbd";
+    struct Case { std::u16string input; std::string expected; };
+    const Case cases[] = {
+        { u"\xd800", replacement },                                 // High at the end
+        { u"\xdc00", replacement },                                 // Low alone
+        { u"\xdc00\xd800", replacement + replacement },             // Reversed pair
+        { u"a\xd83d" u"b", "a" + replacement + "b" },
+        { u"\xd83d\xd83d\xde00", replacement + "\xf0\x9f\x98\x80" },
+    };
+    for (const Case& c : cases)
+    {
+        std::string narrow;
+        CHECK(!Utf16ToUtf8(c.input.data(), c.input.size(), &narrow));
+        CHECK(narrow == c.expected);
+    }
+
+    // Output replaces what was in the string before
+    std::string narrow = "leftover";
+    CHECK(Utf16ToUtf8(u"\x65e5\x672c", 2, &narrow));
+    CHECK(narrow == "\xe6\x97\xa5\xe6\x9c\xac");
+}
@@ -0,0 +1,136 @@
+#include "TestHarness.h"
+#include "ThrottleController.h"
+
+namespace
+{
+    const ThrottleSample IDLE = { 0.05, 0.0 };
+    const ThrottleSample BUSY_CPU = { 0.95, 0.0 };
+    const ThrottleSample BUSY_DISK = { 0.05, 8.0 };
+    const ThrottleSample UNKNOWN = { -1.0, -1.0 };
+}
+
+TEST_CASE(IdleSystemRunsWithoutDelay)
+{
+    ThrottleController throttle;
+    for (uint64_t t = 1000; t < 2000; t += 100)
+        CHECK_EQ(throttle.NextDelayMs(IDLE, t), uint32_t(0));
+    CHECK_EQ(throttle.Stats().delayedMs, uint64_t(0));
+
+    ThrottleController blind;
+    CHECK_EQ(blind.NextDelayMs(UNKNOWN, 1000), uint32_t(0));
+    CHECK(blind.SmoothedCpu() < 0.0);
+}
+
+TEST_CASE(LoadBacksOffExponentiallyUpToTheLimit)
+{
+    ThrottleConfig config;
+    config.smoothing = 1.0;
+    ThrottleController throttle(config);
+
+    uint32_t expected[] = { 50, 100, 200, 400, 800, 1600, 3200, 5000, 5000 };
+    for (uint32_t delay : expected)
+        CHECK_EQ(throttle.NextDelayMs(BUSY_CPU, 1000), delay);
+    CHECK_EQ(throttle.Stats().backoffs, uint64_t(9));
+
+    // Disk pressure alone backs off too
+    ThrottleController disk(config);
+    CHECK_EQ(disk.NextDelayMs(BUSY_DISK, 1000), uint32_t(50));
+}
+
+TEST_CASE(DelayDecaysOnceLoadDrops)
+{
+    ThrottleConfig config;
+    config.smoothing = 1.0;
+    ThrottleController throttle(config);
+    for (int i = 0; i < 4; ++i)
+        throttle.NextDelayMs(BUSY_CPU, 1000);      // 400 ms
+
+    // Between the marks the delay is held
+    ThrottleSample middle = { 0.5, 0.0 };
+    CHECK_EQ(throttle.NextDelayMs(middle, 1000), uint32_t(400));
+
+    CHECK_EQ(throttle.NextDelayMs(IDLE, 1000), uint32_t(200));
+    CHECK_EQ(throttle.NextDelayMs(IDLE, 1000), uint32_t(100));
+    CHECK_EQ(throttle.NextDelayMs(IDLE, 1000), uint32_t(50));
+    CHECK_EQ(throttle.NextDelayMs(IDLE, 1000), uint32_t(25));
+    CHECK_EQ(throttle.NextDelayMs(IDLE, 1000), uint32_t(0));
+}
+
+TEST_CASE(SmoothingIgnoresASingleSpike)
+{
+    ThrottleController throttle;
+    for (int i = 0; i < 10; ++i)
+        throttle.NextDelayMs(IDLE, 1000);
+    // 0.05 + (0.95 - 0.05) * 0.3 = 0.32: below the high mark
+    CHECK_EQ(throttle.NextDelayMs(BUSY_CPU, 1000), uint32_t(0));
+    CHECK(throttle.SmoothedCpu() > 0.3 && throttle.SmoothedCpu() < 0.33);
+    CHECK_EQ(throttle.NextDelayMs(IDLE, 1000), uint32_t(0));
+}
+
+TEST_CASE(ForegroundRequestsPauseBackgroundWork)
+{
+    ThrottleController throttle;
+    throttle.ForegroundBegin(10000);
+    CHECK_EQ(throttle.NextDelayMs(IDLE, 10100), uint32_t(2000));
+    throttle.ForegroundEnd(10500);
+
+    // Quiet period counts from the end of the last request
+    CHECK_EQ(throttle.NextDelayMs(IDLE, 11000), uint32_t(1500));
+    CHECK_EQ(throttle.NextDelayMs(IDLE, 12499), uint32_t(1));
+    CHECK_EQ(throttle.NextDelayMs(IDLE, 12500), uint32_t(0));
+    CHECK_EQ(throttle.Stats().foregroundYields, uint64_t(3));
+}
+
+TEST_CASE(ForegroundEndStampedAheadOfTheWorkerClockStillPauses)
+{
+    ThrottleController throttle;
+    throttle.ForegroundBegin(5000);
+    throttle.ForegroundEnd(5050);
+    // The worker read its clock just before the interactive thread did
+    CHECK_EQ(throttle.NextDelayMs(IDLE, 5040), uint32_t(2000));
+    CHECK_EQ(throttle.NextDelayMs(IDLE, 7049), uint32_t(1));
+}
+
+// Synthetic day: a pregeneration loop (10 ms of work per file) shares the machine with a user
+// who is busy for a while, leaves the CPU loaded by another program, and then goes idle.
+// Background work must stop while the user is active, stay out of the way under sustained load
+// and pick up again within seconds once the machine is idle.
+TEST_CASE(SyntheticLoadShapesTheBackgroundRate)
+{
+    ThrottleController throttle;
+    uint64_t now = 1;
+    uint64_t filesDuringForeground = 0, filesUnderLoad = 0, filesIdle = 0;
+
+    auto phase = [&](uint64_t durationMs, double cpu, bool userActive, uint64_t* files)
+    {
+        uint64_t end = now + durationMs;
+        uint64_t nextRequest = now;
+        while (now < end)
+        {
+            if (userActive && now >= nextRequest)
+            {
+                throttle.ForegroundBegin(now);
+                throttle.ForegroundEnd(now + 30);
+                nextRequest = now + 500;
+            }
+            uint32_t delay = throttle.NextDelayMs(ThrottleSample{ cpu, 0.2 }, now);
+            if (delay)
+            {
+                now += delay;
+                continue;
+            }
+            now += 10;
+            ++*files;
+        }
+    };
+
+    phase(60000, 0.3, true, &filesDuringForeground);
+    phase(60000, 0.9, false, &filesUnderLoad);
+    phase(60000, 0.1, false, &filesIdle);
+
+    CHECK_EQ(filesDuringForeground, uint64_t(0));
+    CHECK_EQ(filesUnderLoad, uint64_t(0));
+    // At most 6000 in a minute; the backoff built up under load decays within ~10 s
+    CHECK(filesIdle > 4500);
+    CHECK(throttle.Stats().backoffs > 0);
+}
@@ -0,0 +1,218 @@
+#include "TestHarness.h"
+#include "ThumbnailAtlas.h"
+#include "ReferenceCodecs.h"
+#include "TestData.h"
+
+namespace fs = std::filesystem;
+
+using TestData::ReadFile;
+
+namespace
+{
+    // Solid image whose colour encodes `index`, so every rectangle can be told apart
+    PixelImage Tile(uint32_t width, uint32_t height, uint32_t index, AlphaMode alpha = AlphaMode::Ignore, uint8_t a = 255)
+    {
+        PixelImage image;
+        image.Allocate(width, height);
+        image.alpha = alpha;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            uint8_t* p = image.Row(y);
+            for (uint32_t x = 0; x < width; ++x, p += 4)
+            {
+                p[0] = static_cast<uint8_t>(index * 37 + 150);     // Blue >= 144 stresses the fixed code
+                p[1] = static_cast<uint8_t>(x * 7 + index);
+                p[2] = static_cast<uint8_t>(y * 5);
+                p[3] = a;
+                if (alpha == AlphaMode::Premultiplied)
+                {
+                    for (int c = 0; c < 3; ++c)
+                        p[c] = static_cast<uint8_t>(p[c] * a / 255);
+                }
+            }
+        }
+        return image;
+    }
+
+    // Checks that `entry` in the decoded page shows `image`
+    bool PageShows(const Reference::DecodedPng& page, const ThumbnailAtlas::Entry& entry, const PixelImage& image)
+    {
+        for (uint32_t y = 0; y < image.height; ++y)
+        {
+            for (uint32_t x = 0; x < image.width; ++x)
+            {
+                uint8_t expected[4];
+                Reference::ExpectedRgba(image.Row(y) + x * 4, image.alpha, expected);
+                if (memcmp(expected, page.Pixel(entry.rect.x + x, entry.rect.y + y), 4) != 0)
+                    return false;
+            }
+        }
+        return true;
+    }
+}
+
+TEST_CASE(SavedPagesShowEveryImageAtItsRectangle)
+{
+    TestHarness::TempDirectory dir;
+    ThumbnailAtlas atlas(128, 128, 2);
+    std::vector<PixelImage> images;
+    std::vector<ThumbnailAtlas::Entry> entries;
+    for (uint32_t i = 0; i < 40; ++i)
+    {
+        images.push_back(Tile(20 + i % 5 * 9, 16 + i % 3 * 11, i));
+        ThumbnailAtlas::Entry entry;
+        REQUIRE(atlas.Add("img" + std::to_string(i), images.back(), &entry));
+        entries.push_back(entry);
+    }
+    CHECK(atlas.PageCount() >= 2);
+    REQUIRE(atlas.Save(dir / "gallery"));
+
+    std::vector<Reference::DecodedPng> pages(atlas.PageCount());
+    for (size_t p = 0; p < pages.size(); ++p)
+    {
+        REQUIRE(Reference::DecodePng(ReadFile(dir / ("gallery_" + std::to_string(p) + ".png")), &pages[p]));
+        CHECK_EQ(pages[p].width, uint32_t(128));
+        CHECK(!pages[p].hasAlpha);
+    }
+    for (size_t i = 0; i < images.size(); ++i)
+        CHECK(PageShows(pages[entries[i].page], entries[i], images[i]));
+}
+
+TEST_CASE(TranslucentImagesKeepTheirAlpha)
+{
+    TestHarness::TempDirectory dir;
+    ThumbnailAtlas atlas(128, 128, 1);
+    PixelImage opaque = Tile(30, 30, 1);
+    PixelImage premultiplied = Tile(30, 30, 2, AlphaMode::Premultiplied, 128);
+    ThumbnailAtlas::Entry a, b;
+    REQUIRE(atlas.Add("opaque", opaque, &a));
+    REQUIRE(atlas.Add("glass", premultiplied, &b));
+    REQUIRE(atlas.Save(dir / "t"));
+
+    Reference::DecodedPng page;
+    REQUIRE(Reference::DecodePng(ReadFile(dir / "t_0.png"), &page));
+    CHECK(page.hasAlpha);
+    CHECK(PageShows(page, a, opaque));
+    CHECK(PageShows(page, b, premultiplied));
+    // Padding stays transparent
+    CHECK_EQ(page.Pixel(a.rect.x + a.rect.width, a.rect.y)[3], uint8_t(0));
+}
+
+TEST_CASE(DuplicateIdsReturnTheFirstEntry)
+{
+    ThumbnailAtlas atlas(128, 128, 0);
+    ThumbnailAtlas::Entry first, again;
+    REQUIRE(atlas.Add("same", Tile(10, 10, 1), &first));
+    REQUIRE(atlas.Add("same", Tile(40, 40, 2), &again));
+    CHECK_EQ(again.rect.width, uint32_t(10));
+    CHECK_EQ(atlas.Entries().size(), size_t(1));
+    CHECK(!atlas.Add("huge", Tile(129, 10, 3), nullptr));
+    CHECK(!atlas.Add("empty", PixelImage(), nullptr));
+}
+
+TEST_CASE(IndexRoundTripsAndAppendsGoToNewPages)
+{
+    TestHarness::TempDirectory dir;
+    ThumbnailAtlas atlas(128, 128, 0);
+    for (uint32_t i = 0; i < 5; ++i)
+        REQUIRE(atlas.Add("\xe5\x86\x99\xe7\x9c\x9f \"" + std::to_string(i) + "\"", Tile(30, 30, i), nullptr));
+    REQUIRE(atlas.Save(dir / "a"));
+
+    std::vector<uint8_t> json = ReadFile(dir / "a.json");
+    std::string text(json.begin(), json.end());
+    CHECK(text.find("\"pages\":[\"a_0.png\"]") != std::string::npos);
+    CHECK(text.find("\"id\":\"\xe5\x86\x99\xe7\x9c\x9f \\\"3\\\"\"") != std::string::npos);
+
+    ThumbnailAtlas loaded(1, 1, 0);
+    REQUIRE(loaded.Load(dir / "a"));
+    CHECK_EQ(loaded.PageWidth(), uint32_t(128));
+    REQUIRE(loaded.Entries().size() == 5);
+    for (size_t i = 0; i < 5; ++i)
+    {
+        CHECK_EQ(loaded.Entries()[i].id, atlas.Entries()[i].id);
+        CHECK_EQ(loaded.Entries()[i].rect.x, atlas.Entries()[i].rect.x);
+        CHECK_EQ(loaded.Entries()[i].rect.y, atlas.Entries()[i].rect.y);
+    }
+    CHECK(loaded.IndexBinary() == atlas.IndexBinary());
+
+    // Sealed pages are not rewritten; the new image lands on page 1
+    fs::file_time_type before = fs::last_write_time(dir / "a_0.png");
+    PixelImage extra = Tile(20, 20, 9);
+    ThumbnailAtlas::Entry added;
+    REQUIRE(loaded.Add("extra", extra, &added));
+    CHECK_EQ(added.page, uint32_t(1));
+    REQUIRE(loaded.Save(dir / "a"));
+    CHECK(fs::last_write_time(dir / "a_0.png") == before);
+
+    Reference::DecodedPng page;
+    REQUIRE(Reference::DecodePng(ReadFile(dir / "a_1.png"), &page));
+    CHECK(PageShows(page, added, extra));
+}
+
+TEST_CASE(SavingUnderANewBaseWritesEveryPage)
+{
+    TestHarness::TempDirectory dir;
+    ThumbnailAtlas atlas(64, 64, 0);
+    std::vector<PixelImage> images;
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        images.push_back(Tile(40, 40, i));
+        REQUIRE(atlas.Add("i" + std::to_string(i), images.back(), nullptr));
+    }
+    REQUIRE(atlas.PageCount() == 6);
+    REQUIRE(atlas.Save(dir / "first"));
+
+    // Nothing is dirty any more, but the second base has no pages yet
+    fs::create_directory(dir / "other");
+    REQUIRE(atlas.Save(dir / "other" / "second"));
+    for (size_t p = 0; p < atlas.PageCount(); ++p)
+    {
+        Reference::DecodedPng page;
+        REQUIRE(Reference::DecodePng(ReadFile(dir / "other" / ("second_" + std::to_string(p) + ".png")), &page));
+        CHECK(PageShows(page, atlas.Entries()[p], images[p]));
+    }
+
+    // Loaded pages are sealed: their files are copied over, new pages are encoded
+    ThumbnailAtlas loaded(64, 64, 0);
+    REQUIRE(loaded.Load(dir / "first"));
+    PixelImage extra = Tile(30, 30, 9);
+    ThumbnailAtlas::Entry added;
+    REQUIRE(loaded.Add("extra", extra, &added));
+    REQUIRE(loaded.Save(dir / "third"));
+    for (size_t p = 0; p < 6; ++p)
+    {
+        std::string name = "_" + std::to_string(p) + ".png";
+        CHECK(ReadFile(dir / ("third" + name)) == ReadFile(dir / ("first" + name)));
+    }
+    Reference::DecodedPng page;
+    REQUIRE(Reference::DecodePng(ReadFile(dir / "third_6.png"), &page));
+    CHECK(PageShows(page, added, extra));
+
+    // Saving again in place after the move leaves the sealed files alone
+    fs::file_time_type before = fs::last_write_time(dir / "third_0.png");
+    REQUIRE(loaded.Save(dir / "third"));
+    CHECK(fs::last_write_time(dir / "third_0.png") == before);
+
+    // A sealed page whose file is gone cannot be carried to a new base
+    fs::remove(dir / "third_2.png");
+    CHECK(!loaded.Save(dir / "fourth"));
+    CHECK(!fs::exists(dir / "fourth.atlas"));
+}
+
+TEST_CASE(DamagedIndexIsRejected)
+{
+    TestHarness::TempDirectory dir;
+    ThumbnailAtlas atlas(64, 64, 0);
+    REQUIRE(atlas.Add("x", Tile(8, 8, 0), nullptr));
+    REQUIRE(atlas.Save(dir / "d"));
+
+    std::vector<uint8_t> binary = ReadFile(dir / "d.atlas");
+    for (size_t cut : { size_t(0), size_t(7), binary.size() - 1 })
+    {
+        TestData::WriteFile(dir / "d.atlas", std::vector<uint8_t>(binary.begin(), binary.begin() + cut));
+        ThumbnailAtlas loaded(64, 64, 0);
+        CHECK(!loaded.Load(dir / "d"));
+    }
+    ThumbnailAtlas missing(64, 64, 0);
+    CHECK(!missing.Load(dir / "nothing"));
+}
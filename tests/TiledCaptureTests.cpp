@@ -0,0 +1,192 @@
+#include "TestHarness.h"
+#include "ReferenceCodecs.h"
+#include "TiledCapture.h"
+#include "TestData.h"
+#include <thread>
+
+using TestData::Scene;
+using Reference::CheckDecodesTo;
+
+namespace
+{
+    // Cuts tiles out of a finished image, so the capture can be compared with encoding the
+    // image in one piece. Records every tile and can fail on a chosen one.
+    class ImageTileRenderer : public TileRenderer
+    {
+    public:
+        explicit ImageTileRenderer(const PixelImage& image, uint32_t failAt = UINT32_MAX) : m_image(image), m_failAt(failAt) {}
+
+        bool RenderTile(const TileRect& tile, uint8_t* pixels, size_t stride) override
+        {
+            threads.push_back(std::this_thread::get_id());
+            if (tiles.size() == m_failAt)
+                return false;
+            tiles.push_back(tile);
+            for (uint32_t y = 0; y < tile.height; ++y)
+                memcpy(pixels + y * stride, m_image.Row(tile.y + y) + static_cast<size_t>(tile.x) * 4, static_cast<size_t>(tile.width) * 4);
+            return true;
+        }
+
+        std::vector<TileRect> tiles;
+        std::vector<std::thread::id> threads;
+
+    private:
+        const PixelImage& m_image;
+        uint32_t m_failAt;
+    };
+
+    TiledCaptureResult Capture(TileRenderer& renderer, const PixelImage& image, const TiledCaptureOptions& options,
+                               std::vector<uint8_t>* png)
+    {
+        png->clear();
+        return RunTiledPngCapture(renderer, image.width, image.height, image.alpha, options,
+                                  [png](const uint8_t* data, size_t size)
+        {
+            png->insert(png->end(), data, data + size);
+            return true;
+        });
+    }
+}
+
+TEST_CASE(TiledOutputDecodesAndMatchesTheOnePieceEncoder)
+{
+    struct Shape { uint32_t width, height, tileWidth, tileHeight, threads, inFlight; };
+    const Shape shapes[] = { { 1, 1, 1024, 256, 1, 0 },
+                             { 300, 200, 64, 16, 4, 0 },        // Partial tiles at the right edge
+                             { 257, 129, 100, 7, 3, 2 },        // Partial last band, few buffers
+                             { 640, 97, 0, 97, 2, 0 },          // One band, whole-width tiles
+                             { 33, 1000, 1024, 1, 8, 3 } };     // One row per band
+    for (const Shape& shape : shapes)
+    {
+        for (AlphaMode alpha : { AlphaMode::Ignore, AlphaMode::Straight, AlphaMode::Premultiplied })
+        {
+            PixelImage image = Scene(shape.width, shape.height, alpha, shape.width);
+            TiledCaptureOptions options;
+            options.tileWidth = shape.tileWidth;
+            options.tileHeight = shape.tileHeight;
+            options.encodeThreads = shape.threads;
+            options.bandsInFlight = shape.inFlight;
+            options.level = 6;
+
+            ImageTileRenderer renderer(image);
+            std::vector<uint8_t> png;
+            TiledCaptureResult result = Capture(renderer, image, options, &png);
+            REQUIRE(result.ok);
+
+            CheckDecodesTo(png, image);
+
+            // Filtering in bands on several threads changes nothing about the bytes
+            std::vector<uint8_t> whole;
+            REQUIRE(EncodePng(image, &whole, options.level));
+            CHECK(png == whole);
+        }
+    }
+}
+
+TEST_CASE(TilesCoverTheImageOnceInRowMajorOrderOnTheCallingThread)
+{
+    PixelImage image = Scene(250, 90, AlphaMode::Ignore, 1);
+    TiledCaptureOptions options;
+    options.tileWidth = 100;
+    options.tileHeight = 40;
+    options.encodeThreads = 3;
+    ImageTileRenderer renderer(image);
+    std::vector<uint8_t> png;
+    TiledCaptureResult result = Capture(renderer, image, options, &png);
+    REQUIRE(result.ok);
+
+    CHECK_EQ(result.tileWidth, uint32_t(100));
+    CHECK_EQ(result.tileHeight, uint32_t(40));
+    CHECK_EQ(result.bands, uint32_t(3));
+    CHECK_EQ(result.tilesRendered, uint32_t(9));
+    REQUIRE(renderer.tiles.size() == 9);
+    const uint32_t expected[9][4] = { { 0, 0, 100, 40 }, { 100, 0, 100, 40 }, { 200, 0, 50, 40 },
+                                      { 0, 40, 100, 40 }, { 100, 40, 100, 40 }, { 200, 40, 50, 40 },
+                                      { 0, 80, 100, 10 }, { 100, 80, 100, 10 }, { 200, 80, 50, 10 } };
+    for (size_t i = 0; i < 9; ++i)
+    {
+        const TileRect& tile = renderer.tiles[i];
+        CHECK(tile.x == expected[i][0] && tile.y == expected[i][1] && tile.width == expected[i][2] && tile.height == expected[i][3]);
+    }
+    for (std::thread::id id : renderer.threads)
+        CHECK(id == std::this_thread::get_id());
+}
+
+TEST_CASE(MemoryFollowsTheBandBudgetNotTheHeight)
+{
+    TiledCaptureOptions options;
+    options.tileHeight = 16;
+    options.encodeThreads = 2;
+    options.bandsInFlight = 3;
+    options.level = 1;
+
+    uint64_t peaks[2] = {};
+    const uint32_t heights[2] = { 200, 6000 };
+    for (int i = 0; i < 2; ++i)
+    {
+        PixelImage image = Scene(512, heights[i], AlphaMode::Ignore, 3);
+        ImageTileRenderer renderer(image);
+        std::vector<uint8_t> png;
+        TiledCaptureResult result = Capture(renderer, image, options, &png);
+        REQUIRE(result.ok);
+        CHECK(result.peakBandBytes <= 3 * result.bandBytes);
+        CHECK_EQ(result.bandBytes, uint64_t(16 * (512 * 4 + 1 + 512 * 3) + 512 * 4));
+        peaks[i] = result.peakBandBytes;
+
+        CheckDecodesTo(png, image);
+    }
+    CHECK_EQ(peaks[0], peaks[1]);
+
+    // Very wide images get shorter bands to stay within maxBandBytes
+    TiledCaptureOptions wide;
+    wide.tileHeight = 256;
+    wide.maxBandBytes = 1024 * 1024;
+    CHECK_EQ(TiledBandHeight(1000, wide), uint32_t(1024 * 1024 / 8001));
+    CHECK_EQ(TiledBandHeight(100, wide), uint32_t(256));
+    CHECK_EQ(TiledBandHeight(1000000, wide), uint32_t(1));
+}
+
+TEST_CASE(RenderAndSinkFailuresStopTheCapture)
+{
+    PixelImage image = Scene(200, 1200, AlphaMode::Straight, 4);
+    TiledCaptureOptions options;
+    options.tileWidth = 100;
+    options.tileHeight = 10;
+    options.encodeThreads = 2;
+
+    // The fifth tile fails: nothing after it is rendered
+    ImageTileRenderer failing(image, 4);
+    std::vector<uint8_t> png;
+    TiledCaptureResult result = Capture(failing, image, options, &png);
+    CHECK(!result.ok);
+    CHECK(result.renderFailed);
+    CHECK(!result.sinkFailed);
+    CHECK_EQ(result.tilesRendered, uint32_t(4));
+    CHECK_EQ(failing.threads.size(), size_t(5));
+
+    // The sink gives up after the header and a little data
+    ImageTileRenderer renderer(image);
+    size_t accepted = 0;
+    result = RunTiledPngCapture(renderer, image.width, image.height, image.alpha, options,
+                                [&accepted](const uint8_t*, size_t size)
+    {
+        if (accepted > 100)
+            return false;
+        accepted += size;
+        return true;
+    });
+    CHECK(!result.ok);
+    CHECK(result.sinkFailed);
+    CHECK(!result.renderFailed);
+    CHECK(result.tilesRendered < 240);
+
+    // Failing on the signature already
+    ImageTileRenderer unused(image);
+    result = RunTiledPngCapture(unused, image.width, image.height, image.alpha, options,
+                                [](const uint8_t*, size_t) { return false; });
+    CHECK(!result.ok && result.sinkFailed);
+    CHECK_EQ(result.tilesRendered, uint32_t(0));
+
+    result = RunTiledPngCapture(unused, 0, 10, AlphaMode::Ignore, options, [](const uint8_t*, size_t) { return true; });
+    CHECK(!result.ok);
+}
@@ -0,0 +1,114 @@
+#include "Benchmark.h"
+#include "WarmSnapshot.h"
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+
+// Start-up with and without a snapshot. Handlers: the first lookup of 400 extensions against a
+// resolver that takes 200 us per call (about what an association query costs on Windows),
+// against opening the snapshot, restoring and looking them all up. Caches: saving and
+// restoring a full 4096-entry 64 px mip cache with 16k image signatures.
+namespace
+{
+    class SlowResolver : public TableHandlerResolver
+    {
+    public:
+        HandlerResolution Resolve(const std::string& extensionKey, HandlerClsid* clsid) override
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            return TableHandlerResolver::Resolve(extensionKey, clsid);
+        }
+    };
+
+    void LookUpAll(HandlerMap& map, int count)
+    {
+        HandlerClsid clsid;
+        for (int i = 0; i < count; ++i)
+            map.Find("." + std::to_string(i), &clsid);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double scale = BenchmarkScale(argc, argv);
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / ("wsp-bench-snapshot-" + std::to_string(std::random_device()()));
+    std::filesystem::create_directories(dir);
+
+    const int handlerCount = 400;
+    std::shared_ptr<SlowResolver> resolver = std::make_shared<SlowResolver>();
+    HandlerClsid clsid = {};
+    for (int i = 0; i < handlerCount; ++i)
+    {
+        clsid.bytes[0] = static_cast<uint8_t>(i);
+        if (i % 3)
+            resolver->Set("." + std::to_string(i), clsid);
+    }
+
+    std::vector<HandlerMapEntry> entries;
+    {
+        HandlerMap cold(resolver);
+        BenchmarkTimer timer;
+        LookUpAll(cold, handlerCount);
+        ReportResult("400 handlers, cold", timer.Milliseconds(), "ms");
+        entries = cold.Entries();
+    }
+    SnapshotWriter handlers;
+    handlers.AddHandlers(entries);
+    handlers.Save(dir / "handlers.snap");
+    {
+        HandlerMap warm(resolver);
+        BenchmarkTimer timer;
+        SnapshotReader reader;
+        std::vector<HandlerMapEntry> restored;
+        if (!reader.Open(dir / "handlers.snap") || !reader.ReadHandlers(&restored))
+        {
+            printf("could not read %s\n", (dir / "handlers.snap").u8string().c_str());
+            return 1;
+        }
+        warm.Restore(restored);
+        LookUpAll(warm, handlerCount);
+        ReportResult("400 handlers, from the snapshot", timer.Milliseconds(), "ms");
+    }
+
+    const int mipCount = static_cast<int>(4096 * scale);
+    const int signatureCount = static_cast<int>(16384 * scale);
+    SnapshotImages mips;
+    for (int i = 0; i < mipCount; ++i)
+    {
+        std::shared_ptr<PixelImage> image = std::make_shared<PixelImage>();
+        image->Allocate(64, 48);
+        image->alpha = AlphaMode::Premultiplied;
+        for (uint32_t y = 0; y < 48; ++y)
+            memset(image->Row(y), (i + y) & 255, 64 * 4);
+        mips.emplace_back("volume-1/file-" + std::to_string(i), image);
+    }
+    SnapshotSignatures signatures;
+    for (int i = 0; i < signatureCount; ++i)
+    {
+        ImageSignature signature;
+        signature.perceptualHash = 0x9e3779b97f4a7c15ull * i;
+        signature.paletteCount = 8;
+        signatures.emplace_back("volume-1/file-" + std::to_string(i), signature);
+    }
+
+    SnapshotWriter writer;
+    writer.AddImages(SnapshotSection::Mips, mips);
+    writer.AddSignatures(signatures);
+    uint64_t bytes = 0;
+    BenchmarkTimer timer;
+    writer.Save(dir / "caches.snap", &bytes);
+    ReportResult("mips and signatures, save", timer.Milliseconds(), "ms");
+    ReportResult("mips and signatures, file size", bytes / (1024.0 * 1024.0), "MB");
+
+    timer.Restart();
+    SnapshotReader reader;
+    SnapshotImages readMips;
+    SnapshotSignatures readSignatures;
+    bool ok = reader.Open(dir / "caches.snap") && reader.ReadImages(SnapshotSection::Mips, &readMips) &&
+              reader.ReadSignatures(&readSignatures);
+    ReportResult("mips and signatures, restore", timer.Milliseconds(), "ms");
+    reader.Close();
+    std::filesystem::remove_all(dir);
+    return ok && readMips.size() == mips.size() ? 0 : 1;
+}
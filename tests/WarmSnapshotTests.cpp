@@ -0,0 +1,460 @@
+#include "TestHarness.h"
+#include "WarmSnapshot.h"
+#include "ContentHash.h"
+#include "TestData.h"
+#include <cstring>
+
+using TestHarness::TempDirectory;
+using TestData::ReadFile;
+using TestData::WriteFile;
+
+namespace
+{
+    // The on-disk layout, to find and patch sections the way damage or a bad writer would
+    const size_t HEADER_BYTES = 64;
+    const size_t TABLE_RECORD_BYTES = 32;
+
+    struct TableRecord
+    {
+        uint32_t kind;
+        uint32_t count;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t hash;
+    };
+
+    uint32_t SectionCount(const std::vector<uint8_t>& file)
+    {
+        uint32_t count;
+        memcpy(&count, &file[12], sizeof(count));
+        return count;
+    }
+
+    TableRecord Section(const std::vector<uint8_t>& file, uint32_t index)
+    {
+        TableRecord record;
+        memcpy(&record, &file[HEADER_BYTES + index * TABLE_RECORD_BYTES], sizeof(record));
+        return record;
+    }
+
+    TableRecord FindSection(const std::vector<uint8_t>& file, SnapshotSection kind)
+    {
+        for (uint32_t i = 0; i < SectionCount(file); ++i)
+        {
+            if (Section(file, i).kind == static_cast<uint32_t>(kind))
+                return Section(file, i);
+        }
+        return TableRecord();
+    }
+
+    // Makes every hash match again after a patch, so only the record checks stand in the way.
+    // Sections patched to reach past the end keep their hash; only the table hash is redone.
+    void Rehash(std::vector<uint8_t>* file)
+    {
+        uint32_t count = SectionCount(*file);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            TableRecord record = Section(*file, i);
+            if (record.offset > file->size() || record.size > file->size() - record.offset)
+                continue;
+            record.hash = HashXxh64(file->data() + record.offset, static_cast<size_t>(record.size));
+            memcpy(&(*file)[HEADER_BYTES + i * TABLE_RECORD_BYTES], &record, sizeof(record));
+        }
+        uint64_t tableHash = HashXxh64(file->data() + HEADER_BYTES, count * TABLE_RECORD_BYTES);
+        memcpy(&(*file)[24], &tableHash, sizeof(tableHash));
+    }
+
+    std::vector<HandlerMapEntry> Handlers(int count)
+    {
+        std::vector<HandlerMapEntry> entries;
+        for (int i = 0; i < count; ++i)
+        {
+            HandlerMapEntry entry;
+            entry.extensionKey = "." + std::to_string(i);
+            entry.resolution = i % 3 ? HandlerResolution::Found : HandlerResolution::None;
+            memset(entry.clsid.bytes, i % 3 ? i : 0, sizeof(entry.clsid.bytes));
+            entries.push_back(entry);
+        }
+        return entries;
+    }
+
+    SnapshotImages Images(int count, uint32_t width)
+    {
+        SnapshotImages images;
+        for (int i = 0; i < count; ++i)
+        {
+            std::shared_ptr<PixelImage> image = std::make_shared<PixelImage>();
+            image->Allocate(width + i % 3, 5 + i % 4);
+            image->alpha = static_cast<AlphaMode>(i % 3);
+            for (uint32_t y = 0; y < image->height; ++y)
+            {
+                for (uint32_t x = 0; x < image->width * 4; ++x)
+                    image->Row(y)[x] = static_cast<uint8_t>(x * 7 + y * 13 + i);
+            }
+            // Keys are file identities: binary-safe, any length
+            std::string key = "vol" + std::to_string(i) + std::string(1, '\0') + "id" + std::string(i % 40, 'k');
+            images.emplace_back(key, image);
+        }
+        return images;
+    }
+
+    SnapshotSignatures Signatures(int count)
+    {
+        SnapshotSignatures signatures;
+        for (int i = 0; i < count; ++i)
+        {
+            ImageSignature signature;
+            signature.perceptualHash = 0x9e3779b97f4a7c15ull * (i + 1);
+            signature.differenceHash = ~static_cast<uint64_t>(i);
+            signature.averageR = static_cast<uint8_t>(i);
+            signature.averageG = static_cast<uint8_t>(i * 2);
+            signature.averageB = static_cast<uint8_t>(i * 3);
+            signature.paletteCount = i % 9;
+            for (uint32_t c = 0; c < signature.paletteCount; ++c)
+            {
+                signature.palette[c].r = static_cast<uint8_t>(c);
+                signature.palette[c].g = static_cast<uint8_t>(c + i);
+                signature.palette[c].b = static_cast<uint8_t>(255 - c);
+                signature.palette[c].share = 65536 / (c + 1);
+            }
+            signatures.emplace_back("sig" + std::to_string(i), signature);
+        }
+        return signatures;
+    }
+
+    bool SameImages(const SnapshotImages& a, const SnapshotImages& b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            const PixelImage& x = *a[i].second;
+            const PixelImage& y = *b[i].second;
+            if (a[i].first != b[i].first || x.width != y.width || x.height != y.height || x.alpha != y.alpha)
+                return false;
+            for (uint32_t row = 0; row < x.height; ++row)
+            {
+                if (memcmp(x.Row(row), y.Row(row), static_cast<size_t>(x.width) * 4) != 0)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    SnapshotWriter FullWriter()
+    {
+        SnapshotWriter writer;
+        writer.AddHandlers(Handlers(50));
+        writer.AddImages(SnapshotSection::Mips, Images(30, 17));
+        writer.AddImages(SnapshotSection::Icons, Images(5, 32));
+        writer.AddSignatures(Signatures(40));
+        writer.AddText(SnapshotSection::ProviderStats, "shell 12 3\nwic 40 1\n");
+        return writer;
+    }
+}
+
+TEST_CASE(EverySectionRoundTrips)
+{
+    TempDirectory dir;
+    std::vector<HandlerMapEntry> handlers = Handlers(50);
+    // Not worth keeping: failed lookups and keys the map cannot hold
+    HandlerMapEntry failed = { ".fail", HandlerResolution::Failed, HandlerClsid() };
+    HandlerMapEntry oversized = { "." + std::string(40, 'x'), HandlerResolution::Found, HandlerClsid() };
+    std::vector<HandlerMapEntry> written = handlers;
+    written.push_back(failed);
+    written.push_back(oversized);
+
+    SnapshotImages mips = Images(30, 17);
+    SnapshotImages withEmpty = mips;
+    withEmpty.emplace_back("empty", std::make_shared<PixelImage>());
+    withEmpty.emplace_back("null", SharedImageCache::ImagePtr());
+    SnapshotSignatures signatures = Signatures(40);
+
+    SnapshotWriter writer;
+    writer.AddHandlers(written);
+    writer.AddImages(SnapshotSection::Mips, withEmpty);
+    writer.AddImages(SnapshotSection::Icons, SnapshotImages());
+    writer.AddSignatures(signatures);
+    writer.AddText(SnapshotSection::ProviderStats, "shell 12 3\nwic 40 1\n");
+    uint64_t bytes = 0;
+    REQUIRE(writer.Save(dir / "warm.snap", &bytes));
+    CHECK_EQ(bytes, static_cast<uint64_t>(std::filesystem::file_size(dir / "warm.snap")));
+    CHECK_EQ(bytes % 64, uint64_t(0));
+    CHECK(!std::filesystem::exists(dir / "warm.snap.tmp"));
+
+    SnapshotReader reader;
+    REQUIRE(reader.Open(dir / "warm.snap"));
+    CHECK_EQ(reader.Size(), bytes);
+
+    std::vector<HandlerMapEntry> readHandlers;
+    REQUIRE(reader.ReadHandlers(&readHandlers));
+    REQUIRE(readHandlers.size() == handlers.size());
+    for (size_t i = 0; i < handlers.size(); ++i)
+    {
+        CHECK_EQ(readHandlers[i].extensionKey, handlers[i].extensionKey);
+        CHECK(readHandlers[i].resolution == handlers[i].resolution);
+        CHECK(memcmp(readHandlers[i].clsid.bytes, handlers[i].clsid.bytes, 16) == 0);
+    }
+
+    SnapshotImages readMips, readIcons;
+    REQUIRE(reader.ReadImages(SnapshotSection::Mips, &readMips));
+    CHECK(SameImages(readMips, mips));
+    REQUIRE(reader.ReadImages(SnapshotSection::Icons, &readIcons));
+    CHECK(readIcons.empty());
+
+    SnapshotSignatures readSignatures;
+    REQUIRE(reader.ReadSignatures(&readSignatures));
+    REQUIRE(readSignatures.size() == signatures.size());
+    for (size_t i = 0; i < signatures.size(); ++i)
+    {
+        const ImageSignature& a = readSignatures[i].second;
+        const ImageSignature& b = signatures[i].second;
+        CHECK_EQ(readSignatures[i].first, signatures[i].first);
+        CHECK(a.perceptualHash == b.perceptualHash && a.differenceHash == b.differenceHash);
+        CHECK(a.averageR == b.averageR && a.averageG == b.averageG && a.averageB == b.averageB);
+        CHECK_EQ(a.paletteCount, b.paletteCount);
+        for (uint32_t c = 0; c < a.paletteCount; ++c)
+        {
+            CHECK(a.palette[c].r == b.palette[c].r && a.palette[c].g == b.palette[c].g && a.palette[c].b == b.palette[c].b);
+            CHECK_EQ(a.palette[c].share, b.palette[c].share);
+        }
+    }
+
+    std::string text;
+    REQUIRE(reader.ReadText(SnapshotSection::ProviderStats, &text));
+    CHECK_EQ(text, std::string("shell 12 3\nwic 40 1\n"));
+}
+
+TEST_CASE(ALaterSectionOfTheSameKindReplacesTheFirst)
+{
+    TempDirectory dir;
+    SnapshotWriter writer;
+    writer.AddText(SnapshotSection::ProviderStats, "old");
+    writer.AddHandlers(Handlers(3));
+    writer.AddText(SnapshotSection::ProviderStats, "new");
+    REQUIRE(writer.Save(dir / "s"));
+
+    SnapshotReader reader;
+    REQUIRE(reader.Open(dir / "s"));
+    CHECK_EQ(SectionCount(ReadFile(dir / "s")), uint32_t(2));
+    std::string text;
+    REQUIRE(reader.ReadText(SnapshotSection::ProviderStats, &text));
+    CHECK_EQ(text, std::string("new"));
+    CHECK(reader.Has(SnapshotSection::Handlers));
+    CHECK(!reader.Has(SnapshotSection::Mips));
+    SnapshotImages images;
+    CHECK(!reader.ReadImages(SnapshotSection::Mips, &images));
+}
+
+TEST_CASE(ADamagedSectionIsSkippedAndTheOthersStillRead)
+{
+    TempDirectory dir;
+    REQUIRE(FullWriter().Save(dir / "s"));
+    const std::vector<uint8_t> original = ReadFile(dir / "s");
+    REQUIRE(SectionCount(original) == 5);
+
+    for (uint32_t damaged = 0; damaged < 5; ++damaged)
+    {
+        std::vector<uint8_t> file = original;
+        TableRecord record = Section(file, damaged);
+        file[record.offset + record.size / 2] ^= 0x10;
+        WriteFile(dir / "s", file);
+
+        SnapshotReader reader;
+        REQUIRE(reader.Open(dir / "s"));
+        std::vector<HandlerMapEntry> handlers;
+        SnapshotImages mips, icons;
+        SnapshotSignatures signatures;
+        std::string text = "untouched";
+        bool read[6] = {};
+        read[1] = reader.ReadHandlers(&handlers);
+        read[2] = reader.ReadImages(SnapshotSection::Icons, &icons);
+        read[3] = reader.ReadImages(SnapshotSection::Mips, &mips);
+        read[4] = reader.ReadSignatures(&signatures);
+        read[5] = reader.ReadText(SnapshotSection::ProviderStats, &text);
+        for (uint32_t kind = 1; kind <= 5; ++kind)
+            CHECK_EQ(read[kind], kind != record.kind);
+        // Nothing is handed out from the damaged one
+        if (record.kind == static_cast<uint32_t>(SnapshotSection::ProviderStats))
+            CHECK_EQ(text, std::string("untouched"));
+        if (record.kind == static_cast<uint32_t>(SnapshotSection::Mips))
+            CHECK(mips.empty());
+    }
+}
+
+TEST_CASE(DamagedHeadersTablesAndLengthsRejectTheFile)
+{
+    TempDirectory dir;
+    REQUIRE(FullWriter().Save(dir / "s"));
+    const std::vector<uint8_t> original = ReadFile(dir / "s");
+    SnapshotReader reader;
+    REQUIRE(reader.Open(dir / "s"));
+    reader.Close();
+    CHECK_EQ(reader.Size(), uint64_t(0));
+
+    // Magic, version, section count, table hash, and a byte of the table itself
+    for (size_t offset : { size_t(0), size_t(8), size_t(12), size_t(24), HEADER_BYTES + 40 })
+    {
+        std::vector<uint8_t> file = original;
+        file[offset] ^= 0x01;
+        WriteFile(dir / "s", file);
+        CHECK(!reader.Open(dir / "s"));
+    }
+
+    // Truncated anywhere, or grown
+    for (size_t size : { size_t(10), size_t(63), size_t(64), size_t(100), original.size() / 2, original.size() - 64, original.size() - 1 })
+    {
+        WriteFile(dir / "s", std::vector<uint8_t>(original.begin(), original.begin() + size));
+        CHECK(!reader.Open(dir / "s"));
+    }
+    std::vector<uint8_t> grown = original;
+    grown.resize(original.size() + 64);
+    WriteFile(dir / "s", grown);
+    CHECK(!reader.Open(dir / "s"));
+
+    WriteFile(dir / "s", std::vector<uint8_t>());
+    CHECK(!reader.Open(dir / "s"));
+    CHECK(!reader.Open(dir / "missing"));
+    std::vector<HandlerMapEntry> handlers;
+    CHECK(!reader.ReadHandlers(&handlers));
+
+    WriteFile(dir / "s", original);
+    CHECK(reader.Open(dir / "s"));
+}
+
+// Records with valid hashes but impossible contents (a buggy or hostile writer) are refused
+// whole, never read out of bounds
+TEST_CASE(RecordsPointingOutsideTheirSectionAreRefused)
+{
+    TempDirectory dir;
+    REQUIRE(FullWriter().Save(dir / "s"));
+    const std::vector<uint8_t> original = ReadFile(dir / "s");
+
+    struct Patch { SnapshotSection section; size_t field; uint64_t value; size_t bytes; };
+    const Patch patches[] = {
+        { SnapshotSection::Handlers, 32, 2, 4 },                // Resolution Failed
+        { SnapshotSection::Handlers, 32, 77, 4 },
+        { SnapshotSection::Mips, 0, 1ull << 40, 8 },            // Key offset
+        { SnapshotSection::Mips, 8, 0xffffffff, 4 },            // Key length
+        { SnapshotSection::Mips, 12, 0, 4 },                    // Width
+        { SnapshotSection::Mips, 16, 5000, 4 },                 // Height
+        { SnapshotSection::Mips, 20, 3, 4 },                    // Alpha mode
+        { SnapshotSection::Mips, 24, 1ull << 33, 8 },           // Pixel offset
+        { SnapshotSection::Signatures, 12, 9, 4 },              // Palette count
+        { SnapshotSection::Signatures, 0, ~0ull, 8 },           // Key offset
+    };
+    for (const Patch& patch : patches)
+    {
+        std::vector<uint8_t> file = original;
+        TableRecord record = FindSection(file, patch.section);
+        REQUIRE(record.size > 0);
+        memcpy(&file[record.offset + patch.field], &patch.value, patch.bytes);
+        Rehash(&file);
+        WriteFile(dir / "s", file);
+
+        SnapshotReader reader;
+        REQUIRE(reader.Open(dir / "s"));
+        std::vector<HandlerMapEntry> handlers(1);
+        SnapshotImages images(1);
+        SnapshotSignatures signatures(1);
+        if (patch.section == SnapshotSection::Handlers)
+            CHECK(!reader.ReadHandlers(&handlers) && handlers.size() == 1);
+        else if (patch.section == SnapshotSection::Mips)
+            CHECK(!reader.ReadImages(SnapshotSection::Mips, &images) && images.size() == 1);
+        else
+            CHECK(!reader.ReadSignatures(&signatures) && signatures.size() == 1);
+    }
+
+    // A count larger than the section holds
+    std::vector<uint8_t> file = original;
+    for (uint32_t i = 0; i < SectionCount(file); ++i)
+    {
+        TableRecord record = Section(file, i);
+        if (record.kind == static_cast<uint32_t>(SnapshotSection::Handlers))
+        {
+            record.count = 1000000;
+            memcpy(&file[HEADER_BYTES + i * TABLE_RECORD_BYTES], &record, sizeof(record));
+        }
+    }
+    Rehash(&file);
+    WriteFile(dir / "s", file);
+    SnapshotReader reader;
+    REQUIRE(reader.Open(dir / "s"));
+    std::vector<HandlerMapEntry> handlers;
+    CHECK(!reader.ReadHandlers(&handlers));
+    SnapshotSignatures signatures;
+    CHECK(reader.ReadSignatures(&signatures));
+
+    // A section table entry pointing past the end rejects the whole file
+    file = original;
+    TableRecord record = Section(file, 0);
+    record.size = file.size();
+    memcpy(&file[HEADER_BYTES], &record, sizeof(record));
+    Rehash(&file);
+    WriteFile(dir / "s", file);
+    CHECK(!reader.Open(dir / "s"));
+}
+
+TEST_CASE(SavingReplacesTheFileWhole)
+{
+    TempDirectory dir;
+    SnapshotWriter first;
+    first.AddText(SnapshotSection::ProviderStats, "first");
+    REQUIRE(first.Save(dir / "s"));
+
+    // A reader of the old file keeps seeing it; the next one sees the new file
+    SnapshotReader old;
+    REQUIRE(old.Open(dir / "s"));
+    REQUIRE(FullWriter().Save(dir / "s"));
+    std::string text;
+    REQUIRE(old.ReadText(SnapshotSection::ProviderStats, &text));
+    CHECK_EQ(text, std::string("first"));
+
+    SnapshotReader next;
+    REQUIRE(next.Open(dir / "s"));
+    REQUIRE(next.ReadText(SnapshotSection::ProviderStats, &text));
+    CHECK_EQ(text, std::string("shell 12 3\nwic 40 1\n"));
+
+    CHECK(!FullWriter().Save(dir / "missing" / "s"));
+    CHECK(!std::filesystem::exists(dir / "missing"));
+
+    SnapshotWriter empty;
+    REQUIRE(empty.Save(dir / "empty"));
+    REQUIRE(next.Open(dir / "empty"));
+    CHECK(!next.Has(SnapshotSection::Handlers));
+}
+
+TEST_CASE(RestoredHandlersAnswerWithoutTheResolver)
+{
+    TempDirectory dir;
+    std::shared_ptr<TableHandlerResolver> resolver = std::make_shared<TableHandlerResolver>();
+    HandlerClsid clsid = {};
+    for (int i = 1; i <= 20; ++i)
+    {
+        clsid.bytes[0] = static_cast<uint8_t>(i);
+        resolver->Set(".e" + std::to_string(i), clsid);
+    }
+    {
+        HandlerMap map(resolver, 64);
+        for (int i = 0; i <= 20; ++i)
+            map.Find(".e" + std::to_string(i), &clsid);
+        SnapshotWriter writer;
+        writer.AddHandlers(map.Entries());
+        REQUIRE(writer.Save(dir / "s"));
+    }
+
+    SnapshotReader reader;
+    REQUIRE(reader.Open(dir / "s"));
+    std::vector<HandlerMapEntry> entries;
+    REQUIRE(reader.ReadHandlers(&entries));
+    HandlerMap map(resolver, 64);
+    uint64_t before = resolver->ResolveCount();
+    CHECK_EQ(map.Restore(entries), size_t(21));
+    for (int i = 0; i <= 20; ++i)
+    {
+        HandlerResolution resolution = map.Find(".e" + std::to_string(i), &clsid);
+        CHECK(resolution == (i ? HandlerResolution::Found : HandlerResolution::None));
+        CHECK_EQ(clsid.bytes[0], static_cast<uint8_t>(i));
+    }
+    CHECK_EQ(resolver->ResolveCount(), before);
+}
@@ -0,0 +1,190 @@
+#include "TestHarness.h"
+#include "WorkStealingPool.h"
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+using TestHarness::WaitUntil;
+
+namespace
+{
+    // Sum of 0..n-1 split in halves down to single numbers, each half a task of its own
+    void SumRange(WorkStealingPool& pool, uint64_t begin, uint64_t end, std::atomic<uint64_t>* sum)
+    {
+        if (end - begin == 1)
+        {
+            sum->fetch_add(begin);
+            return;
+        }
+        uint64_t middle = begin + (end - begin) / 2;
+        std::atomic<int> done(0);
+        pool.Submit([&pool, begin, middle, sum, &done]() { SumRange(pool, begin, middle, sum); done.fetch_add(1); });
+        SumRange(pool, middle, end, sum);
+        pool.RunUntil([&done]() { return done.load() == 1; });
+    }
+}
+
+TEST_CASE(EverySubmittedTaskRunsOnce)
+{
+    const int count = 2000;
+    std::vector<std::atomic<int>> runs(count);
+    for (std::atomic<int>& run : runs)
+        run.store(0);
+
+    WorkStealingPoolStats stats;
+    {
+        WorkStealingPool pool(4, 16);
+        CHECK_EQ(pool.ThreadCount(), uint32_t(4));
+        for (int i = 0; i < count; ++i)
+            pool.Submit([&runs, i]() { runs[i].fetch_add(1); });
+        REQUIRE(WaitUntil([&pool]() { return pool.Stats().executed == count; }, 10000));
+        stats = pool.Stats();
+    }
+    for (std::atomic<int>& run : runs)
+        CHECK_EQ(run.load(), 1);
+    CHECK_EQ(stats.threads, uint32_t(4));
+    CHECK_EQ(stats.submitted, uint64_t(count));
+    CHECK_EQ(stats.spawned, uint64_t(0));
+    CHECK(stats.queueHighWater >= 1 && stats.queueHighWater <= 16);
+
+    WorkStealingPool defaults;
+    CHECK(defaults.ThreadCount() >= 1);
+}
+
+TEST_CASE(DestroyingThePoolRunsWhatIsStillQueued)
+{
+    std::atomic<int> runs(0);
+    {
+        WorkStealingPool pool(2, 256);
+        for (int i = 0; i < 200; ++i)
+        {
+            pool.Submit([&runs]()
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                runs.fetch_add(1);
+            });
+        }
+    }
+    CHECK_EQ(runs.load(), 200);
+}
+
+TEST_CASE(AFullInjectionQueueHoldsSubmittersBack)
+{
+    WorkStealingPool pool(1, 2);
+    std::atomic<bool> started(false), release(false);
+    pool.Submit([&started, &release]()
+    {
+        started.store(true);
+        while (!release.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    REQUIRE(WaitUntil([&started]() { return started.load(); }, 5000));
+
+    // The only worker is busy: two tasks fit, the third doesn't
+    std::atomic<int> runs(0);
+    WorkStealingPool::Task task = [&runs]() { runs.fetch_add(1); };
+    WorkStealingPool::Task copy = task;
+    CHECK(pool.TrySubmit(copy));
+    copy = task;
+    CHECK(pool.TrySubmit(copy));
+    copy = task;
+    CHECK(!pool.TrySubmit(copy));
+    CHECK(copy != nullptr);
+
+    std::atomic<bool> submitted(false);
+    std::thread submitter([&pool, &task, &submitted]()
+    {
+        pool.Submit(task);
+        submitted.store(true);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    CHECK(!submitted.load());
+
+    release.store(true);
+    submitter.join();
+    REQUIRE(WaitUntil([&runs]() { return runs.load() == 3; }, 5000));
+    WorkStealingPoolStats stats = pool.Stats();
+    CHECK(stats.submitWaitMs >= 100);
+    CHECK_EQ(stats.queueHighWater, uint64_t(2));
+    CHECK_EQ(stats.submitted, uint64_t(4));
+}
+
+TEST_CASE(SubtasksRunNewestFirstOnTheirOwnWorker)
+{
+    WorkStealingPool pool(1);
+    std::mutex mutex;
+    std::vector<int> order;
+    std::atomic<bool> finished(false);
+    pool.Submit([&]()
+    {
+        std::atomic<int> done(0);
+        for (int i = 0; i < 4; ++i)
+        {
+            pool.Submit([&, i]()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(i);
+                done.fetch_add(1);
+            });
+        }
+        // A single worker can only wait by running its subtasks itself
+        pool.RunUntil([&done]() { return done.load() == 4; });
+        finished.store(true);
+    });
+    REQUIRE(WaitUntil([&finished]() { return finished.load(); }, 5000));
+    CHECK(order == std::vector<int>({ 3, 2, 1, 0 }));
+    WorkStealingPoolStats stats = pool.Stats();
+    CHECK_EQ(stats.submitted, uint64_t(1));
+    CHECK_EQ(stats.spawned, uint64_t(4));
+    CHECK_EQ(stats.stolen, uint64_t(0));
+}
+
+TEST_CASE(IdleWorkersStealSubtasks)
+{
+    WorkStealingPool pool(4);
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::atomic<bool> finished(false);
+    pool.Submit([&]()
+    {
+        std::atomic<int> done(0);
+        for (int i = 0; i < 64; ++i)
+        {
+            pool.Submit([&]()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                std::lock_guard<std::mutex> lock(mutex);
+                threads.insert(std::this_thread::get_id());
+                done.fetch_add(1);
+            });
+        }
+        pool.RunUntil([&done]() { return done.load() == 64; });
+        finished.store(true);
+    });
+    REQUIRE(WaitUntil([&pool]() { return pool.Stats().executed == 65; }, 10000));
+    CHECK(finished.load());
+    WorkStealingPoolStats stats = pool.Stats();
+    CHECK_EQ(stats.spawned, uint64_t(64));
+    CHECK(stats.stolen > 0);
+    CHECK(threads.size() > 1);
+}
+
+TEST_CASE(RecursiveSplitsFinishOnAnyThreadCount)
+{
+    for (uint32_t threads : { 1u, 2u, 8u })
+    {
+        WorkStealingPool pool(threads);
+        std::atomic<uint64_t> sum(0);
+        std::atomic<bool> finished(false);
+        pool.Submit([&]()
+        {
+            SumRange(pool, 0, 4096, &sum);
+            finished.store(true);
+        });
+        REQUIRE(WaitUntil([&finished]() { return finished.load(); }, 20000));
+        CHECK_EQ(sum.load(), uint64_t(4096) * 4095 / 2);
+        CHECK_EQ(pool.Stats().spawned, uint64_t(4095));
+    }
+}
@@ -0,0 +1,89 @@
+#include "Benchmark.h"
+#include "WorkerPool.h"
+#include <thread>
+
+// Round trips through out-of-process workers: jobs per second for small thumbnails, throughput
+// for full-HD frames read in place from shared memory, and how long a crash costs (detection
+// plus the replacement worker). Uses the StubWorker test executable.
+namespace
+{
+    WorkerJob Pattern(uint32_t width, uint32_t height)
+    {
+        WorkerJob job;
+        job.kind = 0;
+        job.path = "bench.jpg";
+        job.width = width;
+        job.height = height;
+        job.handlerKey = "jpg";
+        return job;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int jobs = static_cast<int>(2000 * BenchmarkScale(argc, argv));
+    WorkerPoolOptions options;
+    options.executable = STUB_WORKER_PATH;
+    options.namePrefix = "wsp-bench";
+    options.workerCount = 4;
+    options.pixelCapacity = 1920 * 1080 * 4;
+
+    WorkerPool pool;
+    BenchmarkTimer timer;
+    if (!pool.Start(options))
+    {
+        printf("cannot start %s\n", STUB_WORKER_PATH);
+        return 1;
+    }
+    ReportResult("pool start (4 workers)", timer.Milliseconds(), "ms");
+
+    uint64_t checksum = 0;
+    auto consume = [&checksum](const SharedImageView& image) { checksum += image.pixels[image.stride * (image.height - 1)]; };
+
+    timer.Restart();
+    for (int i = 0; i < jobs; ++i)
+        pool.Run(Pattern(96, 96), 5000, consume);
+    double smallMs = timer.Milliseconds();
+
+    // Four callers keep every worker busy
+    timer.Restart();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&pool, jobs]()
+        {
+            uint64_t local = 0;
+            for (int i = 0; i < jobs / 4; ++i)
+                pool.Run(Pattern(96, 96), 5000, [&local](const SharedImageView& image) { local += image.pixels[0]; });
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    double parallelMs = timer.Milliseconds();
+
+    const int frames = jobs / 20 > 0 ? jobs / 20 : 1;
+    timer.Restart();
+    for (int i = 0; i < frames; ++i)
+        pool.Run(Pattern(1920, 1080), 5000, consume);
+    double frameMs = timer.Milliseconds();
+
+    const int crashes = 10;
+    timer.Restart();
+    for (int i = 0; i < crashes; ++i)
+    {
+        WorkerJob crash = Pattern(1, 1);
+        crash.kind = 2;
+        crash.handlerKey = "crash" + std::to_string(i);
+        pool.Run(crash, 5000, nullptr);
+        pool.Run(Pattern(96, 96), 5000, consume);
+    }
+    double crashMs = timer.Milliseconds();
+
+    ReportResult("96x96 round trip, one caller", smallMs * 1000.0 / jobs, "us");
+    ReportResult("96x96 jobs, four callers", jobs / (parallelMs / 1000.0), "jobs/s");
+    ReportResult("1920x1080 frame round trip", frameMs / frames, "ms");
+    ReportResult("1920x1080 frame throughput", frames * 1920.0 * 1080 * 4 / (1 << 20) / (frameMs / 1000.0), "MB/s");
+    ReportResult("crash + next job", crashMs / crashes, "ms");
+    ReportResult("checksum", static_cast<double>(checksum % 1000), "");
+    return 0;
+}
@@ -0,0 +1,289 @@
+#include "TestHarness.h"
+#include "WorkerPool.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+    // Job kinds understood by StubWorker
+    enum StubJob : uint32_t
+    {
+        JOB_PATTERN = 0,
+        JOB_FAIL = 1,
+        JOB_CRASH = 2,
+        JOB_HANG = 3,
+        JOB_FREEZE_WHEN_IDLE = 4,
+        JOB_ECHO_PATH = 5,
+        JOB_EXIT = 6,
+        JOB_TOO_BIG = 7
+    };
+
+    WorkerPoolOptions StubOptions(uint32_t workers)
+    {
+        WorkerPoolOptions options;
+        options.executable = STUB_WORKER_PATH;
+        options.namePrefix = TestHarness::UniqueName("wsp-pool");
+        options.workerCount = workers;
+        options.pixelCapacity = 1 << 20;
+        options.startTimeoutMs = 5000;
+        options.healthIntervalMs = 50;
+        return options;
+    }
+
+    WorkerJob Job(uint32_t kind, const std::string& path = "file", const std::string& key = "")
+    {
+        WorkerJob job;
+        job.kind = kind;
+        job.path = path;
+        job.width = 40;
+        job.height = 30;
+        job.handlerKey = key.empty() ? path : key;
+        return job;
+    }
+
+    bool IsPattern(const SharedImageView& image, uint32_t width, uint32_t height, size_t pathBytes)
+    {
+        if (image.width != width || image.height != height || image.stride != width * 4 || image.alpha != AlphaMode::Straight)
+            return false;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const uint8_t* p = image.pixels + y * image.stride;
+            for (uint32_t x = 0; x < width; ++x, p += 4)
+            {
+                if (p[0] != static_cast<uint8_t>(x) || p[1] != static_cast<uint8_t>(y) ||
+                    p[2] != static_cast<uint8_t>(pathBytes) || p[3] != static_cast<uint8_t>(x ^ y))
+                    return false;
+            }
+        }
+        return true;
+    }
+}
+
+TEST_CASE(ImagesComeBackThroughSharedMemory)
+{
+    WorkerPool pool;
+    REQUIRE(pool.Start(StubOptions(2)));
+    CHECK(pool.IsRunning());
+    CHECK_EQ(pool.Stats().liveWorkers, uint32_t(2));
+
+    bool consumed = false;
+    WorkerResult result = pool.Run(Job(JOB_PATTERN, "photo.jpg"), 5000, [&consumed](const SharedImageView& image)
+    {
+        consumed = IsPattern(image, 40, 30, 9);
+    });
+    CHECK(result.outcome == WorkerOutcome::Completed);
+    CHECK_EQ(result.status, 0);
+    CHECK(consumed);
+
+    // A handler failure is an answer, not a crash: no consumer call, no restart
+    consumed = false;
+    result = pool.Run(Job(JOB_FAIL), 5000, [&consumed](const SharedImageView&) { consumed = true; });
+    CHECK(result.outcome == WorkerOutcome::Completed);
+    CHECK_EQ(result.status, -5);
+    CHECK(!consumed);
+
+    // Too large for the shared area: refused by the writer inside the worker
+    result = pool.Run(Job(JOB_TOO_BIG), 5000, nullptr);
+    CHECK(result.outcome == WorkerOutcome::Completed);
+    CHECK_EQ(result.status, -6);
+
+    WorkerPoolStats stats = pool.Stats();
+    CHECK_EQ(stats.jobs, uint64_t(3));
+    CHECK_EQ(stats.completed, uint64_t(3));
+    CHECK_EQ(stats.spawned, uint64_t(2));
+    CHECK_EQ(stats.crashes, uint64_t(0));
+}
+
+TEST_CASE(LongUtf8PathsCrossTheChannel)
+{
+    WorkerPool pool;
+    REQUIRE(pool.Start(StubOptions(1)));
+    std::string path = "/data/";
+    while (path.size() < 3000)
+        path += "\xe5\x86\x99\xe7\x9c\x9f/";
+    path += "IMG.jpg";
+
+    std::string echoed;
+    WorkerResult result = pool.Run(Job(JOB_ECHO_PATH, path), 5000, [&echoed](const SharedImageView& image)
+    {
+        echoed.assign(reinterpret_cast<const char*>(image.pixels), image.width * 4);
+    });
+    CHECK(result.outcome == WorkerOutcome::Completed);
+    CHECK_EQ(result.status, static_cast<int32_t>(path.size()));
+    CHECK(echoed.compare(0, path.size(), path) == 0);
+
+    // Beyond the channel's limit the job is refused without touching a worker
+    WorkerJob huge = Job(JOB_ECHO_PATH, std::string(WorkerChannel::MAX_PATH_BYTES, 'a'));
+    CHECK(pool.Run(huge, 5000, nullptr).outcome == WorkerOutcome::Unavailable);
+    CHECK_EQ(pool.Stats().liveWorkers, uint32_t(1));
+}
+
+TEST_CASE(CrashedWorkersAreReplaced)
+{
+    WorkerPool pool;
+    REQUIRE(pool.Start(StubOptions(1)));
+
+    auto start = std::chrono::steady_clock::now();
+    WorkerResult result = pool.Run(Job(JOB_CRASH, "bad.psd"), 10000, nullptr);
+    CHECK(result.outcome == WorkerOutcome::Crashed);
+    // Noticed from the process state, not by waiting out the deadline
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+
+    result = pool.Run(Job(JOB_EXIT, "quits.psd"), 10000, nullptr);
+    CHECK(result.outcome == WorkerOutcome::Crashed);
+
+    // The next job gets a fresh worker, from the health thread or on demand
+    bool consumed = false;
+    result = pool.Run(Job(JOB_PATTERN, "good.png"), 5000, [&consumed](const SharedImageView& image)
+    {
+        consumed = IsPattern(image, 40, 30, 8);
+    });
+    CHECK(result.outcome == WorkerOutcome::Completed);
+    CHECK(consumed);
+
+    WorkerPoolStats stats = pool.Stats();
+    CHECK_EQ(stats.crashes, uint64_t(2));
+    CHECK(stats.spawned >= 3);
+    CHECK_EQ(stats.liveWorkers, uint32_t(1));
+}
+
+TEST_CASE(HungJobsTimeOutAndTheWorkerIsKilled)
+{
+    WorkerPool pool;
+    REQUIRE(pool.Start(StubOptions(1)));
+
+    auto start = std::chrono::steady_clock::now();
+    WorkerResult result = pool.Run(Job(JOB_HANG, "deadlock.doc"), 200, nullptr);
+    CHECK(result.outcome == WorkerOutcome::TimedOut);
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    CHECK(elapsedMs >= 190 && elapsedMs < 3000);
+
+    result = pool.Run(Job(JOB_PATTERN), 5000, nullptr);
+    CHECK(result.outcome == WorkerOutcome::Completed);
+    CHECK_EQ(pool.Stats().timeouts, uint64_t(1));
+}
+
+TEST_CASE(IdleWorkersWithoutHeartbeatAreRestarted)
+{
+    WorkerPoolOptions options = StubOptions(1);
+    options.heartbeatTimeoutMs = 600;
+    WorkerPool pool;
+    REQUIRE(pool.Start(options));
+
+    // The worker answers, then stops dead while idle
+    CHECK(pool.Run(Job(JOB_FREEZE_WHEN_IDLE), 5000, nullptr).outcome == WorkerOutcome::Completed);
+    CHECK(TestHarness::WaitUntil([&pool]() { return pool.Stats().hangsDetected == 1; }, 10000));
+    CHECK(TestHarness::WaitUntil([&pool]() { return pool.Stats().spawned == 2; }, 10000));
+
+    CHECK(pool.Run(Job(JOB_PATTERN), 5000, nullptr).outcome == WorkerOutcome::Completed);
+    // A healthy idle worker is left alone
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    CHECK_EQ(pool.Stats().hangsDetected, uint64_t(1));
+}
+
+TEST_CASE(RepeatedFailuresQuarantineTheHandlerKey)
+{
+    WorkerPoolOptions options = StubOptions(1);
+    options.quarantineFailures = 3;
+    WorkerPool pool;
+    REQUIRE(pool.Start(options));
+
+    // Two failures, then a success: the count starts over
+    pool.Run(Job(JOB_CRASH, "a.psd", "psd"), 5000, nullptr);
+    pool.Run(Job(JOB_HANG, "b.psd", "psd"), 100, nullptr);
+    CHECK(pool.Run(Job(JOB_PATTERN, "c.psd", "psd"), 5000, nullptr).outcome == WorkerOutcome::Completed);
+    pool.Run(Job(JOB_CRASH, "d.psd", "psd"), 5000, nullptr);
+    pool.Run(Job(JOB_CRASH, "e.psd", "psd"), 5000, nullptr);
+    CHECK(!pool.IsQuarantined("psd"));
+
+    pool.Run(Job(JOB_CRASH, "f.psd", "psd"), 5000, nullptr);
+    CHECK(pool.IsQuarantined("psd"));
+    uint64_t spawned = pool.Stats().spawned;
+    WorkerResult result = pool.Run(Job(JOB_PATTERN, "g.psd", "psd"), 5000, nullptr);
+    CHECK(result.outcome == WorkerOutcome::Quarantined);
+
+    // Other keys are unaffected, and nothing was spent on the refused job
+    CHECK(pool.Run(Job(JOB_PATTERN, "h.png", "png"), 5000, nullptr).outcome == WorkerOutcome::Completed);
+    WorkerPoolStats stats = pool.Stats();
+    CHECK_EQ(stats.quarantined, uint64_t(1));
+    CHECK_EQ(stats.quarantinedKeys, uint32_t(1));
+    CHECK(stats.spawned <= spawned + 1);
+
+    pool.ClearQuarantine();
+    CHECK(!pool.IsQuarantined("psd"));
+    CHECK(pool.Run(Job(JOB_PATTERN, "g.psd", "psd"), 5000, nullptr).outcome == WorkerOutcome::Completed);
+}
+
+TEST_CASE(ConcurrentJobsShareThePool)
+{
+    WorkerPool pool;
+    REQUIRE(pool.Start(StubOptions(3)));
+
+    std::atomic<int> good(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 6; ++t)
+    {
+        threads.emplace_back([&pool, &good, t]()
+        {
+            for (int i = 0; i < 15; ++i)
+            {
+                // Every fifth job crashes its worker; the rest must be unaffected
+                bool crash = (t * 15 + i) % 5 == 4;
+                std::string path = std::string(static_cast<size_t>(t + 1), 'p') + std::to_string(i);
+                WorkerJob job = Job(crash ? JOB_CRASH : JOB_PATTERN, path, "key" + std::to_string(t));
+                job.width = 16 + i;
+                bool ok = false;
+                WorkerResult result = pool.Run(job, 10000, [&ok, &job, &path](const SharedImageView& image)
+                {
+                    ok = IsPattern(image, job.width, job.height, path.size());
+                });
+                if (!crash && result.outcome == WorkerOutcome::Completed && ok)
+                    good++;
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    CHECK_EQ(good.load(), 72);
+    WorkerPoolStats stats = pool.Stats();
+    CHECK_EQ(stats.crashes, uint64_t(18));
+    CHECK_EQ(stats.completed, uint64_t(72));
+}
+
+TEST_CASE(StartFailsWithoutUsableWorkers)
+{
+    WorkerPool missing;
+    WorkerPoolOptions options = StubOptions(2);
+    options.executable = "/nonexistent/StubWorker";
+    CHECK(!missing.Start(options));
+    CHECK(!missing.IsRunning());
+    CHECK(missing.Run(Job(JOB_PATTERN), 1000, nullptr).outcome == WorkerOutcome::Unavailable);
+
+    // A worker that exits at once is noticed without waiting for the start timeout
+    WorkerPool exits;
+    options = StubOptions(1);
+    options.arguments = { "exit", "1" };
+    options.startTimeoutMs = 30000;
+    auto start = std::chrono::steady_clock::now();
+    CHECK(!exits.Start(options));
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(10));
+    CHECK_EQ(exits.Stats().spawnFailures, uint64_t(1));
+}
+
+TEST_CASE(StopShutsWorkersDownAndRefusesJobs)
+{
+    WorkerPool pool;
+    REQUIRE(pool.Start(StubOptions(2)));
+    CHECK(pool.Run(Job(JOB_PATTERN), 5000, nullptr).outcome == WorkerOutcome::Completed);
+    pool.Stop();
+    CHECK(!pool.IsRunning());
+    CHECK(pool.Run(Job(JOB_PATTERN), 1000, nullptr).outcome == WorkerOutcome::Unavailable);
+    pool.Stop();
+
+    // And it can be started again
+    REQUIRE(pool.Start(StubOptions(1)));
+    CHECK(pool.Run(Job(JOB_PATTERN), 5000, nullptr).outcome == WorkerOutcome::Completed);
+}
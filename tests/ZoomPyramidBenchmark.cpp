@@ -0,0 +1,79 @@
+#include "Benchmark.h"
+#include "ZoomPyramid.h"
+#include <string>
+
+// HalvePixelImage on a 4096x4096 frame against a plain per-channel loop, then a whole pyramid
+// (256px tiles, level 1) from a 4096x4096 capture: tiles, total time and the share spent
+// downsampling, with the sink only counting bytes.
+namespace
+{
+    void HalvePlain(const PixelImage& src, PixelImage* dst)
+    {
+        dst->Allocate((src.width + 1) / 2, (src.height + 1) / 2);
+        for (uint32_t y = 0; y < dst->height; ++y)
+        {
+            const uint8_t* row0 = src.Row(y * 2);
+            const uint8_t* row1 = src.Row(y * 2 + 1 < src.height ? y * 2 + 1 : y * 2);
+            uint8_t* out = dst->Row(y);
+            for (uint32_t x = 0; x < src.width / 2; ++x)
+            {
+                for (int c = 0; c < 4; ++c)
+                    out[x * 4 + c] = static_cast<uint8_t>((row0[x * 8 + c] + row0[x * 8 + c + 4] + row1[x * 8 + c] + row1[x * 8 + c + 4] + 2) >> 2);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double scale = BenchmarkScale(argc, argv);
+    const uint32_t size = scale < 1.0 ? 1024 : 4096;
+    const int repeats = static_cast<int>(20 * scale) + 1;
+
+    PixelImage image;
+    if (!image.Allocate(size, size))
+        return 1;
+    for (uint32_t y = 0; y < size; ++y)
+    {
+        uint8_t* p = image.Row(y);
+        for (uint32_t x = 0; x < size; ++x, p += 4)
+        {
+            p[0] = static_cast<uint8_t>(x);
+            p[1] = static_cast<uint8_t>(y);
+            p[2] = static_cast<uint8_t>((x * y) >> 8);
+            p[3] = 255;
+        }
+    }
+
+    PixelImage half;
+    BenchmarkTimer timer;
+    for (int i = 0; i < repeats; ++i)
+        HalvePixelImage(image, &half);
+    std::string name = "halve " + std::to_string(size) + "x" + std::to_string(size);
+    ReportResult(name.c_str(), timer.Milliseconds() / repeats, "ms");
+
+    timer.Restart();
+    for (int i = 0; i < repeats; ++i)
+        HalvePlain(image, &half);
+    name += " (plain loop)";
+    ReportResult(name.c_str(), timer.Milliseconds() / repeats, "ms");
+
+    PyramidOptions options;
+    options.level = 1;
+    uint64_t bytes = 0;
+    timer.Restart();
+    PyramidResult result = BuildZoomPyramid(image, options, [&bytes](const PyramidTile& tile)
+    {
+        bytes += tile.size;
+        return true;
+    });
+    double ms = timer.Milliseconds();
+    if (!result.ok)
+        return 1;
+    ReportResult("pyramid tiles", static_cast<double>(result.tiles), "tiles");
+    ReportResult("pyramid time", ms, "ms");
+    ReportResult("pyramid downsampling", static_cast<double>(result.downsampleMs), "ms");
+    ReportResult("pyramid cut stall", static_cast<double>(result.cutStallMs), "ms");
+    ReportResult("pyramid output", bytes / (1024.0 * 1024), "MB");
+    return 0;
+}
@@ -0,0 +1,251 @@
+#include "TestHarness.h"
+#include "ReferenceCodecs.h"
+#include "ZoomPyramid.h"
+#include "TestData.h"
+#include <map>
+#include <tuple>
+
+using TestData::ReadFile;
+using TestData::Scene;
+
+namespace
+{
+    typedef std::tuple<uint32_t, uint32_t, uint32_t> TileKey;     // level, column, row
+
+    std::map<TileKey, std::vector<uint8_t>> Build(const PixelImage& image, const PyramidOptions& options, PyramidResult* result)
+    {
+        std::map<TileKey, std::vector<uint8_t>> tiles;
+        *result = BuildZoomPyramid(image, options, [&tiles](const PyramidTile& tile)
+        {
+            std::vector<uint8_t>& png = tiles[TileKey(tile.level, tile.column, tile.row)];
+            if (!png.empty())
+                return false;       // Never twice
+            png.assign(tile.data, tile.data + tile.size);
+            return true;
+        });
+        return tiles;
+    }
+
+    // The part of `level` a tile covers, overlap included
+    PixelImage Crop(const PixelImage& level, uint32_t column, uint32_t row, const PyramidOptions& options)
+    {
+        uint32_t x0 = column * options.tileSize, y0 = row * options.tileSize;
+        uint32_t x1 = (std::min)(x0 + options.tileSize + options.overlap, level.width);
+        uint32_t y1 = (std::min)(y0 + options.tileSize + options.overlap, level.height);
+        x0 = column ? x0 - options.overlap : 0;
+        y0 = row ? y0 - options.overlap : 0;
+        PixelImage crop;
+        crop.Allocate(x1 - x0, y1 - y0);
+        crop.alpha = level.alpha;
+        for (uint32_t y = y0; y < y1; ++y)
+            memcpy(crop.Row(y - y0), level.Row(y) + x0 * 4, (x1 - x0) * 4);
+        return crop;
+    }
+}
+
+TEST_CASE(LevelsHalveDownToOnePixel)
+{
+    CHECK_EQ(PyramidLevelCount(1, 1), uint32_t(1));
+    CHECK_EQ(PyramidLevelCount(2, 1), uint32_t(2));
+    CHECK_EQ(PyramidLevelCount(3, 3), uint32_t(3));
+    CHECK_EQ(PyramidLevelCount(1024, 1024), uint32_t(11));
+    CHECK_EQ(PyramidLevelCount(1025, 7), uint32_t(12));
+
+    uint32_t width, height;
+    PyramidLevelSize(1000, 600, 10, &width, &height);
+    CHECK(width == 1000 && height == 600);
+    PyramidLevelSize(1000, 600, 9, &width, &height);
+    CHECK(width == 500 && height == 300);
+    PyramidLevelSize(1000, 600, 6, &width, &height);
+    CHECK(width == 63 && height == 38);
+    PyramidLevelSize(1000, 600, 0, &width, &height);
+    CHECK(width == 1 && height == 1);
+
+    uint32_t columns, rows;
+    PyramidGridSize(1000, 600, 256, &columns, &rows);
+    CHECK(columns == 4 && rows == 3);
+    PyramidGridSize(256, 1, 256, &columns, &rows);
+    CHECK(columns == 1 && rows == 1);
+}
+
+TEST_CASE(EveryTileDecodesToItsPartOfTheLevel)
+{
+    for (AlphaMode alpha : { AlphaMode::Ignore, AlphaMode::Straight })
+    {
+        PixelImage image = Scene(300, 130, alpha, 300);
+        PyramidOptions options;
+        options.tileSize = 64;
+        options.overlap = 2;
+        options.encodeThreads = 3;
+        options.queueDepth = 2;
+
+        PyramidResult result;
+        std::map<TileKey, std::vector<uint8_t>> tiles = Build(image, options, &result);
+        REQUIRE(result.ok);
+        CHECK_EQ(result.levels, uint32_t(10));
+
+        // Levels computed independently, largest first
+        std::vector<PixelImage> levels(result.levels);
+        REQUIRE(CopyPixelImage(image, &levels.back()));
+        for (uint32_t level = result.levels - 1; level > 0; --level)
+            REQUIRE(HalvePixelImage(levels[level], &levels[level - 1]));
+
+        uint64_t expectedTiles = 0, bytes = 0;
+        int64_t mismatches = 0;
+        for (uint32_t level = 0; level < result.levels; ++level)
+        {
+            uint32_t columns, rows;
+            PyramidGridSize(levels[level].width, levels[level].height, options.tileSize, &columns, &rows);
+            for (uint32_t row = 0; row < rows; ++row)
+            {
+                for (uint32_t column = 0; column < columns; ++column, ++expectedTiles)
+                {
+                    auto it = tiles.find(TileKey(level, column, row));
+                    REQUIRE(it != tiles.end());
+                    bytes += it->second.size();
+                    Reference::DecodedPng decoded;
+                    REQUIRE(Reference::DecodePng(it->second, &decoded));
+                    mismatches += Reference::FirstMismatch(Crop(levels[level], column, row, options), decoded) != -1;
+                }
+            }
+        }
+        CHECK_EQ(mismatches, int64_t(0));
+        CHECK_EQ(tiles.size(), static_cast<size_t>(expectedTiles));
+        CHECK_EQ(result.tiles, expectedTiles);
+        CHECK_EQ(result.encodedBytes, bytes);
+    }
+}
+
+TEST_CASE(TilesWithoutOverlapPartitionTheLevel)
+{
+    PixelImage image = Scene(128, 64, AlphaMode::Ignore, 128);
+    PyramidOptions options;
+    options.tileSize = 32;
+    options.overlap = 0;
+    PyramidResult result;
+    std::map<TileKey, std::vector<uint8_t>> tiles = Build(image, options, &result);
+    REQUIRE(result.ok);
+
+    // Top level: 4 x 2 tiles of exactly 32 x 32
+    for (uint32_t row = 0; row < 2; ++row)
+    {
+        for (uint32_t column = 0; column < 4; ++column)
+        {
+            Reference::DecodedPng decoded;
+            REQUIRE(Reference::DecodePng(tiles[TileKey(7, column, row)], &decoded));
+            CHECK(decoded.width == 32 && decoded.height == 32);
+            CHECK_EQ(Reference::FirstMismatch(Crop(image, column, row, options), decoded), int64_t(-1));
+        }
+    }
+    Reference::DecodedPng top;
+    REQUIRE(Reference::DecodePng(tiles[TileKey(0, 0, 0)], &top));
+    CHECK(top.width == 1 && top.height == 1);
+}
+
+TEST_CASE(AStoppingSinkGetsNoMoreTiles)
+{
+    PixelImage image = Scene(500, 500, AlphaMode::Ignore, 500);
+    PyramidOptions options;
+    options.tileSize = 32;
+    options.encodeThreads = 4;
+    uint32_t calls = 0;
+    PyramidResult result = BuildZoomPyramid(image, options, [&calls](const PyramidTile&) { return ++calls < 5; });
+    CHECK(!result.ok);
+    CHECK(result.stopped);
+    CHECK_EQ(calls, uint32_t(5));
+    CHECK_EQ(result.tiles, uint64_t(4));
+
+    PixelImage empty;
+    CHECK(!BuildZoomPyramid(empty, options, [](const PyramidTile&) { return true; }).ok);
+    options.tileSize = 0;
+    CHECK(!BuildZoomPyramid(image, options, [](const PyramidTile&) { return true; }).ok);
+}
+
+TEST_CASE(DziDirectoryHoldsADescriptorAndEveryTile)
+{
+    TestHarness::TempDirectory dir;
+    PixelImage image = Scene(200, 90, AlphaMode::Straight, 200);
+    PyramidOptions options;
+    options.tileSize = 64;
+
+    DziDirectoryWriter writer;
+    CHECK(!writer.WriteTile(PyramidTile()));
+    REQUIRE(writer.Open(dir / "doc.dzi", image.width, image.height, options));
+    PyramidResult built;
+    std::map<TileKey, std::vector<uint8_t>> tiles = Build(image, options, &built);
+    PyramidResult result = BuildZoomPyramid(image, options, [&writer](const PyramidTile& tile) { return writer.WriteTile(tile); });
+    REQUIRE(result.ok);
+
+    std::vector<uint8_t> descriptor = ReadFile(dir / "doc.dzi");
+    std::string text(descriptor.begin(), descriptor.end());
+    CHECK(text.find("TileSize=\"64\"") != std::string::npos);
+    CHECK(text.find("Overlap=\"1\"") != std::string::npos);
+    CHECK(text.find("<Size Width=\"200\" Height=\"90\"/>") != std::string::npos);
+
+    size_t files = 0;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(dir / "doc_files"))
+        files += entry.is_regular_file();
+    CHECK_EQ(files, tiles.size());
+    for (const auto& tile : tiles)
+    {
+        std::filesystem::path path = dir / "doc_files" / std::to_string(std::get<0>(tile.first)) /
+                                     (std::to_string(std::get<1>(tile.first)) + "_" + std::to_string(std::get<2>(tile.first)) + ".png");
+        CHECK(ReadFile(path) == tile.second);
+    }
+}
+
+TEST_CASE(PackFilesReadBackEveryTile)
+{
+    TestHarness::TempDirectory dir;
+    PixelImage image = Scene(200, 90, AlphaMode::Ignore, 200);
+    PyramidOptions options;
+    options.tileSize = 64;
+    options.overlap = 0;
+
+    std::map<TileKey, std::vector<uint8_t>> tiles;
+    PyramidPackWriter writer;
+    REQUIRE(writer.Create(dir / "doc.pack", image.width, image.height, options));
+    PyramidResult result = BuildZoomPyramid(image, options, [&](const PyramidTile& tile)
+    {
+        tiles[TileKey(tile.level, tile.column, tile.row)].assign(tile.data, tile.data + tile.size);
+        return writer.WriteTile(tile);
+    });
+    REQUIRE(result.ok);
+    REQUIRE(writer.Finish());
+
+    PyramidPackReader reader;
+    REQUIRE(reader.Open(dir / "doc.pack"));
+    CHECK(reader.Width() == 200 && reader.Height() == 90);
+    CHECK(reader.TileSize() == 64 && reader.Overlap() == 0);
+    CHECK_EQ(reader.Levels(), uint32_t(9));
+    CHECK_EQ(reader.TileCount(), tiles.size());
+    std::vector<uint8_t> png;
+    for (const auto& tile : tiles)
+    {
+        REQUIRE(reader.ReadTile(std::get<0>(tile.first), std::get<1>(tile.first), std::get<2>(tile.first), &png));
+        CHECK(png == tile.second);
+    }
+    CHECK(!reader.ReadTile(8, 4, 0, &png));
+    CHECK(!reader.ReadTile(9, 0, 0, &png));
+
+    // Damaged packs are refused rather than misread
+    std::vector<uint8_t> pack = ReadFile(dir / "doc.pack");
+    auto write = [&dir](const char* name, const std::vector<uint8_t>& bytes)
+    {
+        TestData::WriteFile(dir / name, bytes);
+        return dir / name;
+    };
+    std::vector<uint8_t> truncated(pack.begin(), pack.end() - 20);
+    CHECK(!PyramidPackReader().Open(write("truncated.pack", truncated)));
+    std::vector<uint8_t> badMagic = pack;
+    badMagic[0] = 'X';
+    CHECK(!PyramidPackReader().Open(write("magic.pack", badMagic)));
+    std::vector<uint8_t> badCount = pack;
+    badCount[badCount.size() - 8]++;
+    CHECK(!PyramidPackReader().Open(write("count.pack", badCount)));
+    std::vector<uint8_t> badOffset = pack;
+    size_t firstEntry = pack.size() - 16 - tiles.size() * 32;
+    badOffset[firstEntry + 23] = 0x7F;      // Tile offset far past the index
+    CHECK(!PyramidPackReader().Open(write("offset.pack", badOffset)));
+    CHECK(!PyramidPackReader().Open(dir / "missing.pack"));
+}